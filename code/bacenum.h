@@ -185,9 +185,6 @@ typedef enum {
     PROP_MAXIMUM_VALUE_TIMESTAMP = 149,
     PROP_MINIMUM_VALUE_TIMESTAMP = 150,
     PROP_VARIANCE_VALUE = 151,
-    PROP_MAXIMUM_VALUE_TIMESTAMP = 149,
-    PROP_MINIMUM_VALUE_TIMESTAMP = 150,
-    PROP_VARIANCE_VALUE = 151,
     PROP_ACTIVE_COV_SUBSCRIPTIONS = 152,
     PROP_BACKUP_FAILURE_TIMEOUT = 153,
     PROP_CONFIGURATION_FILES = 154,
@@ -585,6 +582,18 @@ typedef enum {
     CHARACTER_ISO8859 = 5,
 } BACNET_CHARACTER_STRING;
 
+// the type of an APDU, in the high nibble of its first octet
+typedef enum {
+    PDU_TYPE_CONFIRMED_SERVICE_REQUEST = 0,
+    PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST = 1,
+    PDU_TYPE_SIMPLE_ACK = 2,
+    PDU_TYPE_COMPLEX_ACK = 3,
+    PDU_TYPE_SEGMENT_ACK = 4,
+    PDU_TYPE_ERROR = 5,
+    PDU_TYPE_REJECT = 6,
+    PDU_TYPE_ABORT = 7
+} BACNET_PDU_TYPE;
+
 typedef enum {
     // Alarm and Event Services
     SERVICE_CONFIRMED_ACKNOWLEDGE_ALARM = 0,
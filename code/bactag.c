@@ -0,0 +1,891 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+// BACnet APDU tags
+//
+// A tag is one octet: the tag number in the upper four bits, the class
+// in bit 3, and the length of the value, or opening (6) or closing (7),
+// in the lower three bits.  Tag number 15 is followed by the number,
+// and length 5 by the length in one, three or five octets.  Most tags
+// are the one octet kind with a short length, which are taken first.
+// A constructed value is skipped by counting its opening and closing
+// tags, so nesting takes no recursion.
+//
+// A tag cannot be found by a vector compare, since where each tag
+// starts depends on the length of the one before it.  What can be is
+// whether the octets of a property identifier tag appear at all: most
+// APDUs do not hold the property that is looked for, and those are
+// passed over eight octets at a time without walking their tags.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bacenum.h"
+#include "bactag.h" // check for valid prototypes
+
+#define TAG_CONTEXT 0x08
+#define TAG_LVT_MASK 0x07
+#define TAG_NUMBER_EXTENDED 15
+#define TAG_LENGTH_EXTENDED 5
+#define TAG_OPENING 6
+#define TAG_CLOSING 7
+// application tag 1 carries its value in the length
+#define TAG_APPLICATION_BOOLEAN 1
+
+// the one octet opening and closing tags of context tag numbers below 15
+#define TAG_OPEN(number) (((number) << 4) | TAG_CONTEXT | TAG_OPENING)
+#define TAG_CLOSE(number) (((number) << 4) | TAG_CONTEXT | TAG_CLOSING)
+
+// bits of the first octet of a confirmed request or ComplexACK
+#define APDU_SEGMENTED_MESSAGE 0x08
+// the octets before the service choice, and the sequence number and
+// proposed window size of a segmented message
+#define APDU_CONFIRMED_REQUEST_HEADER 3
+#define APDU_COMPLEX_ACK_HEADER 2
+#define APDU_SEGMENT_HEADER 2
+
+unsigned BACnet_Tag_Decode(
+  const uint8_t *apdu,
+  unsigned length,
+  struct BACnet_Tag *tag)
+{
+  unsigned header = 1;
+  unsigned lvt;
+  uint32_t value_length;
+
+  if (length == 0)
+    return 0;
+  tag->number = apdu[0] >> 4;
+  tag->context = (apdu[0] & TAG_CONTEXT) != 0;
+  tag->opening = false;
+  tag->closing = false;
+  tag->length = 0;
+  lvt = apdu[0] & TAG_LVT_MASK;
+  if (tag->number == TAG_NUMBER_EXTENDED)
+  {
+    if (length < 2)
+      return 0;
+    tag->number = apdu[1];
+    header = 2;
+  }
+  if ((lvt == TAG_OPENING) || (lvt == TAG_CLOSING))
+  {
+    // only context tags open and close
+    if (!tag->context)
+      return 0;
+    tag->opening = (lvt == TAG_OPENING);
+    tag->closing = (lvt == TAG_CLOSING);
+    tag->header = header;
+    return header;
+  }
+  if (lvt == TAG_LENGTH_EXTENDED)
+  {
+    if (header >= length)
+      return 0;
+    lvt = apdu[header++];
+    if (lvt == 254)
+    {
+      if ((header + 2) > length)
+        return 0;
+      lvt = ((unsigned)apdu[header] << 8) | apdu[header + 1];
+      header += 2;
+    }
+    else if (lvt == 255)
+    {
+      if ((header + 4) > length)
+        return 0;
+      lvt = ((uint32_t)apdu[header] << 24) |
+        ((uint32_t)apdu[header + 1] << 16) |
+        ((uint32_t)apdu[header + 2] << 8) | apdu[header + 3];
+      header += 4;
+    }
+  }
+  tag->length = lvt;
+  tag->header = header;
+  value_length = lvt;
+  if (!tag->context && (tag->number == TAG_APPLICATION_BOOLEAN))
+    value_length = 0;
+  if (value_length > (length - header))
+    return 0;
+
+  return header;
+}
+
+unsigned BACnet_Tag_Skip(
+  const uint8_t *apdu,
+  unsigned length,
+  unsigned offset)
+{
+  struct BACnet_Tag tag;
+  unsigned depth = 0;
+  unsigned octets;
+  unsigned first;
+
+  do
+  {
+    if (offset >= length)
+      return 0;
+    first = apdu[offset];
+    // a one octet tag with a short value
+    if (((first & 0xF0) != 0xF0) && ((first & TAG_LVT_MASK) <
+        TAG_LENGTH_EXTENDED))
+    {
+      if ((first & 0xF8) == (TAG_APPLICATION_BOOLEAN << 4))
+        offset++;
+      else
+        offset += 1 + (first & TAG_LVT_MASK);
+      if (offset > length)
+        return 0;
+      continue;
+    }
+    octets = BACnet_Tag_Decode(&apdu[offset], length - offset, &tag);
+    if (octets == 0)
+      return 0;
+    offset += octets;
+    if (tag.opening)
+      depth++;
+    else if (tag.closing)
+    {
+      // a closing tag with no opening tag
+      if (depth == 0)
+        return 0;
+      depth--;
+    }
+    else if (tag.context || (tag.number != TAG_APPLICATION_BOOLEAN))
+      offset += tag.length;
+  } while (depth);
+
+  return offset;
+}
+
+uint32_t BACnet_Tag_Unsigned(const uint8_t *value, uint32_t length)
+{
+  uint32_t result = 0;
+  uint32_t i;
+
+  for (i = 0; i < length; i++)
+    result = (result << 8) | value[i];
+
+  return result;
+}
+
+// reads a context tagged unsigned value, if the next tag is one with
+// this number
+static bool scan_unsigned(
+  struct BACnet_Property_Scan *scan,
+  unsigned number,
+  uint32_t *value)
+{
+  struct BACnet_Tag tag;
+  unsigned octets;
+  unsigned first;
+  unsigned i;
+
+  if (scan->offset >= scan->length)
+    return false;
+  // the one octet tag of a value of up to four octets
+  first = scan->apdu[scan->offset];
+  if (((first & 0xF8) == ((number << 4) | TAG_CONTEXT)) &&
+      ((first & TAG_LVT_MASK) <= 4))
+  {
+    octets = first & TAG_LVT_MASK;
+    if ((scan->offset + 1 + octets) > scan->length)
+      return false;
+    *value = 0;
+    for (i = 1; i <= octets; i++)
+      *value = (*value << 8) | scan->apdu[scan->offset + i];
+    scan->offset += 1 + octets;
+    return true;
+  }
+  octets = BACnet_Tag_Decode(&scan->apdu[scan->offset],
+    scan->length - scan->offset, &tag);
+  if ((octets == 0) || !tag.context || tag.opening || tag.closing ||
+      (tag.number != number) || (tag.length > 4))
+    return false;
+  *value = BACnet_Tag_Unsigned(&scan->apdu[scan->offset + octets],
+    tag.length);
+  scan->offset += octets + tag.length;
+
+  return true;
+}
+
+// steps over a closing tag, if the next tag is one with this number
+static bool scan_closing(struct BACnet_Property_Scan *scan, unsigned number)
+{
+  if ((scan->offset >= scan->length) ||
+      (scan->apdu[scan->offset] != TAG_CLOSE(number)))
+    return false;
+  scan->offset++;
+
+  return true;
+}
+
+// takes the constructed value that has the opening tag number, if the
+// next tag is one
+static bool scan_value(
+  struct BACnet_Property_Scan *scan,
+  unsigned number,
+  struct BACnet_Property_Value *value)
+{
+  unsigned end;
+
+  if ((scan->offset >= scan->length) ||
+      (scan->apdu[scan->offset] != TAG_OPEN(number)))
+    return false;
+  end = BACnet_Tag_Skip(scan->apdu, scan->length, scan->offset);
+  if ((end == 0) || (scan->apdu[end - 1] != TAG_CLOSE(number)))
+    return false;
+  value->value = &scan->apdu[scan->offset + 1];
+  value->value_length = end - scan->offset - 2;
+  scan->offset = end;
+
+  return true;
+}
+
+bool BACnet_Property_Scan_Init(
+  struct BACnet_Property_Scan *scan,
+  const uint8_t *apdu,
+  unsigned length)
+{
+  unsigned offset;
+
+  if (length < 3)
+    return false;
+  switch (apdu[0] >> 4)
+  {
+    case PDU_TYPE_CONFIRMED_SERVICE_REQUEST:
+      scan->ack = false;
+      offset = APDU_CONFIRMED_REQUEST_HEADER;
+      break;
+    case PDU_TYPE_COMPLEX_ACK:
+      scan->ack = true;
+      offset = APDU_COMPLEX_ACK_HEADER;
+      break;
+    default:
+      return false;
+  }
+  if (apdu[0] & APDU_SEGMENTED_MESSAGE)
+  {
+    // only the first segment starts with the first tag
+    if ((offset >= length) || (apdu[offset] != 0))
+      return false;
+    offset += APDU_SEGMENT_HEADER;
+  }
+  if (offset >= length)
+    return false;
+  scan->service = apdu[offset++];
+  switch (scan->service)
+  {
+    case SERVICE_CONFIRMED_READ_PROPERTY:
+    case SERVICE_CONFIRMED_READ_PROPERTY_MULTIPLE:
+      break;
+    case SERVICE_CONFIRMED_WRITE_PROPERTY:
+      if (scan->ack)
+        return false;
+      break;
+    default:
+      return false;
+  }
+  scan->apdu = apdu;
+  scan->length = length;
+  scan->offset = offset;
+  scan->in_list = false;
+  scan->done = false;
+  scan->object = 0;
+
+  return true;
+}
+
+// ReadProperty and WriteProperty: the object identifier [0], the
+// property identifier [1], the array index [2] if any, and the value [3]
+// of an ACK or a write
+static bool scan_property(
+  struct BACnet_Property_Scan *scan,
+  struct BACnet_Property_Value *value)
+{
+  scan->done = true;
+  if (!scan_unsigned(scan, 0, &value->object) ||
+      !scan_unsigned(scan, 1, &value->property))
+    return false;
+  value->array_index = BACNET_ARRAY_ALL;
+  (void)scan_unsigned(scan, 2, &value->array_index);
+  value->value = NULL;
+  value->value_length = 0;
+  if (!scan->ack && (scan->service == SERVICE_CONFIRMED_READ_PROPERTY))
+    return true;
+
+  return scan_value(scan, 3, value);
+}
+
+// ReadPropertyMultiple: a list of the object identifier [0] and the
+// properties [1] of each object.  Each property of a request is its
+// identifier [0] and the array index [1] if any.  Each of an ACK is its
+// identifier [2], the array index [3] if any, and the value [4] or
+// the error [5].
+static bool scan_multiple(
+  struct BACnet_Property_Scan *scan,
+  struct BACnet_Property_Value *value)
+{
+  for (;;)
+  {
+    if (!scan->in_list)
+    {
+      if ((scan->offset >= scan->length) ||
+          !scan_unsigned(scan, 0, &scan->object) ||
+          (scan->offset >= scan->length) ||
+          (scan->apdu[scan->offset] != TAG_OPEN(1)))
+        return false;
+      scan->offset++;
+      scan->in_list = true;
+    }
+    if (!scan_closing(scan, 1))
+      break;
+    scan->in_list = false;
+  }
+  value->object = scan->object;
+  if (!scan_unsigned(scan, scan->ack ? 2 : 0, &value->property))
+    return false;
+  value->array_index = BACNET_ARRAY_ALL;
+  (void)scan_unsigned(scan, scan->ack ? 3 : 1, &value->array_index);
+  value->value = NULL;
+  value->value_length = 0;
+  if (!scan->ack)
+    return true;
+  if (scan_value(scan, 4, value))
+    return true;
+  // an error names the property without a value
+  if (!scan_value(scan, 5, value))
+    return false;
+  value->value = NULL;
+  value->value_length = 0;
+
+  return true;
+}
+
+bool BACnet_Property_Scan_Next(
+  struct BACnet_Property_Scan *scan,
+  struct BACnet_Property_Value *value)
+{
+  bool found;
+
+  if (scan->done)
+    return false;
+  if (scan->service == SERVICE_CONFIRMED_READ_PROPERTY_MULTIPLE)
+    found = scan_multiple(scan, value);
+  else
+    found = scan_property(scan, value);
+  if (!found)
+    scan->done = true;
+
+  return found;
+}
+
+// each octet that is zero in value, as 0x80, and nothing else
+static uint64_t zero_octets(uint64_t value)
+{
+  const uint64_t low7 = 0x7F7F7F7F7F7F7F7FULL;
+
+  return ~(((value & low7) + low7) | value | low7);
+}
+
+// true if the octet first is followed by second anywhere in apdu
+static bool octet_pair(
+  const uint8_t *apdu,
+  unsigned length,
+  uint8_t first,
+  uint8_t second)
+{
+  const uint64_t ones = 0x0101010101010101ULL;
+  uint64_t word;
+  unsigned offset = 0;
+
+  // eight octets at a time, overlapping by one so that no pair is split
+  while ((offset + 8) <= length)
+  {
+    memcpy(&word, &apdu[offset], sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    if ((zero_octets(word ^ (ones * first)) << 8) &
+        zero_octets(word ^ (ones * second)))
+      return true;
+    offset += 7;
+  }
+  for (; (offset + 1) < length; offset++)
+  {
+    if ((apdu[offset] == first) && (apdu[offset + 1] == second))
+      return true;
+  }
+
+  return false;
+}
+
+bool BACnet_Property_Find(
+  const uint8_t *apdu,
+  unsigned length,
+  uint32_t property,
+  struct BACnet_Property_Value *value)
+{
+  struct BACnet_Property_Scan scan;
+
+  unsigned number;
+
+  if (!BACnet_Property_Scan_Init(&scan, apdu, length))
+    return false;
+  // the last two octets of the tag of the property identifier
+  number = 1;
+  if (scan.service == SERVICE_CONFIRMED_READ_PROPERTY_MULTIPLE)
+    number = scan.ack ? 2 : 0;
+  if ((property <= 0xFF) && !octet_pair(&apdu[scan.offset],
+      length - scan.offset, (uint8_t)((number << 4) | TAG_CONTEXT | 1),
+      (uint8_t)property))
+    return false;
+  if ((property > 0xFF) && !octet_pair(&apdu[scan.offset],
+      length - scan.offset, (uint8_t)(property >> 8), (uint8_t)property))
+    return false;
+  while (BACnet_Property_Scan_Next(&scan, value))
+  {
+    if (value->property == property)
+      return true;
+  }
+
+  return false;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "monotime.h"
+#include "ctest.h"
+
+// a ReadPropertyMultiple-ACK with four values of Analog Input 1, among
+// them a string with an extended length, a boolean and a nested value
+// at an array index, and an error for Device 2
+static const uint8_t Test_RPM_ACK[] = {
+  0x30, 0x07, 0x0E,
+  0x0C, 0x00, 0x00, 0x00, 0x01,
+  0x1E,
+  0x29, 0x55, 0x4E, 0x44, 0x42, 0xC8, 0x00, 0x00, 0x4F,
+  0x29, 0x4D, 0x4E, 0x75, 0x06, 0x00, 'A', 'I', '-', '0', '1', 0x4F,
+  0x29, 0x51, 0x4E, 0x11, 0x4F,
+  0x29, 0x57, 0x39, 0x03, 0x4E, 0x0E, 0x21, 0x01, 0x0F, 0x1E, 0x21, 0x02,
+  0x1F, 0x4F,
+  0x1F,
+  0x0C, 0x02, 0x00, 0x00, 0x02,
+  0x1E,
+  0x29, 0x55, 0x5E, 0x91, 0x02, 0x91, 0x20, 0x5F,
+  0x1F
+};
+
+void testTagDecode(Test *pTest)
+{
+  struct BACnet_Tag tag;
+  uint8_t apdu[300];
+  unsigned i;
+
+  // application Unsigned of one octet
+  apdu[0] = 0x21;
+  apdu[1] = 42;
+  ct_test(pTest, BACnet_Tag_Decode(apdu, 2, &tag) == 1);
+  ct_test(pTest, !tag.context && (tag.number == 2) && (tag.length == 1));
+  ct_test(pTest, BACnet_Tag_Decode(apdu, 1, &tag) == 0);
+  ct_test(pTest, BACnet_Tag_Skip(apdu, 2, 0) == 2);
+  // an application boolean has no octets after the tag
+  apdu[0] = 0x11;
+  ct_test(pTest, BACnet_Tag_Decode(apdu, 1, &tag) == 1);
+  ct_test(pTest, tag.length == 1);
+  ct_test(pTest, BACnet_Tag_Skip(apdu, 1, 0) == 1);
+  // context tag 20, with an extended length of 254 and more
+  apdu[0] = 0xFD;
+  apdu[1] = 20;
+  apdu[2] = 254;
+  apdu[3] = 0x01;
+  apdu[4] = 0x01;
+  memset(&apdu[5], 0, 257);
+  ct_test(pTest, BACnet_Tag_Decode(apdu, 5 + 257, &tag) == 5);
+  ct_test(pTest, tag.context && (tag.number == 20) && (tag.length == 257));
+  ct_test(pTest, BACnet_Tag_Decode(apdu, 5 + 256, &tag) == 0);
+  ct_test(pTest, BACnet_Tag_Skip(apdu, 5 + 257, 0) == 5 + 257);
+  ct_test(pTest, BACnet_Tag_Skip(apdu, 5 + 256, 0) == 0);
+  apdu[2] = 255;
+  apdu[3] = 0x00;
+  apdu[4] = 0x00;
+  apdu[5] = 0x00;
+  apdu[6] = 0x10;
+  ct_test(pTest, BACnet_Tag_Decode(apdu, 7 + 16, &tag) == 7);
+  ct_test(pTest, tag.length == 16);
+  apdu[2] = 3;
+  ct_test(pTest, BACnet_Tag_Decode(apdu, 6, &tag) == 3);
+  // opening and closing tags are context tags only
+  apdu[0] = 0x3E;
+  ct_test(pTest, BACnet_Tag_Decode(apdu, 1, &tag) == 1);
+  ct_test(pTest, tag.opening && !tag.closing && (tag.number == 3));
+  apdu[0] = 0x3F;
+  ct_test(pTest, BACnet_Tag_Decode(apdu, 1, &tag) == 1);
+  ct_test(pTest, tag.closing && !tag.opening);
+  ct_test(pTest, BACnet_Tag_Skip(apdu, 1, 0) == 0);
+  apdu[0] = 0x36;
+  ct_test(pTest, BACnet_Tag_Decode(apdu, 1, &tag) == 0);
+  // nested constructed values in one pass, and unbalanced ones fail
+  apdu[0] = 0x0E;
+  apdu[1] = 0x1E;
+  apdu[2] = 0x21;
+  apdu[3] = 0x05;
+  apdu[4] = 0x1F;
+  apdu[5] = 0x2E;
+  apdu[6] = 0x2F;
+  apdu[7] = 0x0F;
+  apdu[8] = 0x21;
+  ct_test(pTest, BACnet_Tag_Skip(apdu, 9, 0) == 8);
+  ct_test(pTest, BACnet_Tag_Skip(apdu, 9, 1) == 5);
+  ct_test(pTest, BACnet_Tag_Skip(apdu, 9, 7) == 0);
+  for (i = 0; i < 8; i++)
+    ct_test(pTest, BACnet_Tag_Skip(apdu, i, 0) == 0);
+  apdu[0] = 0x0C;
+  apdu[1] = 0x02;
+  apdu[2] = 0x00;
+  apdu[3] = 0x00;
+  apdu[4] = 0x05;
+  ct_test(pTest, BACnet_Tag_Unsigned(&apdu[1], 4) == 0x02000005UL);
+  ct_test(pTest, BACnet_Tag_Unsigned(&apdu[1], 0) == 0);
+
+  return;
+}
+
+void testPropertyScan(Test *pTest)
+{
+  struct BACnet_Property_Scan scan;
+  struct BACnet_Property_Value value;
+  // ReadProperty-ACK of the Present_Value of Analog Input 5
+  const uint8_t rp_ack[] = {0x30, 0x01, 0x0C, 0x0C, 0x00, 0x00, 0x00,
+    0x05, 0x19, 0x55, 0x3E, 0x44, 0x42, 0xC8, 0x00, 0x00, 0x3F};
+  // ReadPropertyMultiple of two properties of Analog Input 1, and of
+  // one of Device 2 at an array index, segmented
+  const uint8_t rpm[] = {0x0A, 0x05, 0x01, 0x00, 0x04, 0x0E,
+    0x0C, 0x00, 0x00, 0x00, 0x01, 0x1E, 0x09, 0x55, 0x09, 0x4D, 0x1F,
+    0x0C, 0x02, 0x00, 0x00, 0x02, 0x1E, 0x09, 0x4C, 0x19, 0x00, 0x1F};
+  // WriteProperty of the Present_Value of Analog Value 3 at priority 8
+  const uint8_t wp[] = {0x00, 0x05, 0x02, 0x0F, 0x0C, 0x00, 0x80, 0x00,
+    0x03, 0x19, 0x55, 0x3E, 0x44, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x49,
+    0x08};
+  const uint8_t who_is[] = {0x10, 0x08};
+  const uint8_t rp_ack_later_segment[] = {0x38, 0x01, 0x01, 0x04, 0x0C,
+    0x0C, 0x00, 0x00, 0x00, 0x05};
+  const uint8_t wp_ack[] = {0x30, 0x01, 0x0F};
+  // ReadProperty-ACK of proprietary property 512 of Analog Input 5
+  const uint8_t rp_ack_512[] = {0x30, 0x01, 0x0C, 0x0C, 0x00, 0x00, 0x00,
+    0x05, 0x1A, 0x02, 0x00, 0x3E, 0x21, 0x01, 0x3F};
+  uint8_t octets[20];
+  unsigned length;
+  unsigned count;
+  unsigned i;
+
+  ct_test(pTest, BACnet_Property_Scan_Init(&scan, Test_RPM_ACK,
+    sizeof(Test_RPM_ACK)));
+  ct_test(pTest, BACnet_Property_Scan_Next(&scan, &value));
+  ct_test(pTest, value.object == 1);
+  ct_test(pTest, value.property == PROP_PRESENT_VALUE);
+  ct_test(pTest, value.array_index == BACNET_ARRAY_ALL);
+  ct_test(pTest, value.value_length == 5);
+  ct_test(pTest, value.value && (value.value[0] == 0x44));
+  ct_test(pTest, BACnet_Property_Scan_Next(&scan, &value));
+  ct_test(pTest, value.property == PROP_OBJECT_NAME);
+  ct_test(pTest, value.value_length == 8);
+  ct_test(pTest, memcmp(&value.value[3], "AI-01", 5) == 0);
+  ct_test(pTest, BACnet_Property_Scan_Next(&scan, &value));
+  ct_test(pTest, value.property == PROP_OUT_OF_SERVICE);
+  ct_test(pTest, value.value_length == 1);
+  ct_test(pTest, BACnet_Property_Scan_Next(&scan, &value));
+  ct_test(pTest, value.property == PROP_PRIORITY_ARRAY);
+  ct_test(pTest, value.array_index == 3);
+  ct_test(pTest, value.value_length == 8);
+  ct_test(pTest, BACnet_Property_Scan_Next(&scan, &value));
+  ct_test(pTest, value.object == ((OBJECT_DEVICE << 22) | 2));
+  ct_test(pTest, value.property == PROP_PRESENT_VALUE);
+  ct_test(pTest, value.value == NULL);
+  ct_test(pTest, !BACnet_Property_Scan_Next(&scan, &value));
+  ct_test(pTest, !BACnet_Property_Scan_Next(&scan, &value));
+  // every truncation stops the scan, after the values that fit
+  for (length = 0; length < sizeof(Test_RPM_ACK); length++)
+  {
+    count = 0;
+    if (BACnet_Property_Scan_Init(&scan, Test_RPM_ACK, length))
+    {
+      while (BACnet_Property_Scan_Next(&scan, &value))
+      {
+        ct_test(pTest, (value.value + value.value_length) <=
+          (Test_RPM_ACK + length));
+        count++;
+      }
+    }
+    ct_test(pTest, (count < 5) || (length == (sizeof(Test_RPM_ACK) - 1)));
+  }
+
+  ct_test(pTest, BACnet_Property_Find(Test_RPM_ACK, sizeof(Test_RPM_ACK),
+    PROP_PRIORITY_ARRAY, &value));
+  ct_test(pTest, value.array_index == 3);
+  ct_test(pTest, !BACnet_Property_Find(Test_RPM_ACK, sizeof(Test_RPM_ACK),
+    PROP_UNITS, &value));
+
+  ct_test(pTest, BACnet_Property_Find(rp_ack, sizeof(rp_ack),
+    PROP_PRESENT_VALUE, &value));
+  ct_test(pTest, value.object == 5);
+  ct_test(pTest, value.value_length == 5);
+  ct_test(pTest, !BACnet_Property_Find(rp_ack, sizeof(rp_ack) - 1,
+    PROP_PRESENT_VALUE, &value));
+
+  ct_test(pTest, BACnet_Property_Scan_Init(&scan, rpm, sizeof(rpm)));
+  ct_test(pTest, BACnet_Property_Scan_Next(&scan, &value));
+  ct_test(pTest, (value.object == 1) &&
+    (value.property == PROP_PRESENT_VALUE) && (value.value == NULL));
+  ct_test(pTest, BACnet_Property_Scan_Next(&scan, &value));
+  ct_test(pTest, value.property == PROP_OBJECT_NAME);
+  ct_test(pTest, BACnet_Property_Scan_Next(&scan, &value));
+  ct_test(pTest, (value.object == ((OBJECT_DEVICE << 22) | 2)) &&
+    (value.property == PROP_OBJECT_LIST) && (value.array_index == 0));
+  ct_test(pTest, !BACnet_Property_Scan_Next(&scan, &value));
+
+  ct_test(pTest, BACnet_Property_Find(wp, sizeof(wp), PROP_PRESENT_VALUE,
+    &value));
+  ct_test(pTest, value.object == ((OBJECT_ANALOG_VALUE << 22) | 3));
+  ct_test(pTest, value.value_length == 5);
+
+  ct_test(pTest, BACnet_Property_Find(rp_ack_512, sizeof(rp_ack_512), 512,
+    &value));
+  ct_test(pTest, value.value_length == 2);
+  ct_test(pTest, !BACnet_Property_Find(rp_ack_512, sizeof(rp_ack_512), 2,
+    &value));
+  // a pair of octets is found at every offset, across the words
+  for (i = 0; i < (sizeof(octets) - 1); i++)
+  {
+    memset(octets, 0x29, sizeof(octets));
+    octets[i + 1] = 0x55;
+    ct_test(pTest, octet_pair(octets, sizeof(octets), 0x29, 0x55));
+    ct_test(pTest, !octet_pair(octets, i + 1, 0x29, 0x55));
+    ct_test(pTest, !octet_pair(octets, sizeof(octets), 0x55, 0x29) ==
+      (i == (sizeof(octets) - 2)));
+  }
+
+  ct_test(pTest, !BACnet_Property_Scan_Init(&scan, who_is, sizeof(who_is)));
+  ct_test(pTest, !BACnet_Property_Scan_Init(&scan, rp_ack_later_segment,
+    sizeof(rp_ack_later_segment)));
+  ct_test(pTest, !BACnet_Property_Scan_Init(&scan, wp_ack, sizeof(wp_ack)));
+
+  return;
+}
+
+#ifdef TEST_BACTAG
+#include "npdu.h"
+#include "pcap.h"
+
+// where the Wireshark capture files live, relative to code/
+#ifndef BACTAG_CAPTURES_DIR
+#define BACTAG_CAPTURES_DIR "../captures"
+#endif
+
+#define BENCHMARK_APDUS 4096
+#define BENCHMARK_APDU_SIZE 1476
+
+static uint8_t Benchmark_APDU[BENCHMARK_APDUS][BENCHMARK_APDU_SIZE];
+static unsigned Benchmark_Length[BENCHMARK_APDUS];
+
+// the APDUs of the ReadPropertyMultiple-ACKs in BACnet/IP packets and
+// MS/TP frames of a capture
+static unsigned benchmark_load(const char *name, unsigned count)
+{
+  char filename[256];
+  struct Pcap_File file;
+  struct Pcap_Record record;
+  struct NPDU_Header header;
+  const uint8_t *npdu;
+  unsigned length;
+  unsigned offset;
+
+  snprintf(filename, sizeof(filename), "%s/%s", BACTAG_CAPTURES_DIR, name);
+  if (!Pcap_Open(&file, filename))
+    return count;
+  while ((count < BENCHMARK_APDUS) && Pcap_Next(&file, &record))
+  {
+    npdu = NULL;
+    length = 0;
+    if ((record.linktype == PCAP_LINKTYPE_ETHERNET) &&
+        (record.length > 46) && (record.data[12] == 0x08) &&
+        (record.data[13] == 0x00) && (record.data[23] == 17))
+    {
+      // IPv4, UDP, and a BVLC Original-Unicast-NPDU
+      offset = 14 + ((record.data[14] & 0x0F) * 4) + 8;
+      if (((offset + 4) < record.length) &&
+          (record.data[offset] == 0x81) && (record.data[offset + 1] == 0x0A))
+      {
+        npdu = &record.data[offset + 4];
+        length = record.length - offset - 4;
+      }
+    }
+    else if ((record.linktype == PCAP_LINKTYPE_BACNET_MS_TP) &&
+      (record.length > 10) && ((record.data[2] == 5) ||
+      (record.data[2] == 6)))
+    {
+      npdu = &record.data[8];
+      length = record.length - 10;
+    }
+    if (!npdu || !NPDU_Decode(npdu, length, &header) ||
+        (header.control & NPDU_NETWORK_LAYER_MESSAGE))
+      continue;
+    length -= header.offset;
+    if ((length > BENCHMARK_APDU_SIZE) || (length < 3) ||
+        (npdu[header.offset] != 0x30) ||
+        (npdu[header.offset + 2] != SERVICE_CONFIRMED_READ_PROPERTY_MULTIPLE))
+      continue;
+    memcpy(Benchmark_APDU[count], &npdu[header.offset], length);
+    Benchmark_Length[count] = length;
+    count++;
+  }
+  Pcap_Close(&file);
+
+  return count;
+}
+
+// an MTU of Present_Value, Object_Name and Status_Flags of one Analog
+// Input after another
+static unsigned benchmark_synthetic(uint8_t *apdu)
+{
+  unsigned length = 3;
+  unsigned instance;
+
+  apdu[0] = 0x30;
+  apdu[1] = 0;
+  apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY_MULTIPLE;
+  for (instance = 0; (length + 40) < BENCHMARK_APDU_SIZE; instance++)
+  {
+    apdu[length++] = 0x0C;
+    apdu[length++] = 0x00;
+    apdu[length++] = 0x00;
+    apdu[length++] = (uint8_t)(instance >> 8);
+    apdu[length++] = (uint8_t)instance;
+    apdu[length++] = 0x1E;
+    memcpy(&apdu[length], "\x29\x55\x4E\x44\x42\xC8\x00\x00\x4F", 9);
+    length += 9;
+    memcpy(&apdu[length], "\x29\x4D\x4E\x75\x07\x00" "AI-0000\x4F", 14);
+    length += 14;
+    memcpy(&apdu[length], "\x29\x6F\x4E\x82\x04\x00\x4F", 7);
+    length += 7;
+    apdu[length++] = 0x1F;
+  }
+
+  return length;
+}
+
+// octets a second to find Profile_Name, which few APDUs hold, and to
+// walk every tag of every APDU for every property value
+static void benchmark_scan(const char *title, unsigned count)
+{
+  struct BACnet_Property_Scan scan;
+  struct BACnet_Property_Value value;
+  unsigned long long octets = 0;
+  unsigned long found = 0;
+  unsigned long values = 0;
+  unsigned long rounds;
+  unsigned long i;
+  unsigned j;
+  double start, seconds, counted;
+
+  for (j = 0; j < count; j++)
+    octets += Benchmark_Length[j];
+  if (octets == 0)
+    return;
+  rounds = 1 + (200000000ULL / octets);
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < rounds; i++)
+  {
+    for (j = 0; j < count; j++)
+      found += BACnet_Property_Find(Benchmark_APDU[j], Benchmark_Length[j],
+        PROP_PROFILE_NAME, &value);
+  }
+  seconds = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < rounds; i++)
+  {
+    for (j = 0; j < count; j++)
+    {
+      if (BACnet_Property_Scan_Init(&scan, Benchmark_APDU[j],
+          Benchmark_Length[j]))
+      {
+        while (BACnet_Property_Scan_Next(&scan, &value))
+          values++;
+      }
+    }
+  }
+  counted = OS_MonotonicSeconds() - start;
+  printf("bactag: %s: %u APDUs, %llu octets, find %.2f GB/s, "
+    "every value %.2f GB/s, %lu values a pass (%lu)\n", title, count,
+    octets, ((double)octets * rounds) / (seconds * 1.0e9),
+    ((double)octets * rounds) / (counted * 1.0e9), values / rounds, found);
+
+  return;
+}
+
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+  unsigned count;
+
+  pTest = ct_create("bactag", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testTagDecode);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testPropertyScan);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  Benchmark_Length[0] = benchmark_synthetic(Benchmark_APDU[0]);
+  benchmark_scan("synthetic", 1);
+  count = benchmark_load("RPM_ALL_Allobjecttypes1.pcap", 0);
+  count = benchmark_load("bacnet-services.cap", count);
+  count = benchmark_load("plugfest-delta-2.cap", count);
+  benchmark_scan("captures", count);
+
+  return 0;
+}
+#endif /* TEST_BACTAG */
+#endif /* TEST */
@@ -0,0 +1,135 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef BACTAG_H
+#define BACTAG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Tags of the BACnet APDU encoding, walked in place without recursion
+// or allocation, and a scan for the property values and references of
+// the ReadProperty, ReadPropertyMultiple and WriteProperty services.
+
+// the array index of a property that is read or written whole
+#define BACNET_ARRAY_ALL 0xFFFFFFFFUL
+
+// one tag: a primitive value, or the opening or closing tag of a
+// constructed value
+struct BACnet_Tag
+{
+  uint8_t number;
+  bool context; // context specific, or application
+  bool opening;
+  bool closing;
+  // octets of the value that follows the tag, or the value itself of
+  // an application tagged boolean, which has none
+  uint32_t length;
+  unsigned header; // octets of the tag itself
+};
+
+// a property of an object, and its encoded value
+struct BACnet_Property_Value
+{
+  uint32_t object; // type and instance, as KEY_ENCODE packs them
+  uint32_t property; // BACNET_PROPERTY_ID
+  uint32_t array_index; // or BACNET_ARRAY_ALL
+  // the tags between the opening and closing tags of the value, or
+  // NULL for a property that is only named, by a request or an error
+  const uint8_t *value;
+  unsigned value_length;
+};
+
+// the state of a scan through one APDU
+struct BACnet_Property_Scan
+{
+  const uint8_t *apdu;
+  unsigned length;
+  unsigned offset; // of the next tag
+  uint8_t service; // BACNET_CONFIRMED_SERVICE
+  bool ack; // a ComplexACK, or a Confirmed-Request
+  bool in_list; // within the properties of an object of a ...Multiple
+  bool done; // the one property of ReadProperty or WriteProperty is read
+  uint32_t object;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// decodes the tag at the start of apdu.  returns the octets of the
+// tag, or 0 if it runs past length or is not a valid tag.
+unsigned BACnet_Tag_Decode(
+  const uint8_t *apdu,
+  unsigned length,
+  struct BACnet_Tag *tag);
+
+// returns the offset that follows the value at offset: a primitive
+// value, or a constructed value through its matching closing tag, in
+// one pass.  returns 0 if it runs past length or is not valid.
+unsigned BACnet_Tag_Skip(
+  const uint8_t *apdu,
+  unsigned length,
+  unsigned offset);
+
+// an unsigned value of up to four octets
+uint32_t BACnet_Tag_Unsigned(const uint8_t *value, uint32_t length);
+
+// starts a scan of a ReadProperty, ReadPropertyMultiple or
+// WriteProperty request, or of a ReadProperty or ReadPropertyMultiple
+// ComplexACK.  returns false for any other APDU.
+bool BACnet_Property_Scan_Init(
+  struct BACnet_Property_Scan *scan,
+  const uint8_t *apdu,
+  unsigned length);
+
+// reads the next property.  returns false at the end of the APDU, or
+// at a tag that does not belong.
+bool BACnet_Property_Scan_Next(
+  struct BACnet_Property_Scan *scan,
+  struct BACnet_Property_Value *value);
+
+// finds the first value or reference of property in an APDU that
+// BACnet_Property_Scan_Init accepts.  returns false if there is none.
+bool BACnet_Property_Find(
+  const uint8_t *apdu,
+  unsigned length,
+  uint32_t property,
+  struct BACnet_Property_Value *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,124 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef COBS_H
+#define COBS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Consistent Overhead Byte Stuffing of the data in the COBS-encoded
+// extended MS/TP frames.  The encoded octets are XORed with 0x55, so
+// that neither a zero nor a preamble octet is ever in the data field.
+// The data field of a frame is the encoded data followed by its
+// CRC-32K, itself encoded on its own.
+
+// the octets are XORed with this after encoding
+#define COBS_MASK 0x55
+
+// the most octets that length octets can be encoded in
+#define COBS_ENCODED_SIZE(length) ((length) + ((length) / 254) + 1)
+
+// the four octets of the CRC-32K are always encoded in five
+#define COBS_ENCODED_CRC_SIZE 5
+
+// the most octets of an encoded data field with length octets of data
+#define COBS_FRAME_ENCODED_SIZE(length) \
+  (COBS_ENCODED_SIZE(length) + COBS_ENCODED_CRC_SIZE)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Encodes length octets of from into buffer, each encoded octet XORed
+// with mask.  Returns the number of encoded octets, or zero if they
+// do not fit in buffer_size octets.
+size_t COBS_Encode(
+  uint8_t *buffer,
+  size_t buffer_size,
+  const uint8_t *from,
+  size_t length,
+  uint8_t mask);
+
+// Decodes length encoded octets of from into buffer.  buffer may be
+// from, to decode in place.  Returns the number of decoded octets, or
+// zero if the octets are not a valid encoding or do not fit in
+// buffer_size octets.
+size_t COBS_Decode(
+  uint8_t *buffer,
+  size_t buffer_size,
+  const uint8_t *from,
+  size_t length,
+  uint8_t mask);
+
+// the reference octet-at-a-time codec - for testing and benchmarks
+size_t COBS_Encode_Bytewise(
+  uint8_t *buffer,
+  size_t buffer_size,
+  const uint8_t *from,
+  size_t length,
+  uint8_t mask);
+size_t COBS_Decode_Bytewise(
+  uint8_t *buffer,
+  size_t buffer_size,
+  const uint8_t *from,
+  size_t length,
+  uint8_t mask);
+
+// Builds the data field of an extended frame in buffer: the length
+// octets of data, encoded, and their CRC-32K, encoded.  The data must
+// not be in buffer.  Returns the number of octets in the data field,
+// or zero if it does not fit in buffer_size octets.
+size_t COBS_Frame_Encode(
+  uint8_t *buffer,
+  size_t buffer_size,
+  const uint8_t *data,
+  size_t length);
+
+// Checks the CRC-32K of the length octets of the data field of an
+// extended frame, and decodes its data into buffer, which may be from.
+// Returns the number of data octets, or zero if the CRC is bad or the
+// data field is not a valid encoding.
+size_t COBS_Frame_Decode(
+  uint8_t *buffer,
+  size_t buffer_size,
+  const uint8_t *from,
+  size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
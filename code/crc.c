@@ -0,0 +1,1387 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// MS/TP header and data CRC routines
+//
+// The octet-at-a-time routines are copied directly from the BACnet
+// standard and are kept as the reference.  The block routines use
+// lookup tables that were generated from the reference routines.
+// The data CRC can also be run slice-by-8, which consumes eight
+// octets per step using eight tables, as the CRC-32K of the
+// COBS-encoded extended frames always is.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "crc.h" // check for valid prototypes
+
+// HeaderCRC of each octet value accumulated into a zero CRC
+static const uint8_t Header_CRC_Table[256] =
+{
+  0x00, 0xFE, 0xFF, 0x01, 0xFD, 0x03, 0x02, 0xFC, 0xF9, 0x07, 0x06, 0xF8,
+  0x04, 0xFA, 0xFB, 0x05, 0xF1, 0x0F, 0x0E, 0xF0, 0x0C, 0xF2, 0xF3, 0x0D,
+  0x08, 0xF6, 0xF7, 0x09, 0xF5, 0x0B, 0x0A, 0xF4, 0xE1, 0x1F, 0x1E, 0xE0,
+  0x1C, 0xE2, 0xE3, 0x1D, 0x18, 0xE6, 0xE7, 0x19, 0xE5, 0x1B, 0x1A, 0xE4,
+  0x10, 0xEE, 0xEF, 0x11, 0xED, 0x13, 0x12, 0xEC, 0xE9, 0x17, 0x16, 0xE8,
+  0x14, 0xEA, 0xEB, 0x15, 0xC1, 0x3F, 0x3E, 0xC0, 0x3C, 0xC2, 0xC3, 0x3D,
+  0x38, 0xC6, 0xC7, 0x39, 0xC5, 0x3B, 0x3A, 0xC4, 0x30, 0xCE, 0xCF, 0x31,
+  0xCD, 0x33, 0x32, 0xCC, 0xC9, 0x37, 0x36, 0xC8, 0x34, 0xCA, 0xCB, 0x35,
+  0x20, 0xDE, 0xDF, 0x21, 0xDD, 0x23, 0x22, 0xDC, 0xD9, 0x27, 0x26, 0xD8,
+  0x24, 0xDA, 0xDB, 0x25, 0xD1, 0x2F, 0x2E, 0xD0, 0x2C, 0xD2, 0xD3, 0x2D,
+  0x28, 0xD6, 0xD7, 0x29, 0xD5, 0x2B, 0x2A, 0xD4, 0x81, 0x7F, 0x7E, 0x80,
+  0x7C, 0x82, 0x83, 0x7D, 0x78, 0x86, 0x87, 0x79, 0x85, 0x7B, 0x7A, 0x84,
+  0x70, 0x8E, 0x8F, 0x71, 0x8D, 0x73, 0x72, 0x8C, 0x89, 0x77, 0x76, 0x88,
+  0x74, 0x8A, 0x8B, 0x75, 0x60, 0x9E, 0x9F, 0x61, 0x9D, 0x63, 0x62, 0x9C,
+  0x99, 0x67, 0x66, 0x98, 0x64, 0x9A, 0x9B, 0x65, 0x91, 0x6F, 0x6E, 0x90,
+  0x6C, 0x92, 0x93, 0x6D, 0x68, 0x96, 0x97, 0x69, 0x95, 0x6B, 0x6A, 0x94,
+  0x40, 0xBE, 0xBF, 0x41, 0xBD, 0x43, 0x42, 0xBC, 0xB9, 0x47, 0x46, 0xB8,
+  0x44, 0xBA, 0xBB, 0x45, 0xB1, 0x4F, 0x4E, 0xB0, 0x4C, 0xB2, 0xB3, 0x4D,
+  0x48, 0xB6, 0xB7, 0x49, 0xB5, 0x4B, 0x4A, 0xB4, 0xA1, 0x5F, 0x5E, 0xA0,
+  0x5C, 0xA2, 0xA3, 0x5D, 0x58, 0xA6, 0xA7, 0x59, 0xA5, 0x5B, 0x5A, 0xA4,
+  0x50, 0xAE, 0xAF, 0x51, 0xAD, 0x53, 0x52, 0xAC, 0xA9, 0x57, 0x56, 0xA8,
+  0x54, 0xAA, 0xAB, 0x55
+};
+
+// DataCRC tables for slice-by-8.  Data_CRC_Table[0] is the classic
+// 256-entry table; Data_CRC_Table[k] advances an octet through k
+// further zero octets.
+static const uint16_t Data_CRC_Table[8][256] =
+{
+  {
+    0x0000, 0x1189, 0x2312, 0x329B, 0x4624, 0x57AD, 0x6536, 0x74BF,
+    0x8C48, 0x9DC1, 0xAF5A, 0xBED3, 0xCA6C, 0xDBE5, 0xE97E, 0xF8F7,
+    0x1081, 0x0108, 0x3393, 0x221A, 0x56A5, 0x472C, 0x75B7, 0x643E,
+    0x9CC9, 0x8D40, 0xBFDB, 0xAE52, 0xDAED, 0xCB64, 0xF9FF, 0xE876,
+    0x2102, 0x308B, 0x0210, 0x1399, 0x6726, 0x76AF, 0x4434, 0x55BD,
+    0xAD4A, 0xBCC3, 0x8E58, 0x9FD1, 0xEB6E, 0xFAE7, 0xC87C, 0xD9F5,
+    0x3183, 0x200A, 0x1291, 0x0318, 0x77A7, 0x662E, 0x54B5, 0x453C,
+    0xBDCB, 0xAC42, 0x9ED9, 0x8F50, 0xFBEF, 0xEA66, 0xD8FD, 0xC974,
+    0x4204, 0x538D, 0x6116, 0x709F, 0x0420, 0x15A9, 0x2732, 0x36BB,
+    0xCE4C, 0xDFC5, 0xED5E, 0xFCD7, 0x8868, 0x99E1, 0xAB7A, 0xBAF3,
+    0x5285, 0x430C, 0x7197, 0x601E, 0x14A1, 0x0528, 0x37B3, 0x263A,
+    0xDECD, 0xCF44, 0xFDDF, 0xEC56, 0x98E9, 0x8960, 0xBBFB, 0xAA72,
+    0x6306, 0x728F, 0x4014, 0x519D, 0x2522, 0x34AB, 0x0630, 0x17B9,
+    0xEF4E, 0xFEC7, 0xCC5C, 0xDDD5, 0xA96A, 0xB8E3, 0x8A78, 0x9BF1,
+    0x7387, 0x620E, 0x5095, 0x411C, 0x35A3, 0x242A, 0x16B1, 0x0738,
+    0xFFCF, 0xEE46, 0xDCDD, 0xCD54, 0xB9EB, 0xA862, 0x9AF9, 0x8B70,
+    0x8408, 0x9581, 0xA71A, 0xB693, 0xC22C, 0xD3A5, 0xE13E, 0xF0B7,
+    0x0840, 0x19C9, 0x2B52, 0x3ADB, 0x4E64, 0x5FED, 0x6D76, 0x7CFF,
+    0x9489, 0x8500, 0xB79B, 0xA612, 0xD2AD, 0xC324, 0xF1BF, 0xE036,
+    0x18C1, 0x0948, 0x3BD3, 0x2A5A, 0x5EE5, 0x4F6C, 0x7DF7, 0x6C7E,
+    0xA50A, 0xB483, 0x8618, 0x9791, 0xE32E, 0xF2A7, 0xC03C, 0xD1B5,
+    0x2942, 0x38CB, 0x0A50, 0x1BD9, 0x6F66, 0x7EEF, 0x4C74, 0x5DFD,
+    0xB58B, 0xA402, 0x9699, 0x8710, 0xF3AF, 0xE226, 0xD0BD, 0xC134,
+    0x39C3, 0x284A, 0x1AD1, 0x0B58, 0x7FE7, 0x6E6E, 0x5CF5, 0x4D7C,
+    0xC60C, 0xD785, 0xE51E, 0xF497, 0x8028, 0x91A1, 0xA33A, 0xB2B3,
+    0x4A44, 0x5BCD, 0x6956, 0x78DF, 0x0C60, 0x1DE9, 0x2F72, 0x3EFB,
+    0xD68D, 0xC704, 0xF59F, 0xE416, 0x90A9, 0x8120, 0xB3BB, 0xA232,
+    0x5AC5, 0x4B4C, 0x79D7, 0x685E, 0x1CE1, 0x0D68, 0x3FF3, 0x2E7A,
+    0xE70E, 0xF687, 0xC41C, 0xD595, 0xA12A, 0xB0A3, 0x8238, 0x93B1,
+    0x6B46, 0x7ACF, 0x4854, 0x59DD, 0x2D62, 0x3CEB, 0x0E70, 0x1FF9,
+    0xF78F, 0xE606, 0xD49D, 0xC514, 0xB1AB, 0xA022, 0x92B9, 0x8330,
+    0x7BC7, 0x6A4E, 0x58D5, 0x495C, 0x3DE3, 0x2C6A, 0x1EF1, 0x0F78
+  },
+  {
+    0x0000, 0x19D8, 0x33B0, 0x2A68, 0x6760, 0x7EB8, 0x54D0, 0x4D08,
+    0xCEC0, 0xD718, 0xFD70, 0xE4A8, 0xA9A0, 0xB078, 0x9A10, 0x83C8,
+    0x9591, 0x8C49, 0xA621, 0xBFF9, 0xF2F1, 0xEB29, 0xC141, 0xD899,
+    0x5B51, 0x4289, 0x68E1, 0x7139, 0x3C31, 0x25E9, 0x0F81, 0x1659,
+    0x2333, 0x3AEB, 0x1083, 0x095B, 0x4453, 0x5D8B, 0x77E3, 0x6E3B,
+    0xEDF3, 0xF42B, 0xDE43, 0xC79B, 0x8A93, 0x934B, 0xB923, 0xA0FB,
+    0xB6A2, 0xAF7A, 0x8512, 0x9CCA, 0xD1C2, 0xC81A, 0xE272, 0xFBAA,
+    0x7862, 0x61BA, 0x4BD2, 0x520A, 0x1F02, 0x06DA, 0x2CB2, 0x356A,
+    0x4666, 0x5FBE, 0x75D6, 0x6C0E, 0x2106, 0x38DE, 0x12B6, 0x0B6E,
+    0x88A6, 0x917E, 0xBB16, 0xA2CE, 0xEFC6, 0xF61E, 0xDC76, 0xC5AE,
+    0xD3F7, 0xCA2F, 0xE047, 0xF99F, 0xB497, 0xAD4F, 0x8727, 0x9EFF,
+    0x1D37, 0x04EF, 0x2E87, 0x375F, 0x7A57, 0x638F, 0x49E7, 0x503F,
+    0x6555, 0x7C8D, 0x56E5, 0x4F3D, 0x0235, 0x1BED, 0x3185, 0x285D,
+    0xAB95, 0xB24D, 0x9825, 0x81FD, 0xCCF5, 0xD52D, 0xFF45, 0xE69D,
+    0xF0C4, 0xE91C, 0xC374, 0xDAAC, 0x97A4, 0x8E7C, 0xA414, 0xBDCC,
+    0x3E04, 0x27DC, 0x0DB4, 0x146C, 0x5964, 0x40BC, 0x6AD4, 0x730C,
+    0x8CCC, 0x9514, 0xBF7C, 0xA6A4, 0xEBAC, 0xF274, 0xD81C, 0xC1C4,
+    0x420C, 0x5BD4, 0x71BC, 0x6864, 0x256C, 0x3CB4, 0x16DC, 0x0F04,
+    0x195D, 0x0085, 0x2AED, 0x3335, 0x7E3D, 0x67E5, 0x4D8D, 0x5455,
+    0xD79D, 0xCE45, 0xE42D, 0xFDF5, 0xB0FD, 0xA925, 0x834D, 0x9A95,
+    0xAFFF, 0xB627, 0x9C4F, 0x8597, 0xC89F, 0xD147, 0xFB2F, 0xE2F7,
+    0x613F, 0x78E7, 0x528F, 0x4B57, 0x065F, 0x1F87, 0x35EF, 0x2C37,
+    0x3A6E, 0x23B6, 0x09DE, 0x1006, 0x5D0E, 0x44D6, 0x6EBE, 0x7766,
+    0xF4AE, 0xED76, 0xC71E, 0xDEC6, 0x93CE, 0x8A16, 0xA07E, 0xB9A6,
+    0xCAAA, 0xD372, 0xF91A, 0xE0C2, 0xADCA, 0xB412, 0x9E7A, 0x87A2,
+    0x046A, 0x1DB2, 0x37DA, 0x2E02, 0x630A, 0x7AD2, 0x50BA, 0x4962,
+    0x5F3B, 0x46E3, 0x6C8B, 0x7553, 0x385B, 0x2183, 0x0BEB, 0x1233,
+    0x91FB, 0x8823, 0xA24B, 0xBB93, 0xF69B, 0xEF43, 0xC52B, 0xDCF3,
+    0xE999, 0xF041, 0xDA29, 0xC3F1, 0x8EF9, 0x9721, 0xBD49, 0xA491,
+    0x2759, 0x3E81, 0x14E9, 0x0D31, 0x4039, 0x59E1, 0x7389, 0x6A51,
+    0x7C08, 0x65D0, 0x4FB8, 0x5660, 0x1B68, 0x02B0, 0x28D8, 0x3100,
+    0xB2C8, 0xAB10, 0x8178, 0x98A0, 0xD5A8, 0xCC70, 0xE618, 0xFFC0
+  },
+  {
+    0x0000, 0x5ADC, 0xB5B8, 0xEF64, 0x6361, 0x39BD, 0xD6D9, 0x8C05,
+    0xC6C2, 0x9C1E, 0x737A, 0x29A6, 0xA5A3, 0xFF7F, 0x101B, 0x4AC7,
+    0x8595, 0xDF49, 0x302D, 0x6AF1, 0xE6F4, 0xBC28, 0x534C, 0x0990,
+    0x4357, 0x198B, 0xF6EF, 0xAC33, 0x2036, 0x7AEA, 0x958E, 0xCF52,
+    0x033B, 0x59E7, 0xB683, 0xEC5F, 0x605A, 0x3A86, 0xD5E2, 0x8F3E,
+    0xC5F9, 0x9F25, 0x7041, 0x2A9D, 0xA698, 0xFC44, 0x1320, 0x49FC,
+    0x86AE, 0xDC72, 0x3316, 0x69CA, 0xE5CF, 0xBF13, 0x5077, 0x0AAB,
+    0x406C, 0x1AB0, 0xF5D4, 0xAF08, 0x230D, 0x79D1, 0x96B5, 0xCC69,
+    0x0676, 0x5CAA, 0xB3CE, 0xE912, 0x6517, 0x3FCB, 0xD0AF, 0x8A73,
+    0xC0B4, 0x9A68, 0x750C, 0x2FD0, 0xA3D5, 0xF909, 0x166D, 0x4CB1,
+    0x83E3, 0xD93F, 0x365B, 0x6C87, 0xE082, 0xBA5E, 0x553A, 0x0FE6,
+    0x4521, 0x1FFD, 0xF099, 0xAA45, 0x2640, 0x7C9C, 0x93F8, 0xC924,
+    0x054D, 0x5F91, 0xB0F5, 0xEA29, 0x662C, 0x3CF0, 0xD394, 0x8948,
+    0xC38F, 0x9953, 0x7637, 0x2CEB, 0xA0EE, 0xFA32, 0x1556, 0x4F8A,
+    0x80D8, 0xDA04, 0x3560, 0x6FBC, 0xE3B9, 0xB965, 0x5601, 0x0CDD,
+    0x461A, 0x1CC6, 0xF3A2, 0xA97E, 0x257B, 0x7FA7, 0x90C3, 0xCA1F,
+    0x0CEC, 0x5630, 0xB954, 0xE388, 0x6F8D, 0x3551, 0xDA35, 0x80E9,
+    0xCA2E, 0x90F2, 0x7F96, 0x254A, 0xA94F, 0xF393, 0x1CF7, 0x462B,
+    0x8979, 0xD3A5, 0x3CC1, 0x661D, 0xEA18, 0xB0C4, 0x5FA0, 0x057C,
+    0x4FBB, 0x1567, 0xFA03, 0xA0DF, 0x2CDA, 0x7606, 0x9962, 0xC3BE,
+    0x0FD7, 0x550B, 0xBA6F, 0xE0B3, 0x6CB6, 0x366A, 0xD90E, 0x83D2,
+    0xC915, 0x93C9, 0x7CAD, 0x2671, 0xAA74, 0xF0A8, 0x1FCC, 0x4510,
+    0x8A42, 0xD09E, 0x3FFA, 0x6526, 0xE923, 0xB3FF, 0x5C9B, 0x0647,
+    0x4C80, 0x165C, 0xF938, 0xA3E4, 0x2FE1, 0x753D, 0x9A59, 0xC085,
+    0x0A9A, 0x5046, 0xBF22, 0xE5FE, 0x69FB, 0x3327, 0xDC43, 0x869F,
+    0xCC58, 0x9684, 0x79E0, 0x233C, 0xAF39, 0xF5E5, 0x1A81, 0x405D,
+    0x8F0F, 0xD5D3, 0x3AB7, 0x606B, 0xEC6E, 0xB6B2, 0x59D6, 0x030A,
+    0x49CD, 0x1311, 0xFC75, 0xA6A9, 0x2AAC, 0x7070, 0x9F14, 0xC5C8,
+    0x09A1, 0x537D, 0xBC19, 0xE6C5, 0x6AC0, 0x301C, 0xDF78, 0x85A4,
+    0xCF63, 0x95BF, 0x7ADB, 0x2007, 0xAC02, 0xF6DE, 0x19BA, 0x4366,
+    0x8C34, 0xD6E8, 0x398C, 0x6350, 0xEF55, 0xB589, 0x5AED, 0x0031,
+    0x4AF6, 0x102A, 0xFF4E, 0xA592, 0x2997, 0x734B, 0x9C2F, 0xC6F3
+  },
+  {
+    0x0000, 0x1CBB, 0x3976, 0x25CD, 0x72EC, 0x6E57, 0x4B9A, 0x5721,
+    0xE5D8, 0xF963, 0xDCAE, 0xC015, 0x9734, 0x8B8F, 0xAE42, 0xB2F9,
+    0xC3A1, 0xDF1A, 0xFAD7, 0xE66C, 0xB14D, 0xADF6, 0x883B, 0x9480,
+    0x2679, 0x3AC2, 0x1F0F, 0x03B4, 0x5495, 0x482E, 0x6DE3, 0x7158,
+    0x8F53, 0x93E8, 0xB625, 0xAA9E, 0xFDBF, 0xE104, 0xC4C9, 0xD872,
+    0x6A8B, 0x7630, 0x53FD, 0x4F46, 0x1867, 0x04DC, 0x2111, 0x3DAA,
+    0x4CF2, 0x5049, 0x7584, 0x693F, 0x3E1E, 0x22A5, 0x0768, 0x1BD3,
+    0xA92A, 0xB591, 0x905C, 0x8CE7, 0xDBC6, 0xC77D, 0xE2B0, 0xFE0B,
+    0x16B7, 0x0A0C, 0x2FC1, 0x337A, 0x645B, 0x78E0, 0x5D2D, 0x4196,
+    0xF36F, 0xEFD4, 0xCA19, 0xD6A2, 0x8183, 0x9D38, 0xB8F5, 0xA44E,
+    0xD516, 0xC9AD, 0xEC60, 0xF0DB, 0xA7FA, 0xBB41, 0x9E8C, 0x8237,
+    0x30CE, 0x2C75, 0x09B8, 0x1503, 0x4222, 0x5E99, 0x7B54, 0x67EF,
+    0x99E4, 0x855F, 0xA092, 0xBC29, 0xEB08, 0xF7B3, 0xD27E, 0xCEC5,
+    0x7C3C, 0x6087, 0x454A, 0x59F1, 0x0ED0, 0x126B, 0x37A6, 0x2B1D,
+    0x5A45, 0x46FE, 0x6333, 0x7F88, 0x28A9, 0x3412, 0x11DF, 0x0D64,
+    0xBF9D, 0xA326, 0x86EB, 0x9A50, 0xCD71, 0xD1CA, 0xF407, 0xE8BC,
+    0x2D6E, 0x31D5, 0x1418, 0x08A3, 0x5F82, 0x4339, 0x66F4, 0x7A4F,
+    0xC8B6, 0xD40D, 0xF1C0, 0xED7B, 0xBA5A, 0xA6E1, 0x832C, 0x9F97,
+    0xEECF, 0xF274, 0xD7B9, 0xCB02, 0x9C23, 0x8098, 0xA555, 0xB9EE,
+    0x0B17, 0x17AC, 0x3261, 0x2EDA, 0x79FB, 0x6540, 0x408D, 0x5C36,
+    0xA23D, 0xBE86, 0x9B4B, 0x87F0, 0xD0D1, 0xCC6A, 0xE9A7, 0xF51C,
+    0x47E5, 0x5B5E, 0x7E93, 0x6228, 0x3509, 0x29B2, 0x0C7F, 0x10C4,
+    0x619C, 0x7D27, 0x58EA, 0x4451, 0x1370, 0x0FCB, 0x2A06, 0x36BD,
+    0x8444, 0x98FF, 0xBD32, 0xA189, 0xF6A8, 0xEA13, 0xCFDE, 0xD365,
+    0x3BD9, 0x2762, 0x02AF, 0x1E14, 0x4935, 0x558E, 0x7043, 0x6CF8,
+    0xDE01, 0xC2BA, 0xE777, 0xFBCC, 0xACED, 0xB056, 0x959B, 0x8920,
+    0xF878, 0xE4C3, 0xC10E, 0xDDB5, 0x8A94, 0x962F, 0xB3E2, 0xAF59,
+    0x1DA0, 0x011B, 0x24D6, 0x386D, 0x6F4C, 0x73F7, 0x563A, 0x4A81,
+    0xB48A, 0xA831, 0x8DFC, 0x9147, 0xC666, 0xDADD, 0xFF10, 0xE3AB,
+    0x5152, 0x4DE9, 0x6824, 0x749F, 0x23BE, 0x3F05, 0x1AC8, 0x0673,
+    0x772B, 0x6B90, 0x4E5D, 0x52E6, 0x05C7, 0x197C, 0x3CB1, 0x200A,
+    0x92F3, 0x8E48, 0xAB85, 0xB73E, 0xE01F, 0xFCA4, 0xD969, 0xC5D2
+  },
+  {
+    0x0000, 0x0B44, 0x1688, 0x1DCC, 0x2D10, 0x2654, 0x3B98, 0x30DC,
+    0x5A20, 0x5164, 0x4CA8, 0x47EC, 0x7730, 0x7C74, 0x61B8, 0x6AFC,
+    0xB440, 0xBF04, 0xA2C8, 0xA98C, 0x9950, 0x9214, 0x8FD8, 0x849C,
+    0xEE60, 0xE524, 0xF8E8, 0xF3AC, 0xC370, 0xC834, 0xD5F8, 0xDEBC,
+    0x6091, 0x6BD5, 0x7619, 0x7D5D, 0x4D81, 0x46C5, 0x5B09, 0x504D,
+    0x3AB1, 0x31F5, 0x2C39, 0x277D, 0x17A1, 0x1CE5, 0x0129, 0x0A6D,
+    0xD4D1, 0xDF95, 0xC259, 0xC91D, 0xF9C1, 0xF285, 0xEF49, 0xE40D,
+    0x8EF1, 0x85B5, 0x9879, 0x933D, 0xA3E1, 0xA8A5, 0xB569, 0xBE2D,
+    0xC122, 0xCA66, 0xD7AA, 0xDCEE, 0xEC32, 0xE776, 0xFABA, 0xF1FE,
+    0x9B02, 0x9046, 0x8D8A, 0x86CE, 0xB612, 0xBD56, 0xA09A, 0xABDE,
+    0x7562, 0x7E26, 0x63EA, 0x68AE, 0x5872, 0x5336, 0x4EFA, 0x45BE,
+    0x2F42, 0x2406, 0x39CA, 0x328E, 0x0252, 0x0916, 0x14DA, 0x1F9E,
+    0xA1B3, 0xAAF7, 0xB73B, 0xBC7F, 0x8CA3, 0x87E7, 0x9A2B, 0x916F,
+    0xFB93, 0xF0D7, 0xED1B, 0xE65F, 0xD683, 0xDDC7, 0xC00B, 0xCB4F,
+    0x15F3, 0x1EB7, 0x037B, 0x083F, 0x38E3, 0x33A7, 0x2E6B, 0x252F,
+    0x4FD3, 0x4497, 0x595B, 0x521F, 0x62C3, 0x6987, 0x744B, 0x7F0F,
+    0x8A55, 0x8111, 0x9CDD, 0x9799, 0xA745, 0xAC01, 0xB1CD, 0xBA89,
+    0xD075, 0xDB31, 0xC6FD, 0xCDB9, 0xFD65, 0xF621, 0xEBED, 0xE0A9,
+    0x3E15, 0x3551, 0x289D, 0x23D9, 0x1305, 0x1841, 0x058D, 0x0EC9,
+    0x6435, 0x6F71, 0x72BD, 0x79F9, 0x4925, 0x4261, 0x5FAD, 0x54E9,
+    0xEAC4, 0xE180, 0xFC4C, 0xF708, 0xC7D4, 0xCC90, 0xD15C, 0xDA18,
+    0xB0E4, 0xBBA0, 0xA66C, 0xAD28, 0x9DF4, 0x96B0, 0x8B7C, 0x8038,
+    0x5E84, 0x55C0, 0x480C, 0x4348, 0x7394, 0x78D0, 0x651C, 0x6E58,
+    0x04A4, 0x0FE0, 0x122C, 0x1968, 0x29B4, 0x22F0, 0x3F3C, 0x3478,
+    0x4B77, 0x4033, 0x5DFF, 0x56BB, 0x6667, 0x6D23, 0x70EF, 0x7BAB,
+    0x1157, 0x1A13, 0x07DF, 0x0C9B, 0x3C47, 0x3703, 0x2ACF, 0x218B,
+    0xFF37, 0xF473, 0xE9BF, 0xE2FB, 0xD227, 0xD963, 0xC4AF, 0xCFEB,
+    0xA517, 0xAE53, 0xB39F, 0xB8DB, 0x8807, 0x8343, 0x9E8F, 0x95CB,
+    0x2BE6, 0x20A2, 0x3D6E, 0x362A, 0x06F6, 0x0DB2, 0x107E, 0x1B3A,
+    0x71C6, 0x7A82, 0x674E, 0x6C0A, 0x5CD6, 0x5792, 0x4A5E, 0x411A,
+    0x9FA6, 0x94E2, 0x892E, 0x826A, 0xB2B6, 0xB9F2, 0xA43E, 0xAF7A,
+    0xC586, 0xCEC2, 0xD30E, 0xD84A, 0xE896, 0xE3D2, 0xFE1E, 0xF55A
+  },
+  {
+    0x0000, 0x042B, 0x0856, 0x0C7D, 0x10AC, 0x1487, 0x18FA, 0x1CD1,
+    0x2158, 0x2573, 0x290E, 0x2D25, 0x31F4, 0x35DF, 0x39A2, 0x3D89,
+    0x42B0, 0x469B, 0x4AE6, 0x4ECD, 0x521C, 0x5637, 0x5A4A, 0x5E61,
+    0x63E8, 0x67C3, 0x6BBE, 0x6F95, 0x7344, 0x776F, 0x7B12, 0x7F39,
+    0x8560, 0x814B, 0x8D36, 0x891D, 0x95CC, 0x91E7, 0x9D9A, 0x99B1,
+    0xA438, 0xA013, 0xAC6E, 0xA845, 0xB494, 0xB0BF, 0xBCC2, 0xB8E9,
+    0xC7D0, 0xC3FB, 0xCF86, 0xCBAD, 0xD77C, 0xD357, 0xDF2A, 0xDB01,
+    0xE688, 0xE2A3, 0xEEDE, 0xEAF5, 0xF624, 0xF20F, 0xFE72, 0xFA59,
+    0x02D1, 0x06FA, 0x0A87, 0x0EAC, 0x127D, 0x1656, 0x1A2B, 0x1E00,
+    0x2389, 0x27A2, 0x2BDF, 0x2FF4, 0x3325, 0x370E, 0x3B73, 0x3F58,
+    0x4061, 0x444A, 0x4837, 0x4C1C, 0x50CD, 0x54E6, 0x589B, 0x5CB0,
+    0x6139, 0x6512, 0x696F, 0x6D44, 0x7195, 0x75BE, 0x79C3, 0x7DE8,
+    0x87B1, 0x839A, 0x8FE7, 0x8BCC, 0x971D, 0x9336, 0x9F4B, 0x9B60,
+    0xA6E9, 0xA2C2, 0xAEBF, 0xAA94, 0xB645, 0xB26E, 0xBE13, 0xBA38,
+    0xC501, 0xC12A, 0xCD57, 0xC97C, 0xD5AD, 0xD186, 0xDDFB, 0xD9D0,
+    0xE459, 0xE072, 0xEC0F, 0xE824, 0xF4F5, 0xF0DE, 0xFCA3, 0xF888,
+    0x05A2, 0x0189, 0x0DF4, 0x09DF, 0x150E, 0x1125, 0x1D58, 0x1973,
+    0x24FA, 0x20D1, 0x2CAC, 0x2887, 0x3456, 0x307D, 0x3C00, 0x382B,
+    0x4712, 0x4339, 0x4F44, 0x4B6F, 0x57BE, 0x5395, 0x5FE8, 0x5BC3,
+    0x664A, 0x6261, 0x6E1C, 0x6A37, 0x76E6, 0x72CD, 0x7EB0, 0x7A9B,
+    0x80C2, 0x84E9, 0x8894, 0x8CBF, 0x906E, 0x9445, 0x9838, 0x9C13,
+    0xA19A, 0xA5B1, 0xA9CC, 0xADE7, 0xB136, 0xB51D, 0xB960, 0xBD4B,
+    0xC272, 0xC659, 0xCA24, 0xCE0F, 0xD2DE, 0xD6F5, 0xDA88, 0xDEA3,
+    0xE32A, 0xE701, 0xEB7C, 0xEF57, 0xF386, 0xF7AD, 0xFBD0, 0xFFFB,
+    0x0773, 0x0358, 0x0F25, 0x0B0E, 0x17DF, 0x13F4, 0x1F89, 0x1BA2,
+    0x262B, 0x2200, 0x2E7D, 0x2A56, 0x3687, 0x32AC, 0x3ED1, 0x3AFA,
+    0x45C3, 0x41E8, 0x4D95, 0x49BE, 0x556F, 0x5144, 0x5D39, 0x5912,
+    0x649B, 0x60B0, 0x6CCD, 0x68E6, 0x7437, 0x701C, 0x7C61, 0x784A,
+    0x8213, 0x8638, 0x8A45, 0x8E6E, 0x92BF, 0x9694, 0x9AE9, 0x9EC2,
+    0xA34B, 0xA760, 0xAB1D, 0xAF36, 0xB3E7, 0xB7CC, 0xBBB1, 0xBF9A,
+    0xC0A3, 0xC488, 0xC8F5, 0xCCDE, 0xD00F, 0xD424, 0xD859, 0xDC72,
+    0xE1FB, 0xE5D0, 0xE9AD, 0xED86, 0xF157, 0xF57C, 0xF901, 0xFD2A
+  },
+  {
+    0x0000, 0x9FD5, 0x37BB, 0xA86E, 0x6F76, 0xF0A3, 0x58CD, 0xC718,
+    0xDEEC, 0x4139, 0xE957, 0x7682, 0xB19A, 0x2E4F, 0x8621, 0x19F4,
+    0xB5C9, 0x2A1C, 0x8272, 0x1DA7, 0xDABF, 0x456A, 0xED04, 0x72D1,
+    0x6B25, 0xF4F0, 0x5C9E, 0xC34B, 0x0453, 0x9B86, 0x33E8, 0xAC3D,
+    0x6383, 0xFC56, 0x5438, 0xCBED, 0x0CF5, 0x9320, 0x3B4E, 0xA49B,
+    0xBD6F, 0x22BA, 0x8AD4, 0x1501, 0xD219, 0x4DCC, 0xE5A2, 0x7A77,
+    0xD64A, 0x499F, 0xE1F1, 0x7E24, 0xB93C, 0x26E9, 0x8E87, 0x1152,
+    0x08A6, 0x9773, 0x3F1D, 0xA0C8, 0x67D0, 0xF805, 0x506B, 0xCFBE,
+    0xC706, 0x58D3, 0xF0BD, 0x6F68, 0xA870, 0x37A5, 0x9FCB, 0x001E,
+    0x19EA, 0x863F, 0x2E51, 0xB184, 0x769C, 0xE949, 0x4127, 0xDEF2,
+    0x72CF, 0xED1A, 0x4574, 0xDAA1, 0x1DB9, 0x826C, 0x2A02, 0xB5D7,
+    0xAC23, 0x33F6, 0x9B98, 0x044D, 0xC355, 0x5C80, 0xF4EE, 0x6B3B,
+    0xA485, 0x3B50, 0x933E, 0x0CEB, 0xCBF3, 0x5426, 0xFC48, 0x639D,
+    0x7A69, 0xE5BC, 0x4DD2, 0xD207, 0x151F, 0x8ACA, 0x22A4, 0xBD71,
+    0x114C, 0x8E99, 0x26F7, 0xB922, 0x7E3A, 0xE1EF, 0x4981, 0xD654,
+    0xCFA0, 0x5075, 0xF81B, 0x67CE, 0xA0D6, 0x3F03, 0x976D, 0x08B8,
+    0x861D, 0x19C8, 0xB1A6, 0x2E73, 0xE96B, 0x76BE, 0xDED0, 0x4105,
+    0x58F1, 0xC724, 0x6F4A, 0xF09F, 0x3787, 0xA852, 0x003C, 0x9FE9,
+    0x33D4, 0xAC01, 0x046F, 0x9BBA, 0x5CA2, 0xC377, 0x6B19, 0xF4CC,
+    0xED38, 0x72ED, 0xDA83, 0x4556, 0x824E, 0x1D9B, 0xB5F5, 0x2A20,
+    0xE59E, 0x7A4B, 0xD225, 0x4DF0, 0x8AE8, 0x153D, 0xBD53, 0x2286,
+    0x3B72, 0xA4A7, 0x0CC9, 0x931C, 0x5404, 0xCBD1, 0x63BF, 0xFC6A,
+    0x5057, 0xCF82, 0x67EC, 0xF839, 0x3F21, 0xA0F4, 0x089A, 0x974F,
+    0x8EBB, 0x116E, 0xB900, 0x26D5, 0xE1CD, 0x7E18, 0xD676, 0x49A3,
+    0x411B, 0xDECE, 0x76A0, 0xE975, 0x2E6D, 0xB1B8, 0x19D6, 0x8603,
+    0x9FF7, 0x0022, 0xA84C, 0x3799, 0xF081, 0x6F54, 0xC73A, 0x58EF,
+    0xF4D2, 0x6B07, 0xC369, 0x5CBC, 0x9BA4, 0x0471, 0xAC1F, 0x33CA,
+    0x2A3E, 0xB5EB, 0x1D85, 0x8250, 0x4548, 0xDA9D, 0x72F3, 0xED26,
+    0x2298, 0xBD4D, 0x1523, 0x8AF6, 0x4DEE, 0xD23B, 0x7A55, 0xE580,
+    0xFC74, 0x63A1, 0xCBCF, 0x541A, 0x9302, 0x0CD7, 0xA4B9, 0x3B6C,
+    0x9751, 0x0884, 0xA0EA, 0x3F3F, 0xF827, 0x67F2, 0xCF9C, 0x5049,
+    0x49BD, 0xD668, 0x7E06, 0xE1D3, 0x26CB, 0xB91E, 0x1170, 0x8EA5
+  },
+  {
+    0x0000, 0x81BF, 0x0B6F, 0x8AD0, 0x16DE, 0x9761, 0x1DB1, 0x9C0E,
+    0x2DBC, 0xAC03, 0x26D3, 0xA76C, 0x3B62, 0xBADD, 0x300D, 0xB1B2,
+    0x5B78, 0xDAC7, 0x5017, 0xD1A8, 0x4DA6, 0xCC19, 0x46C9, 0xC776,
+    0x76C4, 0xF77B, 0x7DAB, 0xFC14, 0x601A, 0xE1A5, 0x6B75, 0xEACA,
+    0xB6F0, 0x374F, 0xBD9F, 0x3C20, 0xA02E, 0x2191, 0xAB41, 0x2AFE,
+    0x9B4C, 0x1AF3, 0x9023, 0x119C, 0x8D92, 0x0C2D, 0x86FD, 0x0742,
+    0xED88, 0x6C37, 0xE6E7, 0x6758, 0xFB56, 0x7AE9, 0xF039, 0x7186,
+    0xC034, 0x418B, 0xCB5B, 0x4AE4, 0xD6EA, 0x5755, 0xDD85, 0x5C3A,
+    0x65F1, 0xE44E, 0x6E9E, 0xEF21, 0x732F, 0xF290, 0x7840, 0xF9FF,
+    0x484D, 0xC9F2, 0x4322, 0xC29D, 0x5E93, 0xDF2C, 0x55FC, 0xD443,
+    0x3E89, 0xBF36, 0x35E6, 0xB459, 0x2857, 0xA9E8, 0x2338, 0xA287,
+    0x1335, 0x928A, 0x185A, 0x99E5, 0x05EB, 0x8454, 0x0E84, 0x8F3B,
+    0xD301, 0x52BE, 0xD86E, 0x59D1, 0xC5DF, 0x4460, 0xCEB0, 0x4F0F,
+    0xFEBD, 0x7F02, 0xF5D2, 0x746D, 0xE863, 0x69DC, 0xE30C, 0x62B3,
+    0x8879, 0x09C6, 0x8316, 0x02A9, 0x9EA7, 0x1F18, 0x95C8, 0x1477,
+    0xA5C5, 0x247A, 0xAEAA, 0x2F15, 0xB31B, 0x32A4, 0xB874, 0x39CB,
+    0xCBE2, 0x4A5D, 0xC08D, 0x4132, 0xDD3C, 0x5C83, 0xD653, 0x57EC,
+    0xE65E, 0x67E1, 0xED31, 0x6C8E, 0xF080, 0x713F, 0xFBEF, 0x7A50,
+    0x909A, 0x1125, 0x9BF5, 0x1A4A, 0x8644, 0x07FB, 0x8D2B, 0x0C94,
+    0xBD26, 0x3C99, 0xB649, 0x37F6, 0xABF8, 0x2A47, 0xA097, 0x2128,
+    0x7D12, 0xFCAD, 0x767D, 0xF7C2, 0x6BCC, 0xEA73, 0x60A3, 0xE11C,
+    0x50AE, 0xD111, 0x5BC1, 0xDA7E, 0x4670, 0xC7CF, 0x4D1F, 0xCCA0,
+    0x266A, 0xA7D5, 0x2D05, 0xACBA, 0x30B4, 0xB10B, 0x3BDB, 0xBA64,
+    0x0BD6, 0x8A69, 0x00B9, 0x8106, 0x1D08, 0x9CB7, 0x1667, 0x97D8,
+    0xAE13, 0x2FAC, 0xA57C, 0x24C3, 0xB8CD, 0x3972, 0xB3A2, 0x321D,
+    0x83AF, 0x0210, 0x88C0, 0x097F, 0x9571, 0x14CE, 0x9E1E, 0x1FA1,
+    0xF56B, 0x74D4, 0xFE04, 0x7FBB, 0xE3B5, 0x620A, 0xE8DA, 0x6965,
+    0xD8D7, 0x5968, 0xD3B8, 0x5207, 0xCE09, 0x4FB6, 0xC566, 0x44D9,
+    0x18E3, 0x995C, 0x138C, 0x9233, 0x0E3D, 0x8F82, 0x0552, 0x84ED,
+    0x355F, 0xB4E0, 0x3E30, 0xBF8F, 0x2381, 0xA23E, 0x28EE, 0xA951,
+    0x439B, 0xC224, 0x48F4, 0xC94B, 0x5545, 0xD4FA, 0x5E2A, 0xDF95,
+    0x6E27, 0xEF98, 0x6548, 0xE4F7, 0x78F9, 0xF946, 0x7396, 0xF229
+  }
+};
+
+// CRC-32K tables for slice-by-8, in the same form as Data_CRC_Table.
+// CRC32K_Table[0] is the 256-entry table of the reflected Koopman
+// polynomial 0xEB31D82E.
+static const uint32_t CRC32K_Table[8][256] =
+{
+  {
+    0x00000000, 0x9695C4CA, 0xFB4839C9, 0x6DDDFD03, 0x20F3C3CF, 0xB6660705,
+    0xDBBBFA06, 0x4D2E3ECC, 0x41E7879E, 0xD7724354, 0xBAAFBE57, 0x2C3A7A9D,
+    0x61144451, 0xF781809B, 0x9A5C7D98, 0x0CC9B952, 0x83CF0F3C, 0x155ACBF6,
+    0x788736F5, 0xEE12F23F, 0xA33CCCF3, 0x35A90839, 0x5874F53A, 0xCEE131F0,
+    0xC22888A2, 0x54BD4C68, 0x3960B16B, 0xAFF575A1, 0xE2DB4B6D, 0x744E8FA7,
+    0x199372A4, 0x8F06B66E, 0xD1FDAE25, 0x47686AEF, 0x2AB597EC, 0xBC205326,
+    0xF10E6DEA, 0x679BA920, 0x0A465423, 0x9CD390E9, 0x901A29BB, 0x068FED71,
+    0x6B521072, 0xFDC7D4B8, 0xB0E9EA74, 0x267C2EBE, 0x4BA1D3BD, 0xDD341777,
+    0x5232A119, 0xC4A765D3, 0xA97A98D0, 0x3FEF5C1A, 0x72C162D6, 0xE454A61C,
+    0x89895B1F, 0x1F1C9FD5, 0x13D52687, 0x8540E24D, 0xE89D1F4E, 0x7E08DB84,
+    0x3326E548, 0xA5B32182, 0xC86EDC81, 0x5EFB184B, 0x7598EC17, 0xE30D28DD,
+    0x8ED0D5DE, 0x18451114, 0x556B2FD8, 0xC3FEEB12, 0xAE231611, 0x38B6D2DB,
+    0x347F6B89, 0xA2EAAF43, 0xCF375240, 0x59A2968A, 0x148CA846, 0x82196C8C,
+    0xEFC4918F, 0x79515545, 0xF657E32B, 0x60C227E1, 0x0D1FDAE2, 0x9B8A1E28,
+    0xD6A420E4, 0x4031E42E, 0x2DEC192D, 0xBB79DDE7, 0xB7B064B5, 0x2125A07F,
+    0x4CF85D7C, 0xDA6D99B6, 0x9743A77A, 0x01D663B0, 0x6C0B9EB3, 0xFA9E5A79,
+    0xA4654232, 0x32F086F8, 0x5F2D7BFB, 0xC9B8BF31, 0x849681FD, 0x12034537,
+    0x7FDEB834, 0xE94B7CFE, 0xE582C5AC, 0x73170166, 0x1ECAFC65, 0x885F38AF,
+    0xC5710663, 0x53E4C2A9, 0x3E393FAA, 0xA8ACFB60, 0x27AA4D0E, 0xB13F89C4,
+    0xDCE274C7, 0x4A77B00D, 0x07598EC1, 0x91CC4A0B, 0xFC11B708, 0x6A8473C2,
+    0x664DCA90, 0xF0D80E5A, 0x9D05F359, 0x0B903793, 0x46BE095F, 0xD02BCD95,
+    0xBDF63096, 0x2B63F45C, 0xEB31D82E, 0x7DA41CE4, 0x1079E1E7, 0x86EC252D,
+    0xCBC21BE1, 0x5D57DF2B, 0x308A2228, 0xA61FE6E2, 0xAAD65FB0, 0x3C439B7A,
+    0x519E6679, 0xC70BA2B3, 0x8A259C7F, 0x1CB058B5, 0x716DA5B6, 0xE7F8617C,
+    0x68FED712, 0xFE6B13D8, 0x93B6EEDB, 0x05232A11, 0x480D14DD, 0xDE98D017,
+    0xB3452D14, 0x25D0E9DE, 0x2919508C, 0xBF8C9446, 0xD2516945, 0x44C4AD8F,
+    0x09EA9343, 0x9F7F5789, 0xF2A2AA8A, 0x64376E40, 0x3ACC760B, 0xAC59B2C1,
+    0xC1844FC2, 0x57118B08, 0x1A3FB5C4, 0x8CAA710E, 0xE1778C0D, 0x77E248C7,
+    0x7B2BF195, 0xEDBE355F, 0x8063C85C, 0x16F60C96, 0x5BD8325A, 0xCD4DF690,
+    0xA0900B93, 0x3605CF59, 0xB9037937, 0x2F96BDFD, 0x424B40FE, 0xD4DE8434,
+    0x99F0BAF8, 0x0F657E32, 0x62B88331, 0xF42D47FB, 0xF8E4FEA9, 0x6E713A63,
+    0x03ACC760, 0x953903AA, 0xD8173D66, 0x4E82F9AC, 0x235F04AF, 0xB5CAC065,
+    0x9EA93439, 0x083CF0F3, 0x65E10DF0, 0xF374C93A, 0xBE5AF7F6, 0x28CF333C,
+    0x4512CE3F, 0xD3870AF5, 0xDF4EB3A7, 0x49DB776D, 0x24068A6E, 0xB2934EA4,
+    0xFFBD7068, 0x6928B4A2, 0x04F549A1, 0x92608D6B, 0x1D663B05, 0x8BF3FFCF,
+    0xE62E02CC, 0x70BBC606, 0x3D95F8CA, 0xAB003C00, 0xC6DDC103, 0x504805C9,
+    0x5C81BC9B, 0xCA147851, 0xA7C98552, 0x315C4198, 0x7C727F54, 0xEAE7BB9E,
+    0x873A469D, 0x11AF8257, 0x4F549A1C, 0xD9C15ED6, 0xB41CA3D5, 0x2289671F,
+    0x6FA759D3, 0xF9329D19, 0x94EF601A, 0x027AA4D0, 0x0EB31D82, 0x9826D948,
+    0xF5FB244B, 0x636EE081, 0x2E40DE4D, 0xB8D51A87, 0xD508E784, 0x439D234E,
+    0xCC9B9520, 0x5A0E51EA, 0x37D3ACE9, 0xA1466823, 0xEC6856EF, 0x7AFD9225,
+    0x17206F26, 0x81B5ABEC, 0x8D7C12BE, 0x1BE9D674, 0x76342B77, 0xE0A1EFBD,
+    0xAD8FD171, 0x3B1A15BB, 0x56C7E8B8, 0xC0522C72
+  },
+  {
+    0x00000000, 0x24901FAA, 0x49203F54, 0x6DB020FE, 0x92407EA8, 0xB6D06102,
+    0xDB6041FC, 0xFFF05E56, 0xF2E34D0D, 0xD67352A7, 0xBBC37259, 0x9F536DF3,
+    0x60A333A5, 0x44332C0F, 0x29830CF1, 0x0D13135B, 0x33A52A47, 0x173535ED,
+    0x7A851513, 0x5E150AB9, 0xA1E554EF, 0x85754B45, 0xE8C56BBB, 0xCC557411,
+    0xC146674A, 0xE5D678E0, 0x8866581E, 0xACF647B4, 0x530619E2, 0x77960648,
+    0x1A2626B6, 0x3EB6391C, 0x674A548E, 0x43DA4B24, 0x2E6A6BDA, 0x0AFA7470,
+    0xF50A2A26, 0xD19A358C, 0xBC2A1572, 0x98BA0AD8, 0x95A91983, 0xB1390629,
+    0xDC8926D7, 0xF819397D, 0x07E9672B, 0x23797881, 0x4EC9587F, 0x6A5947D5,
+    0x54EF7EC9, 0x707F6163, 0x1DCF419D, 0x395F5E37, 0xC6AF0061, 0xE23F1FCB,
+    0x8F8F3F35, 0xAB1F209F, 0xA60C33C4, 0x829C2C6E, 0xEF2C0C90, 0xCBBC133A,
+    0x344C4D6C, 0x10DC52C6, 0x7D6C7238, 0x59FC6D92, 0xCE94A91C, 0xEA04B6B6,
+    0x87B49648, 0xA32489E2, 0x5CD4D7B4, 0x7844C81E, 0x15F4E8E0, 0x3164F74A,
+    0x3C77E411, 0x18E7FBBB, 0x7557DB45, 0x51C7C4EF, 0xAE379AB9, 0x8AA78513,
+    0xE717A5ED, 0xC387BA47, 0xFD31835B, 0xD9A19CF1, 0xB411BC0F, 0x9081A3A5,
+    0x6F71FDF3, 0x4BE1E259, 0x2651C2A7, 0x02C1DD0D, 0x0FD2CE56, 0x2B42D1FC,
+    0x46F2F102, 0x6262EEA8, 0x9D92B0FE, 0xB902AF54, 0xD4B28FAA, 0xF0229000,
+    0xA9DEFD92, 0x8D4EE238, 0xE0FEC2C6, 0xC46EDD6C, 0x3B9E833A, 0x1F0E9C90,
+    0x72BEBC6E, 0x562EA3C4, 0x5B3DB09F, 0x7FADAF35, 0x121D8FCB, 0x368D9061,
+    0xC97DCE37, 0xEDEDD19D, 0x805DF163, 0xA4CDEEC9, 0x9A7BD7D5, 0xBEEBC87F,
+    0xD35BE881, 0xF7CBF72B, 0x083BA97D, 0x2CABB6D7, 0x411B9629, 0x658B8983,
+    0x68989AD8, 0x4C088572, 0x21B8A58C, 0x0528BA26, 0xFAD8E470, 0xDE48FBDA,
+    0xB3F8DB24, 0x9768C48E, 0x4B4AE265, 0x6FDAFDCF, 0x026ADD31, 0x26FAC29B,
+    0xD90A9CCD, 0xFD9A8367, 0x902AA399, 0xB4BABC33, 0xB9A9AF68, 0x9D39B0C2,
+    0xF089903C, 0xD4198F96, 0x2BE9D1C0, 0x0F79CE6A, 0x62C9EE94, 0x4659F13E,
+    0x78EFC822, 0x5C7FD788, 0x31CFF776, 0x155FE8DC, 0xEAAFB68A, 0xCE3FA920,
+    0xA38F89DE, 0x871F9674, 0x8A0C852F, 0xAE9C9A85, 0xC32CBA7B, 0xE7BCA5D1,
+    0x184CFB87, 0x3CDCE42D, 0x516CC4D3, 0x75FCDB79, 0x2C00B6EB, 0x0890A941,
+    0x652089BF, 0x41B09615, 0xBE40C843, 0x9AD0D7E9, 0xF760F717, 0xD3F0E8BD,
+    0xDEE3FBE6, 0xFA73E44C, 0x97C3C4B2, 0xB353DB18, 0x4CA3854E, 0x68339AE4,
+    0x0583BA1A, 0x2113A5B0, 0x1FA59CAC, 0x3B358306, 0x5685A3F8, 0x7215BC52,
+    0x8DE5E204, 0xA975FDAE, 0xC4C5DD50, 0xE055C2FA, 0xED46D1A1, 0xC9D6CE0B,
+    0xA466EEF5, 0x80F6F15F, 0x7F06AF09, 0x5B96B0A3, 0x3626905D, 0x12B68FF7,
+    0x85DE4B79, 0xA14E54D3, 0xCCFE742D, 0xE86E6B87, 0x179E35D1, 0x330E2A7B,
+    0x5EBE0A85, 0x7A2E152F, 0x773D0674, 0x53AD19DE, 0x3E1D3920, 0x1A8D268A,
+    0xE57D78DC, 0xC1ED6776, 0xAC5D4788, 0x88CD5822, 0xB67B613E, 0x92EB7E94,
+    0xFF5B5E6A, 0xDBCB41C0, 0x243B1F96, 0x00AB003C, 0x6D1B20C2, 0x498B3F68,
+    0x44982C33, 0x60083399, 0x0DB81367, 0x29280CCD, 0xD6D8529B, 0xF2484D31,
+    0x9FF86DCF, 0xBB687265, 0xE2941FF7, 0xC604005D, 0xABB420A3, 0x8F243F09,
+    0x70D4615F, 0x54447EF5, 0x39F45E0B, 0x1D6441A1, 0x107752FA, 0x34E74D50,
+    0x59576DAE, 0x7DC77204, 0x82372C52, 0xA6A733F8, 0xCB171306, 0xEF870CAC,
+    0xD13135B0, 0xF5A12A1A, 0x98110AE4, 0xBC81154E, 0x43714B18, 0x67E154B2,
+    0x0A51744C, 0x2EC16BE6, 0x23D278BD, 0x07426717, 0x6AF247E9, 0x4E625843,
+    0xB1920615, 0x950219BF, 0xF8B23941, 0xDC2226EB
+  },
+  {
+    0x00000000, 0x80475843, 0xD6ED00DB, 0x56AA5898, 0x7BB9B1EB, 0xFBFEE9A8,
+    0xAD54B130, 0x2D13E973, 0xF77363D6, 0x77343B95, 0x219E630D, 0xA1D93B4E,
+    0x8CCAD23D, 0x0C8D8A7E, 0x5A27D2E6, 0xDA608AA5, 0x388577F1, 0xB8C22FB2,
+    0xEE68772A, 0x6E2F2F69, 0x433CC61A, 0xC37B9E59, 0x95D1C6C1, 0x15969E82,
+    0xCFF61427, 0x4FB14C64, 0x191B14FC, 0x995C4CBF, 0xB44FA5CC, 0x3408FD8F,
+    0x62A2A517, 0xE2E5FD54, 0x710AEFE2, 0xF14DB7A1, 0xA7E7EF39, 0x27A0B77A,
+    0x0AB35E09, 0x8AF4064A, 0xDC5E5ED2, 0x5C190691, 0x86798C34, 0x063ED477,
+    0x50948CEF, 0xD0D3D4AC, 0xFDC03DDF, 0x7D87659C, 0x2B2D3D04, 0xAB6A6547,
+    0x498F9813, 0xC9C8C050, 0x9F6298C8, 0x1F25C08B, 0x323629F8, 0xB27171BB,
+    0xE4DB2923, 0x649C7160, 0xBEFCFBC5, 0x3EBBA386, 0x6811FB1E, 0xE856A35D,
+    0xC5454A2E, 0x4502126D, 0x13A84AF5, 0x93EF12B6, 0xE215DFC4, 0x62528787,
+    0x34F8DF1F, 0xB4BF875C, 0x99AC6E2F, 0x19EB366C, 0x4F416EF4, 0xCF0636B7,
+    0x1566BC12, 0x9521E451, 0xC38BBCC9, 0x43CCE48A, 0x6EDF0DF9, 0xEE9855BA,
+    0xB8320D22, 0x38755561, 0xDA90A835, 0x5AD7F076, 0x0C7DA8EE, 0x8C3AF0AD,
+    0xA12919DE, 0x216E419D, 0x77C41905, 0xF7834146, 0x2DE3CBE3, 0xADA493A0,
+    0xFB0ECB38, 0x7B49937B, 0x565A7A08, 0xD61D224B, 0x80B77AD3, 0x00F02290,
+    0x931F3026, 0x13586865, 0x45F230FD, 0xC5B568BE, 0xE8A681CD, 0x68E1D98E,
+    0x3E4B8116, 0xBE0CD955, 0x646C53F0, 0xE42B0BB3, 0xB281532B, 0x32C60B68,
+    0x1FD5E21B, 0x9F92BA58, 0xC938E2C0, 0x497FBA83, 0xAB9A47D7, 0x2BDD1F94,
+    0x7D77470C, 0xFD301F4F, 0xD023F63C, 0x5064AE7F, 0x06CEF6E7, 0x8689AEA4,
+    0x5CE92401, 0xDCAE7C42, 0x8A0424DA, 0x0A437C99, 0x275095EA, 0xA717CDA9,
+    0xF1BD9531, 0x71FACD72, 0x12480FD5, 0x920F5796, 0xC4A50F0E, 0x44E2574D,
+    0x69F1BE3E, 0xE9B6E67D, 0xBF1CBEE5, 0x3F5BE6A6, 0xE53B6C03, 0x657C3440,
+    0x33D66CD8, 0xB391349B, 0x9E82DDE8, 0x1EC585AB, 0x486FDD33, 0xC8288570,
+    0x2ACD7824, 0xAA8A2067, 0xFC2078FF, 0x7C6720BC, 0x5174C9CF, 0xD133918C,
+    0x8799C914, 0x07DE9157, 0xDDBE1BF2, 0x5DF943B1, 0x0B531B29, 0x8B14436A,
+    0xA607AA19, 0x2640F25A, 0x70EAAAC2, 0xF0ADF281, 0x6342E037, 0xE305B874,
+    0xB5AFE0EC, 0x35E8B8AF, 0x18FB51DC, 0x98BC099F, 0xCE165107, 0x4E510944,
+    0x943183E1, 0x1476DBA2, 0x42DC833A, 0xC29BDB79, 0xEF88320A, 0x6FCF6A49,
+    0x396532D1, 0xB9226A92, 0x5BC797C6, 0xDB80CF85, 0x8D2A971D, 0x0D6DCF5E,
+    0x207E262D, 0xA0397E6E, 0xF69326F6, 0x76D47EB5, 0xACB4F410, 0x2CF3AC53,
+    0x7A59F4CB, 0xFA1EAC88, 0xD70D45FB, 0x574A1DB8, 0x01E04520, 0x81A71D63,
+    0xF05DD011, 0x701A8852, 0x26B0D0CA, 0xA6F78889, 0x8BE461FA, 0x0BA339B9,
+    0x5D096121, 0xDD4E3962, 0x072EB3C7, 0x8769EB84, 0xD1C3B31C, 0x5184EB5F,
+    0x7C97022C, 0xFCD05A6F, 0xAA7A02F7, 0x2A3D5AB4, 0xC8D8A7E0, 0x489FFFA3,
+    0x1E35A73B, 0x9E72FF78, 0xB361160B, 0x33264E48, 0x658C16D0, 0xE5CB4E93,
+    0x3FABC436, 0xBFEC9C75, 0xE946C4ED, 0x69019CAE, 0x441275DD, 0xC4552D9E,
+    0x92FF7506, 0x12B82D45, 0x81573FF3, 0x011067B0, 0x57BA3F28, 0xD7FD676B,
+    0xFAEE8E18, 0x7AA9D65B, 0x2C038EC3, 0xAC44D680, 0x76245C25, 0xF6630466,
+    0xA0C95CFE, 0x208E04BD, 0x0D9DEDCE, 0x8DDAB58D, 0xDB70ED15, 0x5B37B556,
+    0xB9D24802, 0x39951041, 0x6F3F48D9, 0xEF78109A, 0xC26BF9E9, 0x422CA1AA,
+    0x1486F932, 0x94C1A171, 0x4EA12BD4, 0xCEE67397, 0x984C2B0F, 0x180B734C,
+    0x35189A3F, 0xB55FC27C, 0xE3F59AE4, 0x63B2C2A7
+  },
+  {
+    0x00000000, 0x18C5564C, 0x318AAC98, 0x294FFAD4, 0x63155930, 0x7BD00F7C,
+    0x529FF5A8, 0x4A5AA3E4, 0xC62AB260, 0xDEEFE42C, 0xF7A01EF8, 0xEF6548B4,
+    0xA53FEB50, 0xBDFABD1C, 0x94B547C8, 0x8C701184, 0x5A36D49D, 0x42F382D1,
+    0x6BBC7805, 0x73792E49, 0x39238DAD, 0x21E6DBE1, 0x08A92135, 0x106C7779,
+    0x9C1C66FD, 0x84D930B1, 0xAD96CA65, 0xB5539C29, 0xFF093FCD, 0xE7CC6981,
+    0xCE839355, 0xD646C519, 0xB46DA93A, 0xACA8FF76, 0x85E705A2, 0x9D2253EE,
+    0xD778F00A, 0xCFBDA646, 0xE6F25C92, 0xFE370ADE, 0x72471B5A, 0x6A824D16,
+    0x43CDB7C2, 0x5B08E18E, 0x1152426A, 0x09971426, 0x20D8EEF2, 0x381DB8BE,
+    0xEE5B7DA7, 0xF69E2BEB, 0xDFD1D13F, 0xC7148773, 0x8D4E2497, 0x958B72DB,
+    0xBCC4880F, 0xA401DE43, 0x2871CFC7, 0x30B4998B, 0x19FB635F, 0x013E3513,
+    0x4B6496F7, 0x53A1C0BB, 0x7AEE3A6F, 0x622B6C23, 0xBEB8E229, 0xA67DB465,
+    0x8F324EB1, 0x97F718FD, 0xDDADBB19, 0xC568ED55, 0xEC271781, 0xF4E241CD,
+    0x78925049, 0x60570605, 0x4918FCD1, 0x51DDAA9D, 0x1B870979, 0x03425F35,
+    0x2A0DA5E1, 0x32C8F3AD, 0xE48E36B4, 0xFC4B60F8, 0xD5049A2C, 0xCDC1CC60,
+    0x879B6F84, 0x9F5E39C8, 0xB611C31C, 0xAED49550, 0x22A484D4, 0x3A61D298,
+    0x132E284C, 0x0BEB7E00, 0x41B1DDE4, 0x59748BA8, 0x703B717C, 0x68FE2730,
+    0x0AD54B13, 0x12101D5F, 0x3B5FE78B, 0x239AB1C7, 0x69C01223, 0x7105446F,
+    0x584ABEBB, 0x408FE8F7, 0xCCFFF973, 0xD43AAF3F, 0xFD7555EB, 0xE5B003A7,
+    0xAFEAA043, 0xB72FF60F, 0x9E600CDB, 0x86A55A97, 0x50E39F8E, 0x4826C9C2,
+    0x61693316, 0x79AC655A, 0x33F6C6BE, 0x2B3390F2, 0x027C6A26, 0x1AB93C6A,
+    0x96C92DEE, 0x8E0C7BA2, 0xA7438176, 0xBF86D73A, 0xF5DC74DE, 0xED192292,
+    0xC456D846, 0xDC938E0A, 0xAB12740F, 0xB3D72243, 0x9A98D897, 0x825D8EDB,
+    0xC8072D3F, 0xD0C27B73, 0xF98D81A7, 0xE148D7EB, 0x6D38C66F, 0x75FD9023,
+    0x5CB26AF7, 0x44773CBB, 0x0E2D9F5F, 0x16E8C913, 0x3FA733C7, 0x2762658B,
+    0xF124A092, 0xE9E1F6DE, 0xC0AE0C0A, 0xD86B5A46, 0x9231F9A2, 0x8AF4AFEE,
+    0xA3BB553A, 0xBB7E0376, 0x370E12F2, 0x2FCB44BE, 0x0684BE6A, 0x1E41E826,
+    0x541B4BC2, 0x4CDE1D8E, 0x6591E75A, 0x7D54B116, 0x1F7FDD35, 0x07BA8B79,
+    0x2EF571AD, 0x363027E1, 0x7C6A8405, 0x64AFD249, 0x4DE0289D, 0x55257ED1,
+    0xD9556F55, 0xC1903919, 0xE8DFC3CD, 0xF01A9581, 0xBA403665, 0xA2856029,
+    0x8BCA9AFD, 0x930FCCB1, 0x454909A8, 0x5D8C5FE4, 0x74C3A530, 0x6C06F37C,
+    0x265C5098, 0x3E9906D4, 0x17D6FC00, 0x0F13AA4C, 0x8363BBC8, 0x9BA6ED84,
+    0xB2E91750, 0xAA2C411C, 0xE076E2F8, 0xF8B3B4B4, 0xD1FC4E60, 0xC939182C,
+    0x15AA9626, 0x0D6FC06A, 0x24203ABE, 0x3CE56CF2, 0x76BFCF16, 0x6E7A995A,
+    0x4735638E, 0x5FF035C2, 0xD3802446, 0xCB45720A, 0xE20A88DE, 0xFACFDE92,
+    0xB0957D76, 0xA8502B3A, 0x811FD1EE, 0x99DA87A2, 0x4F9C42BB, 0x575914F7,
+    0x7E16EE23, 0x66D3B86F, 0x2C891B8B, 0x344C4DC7, 0x1D03B713, 0x05C6E15F,
+    0x89B6F0DB, 0x9173A697, 0xB83C5C43, 0xA0F90A0F, 0xEAA3A9EB, 0xF266FFA7,
+    0xDB290573, 0xC3EC533F, 0xA1C73F1C, 0xB9026950, 0x904D9384, 0x8888C5C8,
+    0xC2D2662C, 0xDA173060, 0xF358CAB4, 0xEB9D9CF8, 0x67ED8D7C, 0x7F28DB30,
+    0x566721E4, 0x4EA277A8, 0x04F8D44C, 0x1C3D8200, 0x357278D4, 0x2DB72E98,
+    0xFBF1EB81, 0xE334BDCD, 0xCA7B4719, 0xD2BE1155, 0x98E4B2B1, 0x8021E4FD,
+    0xA96E1E29, 0xB1AB4865, 0x3DDB59E1, 0x251E0FAD, 0x0C51F579, 0x1494A335,
+    0x5ECE00D1, 0x460B569D, 0x6F44AC49, 0x7781FA05
+  },
+  {
+    0x00000000, 0x14946D10, 0x2928DA20, 0x3DBCB730, 0x5251B440, 0x46C5D950,
+    0x7B796E60, 0x6FED0370, 0xA4A36880, 0xB0370590, 0x8D8BB2A0, 0x991FDFB0,
+    0xF6F2DCC0, 0xE266B1D0, 0xDFDA06E0, 0xCB4E6BF0, 0x9F25615D, 0x8BB10C4D,
+    0xB60DBB7D, 0xA299D66D, 0xCD74D51D, 0xD9E0B80D, 0xE45C0F3D, 0xF0C8622D,
+    0x3B8609DD, 0x2F1264CD, 0x12AED3FD, 0x063ABEED, 0x69D7BD9D, 0x7D43D08D,
+    0x40FF67BD, 0x546B0AAD, 0xE82972E7, 0xFCBD1FF7, 0xC101A8C7, 0xD595C5D7,
+    0xBA78C6A7, 0xAEECABB7, 0x93501C87, 0x87C47197, 0x4C8A1A67, 0x581E7777,
+    0x65A2C047, 0x7136AD57, 0x1EDBAE27, 0x0A4FC337, 0x37F37407, 0x23671917,
+    0x770C13BA, 0x63987EAA, 0x5E24C99A, 0x4AB0A48A, 0x255DA7FA, 0x31C9CAEA,
+    0x0C757DDA, 0x18E110CA, 0xD3AF7B3A, 0xC73B162A, 0xFA87A11A, 0xEE13CC0A,
+    0x81FECF7A, 0x956AA26A, 0xA8D6155A, 0xBC42784A, 0x06315593, 0x12A53883,
+    0x2F198FB3, 0x3B8DE2A3, 0x5460E1D3, 0x40F48CC3, 0x7D483BF3, 0x69DC56E3,
+    0xA2923D13, 0xB6065003, 0x8BBAE733, 0x9F2E8A23, 0xF0C38953, 0xE457E443,
+    0xD9EB5373, 0xCD7F3E63, 0x991434CE, 0x8D8059DE, 0xB03CEEEE, 0xA4A883FE,
+    0xCB45808E, 0xDFD1ED9E, 0xE26D5AAE, 0xF6F937BE, 0x3DB75C4E, 0x2923315E,
+    0x149F866E, 0x000BEB7E, 0x6FE6E80E, 0x7B72851E, 0x46CE322E, 0x525A5F3E,
+    0xEE182774, 0xFA8C4A64, 0xC730FD54, 0xD3A49044, 0xBC499334, 0xA8DDFE24,
+    0x95614914, 0x81F52404, 0x4ABB4FF4, 0x5E2F22E4, 0x639395D4, 0x7707F8C4,
+    0x18EAFBB4, 0x0C7E96A4, 0x31C22194, 0x25564C84, 0x713D4629, 0x65A92B39,
+    0x58159C09, 0x4C81F119, 0x236CF269, 0x37F89F79, 0x0A442849, 0x1ED04559,
+    0xD59E2EA9, 0xC10A43B9, 0xFCB6F489, 0xE8229999, 0x87CF9AE9, 0x935BF7F9,
+    0xAEE740C9, 0xBA732DD9, 0x0C62AB26, 0x18F6C636, 0x254A7106, 0x31DE1C16,
+    0x5E331F66, 0x4AA77276, 0x771BC546, 0x638FA856, 0xA8C1C3A6, 0xBC55AEB6,
+    0x81E91986, 0x957D7496, 0xFA9077E6, 0xEE041AF6, 0xD3B8ADC6, 0xC72CC0D6,
+    0x9347CA7B, 0x87D3A76B, 0xBA6F105B, 0xAEFB7D4B, 0xC1167E3B, 0xD582132B,
+    0xE83EA41B, 0xFCAAC90B, 0x37E4A2FB, 0x2370CFEB, 0x1ECC78DB, 0x0A5815CB,
+    0x65B516BB, 0x71217BAB, 0x4C9DCC9B, 0x5809A18B, 0xE44BD9C1, 0xF0DFB4D1,
+    0xCD6303E1, 0xD9F76EF1, 0xB61A6D81, 0xA28E0091, 0x9F32B7A1, 0x8BA6DAB1,
+    0x40E8B141, 0x547CDC51, 0x69C06B61, 0x7D540671, 0x12B90501, 0x062D6811,
+    0x3B91DF21, 0x2F05B231, 0x7B6EB89C, 0x6FFAD58C, 0x524662BC, 0x46D20FAC,
+    0x293F0CDC, 0x3DAB61CC, 0x0017D6FC, 0x1483BBEC, 0xDFCDD01C, 0xCB59BD0C,
+    0xF6E50A3C, 0xE271672C, 0x8D9C645C, 0x9908094C, 0xA4B4BE7C, 0xB020D36C,
+    0x0A53FEB5, 0x1EC793A5, 0x237B2495, 0x37EF4985, 0x58024AF5, 0x4C9627E5,
+    0x712A90D5, 0x65BEFDC5, 0xAEF09635, 0xBA64FB25, 0x87D84C15, 0x934C2105,
+    0xFCA12275, 0xE8354F65, 0xD589F855, 0xC11D9545, 0x95769FE8, 0x81E2F2F8,
+    0xBC5E45C8, 0xA8CA28D8, 0xC7272BA8, 0xD3B346B8, 0xEE0FF188, 0xFA9B9C98,
+    0x31D5F768, 0x25419A78, 0x18FD2D48, 0x0C694058, 0x63844328, 0x77102E38,
+    0x4AAC9908, 0x5E38F418, 0xE27A8C52, 0xF6EEE142, 0xCB525672, 0xDFC63B62,
+    0xB02B3812, 0xA4BF5502, 0x9903E232, 0x8D978F22, 0x46D9E4D2, 0x524D89C2,
+    0x6FF13EF2, 0x7B6553E2, 0x14885092, 0x001C3D82, 0x3DA08AB2, 0x2934E7A2,
+    0x7D5FED0F, 0x69CB801F, 0x5477372F, 0x40E35A3F, 0x2F0E594F, 0x3B9A345F,
+    0x0626836F, 0x12B2EE7F, 0xD9FC858F, 0xCD68E89F, 0xF0D45FAF, 0xE44032BF,
+    0x8BAD31CF, 0x9F395CDF, 0xA285EBEF, 0xB61186FF
+  },
+  {
+    0x00000000, 0x83DB9B51, 0xD1D486FF, 0x520F1DAE, 0x75CABDA3, 0xF61126F2,
+    0xA41E3B5C, 0x27C5A00D, 0xEB957B46, 0x684EE017, 0x3A41FDB9, 0xB99A66E8,
+    0x9E5FC6E5, 0x1D845DB4, 0x4F8B401A, 0xCC50DB4B, 0x014946D1, 0x8292DD80,
+    0xD09DC02E, 0x53465B7F, 0x7483FB72, 0xF7586023, 0xA5577D8D, 0x268CE6DC,
+    0xEADC3D97, 0x6907A6C6, 0x3B08BB68, 0xB8D32039, 0x9F168034, 0x1CCD1B65,
+    0x4EC206CB, 0xCD199D9A, 0x02928DA2, 0x814916F3, 0xD3460B5D, 0x509D900C,
+    0x77583001, 0xF483AB50, 0xA68CB6FE, 0x25572DAF, 0xE907F6E4, 0x6ADC6DB5,
+    0x38D3701B, 0xBB08EB4A, 0x9CCD4B47, 0x1F16D016, 0x4D19CDB8, 0xCEC256E9,
+    0x03DBCB73, 0x80005022, 0xD20F4D8C, 0x51D4D6DD, 0x761176D0, 0xF5CAED81,
+    0xA7C5F02F, 0x241E6B7E, 0xE84EB035, 0x6B952B64, 0x399A36CA, 0xBA41AD9B,
+    0x9D840D96, 0x1E5F96C7, 0x4C508B69, 0xCF8B1038, 0x05251B44, 0x86FE8015,
+    0xD4F19DBB, 0x572A06EA, 0x70EFA6E7, 0xF3343DB6, 0xA13B2018, 0x22E0BB49,
+    0xEEB06002, 0x6D6BFB53, 0x3F64E6FD, 0xBCBF7DAC, 0x9B7ADDA1, 0x18A146F0,
+    0x4AAE5B5E, 0xC975C00F, 0x046C5D95, 0x87B7C6C4, 0xD5B8DB6A, 0x5663403B,
+    0x71A6E036, 0xF27D7B67, 0xA07266C9, 0x23A9FD98, 0xEFF926D3, 0x6C22BD82,
+    0x3E2DA02C, 0xBDF63B7D, 0x9A339B70, 0x19E80021, 0x4BE71D8F, 0xC83C86DE,
+    0x07B796E6, 0x846C0DB7, 0xD6631019, 0x55B88B48, 0x727D2B45, 0xF1A6B014,
+    0xA3A9ADBA, 0x207236EB, 0xEC22EDA0, 0x6FF976F1, 0x3DF66B5F, 0xBE2DF00E,
+    0x99E85003, 0x1A33CB52, 0x483CD6FC, 0xCBE74DAD, 0x06FED037, 0x85254B66,
+    0xD72A56C8, 0x54F1CD99, 0x73346D94, 0xF0EFF6C5, 0xA2E0EB6B, 0x213B703A,
+    0xED6BAB71, 0x6EB03020, 0x3CBF2D8E, 0xBF64B6DF, 0x98A116D2, 0x1B7A8D83,
+    0x4975902D, 0xCAAE0B7C, 0x0A4A3688, 0x8991ADD9, 0xDB9EB077, 0x58452B26,
+    0x7F808B2B, 0xFC5B107A, 0xAE540DD4, 0x2D8F9685, 0xE1DF4DCE, 0x6204D69F,
+    0x300BCB31, 0xB3D05060, 0x9415F06D, 0x17CE6B3C, 0x45C17692, 0xC61AEDC3,
+    0x0B037059, 0x88D8EB08, 0xDAD7F6A6, 0x590C6DF7, 0x7EC9CDFA, 0xFD1256AB,
+    0xAF1D4B05, 0x2CC6D054, 0xE0960B1F, 0x634D904E, 0x31428DE0, 0xB29916B1,
+    0x955CB6BC, 0x16872DED, 0x44883043, 0xC753AB12, 0x08D8BB2A, 0x8B03207B,
+    0xD90C3DD5, 0x5AD7A684, 0x7D120689, 0xFEC99DD8, 0xACC68076, 0x2F1D1B27,
+    0xE34DC06C, 0x60965B3D, 0x32994693, 0xB142DDC2, 0x96877DCF, 0x155CE69E,
+    0x4753FB30, 0xC4886061, 0x0991FDFB, 0x8A4A66AA, 0xD8457B04, 0x5B9EE055,
+    0x7C5B4058, 0xFF80DB09, 0xAD8FC6A7, 0x2E545DF6, 0xE20486BD, 0x61DF1DEC,
+    0x33D00042, 0xB00B9B13, 0x97CE3B1E, 0x1415A04F, 0x461ABDE1, 0xC5C126B0,
+    0x0F6F2DCC, 0x8CB4B69D, 0xDEBBAB33, 0x5D603062, 0x7AA5906F, 0xF97E0B3E,
+    0xAB711690, 0x28AA8DC1, 0xE4FA568A, 0x6721CDDB, 0x352ED075, 0xB6F54B24,
+    0x9130EB29, 0x12EB7078, 0x40E46DD6, 0xC33FF687, 0x0E266B1D, 0x8DFDF04C,
+    0xDFF2EDE2, 0x5C2976B3, 0x7BECD6BE, 0xF8374DEF, 0xAA385041, 0x29E3CB10,
+    0xE5B3105B, 0x66688B0A, 0x346796A4, 0xB7BC0DF5, 0x9079ADF8, 0x13A236A9,
+    0x41AD2B07, 0xC276B056, 0x0DFDA06E, 0x8E263B3F, 0xDC292691, 0x5FF2BDC0,
+    0x78371DCD, 0xFBEC869C, 0xA9E39B32, 0x2A380063, 0xE668DB28, 0x65B34079,
+    0x37BC5DD7, 0xB467C686, 0x93A2668B, 0x1079FDDA, 0x4276E074, 0xC1AD7B25,
+    0x0CB4E6BF, 0x8F6F7DEE, 0xDD606040, 0x5EBBFB11, 0x797E5B1C, 0xFAA5C04D,
+    0xA8AADDE3, 0x2B7146B2, 0xE7219DF9, 0x64FA06A8, 0x36F51B06, 0xB52E8057,
+    0x92EB205A, 0x1130BB0B, 0x433FA6A5, 0xC0E43DF4
+  },
+  {
+    0x00000000, 0x6041FC7A, 0xC083F8F4, 0xA0C2048E, 0x576441B5, 0x3725BDCF,
+    0x97E7B941, 0xF7A6453B, 0xAEC8836A, 0xCE897F10, 0x6E4B7B9E, 0x0E0A87E4,
+    0xF9ACC2DF, 0x99ED3EA5, 0x392F3A2B, 0x596EC651, 0x8BF2B689, 0xEBB34AF3,
+    0x4B714E7D, 0x2B30B207, 0xDC96F73C, 0xBCD70B46, 0x1C150FC8, 0x7C54F3B2,
+    0x253A35E3, 0x457BC999, 0xE5B9CD17, 0x85F8316D, 0x725E7456, 0x121F882C,
+    0xB2DD8CA2, 0xD29C70D8, 0xC186DD4F, 0xA1C72135, 0x010525BB, 0x6144D9C1,
+    0x96E29CFA, 0xF6A36080, 0x5661640E, 0x36209874, 0x6F4E5E25, 0x0F0FA25F,
+    0xAFCDA6D1, 0xCF8C5AAB, 0x382A1F90, 0x586BE3EA, 0xF8A9E764, 0x98E81B1E,
+    0x4A746BC6, 0x2A3597BC, 0x8AF79332, 0xEAB66F48, 0x1D102A73, 0x7D51D609,
+    0xDD93D287, 0xBDD22EFD, 0xE4BCE8AC, 0x84FD14D6, 0x243F1058, 0x447EEC22,
+    0xB3D8A919, 0xD3995563, 0x735B51ED, 0x131AAD97, 0x556E0AC3, 0x352FF6B9,
+    0x95EDF237, 0xF5AC0E4D, 0x020A4B76, 0x624BB70C, 0xC289B382, 0xA2C84FF8,
+    0xFBA689A9, 0x9BE775D3, 0x3B25715D, 0x5B648D27, 0xACC2C81C, 0xCC833466,
+    0x6C4130E8, 0x0C00CC92, 0xDE9CBC4A, 0xBEDD4030, 0x1E1F44BE, 0x7E5EB8C4,
+    0x89F8FDFF, 0xE9B90185, 0x497B050B, 0x293AF971, 0x70543F20, 0x1015C35A,
+    0xB0D7C7D4, 0xD0963BAE, 0x27307E95, 0x477182EF, 0xE7B38661, 0x87F27A1B,
+    0x94E8D78C, 0xF4A92BF6, 0x546B2F78, 0x342AD302, 0xC38C9639, 0xA3CD6A43,
+    0x030F6ECD, 0x634E92B7, 0x3A2054E6, 0x5A61A89C, 0xFAA3AC12, 0x9AE25068,
+    0x6D441553, 0x0D05E929, 0xADC7EDA7, 0xCD8611DD, 0x1F1A6105, 0x7F5B9D7F,
+    0xDF9999F1, 0xBFD8658B, 0x487E20B0, 0x283FDCCA, 0x88FDD844, 0xE8BC243E,
+    0xB1D2E26F, 0xD1931E15, 0x71511A9B, 0x1110E6E1, 0xE6B6A3DA, 0x86F75FA0,
+    0x26355B2E, 0x4674A754, 0xAADC1586, 0xCA9DE9FC, 0x6A5FED72, 0x0A1E1108,
+    0xFDB85433, 0x9DF9A849, 0x3D3BACC7, 0x5D7A50BD, 0x041496EC, 0x64556A96,
+    0xC4976E18, 0xA4D69262, 0x5370D759, 0x33312B23, 0x93F32FAD, 0xF3B2D3D7,
+    0x212EA30F, 0x416F5F75, 0xE1AD5BFB, 0x81ECA781, 0x764AE2BA, 0x160B1EC0,
+    0xB6C91A4E, 0xD688E634, 0x8FE62065, 0xEFA7DC1F, 0x4F65D891, 0x2F2424EB,
+    0xD88261D0, 0xB8C39DAA, 0x18019924, 0x7840655E, 0x6B5AC8C9, 0x0B1B34B3,
+    0xABD9303D, 0xCB98CC47, 0x3C3E897C, 0x5C7F7506, 0xFCBD7188, 0x9CFC8DF2,
+    0xC5924BA3, 0xA5D3B7D9, 0x0511B357, 0x65504F2D, 0x92F60A16, 0xF2B7F66C,
+    0x5275F2E2, 0x32340E98, 0xE0A87E40, 0x80E9823A, 0x202B86B4, 0x406A7ACE,
+    0xB7CC3FF5, 0xD78DC38F, 0x774FC701, 0x170E3B7B, 0x4E60FD2A, 0x2E210150,
+    0x8EE305DE, 0xEEA2F9A4, 0x1904BC9F, 0x794540E5, 0xD987446B, 0xB9C6B811,
+    0xFFB21F45, 0x9FF3E33F, 0x3F31E7B1, 0x5F701BCB, 0xA8D65EF0, 0xC897A28A,
+    0x6855A604, 0x08145A7E, 0x517A9C2F, 0x313B6055, 0x91F964DB, 0xF1B898A1,
+    0x061EDD9A, 0x665F21E0, 0xC69D256E, 0xA6DCD914, 0x7440A9CC, 0x140155B6,
+    0xB4C35138, 0xD482AD42, 0x2324E879, 0x43651403, 0xE3A7108D, 0x83E6ECF7,
+    0xDA882AA6, 0xBAC9D6DC, 0x1A0BD252, 0x7A4A2E28, 0x8DEC6B13, 0xEDAD9769,
+    0x4D6F93E7, 0x2D2E6F9D, 0x3E34C20A, 0x5E753E70, 0xFEB73AFE, 0x9EF6C684,
+    0x695083BF, 0x09117FC5, 0xA9D37B4B, 0xC9928731, 0x90FC4160, 0xF0BDBD1A,
+    0x507FB994, 0x303E45EE, 0xC79800D5, 0xA7D9FCAF, 0x071BF821, 0x675A045B,
+    0xB5C67483, 0xD58788F9, 0x75458C77, 0x1504700D, 0xE2A23536, 0x82E3C94C,
+    0x2221CDC2, 0x426031B8, 0x1B0EF7E9, 0x7B4F0B93, 0xDB8D0F1D, 0xBBCCF367,
+    0x4C6AB65C, 0x2C2B4A26, 0x8CE94EA8, 0xECA8B2D2
+  },
+  {
+    0x00000000, 0x9D65B2A5, 0xECA8D517, 0x71CD67B2, 0x0F321A73, 0x9257A8D6,
+    0xE39ACF64, 0x7EFF7DC1, 0x1E6434E6, 0x83018643, 0xF2CCE1F1, 0x6FA95354,
+    0x11562E95, 0x8C339C30, 0xFDFEFB82, 0x609B4927, 0x3CC869CC, 0xA1ADDB69,
+    0xD060BCDB, 0x4D050E7E, 0x33FA73BF, 0xAE9FC11A, 0xDF52A6A8, 0x4237140D,
+    0x22AC5D2A, 0xBFC9EF8F, 0xCE04883D, 0x53613A98, 0x2D9E4759, 0xB0FBF5FC,
+    0xC136924E, 0x5C5320EB, 0x7990D398, 0xE4F5613D, 0x9538068F, 0x085DB42A,
+    0x76A2C9EB, 0xEBC77B4E, 0x9A0A1CFC, 0x076FAE59, 0x67F4E77E, 0xFA9155DB,
+    0x8B5C3269, 0x163980CC, 0x68C6FD0D, 0xF5A34FA8, 0x846E281A, 0x190B9ABF,
+    0x4558BA54, 0xD83D08F1, 0xA9F06F43, 0x3495DDE6, 0x4A6AA027, 0xD70F1282,
+    0xA6C27530, 0x3BA7C795, 0x5B3C8EB2, 0xC6593C17, 0xB7945BA5, 0x2AF1E900,
+    0x540E94C1, 0xC96B2664, 0xB8A641D6, 0x25C3F373, 0xF321A730, 0x6E441595,
+    0x1F897227, 0x82ECC082, 0xFC13BD43, 0x61760FE6, 0x10BB6854, 0x8DDEDAF1,
+    0xED4593D6, 0x70202173, 0x01ED46C1, 0x9C88F464, 0xE27789A5, 0x7F123B00,
+    0x0EDF5CB2, 0x93BAEE17, 0xCFE9CEFC, 0x528C7C59, 0x23411BEB, 0xBE24A94E,
+    0xC0DBD48F, 0x5DBE662A, 0x2C730198, 0xB116B33D, 0xD18DFA1A, 0x4CE848BF,
+    0x3D252F0D, 0xA0409DA8, 0xDEBFE069, 0x43DA52CC, 0x3217357E, 0xAF7287DB,
+    0x8AB174A8, 0x17D4C60D, 0x6619A1BF, 0xFB7C131A, 0x85836EDB, 0x18E6DC7E,
+    0x692BBBCC, 0xF44E0969, 0x94D5404E, 0x09B0F2EB, 0x787D9559, 0xE51827FC,
+    0x9BE75A3D, 0x0682E898, 0x774F8F2A, 0xEA2A3D8F, 0xB6791D64, 0x2B1CAFC1,
+    0x5AD1C873, 0xC7B47AD6, 0xB94B0717, 0x242EB5B2, 0x55E3D200, 0xC88660A5,
+    0xA81D2982, 0x35789B27, 0x44B5FC95, 0xD9D04E30, 0xA72F33F1, 0x3A4A8154,
+    0x4B87E6E6, 0xD6E25443, 0x3020FE3D, 0xAD454C98, 0xDC882B2A, 0x41ED998F,
+    0x3F12E44E, 0xA27756EB, 0xD3BA3159, 0x4EDF83FC, 0x2E44CADB, 0xB321787E,
+    0xC2EC1FCC, 0x5F89AD69, 0x2176D0A8, 0xBC13620D, 0xCDDE05BF, 0x50BBB71A,
+    0x0CE897F1, 0x918D2554, 0xE04042E6, 0x7D25F043, 0x03DA8D82, 0x9EBF3F27,
+    0xEF725895, 0x7217EA30, 0x128CA317, 0x8FE911B2, 0xFE247600, 0x6341C4A5,
+    0x1DBEB964, 0x80DB0BC1, 0xF1166C73, 0x6C73DED6, 0x49B02DA5, 0xD4D59F00,
+    0xA518F8B2, 0x387D4A17, 0x468237D6, 0xDBE78573, 0xAA2AE2C1, 0x374F5064,
+    0x57D41943, 0xCAB1ABE6, 0xBB7CCC54, 0x26197EF1, 0x58E60330, 0xC583B195,
+    0xB44ED627, 0x292B6482, 0x75784469, 0xE81DF6CC, 0x99D0917E, 0x04B523DB,
+    0x7A4A5E1A, 0xE72FECBF, 0x96E28B0D, 0x0B8739A8, 0x6B1C708F, 0xF679C22A,
+    0x87B4A598, 0x1AD1173D, 0x642E6AFC, 0xF94BD859, 0x8886BFEB, 0x15E30D4E,
+    0xC301590D, 0x5E64EBA8, 0x2FA98C1A, 0xB2CC3EBF, 0xCC33437E, 0x5156F1DB,
+    0x209B9669, 0xBDFE24CC, 0xDD656DEB, 0x4000DF4E, 0x31CDB8FC, 0xACA80A59,
+    0xD2577798, 0x4F32C53D, 0x3EFFA28F, 0xA39A102A, 0xFFC930C1, 0x62AC8264,
+    0x1361E5D6, 0x8E045773, 0xF0FB2AB2, 0x6D9E9817, 0x1C53FFA5, 0x81364D00,
+    0xE1AD0427, 0x7CC8B682, 0x0D05D130, 0x90606395, 0xEE9F1E54, 0x73FAACF1,
+    0x0237CB43, 0x9F5279E6, 0xBA918A95, 0x27F43830, 0x56395F82, 0xCB5CED27,
+    0xB5A390E6, 0x28C62243, 0x590B45F1, 0xC46EF754, 0xA4F5BE73, 0x39900CD6,
+    0x485D6B64, 0xD538D9C1, 0xABC7A400, 0x36A216A5, 0x476F7117, 0xDA0AC3B2,
+    0x8659E359, 0x1B3C51FC, 0x6AF1364E, 0xF79484EB, 0x896BF92A, 0x140E4B8F,
+    0x65C32C3D, 0xF8A69E98, 0x983DD7BF, 0x0558651A, 0x749502A8, 0xE9F0B00D,
+    0x970FCDCC, 0x0A6A7F69, 0x7BA718DB, 0xE6C2AA7E
+  }
+};
+
+// blocks shorter than this are faster with the single table
+#define CRC_SLICE8_MIN_LENGTH 8
+
+// Accumulate "dataValue" into the CRC in crcValue.
+// Return value is updated CRC
+//
+//  Assumes that "unsigned char" is equivalent to one octet.
+//  Assumes that "unsigned int" is 16 bits.
+//  The ^ operator means exclusive OR.
+// Note: This function is copied directly from the BACnet standard.
+uint8_t CalcHeaderCRC(uint8_t dataValue, uint8_t crcValue)
+{
+  unsigned int crc;
+ 
+  crc = crcValue ^ dataValue;	/* XOR C7..C0 with D7..D0 */
+
+  /* Exclusive OR the terms in the table (top down) */
+  crc = crc ^ (crc << 1) ^ (crc << 2) ^ (crc << 3)
+            ^ (crc << 4) ^ (crc << 5) ^ (crc << 6) 
+            ^ (crc << 7);
+
+  /* Combine bits shifted out left hand end */
+  return (crc & 0xfe) ^ ((crc >> 8) & 1);
+}
+
+// Accumulate "dataValue" into the CRC in crcValue.
+//  Return value is updated CRC
+//
+//  Assumes that "unsigned char" is equivalent to one octet.
+//  Assumes that "unsigned int" is 16 bits.
+//  The ^ operator means exclusive OR.
+// Note: This function is copied directly from the BACnet standard.
+uint16_t CalcDataCRC(uint8_t dataValue, uint16_t crcValue)
+{
+ unsigned int crcLow;
+
+ crcLow = (crcValue & 0xff) ^ dataValue;	/* XOR C7..C0 with D7..D0 */
+
+ /* Exclusive OR the terms in the table (top down) */
+ return (crcValue >>8) ^ (crcLow << 8)  ^ (crcLow <<3)
+				^ (crcLow <<12)  ^ (crcLow >> 4)
+				^ (crcLow & 0x0f) ^ ((crcLow & 0x0f) << 7);
+}
+
+// accumulate a block of header octets into crc using the table
+uint8_t CRC_Header_Block(
+  const uint8_t *buffer,
+  size_t length,
+  uint8_t crc)
+{
+  while (length--)
+  {
+    crc = Header_CRC_Table[crc ^ *buffer++];
+  }
+
+  return crc;
+}
+
+// accumulate a block of data octets into crc using the reference
+uint16_t CRC_Data_Bytewise(
+  const uint8_t *buffer,
+  size_t length,
+  uint16_t crc)
+{
+  while (length--)
+  {
+    crc = CalcDataCRC(*buffer++, crc);
+  }
+
+  return crc;
+}
+
+// accumulate a block of data octets into crc using one table
+uint16_t CRC_Data_Table(
+  const uint8_t *buffer,
+  size_t length,
+  uint16_t crc)
+{
+  while (length--)
+  {
+    crc = (crc >> 8) ^ Data_CRC_Table[0][(crc ^ *buffer++) & 0xff];
+  }
+
+  return crc;
+}
+
+// accumulate a block of data octets into crc eight octets at a time.
+// The CRC is folded into the first two octets of each group, and
+// each table carries its octet past the rest of the group.
+uint16_t CRC_Data_Slice8(
+  const uint8_t *buffer,
+  size_t length,
+  uint16_t crc)
+{
+  while (length >= 8)
+  {
+    crc = Data_CRC_Table[7][(buffer[0] ^ crc) & 0xff] ^
+          Data_CRC_Table[6][(buffer[1] ^ (crc >> 8)) & 0xff] ^
+          Data_CRC_Table[5][buffer[2]] ^
+          Data_CRC_Table[4][buffer[3]] ^
+          Data_CRC_Table[3][buffer[4]] ^
+          Data_CRC_Table[2][buffer[5]] ^
+          Data_CRC_Table[1][buffer[6]] ^
+          Data_CRC_Table[0][buffer[7]];
+    buffer += 8;
+    length -= 8;
+  }
+
+  return CRC_Data_Table(buffer, length, crc);
+}
+
+// accumulate a block of data octets into crc, with the single table
+// for short blocks and eight tables for the rest
+uint16_t CRC_Data_Block(
+  const uint8_t *buffer,
+  size_t length,
+  uint16_t crc)
+{
+  if (length < CRC_SLICE8_MIN_LENGTH)
+    return CRC_Data_Table(buffer, length, crc);
+
+  return CRC_Data_Slice8(buffer, length, crc);
+}
+
+// Accumulate "dataValue" into the CRC-32K in crcValue.
+// Return value is updated CRC
+//
+//  The ^ operator means exclusive OR.
+// Note: This function follows the one in the BACnet standard.
+uint32_t CalcCRC32K(uint8_t dataValue, uint32_t crcValue)
+{
+  uint8_t b;
+
+  for (b = 0; b < 8; b++)
+  {
+    if ((dataValue & 1) ^ (crcValue & 1))
+    {
+      crcValue >>= 1;
+      crcValue ^= 0xEB31D82E; /* the reflected polynomial */
+    }
+    else
+    {
+      crcValue >>= 1;
+    }
+    dataValue >>= 1;
+  }
+
+  return crcValue;
+}
+
+// accumulate a block of octets into a CRC-32K using the reference
+uint32_t CRC32K_Bytewise(
+  const uint8_t *buffer,
+  size_t length,
+  uint32_t crc)
+{
+  while (length--)
+  {
+    crc = CalcCRC32K(*buffer++, crc);
+  }
+
+  return crc;
+}
+
+// accumulate a block of octets into a CRC-32K eight octets at a time.
+// The CRC is folded into the first four octets of each group, and
+// each table carries its octet past the rest of the group.
+uint32_t CRC32K_Slice8(
+  const uint8_t *buffer,
+  size_t length,
+  uint32_t crc)
+{
+  while (length >= 8)
+  {
+    crc ^= (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) |
+      ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+    crc = CRC32K_Table[7][crc & 0xff] ^
+          CRC32K_Table[6][(crc >> 8) & 0xff] ^
+          CRC32K_Table[5][(crc >> 16) & 0xff] ^
+          CRC32K_Table[4][crc >> 24] ^
+          CRC32K_Table[3][buffer[4]] ^
+          CRC32K_Table[2][buffer[5]] ^
+          CRC32K_Table[1][buffer[6]] ^
+          CRC32K_Table[0][buffer[7]];
+    buffer += 8;
+    length -= 8;
+  }
+  while (length--)
+  {
+    crc = (crc >> 8) ^ CRC32K_Table[0][(crc ^ *buffer++) & 0xff];
+  }
+
+  return crc;
+}
+
+// accumulate a block of octets into a CRC-32K
+uint32_t CRC32K_Block(
+  const uint8_t *buffer,
+  size_t length,
+  uint32_t crc)
+{
+  return CRC32K_Slice8(buffer, length, crc);
+}
+
+// returns true if the five header octets followed by the header CRC
+// octet are valid
+bool CRC_Header_Valid(const uint8_t *header)
+{
+  return (CRC_Header_Block(header, 6, 0xFF) == CRC_HEADER_RESIDUE);
+}
+
+// returns true if the data octets followed by the two data CRC
+// octets are valid.  length includes the two CRC octets.
+bool CRC_Data_Valid(const uint8_t *data, size_t length)
+{
+  return (CRC_Data_Block(data, length, 0xFFFF) == CRC_DATA_RESIDUE);
+}
+
+CRC_DATA_ENGINE CRC_Data_Engine(CRC_METHOD method)
+{
+  switch (method)
+  {
+    case CRC_METHOD_BYTEWISE:
+      return CRC_Data_Bytewise;
+    case CRC_METHOD_TABLE:
+      return CRC_Data_Table;
+    case CRC_METHOD_SLICE8:
+      return CRC_Data_Slice8;
+    case CRC_METHOD_AUTO:
+    default:
+      break;
+  }
+
+  return CRC_Data_Block;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+
+#include "ctest.h"
+
+// where the Wireshark capture files live, relative to code/
+#ifndef CRC_CAPTURES_DIR
+#define CRC_CAPTURES_DIR "../captures"
+#endif
+
+// pcap link type for MS/TP frames that begin with the preamble
+#define DLT_BACNET_MS_TP 165
+
+// test vectors from the examples in the BACnet standard
+void testCRCHeader(Test* pTest)
+{
+  uint8_t header[6] = {0x00, 0x10, 0x05, 0x00, 0x00, 0x00};
+  uint8_t crc = 0xFF;
+  unsigned i;
+
+  for (i = 0; i < 5; i++)
+  {
+    crc = CalcHeaderCRC(header[i], crc);
+  }
+  ct_test(pTest, crc == 0x73);
+  ct_test(pTest, CRC_Header_Block(header, 5, 0xFF) == 0x73);
+  // the ones complement is sent
+  header[5] = ~crc;
+  ct_test(pTest, header[5] == 0x8C);
+  ct_test(pTest, CalcHeaderCRC(header[5], crc) == CRC_HEADER_RESIDUE);
+  ct_test(pTest, CRC_Header_Valid(header));
+  header[2] = 0x06;
+  ct_test(pTest, !CRC_Header_Valid(header));
+
+  return;
+}
+
+void testCRCData(Test* pTest)
+{
+  uint8_t data[5] = {0x01, 0x22, 0x30, 0x00, 0x00};
+  uint16_t crc = 0xFFFF;
+  unsigned i;
+
+  for (i = 0; i < 3; i++)
+  {
+    crc = CalcDataCRC(data[i], crc);
+  }
+  ct_test(pTest, crc == 0x42EF);
+  // the ones complement is sent, least significant octet first
+  crc = ~crc;
+  data[3] = crc & 0xff;
+  data[4] = crc >> 8;
+  ct_test(pTest, data[3] == 0x10);
+  ct_test(pTest, data[4] == 0xBD);
+  ct_test(pTest, CRC_Data_Bytewise(data, 5, 0xFFFF) == CRC_DATA_RESIDUE);
+  ct_test(pTest, CRC_Data_Table(data, 5, 0xFFFF) == CRC_DATA_RESIDUE);
+  ct_test(pTest, CRC_Data_Slice8(data, 5, 0xFFFF) == CRC_DATA_RESIDUE);
+  ct_test(pTest, CRC_Data_Valid(data, 5));
+  data[1] = 0x23;
+  ct_test(pTest, !CRC_Data_Valid(data, 5));
+
+  return;
+}
+
+// every engine must agree with the reference for every length
+// and every alignment of the buffer
+void testCRCEngines(Test* pTest)
+{
+  uint8_t buffer[512 + 8];
+  size_t length;
+  size_t offset;
+  uint16_t crc;
+  uint8_t header_crc;
+  CRC_DATA_ENGINE engine;
+  int method;
+  unsigned i;
+
+  srand(1);
+  for (i = 0; i < sizeof(buffer); i++)
+  {
+    buffer[i] = rand() & 0xff;
+  }
+  for (offset = 0; offset < 8; offset++)
+  {
+    for (length = 0; length <= 512; length++)
+    {
+      crc = CRC_Data_Bytewise(&buffer[offset], length, 0xFFFF);
+      ct_test(pTest, CRC_Data_Table(&buffer[offset], length, 0xFFFF) == crc);
+      ct_test(pTest, CRC_Data_Slice8(&buffer[offset], length, 0xFFFF) == crc);
+      ct_test(pTest, CRC_Data_Block(&buffer[offset], length, 0xFFFF) == crc);
+      for (method = CRC_METHOD_AUTO; method <= CRC_METHOD_SLICE8; method++)
+      {
+        engine = CRC_Data_Engine((CRC_METHOD)method);
+        ct_test(pTest, engine(&buffer[offset], length, 0xFFFF) == crc);
+      }
+    }
+  }
+  for (i = 0; i < 256; i++)
+  {
+    header_crc = CalcHeaderCRC(buffer[i], (uint8_t)i);
+    ct_test(pTest, CRC_Header_Block(&buffer[i], 1, (uint8_t)i) == header_crc);
+  }
+
+  return;
+}
+
+// the check value of the CRC-32K catalogue, and the residue of a
+// block followed by its CRC, for every engine and length
+void testCRC32K(Test* pTest)
+{
+  uint8_t buffer[1500 + 8 + 4];
+  const uint8_t check[] = "123456789";
+  size_t length;
+  size_t offset;
+  uint32_t crc;
+  unsigned i;
+
+  crc = CRC32K_INITIAL_VALUE;
+  for (i = 0; i < 9; i++)
+  {
+    crc = CalcCRC32K(check[i], crc);
+  }
+  ct_test(pTest, ~crc == 0x2D3DD0AE);
+  ct_test(pTest, CRC32K_Bytewise(check, 9, CRC32K_INITIAL_VALUE) == crc);
+  ct_test(pTest, CRC32K_Slice8(check, 9, CRC32K_INITIAL_VALUE) == crc);
+  ct_test(pTest, CRC32K_Block(check, 9, CRC32K_INITIAL_VALUE) == crc);
+  srand(2);
+  for (i = 0; i < sizeof(buffer); i++)
+  {
+    buffer[i] = rand() & 0xff;
+  }
+  for (offset = 0; offset < 8; offset++)
+  {
+    for (length = 0; length <= 1500; length += (length < 64) ? 1 : 37)
+    {
+      crc = CRC32K_Bytewise(&buffer[offset], length, CRC32K_INITIAL_VALUE);
+      ct_test(pTest, CRC32K_Slice8(&buffer[offset], length,
+        CRC32K_INITIAL_VALUE) == crc);
+      ct_test(pTest, CRC32K_Block(&buffer[offset], length,
+        CRC32K_INITIAL_VALUE) == crc);
+      // the ones complement, least significant octet first
+      crc = ~crc;
+      for (i = 0; i < 4; i++)
+      {
+        buffer[offset + length + i] = (uint8_t)(crc >> (8 * i));
+      }
+      ct_test(pTest, CRC32K_Block(&buffer[offset], length + 4,
+        CRC32K_INITIAL_VALUE) == CRC32K_RESIDUE);
+    }
+  }
+
+  return;
+}
+
+static uint32_t pcap_value(const uint8_t *p, bool swap)
+{
+  if (swap)
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+      ((uint32_t)p[2] << 8) | p[3];
+
+  return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) |
+    ((uint32_t)p[1] << 8) | p[0];
+}
+
+// cross check one MS/TP frame against the reference routines
+static void check_frame(Test* pTest, const uint8_t *frame, size_t length)
+{
+  uint8_t header_crc = 0xFF;
+  uint16_t data_crc = 0xFFFF;
+  size_t data_length;
+  size_t i;
+
+  if ((length < 8) || (frame[0] != 0x55) || (frame[1] != 0xFF))
+    return;
+  for (i = 2; i < 8; i++)
+  {
+    header_crc = CalcHeaderCRC(frame[i], header_crc);
+  }
+  ct_test(pTest, CRC_Header_Block(&frame[2], 6, 0xFF) == header_crc);
+  ct_test(pTest, CRC_Header_Valid(&frame[2]) ==
+    (header_crc == CRC_HEADER_RESIDUE));
+  data_length = ((size_t)frame[5] << 8) | frame[6];
+  if (data_length && (length >= (8 + data_length + 2)))
+  {
+    for (i = 0; i < data_length + 2; i++)
+    {
+      data_crc = CalcDataCRC(frame[8 + i], data_crc);
+    }
+    ct_test(pTest, CRC_Data_Table(&frame[8], data_length + 2, 0xFFFF) ==
+      data_crc);
+    ct_test(pTest, CRC_Data_Slice8(&frame[8], data_length + 2, 0xFFFF) ==
+      data_crc);
+    ct_test(pTest, CRC_Data_Valid(&frame[8], data_length + 2) ==
+      (data_crc == CRC_DATA_RESIDUE));
+  }
+
+  return;
+}
+
+// cross check every MS/TP frame in one classic pcap file
+static unsigned check_capture(Test* pTest, const char *filename)
+{
+  FILE *file;
+  uint8_t header[24];
+  uint8_t record[16];
+  uint8_t *frame = NULL;
+  uint32_t magic;
+  uint32_t length;
+  bool swap;
+  unsigned frames = 0;
+
+  file = fopen(filename, "rb");
+  if (!file)
+    return 0;
+  if (fread(header, sizeof(header), 1, file) == 1)
+  {
+    magic = pcap_value(header, false);
+    if ((magic == 0xA1B2C3D4) || (magic == 0xA1B23C4D))
+      swap = false;
+    else if ((magic == 0xD4C3B2A1) || (magic == 0x4D3CB2A1))
+      swap = true;
+    else
+      goto done;
+    if (pcap_value(&header[20], swap) != DLT_BACNET_MS_TP)
+      goto done;
+    frame = malloc(0x10000);
+    if (!frame)
+      goto done;
+    while (fread(record, sizeof(record), 1, file) == 1)
+    {
+      length = pcap_value(&record[8], swap);
+      if (length > 0x10000)
+        break;
+      if (fread(frame, 1, length, file) != length)
+        break;
+      check_frame(pTest, frame, length);
+      frames++;
+    }
+  }
+done:
+  free(frame);
+  fclose(file);
+
+  return frames;
+}
+
+// cross check against the reference on every frame in captures/
+void testCRCCaptures(Test* pTest)
+{
+  DIR *dir;
+  struct dirent *entry;
+  char filename[1024];
+  unsigned frames = 0;
+
+  dir = opendir(CRC_CAPTURES_DIR);
+  if (!dir)
+  {
+    ct_fail(pTest, "unable to open " CRC_CAPTURES_DIR);
+    return;
+  }
+  while ((entry = readdir(dir)) != NULL)
+  {
+    if (entry->d_name[0] == '.')
+      continue;
+    snprintf(filename, sizeof(filename), "%s/%s",
+      CRC_CAPTURES_DIR, entry->d_name);
+    frames += check_capture(pTest, filename);
+  }
+  closedir(dir);
+  ct_test(pTest, frames > 0);
+  printf("crc: cross checked %u MS/TP frames\n", frames);
+
+  return;
+}
+
+// time one data CRC engine over a full size MS/TP data field
+static void benchmark_data(
+  const char *name,
+  uint16_t (*engine)(const uint8_t *, size_t, uint16_t),
+  const uint8_t *buffer,
+  size_t length)
+{
+  unsigned long iterations = 200000;
+  unsigned long i;
+  volatile uint16_t crc = 0;
+  clock_t start;
+  double seconds;
+
+  start = clock();
+  for (i = 0; i < iterations; i++)
+  {
+    crc ^= engine(buffer, length, 0xFFFF);
+  }
+  seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  if (seconds <= 0.0)
+    seconds = 1.0 / CLOCKS_PER_SEC;
+  printf("crc: %-9s %4u octets %9.1f MB/s %12.0f frames/s\n",
+    name, (unsigned)length,
+    ((double)length * iterations) / (seconds * 1000000.0),
+    iterations / seconds);
+
+  return;
+}
+
+static void benchmark_header(void)
+{
+  uint8_t header[6] = {0x00, 0x10, 0x05, 0x00, 0x00, 0x8C};
+  unsigned long iterations = 10000000;
+  unsigned long i;
+  unsigned j;
+  volatile uint8_t crc = 0;
+  uint8_t running;
+  clock_t start;
+  double seconds;
+
+  start = clock();
+  for (i = 0; i < iterations; i++)
+  {
+    running = 0xFF;
+    for (j = 0; j < 6; j++)
+    {
+      running = CalcHeaderCRC(header[j], running);
+    }
+    crc ^= running;
+  }
+  seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  printf("crc: header bytewise %12.0f headers/s\n", iterations / seconds);
+  start = clock();
+  for (i = 0; i < iterations; i++)
+  {
+    crc ^= CRC_Header_Block(header, 6, 0xFF);
+  }
+  seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  printf("crc: header table    %12.0f headers/s\n", iterations / seconds);
+
+  return;
+}
+
+// time one CRC-32K engine over the data of an extended frame
+static void benchmark_crc32k(
+  const char *name,
+  uint32_t (*engine)(const uint8_t *, size_t, uint32_t),
+  const uint8_t *buffer,
+  size_t length)
+{
+  unsigned long iterations = 100000;
+  unsigned long i;
+  volatile uint32_t crc = 0;
+  clock_t start;
+  double seconds;
+
+  start = clock();
+  for (i = 0; i < iterations; i++)
+  {
+    crc ^= engine(buffer, length, CRC32K_INITIAL_VALUE);
+  }
+  seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  if (seconds <= 0.0)
+    seconds = 1.0 / CLOCKS_PER_SEC;
+  printf("crc32k: %-9s %4u octets %9.1f MB/s %12.0f frames/s\n",
+    name, (unsigned)length,
+    ((double)length * iterations) / (seconds * 1000000.0),
+    iterations / seconds);
+
+  return;
+}
+
+void benchmarkCRC(void)
+{
+  uint8_t buffer[1497];
+  size_t lengths[] = {8, 64, 501};
+  unsigned i;
+
+  for (i = 0; i < sizeof(buffer); i++)
+  {
+    buffer[i] = rand() & 0xff;
+  }
+  benchmark_header();
+  for (i = 0; i < sizeof(lengths)/sizeof(lengths[0]); i++)
+  {
+    benchmark_data("bytewise", CRC_Data_Bytewise, buffer, lengths[i]);
+    benchmark_data("table", CRC_Data_Table, buffer, lengths[i]);
+    benchmark_data("slice8", CRC_Data_Slice8, buffer, lengths[i]);
+    benchmark_data("block", CRC_Data_Block, buffer, lengths[i]);
+  }
+  benchmark_crc32k("bytewise", CRC32K_Bytewise, buffer, sizeof(buffer));
+  benchmark_crc32k("slice8", CRC32K_Slice8, buffer, sizeof(buffer));
+
+  return;
+}
+
+#ifdef TEST_CRC
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("crc", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testCRCHeader);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testCRCData);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testCRCEngines);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testCRC32K);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testCRCCaptures);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  benchmarkCRC();
+
+  return 0;
+}
+#endif /* TEST_CRC */
+#endif /* TEST */
@@ -0,0 +1,125 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef CRC_H
+#define CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// CRC routines for the MS/TP header and data fields, and the CRC-32K
+// of COBS-encoded extended frames.
+// The octet-at-a-time routines are the reference copied from the
+// BACnet standard.  The block routines check a whole header or data
+// field at once using lookup tables.
+
+// Value of HeaderCRC after the header and its CRC octet are accumulated
+#define CRC_HEADER_RESIDUE 0x55
+// Value of DataCRC after the data and its two CRC octets are accumulated
+#define CRC_DATA_RESIDUE 0xF0B8
+// Start of a CRC-32K, and its value after the octets and their four
+// CRC octets are accumulated
+#define CRC32K_INITIAL_VALUE 0xFFFFFFFF
+#define CRC32K_RESIDUE 0x0843323B
+
+// engine of the data CRC block routine
+typedef enum
+{
+  CRC_METHOD_AUTO, // pick an engine based on the block length
+  CRC_METHOD_BYTEWISE, // reference shift and XOR
+  CRC_METHOD_TABLE, // one 256-entry table lookup per octet
+  CRC_METHOD_SLICE8 // eight 256-entry tables, eight octets per step
+} CRC_METHOD;
+
+// a data CRC block routine
+typedef uint16_t (*CRC_DATA_ENGINE)(
+  const uint8_t *buffer,
+  size_t length,
+  uint16_t crc);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// reference octet-at-a-time routines from the standard
+uint8_t CalcHeaderCRC(uint8_t dataValue, uint8_t crcValue);
+uint16_t CalcDataCRC(uint8_t dataValue, uint16_t crcValue);
+
+// accumulate a block of octets into a running CRC
+uint8_t CRC_Header_Block(
+  const uint8_t *buffer,
+  size_t length,
+  uint8_t crc);
+// CRC_Data_Block picks the engine based on the block length
+uint16_t CRC_Data_Block(
+  const uint8_t *buffer,
+  size_t length,
+  uint16_t crc);
+
+// the individual data CRC engines - for testing and benchmarks
+uint16_t CRC_Data_Bytewise(const uint8_t *buffer, size_t length, uint16_t crc);
+uint16_t CRC_Data_Table(const uint8_t *buffer, size_t length, uint16_t crc);
+uint16_t CRC_Data_Slice8(const uint8_t *buffer, size_t length, uint16_t crc);
+
+// The CRC-32K of COBS-encoded extended frames: the Koopman polynomial,
+// reflected, started at CRC32K_INITIAL_VALUE.  Its ones-complement is
+// sent least significant octet first.
+uint32_t CalcCRC32K(uint8_t dataValue, uint32_t crcValue);
+uint32_t CRC32K_Block(
+  const uint8_t *buffer,
+  size_t length,
+  uint32_t crc);
+
+// the individual CRC-32K engines - for testing and benchmarks
+uint32_t CRC32K_Bytewise(const uint8_t *buffer, size_t length, uint32_t crc);
+uint32_t CRC32K_Slice8(const uint8_t *buffer, size_t length, uint32_t crc);
+
+// returns true if the five header octets followed by the header CRC
+// octet are valid
+bool CRC_Header_Valid(const uint8_t *header);
+
+// returns true if the data octets followed by the two data CRC
+// octets are valid.  length includes the two CRC octets.
+bool CRC_Data_Valid(const uint8_t *data, size_t length);
+
+// returns the routine of a method, to be looked up once by a caller
+// that wants a particular engine.  CRC_METHOD_AUTO is CRC_Data_Block.
+CRC_DATA_ENGINE CRC_Data_Engine(CRC_METHOD method);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
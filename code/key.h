@@ -35,7 +35,8 @@
 #define KEY_H
 
 // This file has the macros that encode and decode the
-// keys for the keylist when used with BACnet Object Id's
+// keys for the keylist when used with BACnet Object Id's.
+// keyindex.h looks objects up on the two parts of the key.
 typedef unsigned int KEY;
 
 // assuming a 32 bit KEY
@@ -0,0 +1,563 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// Keyed Linked List Library
+//
+// This is a sorted array with the same functions as the keylist.
+// The entries are in one block that doubles when it is full, so
+// keys are found by binary search and indexes without a walk.
+// Popping the first entry only moves the start of the array,
+// which is taken back the next time the block is full.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "keyarray.h" // check for valid prototypes
+
+// entries in a new block
+#define KEYARRAY_SIZE_MIN 16
+
+/////////////////////////////////////////////////////////////////////
+// Generic entry routines
+/////////////////////////////////////////////////////////////////////
+
+// the first entry whose key is not less than key
+static int EntryLowerBound(
+  OS_Keyarray array,
+  KEY key)
+{
+  struct Keyarray_Entry *base = &array->entry[array->first];
+  int low = 0;
+  int high = array->count;
+  int middle;
+
+  while (low < high)
+  {
+    middle = low + ((high - low) / 2);
+    if (base[middle].key < key)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return low;
+}
+
+// the first entry whose key is more than key
+static int EntryUpperBound(
+  OS_Keyarray array,
+  KEY key)
+{
+  struct Keyarray_Entry *base = &array->entry[array->first];
+  int low = 0;
+  int high = array->count;
+  int middle;
+
+  while (low < high)
+  {
+    middle = low + ((high - low) / 2);
+    if (base[middle].key <= key)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return low;
+}
+
+// makes room for one more entry at the end of the block,
+// first by taking back the popped entries, then by growing it
+static int EntryRoom(
+  OS_Keyarray array)
+{
+  struct Keyarray_Entry *entry;
+  int size;
+
+  if ((array->first + array->count) < array->size)
+    return 1;
+  if (array->first)
+  {
+    memmove(array->entry,&array->entry[array->first],
+      array->count * sizeof(struct Keyarray_Entry));
+    array->first = 0;
+    return 1;
+  }
+  size = array->size ? (array->size * 2) : KEYARRAY_SIZE_MIN;
+  entry = realloc(array->entry,size * sizeof(struct Keyarray_Entry));
+  if (!entry)
+    return 0;
+  array->entry = entry;
+  array->size = size;
+
+  return 1;
+}
+
+// removes the entry at index and returns its data
+static void *EntryRemove(
+  OS_Keyarray array,
+  int index)
+{
+  struct Keyarray_Entry *base = &array->entry[array->first];
+  void *data = base[index].data;
+
+  // the key is empty unless an entry beside it has it too
+  if (array->used &&
+      !((index > 0) && (base[index - 1].key == base[index].key)) &&
+      !((index < (array->count - 1)) &&
+        (base[index + 1].key == base[index].key)))
+    Keymap_Clear(array->used,base[index].key);
+  if (index == 0)
+    array->first++;
+  else
+    memmove(&base[index],&base[index + 1],
+      (array->count - index - 1) * sizeof(struct Keyarray_Entry));
+  array->count--;
+  if (array->count == 0)
+    array->first = 0;
+
+  return data;
+}
+
+// builds the map of the keys in the array
+// returns NULL on failure
+static OS_Keymap EntryKeymap(
+  OS_Keyarray array)
+{
+  OS_Keymap map;
+  int index;
+
+  map = Keymap_Create();
+  for (index = 0; map && (index < array->count); index++)
+  {
+    if (!Keymap_Set(map,array->entry[array->first + index].key))
+    {
+      Keymap_Delete(map);
+      map = NULL;
+    }
+  }
+
+  return map;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Array functions
+/////////////////////////////////////////////////////////////////////
+
+// returns the array or NULL on failure.
+OS_Keyarray Keyarray_Create(void)
+{
+  return calloc(1,sizeof(struct Keyarray));
+}
+
+// returns an array with room for capacity entries,
+// or NULL on failure.
+OS_Keyarray Keyarray_Create_With_Capacity(
+  int capacity)
+{
+  OS_Keyarray array;
+
+  array = Keyarray_Create();
+  if (array && (capacity > 0))
+  {
+    array->entry = malloc(capacity * sizeof(struct Keyarray_Entry));
+    if (!array->entry)
+    {
+      free(array);
+      return NULL;
+    }
+    array->size = capacity;
+  }
+
+  return array;
+}
+
+// delete specified array
+void Keyarray_Delete(
+  OS_Keyarray array)
+{
+  if (array)
+  {
+    Keymap_Delete(array->used);
+    free(array->entry);
+    free(array);
+  }
+
+  return;
+}
+
+// inserts the data after any entries with the same key
+int Keyarray_Data_Add(
+  OS_Keyarray array,
+  KEY key,
+  void *data)
+{
+  struct Keyarray_Entry *base;
+  int index = -1;
+
+  if (array && EntryRoom(array))
+  {
+    index = EntryUpperBound(array,key);
+    base = &array->entry[array->first];
+    memmove(&base[index + 1],&base[index],
+      (array->count - index) * sizeof(struct Keyarray_Entry));
+    base[index].key = key;
+    base[index].data = data;
+    array->count++;
+    // without room for the key, the map is made again when needed
+    if (array->used && !Keymap_Set(array->used,key))
+    {
+      Keymap_Delete(array->used);
+      array->used = NULL;
+    }
+  }
+
+  return index;
+}
+
+// deletes the first entry with the key
+// returns the data from the entry
+void *Keyarray_Data_Delete(
+  OS_Keyarray array,
+  KEY key)
+{
+  int index;
+
+  if (array)
+  {
+    index = EntryLowerBound(array,key);
+    if ((index < array->count) &&
+        (array->entry[array->first + index].key == key))
+      return EntryRemove(array,index);
+  }
+
+  return NULL;
+}
+
+// deletes an entry specified by its index
+// returns the data from the entry
+void *Keyarray_Data_Delete_By_Index(
+  OS_Keyarray array,
+  int index)
+{
+  if (array && (index >= 0) && (index < array->count))
+    return EntryRemove(array,index);
+
+  return NULL;
+}
+
+// returns the data from the first entry, and removes it
+void *Keyarray_Data_Pop(
+  OS_Keyarray array)
+{
+  return Keyarray_Data_Delete_By_Index(array,0);
+}
+
+// returns the data from the first entry with the key
+void *Keyarray_Data(
+  OS_Keyarray array,
+  KEY key)
+{
+  int index;
+
+  if (array)
+  {
+    index = EntryLowerBound(array,key);
+    if ((index < array->count) &&
+        (array->entry[array->first + index].key == key))
+      return array->entry[array->first + index].data;
+  }
+
+  return NULL;
+}
+
+// returns the data specified by index
+void *Keyarray_Data_Index(
+  OS_Keyarray array,
+  int index)
+{
+  if (array && (index >= 0) && (index < array->count))
+    return array->entry[array->first + index].data;
+
+  return NULL;
+}
+
+// returns the first key from key on that is not in the array
+int Keyarray_Next_Empty_Key(
+  OS_Keyarray array,
+  KEY key)
+{
+  struct Keyarray_Entry *base;
+  int index;
+
+  if (array)
+  {
+    // the map is only kept for the arrays that use it
+    if (!array->used)
+      array->used = EntryKeymap(array);
+    if (array->used)
+      return Keymap_Next_Empty_Key(array->used,key);
+    base = &array->entry[array->first];
+    // the keys that follow key one after another are in use
+    for (index = EntryLowerBound(array,key);
+      (index < array->count) && (base[index].key <= key); index++)
+    {
+      if (base[index].key == key)
+        key++;
+    }
+  }
+
+  return key;
+}
+
+// returns the number of entries in the array
+int Keyarray_Count(
+  OS_Keyarray array)
+{
+  return array ? array->count : 0;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+
+#include "monotime.h"
+#include "ctest.h"
+#include "keylist.h"
+
+// growing, popping and taking back the front of the block
+void testKeyArray(Test* pTest)
+{
+  OS_Keyarray array;
+  static int data[1000];
+  int *value;
+  int index;
+  int i;
+
+  array = Keyarray_Create();
+  ct_test(pTest,array != NULL);
+  for (i = 0; i < 1000; i++)
+  {
+    data[i] = i;
+    // even keys going up, then odd keys going down
+    index = Keyarray_Data_Add(array,
+      (i < 500) ? (KEY)(i * 2) : (KEY)((999 - i) * 2 + 1),&data[i]);
+    ct_test(pTest,index == ((i < 500) ? i : (999 - i + 1)));
+  }
+  ct_test(pTest,Keyarray_Count(array) == 1000);
+  ct_test(pTest,array->size == 1024);
+  for (i = 0; i < 1000; i++)
+  {
+    value = Keyarray_Data(array,i);
+    ct_test(pTest,value && (*value == ((i & 1) ? (999 - (i / 2)) : (i / 2))));
+    ct_test(pTest,Keyarray_Data_Index(array,i) == value);
+  }
+  ct_test(pTest,Keyarray_Data(array,1000) == NULL);
+  ct_test(pTest,Keyarray_Data_Index(array,1000) == NULL);
+  ct_test(pTest,Keyarray_Data_Index(array,-1) == NULL);
+  ct_test(pTest,Keyarray_Next_Empty_Key(array,0) == 1000);
+  // pops only move the front
+  for (i = 0; i < 100; i++)
+    ct_test(pTest,Keyarray_Data_Pop(array) != NULL);
+  ct_test(pTest,array->first == 100);
+  ct_test(pTest,Keyarray_Count(array) == 900);
+  ct_test(pTest,Keyarray_Next_Empty_Key(array,0) == 0);
+  ct_test(pTest,Keyarray_Next_Empty_Key(array,100) == 1000);
+  // which are taken back instead of growing the block
+  for (i = 0; i < 100; i++)
+    (void)Keyarray_Data_Add(array,2000 + i,&data[i]);
+  ct_test(pTest,array->first == 0);
+  ct_test(pTest,array->size == 1024);
+  ct_test(pTest,Keyarray_Data_Index(array,0) == &data[50]);
+  ct_test(pTest,Keyarray_Data_Delete(array,2050) == &data[50]);
+  ct_test(pTest,Keyarray_Data_Delete(array,2050) == NULL);
+  ct_test(pTest,Keyarray_Data_Delete_By_Index(array,900) == &data[0]);
+  ct_test(pTest,Keyarray_Data_Delete_By_Index(array,998) == NULL);
+  ct_test(pTest,Keyarray_Count(array) == 998);
+  while (Keyarray_Data_Pop(array))
+    ;
+  ct_test(pTest,Keyarray_Count(array) == 0);
+  ct_test(pTest,array->first == 0);
+  Keyarray_Delete(array);
+  ct_test(pTest,Keyarray_Count(NULL) == 0);
+  ct_test(pTest,Keyarray_Data_Add(NULL,1,NULL) == -1);
+
+  return;
+}
+
+// the array and the keylist give the same answers to the same calls
+void testKeyArrayList(Test* pTest)
+{
+  OS_Keyarray array;
+  OS_Keylist list;
+  static int data[4000];
+  unsigned seed = 1;
+  KEY key;
+  int same = 1;
+  int i;
+
+  array = Keyarray_Create();
+  list = Keylist_Create();
+  for (i = 0; i < 4000; i++)
+  {
+    data[i] = i;
+    seed = seed * 1103515245 + 12345;
+    key = (seed >> 16) % 500;
+    switch ((seed >> 8) % 8)
+    {
+      case 0:
+        same &= (Keyarray_Data_Delete(array,key) ==
+          Keylist_Data_Delete(list,key));
+        break;
+      case 1:
+        same &= (Keyarray_Data_Delete_By_Index(array,key) ==
+          Keylist_Data_Delete_By_Index(list,key));
+        break;
+      case 2:
+        same &= (Keyarray_Data_Pop(array) == Keylist_Data_Pop(list));
+        break;
+      case 3:
+        same &= (Keyarray_Next_Empty_Key(array,key) ==
+          Keylist_Next_Empty_Key(list,key));
+        break;
+      default:
+        same &= (Keyarray_Data_Add(array,key,&data[i]) ==
+          Keylist_Data_Add(list,key,&data[i]));
+        break;
+    }
+    same &= (Keyarray_Data(array,key) == Keylist_Data(list,key));
+    same &= (Keyarray_Data_Index(array,key) == Keylist_Data_Index(list,key));
+    same &= (Keyarray_Count(array) == Keylist_Count(list));
+  }
+  ct_test(pTest,same);
+  ct_test(pTest,Keyarray_Count(array) > 100);
+  while (Keylist_Data_Pop(list))
+    ;
+  Keylist_Delete(list);
+  Keyarray_Delete(array);
+
+  return;
+}
+
+#ifdef TEST_KEYARRAY
+// an object table of count objects of a few types, added in random
+// order, then found by key and walked by index, as ReadPropertyMultiple
+// of all of the objects does
+static void benchmarkKeyArray(int count)
+{
+  OS_Keyarray array;
+  OS_Keylist list;
+  static KEY keys[100000];
+  unsigned seed = 7;
+  unsigned long sum = 0;
+  double start, list_add, list_find, list_index;
+  double array_add, array_find, array_index;
+  KEY swap;
+  int i, j;
+
+  for (i = 0; i < count; i++)
+    keys[i] = KEY_ENCODE(i % 8,i / 8);
+  for (i = count - 1; i > 0; i--)
+  {
+    seed = seed * 1103515245 + 12345;
+    j = (seed >> 8) % (i + 1);
+    swap = keys[i];
+    keys[i] = keys[j];
+    keys[j] = swap;
+  }
+  list = Keylist_Create();
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < count; i++)
+    (void)Keylist_Data_Add(list,keys[i],&keys[i]);
+  list_add = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < count; i++)
+    sum += (Keylist_Data(list,keys[i]) != NULL);
+  list_find = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < count; i++)
+    sum += (Keylist_Data_Index(list,i) != NULL);
+  list_index = OS_MonotonicSeconds() - start;
+  while (Keylist_Data_Pop(list))
+    ;
+  Keylist_Delete(list);
+
+  array = Keyarray_Create();
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < count; i++)
+    (void)Keyarray_Data_Add(array,keys[i],&keys[i]);
+  array_add = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < count; i++)
+    sum += (Keyarray_Data(array,keys[i]) != NULL);
+  array_find = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < count; i++)
+    sum += (Keyarray_Data_Index(array,i) != NULL);
+  array_index = OS_MonotonicSeconds() - start;
+  Keyarray_Delete(array);
+
+  printf("keyarray: %6d objects, ns each: add %9.1f list %9.1f array, "
+    "find %9.1f list %6.1f array, index %9.1f list %4.1f array (%lu)\n",
+    count, list_add * 1.0e9 / count, array_add * 1.0e9 / count,
+    list_find * 1.0e9 / count, array_find * 1.0e9 / count,
+    list_index * 1.0e9 / count, array_index * 1.0e9 / count, sum);
+
+  return;
+}
+
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("keyarray", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testKeyArray);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testKeyArrayList);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  benchmarkKeyArray(1000);
+  benchmarkKeyArray(5000);
+  benchmarkKeyArray(20000);
+
+  return 0;
+}
+#endif /* TEST_KEYARRAY */
+#endif /* TEST */
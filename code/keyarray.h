@@ -0,0 +1,114 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330 
+ Boston, MA  02111-1307, USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef KEYARRAY_H
+#define KEYARRAY_H
+
+#include "key.h"
+#include "keymap.h"
+
+// This is a key sorted array library with the same functions
+// as the keylist.  The entries are kept in one block of memory,
+// so a key is found by a binary search and an index at once.
+// Adding or deleting in the middle moves the entries after it.
+
+// one key and its data
+struct Keyarray_Entry
+{
+  KEY key; // sorted, and more than one entry may have the same key
+  void *data; // pointer to some data that is stored
+};
+
+typedef struct Keyarray
+{
+  struct Keyarray_Entry *entry; // the block, grown as needed
+  int first; // the entries that were popped off the front
+  int count; // entries in use after first
+  int size; // entries in the block
+  OS_Keymap used; // keys in the array, once an empty key is asked for
+} *OS_Keyarray;
+
+// returns the array or NULL on failure.
+OS_Keyarray Keyarray_Create(void);
+
+// returns an array with room for capacity entries,
+// or NULL on failure.  more may be added.
+OS_Keyarray Keyarray_Create_With_Capacity(
+  int capacity);
+
+// delete specified array
+void Keyarray_Delete(OS_Keyarray array);
+
+// inserts the data after any entries with the same key
+// returns the index where it was added, or -1 on failure
+int Keyarray_Data_Add(
+  OS_Keyarray array,
+  KEY key,
+  void *data);
+
+// deletes the first entry with the key
+// returns the data from the entry
+void *Keyarray_Data_Delete(
+  OS_Keyarray array,
+  KEY key);
+
+// deletes an entry specified by its index
+// returns the data from the entry
+void *Keyarray_Data_Delete_By_Index(
+  OS_Keyarray array,
+  int index);
+
+// returns the data from the first entry, and removes it
+void *Keyarray_Data_Pop(
+  OS_Keyarray array);
+
+// returns the data from the first entry with the key
+void *Keyarray_Data(
+  OS_Keyarray array,
+  KEY key);
+
+// returns the data specified by index
+void *Keyarray_Data_Index(
+  OS_Keyarray array,
+  int index);
+
+// returns the first key from key on that is not in the array
+int Keyarray_Next_Empty_Key(
+  OS_Keyarray array,
+  KEY key);
+
+// returns the number of entries in the array
+int Keyarray_Count(
+  OS_Keyarray array);
+
+#endif
@@ -0,0 +1,672 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// Keyed Linked List Library
+//
+// This is an index of objects on their object type and instance.
+// The type picks one slot of a fixed table, and the slot holds the
+// block of that type, so finding an object whose instances are
+// close together reads the slot and then the block.  A type whose
+// instances are spread out over a large span changes its block to
+// a sorted array of entries, which is searched instead, and changes
+// back once the instances fill the span again.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "keyindex.h" // check for valid prototypes
+
+// slots in a new block
+#define KEYINDEX_SIZE_MIN 16
+
+/////////////////////////////////////////////////////////////////////
+// Generic type routines
+/////////////////////////////////////////////////////////////////////
+
+// the smallest power of two block that holds instance
+static uint32_t TypeSpan(
+  uint32_t instance)
+{
+  uint32_t span = KEYINDEX_SIZE_MIN;
+
+  while (span <= instance)
+    span *= 2;
+
+  return span;
+}
+
+// the first entry whose instance is not less than instance
+static uint32_t EntryLowerBound(
+  struct Keyindex_Type *type,
+  uint32_t instance)
+{
+  uint32_t low = 0;
+  uint32_t high = type->count;
+  uint32_t middle;
+
+  while (low < high)
+  {
+    middle = low + ((high - low) / 2);
+    if (type->block.entry[middle].instance < instance)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return low;
+}
+
+// grows the direct array to span slots
+static bool TypeGrowDirect(
+  struct Keyindex_Type *type,
+  uint32_t span)
+{
+  void **data;
+
+  data = realloc(type->block.data,span * sizeof(void *));
+  if (!data)
+    return false;
+  memset(&data[type->size],0,(span - type->size) * sizeof(void *));
+  type->block.data = data;
+  type->size = span;
+
+  return true;
+}
+
+// puts the objects of a direct array into sorted entries
+static bool TypeMakeSparse(
+  struct Keyindex_Type *type)
+{
+  struct Keyindex_Entry *entry;
+  uint32_t size = KEYINDEX_SIZE_MIN;
+  uint32_t count = 0;
+  uint32_t i;
+
+  while (size <= type->count)
+    size *= 2;
+  entry = malloc(size * sizeof(struct Keyindex_Entry));
+  if (!entry)
+    return false;
+  for (i = 0; i < type->size; i++)
+  {
+    if (type->block.data[i])
+    {
+      entry[count].instance = i;
+      entry[count].data = type->block.data[i];
+      count++;
+    }
+  }
+  free(type->block.data);
+  type->block.entry = entry;
+  type->size = size;
+  type->sparse = 1;
+
+  return true;
+}
+
+// puts the sorted entries into a direct array of span slots
+static bool TypeMakeDirect(
+  struct Keyindex_Type *type,
+  uint32_t span)
+{
+  void **data;
+  uint32_t i;
+
+  data = calloc(span,sizeof(void *));
+  if (!data)
+    return false;
+  for (i = 0; i < type->count; i++)
+    data[type->block.entry[i].instance] = type->block.entry[i].data;
+  free(type->block.entry);
+  type->block.data = data;
+  type->size = span;
+  type->sparse = 0;
+
+  return true;
+}
+
+// adds an entry in instance order
+static bool TypeAddSparse(
+  struct Keyindex_Type *type,
+  uint32_t instance,
+  void *data)
+{
+  struct Keyindex_Entry *entry;
+  uint32_t i;
+
+  i = EntryLowerBound(type,instance);
+  if ((i < type->count) && (type->block.entry[i].instance == instance))
+    return false;
+  if (type->count == type->size)
+  {
+    entry = realloc(type->block.entry,
+      2 * type->size * sizeof(struct Keyindex_Entry));
+    if (!entry)
+      return false;
+    type->block.entry = entry;
+    type->size *= 2;
+  }
+  memmove(&type->block.entry[i + 1],&type->block.entry[i],
+    (type->count - i) * sizeof(struct Keyindex_Entry));
+  type->block.entry[i].instance = instance;
+  type->block.entry[i].data = data;
+  type->count++;
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Index functions
+/////////////////////////////////////////////////////////////////////
+
+// returns the index or NULL on failure.
+OS_Keyindex Keyindex_Create(void)
+{
+  return calloc(1,sizeof(struct Keyindex));
+}
+
+// delete specified index
+void Keyindex_Delete(
+  OS_Keyindex index)
+{
+  int t;
+
+  if (index)
+  {
+    for (t = 0; t < KEY_TYPE_MAX; t++)
+      free(index->type[t].block.data);
+    free(index);
+  }
+
+  return;
+}
+
+// adds the data as the object with the key
+bool Keyindex_Data_Add(
+  OS_Keyindex index,
+  KEY key,
+  void *data)
+{
+  struct Keyindex_Type *type;
+  uint32_t instance = KEY_DECODE_ID(key);
+  uint32_t span;
+
+  if (!index || !data)
+    return false;
+  type = &index->type[KEY_DECODE_TYPE(key)];
+  if (!type->sparse && (instance >= type->size))
+  {
+    span = TypeSpan(instance);
+    // a few objects far apart take too many slots
+    if ((span > KEYINDEX_DIRECT_MIN) &&
+        (span > (KEYINDEX_DENSITY * (uint32_t)(type->count + 1))))
+    {
+      if (!TypeMakeSparse(type))
+        return false;
+    }
+    else if (!TypeGrowDirect(type,span))
+      return false;
+  }
+  if (type->sparse)
+  {
+    if (!TypeAddSparse(type,instance,data))
+      return false;
+    // once the objects fill their span, the direct array is faster
+    span = TypeSpan(type->block.entry[type->count - 1].instance);
+    if ((span <= KEYINDEX_DIRECT_MIN) ||
+        (span <= (KEYINDEX_DENSITY * (uint32_t)type->count)))
+      (void)TypeMakeDirect(type,span);
+  }
+  else
+  {
+    if (type->block.data[instance])
+      return false;
+    type->block.data[instance] = data;
+    type->count++;
+  }
+  index->count++;
+
+  return true;
+}
+
+// deletes the object with the key
+// returns its data
+void *Keyindex_Data_Delete(
+  OS_Keyindex index,
+  KEY key)
+{
+  struct Keyindex_Type *type;
+  uint32_t instance = KEY_DECODE_ID(key);
+  void *data = NULL;
+  uint32_t i;
+
+  if (!index)
+    return NULL;
+  type = &index->type[KEY_DECODE_TYPE(key)];
+  if (type->sparse)
+  {
+    i = EntryLowerBound(type,instance);
+    if ((i < type->count) && (type->block.entry[i].instance == instance))
+    {
+      data = type->block.entry[i].data;
+      memmove(&type->block.entry[i],&type->block.entry[i + 1],
+        (type->count - i - 1) * sizeof(struct Keyindex_Entry));
+    }
+  }
+  else if (instance < type->size)
+  {
+    data = type->block.data[instance];
+    type->block.data[instance] = NULL;
+  }
+  if (data)
+  {
+    type->count--;
+    index->count--;
+    // the last object of a type gives back its block
+    if (type->count == 0)
+    {
+      free(type->block.data);
+      memset(type,0,sizeof(*type));
+    }
+  }
+
+  return data;
+}
+
+// returns the data of the object with the key, or NULL
+void *Keyindex_Data(
+  OS_Keyindex index,
+  KEY key)
+{
+  struct Keyindex_Type *type;
+  uint32_t instance = KEY_DECODE_ID(key);
+  uint32_t i;
+
+  if (!index)
+    return NULL;
+  type = &index->type[KEY_DECODE_TYPE(key)];
+  if (!type->sparse)
+    return (instance < type->size) ? type->block.data[instance] : NULL;
+  i = EntryLowerBound(type,instance);
+  if ((i < type->count) && (type->block.entry[i].instance == instance))
+    return type->block.entry[i].data;
+
+  return NULL;
+}
+
+// returns the number of objects in the index
+int Keyindex_Count(
+  OS_Keyindex index)
+{
+  return index ? index->count : 0;
+}
+
+// returns the number of objects of one type
+int Keyindex_Type_Count(
+  OS_Keyindex index,
+  int type)
+{
+  if (!index || (type < 0) || (type >= KEY_TYPE_MAX))
+    return 0;
+
+  return index->type[type].count;
+}
+
+// places the cursor at the first object of the type whose instance
+// is not less than instance
+void Keyindex_Cursor_Seek(
+  OS_Keyindex index,
+  int type,
+  uint32_t instance,
+  struct Keyindex_Cursor *cursor)
+{
+  cursor->type = type;
+  cursor->position = instance;
+  if (index && (type >= 0) && (type < KEY_TYPE_MAX) &&
+      index->type[type].sparse)
+    cursor->position = EntryLowerBound(&index->type[type],instance);
+
+  return;
+}
+
+// returns the data of the object at the cursor and moves past it,
+// or NULL after the last object of the type
+void *Keyindex_Cursor_Next(
+  OS_Keyindex index,
+  struct Keyindex_Cursor *cursor,
+  KEY *key)
+{
+  struct Keyindex_Type *type;
+  struct Keyindex_Entry *entry;
+  uint32_t position = cursor->position;
+
+  if (!index || (cursor->type < 0) || (cursor->type >= KEY_TYPE_MAX))
+    return NULL;
+  type = &index->type[cursor->type];
+  if (type->sparse)
+  {
+    if (position >= type->count)
+      return NULL;
+    entry = &type->block.entry[position];
+    cursor->position = position + 1;
+    if (key)
+      *key = KEY_ENCODE(cursor->type,entry->instance);
+    return entry->data;
+  }
+  // the unused instances between objects are skipped over
+  while ((position < type->size) && !type->block.data[position])
+    position++;
+  cursor->position = position + 1;
+  if (position >= type->size)
+  {
+    cursor->position = position;
+    return NULL;
+  }
+  if (key)
+    *key = KEY_ENCODE(cursor->type,position);
+
+  return type->block.data[position];
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+
+#include "monotime.h"
+#include "ctest.h"
+#include "keyarray.h"
+#include "keytree.h"
+
+// the objects of one type in order from a cursor, checked against
+// the same keys in a sorted array
+static bool test_scan(
+  OS_Keyindex index,
+  OS_Keyarray array,
+  int type)
+{
+  struct Keyindex_Cursor cursor;
+  void *data;
+  KEY key = 0;
+  int i;
+  int count = 0;
+  bool same = true;
+
+  Keyindex_Cursor_Seek(index,type,0,&cursor);
+  for (i = 0; i < Keyarray_Count(array); i++)
+  {
+    if (KEY_DECODE_TYPE(array->entry[array->first + i].key) != type)
+      continue;
+    data = Keyindex_Cursor_Next(index,&cursor,&key);
+    same &= (data == array->entry[array->first + i].data);
+    same &= (key == array->entry[array->first + i].key);
+    count++;
+  }
+  same &= (Keyindex_Cursor_Next(index,&cursor,&key) == NULL);
+  same &= (count == Keyindex_Type_Count(index,type));
+
+  return same;
+}
+
+void testKeyIndex(Test* pTest)
+{
+  OS_Keyindex index;
+  struct Keyindex_Cursor cursor;
+  int data[1000];
+  KEY key = 0;
+  int i;
+
+  index = Keyindex_Create();
+  ct_test(pTest,index != NULL);
+  for (i = 0; i < 1000; i++)
+    data[i] = i;
+  ct_test(pTest,Keyindex_Data(index,KEY_ENCODE(8,3)) == NULL);
+  ct_test(pTest,Keyindex_Data_Add(index,KEY_ENCODE(8,3),&data[0]));
+  ct_test(pTest,!Keyindex_Data_Add(index,KEY_ENCODE(8,3),&data[1]));
+  ct_test(pTest,!Keyindex_Data_Add(index,KEY_ENCODE(8,4),NULL));
+  ct_test(pTest,Keyindex_Data_Add(index,KEY_ENCODE(8,1),&data[1]));
+  ct_test(pTest,Keyindex_Data(index,KEY_ENCODE(8,3)) == &data[0]);
+  ct_test(pTest,Keyindex_Data(index,KEY_ENCODE(9,3)) == NULL);
+  ct_test(pTest,!index->type[8].sparse);
+
+  // one object far away makes the type sparse
+  ct_test(pTest,Keyindex_Data_Add(index,KEY_ENCODE(8,KEY_ID_MAX - 2),
+    &data[2]));
+  ct_test(pTest,index->type[8].sparse);
+  ct_test(pTest,!Keyindex_Data_Add(index,KEY_ENCODE(8,1),&data[3]));
+  ct_test(pTest,Keyindex_Data(index,KEY_ENCODE(8,KEY_ID_MAX - 2)) ==
+    &data[2]);
+  ct_test(pTest,Keyindex_Data(index,KEY_ENCODE(8,3)) == &data[0]);
+  ct_test(pTest,Keyindex_Data(index,KEY_ENCODE(8,2)) == NULL);
+  Keyindex_Cursor_Seek(index,8,2,&cursor);
+  ct_test(pTest,Keyindex_Cursor_Next(index,&cursor,&key) == &data[0]);
+  ct_test(pTest,key == KEY_ENCODE(8,3));
+  ct_test(pTest,Keyindex_Cursor_Next(index,&cursor,&key) == &data[2]);
+  ct_test(pTest,Keyindex_Cursor_Next(index,&cursor,&key) == NULL);
+  ct_test(pTest,Keyindex_Count(index) == 3);
+  ct_test(pTest,Keyindex_Type_Count(index,8) == 3);
+
+  // and deleting it does not change it back, but the type is only
+  // made direct again by filling in its span
+  ct_test(pTest,Keyindex_Data_Delete(index,KEY_ENCODE(8,KEY_ID_MAX - 2)) ==
+    &data[2]);
+  ct_test(pTest,Keyindex_Data_Delete(index,KEY_ENCODE(8,KEY_ID_MAX - 2)) ==
+    NULL);
+  for (i = 0; i < 1000; i++)
+    (void)Keyindex_Data_Add(index,KEY_ENCODE(8,i),&data[i]);
+  ct_test(pTest,!index->type[8].sparse);
+  ct_test(pTest,Keyindex_Type_Count(index,8) == 1000);
+  ct_test(pTest,Keyindex_Data(index,KEY_ENCODE(8,3)) == &data[0]);
+  ct_test(pTest,Keyindex_Data(index,KEY_ENCODE(8,999)) == &data[999]);
+
+  // an empty type gives back its block
+  for (i = 0; i < 1000; i++)
+    ct_test(pTest,Keyindex_Data_Delete(index,KEY_ENCODE(8,i)) != NULL);
+  ct_test(pTest,Keyindex_Count(index) == 0);
+  ct_test(pTest,index->type[8].size == 0);
+  Keyindex_Cursor_Seek(index,8,0,&cursor);
+  ct_test(pTest,Keyindex_Cursor_Next(index,&cursor,&key) == NULL);
+  Keyindex_Delete(index);
+
+  return;
+}
+
+// random objects of a few types, some close together and some
+// spread out, against a sorted array
+void testKeyIndexArray(Test* pTest)
+{
+  OS_Keyindex index;
+  OS_Keyarray array;
+  static int data[200000];
+  unsigned seed = 13;
+  uint32_t instance;
+  bool added;
+  KEY key;
+  int type;
+  int i, j;
+  bool same = true;
+
+  index = Keyindex_Create();
+  array = Keyarray_Create();
+  for (i = 0; i < 200000; i++)
+  {
+    data[i] = i;
+    seed = seed * 1103515245 + 12345;
+    type = (seed >> 8) % 4;
+    seed = seed * 1103515245 + 12345;
+    // type 0 close together, type 3 spread out, and the others
+    // spread out until they are emptied and filled in again
+    if ((type == 0) || ((type != 3) && (i >= 100000)))
+      instance = (seed >> 8) % 2000;
+    else
+      instance = (seed >> 8) % ((type == 3) ? KEY_ID_MAX : 50000);
+    key = KEY_ENCODE(type,instance);
+    if (i == 100000)
+    {
+      ct_test(pTest,index->type[1].sparse);
+      // the far out objects of the types that fill in go away
+      for (j = Keyarray_Count(array) - 1; j >= 0; j--)
+      {
+        key = array->entry[array->first + j].key;
+        if ((KEY_DECODE_TYPE(key) == 1) || (KEY_DECODE_TYPE(key) == 2))
+          same &= (Keyindex_Data_Delete(index,key) ==
+            Keyarray_Data_Delete_By_Index(array,j));
+      }
+      key = KEY_ENCODE(type,instance);
+    }
+    if ((seed >> 4) & 1)
+    {
+      added = Keyindex_Data_Add(index,key,&data[i]);
+      same &= (added == (Keyarray_Data(array,key) == NULL));
+      if (added)
+        (void)Keyarray_Data_Add(array,key,&data[i]);
+    }
+    else
+      same &= (Keyindex_Data_Delete(index,key) ==
+        Keyarray_Data_Delete(array,key));
+    same &= (Keyindex_Data(index,key) == Keyarray_Data(array,key));
+    same &= (Keyindex_Count(index) == Keyarray_Count(array));
+    if ((i % 20000) == 0)
+    {
+      for (type = 0; type < 4; type++)
+        same &= test_scan(index,array,type);
+    }
+  }
+  for (type = 0; type < 4; type++)
+    same &= test_scan(index,array,type);
+  ct_test(pTest,same);
+  ct_test(pTest,!index->type[0].sparse);
+  ct_test(pTest,!index->type[1].sparse);
+  ct_test(pTest,index->type[3].sparse);
+  Keyindex_Delete(index);
+  Keyarray_Delete(array);
+
+  return;
+}
+
+#ifdef TEST_KEYINDEX
+// a device object database of count objects over 16 types with
+// instances from zero, and a few far out instances in one type.
+// finds every object in random order and scans one type.
+static void benchmarkKeyIndex(int count)
+{
+  OS_Keyindex index;
+  OS_Keytree tree;
+  struct Keyindex_Cursor cursor;
+  struct Keytree_Cursor tree_cursor;
+  static KEY keys[1000000];
+  unsigned seed = 17;
+  unsigned long sum = 0;
+  double start;
+  double index_find, tree_find, index_scan, tree_scan;
+  KEY key;
+  KEY swap;
+  int i, j;
+
+  for (i = 0; i < count; i++)
+    keys[i] = KEY_ENCODE(i % 16,i / 16);
+  for (i = 0; i < 4; i++)
+    keys[i * 4] = KEY_ENCODE(15,4000000 + (i * 1000));
+  index = Keyindex_Create();
+  tree = Keytree_Create();
+  for (i = 0; i < count; i++)
+  {
+    (void)Keyindex_Data_Add(index,keys[i],&keys[i]);
+    (void)Keytree_Data_Add(tree,keys[i],&keys[i]);
+  }
+  for (i = count - 1; i > 0; i--)
+  {
+    seed = seed * 1103515245 + 12345;
+    j = (int)((seed >> 8) % (i + 1));
+    swap = keys[i];
+    keys[i] = keys[j];
+    keys[j] = swap;
+  }
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < count; i++)
+    sum += (Keyindex_Data(index,keys[i]) != NULL);
+  index_find = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < count; i++)
+    sum += (Keytree_Data(tree,keys[i]) != NULL);
+  tree_find = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  Keyindex_Cursor_Seek(index,1,0,&cursor);
+  while (Keyindex_Cursor_Next(index,&cursor,&key))
+    sum += key;
+  index_scan = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  Keytree_Cursor_Seek(tree,KEY_ENCODE(1,0),&tree_cursor);
+  while (Keytree_Cursor_Next(&tree_cursor,&key,NULL) &&
+    (KEY_DECODE_TYPE(key) == 1))
+    sum += key;
+  tree_scan = OS_MonotonicSeconds() - start;
+
+  printf("keyindex: %7d objects, index/tree: find %.1f/%.1f ns, "
+    "scan of one type %.1f/%.1f ns an object (%lu)\n", count,
+    index_find * 1.0e9 / count, tree_find * 1.0e9 / count,
+    index_scan * 1.0e9 / Keyindex_Type_Count(index,1),
+    tree_scan * 1.0e9 / Keyindex_Type_Count(index,1), sum);
+  Keyindex_Delete(index);
+  while (Keytree_Data_Pop(tree))
+    ;
+  Keytree_Delete(tree);
+
+  return;
+}
+
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("keyindex", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testKeyIndex);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testKeyIndexArray);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  benchmarkKeyIndex(10000);
+  benchmarkKeyIndex(100000);
+  benchmarkKeyIndex(1000000);
+
+  return 0;
+}
+#endif /* TEST_KEYINDEX */
+#endif /* TEST */
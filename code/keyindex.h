@@ -0,0 +1,143 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330 
+ Boston, MA  02111-1307, USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef KEYINDEX_H
+#define KEYINDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "key.h"
+
+// This is an index of BACnet objects by the object type and the
+// instance number that make up their key.  A table on the object
+// type points to the objects of that type, which are in an array
+// on the instance number when the instances are close together,
+// or in an array sorted by instance number when they are spread
+// out.  Finding a close together object is two memory reads, and
+// the objects of a type are all in one block.
+// Each key has at most one object, and its data may not be NULL.
+
+// instances a type may span in the direct array before it needs
+// to fill KEYINDEX_DENSITY of them
+#define KEYINDEX_DIRECT_MIN 256
+// at least one in KEYINDEX_DENSITY instances of a direct array
+// has an object in it
+#define KEYINDEX_DENSITY 4
+
+// an object of a type whose instances are spread out
+struct Keyindex_Entry
+{
+  uint32_t instance;
+  void *data;
+};
+
+// the objects of one type
+struct Keyindex_Type
+{
+  // data[instance], or NULL for an unused instance, until the
+  // instances are spread out, and then entry[] sorted by instance
+  union
+  {
+    void **data;
+    struct Keyindex_Entry *entry;
+  } block;
+  uint32_t size; // slots in the block
+  uint32_t count : 31; // objects of this type
+  uint32_t sparse : 1; // the block is entry[] instead of data[]
+};
+
+typedef struct Keyindex
+{
+  struct Keyindex_Type type[KEY_TYPE_MAX];
+  int count; // objects of every type
+} *OS_Keyindex;
+
+// a place among the objects of one type, in instance order.
+// adding or deleting objects of the type may move the places.
+struct Keyindex_Cursor
+{
+  int type;
+  uint32_t position; // in the block of the type
+};
+
+// returns the index or NULL on failure.
+OS_Keyindex Keyindex_Create(void);
+
+// delete specified index
+void Keyindex_Delete(OS_Keyindex index);
+
+// adds the data as the object with the key
+// returns false if the key is in use, the data is NULL,
+// or there is no memory for it
+bool Keyindex_Data_Add(
+  OS_Keyindex index,
+  KEY key,
+  void *data);
+
+// deletes the object with the key
+// returns its data
+void *Keyindex_Data_Delete(
+  OS_Keyindex index,
+  KEY key);
+
+// returns the data of the object with the key, or NULL
+void *Keyindex_Data(
+  OS_Keyindex index,
+  KEY key);
+
+// returns the number of objects in the index
+int Keyindex_Count(
+  OS_Keyindex index);
+
+// returns the number of objects of one type
+int Keyindex_Type_Count(
+  OS_Keyindex index,
+  int type);
+
+// places the cursor at the first object of the type whose instance
+// is not less than instance
+void Keyindex_Cursor_Seek(
+  OS_Keyindex index,
+  int type,
+  uint32_t instance,
+  struct Keyindex_Cursor *cursor);
+
+// returns the data of the object at the cursor and moves past it,
+// or NULL after the last object of the type.  key may be NULL.
+void *Keyindex_Cursor_Next(
+  OS_Keyindex index,
+  struct Keyindex_Cursor *cursor,
+  KEY *key);
+
+#endif
@@ -39,25 +39,79 @@
 // static data
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "keylist.h" // check for valid prototypes
 
+#if !defined(KEYLIST_SORTED_ARRAY) && !defined(KEYLIST_BTREE)
+
+// nodes in the first and the largest block of nodes
+#define KEYLIST_CHUNK_MIN 16
+#define KEYLIST_CHUNK_MAX 1024
+
+// a block of nodes, freed with the list
+struct Keylist_Chunk
+{
+  struct Keylist_Chunk *next;
+  struct Keylist_Node node[];
+};
+
 /////////////////////////////////////////////////////////////////////
 // Generic node routines
 /////////////////////////////////////////////////////////////////////
 
-// grab memory for a node
-static OS_Keylist NodeCreate(void)
+// grab memory for a block of count nodes, and put them on
+// the free nodes of the list
+// returns 0 on failure
+static int NodeChunk(
+  OS_Keylist list,
+  int count) // nodes in the block
+{
+  struct Keylist_Chunk *chunk;
+  int i;
+
+  chunk = malloc(sizeof(struct Keylist_Chunk) +
+    (count * sizeof(struct Keylist_Node)));
+  if (!chunk)
+    return 0;
+  chunk->next = list->chunk;
+  list->chunk = chunk;
+  for (i = 0; i < count; i++)
+  {
+    chunk->node[i].next = list->free;
+    list->free = &chunk->node[i];
+  }
+
+  return 1;
+}
+
+// grab memory for a node, from the free nodes of the list
+static struct Keylist_Node *NodeCreate(
+  OS_Keylist list)
 {
-  return calloc(1,sizeof(struct Keylist_Node));
+  struct Keylist_Node *node;
+
+  if (!list->free)
+  {
+    if (!NodeChunk(list,list->chunk_size))
+      return NULL;
+    // each block is larger than the last, up to a point
+    if (list->chunk_size < KEYLIST_CHUNK_MAX)
+      list->chunk_size *= 2;
+  }
+  node = list->free;
+  list->free = node->next;
+  memset(node,0,sizeof(struct Keylist_Node));
+
+  return node;
 }
 
 // find the next available key in the list of lists
 static KEY NodeNextKey(
-  OS_Keylist head,// head of the list
+  struct Keylist_Node *head,// head of the list
   KEY key)// starting key you wish to use - try zero
 {
-  OS_Keylist node;
+  struct Keylist_Node *node;
   int found;
 
   if (head)
@@ -86,18 +140,19 @@ static KEY NodeNextKey(
 // the key indicates it should go
 // return the place in the list where it went
 static int NodeAddByKey(
-  OS_Keylist head,// head of the list
+  OS_Keylist list,
   KEY key,
   void *data)
 {
   int index = -1;
-  OS_Keylist node;
-  OS_Keylist prev;
-  OS_Keylist next;
+  struct Keylist_Node *head = &list->head;
+  struct Keylist_Node *node;
+  struct Keylist_Node *prev;
+  struct Keylist_Node *next;
 
   if (head)
   {
-    node = NodeCreate();
+    node = NodeCreate(list);
     if (node)
     {
       node->key = key;
@@ -118,18 +173,9 @@ static int NodeAddByKey(
         next = next->next;
         index++;
       }
-      // case: middle of the list
-      if (next)
-      {
-        node->next = next->next;
-        next->next = node;
-      }
-      // case: end of the list
-      else
-      {
-        node->next = NULL;
-        prev->next = node;
-      }
+      // before the larger key, or at the end of the list
+      node->next = next;
+      prev->next = node;
     }
   }
 
@@ -138,11 +184,11 @@ static int NodeAddByKey(
 
 // search through list and find the first matching key
 // return the node
-static OS_Keylist NodeByKey(
-  OS_Keylist head,// head of the list
+static struct Keylist_Node *NodeByKey(
+  struct Keylist_Node *head,// head of the list
   KEY key) // key to find a match
 {
-  OS_Keylist next = NULL; // return value
+  struct Keylist_Node *next = NULL; // return value
 
   if (head)
   {
@@ -160,11 +206,11 @@ static OS_Keylist NodeByKey(
 
 // search through list and find the node with the
 // correct index
-static OS_Keylist NodeByIndex(
-  OS_Keylist head,// head of the list
+static struct Keylist_Node *NodeByIndex(
+  struct Keylist_Node *head,// head of the list
   int index) // position in list to find
 {
-  OS_Keylist next = NULL; // used for return value
+  struct Keylist_Node *next = NULL; // used for return value
 
   if (head && (index >= 0))
   {
@@ -182,10 +228,10 @@ static OS_Keylist NodeByIndex(
 }
 
 // returns the last node, and removes it from the list
-static OS_Keylist NodePop(
-  OS_Keylist head)// head of the list
+static struct Keylist_Node *NodePop(
+  struct Keylist_Node *head)// head of the list
 {
-  OS_Keylist next = NULL; // used for return value
+  struct Keylist_Node *next = NULL; // used for return value
 
   if (head)
   {
@@ -201,12 +247,12 @@ static OS_Keylist NodePop(
 
 // removes node specified by key on the list of lists
 // and returns it
-static OS_Keylist NodeRemoveByKey(
-  OS_Keylist head,// head of the list
+static struct Keylist_Node *NodeRemoveByKey(
+  struct Keylist_Node *head,// head of the list
   KEY key) // key to find a match
 {
-  OS_Keylist next = NULL;// return value
-  OS_Keylist prev;
+  struct Keylist_Node *next = NULL;// return value
+  struct Keylist_Node *prev;
 
   if (head)
   {
@@ -234,12 +280,12 @@ static OS_Keylist NodeRemoveByKey(
 
 // removes node specified by key on the list of lists
 // and returns it
-static OS_Keylist NodeRemoveByIndex(
-  OS_Keylist head,// head of the list
+static struct Keylist_Node *NodeRemoveByIndex(
+  struct Keylist_Node *head,// head of the list
   int index) // key to find a match
 {
-  OS_Keylist next = NULL;// return value
-  OS_Keylist prev;
+  struct Keylist_Node *next = NULL;// return value
+  struct Keylist_Node *prev;
 
   if (head)
   {
@@ -268,12 +314,12 @@ static OS_Keylist NodeRemoveByIndex(
 
 // removes node specified by key on the list of lists
 // and returns it
-static OS_Keylist NodeRemoveByData(
-  OS_Keylist head,// head of the list
+static struct Keylist_Node *NodeRemoveByData(
+  struct Keylist_Node *head,// head of the list
   void *data) // key to find a match
 {
-  OS_Keylist next = NULL;// return value
-  OS_Keylist prev;
+  struct Keylist_Node *next = NULL;// return value
+  struct Keylist_Node *prev;
 
   if (head)
   {
@@ -301,9 +347,9 @@ static OS_Keylist NodeRemoveByData(
 
 // returns the number of nodes in the list
 static int NodeCount(
-  OS_Keylist head)// head of the list
+  struct Keylist_Node *head)// head of the list
 {
-  OS_Keylist next;
+  struct Keylist_Node *next;
   int count = 0; // return value
 
   if (head)
@@ -319,6 +365,60 @@ static int NodeCount(
   return count;
 }
 
+// returns 1 if a node in the sorted list has the key
+static int NodeHasKey(
+  struct Keylist_Node *head,// head of the list
+  KEY key) // key to find a match
+{
+  struct Keylist_Node *next = head->next;
+
+  while (next && (next->key < key))
+    next = next->next;
+
+  return next && (next->key == key);
+}
+
+// builds the map of the keys in the list
+// returns NULL on failure
+static OS_Keymap NodeKeymap(
+  struct Keylist_Node *head)// head of the list
+{
+  OS_Keymap map;
+  struct Keylist_Node *next;
+
+  map = Keymap_Create();
+  for (next = head->next; map && next; next = next->next)
+  {
+    if (!Keymap_Set(map,next->key))
+    {
+      Keymap_Delete(map);
+      map = NULL;
+    }
+  }
+
+  return map;
+}
+
+// the node is off the list, so its key is empty unless another
+// node has it.  the node goes back to the free nodes of the list.
+static void *NodeFree(
+  OS_Keylist list,
+  struct Keylist_Node *node)
+{
+  void *data = NULL; // return value
+
+  if (node)
+  {
+    if (list->used && !NodeHasKey(&list->head,node->key))
+      Keymap_Clear(list->used,node->key);
+    data = node->data;
+    node->next = list->free;
+    list->free = node;
+  }
+
+  return data;
+}
+
 /////////////////////////////////////////////////////////////////////
 // List of Lists functions
 /////////////////////////////////////////////////////////////////////
@@ -327,17 +427,51 @@ static int NodeCount(
 // returns head of the list or NULL on failure.
 OS_Keylist Keylist_Create(void)
 {
+  OS_Keylist list;
+
   // create the new list head
-  return NodeCreate();
+  list = calloc(1,sizeof(struct Keylist));
+  if (list)
+    list->chunk_size = KEYLIST_CHUNK_MIN;
+
+  return list;
+}
+
+// returns head of a list with nodes for capacity entries,
+// or NULL on failure.
+OS_Keylist Keylist_Create_With_Capacity(
+  int capacity)
+{
+  OS_Keylist list;
+
+  list = Keylist_Create();
+  if (list && (capacity > 0) && !NodeChunk(list,capacity))
+  {
+    Keylist_Delete(list);
+    list = NULL;
+  }
+
+  return list;
 }
 
 // delete specified list
 void Keylist_Delete(
   OS_Keylist list) // list number to be deleted
 {
-  // FIXME: delete all the members?
+  struct Keylist_Chunk *chunk;
+
+  // the nodes go with the list, but not the data in them
   if (list)
+  {
+    while (list->chunk)
+    {
+      chunk = list->chunk;
+      list->chunk = chunk->next;
+      free(chunk);
+    }
+    Keymap_Delete(list->used);
     free(list);
+  }
 
   return;
 }
@@ -352,7 +486,20 @@ int Keylist_Data_Add(
   KEY key,
   void *data)
 {
-  return NodeAddByKey(list,key,data);
+  int index = -1;
+
+  if (list)
+  {
+    index = NodeAddByKey(list,key,data);
+    // without room for the key, the map is made again when needed
+    if ((index >= 0) && list->used && !Keymap_Set(list->used,key))
+    {
+      Keymap_Delete(list->used);
+      list->used = NULL;
+    }
+  }
+
+  return index;
 }
 
 // deletes a node specified by its key
@@ -361,17 +508,10 @@ void *Keylist_Data_Delete(
   OS_Keylist list,
   KEY key)
 {
-  OS_Keylist node;
-  void *data = NULL; // return value
-
-  node = NodeRemoveByKey(list,key);
-  if (node)
-  {
-    data = node->data;
-    free(node);
-  }
+  if (!list)
+    return NULL;
 
-  return data;
+  return NodeFree(list,NodeRemoveByKey(&list->head,key));
 }
 
 // deletes a node specified by its index
@@ -380,17 +520,10 @@ void *Keylist_Data_Delete_By_Index(
   OS_Keylist list,
   int index)
 {
-  OS_Keylist node;
-  void *data = NULL;
-
-  node = NodeRemoveByIndex(list,index);
-  if (node)
-  {
-    data = node->data;
-    free(node);
-  }
+  if (!list)
+    return NULL;
 
-  return data;
+  return NodeFree(list,NodeRemoveByIndex(&list->head,index));
 }
 
 // deletes a node specified by its index
@@ -399,11 +532,8 @@ void *Keylist_Data_Delete_By_Data(
   OS_Keylist list,
   void *data)
 {
-  OS_Keylist node;
-
-  node = NodeRemoveByData(list,data);
-  if (node)
-    free(node);
+  if (list)
+    (void)NodeFree(list,NodeRemoveByData(&list->head,data));
 
   return data;
 }
@@ -413,9 +543,9 @@ void *Keylist_Data(
   OS_Keylist list,
   KEY key)
 {
-  OS_Keylist node;
+  struct Keylist_Node *node;
 
-  node = NodeByKey(list,key);
+  node = list ? NodeByKey(&list->head,key) : NULL;
 
   return node ? node->data : NULL;
 }
@@ -425,7 +555,15 @@ int Keylist_Next_Empty_Key(
   OS_Keylist list,
   KEY key)
 {
-  return NodeNextKey(list,key);
+  if (!list)
+    return key;
+  // the map is only kept for the lists that use it
+  if (!list->used)
+    list->used = NodeKeymap(&list->head);
+  if (list->used)
+    return Keymap_Next_Empty_Key(list->used,key);
+
+  return NodeNextKey(&list->head,key);
 }
 
 // returns the data specified by key
@@ -433,9 +571,9 @@ void *Keylist_Data_Index(
   OS_Keylist list,
   int index)
 {
-  OS_Keylist node;
+  struct Keylist_Node *node;
 
-  node = NodeByIndex(list,index);
+  node = list ? NodeByIndex(&list->head,index) : NULL;
 
   return node ? node->data : NULL;
 }
@@ -444,26 +582,43 @@ void *Keylist_Data_Index(
 void *Keylist_Data_Pop(
   OS_Keylist list)
 {
-  OS_Keylist node;
-
-  node = NodePop(list);
+  if (!list)
+    return NULL;
 
-  return node ? node->data : NULL;
+  return NodeFree(list,NodePop(&list->head));
 }
 
 // return the number of nodes in this list
 int Keylist_Count(
   OS_Keylist list)
 {
-  return NodeCount(list);
+  return list ? NodeCount(&list->head) : 0;
 }
+#endif
 
 #ifdef TEST
 #include <assert.h>
+#include <stdio.h>
 #include <string.h>
 
+#include "monotime.h"
 #include "ctest.h"
 
+#if !defined(KEYLIST_SORTED_ARRAY) && !defined(KEYLIST_BTREE)
+// the blocks of nodes that the list has taken
+static int test_chunks(
+  OS_Keylist list)
+{
+  struct Keylist_Chunk *chunk;
+  int count = 0;
+
+  for (chunk = list->chunk; chunk; chunk = chunk->next)
+    count++;
+
+  return count;
+}
+#endif
+
 // test the encode and decode macros
 void testKeySample(Test* pTest)
 {
@@ -678,7 +833,190 @@ void testKeyListDataIndex(Test* pTest)
   return;
 }
 
+// keys added out of order are sorted, with equal keys in the
+// order that they were added
+void testKeyListOrder(Test* pTest)
+{
+  OS_Keylist list;
+  KEY keys[] = {5, 3, 4, 1, 3, 9};
+  int expected_index[] = {0, 0, 1, 0, 2, 5};
+  KEY sorted[] = {1, 3, 3, 4, 5, 9};
+  int sorted_data[] = {3, 1, 4, 2, 0, 5};
+  int data[6];
+  int *value;
+  int index;
+  int i;
+
+  list = Keylist_Create();
+  ct_test(pTest,list != NULL);
+
+  for (i = 0; i < 6; i++)
+  {
+    data[i] = i;
+    index = Keylist_Data_Add(list,keys[i],&data[i]);
+    ct_test(pTest,index == expected_index[i]);
+  }
+  for (i = 0; i < 6; i++)
+  {
+    value = Keylist_Data_Index(list,i);
+    ct_test(pTest,value != NULL);
+    ct_test(pTest,*value == sorted_data[i]);
+    value = Keylist_Data(list,sorted[i]);
+    ct_test(pTest,value != NULL);
+  }
+  ct_test(pTest,Keylist_Next_Empty_Key(list,3) == 6);
+  ct_test(pTest,Keylist_Next_Empty_Key(list,0) == 0);
+  ct_test(pTest,Keylist_Next_Empty_Key(list,9) == 10);
+  value = Keylist_Data_Delete(list,3);
+  ct_test(pTest,(value != NULL) && (*value == 1));
+  value = Keylist_Data_Index(list,1);
+  ct_test(pTest,(value != NULL) && (*value == 4));
+  value = Keylist_Data_Pop(list);
+  ct_test(pTest,(value != NULL) && (*value == 3));
+
+  // cleanup
+  do
+  {
+    value = Keylist_Data_Pop(list);
+  } while (value);
+
+  Keylist_Delete(list);
+
+  return;
+}
+
+// the next empty key follows the keys as they are added and deleted,
+// and a key stays in use until its last node is gone
+void testKeyListNextEmpty(Test* pTest)
+{
+  OS_Keylist list;
+  int data[8];
+  int i;
+
+  list = Keylist_Create();
+  ct_test(pTest,list != NULL);
+  for (i = 0; i < 4; i++)
+  {
+    data[i] = i;
+    (void)Keylist_Data_Add(list,Keylist_Next_Empty_Key(list,10),&data[i]);
+  }
+  // 10, 11, 12, 13 and then 11 and 12 again
+  ct_test(pTest,Keylist_Next_Empty_Key(list,10) == 14);
+  (void)Keylist_Data_Add(list,11,&data[4]);
+  (void)Keylist_Data_Add(list,12,&data[5]);
+  ct_test(pTest,Keylist_Next_Empty_Key(list,11) == 14);
+  ct_test(pTest,Keylist_Data_Delete(list,11) == &data[1]);
+  ct_test(pTest,Keylist_Next_Empty_Key(list,10) == 14);
+  ct_test(pTest,Keylist_Data_Delete(list,11) == &data[4]);
+  ct_test(pTest,Keylist_Next_Empty_Key(list,10) == 11);
+  // 10, 12, 12, 13
+  ct_test(pTest,Keylist_Data_Delete_By_Index(list,2) == &data[5]);
+  ct_test(pTest,Keylist_Next_Empty_Key(list,12) == 14);
+  ct_test(pTest,Keylist_Data_Delete_By_Index(list,1) == &data[2]);
+  ct_test(pTest,Keylist_Next_Empty_Key(list,12) == 12);
+  ct_test(pTest,Keylist_Data_Pop(list) == &data[0]);
+  ct_test(pTest,Keylist_Next_Empty_Key(list,10) == 10);
+  ct_test(pTest,Keylist_Next_Empty_Key(list,13) == 14);
+  ct_test(pTest,Keylist_Data_Pop(list) == &data[3]);
+  ct_test(pTest,Keylist_Next_Empty_Key(list,13) == 13);
+  // across the end of one object type into the next
+  (void)Keylist_Data_Add(list,KEY_ENCODE(4,KEY_ID_MAX - 1),&data[6]);
+  (void)Keylist_Data_Add(list,KEY_ENCODE(5,0),&data[7]);
+  ct_test(pTest,Keylist_Next_Empty_Key(list,KEY_ENCODE(4,KEY_ID_MAX - 1)) ==
+    (int)KEY_ENCODE(5,1));
+  while (Keylist_Data_Pop(list))
+    ;
+
+  Keylist_Delete(list);
+
+  return;
+}
+
+// a list made with room for its entries, used over and over
+void testKeyListCapacity(Test* pTest)
+{
+  OS_Keylist list;
+  int data[100];
+  int *value;
+  int pass, i;
+
+  list = Keylist_Create_With_Capacity(100);
+  ct_test(pTest,list != NULL);
+  for (pass = 0; pass < 3; pass++)
+  {
+    for (i = 0; i < 100; i++)
+    {
+      data[i] = i;
+      ct_test(pTest,Keylist_Data_Add(list,99 - i,&data[i]) == 0);
+    }
+    ct_test(pTest,Keylist_Count(list) == 100);
+#if !defined(KEYLIST_SORTED_ARRAY) && !defined(KEYLIST_BTREE)
+    // the nodes that are given back are used again
+    ct_test(pTest,test_chunks(list) == 1);
+#endif
+    for (i = 0; i < 100; i++)
+    {
+      value = Keylist_Data_Pop(list);
+      ct_test(pTest,(value != NULL) && (*value == (99 - i)));
+    }
+  }
+  // more than the capacity, and a list deleted with its entries
+  for (i = 0; i < 100; i++)
+    (void)Keylist_Data_Add(list,i,&data[i]);
+  (void)Keylist_Data_Add(list,100,&data[0]);
+  ct_test(pTest,Keylist_Count(list) == 101);
+  ct_test(pTest,Keylist_Data(list,100) == &data[0]);
+#if !defined(KEYLIST_SORTED_ARRAY) && !defined(KEYLIST_BTREE)
+  ct_test(pTest,test_chunks(list) == 2);
+#endif
+  Keylist_Delete(list);
+  list = Keylist_Create_With_Capacity(0);
+  ct_test(pTest,list != NULL);
+  ct_test(pTest,Keylist_Data_Add(list,1,&data[1]) == 0);
+  ct_test(pTest,Keylist_Data(list,1) == &data[1]);
+  Keylist_Delete(list);
+
+  return;
+}
+
 #ifdef TEST_KEYLIST
+// COV subscriptions coming and going: a list of count entries that
+// deletes one at random and adds another, over and over
+static void benchmarkKeyListChurn(int count, int capacity)
+{
+  OS_Keylist list;
+  static int data[1000];
+  unsigned seed = 19;
+  long operations = 4000000L / count;
+  double start;
+  double seconds;
+  long i;
+
+  list = capacity ? Keylist_Create_With_Capacity(count) : Keylist_Create();
+  for (i = 0; i < count; i++)
+    (void)Keylist_Data_Add(list,i * 2,&data[i]);
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < operations; i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    (void)Keylist_Data_Delete_By_Index(list,(seed >> 8) % count);
+    (void)Keylist_Data_Add(list,(seed >> 4) % (count * 2),&data[i % count]);
+  }
+  seconds = OS_MonotonicSeconds() - start;
+#if !defined(KEYLIST_SORTED_ARRAY) && !defined(KEYLIST_BTREE)
+  printf("keylist: %4d entries%s, %.1f ns a delete and add, "
+    "%d blocks of nodes taken for %ld adds\n", count,
+    capacity ? " with capacity" : "", seconds * 1.0e9 / operations,
+    test_chunks(list), count + operations);
+#else
+  printf("keylist: %4d entries%s, %.1f ns a delete and add\n", count,
+    capacity ? " with capacity" : "", seconds * 1.0e9 / operations);
+#endif
+  Keylist_Delete(list);
+
+  return;
+}
+
 int main(void)
 {
   Test *pTest;
@@ -695,6 +1033,12 @@ int main(void)
   assert(rc);
   rc = ct_addTestFunction(pTest, testKeyListDataIndex);
   assert(rc);
+  rc = ct_addTestFunction(pTest, testKeyListOrder);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testKeyListNextEmpty);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testKeyListCapacity);
+  assert(rc);
 
   ct_setStream(pTest, stdout);
   ct_run(pTest);
@@ -702,6 +1046,11 @@ int main(void)
 
   ct_destroy(pTest);
 
+  benchmarkKeyListChurn(16,0);
+  benchmarkKeyListChurn(16,1);
+  benchmarkKeyListChurn(1000,0);
+  benchmarkKeyListChurn(1000,1);
+
   return 0;
 }
 #endif /* LOCAL_TEST */
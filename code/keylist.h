@@ -39,21 +39,69 @@
 // This is a key sorted linked list data library that
 // uses a key or index to access the data.
 
+// The list is a singly linked list of nodes, which come from
+// blocks of nodes that are kept with the list.  Defining
+// KEYLIST_SORTED_ARRAY puts the same functions on the sorted
+// array of keyarray.h instead, or KEYLIST_BTREE on the B+tree
+// of keytree.h, and keylist.c is left empty.
+#if defined(KEYLIST_SORTED_ARRAY)
+#include "keyarray.h"
+typedef OS_Keyarray OS_Keylist;
+#define Keylist_Create Keyarray_Create
+#define Keylist_Create_With_Capacity Keyarray_Create_With_Capacity
+#define Keylist_Delete Keyarray_Delete
+#define Keylist_Data_Add Keyarray_Data_Add
+#define Keylist_Data_Delete Keyarray_Data_Delete
+#define Keylist_Data_Delete_By_Index Keyarray_Data_Delete_By_Index
+#define Keylist_Data_Pop Keyarray_Data_Pop
+#define Keylist_Data Keyarray_Data
+#define Keylist_Data_Index Keyarray_Data_Index
+#define Keylist_Next_Empty_Key Keyarray_Next_Empty_Key
+#define Keylist_Count Keyarray_Count
+#elif defined(KEYLIST_BTREE)
+#include "keytree.h"
+typedef OS_Keytree OS_Keylist;
+#define Keylist_Create Keytree_Create
+#define Keylist_Create_With_Capacity Keytree_Create_With_Capacity
+#define Keylist_Delete Keytree_Delete
+#define Keylist_Data_Add Keytree_Data_Add
+#define Keylist_Data_Delete Keytree_Data_Delete
+#define Keylist_Data_Delete_By_Index Keytree_Data_Delete_By_Index
+#define Keylist_Data_Pop Keytree_Data_Pop
+#define Keylist_Data Keytree_Data
+#define Keylist_Data_Index Keytree_Data_Index
+#define Keylist_Next_Empty_Key Keytree_Next_Empty_Key
+#define Keylist_Count Keytree_Count
+#else
+#include "keymap.h"
 // list data and datatype
-struct Keylist_Node;
-typedef struct Keylist_Node *OS_Keylist;
 typedef struct Keylist_Node
 {
   struct Keylist_Node *next; // points to the next node in the list
   KEY key; // unique number that is sorted in the list
   void *data; // pointer to some data that is stored
 } KEYLIST_NODE_TYPE;
+struct Keylist_Chunk;
+typedef struct Keylist
+{
+  struct Keylist_Node head; // its next is the first node
+  struct Keylist_Node *free; // nodes to use again, linked by next
+  struct Keylist_Chunk *chunk; // blocks that the nodes come from
+  int chunk_size; // nodes in the next block
+  OS_Keymap used; // keys in the list, once an empty key is asked for
+} *OS_Keylist;
+#endif
 
 // returns head of the list or NULL on failure.
 OS_Keylist Keylist_Create(void);
 
+// returns head of a list with room for capacity entries,
+// or NULL on failure.  more may be added.
+OS_Keylist Keylist_Create_With_Capacity(
+  int capacity);
+
 // delete specified list
-// note: you should pop all the nodes off the list first.
+// note: the data in the list is not freed.
 void Keylist_Delete(OS_Keylist list);
 
 // inserts a node into its sorted position
@@ -0,0 +1,491 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// Keyed Linked List Library
+//
+// This is a bitmap of the keys that are used in a keylist.
+// A key is found empty by looking at the bits of its word, then
+// the full bits of its leaf, then the full bits of its object
+// type, so at most a handful of words are read.  A leaf or a
+// type that was never allocated has every key empty.  Keys that
+// run off the end of a type go on to the next type, as adding
+// one to the key would.
+
+#include <stdlib.h>
+
+#include "keymap.h" // check for valid prototypes
+
+#define KEYMAP_ONES (~(uint64_t)0)
+
+#if defined(__GNUC__)
+#define KEYMAP_CTZ(word) __builtin_ctzll(word)
+#else
+static int KEYMAP_CTZ(uint64_t word)
+{
+  int bit = 0;
+
+  while (!(word & 1))
+  {
+    word >>= 1;
+    bit++;
+  }
+
+  return bit;
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////
+// Generic word routines
+/////////////////////////////////////////////////////////////////////
+
+// the first clear bit of word from bit on, or -1 if there is none
+static int WordNextClear(
+  uint64_t word,
+  int bit)
+{
+  if (bit >= 64)
+    return -1;
+  word = ~word & (KEYMAP_ONES << bit);
+
+  return word ? KEYMAP_CTZ(word) : -1;
+}
+
+// the first clear bit of the leaf from bit on, or -1 if there is none
+static int LeafNextClear(
+  struct Keymap_Leaf *leaf,
+  int bit)
+{
+  int word = bit / 64;
+
+  bit = WordNextClear(leaf->bits[word],bit % 64);
+  if (bit >= 0)
+    return (word * 64) + bit;
+  word = WordNextClear(leaf->full,word + 1);
+  if (word < 0)
+    return -1;
+
+  return (word * 64) + WordNextClear(leaf->bits[word],0);
+}
+
+// the first empty instance of the type from id on,
+// or -1 if there is none
+static long TypeNextClear(
+  struct Keymap_Type *type,
+  long id)
+{
+  struct Keymap_Leaf *leaf;
+  int index = id / KEYMAP_LEAF_BITS;
+  int word;
+  int bit;
+
+  leaf = type->leaf[index];
+  if (!leaf)
+    return id;
+  bit = LeafNextClear(leaf,id % KEYMAP_LEAF_BITS);
+  if (bit >= 0)
+    return ((long)index * KEYMAP_LEAF_BITS) + bit;
+  // the first leaf after it that is not full
+  index++;
+  if (index >= KEYMAP_LEAVES)
+    return -1;
+  word = index / 64;
+  bit = WordNextClear(type->full[word],index % 64);
+  if (bit < 0)
+  {
+    word = WordNextClear(type->top,word + 1);
+    if (word < 0)
+      return -1;
+    bit = WordNextClear(type->full[word],0);
+  }
+  index = (word * 64) + bit;
+  leaf = type->leaf[index];
+
+  return ((long)index * KEYMAP_LEAF_BITS) + (leaf ? LeafNextClear(leaf,0) : 0);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Map functions
+/////////////////////////////////////////////////////////////////////
+
+// returns the map or NULL on failure.
+OS_Keymap Keymap_Create(void)
+{
+  return calloc(1,sizeof(struct Keymap));
+}
+
+// delete specified map
+void Keymap_Delete(
+  OS_Keymap map)
+{
+  struct Keymap_Type *type;
+  int t, i;
+
+  if (map)
+  {
+    for (t = 0; t < KEY_TYPE_MAX; t++)
+    {
+      type = map->type[t];
+      if (type)
+      {
+        for (i = 0; i < KEYMAP_LEAVES; i++)
+          free(type->leaf[i]);
+        free(type);
+      }
+    }
+    free(map);
+  }
+
+  return;
+}
+
+// marks the key as used
+bool Keymap_Set(
+  OS_Keymap map,
+  KEY key)
+{
+  struct Keymap_Type *type;
+  struct Keymap_Leaf *leaf;
+  long id = KEY_DECODE_ID(key);
+  int index = id / KEYMAP_LEAF_BITS;
+  int word = (id % KEYMAP_LEAF_BITS) / 64;
+
+  if (!map)
+    return false;
+  type = map->type[KEY_DECODE_TYPE(key)];
+  if (!type)
+  {
+    type = calloc(1,sizeof(struct Keymap_Type));
+    if (!type)
+      return false;
+    // the bits past the last word of full never look empty
+    type->top = KEYMAP_ONES << (KEYMAP_LEAVES / 64);
+    map->type[KEY_DECODE_TYPE(key)] = type;
+  }
+  leaf = type->leaf[index];
+  if (!leaf)
+  {
+    leaf = calloc(1,sizeof(struct Keymap_Leaf));
+    if (!leaf)
+      return false;
+    type->leaf[index] = leaf;
+  }
+  leaf->bits[word] |= (uint64_t)1 << (id % 64);
+  // a full word fills in its bit above, and so on up
+  if (leaf->bits[word] == KEYMAP_ONES)
+  {
+    leaf->full |= (uint64_t)1 << word;
+    if (leaf->full == KEYMAP_ONES)
+    {
+      type->full[index / 64] |= (uint64_t)1 << (index % 64);
+      if (type->full[index / 64] == KEYMAP_ONES)
+        type->top |= (uint64_t)1 << (index / 64);
+    }
+  }
+
+  return true;
+}
+
+// marks the key as empty
+void Keymap_Clear(
+  OS_Keymap map,
+  KEY key)
+{
+  struct Keymap_Type *type;
+  struct Keymap_Leaf *leaf;
+  long id = KEY_DECODE_ID(key);
+  int index = id / KEYMAP_LEAF_BITS;
+  int word = (id % KEYMAP_LEAF_BITS) / 64;
+
+  if (map)
+  {
+    type = map->type[KEY_DECODE_TYPE(key)];
+    leaf = type ? type->leaf[index] : NULL;
+    if (leaf)
+    {
+      leaf->bits[word] &= ~((uint64_t)1 << (id % 64));
+      leaf->full &= ~((uint64_t)1 << word);
+      type->full[index / 64] &= ~((uint64_t)1 << (index % 64));
+      type->top &= ~((uint64_t)1 << (index / 64));
+    }
+  }
+
+  return;
+}
+
+// returns true if the key is used
+bool Keymap_Test(
+  OS_Keymap map,
+  KEY key)
+{
+  struct Keymap_Type *type;
+  struct Keymap_Leaf *leaf;
+  long id = KEY_DECODE_ID(key);
+
+  if (!map)
+    return false;
+  type = map->type[KEY_DECODE_TYPE(key)];
+  leaf = type ? type->leaf[id / KEYMAP_LEAF_BITS] : NULL;
+  if (!leaf)
+    return false;
+
+  return (leaf->bits[(id % KEYMAP_LEAF_BITS) / 64] >> (id % 64)) & 1;
+}
+
+// returns the first key from key on that is empty
+KEY Keymap_Next_Empty_Key(
+  OS_Keymap map,
+  KEY key)
+{
+  struct Keymap_Type *type;
+  long id;
+
+  if (map)
+  {
+    // every key in use is not possible, so this ends
+    for (;;)
+    {
+      type = map->type[KEY_DECODE_TYPE(key)];
+      if (!type)
+        break;
+      id = TypeNextClear(type,KEY_DECODE_ID(key));
+      if (id >= 0)
+      {
+        key = KEY_ENCODE(KEY_DECODE_TYPE(key),id);
+        break;
+      }
+      key = KEY_ENCODE(KEY_DECODE_TYPE(key) + 1,0);
+    }
+  }
+
+  return key;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "monotime.h"
+#include "ctest.h"
+#include "keylist.h"
+#include "keyarray.h"
+#include "keytree.h"
+
+// the edges of words, leaves and object types
+void testKeymap(Test* pTest)
+{
+  OS_Keymap map;
+  long id;
+  int ok;
+
+  map = Keymap_Create();
+  ct_test(pTest,map != NULL);
+  ct_test(pTest,Keymap_Next_Empty_Key(map,KEY_ENCODE(3,7)) ==
+    KEY_ENCODE(3,7));
+  ct_test(pTest,!Keymap_Test(map,KEY_ENCODE(3,7)));
+  for (id = 0; id < 64; id++)
+    ct_test(pTest,Keymap_Set(map,KEY_ENCODE(3,id)));
+  ct_test(pTest,Keymap_Test(map,KEY_ENCODE(3,7)));
+  ct_test(pTest,!Keymap_Test(map,KEY_ENCODE(2,7)));
+  ct_test(pTest,Keymap_Next_Empty_Key(map,KEY_ENCODE(3,0)) ==
+    KEY_ENCODE(3,64));
+  for (id = 64; id < KEYMAP_LEAF_BITS; id++)
+    (void)Keymap_Set(map,KEY_ENCODE(3,id));
+  ct_test(pTest,Keymap_Next_Empty_Key(map,KEY_ENCODE(3,0)) ==
+    KEY_ENCODE(3,KEYMAP_LEAF_BITS));
+  (void)Keymap_Set(map,KEY_ENCODE(3,KEYMAP_LEAF_BITS));
+  ct_test(pTest,Keymap_Next_Empty_Key(map,KEY_ENCODE(3,0)) ==
+    KEY_ENCODE(3,KEYMAP_LEAF_BITS + 1));
+  Keymap_Clear(map,KEY_ENCODE(3,100));
+  ct_test(pTest,Keymap_Next_Empty_Key(map,KEY_ENCODE(3,0)) ==
+    KEY_ENCODE(3,100));
+  ct_test(pTest,Keymap_Next_Empty_Key(map,KEY_ENCODE(3,101)) ==
+    KEY_ENCODE(3,KEYMAP_LEAF_BITS + 1));
+  Keymap_Clear(map,KEY_ENCODE(7,100));
+  ct_test(pTest,Keymap_Next_Empty_Key(map,KEY_ENCODE(7,100)) ==
+    KEY_ENCODE(7,100));
+
+  // a whole object type goes on to the next one
+  for (id = 0; id < KEY_ID_MAX; id++)
+    (void)Keymap_Set(map,KEY_ENCODE(5,id));
+  ct_test(pTest,Keymap_Next_Empty_Key(map,KEY_ENCODE(5,0)) ==
+    KEY_ENCODE(6,0));
+  ct_test(pTest,Keymap_Next_Empty_Key(map,KEY_ENCODE(5,KEY_ID_MAX - 1)) ==
+    KEY_ENCODE(6,0));
+  (void)Keymap_Set(map,KEY_ENCODE(6,0));
+  ct_test(pTest,Keymap_Next_Empty_Key(map,KEY_ENCODE(5,12345)) ==
+    KEY_ENCODE(6,1));
+  Keymap_Clear(map,KEY_ENCODE(5,3000000));
+  ct_test(pTest,Keymap_Next_Empty_Key(map,KEY_ENCODE(5,12345)) ==
+    KEY_ENCODE(5,3000000));
+  ok = 1;
+  for (id = 0; id < KEY_ID_MAX; id++)
+    ok &= (Keymap_Test(map,KEY_ENCODE(5,id)) == (id != 3000000));
+  ct_test(pTest,ok);
+  Keymap_Delete(map);
+
+  return;
+}
+
+// random keys across the edges of leaves, against a plain array
+void testKeymapRandom(Test* pTest)
+{
+  OS_Keymap map;
+  static uint8_t used[3 * KEYMAP_LEAF_BITS];
+  const KEY base = KEY_ENCODE(9,KEY_ID_MAX - (2 * KEYMAP_LEAF_BITS));
+  unsigned seed = 11;
+  KEY key;
+  KEY empty;
+  long range;
+  long i;
+  int same = 1;
+
+  map = Keymap_Create();
+  memset(used,0,sizeof(used));
+  for (i = 0; i < 400000; i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    // runs of used keys grow, and are then broken up
+    range = (i < 200000) ? (long)sizeof(used) : 256;
+    key = (seed >> 8) % range;
+    if (((seed >> 4) & 3) || (i < 100000))
+    {
+      used[key] = 1;
+      (void)Keymap_Set(map,base + key);
+    }
+    else
+    {
+      used[key] = 0;
+      Keymap_Clear(map,base + key);
+    }
+    seed = seed * 1103515245 + 12345;
+    key = (seed >> 8) % sizeof(used);
+    for (empty = key; (empty < sizeof(used)) && used[empty]; empty++)
+      ;
+    // past the end of the keys tested, the next type is empty
+    same &= (Keymap_Next_Empty_Key(map,base + key) == (base + empty));
+    same &= (Keymap_Test(map,base + key) == used[key]);
+  }
+  ct_test(pTest,same);
+  Keymap_Delete(map);
+
+  return;
+}
+
+#ifdef TEST_KEYMAP
+// provisions count objects of one type by asking for the next empty
+// instance from zero, deletes every tenth of them, and provisions
+// them again, then asks for the next empty instance from each of
+// them in turn
+#define BENCHMARK_PROVISION(create,add,remove,next,table,seconds) \
+  do { \
+    table = create(); \
+    start = OS_MonotonicSeconds(); \
+    for (i = 0; i < count; i++) \
+      (void)add(table,next(table,first),&data[i]); \
+    for (i = 0; i < count; i += 10) \
+      (void)remove(table,first + i); \
+    for (i = 0; i < count; i += 10) \
+      (void)add(table,next(table,first),&data[i]); \
+    seconds[0] = OS_MonotonicSeconds() - start; \
+    start = OS_MonotonicSeconds(); \
+    for (i = 0; i < count; i++) \
+      sum += next(table,first + i); \
+    seconds[1] = OS_MonotonicSeconds() - start; \
+  } while (0)
+
+static void benchmarkKeymap(int count, int with_list)
+{
+  OS_Keylist list;
+  OS_Keyarray array;
+  OS_Keytree tree;
+  static int data[100000];
+  const KEY first = KEY_ENCODE(8,0);
+  unsigned long sum = 0;
+  double start;
+  double list_seconds[2] = {0, 0};
+  double array_seconds[2];
+  double tree_seconds[2];
+  int i;
+
+  if (with_list)
+  {
+    BENCHMARK_PROVISION(Keylist_Create,Keylist_Data_Add,Keylist_Data_Delete,
+      Keylist_Next_Empty_Key,list,list_seconds);
+    while (Keylist_Data_Pop(list))
+      ;
+    Keylist_Delete(list);
+  }
+  BENCHMARK_PROVISION(Keyarray_Create,Keyarray_Data_Add,Keyarray_Data_Delete,
+    Keyarray_Next_Empty_Key,array,array_seconds);
+  Keyarray_Delete(array);
+  BENCHMARK_PROVISION(Keytree_Create,Keytree_Data_Add,Keytree_Data_Delete,
+    Keytree_Next_Empty_Key,tree,tree_seconds);
+  Keytree_Delete(tree);
+
+  printf("keymap: %6d objects, list/array/tree: provision %.2f/%.2f/%.2f ms, "
+    "Next_Empty_Key %.1f/%.1f/%.1f ns (%lu)\n", count,
+    list_seconds[0] * 1.0e3, array_seconds[0] * 1.0e3,
+    tree_seconds[0] * 1.0e3, list_seconds[1] * 1.0e9 / count,
+    array_seconds[1] * 1.0e9 / count, tree_seconds[1] * 1.0e9 / count,
+    sum);
+
+  return;
+}
+
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("keymap", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testKeymap);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testKeymapRandom);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  benchmarkKeymap(1000,1);
+  benchmarkKeymap(5000,1);
+  benchmarkKeymap(100000,0);
+
+  return 0;
+}
+#endif /* TEST_KEYMAP */
+#endif /* TEST */
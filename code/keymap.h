@@ -0,0 +1,100 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330 
+ Boston, MA  02111-1307, USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef KEYMAP_H
+#define KEYMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "key.h"
+
+// This is a bitmap of the keys that are in use, kept beside a
+// keylist so that the next empty key is found without a walk.
+// Each object type has its own bitmap over the instances, in
+// leaves of KEYMAP_LEAF_BITS keys that are allocated as they are
+// used.  Above the bits are bitmaps of the full words and of the
+// full leaves, so finding a clear bit looks at a few words.
+
+// instances in a leaf
+#define KEYMAP_LEAF_BITS 4096
+#define KEYMAP_LEAF_WORDS (KEYMAP_LEAF_BITS / 64)
+// leaves of one object type
+#define KEYMAP_LEAVES (KEY_ID_MAX / KEYMAP_LEAF_BITS)
+
+struct Keymap_Leaf
+{
+  uint64_t bits[KEYMAP_LEAF_WORDS]; // a bit for each key in use
+  uint64_t full; // a bit for each word of bits that is all ones
+};
+
+struct Keymap_Type
+{
+  struct Keymap_Leaf *leaf[KEYMAP_LEAVES]; // NULL when no key is used
+  uint64_t full[KEYMAP_LEAVES / 64]; // a bit for each full leaf
+  uint64_t top; // a bit for each word of full that is all ones
+};
+
+typedef struct Keymap
+{
+  struct Keymap_Type *type[KEY_TYPE_MAX]; // NULL when no key is used
+} *OS_Keymap;
+
+// returns the map or NULL on failure.
+OS_Keymap Keymap_Create(void);
+
+// delete specified map
+void Keymap_Delete(OS_Keymap map);
+
+// marks the key as used
+// returns false if there is no memory for it
+bool Keymap_Set(
+  OS_Keymap map,
+  KEY key);
+
+// marks the key as empty
+void Keymap_Clear(
+  OS_Keymap map,
+  KEY key);
+
+// returns true if the key is used
+bool Keymap_Test(
+  OS_Keymap map,
+  KEY key);
+
+// returns the first key from key on that is empty
+KEY Keymap_Next_Empty_Key(
+  OS_Keymap map,
+  KEY key);
+
+#endif
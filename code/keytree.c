@@ -0,0 +1,1213 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// Keyed Linked List Library
+//
+// This is a B+tree with the same functions as the keylist.
+// The entries are in the leaves, and each branch holds the
+// smallest key and the number of entries under each of its
+// children, so a key or an index is found in one pass down.
+// A node that falls below half full takes an entry from its
+// neighbor, or is merged into it.  Nodes that leave the tree are
+// kept for the next split, and freed with the tree.
+//
+// The keys of a node are always in order, and every key under
+// a child is at least its key in the branch and at most the
+// key of the next child, which holds when keys are the same.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "keytree.h" // check for valid prototypes
+
+#if KEYTREE_ORDER < 4
+#error "a node needs room for at least four entries"
+#endif
+
+// nodes start on a cache line
+#define KEYTREE_CACHE_LINE 64
+// fewest entries or children of a node that is not the root
+#define KEYTREE_MIN (KEYTREE_ORDER / 2)
+// more levels than 2^31 entries can fill, at the smallest order
+#define KEYTREE_HEIGHT_MAX 32
+// octets of a spare node, which may become a leaf or a branch
+#define KEYTREE_NODE_SIZE \
+  ((sizeof(struct Keytree_Leaf) > sizeof(struct Keytree_Branch)) ? \
+  sizeof(struct Keytree_Leaf) : sizeof(struct Keytree_Branch))
+
+// the nodes that an insert will split into, taken before it starts
+// so that it cannot fail half done
+struct Keytree_Spares
+{
+  void *node[KEYTREE_HEIGHT_MAX + 2];
+  int count;
+};
+
+/////////////////////////////////////////////////////////////////////
+// Generic node routines
+/////////////////////////////////////////////////////////////////////
+
+// takes a node from the spare nodes of the tree, or grabs memory
+// for one.  every node has room for a leaf or a branch.
+static void *NodeCreate(
+  OS_Keytree tree)
+{
+  void *node = tree->spare;
+
+  if (node)
+    tree->spare = *(void **)node;
+  else if (posix_memalign(&node,KEYTREE_CACHE_LINE,KEYTREE_NODE_SIZE) != 0)
+    return NULL;
+  memset(node,0,KEYTREE_NODE_SIZE);
+
+  return node;
+}
+
+// keeps a node that has left the tree for the next split
+static void NodeRelease(
+  OS_Keytree tree,
+  void *node)
+{
+  *(void **)node = tree->spare;
+  tree->spare = node;
+
+  return;
+}
+
+// takes a spare node for a split
+static void *NodeSpare(
+  struct Keytree_Spares *spares,
+  size_t size)
+{
+  void *node = spares->node[--spares->count];
+
+  memset(node,0,size);
+
+  return node;
+}
+
+// the first key in the node that is not less than key
+static int NodeLowerBound(
+  const KEY *keys,
+  int first,
+  int count,
+  KEY key)
+{
+  while ((first < count) && (keys[first] < key))
+    first++;
+
+  return first;
+}
+
+// the first key in the node that is more than key
+static int NodeUpperBound(
+  const KEY *keys,
+  int first,
+  int count,
+  KEY key)
+{
+  while ((first < count) && (keys[first] <= key))
+    first++;
+
+  return first;
+}
+
+// the entries under a child
+static int NodeSize(
+  void *node,
+  int height)
+{
+  struct Keytree_Branch *branch = node;
+  int size = 0;
+  int i;
+
+  if (height == 0)
+    return ((struct Keytree_Leaf *)node)->count;
+  for (i = 0; i < branch->count; i++)
+    size += branch->size[i];
+
+  return size;
+}
+
+// frees a node and all of the nodes under it
+static void NodeFree(
+  void *node,
+  int height)
+{
+  struct Keytree_Branch *branch = node;
+  int i;
+
+  if (height)
+  {
+    for (i = 0; i < branch->count; i++)
+      NodeFree(branch->child[i],height - 1);
+  }
+  free(node);
+
+  return;
+}
+
+// inserts the entry into the leaf after any with the same key,
+// and returns the new leaf to its right if it had to be split
+static struct Keytree_Leaf *LeafInsert(
+  OS_Keytree tree,
+  struct Keytree_Leaf *leaf,
+  KEY key,
+  void *data,
+  int *index,
+  struct Keytree_Spares *spares)
+{
+  struct Keytree_Leaf *right = NULL;
+  int position;
+
+  position = NodeUpperBound(leaf->key,0,leaf->count,key);
+  *index = position;
+  if (leaf->count == KEYTREE_ORDER)
+  {
+    right = NodeSpare(spares,sizeof(struct Keytree_Leaf));
+    // the upper half moves to the new leaf
+    right->count = KEYTREE_ORDER - KEYTREE_MIN;
+    memcpy(right->key,&leaf->key[KEYTREE_MIN],right->count * sizeof(KEY));
+    memcpy(right->data,&leaf->data[KEYTREE_MIN],right->count * sizeof(void *));
+    leaf->count = KEYTREE_MIN;
+    right->next = leaf->next;
+    right->prev = leaf;
+    if (leaf->next)
+      leaf->next->prev = right;
+    else
+      tree->last = right;
+    leaf->next = right;
+    if (position > KEYTREE_MIN)
+    {
+      leaf = right;
+      position -= KEYTREE_MIN;
+    }
+  }
+  memmove(&leaf->key[position + 1],&leaf->key[position],
+    (leaf->count - position) * sizeof(KEY));
+  memmove(&leaf->data[position + 1],&leaf->data[position],
+    (leaf->count - position) * sizeof(void *));
+  leaf->key[position] = key;
+  leaf->data[position] = data;
+  leaf->count++;
+
+  return right;
+}
+
+// puts a new child to the right of child c of the branch, which
+// must have room for it
+static void BranchInsertChild(
+  struct Keytree_Branch *branch,
+  int c,
+  void *child,
+  KEY key,
+  int size)
+{
+  int position = c + 1;
+  int moved = branch->count - position;
+
+  memmove(&branch->key[position + 1],&branch->key[position],
+    moved * sizeof(KEY));
+  memmove(&branch->child[position + 1],&branch->child[position],
+    moved * sizeof(void *));
+  memmove(&branch->size[position + 1],&branch->size[position],
+    moved * sizeof(int));
+  branch->key[position] = key;
+  branch->child[position] = child;
+  branch->size[position] = size;
+  branch->count++;
+
+  return;
+}
+
+// inserts the entry under the node, and returns the new node to
+// its right, with the smallest key under it, if it had to be split
+static void *NodeInsert(
+  OS_Keytree tree,
+  void *node,
+  int height,
+  KEY key,
+  void *data,
+  int *index,
+  KEY *split_key,
+  struct Keytree_Spares *spares)
+{
+  struct Keytree_Branch *branch = node;
+  struct Keytree_Branch *right;
+  void *child;
+  int before = 0;
+  int size;
+  int c;
+  int i;
+
+  if (height == 0)
+  {
+    child = LeafInsert(tree,node,key,data,index,spares);
+    if (child)
+      *split_key = ((struct Keytree_Leaf *)child)->key[0];
+    return child;
+  }
+  // the last child whose smallest key is not more than key
+  c = NodeUpperBound(branch->key,1,branch->count,key) - 1;
+  for (i = 0; i < c; i++)
+    before += branch->size[i];
+  child = NodeInsert(tree,branch->child[c],height - 1,key,data,index,
+    split_key,spares);
+  *index += before;
+  branch->size[c]++;
+  if (!child)
+    return NULL;
+  size = NodeSize(child,height - 1);
+  branch->size[c] -= size;
+  if (branch->count < KEYTREE_ORDER)
+  {
+    BranchInsertChild(branch,c,child,*split_key,size);
+    return NULL;
+  }
+  right = NodeSpare(spares,sizeof(struct Keytree_Branch));
+  // the upper half moves to the new branch
+  right->count = KEYTREE_ORDER - KEYTREE_MIN;
+  memcpy(right->key,&branch->key[KEYTREE_MIN],right->count * sizeof(KEY));
+  memcpy(right->child,&branch->child[KEYTREE_MIN],
+    right->count * sizeof(void *));
+  memcpy(right->size,&branch->size[KEYTREE_MIN],right->count * sizeof(int));
+  branch->count = KEYTREE_MIN;
+  if (c < KEYTREE_MIN)
+    BranchInsertChild(branch,c,child,*split_key,size);
+  else
+    BranchInsertChild(right,c - KEYTREE_MIN,child,*split_key,size);
+  *split_key = right->key[0];
+
+  return right;
+}
+
+// removes the entry at index from the leaf and returns its data
+static void *LeafRemove(
+  struct Keytree_Leaf *leaf,
+  int index)
+{
+  void *data = leaf->data[index];
+
+  leaf->count--;
+  memmove(&leaf->key[index],&leaf->key[index + 1],
+    (leaf->count - index) * sizeof(KEY));
+  memmove(&leaf->data[index],&leaf->data[index + 1],
+    (leaf->count - index) * sizeof(void *));
+
+  return data;
+}
+
+// removes child c, with its key and size, from the branch
+static void BranchRemoveChild(
+  struct Keytree_Branch *branch,
+  int c)
+{
+  int moved = branch->count - c - 1;
+
+  memmove(&branch->key[c],&branch->key[c + 1],moved * sizeof(KEY));
+  memmove(&branch->child[c],&branch->child[c + 1],moved * sizeof(void *));
+  memmove(&branch->size[c],&branch->size[c + 1],moved * sizeof(int));
+  branch->count--;
+
+  return;
+}
+
+// brings child c of the branch back to half full, from the
+// neighbor on its left or its right, which are leaves when
+// height is one
+static void BranchRebalance(
+  OS_Keytree tree,
+  struct Keytree_Branch *branch,
+  int height,
+  int c)
+{
+  struct Keytree_Leaf *left_leaf, *right_leaf;
+  struct Keytree_Branch *left, *right;
+  int i;
+  int moved;
+
+  // the pair of children i and i + 1, one of which is short
+  i = (c > 0) ? (c - 1) : c;
+  if (height == 1)
+  {
+    left_leaf = branch->child[i];
+    right_leaf = branch->child[i + 1];
+    if ((left_leaf->count + right_leaf->count) <= KEYTREE_ORDER)
+    {
+      memcpy(&left_leaf->key[left_leaf->count],right_leaf->key,
+        right_leaf->count * sizeof(KEY));
+      memcpy(&left_leaf->data[left_leaf->count],right_leaf->data,
+        right_leaf->count * sizeof(void *));
+      left_leaf->count += right_leaf->count;
+      left_leaf->next = right_leaf->next;
+      if (right_leaf->next)
+        right_leaf->next->prev = left_leaf;
+      else
+        tree->last = left_leaf;
+      branch->size[i] += branch->size[i + 1];
+      BranchRemoveChild(branch,i + 1);
+      NodeRelease(tree,right_leaf);
+    }
+    else if (left_leaf->count > right_leaf->count)
+    {
+      // the last entry on the left moves to the right
+      memmove(&right_leaf->key[1],right_leaf->key,
+        right_leaf->count * sizeof(KEY));
+      memmove(&right_leaf->data[1],right_leaf->data,
+        right_leaf->count * sizeof(void *));
+      left_leaf->count--;
+      right_leaf->key[0] = left_leaf->key[left_leaf->count];
+      right_leaf->data[0] = left_leaf->data[left_leaf->count];
+      right_leaf->count++;
+      branch->key[i + 1] = right_leaf->key[0];
+      branch->size[i]--;
+      branch->size[i + 1]++;
+    }
+    else
+    {
+      // the first entry on the right moves to the left
+      left_leaf->key[left_leaf->count] = right_leaf->key[0];
+      left_leaf->data[left_leaf->count] = right_leaf->data[0];
+      left_leaf->count++;
+      (void)LeafRemove(right_leaf,0);
+      branch->key[i + 1] = right_leaf->key[0];
+      branch->size[i]++;
+      branch->size[i + 1]--;
+    }
+    return;
+  }
+  left = branch->child[i];
+  right = branch->child[i + 1];
+  if ((left->count + right->count) <= KEYTREE_ORDER)
+  {
+    // the smallest key under the right is the one in this branch
+    right->key[0] = branch->key[i + 1];
+    memcpy(&left->key[left->count],right->key,right->count * sizeof(KEY));
+    memcpy(&left->child[left->count],right->child,
+      right->count * sizeof(void *));
+    memcpy(&left->size[left->count],right->size,right->count * sizeof(int));
+    left->count += right->count;
+    branch->size[i] += branch->size[i + 1];
+    BranchRemoveChild(branch,i + 1);
+    NodeRelease(tree,right);
+  }
+  else if (left->count > right->count)
+  {
+    // the last child on the left moves to the right
+    right->key[0] = branch->key[i + 1];
+    // opens a place in front of the first child
+    BranchInsertChild(right,-1,NULL,0,0);
+    left->count--;
+    right->child[0] = left->child[left->count];
+    right->size[0] = left->size[left->count];
+    branch->key[i + 1] = left->key[left->count];
+    moved = right->size[0];
+    branch->size[i] -= moved;
+    branch->size[i + 1] += moved;
+  }
+  else
+  {
+    // the first child on the right moves to the left
+    left->key[left->count] = branch->key[i + 1];
+    left->child[left->count] = right->child[0];
+    left->size[left->count] = right->size[0];
+    left->count++;
+    moved = right->size[0];
+    branch->key[i + 1] = right->key[1];
+    BranchRemoveChild(right,0);
+    branch->size[i] += moved;
+    branch->size[i + 1] -= moved;
+  }
+
+  return;
+}
+
+// removes the entry at index under the node and returns its data
+static void *NodeRemove(
+  OS_Keytree tree,
+  void *node,
+  int height,
+  int index)
+{
+  struct Keytree_Branch *branch = node;
+  void *data;
+  int c = 0;
+
+  if (height == 0)
+    return LeafRemove(node,index);
+  while (index >= branch->size[c])
+  {
+    index -= branch->size[c];
+    c++;
+  }
+  data = NodeRemove(tree,branch->child[c],height - 1,index);
+  branch->size[c]--;
+  if ((height == 1) ?
+      (((struct Keytree_Leaf *)branch->child[c])->count < KEYTREE_MIN) :
+      (((struct Keytree_Branch *)branch->child[c])->count < KEYTREE_MIN))
+    BranchRebalance(tree,branch,height,c);
+
+  return data;
+}
+
+// the leaf and the place in it of the first entry whose key is not
+// less than key, and returns the index of that entry
+static int TreeLowerBound(
+  OS_Keytree tree,
+  KEY key,
+  struct Keytree_Cursor *cursor)
+{
+  struct Keytree_Branch *branch;
+  void *node = tree->root;
+  int height = tree->height;
+  int index = 0;
+  int c;
+  int i;
+
+  while (height)
+  {
+    branch = node;
+    // the last child whose smallest key is less than key
+    c = NodeLowerBound(branch->key,1,branch->count,key) - 1;
+    for (i = 0; i < c; i++)
+      index += branch->size[i];
+    node = branch->child[c];
+    height--;
+  }
+  cursor->leaf = node;
+  cursor->index = NodeLowerBound(cursor->leaf->key,0,cursor->leaf->count,key);
+  index += cursor->index;
+  // the first entry of the next leaf, if every key here is less
+  if ((cursor->index == cursor->leaf->count) && cursor->leaf->next)
+  {
+    cursor->leaf = cursor->leaf->next;
+    cursor->index = 0;
+  }
+
+  return index;
+}
+
+// the leaf of the entry at index, which becomes its place in the leaf
+static struct Keytree_Leaf *TreeByIndex(
+  OS_Keytree tree,
+  int *index)
+{
+  struct Keytree_Branch *branch;
+  void *node = tree->root;
+  int height;
+  int c;
+
+  for (height = tree->height; height; height--)
+  {
+    branch = node;
+    for (c = 0; *index >= branch->size[c]; c++)
+      *index -= branch->size[c];
+    node = branch->child[c];
+  }
+
+  return node;
+}
+
+// builds the map of the keys in the tree
+// returns NULL on failure
+static OS_Keymap TreeKeymap(
+  OS_Keytree tree)
+{
+  OS_Keymap map;
+  struct Keytree_Leaf *leaf;
+  int i;
+
+  map = Keymap_Create();
+  for (leaf = tree->first; map && leaf; leaf = leaf->next)
+  {
+    for (i = 0; map && (i < leaf->count); i++)
+    {
+      if (!Keymap_Set(map,leaf->key[i]))
+      {
+        Keymap_Delete(map);
+        map = NULL;
+      }
+    }
+  }
+
+  return map;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Tree functions
+/////////////////////////////////////////////////////////////////////
+
+// returns the tree or NULL on failure.
+OS_Keytree Keytree_Create(void)
+{
+  OS_Keytree tree;
+
+  tree = calloc(1,sizeof(struct Keytree));
+  if (tree)
+  {
+    tree->root = NodeCreate(tree);
+    if (!tree->root)
+    {
+      free(tree);
+      return NULL;
+    }
+    tree->first = tree->root;
+    tree->last = tree->root;
+  }
+
+  return tree;
+}
+
+// returns a tree with spare nodes for capacity entries,
+// or NULL on failure.
+OS_Keytree Keytree_Create_With_Capacity(
+  int capacity)
+{
+  OS_Keytree tree;
+  void *node;
+  int count;
+
+  tree = Keytree_Create();
+  // leaves half full, and the branches over them, are one node
+  // for each KEYTREE_MIN - 1 entries
+  for (count = capacity / (KEYTREE_MIN - 1); tree && (count > 0); count--)
+  {
+    node = NodeCreate(tree);
+    if (!node)
+    {
+      Keytree_Delete(tree);
+      return NULL;
+    }
+    NodeRelease(tree,node);
+  }
+
+  return tree;
+}
+
+// delete specified tree and all of its nodes
+void Keytree_Delete(
+  OS_Keytree tree)
+{
+  void *node;
+
+  if (tree)
+  {
+    NodeFree(tree->root,tree->height);
+    while (tree->spare)
+    {
+      node = tree->spare;
+      tree->spare = *(void **)node;
+      free(node);
+    }
+    Keymap_Delete(tree->used);
+    free(tree);
+  }
+
+  return;
+}
+
+// inserts the data after any entries with the same key
+int Keytree_Data_Add(
+  OS_Keytree tree,
+  KEY key,
+  void *data)
+{
+  struct Keytree_Spares spares;
+  struct Keytree_Branch *branch;
+  void *node;
+  void *right;
+  KEY split_key = 0;
+  int index = -1;
+  int height;
+  int full = 0;
+  int c;
+
+  if (!tree)
+    return -1;
+  // the full nodes just above the leaf, which will split, and a new
+  // root if they go all the way up
+  node = tree->root;
+  for (height = tree->height; height; height--)
+  {
+    branch = node;
+    full = (branch->count == KEYTREE_ORDER) ? (full + 1) : 0;
+    c = NodeUpperBound(branch->key,1,branch->count,key) - 1;
+    node = branch->child[c];
+  }
+  full = (((struct Keytree_Leaf *)node)->count == KEYTREE_ORDER) ?
+    (full + 1) : 0;
+  if (full == (tree->height + 1))
+    full++;
+  if ((tree->height + (full > tree->height)) >= KEYTREE_HEIGHT_MAX)
+    return -1;
+  for (spares.count = 0; spares.count < full; spares.count++)
+  {
+    spares.node[spares.count] = NodeCreate(tree);
+    if (!spares.node[spares.count])
+    {
+      while (spares.count)
+        NodeRelease(tree,spares.node[--spares.count]);
+      return -1;
+    }
+  }
+  right = NodeInsert(tree,tree->root,tree->height,key,data,&index,
+    &split_key,&spares);
+  if (right)
+  {
+    branch = NodeSpare(&spares,sizeof(struct Keytree_Branch));
+    branch->count = 2;
+    branch->child[0] = tree->root;
+    branch->child[1] = right;
+    branch->key[1] = split_key;
+    branch->size[1] = NodeSize(right,tree->height);
+    branch->size[0] = tree->count + 1 - branch->size[1];
+    tree->root = branch;
+    tree->height++;
+  }
+  tree->count++;
+  // without room for the key, the map is made again when needed
+  if (tree->used && !Keymap_Set(tree->used,key))
+  {
+    Keymap_Delete(tree->used);
+    tree->used = NULL;
+  }
+
+  return index;
+}
+
+// deletes the first entry with the key
+// returns the data from the entry
+void *Keytree_Data_Delete(
+  OS_Keytree tree,
+  KEY key)
+{
+  struct Keytree_Cursor cursor;
+  int index;
+
+  if (!tree)
+    return NULL;
+  index = TreeLowerBound(tree,key,&cursor);
+  if ((cursor.index >= cursor.leaf->count) ||
+      (cursor.leaf->key[cursor.index] != key))
+    return NULL;
+
+  return Keytree_Data_Delete_By_Index(tree,index);
+}
+
+// deletes an entry specified by its index
+// returns the data from the entry
+void *Keytree_Data_Delete_By_Index(
+  OS_Keytree tree,
+  int index)
+{
+  struct Keytree_Branch *branch;
+  struct Keytree_Leaf *leaf;
+  struct Keytree_Cursor cursor;
+  KEY key = 0;
+  int i = index;
+  void *data;
+
+  if (!tree || (index < 0) || (index >= tree->count))
+    return NULL;
+  if (tree->used)
+  {
+    leaf = TreeByIndex(tree,&i);
+    key = leaf->key[i];
+  }
+  data = NodeRemove(tree,tree->root,tree->height,index);
+  tree->count--;
+  // a root with one child gives way to it
+  branch = tree->root;
+  if (tree->height && (branch->count == 1))
+  {
+    tree->root = branch->child[0];
+    tree->height--;
+    NodeRelease(tree,branch);
+  }
+  // the key is empty unless another entry has it
+  if (tree->used)
+  {
+    (void)TreeLowerBound(tree,key,&cursor);
+    if ((cursor.index >= cursor.leaf->count) ||
+        (cursor.leaf->key[cursor.index] != key))
+      Keymap_Clear(tree->used,key);
+  }
+
+  return data;
+}
+
+// returns the data from the first entry, and removes it
+void *Keytree_Data_Pop(
+  OS_Keytree tree)
+{
+  return Keytree_Data_Delete_By_Index(tree,0);
+}
+
+// returns the data from the first entry with the key
+void *Keytree_Data(
+  OS_Keytree tree,
+  KEY key)
+{
+  struct Keytree_Cursor cursor;
+
+  if (!tree)
+    return NULL;
+  (void)TreeLowerBound(tree,key,&cursor);
+  if ((cursor.index >= cursor.leaf->count) ||
+      (cursor.leaf->key[cursor.index] != key))
+    return NULL;
+
+  return cursor.leaf->data[cursor.index];
+}
+
+// returns the data specified by index
+void *Keytree_Data_Index(
+  OS_Keytree tree,
+  int index)
+{
+  struct Keytree_Leaf *leaf;
+
+  if (!tree || (index < 0) || (index >= tree->count))
+    return NULL;
+  leaf = TreeByIndex(tree,&index);
+
+  return leaf->data[index];
+}
+
+// returns the first key from key on that is not in the tree
+int Keytree_Next_Empty_Key(
+  OS_Keytree tree,
+  KEY key)
+{
+  struct Keytree_Cursor cursor;
+  KEY next;
+
+  if (tree)
+  {
+    // the map is only kept for the trees that use it
+    if (!tree->used)
+      tree->used = TreeKeymap(tree);
+    if (tree->used)
+      return Keymap_Next_Empty_Key(tree->used,key);
+    // the keys that follow key one after another are in use
+    Keytree_Cursor_Seek(tree,key,&cursor);
+    while (Keytree_Cursor_Next(&cursor,&next,NULL) && (next <= key))
+    {
+      if (next == key)
+        key++;
+    }
+  }
+
+  return key;
+}
+
+// returns the number of entries in the tree
+int Keytree_Count(
+  OS_Keytree tree)
+{
+  return tree ? tree->count : 0;
+}
+
+// places the cursor at the first entry whose key is not less than key
+void Keytree_Cursor_Seek(
+  OS_Keytree tree,
+  KEY key,
+  struct Keytree_Cursor *cursor)
+{
+  if (tree)
+    (void)TreeLowerBound(tree,key,cursor);
+  else
+  {
+    cursor->leaf = NULL;
+    cursor->index = 0;
+  }
+
+  return;
+}
+
+// reads the entry at the cursor and moves past it
+int Keytree_Cursor_Next(
+  struct Keytree_Cursor *cursor,
+  KEY *key,
+  void **data)
+{
+  struct Keytree_Leaf *leaf = cursor->leaf;
+
+  // an empty leaf is only ever the root
+  while (leaf && (cursor->index >= leaf->count))
+  {
+    leaf = leaf->next;
+    cursor->leaf = leaf;
+    cursor->index = 0;
+  }
+  if (!leaf)
+    return 0;
+  if (key)
+    *key = leaf->key[cursor->index];
+  if (data)
+    *data = leaf->data[cursor->index];
+  cursor->index++;
+
+  return 1;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+
+#include "monotime.h"
+#include "ctest.h"
+#include "keyarray.h"
+
+// the object type that the tests scan for, an analog input
+#define OBJECT_TYPE_TEST 0
+
+// checks the order, the sizes and the fill of every node under node,
+// and returns the entries under it
+static int test_check(
+  Test* pTest,
+  OS_Keytree tree,
+  void *node,
+  int height,
+  KEY low,
+  KEY high,
+  struct Keytree_Leaf **leaf)
+{
+  struct Keytree_Branch *branch = node;
+  struct Keytree_Leaf *this_leaf = node;
+  int size = 0;
+  int ok = 1;
+  int i;
+
+  if (height == 0)
+  {
+    // the leaves come in the order of their links
+    ok &= (this_leaf->prev == *leaf);
+    ok &= (!*leaf || ((*leaf)->next == this_leaf));
+    *leaf = this_leaf;
+    ok &= ((node == tree->root) || (this_leaf->count >= KEYTREE_MIN));
+    for (i = 0; i < this_leaf->count; i++)
+    {
+      ok &= (this_leaf->key[i] >= low) && (this_leaf->key[i] <= high);
+      ok &= ((i == 0) || (this_leaf->key[i - 1] <= this_leaf->key[i]));
+    }
+    ct_test(pTest,ok);
+    return this_leaf->count;
+  }
+  ok &= ((node == tree->root) ? (branch->count >= 2) :
+    (branch->count >= KEYTREE_MIN));
+  ok &= (branch->count <= KEYTREE_ORDER);
+  for (i = 0; i < branch->count; i++)
+  {
+    ok &= ((i == 0) || (branch->key[i] >= low));
+    ok &= ((i == 0) || (branch->key[i] <= high));
+    ok &= ((i < 2) || (branch->key[i - 1] <= branch->key[i]));
+    ok &= (branch->size[i] == test_check(pTest,tree,branch->child[i],
+      height - 1,(i == 0) ? low : branch->key[i],
+      (i == (branch->count - 1)) ? high : branch->key[i + 1],leaf));
+    size += branch->size[i];
+  }
+  ct_test(pTest,ok);
+
+  return size;
+}
+
+static void test_tree(
+  Test* pTest,
+  OS_Keytree tree)
+{
+  struct Keytree_Leaf *leaf = NULL;
+
+  ct_test(pTest,test_check(pTest,tree,tree->root,tree->height,0,
+    0xFFFFFFFFU,&leaf) == tree->count);
+  ct_test(pTest,leaf == tree->last);
+  ct_test(pTest,tree->first->prev == NULL);
+  ct_test(pTest,tree->last->next == NULL);
+
+  return;
+}
+
+// the tree and the sorted array give the same answers to the same
+// calls, and the tree stays balanced
+void testKeyTreeArray(Test* pTest)
+{
+  OS_Keytree tree;
+  OS_Keyarray array;
+  static int data[40000];
+  unsigned seed = 3;
+  KEY key;
+  int same = 1;
+  int i;
+
+  tree = Keytree_Create();
+  array = Keyarray_Create();
+  ct_test(pTest,tree != NULL);
+  for (i = 0; i < 40000; i++)
+  {
+    data[i] = i;
+    seed = seed * 1103515245 + 12345;
+    key = (seed >> 16) % ((i < 20000) ? 3000 : 300);
+    switch ((seed >> 8) % ((i < 20000) ? 8 : 3))
+    {
+      case 0:
+        same &= (Keytree_Data_Delete(tree,key) ==
+          Keyarray_Data_Delete(array,key));
+        break;
+      case 1:
+        same &= (Keytree_Data_Delete_By_Index(tree,key) ==
+          Keyarray_Data_Delete_By_Index(array,key));
+        break;
+      case 2:
+        same &= (Keytree_Data_Pop(tree) == Keyarray_Data_Pop(array));
+        break;
+      case 3:
+        same &= (Keytree_Next_Empty_Key(tree,key) ==
+          Keyarray_Next_Empty_Key(array,key));
+        break;
+      default:
+        same &= (Keytree_Data_Add(tree,key,&data[i]) ==
+          Keyarray_Data_Add(array,key,&data[i]));
+        break;
+    }
+    same &= (Keytree_Data(tree,key) == Keyarray_Data(array,key));
+    same &= (Keytree_Data_Index(tree,key) == Keyarray_Data_Index(array,key));
+    same &= (Keytree_Count(tree) == Keyarray_Count(array));
+    if ((i % 1000) == 0)
+      test_tree(pTest,tree);
+  }
+  ct_test(pTest,same);
+  test_tree(pTest,tree);
+  while (Keytree_Data_Pop(tree))
+    ;
+  ct_test(pTest,Keytree_Count(tree) == 0);
+  ct_test(pTest,tree->height == 0);
+  ct_test(pTest,tree->first == tree->root);
+  Keytree_Delete(tree);
+  Keyarray_Delete(array);
+
+  return;
+}
+
+// one object type after another, in key order from a cursor, and a
+// large tree built in order and taken apart from the middle
+void testKeyTreeCursor(Test* pTest)
+{
+  OS_Keytree tree;
+  struct Keytree_Cursor cursor;
+  static int data[100000];
+  unsigned seed = 5;
+  KEY key = 0;
+  KEY last;
+  void *value;
+  int count;
+  int i, j;
+
+  tree = Keytree_Create();
+  for (i = 0; i < 4000; i++)
+  {
+    // a shuffle of instance i % 1000 of type i / 1000
+    seed = seed * 1103515245 + 12345;
+    j = (int)((seed >> 8) % (i + 1));
+    data[i] = data[j];
+    data[j] = i;
+  }
+  for (i = 0; i < 4000; i++)
+    (void)Keytree_Data_Add(tree,KEY_ENCODE(data[i] / 1000,data[i] % 1000),
+      &data[i]);
+  test_tree(pTest,tree);
+  Keytree_Cursor_Seek(tree,KEY_ENCODE(OBJECT_TYPE_TEST,0),&cursor);
+  count = 0;
+  last = 0;
+  while (Keytree_Cursor_Next(&cursor,&key,&value) &&
+    (KEY_DECODE_TYPE(key) == OBJECT_TYPE_TEST))
+  {
+    ct_test(pTest,KEY_DECODE_ID(key) == count);
+    ct_test(pTest,(count == 0) || (key > last));
+    ct_test(pTest,*(int *)value == ((OBJECT_TYPE_TEST * 1000) + count));
+    last = key;
+    count++;
+  }
+  ct_test(pTest,count == 1000);
+  ct_test(pTest,KEY_DECODE_TYPE(key) == (OBJECT_TYPE_TEST + 1));
+  Keytree_Cursor_Seek(tree,KEY_ENCODE(3,1000),&cursor);
+  ct_test(pTest,!Keytree_Cursor_Next(&cursor,&key,&value));
+  ct_test(pTest,Keytree_Next_Empty_Key(tree,KEY_ENCODE(1,0)) ==
+    (int)KEY_ENCODE(1,1000));
+  while (Keytree_Data_Pop(tree))
+    ;
+
+  for (i = 0; i < 100000; i++)
+  {
+    data[i] = i;
+    ct_test(pTest,Keytree_Data_Add(tree,i,&data[i]) == i);
+  }
+  test_tree(pTest,tree);
+  // four levels of branches at the default order
+  ct_test(pTest,(KEYTREE_ORDER > 16) || (tree->height >= 4));
+  for (i = 0; i < 100000; i++)
+  {
+    value = Keytree_Data_Delete_By_Index(tree,(100000 - i) / 2);
+    ct_test(pTest,value != NULL);
+    if ((i % 10000) == 0)
+      test_tree(pTest,tree);
+  }
+  ct_test(pTest,Keytree_Count(tree) == 0);
+  ct_test(pTest,Keytree_Data_Delete_By_Index(tree,0) == NULL);
+  Keytree_Delete(tree);
+
+  return;
+}
+
+#ifdef TEST_KEYTREE
+// an object table of count objects of 8 types added in random order,
+// found by key, walked by index, scanned for all of one type, and
+// deleted in random order
+static void benchmarkKeyTree(int count, int with_array)
+{
+  OS_Keytree tree;
+  OS_Keyarray array;
+  struct Keytree_Cursor cursor;
+  static KEY keys[1000000];
+  unsigned seed = 7;
+  unsigned long sum = 0;
+  double start;
+  double tree_time[5];
+  double array_time[5] = {0, 0, 0, 0, 0};
+  KEY key;
+  KEY swap;
+  int i, j;
+
+  for (i = 0; i < count; i++)
+    keys[i] = KEY_ENCODE(i % 8,i / 8);
+  for (i = count - 1; i > 0; i--)
+  {
+    seed = seed * 1103515245 + 12345;
+    j = (int)((seed >> 8) % (i + 1));
+    swap = keys[i];
+    keys[i] = keys[j];
+    keys[j] = swap;
+  }
+  tree = Keytree_Create();
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < count; i++)
+    (void)Keytree_Data_Add(tree,keys[i],&keys[i]);
+  tree_time[0] = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < count; i++)
+    sum += (Keytree_Data(tree,keys[i]) != NULL);
+  tree_time[1] = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < count; i++)
+    sum += (Keytree_Data_Index(tree,i) != NULL);
+  tree_time[2] = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  Keytree_Cursor_Seek(tree,KEY_ENCODE(OBJECT_TYPE_TEST,0),&cursor);
+  while (Keytree_Cursor_Next(&cursor,&key,NULL) &&
+    (KEY_DECODE_TYPE(key) == OBJECT_TYPE_TEST))
+    sum++;
+  tree_time[3] = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < count; i++)
+    sum += (Keytree_Data_Delete(tree,keys[count - 1 - i]) != NULL);
+  tree_time[4] = OS_MonotonicSeconds() - start;
+  Keytree_Delete(tree);
+
+  if (with_array)
+  {
+    array = Keyarray_Create();
+    start = OS_MonotonicSeconds();
+    for (i = 0; i < count; i++)
+      (void)Keyarray_Data_Add(array,keys[i],&keys[i]);
+    array_time[0] = OS_MonotonicSeconds() - start;
+    start = OS_MonotonicSeconds();
+    for (i = 0; i < count; i++)
+      sum += (Keyarray_Data(array,keys[i]) != NULL);
+    array_time[1] = OS_MonotonicSeconds() - start;
+    start = OS_MonotonicSeconds();
+    for (i = 0; i < count; i++)
+      sum += (Keyarray_Data_Index(array,i) != NULL);
+    array_time[2] = OS_MonotonicSeconds() - start;
+    // the objects of one type are one run of the array
+    start = OS_MonotonicSeconds();
+    j = Keyarray_Count(array);
+    for (i = 0; i < j; i++)
+    {
+      key = array->entry[array->first + i].key;
+      sum += (KEY_DECODE_TYPE(key) == OBJECT_TYPE_TEST);
+    }
+    array_time[3] = OS_MonotonicSeconds() - start;
+    start = OS_MonotonicSeconds();
+    for (i = 0; i < count; i++)
+      sum += (Keyarray_Data_Delete(array,keys[count - 1 - i]) != NULL);
+    array_time[4] = OS_MonotonicSeconds() - start;
+    Keyarray_Delete(array);
+  }
+
+  printf("keytree: %7d objects, ns each, tree/array: add %6.1f/%-8.1f "
+    "find %6.1f/%-6.1f index %6.1f/%-4.1f delete %6.1f/%-8.1f, "
+    "scan of one type %.2f/%.2f ms (%lu)\n", count,
+    tree_time[0] * 1.0e9 / count, array_time[0] * 1.0e9 / count,
+    tree_time[1] * 1.0e9 / count, array_time[1] * 1.0e9 / count,
+    tree_time[2] * 1.0e9 / count, array_time[2] * 1.0e9 / count,
+    tree_time[4] * 1.0e9 / count, array_time[4] * 1.0e9 / count,
+    tree_time[3] * 1.0e3, array_time[3] * 1.0e3, sum);
+
+  return;
+}
+
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("keytree", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testKeyTreeArray);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testKeyTreeCursor);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  benchmarkKeyTree(10000,1);
+  benchmarkKeyTree(100000,1);
+  benchmarkKeyTree(1000000,0);
+
+  return 0;
+}
+#endif /* TEST_KEYTREE */
+#endif /* TEST */
@@ -0,0 +1,160 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330 
+ Boston, MA  02111-1307, USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef KEYTREE_H
+#define KEYTREE_H
+
+#include "key.h"
+#include "keymap.h"
+
+// This is a key sorted B+tree library with the same functions
+// as the keylist, for tables too large to move around in one
+// block.  Every node keeps its keys together at its start,
+// every branch keeps the number of entries under each child so
+// that an index is found on the way down, and the leaves are
+// linked in key order for a cursor to walk a range of keys.
+
+// entries or children in a node.  sixteen 32 bit keys fill one 64
+// octet cache line, which the search of a node reads; with the data
+// or child pointers and counts a node is five lines (264 octets).  a whole node in one line
+// would hold three entries.  four or eight entries make a taller
+// and slower tree, and 16 to 64 measure about the same.
+#ifndef KEYTREE_ORDER
+#define KEYTREE_ORDER 16
+#endif
+
+// the entries of a leaf, sorted by key
+struct Keytree_Leaf
+{
+  KEY key[KEYTREE_ORDER];
+  void *data[KEYTREE_ORDER];
+  struct Keytree_Leaf *next; // in key order
+  struct Keytree_Leaf *prev;
+  int count;
+};
+
+// the children of a branch, which are leaves on the lowest level
+struct Keytree_Branch
+{
+  KEY key[KEYTREE_ORDER]; // smallest key under each child but the first
+  void *child[KEYTREE_ORDER];
+  int size[KEYTREE_ORDER]; // entries under each child
+  int count;
+};
+
+typedef struct Keytree
+{
+  void *root; // a leaf when height is zero
+  int height; // levels of branches
+  int count; // entries in the tree
+  struct Keytree_Leaf *first; // leaves, in key order
+  struct Keytree_Leaf *last;
+  void *spare; // nodes to use again, linked through their first octets
+  OS_Keymap used; // keys in the tree, once an empty key is asked for
+} *OS_Keytree;
+
+// a place among the entries, in key order.
+// adding or deleting entries moves the places of the others.
+struct Keytree_Cursor
+{
+  struct Keytree_Leaf *leaf;
+  int index; // in the leaf
+};
+
+// returns the tree or NULL on failure.
+OS_Keytree Keytree_Create(void);
+
+// returns a tree with room for capacity entries,
+// or NULL on failure.  more may be added.
+OS_Keytree Keytree_Create_With_Capacity(
+  int capacity);
+
+// delete specified tree and all of its nodes
+void Keytree_Delete(OS_Keytree tree);
+
+// inserts the data after any entries with the same key
+// returns the index where it was added, or -1 on failure
+int Keytree_Data_Add(
+  OS_Keytree tree,
+  KEY key,
+  void *data);
+
+// deletes the first entry with the key
+// returns the data from the entry
+void *Keytree_Data_Delete(
+  OS_Keytree tree,
+  KEY key);
+
+// deletes an entry specified by its index
+// returns the data from the entry
+void *Keytree_Data_Delete_By_Index(
+  OS_Keytree tree,
+  int index);
+
+// returns the data from the first entry, and removes it
+void *Keytree_Data_Pop(
+  OS_Keytree tree);
+
+// returns the data from the first entry with the key
+void *Keytree_Data(
+  OS_Keytree tree,
+  KEY key);
+
+// returns the data specified by index
+void *Keytree_Data_Index(
+  OS_Keytree tree,
+  int index);
+
+// returns the first key from key on that is not in the tree
+int Keytree_Next_Empty_Key(
+  OS_Keytree tree,
+  KEY key);
+
+// returns the number of entries in the tree
+int Keytree_Count(
+  OS_Keytree tree);
+
+// places the cursor at the first entry whose key is not less than key
+void Keytree_Cursor_Seek(
+  OS_Keytree tree,
+  KEY key,
+  struct Keytree_Cursor *cursor);
+
+// reads the entry at the cursor and moves past it
+// returns 0 after the last entry
+int Keytree_Cursor_Next(
+  struct Keytree_Cursor *cursor,
+  KEY *key,
+  void **data);
+
+#endif
@@ -45,154 +45,12 @@
 // (c)	A timer with a resolution of five milliseconds or less
 
 #include <stddef.h>
+#include <string.h>
+#include "crc.h"
+#include "preamble.h"
+#include "mstp.h"
+#include "mstpq.h"
 
-#define FALSE 0
-#define TRUE 1
-typedef unsigned char BOOLEAN;
-typedef unsigned short UINT16;
-typedef unsigned char UINT8;
-
-// MS/TP Frame Type
-// Frame Types 8 through 127 are reserved by ASHRAE.
-#define FRAME_TYPE_TOKEN 0
-#define FRAME_TYPE_POLL_FOR_MASTER 1
-#define FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER 2
-#define FRAME_TYPE_TEST_REQUEST 3
-#define FRAME_TYPE_TEST_RESPONSE 4
-#define FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY 5
-#define FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY 6
-#define FRAME_TYPE_REPLY_POSTPONED 7
-// Frame Types 128 through 255: Proprietary Frames
-// These frames are available to vendors as proprietary (non-BACnet) frames. 
-// The first two octets of the Data field shall specify the unique vendor 
-// identification code, most significant octet first, for the type of 
-// vendor-proprietary frame to be conveyed. The length of the data portion 
-// of a Proprietary frame shall be in the range of 2 to 501 octets.
-#define FRAME_TYPE_PROPRIETARY_MIN 128
-#define FRAME_TYPE_PROPRIETARY_MAX 255
-
-// MS/TP Frame Format 
-// All frames are of the following format:
-// 
-// Preamble: two octet preamble: X`55', X`FF'
-// Frame Type: one octet
-// Destination Address: one octet address
-// Source Address: one octet address
-// Length: two octets, most significant octet first, of the Data field
-// Header CRC: one octet
-// Data: (present only if Length is non-zero)
-// Data CRC: (present only if Length is non-zero) two octets, 
-//           least significant octet first
-// (pad): (optional) at most one octet of padding: X'FF'
-
-// Used to accumulate the CRC on the data field of a frame.
-static UINT16 DataCRC;
-
-// Used to store the data length of a received frame.
-static unsigned DataLength;
-
-// Used to store the destination address of a received frame.
-static UINT8 DestinationAddress;
-
-// Used to count the number of received octets or errors. 
-// This is used in the detection of link activity.
-static unsigned EventCount;
-
-// Used to store the frame type of a received frame.
-static UINT8 FrameType;
-
-// The number of frames sent by this node during a single token hold. 
-// When this counter reaches the value Nmax_info_frames, the node must 
-// pass the token.
-static unsigned FrameCount;
-
-// Used to accumulate the CRC on the header of a frame.
-static UINT8 HeaderCRC;
-
-// Used as an index by the Receive State Machine, up to a maximum value of 
-// InputBufferSize.
-static unsigned Index;
-
-// The number of elements in the array InputBuffer[].
-#define INPUT_BUFFER_SIZE (501)
-
-// An array of octets, used to store octets as they are received. 
-// InputBuffer is indexed from 0 to InputBufferSize-1. 
-// The maximum size of a frame is 501 octets. 
-// A smaller value for InputBufferSize may be used by some implementations.
-static UINT8 InputBuffer[INPUT_BUFFER_SIZE];
-
-// "Next Station," the MAC address of the node to which This Station passes 
-// the token. If the Next_Station is unknown, Next_Station shall be equal to
-// This_Station.
-static UINT8 Next_Station;
-
-// "Poll Station," the MAC address of the node to which This Station last 
-// sent a Poll For Master. This is used during token maintenance.
-static UINT8 Poll_Station;
-
-// A Boolean flag set to TRUE by the Receive State Machine if an error is 
-// detected during the reception of a frame. Set to FALSE by the main 
-// state machine.
-static BOOLEAN ReceivedInvalidFrame;
-
-// A Boolean flag set to TRUE by the Receive State Machine if a valid frame 
-// is received. Set to FALSE by the main state machine.
-static BOOLEAN ReceivedValidFrame;
-
-// A counter of transmission retries used for Token and Poll For Master 
-// transmission.
-static unsigned RetryCount;
-
-// A timer with nominal 5 millisecond resolution used to measure and 
-// generate silence on the medium between octets. It is incremented by a 
-// timer process and is cleared by the Receive State Machine when activity 
-// is detected and by the SendFrame procedure as each octet is transmitted. 
-// Since the timer resolution is limited and the timer is not necessarily 
-// synchronized to other machine events, a timer value of N will actually 
-// denote intervals between N-1 and N
-static unsigned SilenceTimer;
-
-// A timer used to measure and generate Reply Postponed frames.  It is 
-// incremented by a timer process and is cleared by the Master Node State 
-// Machine when a Data Expecting Reply Answer activity is completed.
-static unsigned ReplyPostponedTimer;
-
-// A Boolean flag set to TRUE by the master machine if this node is the 
-// only known master node.
-static BOOLEAN SoleMaster;
-
-// Used to store the Source Address of a received frame.
-static UINT8 SourceAddress;
-
-// The number of tokens received by this node. When this counter reaches the 
-// value Npoll, the node polls the address range between TS and NS for 
-// additional master nodes. TokenCount is set to zero at the end of the 
-// polling process.
-static unsigned TokenCount;
-
-// "This Station," the MAC address of this node. TS is generally read from a 
-// hardware DIP switch, or from nonvolatile memory. Valid values for TS are 
-// 0 to 254. The value 255 is used to denote broadcast when used as a 
-// destination address but is not allowed as a value for TS.
-static UINT8 This_Station;
-#define MSTP_BROADCAST_ADDRESS 255
-
-// This parameter represents the value of the Max_Info_Frames property of 
-// the node's Device object. The value of Max_Info_Frames specifies the 
-// maximum number of information frames the node may send before it must 
-// pass the token. Max_Info_Frames may have different values on different 
-// nodes. This may be used to allocate more or less of the available link 
-// bandwidth to particular nodes. If Max_Info_Frames is not writable in a 
-// node, its value shall be 1.
-static unsigned Nmax_info_frames = 1;
-
-// This parameter represents the value of the Max_Master property of the 
-// node's Device object. The value of Max_Master specifies the highest 
-// allowable address for master nodes. The value of Max_Master shall be 
-// less than or equal to 127. If Max_Master is not writable in a node, 
-// its value shall be 127.
-static unsigned Nmax_master = 127;
 
 // The number of tokens received or used before a Poll For Master cycle 
 // is executed: 50.
@@ -205,26 +63,10 @@ static unsigned Nretry_token = 1;
 // seen by a receiving node in order to declare the line "active": 4.
 static unsigned Nmin_octets = 4;
 
-// The minimum time without a DataAvailable or ReceiveError event within 
-// a frame before a receiving node may discard the frame: 60 bit times. 
-// (Implementations may use larger values for this timeout, 
-// not to exceed 100 milliseconds.)
-// At 9600 baud, 60 bit times would be about 6.25 milliseconds
-static unsigned Tframe_abort = 1 + ((1000 * 60) / 9600);
-
-// The maximum idle time a sending node may allow to elapse between octets 
-// of a frame the node is transmitting: 20 bit times.
-static unsigned Tframe_gap = 20;
-
 // The time without a DataAvailable or ReceiveError event before declaration 
 // of loss of token: 500 milliseconds.
 static unsigned Tno_token = 500;
 
-// The maximum time after the end of the stop bit of the final 
-// octet of a transmitted frame before a node must disable its 
-// EIA-485 driver: 15 bit times.
-static unsigned Tpostdrive = 15;
-
 // The maximum time a node may wait after reception of a frame that expects 
 // a reply before sending the first octet of a reply or Reply Postponed 
 // frame: 250 milliseconds.
@@ -236,20 +78,10 @@ static unsigned Treply_delay = 225;
 // larger values for this timeout, not to exceed 300 milliseconds.)
 static unsigned Treply_timeout = 255;
 
-// Repeater turnoff delay. The duration of a continuous logical one state 
-// at the active input port of an MS/TP repeater after which the repeater 
-// will enter the IDLE state: 29 bit times < Troff < 40 bit times.
-static unsigned Troff = 30;
-
 // The width of the time slot within which a node may generate a token: 
 // 10 milliseconds.
 static unsigned Tslot = 10;
 
-// The minimum time after the end of the stop bit of the final octet of a 
-// received frame before a node may enable its EIA-485 driver: 40 bit times.
-// At 9600 baud, 40 bit times would be about 4.166 milliseconds
-static unsigned Tturnaround = 1 + ((1000 * 40) / 9600);
-
 // The maximum time a node may wait after reception of the token or 
 // a Poll For Master frame before sending the first octet of a frame: 
 // 15 milliseconds.
@@ -261,121 +93,393 @@ static unsigned Tusage_delay = 15;
 // larger values for this timeout, not to exceed 100 milliseconds.)
 static unsigned Tusage_timeout = 20;
 
-// Accumulate "dataValue" into the CRC in crcValue.
-// Return value is updated CRC
-//
-//  Assumes that "unsigned char" is equivalent to one octet.
-//  Assumes that "unsigned int" is 16 bits.
-//  The ^ operator means exclusive OR.
-// Note: This function is copied directly from the BACnet standard.
-UINT8 CalcHeaderCRC(UINT8 dataValue, UINT8 crcValue)
+// The times in bit times, which differ with the baud rate.
+
+// a start bit, eight data bits and a stop bit
+#define MSTP_OCTET_BITS 10
+
+// The minimum time without a DataAvailable or ReceiveError event within 
+// a frame before a receiving node may discard the frame: 60 bit times. 
+// (Implementations may use larger values for this timeout, 
+// not to exceed 100 milliseconds.)
+// At 9600 baud, 60 bit times would be about 6.25 milliseconds
+#define MSTP_FRAME_ABORT_BITS 60
+
+// The maximum idle time a sending node may allow to elapse between octets 
+// of a frame the node is transmitting: 20 bit times.
+#define MSTP_FRAME_GAP_BITS 20
+
+// The maximum time after the end of the stop bit of the final 
+// octet of a transmitted frame before a node must disable its 
+// EIA-485 driver: 15 bit times.
+#define MSTP_POSTDRIVE_BITS 15
+
+// Repeater turnoff delay. The duration of a continuous logical one state 
+// at the active input port of an MS/TP repeater after which the repeater 
+// will enter the IDLE state: 29 bit times < Troff < 40 bit times.
+#define MSTP_ROFF_BITS 30
+
+// The minimum time after the end of the stop bit of the final octet of a 
+// received frame before a node may enable its EIA-485 driver: 40 bit times.
+// At 9600 baud, 40 bit times would be about 4.166 milliseconds
+#define MSTP_TURNAROUND_BITS 40
+
+// The least Tframe_abort in milliseconds.  A build whose octets are
+// read in bursts some milliseconds apart, such as from a UART whose
+// driver waits to fill its FIFO, may raise it so that a frame is not
+// discarded while its octets are still on the way.
+#ifndef MSTP_FRAME_ABORT_MIN
+#define MSTP_FRAME_ABORT_MIN 1
+#endif
+
+// bit times in nanoseconds or milliseconds, rounded up or down
+#define BITS_NS_UP(bits, baud) \
+  ((((bits) * 1000000000ULL) + (baud) - 1) / (baud))
+#define BITS_NS_DOWN(bits, baud) (((bits) * 1000000000ULL) / (baud))
+#define BITS_MS_UP(bits, baud) ((((bits) * 1000U) + (baud) - 1) / (baud))
+
+#define MSTP_TIMING(baud) \
+  { \
+    (baud), \
+    BITS_NS_DOWN(MSTP_OCTET_BITS, baud), \
+    ((BITS_MS_UP(MSTP_FRAME_ABORT_BITS, baud) > MSTP_FRAME_ABORT_MIN) ? \
+      BITS_MS_UP(MSTP_FRAME_ABORT_BITS, baud) : MSTP_FRAME_ABORT_MIN), \
+    BITS_NS_DOWN(MSTP_FRAME_GAP_BITS, baud), \
+    BITS_NS_DOWN(MSTP_POSTDRIVE_BITS, baud), \
+    BITS_NS_UP(MSTP_ROFF_BITS, baud), \
+    BITS_NS_UP(MSTP_TURNAROUND_BITS, baud) \
+  }
+
+// the baud rates of MS/TP, slowest first
+static const struct MSTP_Timing MSTP_Timing_Table[] =
+{
+  MSTP_TIMING(9600),
+  MSTP_TIMING(19200),
+  MSTP_TIMING(38400),
+  MSTP_TIMING(57600),
+  MSTP_TIMING(76800),
+  MSTP_TIMING(115200)
+};
+
+// sets up a port with its station address and the default
+// Max_Info_Frames and Max_Master values
+void MSTP_Init(
+  struct MSTP_Port *port,
+  UINT8 this_station)
+{
+  memset(port, 0, sizeof(struct MSTP_Port));
+  port->This_Station = this_station;
+  port->Nmax_info_frames = 1;
+  port->Nmax_master = 127;
+  port->Npoll = Npoll;
+  // the slowest rate has the longest Tframe_abort and Tturnaround
+  port->Timing = &MSTP_Timing_Table[0];
+  port->Preamble_Find = Preamble_Engine(PREAMBLE_METHOD_AUTO);
+  port->InputBuffer = port->Input_Storage;
+  port->Receive_State = MSTP_RECEIVE_STATE_IDLE;
+  // When a master node is powered up or reset, 
+  // it shall unconditionally enter the INITIALIZE state.
+  port->Master_State = MSTP_MASTER_STATE_INITIALIZE;
+
+  return;
+}
+
+const struct MSTP_Timing *MSTP_Timing_Find(unsigned baud)
 {
-  unsigned int crc;
- 
-  crc = crcValue ^ dataValue;	/* XOR C7..C0 with D7..D0 */
+  unsigned i;
 
-  /* Exclusive OR the terms in the table (top down) */
-  crc = crc ^ (crc << 1) ^ (crc << 2) ^ (crc << 3)
-            ^ (crc << 4) ^ (crc << 5) ^ (crc << 6) 
-            ^ (crc << 7);
+  for (i = 0; i < sizeof(MSTP_Timing_Table)/sizeof(MSTP_Timing_Table[0]); i++)
+  {
+    if (MSTP_Timing_Table[i].baud == baud)
+      return &MSTP_Timing_Table[i];
+  }
 
-  /* Combine bits shifted out left hand end */
-  return (crc & 0xfe) ^ ((crc >> 8) & 1);
+  return NULL;
 }
 
-// Accumulate "dataValue" into the CRC in crcValue.
-//  Return value is updated CRC
-//
-//  Assumes that "unsigned char" is equivalent to one octet.
-//  Assumes that "unsigned int" is 16 bits.
-//  The ^ operator means exclusive OR.
-// Note: This function is copied directly from the BACnet standard.
-UINT16 CalcDataCRC(UINT8 dataValue, UINT16 crcValue)
+BOOLEAN MSTP_Timing_Set(
+  struct MSTP_Port *port,
+  unsigned baud)
 {
- unsigned int crcLow;
+  const struct MSTP_Timing *timing = MSTP_Timing_Find(baud);
 
- crcLow = (crcValue & 0xff) ^ dataValue;	/* XOR C7..C0 with D7..D0 */
+  if (!timing)
+    return FALSE;
+  port->Timing = timing;
 
- /* Exclusive OR the terms in the table (top down) */
- return (crcValue >>8) ^ (crcLow << 8)  ^ (crcLow <<3)
-				^ (crcLow <<12)  ^ (crcLow >> 4)
-				^ (crcLow & 0x0f) ^ ((crcLow & 0x0f) << 7);
+  return TRUE;
 }
 
 // Millisecond Timer - called every millisecond
-void MSTP_Millisecond_Timer(void)
+void MSTP_Millisecond_Timer(struct MSTP_Port *port)
 {
-  if (SilenceTimer < 255)
-    SilenceTimer++;
-  if (ReplyPostponedTimer < 255)
-    ReplyPostponedTimer++;
+  // saturate well above the longest timeout, Tno_token plus
+  // a Tslot for each station address
+  if (port->SilenceTimer < 0xFFFF)
+    port->SilenceTimer++;
+  if (port->ReplyPostponedTimer < 0xFFFF)
+    port->ReplyPostponedTimer++;
+  port->Milliseconds++;
 
   return;
 }
 
-// Transmits a Frame on the wire
-static void SendFrame(
+// Advances the timers by the milliseconds since they were last
+// advanced, so that a port need only be woken at its deadlines.
+void MSTP_Timer_Elapsed(
+  struct MSTP_Port *port,
+  unsigned milliseconds)
+{
+  port->Milliseconds += milliseconds;
+  if (milliseconds > 0xFFFF)
+    milliseconds = 0xFFFF;
+  port->SilenceTimer += milliseconds;
+  if (port->SilenceTimer > 0xFFFF)
+    port->SilenceTimer = 0xFFFF;
+  port->ReplyPostponedTimer += milliseconds;
+  if (port->ReplyPostponedTimer > 0xFFFF)
+    port->ReplyPostponedTimer = 0xFFFF;
+
+  return;
+}
+
+// milliseconds until SilenceTimer reaches limit
+static unsigned Silence_Until(struct MSTP_Port *port, unsigned limit)
+{
+  return (port->SilenceTimer >= limit) ? 0 : limit - port->SilenceTimer;
+}
+
+// The deadline of each state is the silence that the state waits
+// for, as tested by Receive_Frame_FSM and Master_Node_FSM.  States
+// that do not wait are due now, and so is a frame that has not been
+// taken, but only in a state that takes it: in the others, running
+// the state machine would not change anything before the deadline.
+// The deadline only moves when an octet is received or sent, so it
+// need only be asked for again after that or after it has passed.
+unsigned MSTP_Timeout(struct MSTP_Port *port)
+{
+  unsigned timeout = MSTP_TIMEOUT_NONE; // return value
+  unsigned master = MSTP_TIMEOUT_NONE;
+
+  if ((port->ReceivedValidFrame || port->ReceivedInvalidFrame) &&
+      (port->Monitor_Frame ||
+       (port->Master_State == MSTP_MASTER_STATE_IDLE) ||
+       (port->Master_State == MSTP_MASTER_STATE_WAIT_FOR_REPLY) ||
+       (port->Master_State == MSTP_MASTER_STATE_POLL_FOR_MASTER)))
+    return 0;
+  switch (port->Receive_State)
+  {
+    case MSTP_RECEIVE_STATE_IDLE:
+      break;
+    case MSTP_RECEIVE_STATE_HEADER_CRC:
+    case MSTP_RECEIVE_STATE_DATA_CRC:
+      return 0;
+    default:
+      // a frame in progress is discarded after Tframe_abort
+      timeout = Silence_Until(port, port->Timing->Tframe_abort + 1);
+      break;
+  }
+  // a bus monitor never runs Master_Node_FSM
+  if (port->Monitor_Frame)
+    return timeout;
+  switch (port->Master_State)
+  {
+    case MSTP_MASTER_STATE_IDLE:
+      master = Silence_Until(port, Tno_token);
+      break;
+    case MSTP_MASTER_STATE_WAIT_FOR_REPLY:
+      master = Silence_Until(port, Treply_timeout);
+      break;
+    case MSTP_MASTER_STATE_PASS_TOKEN:
+      if (port->EventCount > Nmin_octets)
+        master = 0;
+      else
+        master = Silence_Until(port, Tusage_timeout);
+      break;
+    case MSTP_MASTER_STATE_NO_TOKEN:
+      if (port->EventCount > Nmin_octets)
+        master = 0;
+      // our time slot to generate a token
+      else if (port->SilenceTimer <
+        (Tno_token + (Tslot * (port->This_Station + 1))))
+        master = Silence_Until(port, Tno_token + (Tslot * port->This_Station));
+      break;
+    case MSTP_MASTER_STATE_POLL_FOR_MASTER:
+      master = Silence_Until(port, Tusage_timeout);
+      break;
+    default:
+      // INITIALIZE, USE_TOKEN, DONE_WITH_TOKEN and ANSWER_DATA_REQUEST
+      master = 0;
+      break;
+  }
+  if (master < timeout)
+    timeout = master;
+
+  return timeout;
+}
+
+// Builds the preamble, the header and the header CRC of a frame
+// in the MSTP_HEADER_SIZE octets of header.
+void MSTP_Create_Header(
+  UINT8 *header, // where the header is built
   UINT8 frame_type, // type of frame to send - see defines
   UINT8 destination, // destination address
-  UINT8 source,  // source address
-  UINT8 *data, // any data to be sent - may be null
+  UINT8 source, // source address
   unsigned data_len) // number of bytes of data (up to 501)
 {
-  UINT8 HeaderCRC; // used for running CRC calculation
-  
-  (void)frame_type; // FIXME: temp until we implement this code
-  (void)destination; // FIXME: temp until we implement this code
-  (void)source; // FIXME: temp until we implement this code
-  (void)data; // FIXME: temp until we implement this code
-  (void)data_len; // FIXME: temp until we implement this code
-  // in order to avoid line contention
-  while (SilenceTimer < Tturnaround)
-  {
-    // wait, yield, or whatever
-  }
+  header[0] = 0x55;
+  header[1] = 0xFF;
+  header[2] = frame_type;
+  header[3] = destination;
+  header[4] = source;
+  header[5] = (UINT8)(data_len >> 8);
+  header[6] = (UINT8)(data_len & 0xFF);
+  header[7] = ~CRC_Header_Block(&header[2], 5, 0xFF);
 
-	// Disable the receiver, and enable the transmit line driver.
+  return;
+}
 
-  // Transmit the preamble octets X'55', X'FF'. 
-  // As each octet is transmitted, set SilenceTimer to zero.
+// Builds the two octets that follow the data of a frame: the
+// ones-complement of the data CRC, least significant octet first.
+void MSTP_Create_Data_CRC(
+  UINT8 *crc, // where the two octets are built
+  const UINT8 *data, // the data of the frame
+  unsigned data_len) // number of bytes of data
+{
+  UINT16 crc16 = ~CRC_Data_Block(data, data_len, 0xFFFF);
 
-  // HeaderCRC = 0xFF;
+  crc[0] = (UINT8)(crc16 & 0xFF);
+  crc[1] = (UINT8)(crc16 >> 8);
 
-  // Transmit the Frame Type, Destination Address, Source Address, 
-  // and Data Length octets. Accumulate each octet into HeaderCRC. 
-  // As each octet is transmitted, set SilenceTimer to zero.
+  return;
+}
 
-  // Transmit the ones-complement of HeaderCRC. Set SilenceTimer to zero.
+// Builds a complete frame in buffer: the preamble, the header and
+// its CRC, and any data followed by the data CRC.  The data of a
+// COBS-encoded frame is encoded with its CRC-32K, and must not
+// already be in buffer.
+// Returns the number of octets in the frame, or zero if the frame
+// does not fit in the buffer.
+unsigned MSTP_Create_Frame(
+  UINT8 *buffer, // where the frame is built
+  unsigned buffer_len, // number of octets available in buffer
+  UINT8 frame_type, // type of frame to send - see defines
+  UINT8 destination, // destination address
+  UINT8 source, // source address
+  const UINT8 *data, // any data to be sent - may be null
+  unsigned data_len) // number of bytes of data (up to 501, or 1497)
+{
+  unsigned index = 0; // number of octets in the frame - return value
 
-  // If there are data octets, initialize DataCRC to X'FFFF'.
+  if (MSTP_COBS_FRAME(frame_type))
+  {
+    if ((data_len == 0) || (data_len > MSTP_EXTENDED_DATA_MAX) ||
+        (buffer_len <= MSTP_HEADER_SIZE))
+      return 0;
+    index = (unsigned)COBS_Frame_Encode(&buffer[MSTP_HEADER_SIZE],
+      buffer_len - MSTP_HEADER_SIZE, data, data_len);
+    if (index == 0)
+      return 0;
+    MSTP_Create_Header(buffer, frame_type, destination, source, index - 2);
+    return MSTP_HEADER_SIZE + index;
+  }
+  if (buffer_len < (MSTP_HEADER_SIZE + (data_len ? (data_len + 2) : 0)))
+    return 0;
+  MSTP_Create_Header(buffer, frame_type, destination, source, data_len);
+  index = MSTP_HEADER_SIZE;
+  if (data_len)
+  {
+    memmove(&buffer[index], data, data_len);
+    index += data_len;
+    MSTP_Create_Data_CRC(&buffer[index], data, data_len);
+    index += 2;
+  }
 
-  // Transmit any data octets. Accumulate each octet into DataCRC. 
-  // As each octet is transmitted, set SilenceTimer to zero.
+  return index;
+}
 
-  // Transmit the ones-complement of DataCRC, least significant octet first. 
-  // As each octet is transmitted, set SilenceTimer to zero.
+// the counter of a frame type in MSTP_Stats
+static unsigned Stats_Frame_Type(UINT8 frame_type)
+{
+  if (frame_type < (MSTP_STATS_FRAME_TYPES - 1))
+    return frame_type;
 
-  // Wait until the final stop bit of the most significant CRC octet 
-  // has been transmitted but not more than Tpostdrive.
+  return MSTP_STATS_FRAME_TYPES - 1;
+}
 
-  // Disable the transmit line driver.
+// Transmits a Frame on the wire.
+// The header and the data CRC are built on the stack around the data,
+// and the three parts are handed to Send_Frame as they are, so the
+// data is never copied.  The data of a COBS-encoded frame is encoded
+// with its CRC-32K on the stack, and sent as the second part.
+// Send_Frame waits out the turnaround, enables the driver, sends the
+// parts and returns when the last stop bit is on the wire.  With no
+// Send_Frame, the port has no transmitter.
+static void SendFrame(
+  struct MSTP_Port *port, // port to send on
+  UINT8 frame_type, // type of frame to send - see defines
+  UINT8 destination, // destination address
+  UINT8 source,  // source address
+  const UINT8 *data, // any data to be sent - may be null
+  unsigned data_len) // number of bytes of data (up to 501, or 1497)
+{
+  UINT8 header[MSTP_HEADER_SIZE]; // preamble, header and HeaderCRC
+  UINT8 crc[2]; // DataCRC, least significant octet first
+  UINT8 encoded[MSTP_EXTENDED_ENCODED_MAX]; // COBS-encoded data and CRC
+  struct MSTP_Frame_Part part[MSTP_FRAME_PARTS];
+  unsigned count = 1; // number of parts to send
+  unsigned length = data_len; // the Length field
+  unsigned octets = 0;
+  unsigned i;
+
+  if (data_len > MSTP_FRAME_DATA_MAX(frame_type))
+    return;
+  if (MSTP_COBS_FRAME(frame_type))
+  {
+    if (data_len == 0)
+      return;
+    part[1].buffer = encoded;
+    part[1].length = (unsigned)COBS_Frame_Encode(encoded, sizeof(encoded),
+      data, data_len);
+    count = 2;
+    // the last two octets are where the data CRC would be
+    length = part[1].length - 2;
+  }
+  else if (data_len)
+  {
+    MSTP_Create_Data_CRC(crc, data, data_len);
+    part[1].buffer = data;
+    part[1].length = data_len;
+    part[2].buffer = crc;
+    part[2].length = sizeof(crc);
+    count = 3;
+  }
+  MSTP_Create_Header(header, frame_type, destination, source, length);
+  part[0].buffer = header;
+  part[0].length = sizeof(header);
+  if (port->Send_Frame)
+    port->Send_Frame(port, part, count);
+  // As each octet is transmitted, set SilenceTimer to zero.
+  port->SilenceTimer = 0;
+  for (i = 0; i < count; i++)
+  {
+    octets += part[i].length;
+  }
+  MSTP_STAT_ADD(port->Stats.frames_sent[Stats_Frame_Type(frame_type)], 1);
+  MSTP_STAT_ADD(port->Stats.octets_sent, octets);
 
   return;
 }
 
-static BOOLEAN ReceiveError; // TRUE when error detected during Rx octet
-static BOOLEAN DataAvailable; // There is data in the buffer
-static UINT8 DataRegister; // stores the latest data 
-
 // called by timer, interrupt(?) or other thread
-void Check_UART_Data(void)
+void Check_UART_Data(struct MSTP_Port *port)
 {
-  if (ReceiveError == TRUE)
+  if (port->ReceiveError == TRUE)
   {
     // wait for state machine to clear this
   }
   // wait for state machine to read from the DataRegister
-  else if (DataAvailable == FALSE)
+  else if (port->DataAvailable == FALSE)
   {
     // check for data
 
@@ -383,7 +487,7 @@ void Check_UART_Data(void)
     // ReceiveError = TRUE;
     // return;
 
-    DataRegister = 0; // FIXME: Get this data from UART or buffer
+    port->DataRegister = 0; // FIXME: Get this data from UART or buffer
 
     // if data is ready, 
     // DataAvailable = TRUE;
@@ -391,55 +495,158 @@ void Check_UART_Data(void)
   }
 }
 
-// receive FSM states
-typedef enum
+// In the HEADER_CRC state, the node validates the CRC on the fixed 
+// message header.
+// Returns TRUE if a valid or invalid frame was indicated.
+static BOOLEAN ReceiveHeaderCRC(struct MSTP_Port *port)
 {
-  MSTP_RECEIVE_STATE_IDLE,
-  MSTP_RECEIVE_STATE_PREAMBLE,
-  MSTP_RECEIVE_STATE_HEADER,
-  MSTP_RECEIVE_STATE_HEADER_CRC,
-  MSTP_RECEIVE_STATE_DATA,
-  MSTP_RECEIVE_STATE_DATA_CRC,
-} MSTP_RECEIVE_STATE;
-
-void Receive_Frame_FSM(void)
+  BOOLEAN done = TRUE; // return value - reception of the frame ended
+
+  // BadCRC
+  if (port->HeaderCRC != 0x55)
+  {
+    MSTP_STAT_ADD(port->Stats.header_crc_errors, 1);
+    // indicate that an error has occurred during the reception of a frame
+    port->ReceivedInvalidFrame = TRUE;
+    // wait for the start of the next frame.
+    port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
+  }
+  else
+  {
+    if ((port->DestinationAddress == port->This_Station) ||
+        (port->DestinationAddress == MSTP_BROADCAST_ADDRESS) ||
+        port->Promiscuous)
+    {
+      // FrameTooLong
+      if (port->DataLength > MSTP_LENGTH_MAX(port->FrameType))
+      {
+        MSTP_STAT_ADD(port->Stats.frames_too_long, 1);
+        // indicate that a frame with an illegal or unacceptable data length 
+        // has been received
+        port->ReceivedInvalidFrame = TRUE;
+        // wait for the start of the next frame.
+        port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
+      }
+      // NoData
+      else if (port->DataLength == 0)
+      {
+        MSTP_STAT_ADD(
+          port->Stats.frames_received[Stats_Frame_Type(port->FrameType)], 1);
+        // indicate that a frame with no data has been received
+        port->ReceivedValidFrame = TRUE;
+        // wait for the start of the next frame.
+        port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
+      }
+      // Data
+      else
+      {
+        port->Index = 0;
+        port->DataCRC = 0xFFFF;
+        // receive the data portion of the frame.
+        port->Receive_State = MSTP_RECEIVE_STATE_DATA;  
+        done = FALSE;
+      }
+    }
+    // NotForUs
+    else
+    {
+      MSTP_STAT_ADD(port->Stats.frames_not_for_us, 1);
+      // wait for the start of the next frame.
+      port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
+      done = FALSE;
+    }
+  }
+
+  return done;
+}
+
+// In the DATA_CRC state, the node validates the CRC of the message data.
+// A COBS-encoded frame is in InputBuffer with its encoded CRC-32K,
+// which is checked, and the data decoded in place over it.  A bus
+// monitor decodes it to one side and keeps the frame as it was sent.
+// Returns TRUE since a valid or invalid frame is always indicated.
+static BOOLEAN ReceiveDataCRC(struct MSTP_Port *port)
 {
-  static MSTP_RECEIVE_STATE state = MSTP_RECEIVE_STATE_IDLE;
+  UINT8 decoded[MSTP_EXTENDED_DATA_MAX];
+  size_t length = 0;
 
-  switch (state)
+  if (MSTP_COBS_FRAME(port->FrameType))
+  {
+    if (port->Monitor_Frame)
+      length = COBS_Frame_Decode(decoded, sizeof(decoded),
+        port->InputBuffer, port->DataLength + 2);
+    else
+    {
+      length = COBS_Frame_Decode(port->InputBuffer,
+        MSTP_EXTENDED_ENCODED_MAX, port->InputBuffer, port->DataLength + 2);
+      if (length)
+        port->DataLength = (unsigned)length;
+    }
+  }
+  // GoodCRC
+  if (MSTP_COBS_FRAME(port->FrameType) ? (length != 0) :
+      (port->DataCRC == 0xF0B8))
+  {
+    MSTP_STAT_ADD(
+      port->Stats.frames_received[Stats_Frame_Type(port->FrameType)], 1);
+    // indicate the complete reception of a valid frame
+    port->ReceivedValidFrame = TRUE;
+
+    // now might be a good time to process the message or
+    // copy the data to a buffer so that we can process the message
+
+    // wait for the start of the next frame.
+    port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
+  }
+  // BadCRC
+  else
+  {
+    MSTP_STAT_ADD(port->Stats.data_crc_errors, 1);
+    // to indicate that an error has occurred during the reception of a frame
+    port->ReceivedInvalidFrame = TRUE;
+    // wait for the start of the next frame.
+    port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
+  }
+
+  return TRUE;
+}
+
+static void ReceiveFrame(struct MSTP_Port *port)
+{
+  switch (port->Receive_State)
   {
     // In the IDLE state, the node waits for the beginning of a frame.
     case MSTP_RECEIVE_STATE_IDLE:
       // EatAnError
-      if (ReceiveError == TRUE)
+      if (port->ReceiveError == TRUE)
       {
-        ReceiveError = FALSE;
-        SilenceTimer = 0; 
-        EventCount++;
+        port->ReceiveError = FALSE;
+        port->SilenceTimer = 0; 
+        port->EventCount++;
         // wait for the start of a frame.
-        state = MSTP_RECEIVE_STATE_IDLE; 
+        port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
       }
       else 
       {
-        if (DataAvailable == TRUE)
+        if (port->DataAvailable == TRUE)
         {
           // Preamble1
-          if (DataRegister == 0x55)
+          if (port->DataRegister == 0x55)
           {
-            DataAvailable = FALSE;
-            SilenceTimer = 0;
-            EventCount++;
+            port->DataAvailable = FALSE;
+            port->SilenceTimer = 0;
+            port->EventCount++;
             // receive the remainder of the frame.
-            state = MSTP_RECEIVE_STATE_PREAMBLE; 
+            port->Receive_State = MSTP_RECEIVE_STATE_PREAMBLE; 
           }
           // EatAnOctet
           else
           {
-            DataAvailable = FALSE;
-            SilenceTimer = 0;
-            EventCount++;
+            port->DataAvailable = FALSE;
+            port->SilenceTimer = 0;
+            port->EventCount++;
             // wait for the start of a frame.
-            state = MSTP_RECEIVE_STATE_IDLE; 
+            port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
           }
         }
       }
@@ -447,54 +654,53 @@ void Receive_Frame_FSM(void)
     // In the PREAMBLE state, the node waits for the second octet of the preamble.
     case MSTP_RECEIVE_STATE_PREAMBLE:
       // Timeout
-      if (SilenceTimer > Tframe_abort)
+      if (port->SilenceTimer > port->Timing->Tframe_abort)
       {
         // a correct preamble has not been received
         // wait for the start of a frame.
-        state = MSTP_RECEIVE_STATE_IDLE; 
+        port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
       }
-    
       // Error
-      if (ReceiveError == TRUE)
+      else if (port->ReceiveError == TRUE)
       {
-        ReceiveError = FALSE;
-        SilenceTimer = 0;
-        EventCount++;
+        port->ReceiveError = FALSE;
+        port->SilenceTimer = 0;
+        port->EventCount++;
         // wait for the start of a frame.
-        state = MSTP_RECEIVE_STATE_IDLE; 
+        port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
       }
       else
       {
-        if (DataAvailable == TRUE)
+        if (port->DataAvailable == TRUE)
         {
           // Preamble2
-          if (DataRegister ==0xFF)
+          if (port->DataRegister ==0xFF)
           {
-            DataAvailable = FALSE;
-            SilenceTimer = 0; 
-            EventCount++;
-            Index = 0; 
-            HeaderCRC = 0xFF;
+            port->DataAvailable = FALSE;
+            port->SilenceTimer = 0; 
+            port->EventCount++;
+            port->Index = 0; 
+            port->HeaderCRC = 0xFF;
             // receive the remainder of the frame.
-            state = MSTP_RECEIVE_STATE_HEADER; 
+            port->Receive_State = MSTP_RECEIVE_STATE_HEADER; 
           }
           // RepeatedPreamble1
-          else if (DataRegister == 0x55)
+          else if (port->DataRegister == 0x55)
           {
-            DataAvailable = FALSE;
-            SilenceTimer = 0; 
-            EventCount++;
+            port->DataAvailable = FALSE;
+            port->SilenceTimer = 0; 
+            port->EventCount++;
             // wait for the second preamble octet.
-            state = MSTP_RECEIVE_STATE_PREAMBLE; 
+            port->Receive_State = MSTP_RECEIVE_STATE_PREAMBLE; 
           }
           // NotPreamble
           else
           {
-            DataAvailable = FALSE;
-            SilenceTimer = 0;
-            EventCount++;
+            port->DataAvailable = FALSE;
+            port->SilenceTimer = 0;
+            port->EventCount++;
             // wait for the start of a frame.
-            state = MSTP_RECEIVE_STATE_IDLE; 
+            port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
           }
         }
       }
@@ -502,374 +708,713 @@ void Receive_Frame_FSM(void)
     // In the HEADER state, the node waits for the fixed message header.
     case MSTP_RECEIVE_STATE_HEADER:
       // Timeout
-      if (SilenceTimer > Tframe_abort)
+      if (port->SilenceTimer > port->Timing->Tframe_abort)
       {
         // indicate that an error has occurred during the reception of a frame
-        ReceivedInvalidFrame = TRUE;
+        port->ReceivedInvalidFrame = TRUE;
         // wait for the start of a frame.
-        state = MSTP_RECEIVE_STATE_IDLE; 
+        port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
       }
-    
       // Error
-      if (ReceiveError == TRUE)
+      else if (port->ReceiveError == TRUE)
       {
-        ReceiveError = FALSE;
-        SilenceTimer = 0;
-        EventCount++;
+        port->ReceiveError = FALSE;
+        port->SilenceTimer = 0;
+        port->EventCount++;
         // indicate that an error has occurred during the reception of a frame
-        ReceivedInvalidFrame = TRUE;
+        port->ReceivedInvalidFrame = TRUE;
         // wait for the start of a frame.
-        state = MSTP_RECEIVE_STATE_IDLE; 
+        port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
       }
-      else if (DataAvailable == TRUE)
+      else if (port->DataAvailable == TRUE)
       {
         // FrameType
-        if (Index == 0)
+        if (port->Index == 0)
         {
-          SilenceTimer = 0; 
-          EventCount++;
-          HeaderCRC = CalcHeaderCRC(DataRegister,HeaderCRC);
-          FrameType = DataRegister;
-          DataAvailable = FALSE;
-          Index = 1;
-          state = MSTP_RECEIVE_STATE_HEADER;
+          port->SilenceTimer = 0; 
+          port->EventCount++;
+          port->HeaderCRC = CalcHeaderCRC(port->DataRegister,port->HeaderCRC);
+          port->FrameType = port->DataRegister;
+          port->DataAvailable = FALSE;
+          port->Index = 1;
+          port->Receive_State = MSTP_RECEIVE_STATE_HEADER;
         }
         // Destination
-        else if (Index == 1)
+        else if (port->Index == 1)
         {
-          SilenceTimer = 0;
-          EventCount++;
-          HeaderCRC = CalcHeaderCRC(DataRegister,HeaderCRC);
-          DestinationAddress = DataRegister;
-          DataAvailable = FALSE;
-          Index = 2;
-          state = MSTP_RECEIVE_STATE_HEADER;
+          port->SilenceTimer = 0;
+          port->EventCount++;
+          port->HeaderCRC = CalcHeaderCRC(port->DataRegister,port->HeaderCRC);
+          port->DestinationAddress = port->DataRegister;
+          port->DataAvailable = FALSE;
+          port->Index = 2;
+          port->Receive_State = MSTP_RECEIVE_STATE_HEADER;
         }
         // Source
-        else if (Index == 2)
+        else if (port->Index == 2)
         {
-          SilenceTimer = 0;
-          EventCount++;
-          HeaderCRC = CalcHeaderCRC(DataRegister,HeaderCRC);
-          SourceAddress = DataRegister;
-          DataAvailable = FALSE;
-          Index = 3;
-          state = MSTP_RECEIVE_STATE_HEADER;
+          port->SilenceTimer = 0;
+          port->EventCount++;
+          port->HeaderCRC = CalcHeaderCRC(port->DataRegister,port->HeaderCRC);
+          port->SourceAddress = port->DataRegister;
+          port->DataAvailable = FALSE;
+          port->Index = 3;
+          port->Receive_State = MSTP_RECEIVE_STATE_HEADER;
         }
         // Length1
-        else if (Index == 3)
+        else if (port->Index == 3)
         {
-          SilenceTimer = 0;
-          EventCount++;
-          HeaderCRC = CalcHeaderCRC(DataRegister,HeaderCRC);
-          DataLength = DataRegister * 256; 
-          DataAvailable = FALSE;
-          Index = 4;
-          state = MSTP_RECEIVE_STATE_HEADER;
+          port->SilenceTimer = 0;
+          port->EventCount++;
+          port->HeaderCRC = CalcHeaderCRC(port->DataRegister,port->HeaderCRC);
+          port->DataLength = port->DataRegister * 256; 
+          port->DataAvailable = FALSE;
+          port->Index = 4;
+          port->Receive_State = MSTP_RECEIVE_STATE_HEADER;
         }
         // Length2
-        else if (Index == 4)
+        else if (port->Index == 4)
         {
-          SilenceTimer = 0;
-          EventCount++;
-          HeaderCRC = CalcHeaderCRC(DataRegister,HeaderCRC);
-          DataLength += DataRegister;
-          DataAvailable = FALSE;
-          Index = 5;
-          state = MSTP_RECEIVE_STATE_HEADER;
+          port->SilenceTimer = 0;
+          port->EventCount++;
+          port->HeaderCRC = CalcHeaderCRC(port->DataRegister,port->HeaderCRC);
+          port->DataLength += port->DataRegister;
+          port->DataAvailable = FALSE;
+          port->Index = 5;
+          port->Receive_State = MSTP_RECEIVE_STATE_HEADER;
         }
         // HeaderCRC
-        else if (Index == 5)
+        else if (port->Index == 5)
         {
-          SilenceTimer = 0;
-          EventCount++;
-          HeaderCRC = CalcHeaderCRC(DataRegister,HeaderCRC);
-          DataAvailable = FALSE;
-          state = MSTP_RECEIVE_STATE_HEADER;
+          port->SilenceTimer = 0;
+          port->EventCount++;
+          port->HeaderCRCActual = port->DataRegister;
+          port->HeaderCRC = CalcHeaderCRC(port->DataRegister,port->HeaderCRC);
+          port->DataAvailable = FALSE;
+          // validate the header on the next call
+          port->Receive_State = MSTP_RECEIVE_STATE_HEADER_CRC;
         }
         // not per MS/TP standard, but it is a case not covered
         else
         {
-          ReceiveError = FALSE;
-          SilenceTimer = 0;
-          EventCount++;
+          port->ReceiveError = FALSE;
+          port->SilenceTimer = 0;
+          port->EventCount++;
           // indicate that an error has occurred during the reception of a frame
-          ReceivedInvalidFrame = TRUE;
+          port->ReceivedInvalidFrame = TRUE;
           // wait for the start of a frame.
-          state = MSTP_RECEIVE_STATE_IDLE; 
+          port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
         }
       }
       break;
     // In the HEADER_CRC state, the node validates the CRC on the fixed 
     // message header.
     case MSTP_RECEIVE_STATE_HEADER_CRC:
-      // BadCRC
-      if (HeaderCRC != 0x55)
-      {
-        // indicate that an error has occurred during the reception of a frame
-        ReceivedInvalidFrame = TRUE;
-        // wait for the start of the next frame.
-        state = MSTP_RECEIVE_STATE_IDLE; 
-      }
-      else
-      {
-        if ((DestinationAddress == This_Station) ||
-            (DestinationAddress == MSTP_BROADCAST_ADDRESS))
-        {
-          // FrameTooLong
-          if (DataLength > INPUT_BUFFER_SIZE)
-          {
-            // indicate that a frame with an illegal or unacceptable data length 
-            // has been received
-            ReceivedInvalidFrame = TRUE;
-            // wait for the start of the next frame.
-            state = MSTP_RECEIVE_STATE_IDLE; 
-          }
-          // NoData
-          else if (DataLength == 0)
-          {
-            // indicate that a frame with no data has been received
-            ReceivedValidFrame = TRUE;
-            // wait for the start of the next frame.
-            state = MSTP_RECEIVE_STATE_IDLE; 
-          }
-          // Data
-          else
-          {
-            Index = 0;
-            DataCRC = 0xFFFF;
-            // receive the data portion of the frame.
-            state = MSTP_RECEIVE_STATE_DATA;  
-          }
-        }
-        // NotForUs
-        else
-        {
-          // wait for the start of the next frame.
-          state = MSTP_RECEIVE_STATE_IDLE; 
-        }
-      }
+      (void)ReceiveHeaderCRC(port);
       break;
     // In the DATA state, the node waits for the data portion of a frame.
     case MSTP_RECEIVE_STATE_DATA:
       // Timeout
-      if (SilenceTimer > Tframe_abort)
+      if (port->SilenceTimer > port->Timing->Tframe_abort)
       {
         // indicate that an error has occurred during the reception of a frame
-        ReceivedInvalidFrame = TRUE;
+        port->ReceivedInvalidFrame = TRUE;
         // wait for the start of the next frame.
-        state = MSTP_RECEIVE_STATE_IDLE; 
+        port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
       }
       // Error
-      if (ReceiveError == TRUE)
+      else if (port->ReceiveError == TRUE)
       {
-        ReceiveError = FALSE;
-        SilenceTimer = 0;
+        port->ReceiveError = FALSE;
+        port->SilenceTimer = 0;
         // indicate that an error has occurred during the reception of a frame
-        ReceivedInvalidFrame = TRUE;
+        port->ReceivedInvalidFrame = TRUE;
         // wait for the start of the next frame.
-        state = MSTP_RECEIVE_STATE_IDLE; 
+        port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
       }
-      else if (DataAvailable == TRUE)
+      else if (port->DataAvailable == TRUE)
       {
         // DataOctet
-        if (Index < DataLength)
+        if (port->Index < port->DataLength)
         {
-          SilenceTimer = 0;
-          DataCRC = CalcDataCRC(DataRegister,DataCRC);
-          InputBuffer[Index] = DataRegister;
-          DataAvailable = FALSE;
-          Index++;
-          state = MSTP_RECEIVE_STATE_DATA;
+          port->SilenceTimer = 0;
+          port->DataCRC = CalcDataCRC(port->DataRegister,port->DataCRC);
+          port->InputBuffer[port->Index] = port->DataRegister;
+          port->DataAvailable = FALSE;
+          port->Index++;
+          port->Receive_State = MSTP_RECEIVE_STATE_DATA;
         }
         // CRC1
-        if (Index == DataLength)
+        // the CRC octets are kept too: in a COBS-encoded frame they are
+        // the end of its encoded CRC-32K
+        else if (port->Index == port->DataLength)
         {
-          SilenceTimer = 0;
-          DataCRC = CalcDataCRC(DataRegister,DataCRC);
-          DataAvailable = FALSE;
-          Index++; // Index now becomes the number of data octets
-          state = MSTP_RECEIVE_STATE_DATA;
+          port->SilenceTimer = 0;
+          port->DataCRC = CalcDataCRC(port->DataRegister,port->DataCRC);
+          port->InputBuffer[port->Index] = port->DataRegister;
+          port->DataAvailable = FALSE;
+          port->Index++; // Index now becomes the number of data octets
+          port->Receive_State = MSTP_RECEIVE_STATE_DATA;
         }
         // CRC2
-        if (Index == (DataLength + 1))
+        else if (port->Index == (port->DataLength + 1))
         {
-          SilenceTimer = 0;
-          DataCRC = CalcDataCRC(DataRegister,DataCRC);
-          DataAvailable = FALSE;
-          state = MSTP_RECEIVE_STATE_DATA_CRC;
+          port->SilenceTimer = 0;
+          port->DataCRC = CalcDataCRC(port->DataRegister,port->DataCRC);
+          port->InputBuffer[port->Index] = port->DataRegister;
+          port->DataAvailable = FALSE;
+          port->Receive_State = MSTP_RECEIVE_STATE_DATA_CRC;
         }
       }
       break;
     // In the DATA_CRC state, the node validates the CRC of the message data.
     case MSTP_RECEIVE_STATE_DATA_CRC:
-      // GoodCRC
-      if (DataCRC == 0xF0B8)
-      {
-        // indicate the complete reception of a valid frame
-        ReceivedValidFrame = TRUE;
-
-        // now might be a good time to process the message or
-        // copy the data to a buffer so that we can process the message
-    
-        // wait for the start of the next frame.
-        state = MSTP_RECEIVE_STATE_IDLE; 
-      }
-      // BadCRC
-      else
-      {
-        // to indicate that an error has occurred during the reception of a frame
-        ReceivedInvalidFrame = TRUE;
-        // wait for the start of the next frame.
-        state = MSTP_RECEIVE_STATE_IDLE; 
-      }
+      (void)ReceiveDataCRC(port);
       break;
     default:
       // shouldn't get here - but if we do...
-      state = MSTP_RECEIVE_STATE_IDLE; 
+      port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
       break;
   }
   
   return;
 }
 
-// master node FSM states
-typedef enum
+// The receive state machine, one octet or error at a time.
+// The statistics are counted around it: any state but IDLE checks
+// for Tframe_abort first, and an octet or error is used when its
+// flag is cleared.
+void Receive_Frame_FSM(struct MSTP_Port *port)
 {
-  MSTP_MASTER_STATE_INITIALIZE,
-  MSTP_MASTER_STATE_IDLE,
-  MSTP_MASTER_STATE_USE_TOKEN,
-  MSTP_MASTER_STATE_WAIT_FOR_REPLY,
-  MSTP_MASTER_STATE_DONE_WITH_TOKEN,
-  MSTP_MASTER_STATE_PASS_TOKEN,
-  MSTP_MASTER_STATE_NO_TOKEN,
-  MSTP_MASTER_STATE_POLL_FOR_MASTER,
-  MSTP_MASTER_STATE_ANSWER_DATA_REQUEST,
-} MSTP_MASTER_STATE;
-
-void Master_Node_FSM(void)
+  BOOLEAN timeout = (port->Receive_State != MSTP_RECEIVE_STATE_IDLE) &&
+    (port->Receive_State != MSTP_RECEIVE_STATE_HEADER_CRC) &&
+    (port->Receive_State != MSTP_RECEIVE_STATE_DATA_CRC) &&
+    (port->SilenceTimer > port->Timing->Tframe_abort);
+  BOOLEAN error = port->ReceiveError;
+  BOOLEAN data = port->DataAvailable;
+
+  ReceiveFrame(port);
+  if (timeout)
+    MSTP_STAT_ADD(port->Stats.frame_aborts, 1);
+  else if (error && !port->ReceiveError)
+    MSTP_STAT_ADD(port->Stats.receive_errors, 1);
+  else if (data && !port->DataAvailable)
+    MSTP_STAT_ADD(port->Stats.octets_received, 1);
+
+  return;
+}
+
+// Receives a block of octets that arrived back to back, such as the
+// result of one read() on a tty or one record of a capture file.
+// The octets go through the same states as Receive_Frame_FSM, but
+// without the DataAvailable/DataRegister handoff for every octet.
+// Returns the number of octets consumed.  It returns early when
+// ReceivedValidFrame or ReceivedInvalidFrame is set, so that the
+// Master Node State Machine can take the frame before the rest of
+// the block is received into InputBuffer.
+// Timeouts are checked once on entry.  There is no silence between
+// the octets of one block, just as SilenceTimer is cleared after
+// every octet by Receive_Frame_FSM.  Errors are still reported one
+// at a time through ReceiveError.
+static unsigned ReceiveOctets(
+  struct MSTP_Port *port,
+  const UINT8 *buffer, // octets received
+  unsigned length) // number of octets in the buffer
 {
-  // When a master node is powered up or reset, 
-  // it shall unconditionally enter the INITIALIZE state.
-  static MSTP_MASTER_STATE state = MSTP_MASTER_STATE_INITIALIZE;
+  unsigned index = 0; // octets consumed - return value
+  unsigned count = 0;
+  UINT8 octet = 0;
+
+  // validation that is waiting on a call
+  if (port->Receive_State == MSTP_RECEIVE_STATE_HEADER_CRC)
+  {
+    if (ReceiveHeaderCRC(port))
+      return 0;
+  }
+  else if (port->Receive_State == MSTP_RECEIVE_STATE_DATA_CRC)
+  {
+    (void)ReceiveDataCRC(port);
+    return 0;
+  }
+  // Timeout
+  if ((port->SilenceTimer > port->Timing->Tframe_abort) &&
+      (port->Receive_State != MSTP_RECEIVE_STATE_IDLE))
+  {
+    MSTP_STAT_ADD(port->Stats.frame_aborts, 1);
+    if (port->Receive_State != MSTP_RECEIVE_STATE_PREAMBLE)
+      port->ReceivedInvalidFrame = TRUE;
+    // wait for the start of a frame.
+    port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
+    if (port->ReceivedInvalidFrame)
+      return 0;
+  }
+  // Error
+  if (port->ReceiveError == TRUE)
+  {
+    MSTP_STAT_ADD(port->Stats.receive_errors, 1);
+    port->ReceiveError = FALSE;
+    port->SilenceTimer = 0;
+    if (port->Receive_State != MSTP_RECEIVE_STATE_DATA)
+      port->EventCount++;
+    if ((port->Receive_State == MSTP_RECEIVE_STATE_HEADER) ||
+        (port->Receive_State == MSTP_RECEIVE_STATE_DATA))
+    {
+      port->ReceivedInvalidFrame = TRUE;
+      port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
+      return 0;
+    }
+    port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
+  }
+
+  while (index < length)
+  {
+    switch (port->Receive_State)
+    {
+      case MSTP_RECEIVE_STATE_IDLE:
+        // EatAnOctet up to the first Preamble1 that is followed by
+        // Preamble2, which is where the PREAMBLE state would end up
+        count = (unsigned)port->Preamble_Find(&buffer[index],
+          length - index);
+        if (count < (length - index))
+        {
+          count += 2;
+          port->Index = 0; 
+          port->HeaderCRC = 0xFF;
+          port->Receive_State = MSTP_RECEIVE_STATE_HEADER; 
+        }
+        // Preamble1 at the end of the block
+        else if (buffer[length - 1] == 0x55)
+          port->Receive_State = MSTP_RECEIVE_STATE_PREAMBLE; 
+        port->EventCount += count;
+        index += count;
+        break;
+      case MSTP_RECEIVE_STATE_PREAMBLE:
+        octet = buffer[index++];
+        port->EventCount++;
+        // Preamble2
+        if (octet == 0xFF)
+        {
+          port->Index = 0; 
+          port->HeaderCRC = 0xFF;
+          port->Receive_State = MSTP_RECEIVE_STATE_HEADER; 
+        }
+        // NotPreamble - RepeatedPreamble1 stays in this state
+        else if (octet != 0x55)
+          port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
+        break;
+      case MSTP_RECEIVE_STATE_HEADER:
+        // the whole header is in the block: its CRC is checked over
+        // all six octets before the frame is taken any further
+        if ((port->Index == 0) && ((length - index) >= 6))
+        {
+          port->HeaderCRC = CRC_Header_Block(&buffer[index], 6, 0xFF);
+          port->FrameType = buffer[index];
+          port->DestinationAddress = buffer[index + 1];
+          port->SourceAddress = buffer[index + 2];
+          port->DataLength = (buffer[index + 3] * 256) + buffer[index + 4];
+          port->HeaderCRCActual = buffer[index + 5];
+          port->Index = 5;
+          port->EventCount += 6;
+          index += 6;
+          // HeaderCRC
+          port->Receive_State = MSTP_RECEIVE_STATE_HEADER_CRC;
+          if (ReceiveHeaderCRC(port))
+          {
+            port->SilenceTimer = 0;
+            return index;
+          }
+          break;
+        }
+        octet = buffer[index++];
+        port->EventCount++;
+        port->HeaderCRC = CRC_Header_Block(&octet, 1, port->HeaderCRC);
+        switch (port->Index)
+        {
+          case 0:
+            port->FrameType = octet;
+            break;
+          case 1:
+            port->DestinationAddress = octet;
+            break;
+          case 2:
+            port->SourceAddress = octet;
+            break;
+          case 3:
+            port->DataLength = octet * 256; 
+            break;
+          case 4:
+            port->DataLength += octet;
+            break;
+          default:
+            // HeaderCRC
+            port->HeaderCRCActual = octet;
+            port->Receive_State = MSTP_RECEIVE_STATE_HEADER_CRC;
+            if (ReceiveHeaderCRC(port))
+            {
+              port->SilenceTimer = 0;
+              return index;
+            }
+            break;
+        }
+        if (port->Receive_State == MSTP_RECEIVE_STATE_HEADER)
+          port->Index++;
+        break;
+      case MSTP_RECEIVE_STATE_DATA:
+        // DataOctet, CRC1 and CRC2 - as many as are in the block.
+        // The CRC octets are kept as Receive_Frame_FSM keeps them, and
+        // a COBS-encoded frame is checked by its CRC-32K instead.
+        count = (port->DataLength + 2) - port->Index;
+        if (count > (length - index))
+          count = length - index;
+        memcpy(&port->InputBuffer[port->Index], &buffer[index], count);
+        if (!MSTP_COBS_FRAME(port->FrameType))
+          port->DataCRC =
+            CRC_Data_Block(&buffer[index], count, port->DataCRC);
+        port->Index += count;
+        index += count;
+        if (port->Index == (port->DataLength + 2))
+        {
+          // Index is left as it is by Receive_Frame_FSM
+          port->Index = port->DataLength + 1;
+          port->Receive_State = MSTP_RECEIVE_STATE_DATA_CRC;
+          (void)ReceiveDataCRC(port);
+          port->SilenceTimer = 0;
+          return index;
+        }
+        break;
+      default:
+        // shouldn't get here - but if we do...
+        port->Receive_State = MSTP_RECEIVE_STATE_IDLE; 
+        break;
+    }
+  }
+  if (index)
+    port->SilenceTimer = 0;
+
+  return index;
+}
 
-  switch (state)
+unsigned MSTP_Receive_Octets(
+  struct MSTP_Port *port,
+  const UINT8 *buffer,
+  unsigned length)
+{
+  unsigned count = ReceiveOctets(port, buffer, length);
+
+  MSTP_STAT_ADD(port->Stats.octets_received, count);
+
+  return count;
+}
+
+// Passes the frame that was just indicated to Monitor_Frame, rebuilt
+// from the header fields and InputBuffer.  state is the receive state
+// before the octets that ended the frame, of which there were used.
+static void MonitorFrame(
+  struct MSTP_Port *port,
+  MSTP_RECEIVE_STATE state,
+  unsigned used)
+{
+  UINT8 frame[MSTP_EXTENDED_FRAME_SIZE];
+  unsigned length = 0;
+
+  frame[0] = 0x55;
+  frame[1] = 0xFF;
+  frame[2] = port->FrameType;
+  frame[3] = port->DestinationAddress;
+  frame[4] = port->SourceAddress;
+  frame[5] = (UINT8)(port->DataLength >> 8);
+  frame[6] = (UINT8)(port->DataLength & 0xFF);
+  frame[7] = port->HeaderCRCActual;
+  if (port->ReceivedValidFrame)
+    length = MSTP_HEADER_SIZE + (port->DataLength ? port->DataLength + 2 : 0);
+  // Timeout or Error - the frame ended before any octet of the block
+  else if ((used == 0) && (state == MSTP_RECEIVE_STATE_HEADER))
+    length = 2 + port->Index;
+  else if ((used == 0) && (state == MSTP_RECEIVE_STATE_DATA))
+    length = MSTP_HEADER_SIZE + port->Index;
+  // BadCRC or FrameTooLong on the header
+  else if ((port->HeaderCRC != CRC_HEADER_RESIDUE) ||
+    (port->DataLength > MSTP_LENGTH_MAX(port->FrameType)))
+    length = MSTP_HEADER_SIZE;
+  // BadCRC on the data
+  else
+    length = MSTP_HEADER_SIZE + port->DataLength + 2;
+  if (length > MSTP_HEADER_SIZE)
+    memcpy(&frame[MSTP_HEADER_SIZE], port->InputBuffer,
+      length - MSTP_HEADER_SIZE);
+  port->Monitor_Frame(port, frame, length, port->ReceivedValidFrame);
+
+  return;
+}
+
+// Receives as a bus monitor.  Each frame that is indicated is passed
+// on and taken at once, so the whole block is always received.
+unsigned MSTP_Monitor_Octets(
+  struct MSTP_Port *port,
+  const UINT8 *buffer,
+  unsigned length)
+{
+  MSTP_RECEIVE_STATE state;
+  unsigned total = 0; // octets used - return value
+  unsigned count = 0;
+
+  do
+  {
+    state = port->Receive_State;
+    count = MSTP_Receive_Octets(port, &buffer[total], length - total);
+    total += count;
+    if (port->ReceivedValidFrame || port->ReceivedInvalidFrame)
+    {
+      MonitorFrame(port, state, count);
+      port->ReceivedValidFrame = FALSE;
+      port->ReceivedInvalidFrame = FALSE;
+    }
+    else if (count == 0)
+      break;
+  } while (total < length);
+
+  return total;
+}
+
+// Receives from a ring that a UART reader thread or ISR fills, in
+// place of the DataAvailable/ReceiveError handoff of Check_UART_Data.
+// The octets up to the next error or the end of the ring array are
+// received as one block.  An error entry sets ReceiveError, which
+// takes the place of its octet just as it does in Receive_Frame_FSM.
+// Nothing is taken from the ring while a frame is indicated, so no
+// octets are lost while Master_Node_FSM catches up.  Call it even
+// when the ring is empty so that timeouts are still checked.
+unsigned MSTP_Receive_Ring(
+  struct MSTP_Port *port,
+  SPSC_RING *ring)
+{
+  UINT8 octets[128];
+  const uint16_t *entry = NULL;
+  unsigned total = 0; // entries used - return value
+  unsigned available = 0;
+  unsigned count = 0;
+  unsigned used = 0;
+
+  while (!port->ReceivedValidFrame && !port->ReceivedInvalidFrame)
+  {
+    available = Ringbuf_SPSC_Peek(ring, &entry);
+    count = 0;
+    if (available && (entry[0] & MSTP_RING_ERROR))
+    {
+      // the last error has not been handled yet
+      if (port->ReceiveError == TRUE)
+        break;
+      port->ReceiveError = TRUE;
+      Ringbuf_SPSC_Consume(ring, 1);
+      total++;
+    }
+    else
+    {
+      if (available > sizeof(octets))
+        available = sizeof(octets);
+      while ((count < available) && !(entry[count] & MSTP_RING_ERROR))
+      {
+        octets[count] = (UINT8)entry[count];
+        count++;
+      }
+    }
+    used = MSTP_Receive_Octets(port, octets, count);
+    Ringbuf_SPSC_Consume(ring, used);
+    total += used;
+    if (!available || (used < count))
+      break;
+  }
+
+  return total;
+}
+
+// indicates the reception of a BACnet data frame to the higher layers
+static void ReceiveData(struct MSTP_Port *port)
+{
+  if (port->Receive_Data &&
+      ((port->FrameType == FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY) ||
+       (port->FrameType == FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY) ||
+       (port->FrameType == FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY) ||
+       (port->FrameType ==
+         FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY)))
+    port->Receive_Data(port);
+
+  return;
+}
+
+// sends the reply that Reply_Data has for a BACnet data frame that
+// expects one.  returns FALSE if it has none.
+static BOOLEAN ReplyData(struct MSTP_Port *port)
+{
+  const UINT8 *reply = NULL;
+  unsigned length;
+  UINT8 frame_type = FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY;
+
+  length = port->Reply_Data(port, &reply);
+  if (length > INPUT_BUFFER_SIZE)
+    frame_type = FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY;
+  if ((length == 0) || (length > MSTP_FRAME_DATA_MAX(frame_type)))
+    return FALSE;
+  SendFrame(
+    port,
+    frame_type,
+    port->SourceAddress,
+    port->This_Station,
+    reply,length);
+  MSTP_STAT_ADD(port->Stats.replies_sent, 1);
+
+  return TRUE;
+}
+
+// the frame types that this node implements; the others are unwanted
+#define MSTP_FRAME_TYPE_KNOWN(frame_type) \
+  (((frame_type) <= FRAME_TYPE_REPLY_POSTPONED) || \
+   ((frame_type) == FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY) || \
+   ((frame_type) == FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY))
+
+void Master_Node_FSM(struct MSTP_Port *port)
+{
+  const struct MSTP_Queue_Frame *frame = NULL; // awaiting transmission
+  BOOLEAN postpone; // no reply within Treply_delay
+
+  switch (port->Master_State)
   {
     case MSTP_MASTER_STATE_INITIALIZE:
       // DoneInitializing
-      This_Station = 0; // FIXME: the node's station address
       // indicate that the next station is unknown
-      Next_Station = This_Station; 
-      Poll_Station = This_Station;
+      port->Next_Station = port->This_Station; 
+      port->Poll_Station = port->This_Station;
       // cause a Poll For Master to be sent when this node first 
       // receives the token
-      TokenCount = Npoll;
-      SoleMaster = FALSE;
-      ReceivedValidFrame = FALSE;
-      ReceivedInvalidFrame = FALSE;
-      state = MSTP_MASTER_STATE_IDLE; 
+      port->TokenCount = port->Npoll;
+      port->SoleMaster = FALSE;
+      port->ReceivedValidFrame = FALSE;
+      port->ReceivedInvalidFrame = FALSE;
+      port->Master_State = MSTP_MASTER_STATE_IDLE; 
       break;
     // In the IDLE state, the node waits for a frame.
     case MSTP_MASTER_STATE_IDLE:
       // LostToken
-      if (SilenceTimer >= Tno_token)
+      if (port->SilenceTimer >= Tno_token)
       {
         // assume that the token has been lost
-        state = MSTP_MASTER_STATE_NO_TOKEN;
+        MSTP_STAT_ADD(port->Stats.lost_tokens, 1);
+        port->EventCount = 0;
+        port->Master_State = MSTP_MASTER_STATE_NO_TOKEN;
       }
       // ReceivedInvalidFrame
-      else if (ReceivedInvalidFrame == TRUE)
+      else if (port->ReceivedInvalidFrame == TRUE)
       {
         // invalid frame was received
-        ReceivedInvalidFrame = FALSE;
+        port->ReceivedInvalidFrame = FALSE;
         // wait for the next frame
-        state = MSTP_MASTER_STATE_IDLE; 
+        port->Master_State = MSTP_MASTER_STATE_IDLE; 
       }
       // ReceivedUnwantedFrame
-      else if (ReceivedValidFrame == TRUE)
+      else if (port->ReceivedValidFrame == TRUE)
       {
-        if ((DestinationAddress != This_Station) ||
-            (DestinationAddress != MSTP_BROADCAST_ADDRESS))
+        if ((port->DestinationAddress != port->This_Station) &&
+            (port->DestinationAddress != MSTP_BROADCAST_ADDRESS))
         {
           // an unexpected or unwanted frame was received.
-          ReceivedValidFrame = FALSE;
+          port->ReceivedValidFrame = FALSE;
           // wait for the next frame
-          state = MSTP_MASTER_STATE_IDLE; 
+          port->Master_State = MSTP_MASTER_STATE_IDLE; 
         }
         // DestinationAddress is equal to 255 (broadcast) and 
         // FrameType has a value of Token, BACnet Data Expecting Reply, Test_Request, 
         // or a proprietary type known to this node that expects a reply 
         // (such frames may not be broadcast), or
-        else if ((DestinationAddress == MSTP_BROADCAST_ADDRESS) &&
-             ((FrameType == FRAME_TYPE_TOKEN) ||
-              (FrameType == FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY) ||
-              (FrameType == FRAME_TYPE_TEST_REQUEST)))
+        else if ((port->DestinationAddress == MSTP_BROADCAST_ADDRESS) &&
+             ((port->FrameType == FRAME_TYPE_TOKEN) ||
+              (port->FrameType == FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY) ||
+              (port->FrameType ==
+                FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY) ||
+              (port->FrameType == FRAME_TYPE_TEST_REQUEST)))
         {
           // an unexpected or unwanted frame was received.
-          ReceivedValidFrame = FALSE;
+          port->ReceivedValidFrame = FALSE;
           // wait for the next frame
-          state = MSTP_MASTER_STATE_IDLE; 
+          port->Master_State = MSTP_MASTER_STATE_IDLE; 
         }
         // FrameType has a value that indicates a standard or proprietary type
         // that is not known to this node.
-        // FIXME: change this if you add a proprietary type
-        else if /*(*/(FrameType >= FRAME_TYPE_PROPRIETARY_MIN) /*&&*/
-          /*(FrameType <= FRAME_TYPE_PROPRIETARY_MAX))*/
-          /* unnecessary if FrameType is UINT8 with max of 255 */
+        else if (!MSTP_FRAME_TYPE_KNOWN(port->FrameType))
         {
           // an unexpected or unwanted frame was received.
-          ReceivedValidFrame = FALSE;
+          port->ReceivedValidFrame = FALSE;
           // wait for the next frame
-          state = MSTP_MASTER_STATE_IDLE; 
+          port->Master_State = MSTP_MASTER_STATE_IDLE; 
         }
         // ReceivedToken
-        else if ((DestinationAddress == This_Station) &&
-                 (FrameType == FRAME_TYPE_TOKEN))
+        else if ((port->DestinationAddress == port->This_Station) &&
+                 (port->FrameType == FRAME_TYPE_TOKEN))
         {
-          ReceivedValidFrame = FALSE;
-          FrameCount = 0; 
-          SoleMaster = FALSE;
-          state = MSTP_MASTER_STATE_USE_TOKEN;
+          if (port->Stats.tokens_received)
+            MSTP_Histogram_Record(&port->Stats.token_rotation,
+              port->Milliseconds - port->TokenTime);
+          port->TokenTime = port->Milliseconds;
+          MSTP_STAT_ADD(port->Stats.tokens_received, 1);
+          port->ReceivedValidFrame = FALSE;
+          port->FrameCount = 0; 
+          port->SoleMaster = FALSE;
+          port->Master_State = MSTP_MASTER_STATE_USE_TOKEN;
         }  
           // ReceivedPFM
-        else if ((DestinationAddress == This_Station) &&
-                 (FrameType == FRAME_TYPE_POLL_FOR_MASTER))
+        else if ((port->DestinationAddress == port->This_Station) &&
+                 (port->FrameType == FRAME_TYPE_POLL_FOR_MASTER))
         {
           SendFrame(
+            port,
             FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER,
-            SourceAddress,
-            This_Station,
+            port->SourceAddress,
+            port->This_Station,
             NULL,0);
-          ReceivedValidFrame = FALSE;
+          port->ReceivedValidFrame = FALSE;
           // wait for the next frame
-          state = MSTP_MASTER_STATE_IDLE; 
+          port->Master_State = MSTP_MASTER_STATE_IDLE; 
         }
         // ReceivedDataNoReply
         // or a proprietary type known to this node that does not expect a reply
-        else if (((DestinationAddress == This_Station) || 
-                  (DestinationAddress == MSTP_BROADCAST_ADDRESS)) &&
-                 ((FrameType == FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY) ||
+        else if (((port->DestinationAddress == port->This_Station) || 
+                  (port->DestinationAddress == MSTP_BROADCAST_ADDRESS)) &&
+                 ((port->FrameType == FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY) ||
+                  (port->FrameType ==
+                    FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY) ||
                 //  (FrameType == FRAME_TYPE_PROPRIETARY_0) ||
-                  (FrameType == FRAME_TYPE_TEST_RESPONSE)))
+                  (port->FrameType == FRAME_TYPE_TEST_RESPONSE)))
         {
-          // FIXME: indicate successful reception to the higher layers
-          // i.e. Process this frame!
-          ReceivedValidFrame = FALSE;
+          // indicate successful reception to the higher layers
+          ReceiveData(port);
+          port->ReceivedValidFrame = FALSE;
           // wait for the next frame
-          state = MSTP_MASTER_STATE_IDLE; 
+          port->Master_State = MSTP_MASTER_STATE_IDLE; 
         }
         // ReceivedDataNeedingReply
         // or a proprietary type known to this node that expects a reply
-        else if ((DestinationAddress == This_Station) &&
-                 ((FrameType == FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY) ||
+        else if ((port->DestinationAddress == port->This_Station) &&
+                 ((port->FrameType == FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY) ||
+                  (port->FrameType ==
+                    FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY) ||
                 //  (FrameType == FRAME_TYPE_PROPRIETARY) ||
-                  (FrameType == FRAME_TYPE_TEST_REQUEST)))
+                  (port->FrameType == FRAME_TYPE_TEST_REQUEST)))
         {
-          ReplyPostponedTimer = 0;
+          port->ReplyPostponedTimer = 0;
           // indicate successful reception to the higher layers 
-          // (management entity in the case of Test_Request);
-          ReceivedValidFrame = FALSE;
-          state = MSTP_MASTER_STATE_ANSWER_DATA_REQUEST;
+          // (management entity in the case of Test_Request),
+          // unless Reply_Data can answer it
+          if (!port->Reply_Data)
+            ReceiveData(port);
+          port->ReceivedValidFrame = FALSE;
+          port->Master_State = MSTP_MASTER_STATE_ANSWER_DATA_REQUEST;
+        }
+        // a known type that is not for this state, such as a reply
+        // that comes too late, is dropped as well, so that every
+        // frame is taken in one step
+        else
+        {
+          port->ReceivedValidFrame = FALSE;
+          port->Master_State = MSTP_MASTER_STATE_IDLE; 
         }
       }
       break;
@@ -878,243 +1423,269 @@ void Master_Node_FSM(void)
     // proprietary frames.
     case MSTP_MASTER_STATE_USE_TOKEN:
       // NothingToSend
-	    // FIXME: If there is no data frame awaiting transmission,
+      if (port->Queue)
+        frame = MSTP_Queue_Front(port->Queue);
+      if (frame == NULL)
       {
-        FrameCount = Nmax_info_frames;
-        state = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
+        port->FrameCount = port->Nmax_info_frames;
+        port->Master_State = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
       }
-      // SendNoWait
-      // FIXME: If there is a frame awaiting transmission that 
-      // is of type Test_Response, BACnet Data Not Expecting Reply, 
-      // or a proprietary type that does not expect a reply,
-//      {
-//        // transmit the data frame
-//        SendFrame(?????????????);
-//        FrameCount++;
-//        state = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
-//      }
       // SendAndWait
-      // FIXME:	If there is a frame awaiting transmission that is of 
-      // type Test_Request, BACnet Data Expecting Reply, or 
-      // a proprietary type that expects a reply,
-//      {
-//        // transmit the data frame
-//        SendFrame();
-//        FrameCount++;
-//        state = MSTP_MASTER_STATE_WAIT_FOR_REPLY;
-//      }
+      // a frame of type Test_Request, BACnet Data Expecting Reply, 
+      // BACnet Extended Data Expecting Reply,
+      // or a proprietary type that expects a reply
+      else if ((frame->frame_type == FRAME_TYPE_TEST_REQUEST) ||
+               (frame->frame_type == FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY) ||
+               (frame->frame_type ==
+                 FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY))
+      {
+        // transmit the data frame, from its slot in the queue
+        SendFrame(port, frame->frame_type, frame->destination,
+          port->This_Station, frame->data, frame->data_len);
+        MSTP_Queue_Pop(port->Queue);
+        port->RequestTime = port->Milliseconds;
+        port->FrameCount++;
+        port->Master_State = MSTP_MASTER_STATE_WAIT_FOR_REPLY;
+      }
+      // SendNoWait
+      // a frame of type Test_Response, BACnet Data Not Expecting Reply, 
+      // or a proprietary type that does not expect a reply
+      else
+      {
+        // transmit the data frame, from its slot in the queue
+        SendFrame(port, frame->frame_type, frame->destination,
+          port->This_Station, frame->data, frame->data_len);
+        MSTP_Queue_Pop(port->Queue);
+        port->FrameCount++;
+        port->Master_State = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
+      }
+      break;
     // In the WAIT_FOR_REPLY state, the node waits for 
     // a reply from another node.
     case MSTP_MASTER_STATE_WAIT_FOR_REPLY:
       // ReplyTimeout
-      if (SilenceTimer >= Treply_timeout)
+      if (port->SilenceTimer >= Treply_timeout)
       {
         // assume that the request has failed
-        FrameCount = Nmax_info_frames;
-        state = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
+        MSTP_STAT_ADD(port->Stats.reply_timeouts, 1);
+        port->FrameCount = port->Nmax_info_frames;
+        port->Master_State = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
         // Any retry of the data frame shall await the next entry
         // to the USE_TOKEN state. (Because of the length of the timeout, 
         // this transition will cause the token to be passed regardless 
         // of the initial value of FrameCount.)
       }
       // InvalidFrame
-      else if ((SilenceTimer < Treply_timeout) &&
-        (ReceivedInvalidFrame == TRUE))
+      else if ((port->SilenceTimer < Treply_timeout) &&
+        (port->ReceivedInvalidFrame == TRUE))
       {
         // error in frame reception
-        ReceivedInvalidFrame = FALSE;
-        state = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
+        port->ReceivedInvalidFrame = FALSE;
+        port->Master_State = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
       }
       // ReceivedReply
       // or a proprietary type that indicates a reply
-      else if ((SilenceTimer < Treply_timeout) &&
-        (ReceivedValidFrame == TRUE) &&
-        (DestinationAddress == This_Station) &&
-        ((FrameType == FRAME_TYPE_TEST_RESPONSE) ||
+      else if ((port->SilenceTimer < Treply_timeout) &&
+        (port->ReceivedValidFrame == TRUE) &&
+        (port->DestinationAddress == port->This_Station) &&
+        ((port->FrameType == FRAME_TYPE_TEST_RESPONSE) ||
          //(FrameType == FRAME_TYPE_PROPRIETARY_0) ||
-         (FrameType == FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY)))
+         (port->FrameType == FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY) ||
+         (port->FrameType ==
+           FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY)))
       {
-        // FIXME: indicate successful reception to the higher layers
-        ReceivedValidFrame = FALSE;
-        state = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
+        // indicate successful reception to the higher layers
+        ReceiveData(port);
+        MSTP_Histogram_Record(&port->Stats.reply_latency,
+          port->Milliseconds - port->RequestTime);
+        port->ReceivedValidFrame = FALSE;
+        port->Master_State = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
       }
       // ReceivedPostpone
-      else if ((SilenceTimer < Treply_timeout) && 
-          (ReceivedValidFrame == TRUE) && 
-          (DestinationAddress == This_Station) &&
-          (FrameType == FRAME_TYPE_REPLY_POSTPONED))
+      else if ((port->SilenceTimer < Treply_timeout) && 
+          (port->ReceivedValidFrame == TRUE) && 
+          (port->DestinationAddress == port->This_Station) &&
+          (port->FrameType == FRAME_TYPE_REPLY_POSTPONED))
       {
         // FIXME: then the reply to the message has been postponed until a later time.
         // So, what does this really mean?
-        ReceivedValidFrame = FALSE;
-        state = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
+        MSTP_STAT_ADD(port->Stats.replies_postponed_received, 1);
+        port->ReceivedValidFrame = FALSE;
+        port->Master_State = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
       }
       // ReceivedUnexpectedFrame
-      else if ((SilenceTimer < Treply_timeout) &&
-          (ReceivedValidFrame == TRUE) &&
-          (DestinationAddress != This_Station))
+      else if ((port->SilenceTimer < Treply_timeout) &&
+          (port->ReceivedValidFrame == TRUE) &&
+          (port->DestinationAddress != port->This_Station))
       //the expected reply should not be broadcast) 
       {
         // an unexpected frame was received
         // This may indicate the presence of multiple tokens. 
-        ReceivedValidFrame = FALSE;
+        port->ReceivedValidFrame = FALSE;
         // Synchronize with the network.
         // This action drops the token.      
-        state = MSTP_MASTER_STATE_IDLE;
+        port->Master_State = MSTP_MASTER_STATE_IDLE;
       }
       // ReceivedUnexpectedFrame
-      else if ((SilenceTimer < Treply_timeout) &&
-        (ReceivedValidFrame == TRUE) &&
-        ((FrameType == FRAME_TYPE_TEST_RESPONSE) ||
-         //(FrameType == FRAME_TYPE_PROPRIETARY_0) ||
-         (FrameType == FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY)))
+      // a frame for this node that is not a reply
+      else if ((port->SilenceTimer < Treply_timeout) &&
+        (port->ReceivedValidFrame == TRUE))
       {
         // An unexpected frame was received.
         // This may indicate the presence of multiple tokens. 
-        ReceivedValidFrame = FALSE;
+        port->ReceivedValidFrame = FALSE;
         // Synchronize with the network.
         // This action drops the token.      
-        state = MSTP_MASTER_STATE_IDLE;
+        port->Master_State = MSTP_MASTER_STATE_IDLE;
       }
       break;
     // The DONE_WITH_TOKEN state either sends another data frame, 
     // passes the token, or initiates a Poll For Master cycle.
     case MSTP_MASTER_STATE_DONE_WITH_TOKEN:
       // SendAnotherFrame
-      if (FrameCount < Nmax_info_frames)
+      if (port->FrameCount < port->Nmax_info_frames)
       {
         // then this node may send another information frame 
         // before passing the token. 
-        state = MSTP_MASTER_STATE_USE_TOKEN;
+        port->Master_State = MSTP_MASTER_STATE_USE_TOKEN;
       }
       // SoleMaster
-      else if ((FrameCount >= Nmax_info_frames) &&
-        (TokenCount < Npoll) &&
-        (SoleMaster == TRUE))
+      else if ((port->FrameCount >= port->Nmax_info_frames) &&
+        (port->TokenCount < port->Npoll) &&
+        (port->SoleMaster == TRUE))
       {
         // there are no other known master nodes to 
         // which the token may be sent (true master-slave operation). 
-        FrameCount = 0;
-        TokenCount++;
-        state = MSTP_MASTER_STATE_USE_TOKEN;
+        port->FrameCount = 0;
+        port->TokenCount++;
+        port->Master_State = MSTP_MASTER_STATE_USE_TOKEN;
       }
       // SendToken
-      else if (((FrameCount >= Nmax_info_frames) &&
-        (TokenCount < Npoll) &&
-        (SoleMaster == FALSE)) ||
+      else if (((port->FrameCount >= port->Nmax_info_frames) &&
+        (port->TokenCount < port->Npoll) &&
+        (port->SoleMaster == FALSE)) ||
         // The comparison of NS and TS+1 eliminates the Poll For Master 
         // if there are no addresses between TS and NS, since there is no 
         // address at which a new master node may be found in that case.
-        (Next_Station == (UINT8)((This_Station +1) % (Nmax_master + 1))))
+        (port->Next_Station == (UINT8)((port->This_Station +1) % (port->Nmax_master + 1))))
       {
-        TokenCount++;
+        port->TokenCount++;
         // transmit a Token frame to NS
         SendFrame(
+          port,
           FRAME_TYPE_TOKEN,
-          Next_Station,
-          This_Station,
+          port->Next_Station,
+          port->This_Station,
           NULL,0);
-        RetryCount = 0;
-        EventCount = 0;
-        state = MSTP_MASTER_STATE_PASS_TOKEN;
+        port->RetryCount = 0;
+        port->EventCount = 0;
+        port->Master_State = MSTP_MASTER_STATE_PASS_TOKEN;
       }
       // SendMaintenancePFM
-      else if ((FrameCount >= Nmax_info_frames) &&
-        (TokenCount >= Npoll) &&
-        ((UINT8)((Poll_Station + 1) % (Nmax_master + 1)) != Next_Station))
+      else if ((port->FrameCount >= port->Nmax_info_frames) &&
+        (port->TokenCount >= port->Npoll) &&
+        ((UINT8)((port->Poll_Station + 1) % (port->Nmax_master + 1)) != port->Next_Station))
       {
-        Poll_Station = (Poll_Station + 1) % (Nmax_master + 1);
+        port->Poll_Station = (port->Poll_Station + 1) % (port->Nmax_master + 1);
         SendFrame(
+          port,
           FRAME_TYPE_POLL_FOR_MASTER,
-          Poll_Station,
-          This_Station,
+          port->Poll_Station,
+          port->This_Station,
           NULL,0);
-        RetryCount = 0;
-        state = MSTP_MASTER_STATE_POLL_FOR_MASTER;
+        port->RetryCount = 0;
+        port->Master_State = MSTP_MASTER_STATE_POLL_FOR_MASTER;
       }
       // ResetMaintenancePFM
-      else if ((FrameCount >= Nmax_info_frames) &&
-        (TokenCount >= Npoll) &&
-        ((UINT8)((Poll_Station + 1) % (Nmax_master + 1)) == Next_Station) &&
-        (SoleMaster == FALSE))
+      else if ((port->FrameCount >= port->Nmax_info_frames) &&
+        (port->TokenCount >= port->Npoll) &&
+        ((UINT8)((port->Poll_Station + 1) % (port->Nmax_master + 1)) == port->Next_Station) &&
+        (port->SoleMaster == FALSE))
       {
-        Poll_Station = This_Station;
+        port->Poll_Station = port->This_Station;
         // transmit a Token frame to NS
         SendFrame(
+          port,
           FRAME_TYPE_TOKEN,
-          Next_Station,
-          This_Station,
+          port->Next_Station,
+          port->This_Station,
           NULL,0);
-        RetryCount = 0;
-        TokenCount = 0;
-        EventCount = 0;
-        state = MSTP_MASTER_STATE_PASS_TOKEN;
+        port->RetryCount = 0;
+        port->TokenCount = 0;
+        port->EventCount = 0;
+        port->Master_State = MSTP_MASTER_STATE_PASS_TOKEN;
       }
       // SoleMasterRestartMaintenancePFM
-      else if ((FrameCount >= Nmax_info_frames) &&
-        (TokenCount >= Npoll) &&
-        ((UINT8)((Poll_Station + 1) % (Nmax_master + 1)) == Next_Station) &&
-        (SoleMaster == TRUE))
+      else if ((port->FrameCount >= port->Nmax_info_frames) &&
+        (port->TokenCount >= port->Npoll) &&
+        ((UINT8)((port->Poll_Station + 1) % (port->Nmax_master + 1)) == port->Next_Station) &&
+        (port->SoleMaster == TRUE))
       {
-        Poll_Station = (Next_Station +1) % (Nmax_master + 1);
+        port->Poll_Station = (port->Next_Station +1) % (port->Nmax_master + 1);
         SendFrame(
+          port,
           FRAME_TYPE_POLL_FOR_MASTER,
-          Poll_Station,
-          This_Station,
+          port->Poll_Station,
+          port->This_Station,
           NULL,0);
         // no known successor node
-        Next_Station = This_Station;
-        RetryCount = 0;
-        TokenCount = 0;
-        EventCount = 0;
+        port->Next_Station = port->This_Station;
+        port->RetryCount = 0;
+        port->TokenCount = 0;
+        port->EventCount = 0;
         // find a new successor to TS
-        state = MSTP_MASTER_STATE_POLL_FOR_MASTER;
+        port->Master_State = MSTP_MASTER_STATE_POLL_FOR_MASTER;
       }
+      break;
     // The PASS_TOKEN state listens for a successor to begin using
     // the token that this node has just attempted to pass.
     case MSTP_MASTER_STATE_PASS_TOKEN:
       // SawTokenUser
-      if ((SilenceTimer < Tusage_timeout) &&
-        (EventCount > Nmin_octets))
+      if ((port->SilenceTimer < Tusage_timeout) &&
+        (port->EventCount > Nmin_octets))
       {
         // Assume that a frame has been sent by the new token user. 
         // Enter the IDLE state to process the frame.
-        state = MSTP_MASTER_STATE_IDLE;
+        port->Master_State = MSTP_MASTER_STATE_IDLE;
       }
       // RetrySendToken
-      else if ((SilenceTimer >= Tusage_timeout) &&
-          (RetryCount < Nretry_token))
+      else if ((port->SilenceTimer >= Tusage_timeout) &&
+          (port->RetryCount < Nretry_token))
       {
-        RetryCount++;
+        MSTP_STAT_ADD(port->Stats.token_retries, 1);
+        port->RetryCount++;
         // Transmit a Token frame to NS
         SendFrame(
+          port,
           FRAME_TYPE_TOKEN,
-          Next_Station,
-          This_Station,
+          port->Next_Station,
+          port->This_Station,
           NULL,0);
-        EventCount = 0;
+        port->EventCount = 0;
         // re-enter the current state to listen for NS 
         // to begin using the token.
       }
       // FindNewSuccessor
-      else if ((SilenceTimer >= Tusage_timeout) &&
-          (RetryCount >= Nretry_token))
+      else if ((port->SilenceTimer >= Tusage_timeout) &&
+          (port->RetryCount >= Nretry_token))
       {
         // Assume that NS has failed. 
-        Poll_Station = (Next_Station + 1) % (Nmax_master + 1);
+        MSTP_STAT_ADD(port->Stats.token_pass_failures, 1);
+        port->Poll_Station = (port->Next_Station + 1) % (port->Nmax_master + 1);
         // Transmit a Poll For Master frame to PS.
         SendFrame(
+          port,
           FRAME_TYPE_POLL_FOR_MASTER,
-          Poll_Station,
-          This_Station,
+          port->Poll_Station,
+          port->This_Station,
           NULL,0);
         // no known successor node
-        Next_Station = This_Station;
-        RetryCount = 0;
-        TokenCount = 0;
-        EventCount = 0;
+        port->Next_Station = port->This_Station;
+        port->RetryCount = 0;
+        port->TokenCount = 0;
+        port->EventCount = 0;
         // find a new successor to TS
-        state = MSTP_MASTER_STATE_POLL_FOR_MASTER;
+        port->Master_State = MSTP_MASTER_STATE_POLL_FOR_MASTER;
       }
       break;
     // The NO_TOKEN state is entered if SilenceTimer becomes greater 
@@ -1123,33 +1694,34 @@ void Master_Node_FSM(void)
     // whether or not this node may create a token.
     case MSTP_MASTER_STATE_NO_TOKEN:
       // SawFrame
-      if ((SilenceTimer < (Tno_token + (Tslot * This_Station))) &&
-            (EventCount > Nmin_octets))
+      if ((port->SilenceTimer < (Tno_token + (Tslot * port->This_Station))) &&
+            (port->EventCount > Nmin_octets))
       {
         // Some other node exists at a lower address. 
         // Enter the IDLE state to receive and process the incoming frame.
-        state = MSTP_MASTER_STATE_IDLE;
+        port->Master_State = MSTP_MASTER_STATE_IDLE;
       }
       // GenerateToken
-      else if ((SilenceTimer >= (Tno_token + (Tslot * This_Station))) &&
-          (SilenceTimer < (Tno_token + (Tslot * (This_Station + 1)))))
+      else if ((port->SilenceTimer >= (Tno_token + (Tslot * port->This_Station))) &&
+          (port->SilenceTimer < (Tno_token + (Tslot * (port->This_Station + 1)))))
       {
         // Assume that this node is the lowest numerical address 
         // on the network and is empowered to create a token. 
-        Poll_Station = (This_Station + 1) % (Nmax_master + 1);
+        port->Poll_Station = (port->This_Station + 1) % (port->Nmax_master + 1);
         // Transmit a Poll For Master frame to PS.
         SendFrame(
+          port,
           FRAME_TYPE_POLL_FOR_MASTER,
-          Poll_Station,
-          This_Station,
+          port->Poll_Station,
+          port->This_Station,
           NULL,0);
         // indicate that the next station is unknown
-        Next_Station = This_Station;
-        RetryCount = 0;
-        TokenCount = 0;
-        EventCount = 0;
+        port->Next_Station = port->This_Station;
+        port->RetryCount = 0;
+        port->TokenCount = 0;
+        port->EventCount = 0;
         // enter the POLL_FOR_MASTER state to find a new successor to TS.
-        state = MSTP_MASTER_STATE_POLL_FOR_MASTER;
+        port->Master_State = MSTP_MASTER_STATE_POLL_FOR_MASTER;
       }
       break;
     // In the POLL_FOR_MASTER state, the node listens for a reply to 
@@ -1157,104 +1729,108 @@ void Master_Node_FSM(void)
     // a successor node.
     case MSTP_MASTER_STATE_POLL_FOR_MASTER:
       // ReceivedReplyToPFM
-      if ((ReceivedValidFrame == TRUE) &&
-          (DestinationAddress == This_Station) &&
-          (FrameType == FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER))
+      if ((port->ReceivedValidFrame == TRUE) &&
+          (port->DestinationAddress == port->This_Station) &&
+          (port->FrameType == FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER))
       {
-        SoleMaster = FALSE;
-        Next_Station = SourceAddress;
-        EventCount = 0;
+        port->SoleMaster = FALSE;
+        port->Next_Station = port->SourceAddress;
+        port->EventCount = 0;
         // Transmit a Token frame to NS
         SendFrame(
+          port,
           FRAME_TYPE_TOKEN,
-          Next_Station,
-          This_Station,
+          port->Next_Station,
+          port->This_Station,
           NULL,0);
-        Poll_Station = This_Station;
-        TokenCount = 0;
-        RetryCount = 0;
-        ReceivedValidFrame = FALSE;
-        state = MSTP_MASTER_STATE_PASS_TOKEN;
+        port->Poll_Station = port->This_Station;
+        port->TokenCount = 0;
+        port->RetryCount = 0;
+        port->ReceivedValidFrame = FALSE;
+        port->Master_State = MSTP_MASTER_STATE_PASS_TOKEN;
       }
       // ReceivedUnexpectedFrame
-      else if ((ReceivedValidFrame == TRUE) &&
-          ((DestinationAddress != This_Station) ||
-           (FrameType != FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER)))
+      else if ((port->ReceivedValidFrame == TRUE) &&
+          ((port->DestinationAddress != port->This_Station) ||
+           (port->FrameType != FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER)))
       {
         // An unexpected frame was received. 
         // This may indicate the presence of multiple tokens. 
-        ReceivedValidFrame = FALSE;
+        port->ReceivedValidFrame = FALSE;
         // enter the IDLE state to synchronize with the network. 
         // This action drops the token.
-        state = MSTP_MASTER_STATE_IDLE;
+        port->Master_State = MSTP_MASTER_STATE_IDLE;
       }
       // SoleMaster
-      else if ((SoleMaster == TRUE) &&
-          ((SilenceTimer >= Tusage_timeout) ||
-           (ReceivedInvalidFrame == TRUE)))
+      else if ((port->SoleMaster == TRUE) &&
+          ((port->SilenceTimer >= Tusage_timeout) ||
+           (port->ReceivedInvalidFrame == TRUE)))
       {
         // There was no valid reply to the periodic poll 
         // by the sole known master for other masters. 
-        FrameCount = 0;
-        ReceivedInvalidFrame = FALSE;
-        state = MSTP_MASTER_STATE_USE_TOKEN;
+        port->FrameCount = 0;
+        port->ReceivedInvalidFrame = FALSE;
+        port->Master_State = MSTP_MASTER_STATE_USE_TOKEN;
       }
       // DoneWithPFM
-      else if ((SoleMaster == FALSE) &&
-          (Next_Station != This_Station) &&
-          ((SilenceTimer >= Tusage_timeout) ||
-           (ReceivedInvalidFrame == TRUE)))
+      else if ((port->SoleMaster == FALSE) &&
+          (port->Next_Station != port->This_Station) &&
+          ((port->SilenceTimer >= Tusage_timeout) ||
+           (port->ReceivedInvalidFrame == TRUE)))
       {
         // There was no valid reply to the maintenance 
         // poll for a master at address PS. 
-        EventCount = 0;
+        port->EventCount = 0;
         // transmit a Token frame to NS
         SendFrame(
+          port,
           FRAME_TYPE_TOKEN,
-          Next_Station,
-          This_Station,
+          port->Next_Station,
+          port->This_Station,
           NULL,0);
-        RetryCount = 0;
-        ReceivedInvalidFrame = FALSE;
-        state = MSTP_MASTER_STATE_PASS_TOKEN;
+        port->RetryCount = 0;
+        port->ReceivedInvalidFrame = FALSE;
+        port->Master_State = MSTP_MASTER_STATE_PASS_TOKEN;
       }
       // SendNextPFM
-      else if ((SoleMaster == FALSE) &&
-        (Next_Station == This_Station) && // no known successor node
-        ((UINT8)((Poll_Station + 1) % (Nmax_master + 1)) != This_Station) &&
-        ((SilenceTimer >= Tusage_timeout) ||
-         (ReceivedInvalidFrame == TRUE)))
+      else if ((port->SoleMaster == FALSE) &&
+        (port->Next_Station == port->This_Station) && // no known successor node
+        ((UINT8)((port->Poll_Station + 1) % (port->Nmax_master + 1)) != port->This_Station) &&
+        ((port->SilenceTimer >= Tusage_timeout) ||
+         (port->ReceivedInvalidFrame == TRUE)))
       {
-        Poll_Station =  (Poll_Station + 1) % (Nmax_master + 1);
+        port->Poll_Station =  (port->Poll_Station + 1) % (port->Nmax_master + 1);
         // Transmit a Poll For Master frame to PS.
         SendFrame(
+          port,
           FRAME_TYPE_POLL_FOR_MASTER,
-          Poll_Station,
-          This_Station,
+          port->Poll_Station,
+          port->This_Station,
           NULL,0);
-        RetryCount = 0;
-        ReceivedInvalidFrame = FALSE;
+        port->RetryCount = 0;
+        port->ReceivedInvalidFrame = FALSE;
         // Re-enter the current state.
       }
       // DeclareSoleMaster
-      else if ((SoleMaster == FALSE) &&
-          (Next_Station == This_Station) && // no known successor node
-          ((UINT8)((Poll_Station + 1) % (Nmax_master + 1)) == This_Station) &&
-          ((SilenceTimer >= Tusage_timeout) ||
-           (ReceivedInvalidFrame == TRUE)))
+      else if ((port->SoleMaster == FALSE) &&
+          (port->Next_Station == port->This_Station) && // no known successor node
+          ((UINT8)((port->Poll_Station + 1) % (port->Nmax_master + 1)) == port->This_Station) &&
+          ((port->SilenceTimer >= Tusage_timeout) ||
+           (port->ReceivedInvalidFrame == TRUE)))
       {
         // to indicate that this station is the only master
-        SoleMaster = TRUE;
-        FrameCount = 0;
-        ReceivedInvalidFrame = FALSE;
-        state = MSTP_MASTER_STATE_USE_TOKEN;
+        port->SoleMaster = TRUE;
+        port->FrameCount = 0;
+        port->ReceivedInvalidFrame = FALSE;
+        port->Master_State = MSTP_MASTER_STATE_USE_TOKEN;
       }
       break;
     // The ANSWER_DATA_REQUEST state is entered when a 
     // BACnet Data Expecting Reply, a Test_Request, or 
     // a proprietary frame that expects a reply is received.
     case MSTP_MASTER_STATE_ANSWER_DATA_REQUEST:
-      if (ReplyPostponedTimer <= Treply_delay)
+      postpone = (port->ReplyPostponedTimer > Treply_delay);
+      if (!postpone)
       {
         // Reply
         // If a reply is available from the higher layers 
@@ -1275,15 +1851,18 @@ void Master_Node_FSM(void)
         // no information field. If the receiving node cannot detect 
         // the valid reception of frames with overlength information fields, 
         // then no response shall be returned.
-        if (FrameType == FRAME_TYPE_TEST_REQUEST)
+        if (port->FrameType == FRAME_TYPE_TEST_REQUEST)
         {
           SendFrame(
+            port,
             FRAME_TYPE_TEST_RESPONSE,
-            SourceAddress,
-            This_Station,
-            InputBuffer,Index);
+            port->SourceAddress,
+            port->This_Station,
+            port->InputBuffer,port->DataLength);
         }
-        state = MSTP_MASTER_STATE_IDLE;
+        // the mechanism here is Reply_Data, if the port has one
+        else if (port->Reply_Data)
+          postpone = !ReplyData(port);
       }
 
       //
@@ -1297,32 +1876,1338 @@ void Master_Node_FSM(void)
       // Call SendFrame to transmit a Reply Postponed frame, 
       // and enter the IDLE state.
 
-      else
+      if (postpone)
       {
+        // the higher layers reply when this node has the token
+        if (port->Reply_Data)
+          ReceiveData(port);
+        MSTP_STAT_ADD(port->Stats.replies_postponed_sent, 1);
         SendFrame(
+          port,
           FRAME_TYPE_REPLY_POSTPONED,
-          SourceAddress,
-          This_Station,
+          port->SourceAddress,
+          port->This_Station,
           NULL,0);
-        state = MSTP_MASTER_STATE_IDLE;
       }
+      port->Master_State = MSTP_MASTER_STATE_IDLE;
       break;
     default:
-      state = MSTP_MASTER_STATE_IDLE; 
+      port->Master_State = MSTP_MASTER_STATE_IDLE; 
       break;
   }
 
   return;
 }
 
-#ifdef TEST_MSTP
-void main(void)
+#ifdef TEST
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mstptest.h"
+#include "ctest.h"
+
+// a frame as seen by the Master Node State Machine
+struct test_frame
 {
-  while (TRUE)
+  BOOLEAN valid;
+  UINT8 frame_type;
+  UINT8 destination;
+  UINT8 source;
+  unsigned data_len;
+  UINT8 data[MSTP_EXTENDED_DATA_MAX];
+};
+
+#define TEST_FRAMES_MAX 64
+struct test_frames
+{
+  unsigned count;
+  struct test_frame frame[TEST_FRAMES_MAX];
+};
+
+// takes any frame indicated by the receive state machine
+static void test_take_frame(struct MSTP_Port *port, struct test_frames *frames)
+{
+  struct test_frame *frame;
+
+  if ((port->ReceivedValidFrame || port->ReceivedInvalidFrame) &&
+      (frames->count < TEST_FRAMES_MAX))
   {
-    Master_Node_FSM();
-    Receive_Frame_FSM();
-    Check_UART_Data();
+    frame = &frames->frame[frames->count++];
+    frame->valid = port->ReceivedValidFrame;
+    frame->frame_type = port->FrameType;
+    frame->destination = port->DestinationAddress;
+    frame->source = port->SourceAddress;
+    frame->data_len = 0;
+    if (port->ReceivedValidFrame)
+    {
+      frame->data_len = port->DataLength;
+      memcpy(frame->data, port->InputBuffer, port->DataLength);
+    }
   }
+  port->ReceivedValidFrame = FALSE;
+  port->ReceivedInvalidFrame = FALSE;
+
+  return;
 }
-#endif
+
+// feeds the octets through the octet-at-a-time state machine
+static void test_receive_fsm(
+  struct MSTP_Port *port,
+  const UINT8 *buffer,
+  unsigned length,
+  struct test_frames *frames)
+{
+  unsigned i;
+
+  for (i = 0; i < length; i++)
+  {
+    port->DataRegister = buffer[i];
+    port->DataAvailable = TRUE;
+    while (port->DataAvailable)
+    {
+      Receive_Frame_FSM(port);
+      test_take_frame(port, frames);
+    }
+  }
+  // states that validate without an octet
+  Receive_Frame_FSM(port);
+  test_take_frame(port, frames);
+
+  return;
+}
+
+// feeds the octets through the block receive
+static void test_receive_octets(
+  struct MSTP_Port *port,
+  const UINT8 *buffer,
+  unsigned length,
+  struct test_frames *frames)
+{
+  unsigned count;
+
+  do
+  {
+    count = MSTP_Receive_Octets(port, buffer, length);
+    test_take_frame(port, frames);
+    buffer += count;
+    length -= count;
+  } while (length);
+
+  return;
+}
+
+static BOOLEAN test_frames_same(
+  const struct test_frames *a,
+  const struct test_frames *b)
+{
+  unsigned i;
+
+  if (a->count != b->count)
+    return FALSE;
+  for (i = 0; i < a->count; i++)
+  {
+    if ((a->frame[i].valid != b->frame[i].valid) ||
+        (a->frame[i].frame_type != b->frame[i].frame_type) ||
+        (a->frame[i].destination != b->frame[i].destination) ||
+        (a->frame[i].source != b->frame[i].source) ||
+        (a->frame[i].data_len != b->frame[i].data_len) ||
+        memcmp(a->frame[i].data, b->frame[i].data, a->frame[i].data_len))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+// a stream with noise, good frames, a frame for another node,
+// a bad header CRC and a bad data CRC
+static const struct Test_Stream_Frame Test_Stream_Frames[] = {
+  {{0x00, 0x55, 0x12}, 3, FRAME_TYPE_TOKEN, 1, 2, 0, 0, 0},
+  {{0}, 0, FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY, 1, 3, 24, 0, 0},
+  {{0}, 0, FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 7, 3, 40, 0, 0},
+  {{0}, 0, FRAME_TYPE_POLL_FOR_MASTER, 1, 4, 0, 7, 0x01},
+  {{0}, 0, FRAME_TYPE_TEST_REQUEST, MSTP_BROADCAST_ADDRESS, 5, 100, 20, 0x80},
+  {{0x55}, 1, FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY,
+    MSTP_BROADCAST_ADDRESS, 6, INPUT_BUFFER_SIZE, 0, 0}
+};
+
+static unsigned test_stream(UINT8 *buffer, unsigned size)
+{
+  UINT8 data[INPUT_BUFFER_SIZE];
+  unsigned i;
+
+  for (i = 0; i < sizeof(data); i++)
+  {
+    data[i] = (UINT8)(i * 7);
+  }
+  data[10] = 0x55;
+  data[11] = 0xFF;
+
+  return Test_Stream(buffer, size, Test_Stream_Frames,
+    sizeof(Test_Stream_Frames) / sizeof(Test_Stream_Frames[0]), data, NULL);
+}
+
+void testReceiveOctets(Test* pTest)
+{
+  static struct MSTP_Port port_fsm, port_octets;
+  static struct test_frames frames_fsm, frames_octets;
+  static UINT8 buffer[2048];
+  unsigned length;
+  unsigned split;
+
+  length = test_stream(buffer, sizeof(buffer));
+  MSTP_Init(&port_fsm, 1);
+  memset(&frames_fsm, 0, sizeof(frames_fsm));
+  test_receive_fsm(&port_fsm, buffer, length, &frames_fsm);
+  ct_test(pTest, frames_fsm.count == 6);
+  ct_test(pTest, frames_fsm.frame[0].valid);
+  ct_test(pTest, frames_fsm.frame[0].frame_type == FRAME_TYPE_TOKEN);
+  ct_test(pTest, frames_fsm.frame[1].valid);
+  ct_test(pTest, frames_fsm.frame[1].data_len == 24);
+  // the data of the frame that is not for us is hunted for a
+  // preamble, and the X'55' X'FF' in it starts a bad header
+  ct_test(pTest, !frames_fsm.frame[2].valid);
+  ct_test(pTest, !frames_fsm.frame[3].valid);
+  ct_test(pTest, frames_fsm.frame[3].frame_type == FRAME_TYPE_POLL_FOR_MASTER);
+  ct_test(pTest, !frames_fsm.frame[4].valid);
+  ct_test(pTest, frames_fsm.frame[4].frame_type == FRAME_TYPE_TEST_REQUEST);
+  ct_test(pTest, frames_fsm.frame[5].valid);
+  ct_test(pTest, frames_fsm.frame[5].data_len == INPUT_BUFFER_SIZE);
+
+  // the whole stream in one block
+  MSTP_Init(&port_octets, 1);
+  memset(&frames_octets, 0, sizeof(frames_octets));
+  test_receive_octets(&port_octets, buffer, length, &frames_octets);
+  ct_test(pTest, test_frames_same(&frames_fsm, &frames_octets));
+  ct_test(pTest, port_octets.EventCount == port_fsm.EventCount);
+
+  // the stream split into two blocks at every octet
+  for (split = 0; split <= length; split++)
+  {
+    MSTP_Init(&port_octets, 1);
+    memset(&frames_octets, 0, sizeof(frames_octets));
+    test_receive_octets(&port_octets, buffer, split, &frames_octets);
+    test_receive_octets(&port_octets, &buffer[split], length - split,
+      &frames_octets);
+    ct_test(pTest, test_frames_same(&frames_fsm, &frames_octets));
+  }
+
+  return;
+}
+
+// frames in line noise that is full of preamble octets are found
+// alike by both receive paths, with every preamble scanner
+void testReceiveNoise(Test* pTest)
+{
+  static struct MSTP_Port port_fsm, port_octets;
+  static struct test_frames frames_fsm, frames_octets;
+  static UINT8 buffer[4096];
+  static const PREAMBLE_METHOD methods[] =
+  {
+    PREAMBLE_METHOD_BYTEWISE, PREAMBLE_METHOD_MEMCHR,
+    PREAMBLE_METHOD_SSE2, PREAMBLE_METHOD_AVX2, PREAMBLE_METHOD_AUTO
+  };
+  UINT8 data[64];
+  unsigned length = 0;
+  unsigned block;
+  unsigned count;
+  unsigned i, m;
+
+  srand(2);
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (UINT8)rand();
+  while (length < (sizeof(buffer) - 256))
+  {
+    // noise, then a frame
+    count = rand() % 160;
+    for (i = 0; i < count; i++)
+    {
+      buffer[length] = (UINT8)rand();
+      if ((rand() % 4) == 0)
+        buffer[length] = (rand() & 1) ? 0x55 : 0xFF;
+      length++;
+    }
+    length += MSTP_Create_Frame(&buffer[length], sizeof(buffer) - length,
+      FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 1, 2, data,
+      rand() % sizeof(data));
+  }
+  MSTP_Init(&port_fsm, 1);
+  memset(&frames_fsm, 0, sizeof(frames_fsm));
+  test_receive_fsm(&port_fsm, buffer, length, &frames_fsm);
+  ct_test(pTest, frames_fsm.count > 20);
+  for (m = 0; m < sizeof(methods)/sizeof(methods[0]); m++)
+  {
+    for (block = 1; block <= 256; block *= 4)
+    {
+      MSTP_Init(&port_octets, 1);
+      port_octets.Preamble_Find = Preamble_Engine(methods[m]);
+      memset(&frames_octets, 0, sizeof(frames_octets));
+      for (i = 0; i < length; i += count)
+      {
+        count = (length - i) < block ? (length - i) : block;
+        test_receive_octets(&port_octets, &buffer[i], count,
+          &frames_octets);
+      }
+      ct_test(pTest, test_frames_same(&frames_fsm, &frames_octets));
+      ct_test(pTest, port_octets.EventCount == port_fsm.EventCount);
+    }
+  }
+
+  return;
+}
+
+// feeds the entries through the ring, as the FSM thread would
+static void test_receive_ring(
+  struct MSTP_Port *port,
+  SPSC_RING *ring,
+  struct test_frames *frames)
+{
+  do
+  {
+    (void)MSTP_Receive_Ring(port, ring);
+    test_take_frame(port, frames);
+  } while (Ringbuf_SPSC_Count(ring));
+  // states that validate without an octet
+  (void)MSTP_Receive_Ring(port, ring);
+  test_take_frame(port, frames);
+
+  return;
+}
+
+// the same stream with an error in place of the octet at error_index
+static unsigned test_ring_entries(
+  uint16_t *entries,
+  const UINT8 *buffer,
+  unsigned length,
+  unsigned error_index)
+{
+  unsigned i;
+
+  for (i = 0; i < length; i++)
+  {
+    entries[i] = buffer[i];
+  }
+  if (error_index < length)
+    entries[error_index] = MSTP_RING_ERROR;
+
+  return length;
+}
+
+void testReceiveRing(Test* pTest)
+{
+  static struct MSTP_Port port_fsm, port_ring;
+  static struct test_frames frames_fsm, frames_ring;
+  static UINT8 buffer[2048];
+  static uint16_t entries[2048];
+  static uint16_t ring_store[2048];
+  static SPSC_RING ring;
+  unsigned length;
+  unsigned error_index;
+  unsigned sent;
+
+  length = test_stream(buffer, sizeof(buffer));
+  (void)test_ring_entries(entries, buffer, length, length);
+  MSTP_Init(&port_fsm, 1);
+  memset(&frames_fsm, 0, sizeof(frames_fsm));
+  test_receive_fsm(&port_fsm, buffer, length, &frames_fsm);
+
+  // the whole stream in a ring that holds it
+  (void)Ringbuf_SPSC_Init(&ring, ring_store, 2048);
+  MSTP_Init(&port_ring, 1);
+  memset(&frames_ring, 0, sizeof(frames_ring));
+  ct_test(pTest, Ringbuf_SPSC_Put_Block(&ring, entries, length) == length);
+  test_receive_ring(&port_ring, &ring, &frames_ring);
+  ct_test(pTest, test_frames_same(&frames_fsm, &frames_ring));
+  ct_test(pTest, port_ring.EventCount == port_fsm.EventCount);
+
+  // a small ring that wraps many times, filled and drained in turn
+  (void)Ringbuf_SPSC_Init(&ring, ring_store, 32);
+  MSTP_Init(&port_ring, 1);
+  memset(&frames_ring, 0, sizeof(frames_ring));
+  sent = 0;
+  while (sent < length)
+  {
+    sent += Ringbuf_SPSC_Put_Block(&ring, &entries[sent], length - sent);
+    (void)MSTP_Receive_Ring(&port_ring, &ring);
+    test_take_frame(&port_ring, &frames_ring);
+  }
+  test_receive_ring(&port_ring, &ring, &frames_ring);
+  ct_test(pTest, test_frames_same(&frames_fsm, &frames_ring));
+
+  // an error anywhere gives the same frames as Receive_Frame_FSM
+  for (error_index = 0; error_index < 300; error_index++)
+  {
+    MSTP_Init(&port_fsm, 1);
+    memset(&frames_fsm, 0, sizeof(frames_fsm));
+    test_receive_fsm(&port_fsm, buffer, error_index, &frames_fsm);
+    port_fsm.ReceiveError = TRUE;
+    while (port_fsm.ReceiveError)
+    {
+      Receive_Frame_FSM(&port_fsm);
+      test_take_frame(&port_fsm, &frames_fsm);
+    }
+    test_receive_fsm(&port_fsm, &buffer[error_index + 1],
+      length - error_index - 1, &frames_fsm);
+
+    (void)test_ring_entries(entries, buffer, length, error_index);
+    (void)Ringbuf_SPSC_Init(&ring, ring_store, 2048);
+    MSTP_Init(&port_ring, 1);
+    memset(&frames_ring, 0, sizeof(frames_ring));
+    (void)Ringbuf_SPSC_Put_Block(&ring, entries, length);
+    test_receive_ring(&port_ring, &ring, &frames_ring);
+    ct_test(pTest, test_frames_same(&frames_fsm, &frames_ring));
+    ct_test(pTest, port_ring.EventCount == port_fsm.EventCount);
+  }
+
+  return;
+}
+
+// a reader thread fills the ring in bursts while this thread drains it
+#define TEST_RING_STREAMS 2000
+struct test_reader
+{
+  SPSC_RING ring;
+  uint16_t entries[2048];
+  unsigned length;
+};
+
+static void *test_reader_thread(void *arg)
+{
+  struct test_reader *reader = arg;
+  unsigned stream;
+  unsigned sent;
+  unsigned count;
+  uint32_t seed = 3;
+
+  for (stream = 0; stream < TEST_RING_STREAMS; stream++)
+  {
+    sent = 0;
+    while (sent < reader->length)
+    {
+      // as much as one read() of a UART FIFO
+      seed = seed * 1103515245 + 12345;
+      count = 1 + ((seed >> 16) % 64);
+      if (count > reader->length - sent)
+        count = reader->length - sent;
+      count = Ringbuf_SPSC_Put_Block(&reader->ring,
+        &reader->entries[sent], count);
+      if (!count)
+        sched_yield();
+      sent += count;
+    }
+  }
+
+  return NULL;
+}
+
+void testReceiveRingThreads(Test* pTest)
+{
+  static struct MSTP_Port port_fsm, port_ring;
+  static struct test_frames frames_fsm;
+  static UINT8 buffer[2048];
+  static uint16_t ring_store[256];
+  static struct test_reader reader;
+  pthread_t thread;
+  unsigned long entries = 0;
+  unsigned long valid = 0;
+  unsigned long invalid = 0;
+  unsigned long valid_fsm = 0;
+  unsigned i;
+
+  reader.length = test_stream(buffer, sizeof(buffer));
+  MSTP_Init(&port_fsm, 1);
+  memset(&frames_fsm, 0, sizeof(frames_fsm));
+  test_receive_fsm(&port_fsm, buffer, reader.length, &frames_fsm);
+  for (i = 0; i < frames_fsm.count; i++)
+  {
+    if (frames_fsm.frame[i].valid)
+      valid_fsm++;
+  }
+  for (i = 0; i < reader.length; i++)
+  {
+    reader.entries[i] = buffer[i];
+  }
+  (void)Ringbuf_SPSC_Init(&reader.ring, ring_store, 256);
+  MSTP_Init(&port_ring, 1);
+  pthread_create(&thread, NULL, test_reader_thread, &reader);
+  while (entries < (unsigned long)reader.length * TEST_RING_STREAMS)
+  {
+    i = MSTP_Receive_Ring(&port_ring, &reader.ring);
+    if (!i)
+      sched_yield();
+    entries += i;
+    if (port_ring.ReceivedValidFrame)
+      valid++;
+    if (port_ring.ReceivedInvalidFrame)
+      invalid++;
+    port_ring.ReceivedValidFrame = FALSE;
+    port_ring.ReceivedInvalidFrame = FALSE;
+  }
+  pthread_join(thread, NULL);
+  ct_test(pTest, entries == (unsigned long)reader.length * TEST_RING_STREAMS);
+  ct_test(pTest, valid == valid_fsm * TEST_RING_STREAMS);
+  ct_test(pTest, valid + invalid == frames_fsm.count * TEST_RING_STREAMS);
+  ct_test(pTest, Ringbuf_SPSC_Count(&reader.ring) == 0);
+
+  return;
+}
+
+// a gap longer than Tframe_abort inside a frame discards it
+void testReceiveTimeout(Test* pTest)
+{
+  static struct MSTP_Port port_fsm, port_octets;
+  static struct test_frames frames_fsm, frames_octets;
+  UINT8 data[32] = {0};
+  UINT8 buffer[64];
+  unsigned length;
+  unsigned split;
+
+  length = MSTP_Create_Frame(buffer, sizeof(buffer),
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 1, 2, data, sizeof(data));
+  for (split = 1; split < length; split++)
+  {
+    MSTP_Init(&port_fsm, 1);
+    MSTP_Init(&port_octets, 1);
+    memset(&frames_fsm, 0, sizeof(frames_fsm));
+    memset(&frames_octets, 0, sizeof(frames_octets));
+    test_receive_fsm(&port_fsm, buffer, split, &frames_fsm);
+    test_receive_octets(&port_octets, buffer, split, &frames_octets);
+    port_fsm.SilenceTimer = port_fsm.Timing->Tframe_abort + 1;
+    port_octets.SilenceTimer = port_octets.Timing->Tframe_abort + 1;
+    test_receive_fsm(&port_fsm, &buffer[split], length - split,
+      &frames_fsm);
+    test_receive_octets(&port_octets, &buffer[split], length - split,
+      &frames_octets);
+    ct_test(pTest, test_frames_same(&frames_fsm, &frames_octets));
+    if (split >= 3)
+    {
+      // the frame was aborted after the preamble
+      ct_test(pTest, frames_octets.count == 1);
+      ct_test(pTest, !frames_octets.frame[0].valid);
+    }
+  }
+
+  return;
+}
+
+// the timing of each baud rate, and a frame abort that follows it
+void testTiming(Test* pTest)
+{
+  static struct MSTP_Port port;
+  static const unsigned bauds[] = {9600, 19200, 38400, 57600, 76800, 115200};
+  static const unsigned frame_abort[] = {7, 4, 2, 2, 1, 1};
+  const struct MSTP_Timing *timing;
+  UINT8 buffer[16];
+  unsigned i;
+
+  for (i = 0; i < sizeof(bauds)/sizeof(bauds[0]); i++)
+  {
+    timing = MSTP_Timing_Find(bauds[i]);
+    ct_test(pTest, timing != NULL);
+    ct_test(pTest, timing->baud == bauds[i]);
+    ct_test(pTest, timing->Tframe_abort == frame_abort[i]);
+    // not less than 60 bit times
+    ct_test(pTest, timing->Tframe_abort * bauds[i] >= 60 * 1000);
+    ct_test(pTest, timing->Toctet == 10000000000ULL / bauds[i]);
+    // a minimum is rounded up, and a maximum down
+    ct_test(pTest, timing->Tturnaround * bauds[i] >= 40000000000ULL);
+    ct_test(pTest, timing->Tturnaround * bauds[i] < 40000000000ULL + bauds[i]);
+    ct_test(pTest, timing->Troff * bauds[i] >= 30000000000ULL);
+    ct_test(pTest, timing->Tframe_gap * bauds[i] <= 20000000000ULL);
+    ct_test(pTest, timing->Tpostdrive * bauds[i] <= 15000000000ULL);
+    if (i > 0)
+    {
+      ct_test(pTest, timing->Tturnaround < timing[-1].Tturnaround);
+    }
+  }
+  ct_test(pTest, MSTP_Timing_Find(0) == NULL);
+  ct_test(pTest, MSTP_Timing_Find(4800) == NULL);
+  // a port is 9600 baud until it is set, and keeps its timing
+  // for a rate that MS/TP does not have
+  MSTP_Init(&port, 1);
+  ct_test(pTest, port.Timing == MSTP_Timing_Find(9600));
+  ct_test(pTest, MSTP_Timing_Set(&port, 115200) == TRUE);
+  ct_test(pTest, port.Timing == MSTP_Timing_Find(115200));
+  ct_test(pTest, MSTP_Timing_Set(&port, 4800) == FALSE);
+  ct_test(pTest, port.Timing == MSTP_Timing_Find(115200));
+
+  // a gap of 2 milliseconds in a frame aborts it at 115200 baud,
+  // but not at 9600 baud
+  (void)MSTP_Create_Frame(buffer, sizeof(buffer),
+    FRAME_TYPE_TOKEN, 2, 1, NULL, 0);
+  for (i = 0; i < 2; i++)
+  {
+    MSTP_Init(&port, 2);
+    (void)MSTP_Timing_Set(&port, i ? 115200 : 9600);
+    port.Master_State = MSTP_MASTER_STATE_IDLE;
+    (void)MSTP_Receive_Octets(&port, buffer, 4);
+    ct_test(pTest, MSTP_Timeout(&port) == port.Timing->Tframe_abort + 1);
+    MSTP_Timer_Elapsed(&port, 2);
+    (void)MSTP_Receive_Octets(&port, &buffer[4], 4);
+    ct_test(pTest, port.ReceivedValidFrame == (i ? FALSE : TRUE));
+    ct_test(pTest, port.ReceivedInvalidFrame == (i ? TRUE : FALSE));
+  }
+
+  return;
+}
+
+// the state machines wait exactly until the deadline
+static void test_deadline(
+  Test* pTest,
+  struct MSTP_Port *port,
+  unsigned timeout)
+{
+  MSTP_MASTER_STATE state = port->Master_State;
+
+  ct_test(pTest, MSTP_Timeout(port) == timeout);
+  MSTP_Timer_Elapsed(port, timeout - 1);
+  Master_Node_FSM(port);
+  ct_test(pTest, port->Master_State == state);
+  ct_test(pTest, MSTP_Timeout(port) == 1);
+  MSTP_Timer_Elapsed(port, 1);
+  ct_test(pTest, MSTP_Timeout(port) == 0);
+  Master_Node_FSM(port);
+  // either a new state, or a frame sent again from the same state
+  ct_test(pTest, (port->Master_State != state) || (port->SilenceTimer == 0));
+
+  return;
+}
+
+void testTimeout(Test* pTest)
+{
+  static struct MSTP_Port port;
+  UINT8 buffer[MAX_FRAME_SIZE];
+  unsigned length;
+
+  MSTP_Init(&port, 5);
+  port.Nmax_master = 7;
+  ct_test(pTest, MSTP_Timeout(&port) == 0);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_IDLE);
+  // loss of token, then our slot in NO_TOKEN
+  test_deadline(pTest, &port, Tno_token);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_NO_TOKEN);
+  test_deadline(pTest, &port, Tslot * 5);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_POLL_FOR_MASTER);
+  // SendFrame cleared SilenceTimer
+  test_deadline(pTest, &port, Tusage_timeout);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_POLL_FOR_MASTER);
+  ct_test(pTest, port.Poll_Station == 7);
+  // the last station to poll, then sole master
+  test_deadline(pTest, &port, Tusage_timeout);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_POLL_FOR_MASTER);
+  ct_test(pTest, port.Poll_Station == 0);
+  port.Poll_Station = 4;
+  test_deadline(pTest, &port, Tusage_timeout);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_USE_TOKEN);
+  ct_test(pTest, MSTP_Timeout(&port) == 0);
+
+  // a NO_TOKEN past our slot waits for an octet
+  MSTP_Init(&port, 5);
+  port.Master_State = MSTP_MASTER_STATE_NO_TOKEN;
+  port.SilenceTimer = Tno_token + (Tslot * 6);
+  ct_test(pTest, MSTP_Timeout(&port) == MSTP_TIMEOUT_NONE);
+  port.EventCount = Nmin_octets + 1;
+  ct_test(pTest, MSTP_Timeout(&port) == 0);
+
+  // passing the token, and waiting for a reply
+  MSTP_Init(&port, 5);
+  port.Master_State = MSTP_MASTER_STATE_PASS_TOKEN;
+  test_deadline(pTest, &port, Tusage_timeout);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_PASS_TOKEN);
+  ct_test(pTest, port.RetryCount == 1);
+  port.Master_State = MSTP_MASTER_STATE_WAIT_FOR_REPLY;
+  port.SilenceTimer = 0;
+  test_deadline(pTest, &port, Treply_timeout);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_DONE_WITH_TOKEN);
+
+  // a frame in progress is aborted, and a frame that is waiting is due
+  MSTP_Init(&port, 5);
+  port.Master_State = MSTP_MASTER_STATE_IDLE;
+  length = MSTP_Create_Frame(buffer, sizeof(buffer),
+    FRAME_TYPE_TOKEN, 5, 2, NULL, 0);
+  (void)MSTP_Receive_Octets(&port, buffer, 4);
+  ct_test(pTest, MSTP_Timeout(&port) == port.Timing->Tframe_abort + 1);
+  MSTP_Timer_Elapsed(&port, port.Timing->Tframe_abort + 1);
+  ct_test(pTest, MSTP_Timeout(&port) == 0);
+  (void)MSTP_Receive_Octets(&port, buffer, 0);
+  ct_test(pTest, port.ReceivedInvalidFrame == TRUE);
+  ct_test(pTest, MSTP_Timeout(&port) == 0);
+  Master_Node_FSM(&port);
+  ct_test(pTest,
+    MSTP_Timeout(&port) == Tno_token - port.Timing->Tframe_abort - 1);
+  (void)MSTP_Receive_Octets(&port, buffer, length);
+  ct_test(pTest, port.ReceivedValidFrame == TRUE);
+  ct_test(pTest, MSTP_Timeout(&port) == 0);
+  // but not in a state that leaves it for later
+  port.Master_State = MSTP_MASTER_STATE_NO_TOKEN;
+  port.SilenceTimer = Tno_token + (Tslot * 6);
+  port.EventCount = 0;
+  ct_test(pTest, MSTP_Timeout(&port) == MSTP_TIMEOUT_NONE);
+  port.Master_State = MSTP_MASTER_STATE_PASS_TOKEN;
+  port.SilenceTimer = 0;
+  ct_test(pTest, MSTP_Timeout(&port) == Tusage_timeout);
+
+  // the timers saturate
+  MSTP_Timer_Elapsed(&port, 0xFFFFFFFF);
+  ct_test(pTest, port.SilenceTimer == 0xFFFF);
+  ct_test(pTest, port.ReplyPostponedTimer == 0xFFFF);
+
+  return;
+}
+
+// receives a frame for the Master Node State Machine, and runs it
+// until it waits
+static void test_master_receive(
+  struct MSTP_Port *port,
+  UINT8 frame_type,
+  UINT8 destination,
+  UINT8 source,
+  UINT8 *data,
+  unsigned data_len)
+{
+  UINT8 buffer[MSTP_EXTENDED_FRAME_SIZE];
+  unsigned length;
+  unsigned i;
+
+  length = MSTP_Create_Frame(buffer, sizeof(buffer), frame_type,
+    destination, source, data, data_len);
+  (void)MSTP_Receive_Octets(port, buffer, length);
+  for (i = 0; i < 8; i++)
+    Master_Node_FSM(port);
+
+  return;
+}
+
+void testStats(Test* pTest)
+{
+  static struct MSTP_Port port_fsm, port_octets;
+  static struct MSTP_Port port;
+  static struct test_frames frames;
+  static struct MSTP_Queue queue;
+  static struct MSTP_Queue_Frame queued[MSTP_QUEUE_LANES * 4];
+  static UINT8 buffer[2048];
+  UINT8 request[4] = {1, 2, 3, 4};
+  UINT8 reply[10] = {0};
+  unsigned length;
+  unsigned i;
+
+  // both receive paths count the same
+  length = test_stream(buffer, sizeof(buffer));
+  MSTP_Init(&port_fsm, 1);
+  MSTP_Init(&port_octets, 1);
+  memset(&frames, 0, sizeof(frames));
+  test_receive_fsm(&port_fsm, buffer, length, &frames);
+  memset(&frames, 0, sizeof(frames));
+  test_receive_octets(&port_octets, buffer, length, &frames);
+  ct_test(pTest, memcmp(&port_fsm.Stats, &port_octets.Stats,
+    sizeof(struct MSTP_Stats)) == 0);
+  ct_test(pTest, port_octets.Stats.octets_received == length);
+  ct_test(pTest, port_octets.Stats.frames_received[FRAME_TYPE_TOKEN] == 1);
+  ct_test(pTest, port_octets.Stats.frames_received[
+    FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY] == 1);
+  ct_test(pTest, port_octets.Stats.frames_received[
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY] == 1);
+  ct_test(pTest, port_octets.Stats.frames_not_for_us == 1);
+  // the bad header found in the data of the frame for another station
+  ct_test(pTest, port_octets.Stats.header_crc_errors +
+    port_octets.Stats.frames_too_long == 2);
+  ct_test(pTest, port_octets.Stats.data_crc_errors == 1);
+  // timeouts and errors
+  port_octets.Receive_State = MSTP_RECEIVE_STATE_HEADER;
+  port_octets.SilenceTimer = port_octets.Timing->Tframe_abort + 1;
+  (void)MSTP_Receive_Octets(&port_octets, buffer, 0);
+  port_fsm.Receive_State = MSTP_RECEIVE_STATE_HEADER;
+  port_fsm.SilenceTimer = port_fsm.Timing->Tframe_abort + 1;
+  Receive_Frame_FSM(&port_fsm);
+  port_octets.ReceiveError = TRUE;
+  (void)MSTP_Receive_Octets(&port_octets, buffer, 0);
+  port_fsm.ReceiveError = TRUE;
+  Receive_Frame_FSM(&port_fsm);
+  ct_test(pTest, port_octets.Stats.frame_aborts == 1);
+  ct_test(pTest, port_octets.Stats.receive_errors == 1);
+  ct_test(pTest, memcmp(&port_fsm.Stats, &port_octets.Stats,
+    sizeof(struct MSTP_Stats)) == 0);
+
+  // the token comes around every 100 ms
+  MSTP_Init(&port, 5);
+  port.Nmax_master = 7;
+  port.Next_Station = 6;
+  Master_Node_FSM(&port);
+  port.Next_Station = 6;
+  for (i = 0; i < 4; i++)
+  {
+    test_master_receive(&port, FRAME_TYPE_TOKEN, 5, 4, NULL, 0);
+    MSTP_Timer_Elapsed(&port, 100);
+  }
+  ct_test(pTest, port.Stats.tokens_received == 4);
+  ct_test(pTest, port.Stats.token_rotation.count == 3);
+  ct_test(pTest, port.Stats.token_rotation.max == 100);
+  ct_test(pTest, MSTP_Histogram_Percentile(&port.Stats.token_rotation,
+    50.0) == 100);
+  ct_test(pTest, port.Stats.frames_sent[FRAME_TYPE_TOKEN] == 4);
+  ct_test(pTest, port.Stats.octets_sent == 4 * MSTP_HEADER_SIZE);
+  // the last token was not used by NS, so it is passed again,
+  // and then given up on
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_PASS_TOKEN);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Stats.token_retries == 1);
+  MSTP_Timer_Elapsed(&port, Tusage_timeout);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Stats.token_pass_failures == 1);
+  ct_test(pTest, port.Stats.frames_sent[FRAME_TYPE_POLL_FOR_MASTER] == 1);
+  // silence
+  port.Master_State = MSTP_MASTER_STATE_IDLE;
+  MSTP_Timer_Elapsed(&port, Tno_token);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Stats.lost_tokens == 1);
+
+  // a request that is answered in 30 ms, postponed, or not answered
+  MSTP_Init(&port, 5);
+  (void)MSTP_Queue_Init(&queue, queued, 4);
+  for (i = 0; i < 3; i++)
+    (void)MSTP_Queue_Put(&queue, FALSE, FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY,
+      9, request, sizeof(request));
+  port.Queue = &queue;
+  Master_Node_FSM(&port);
+  test_master_receive(&port, FRAME_TYPE_TOKEN, 5, 4, NULL, 0);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_WAIT_FOR_REPLY);
+  ct_test(pTest, port.Stats.frames_sent[
+    FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY] == 1);
+  MSTP_Timer_Elapsed(&port, 30);
+  test_master_receive(&port, FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY,
+    5, 9, reply, sizeof(reply));
+  ct_test(pTest, port.Stats.reply_latency.count == 1);
+  ct_test(pTest, port.Stats.reply_latency.max == 30);
+  port.Master_State = MSTP_MASTER_STATE_IDLE;
+  test_master_receive(&port, FRAME_TYPE_TOKEN, 5, 4, NULL, 0);
+  test_master_receive(&port, FRAME_TYPE_REPLY_POSTPONED, 5, 9, NULL, 0);
+  ct_test(pTest, port.Stats.replies_postponed_received == 1);
+  port.Master_State = MSTP_MASTER_STATE_IDLE;
+  test_master_receive(&port, FRAME_TYPE_TOKEN, 5, 4, NULL, 0);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_WAIT_FOR_REPLY);
+  MSTP_Timer_Elapsed(&port, Treply_timeout);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Stats.reply_timeouts == 1);
+  ct_test(pTest, port.Stats.reply_latency.count == 1);
+
+  // a request for us that is not answered in time is postponed
+  MSTP_Init(&port, 5);
+  Master_Node_FSM(&port);
+  length = MSTP_Create_Frame(buffer, sizeof(buffer),
+    FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY, 5, 9, reply, sizeof(reply));
+  (void)MSTP_Receive_Octets(&port, buffer, length);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_ANSWER_DATA_REQUEST);
+  MSTP_Timer_Elapsed(&port, Treply_delay + 1);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Stats.replies_postponed_sent == 1);
+  ct_test(pTest, port.Stats.frames_sent[FRAME_TYPE_REPLY_POSTPONED] == 1);
+
+  return;
+}
+
+// each token sends up to Nmax_info_frames of the queued frames
+void testUseToken(Test* pTest)
+{
+  static struct MSTP_Port port;
+  static struct MSTP_Queue queue;
+  static struct MSTP_Queue_Frame queued[MSTP_QUEUE_LANES * 8];
+  UINT8 data[8] = {0};
+  unsigned i;
+
+  MSTP_Init(&port, 5);
+  port.Nmax_info_frames = 3;
+  ct_test(pTest, MSTP_Queue_Init(&queue, queued, 8));
+  Master_Node_FSM(&port);
+  port.Next_Station = 6;
+  // nothing to send
+  test_master_receive(&port, FRAME_TYPE_TOKEN, 5, 4, NULL, 0);
+  ct_test(pTest, port.Stats.frames_sent[FRAME_TYPE_TOKEN] == 1);
+  port.Queue = &queue;
+  port.Master_State = MSTP_MASTER_STATE_IDLE;
+  test_master_receive(&port, FRAME_TYPE_TOKEN, 5, 4, NULL, 0);
+  ct_test(pTest, port.Stats.frames_sent[FRAME_TYPE_TOKEN] == 2);
+  ct_test(pTest, port.Stats.frames_sent[
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY] == 0);
+  for (i = 0; i < 5; i++)
+    ct_test(pTest, MSTP_Queue_Put(&queue, FALSE,
+      FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 7, data, sizeof(data)));
+  port.Master_State = MSTP_MASTER_STATE_IDLE;
+  test_master_receive(&port, FRAME_TYPE_TOKEN, 5, 4, NULL, 0);
+  ct_test(pTest, port.Stats.frames_sent[
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY] == 3);
+  ct_test(pTest, port.Stats.frames_sent[FRAME_TYPE_TOKEN] == 3);
+  ct_test(pTest, port.Stats.octets_sent ==
+    (6 * MSTP_HEADER_SIZE) + (3 * (sizeof(data) + 2)));
+  ct_test(pTest, MSTP_Queue_Count(&queue) == 2);
+  port.Master_State = MSTP_MASTER_STATE_IDLE;
+  test_master_receive(&port, FRAME_TYPE_TOKEN, 5, 4, NULL, 0);
+  ct_test(pTest, port.Stats.frames_sent[
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY] == 5);
+  ct_test(pTest, port.Stats.frames_sent[FRAME_TYPE_TOKEN] == 4);
+  ct_test(pTest, MSTP_Queue_Count(&queue) == 0);
+
+  return;
+}
+
+// a valid frame to this station of a type that it does not implement,
+// or one that IDLE does not expect, is dropped in one step, so the
+// token is not lost waiting for it to be taken
+void testUnwantedFrame(Test* pTest)
+{
+  static struct MSTP_Port port;
+  static const UINT8 types[] = {
+    8, 31, 34, 127, FRAME_TYPE_PROPRIETARY_MIN,
+    FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER, FRAME_TYPE_REPLY_POSTPONED
+  };
+  UINT8 buffer[MSTP_EXTENDED_FRAME_SIZE];
+  UINT8 data[8] = {0};
+  unsigned length;
+  unsigned i;
+
+  MSTP_Init(&port, 5);
+  Master_Node_FSM(&port);
+  for (i = 0; i < sizeof(types); i++)
+  {
+    length = MSTP_Create_Frame(buffer, sizeof(buffer), types[i], 5, 4,
+      data, sizeof(data));
+    (void)MSTP_Receive_Octets(&port, buffer, length);
+    ct_test(pTest, port.ReceivedValidFrame == TRUE);
+    ct_test(pTest, port.FrameType == types[i]);
+    ct_test(pTest, MSTP_Timeout(&port) == 0);
+    Master_Node_FSM(&port);
+    ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_IDLE);
+    ct_test(pTest, port.ReceivedValidFrame == FALSE);
+    ct_test(pTest, MSTP_Timeout(&port) == Tno_token);
+  }
+  // nothing is sent in reply
+  ct_test(pTest, port.Stats.octets_sent == 0);
+
+  return;
+}
+
+// COBS-encoded frames up to a whole APDU are received the same by
+// both receive paths, and one that is too long or bad is dropped
+void testExtendedFrames(Test* pTest)
+{
+  static struct MSTP_Port port_fsm, port_octets;
+  static struct test_frames frames_fsm, frames_octets;
+  static UINT8 data[MSTP_EXTENDED_DATA_MAX + 1];
+  static UINT8 buffer[5 * MSTP_EXTENDED_FRAME_SIZE];
+  unsigned length = 0;
+  unsigned count;
+  unsigned i;
+
+  // the zeros of the tags and small values of an APDU
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (i % 5) ? (UINT8)(i * 13) : 0;
+  MSTP_Init(&port_fsm, 3);
+  MSTP_Init(&port_octets, 3);
+  ct_test(pTest, MSTP_Create_Frame(buffer, sizeof(buffer),
+    FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY, 3, 1, data,
+    MSTP_EXTENDED_DATA_MAX + 1) == 0);
+  ct_test(pTest, MSTP_Create_Frame(buffer, sizeof(buffer),
+    FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY, 3, 1, NULL, 0) == 0);
+  ct_test(pTest, MSTP_Create_Frame(buffer, MSTP_HEADER_SIZE + 100,
+    FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY, 3, 1, data,
+    100) == 0);
+  count = MSTP_Create_Frame(buffer, sizeof(buffer),
+    FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY, 3, 1, data,
+    MSTP_EXTENDED_DATA_MAX);
+  ct_test(pTest, count > (MSTP_HEADER_SIZE + MSTP_EXTENDED_DATA_MAX));
+  ct_test(pTest, count <= MSTP_EXTENDED_FRAME_SIZE);
+  // the Length field leaves out the last two octets
+  ct_test(pTest, (unsigned)((buffer[5] * 256) + buffer[6]) ==
+    (count - MSTP_HEADER_SIZE - 2));
+  // nothing in the data looks like a preamble
+  ct_test(pTest, memchr(&buffer[MSTP_HEADER_SIZE], 0x55,
+    count - MSTP_HEADER_SIZE) == NULL);
+  length += count;
+  count = MSTP_Create_Frame(&buffer[length], sizeof(buffer) - length,
+    FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY, 3, 2, data, 1);
+  ct_test(pTest, count == (MSTP_HEADER_SIZE + 2 + COBS_ENCODED_CRC_SIZE));
+  length += count;
+  // FrameTooLong for a frame that is not COBS-encoded
+  MSTP_Create_Header(&buffer[length],
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 3, 1, INPUT_BUFFER_SIZE + 1);
+  length += MSTP_HEADER_SIZE;
+  memset(&buffer[length], 0, INPUT_BUFFER_SIZE + 3);
+  length += INPUT_BUFFER_SIZE + 3;
+  // a bad CRC-32K
+  count = MSTP_Create_Frame(&buffer[length], sizeof(buffer) - length,
+    FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY, 3, 4, data, 600);
+  buffer[length + MSTP_HEADER_SIZE + 100] ^= 0x01;
+  length += count;
+  count = MSTP_Create_Frame(&buffer[length], sizeof(buffer) - length,
+    FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY,
+    MSTP_BROADCAST_ADDRESS, 5, &data[1], 20);
+  length += count;
+  test_receive_fsm(&port_fsm, buffer, length, &frames_fsm);
+  test_receive_octets(&port_octets, buffer, length, &frames_octets);
+  ct_test(pTest, test_frames_same(&frames_fsm, &frames_octets));
+  ct_test(pTest, frames_fsm.count == 5);
+  ct_test(pTest, frames_fsm.frame[0].valid);
+  ct_test(pTest, frames_fsm.frame[0].frame_type ==
+    FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY);
+  ct_test(pTest, frames_fsm.frame[0].data_len == MSTP_EXTENDED_DATA_MAX);
+  ct_test(pTest, memcmp(frames_fsm.frame[0].data, data,
+    MSTP_EXTENDED_DATA_MAX) == 0);
+  ct_test(pTest, frames_fsm.frame[1].valid);
+  ct_test(pTest, frames_fsm.frame[1].data_len == 1);
+  ct_test(pTest, frames_fsm.frame[1].data[0] == data[0]);
+  ct_test(pTest, !frames_fsm.frame[2].valid);
+  ct_test(pTest, !frames_fsm.frame[3].valid);
+  ct_test(pTest, frames_fsm.frame[4].valid);
+  ct_test(pTest, frames_fsm.frame[4].source == 5);
+  ct_test(pTest, frames_fsm.frame[4].data_len == 20);
+  ct_test(pTest, memcmp(frames_fsm.frame[4].data, &data[1], 20) == 0);
+  ct_test(pTest, port_fsm.Stats.frames_too_long == 1);
+  ct_test(pTest, port_fsm.Stats.data_crc_errors == 1);
+  ct_test(pTest, port_octets.Stats.frames_too_long == 1);
+  ct_test(pTest, port_octets.Stats.data_crc_errors == 1);
+  ct_test(pTest, port_octets.Stats.octets_received == length);
+
+  return;
+}
+
+// a whole APDU goes out in one COBS-encoded frame that expects a
+// reply, and the reply may be one too
+void testSendExtended(Test* pTest)
+{
+  static struct MSTP_Port port, peer;
+  static struct MSTP_Queue queue;
+  static struct MSTP_Queue_Frame queued[MSTP_QUEUE_LANES * 2];
+  static struct test_frames frames;
+  static UINT8 data[1476];
+  unsigned i;
+
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (UINT8)(i * 31);
+  MSTP_Init(&port, 5);
+  MSTP_Init(&peer, 7);
+  port.Send_Frame = Test_Send_Frame;
+  port.Queue = &queue;
+  ct_test(pTest, MSTP_Queue_Init(&queue, queued, 2));
+  ct_test(pTest, MSTP_Queue_Put(&queue, FALSE,
+    FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY, 7, data, sizeof(data)));
+  Master_Node_FSM(&port);
+  port.Next_Station = 6;
+  test_master_receive(&port, FRAME_TYPE_TOKEN, 5, 4, NULL, 0);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_WAIT_FOR_REPLY);
+  ct_test(pTest, port.Stats.octets_sent == Test_Sent_Length);
+  test_receive_octets(&peer, Test_Sent, Test_Sent_Length, &frames);
+  ct_test(pTest, frames.count == 1);
+  ct_test(pTest, frames.frame[0].valid);
+  ct_test(pTest, frames.frame[0].frame_type ==
+    FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY);
+  ct_test(pTest, frames.frame[0].destination == 7);
+  ct_test(pTest, frames.frame[0].data_len == sizeof(data));
+  ct_test(pTest, memcmp(frames.frame[0].data, data, sizeof(data)) == 0);
+  // ReceivedReply, and the token is passed
+  test_master_receive(&port,
+    FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY, 5, 7, data, 1000);
+  ct_test(pTest, port.Stats.reply_timeouts == 0);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_PASS_TOKEN);
+  ct_test(pTest, Test_Sent[2] == FRAME_TYPE_TOKEN);
+  ct_test(pTest, Test_Sent[3] == 6);
+  // such a request may not be broadcast
+  test_master_receive(&port,
+    FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY, MSTP_BROADCAST_ADDRESS,
+    7, data, 10);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_IDLE);
+  ct_test(pTest, !port.ReceivedValidFrame);
+
+  return;
+}
+
+// a reply for test_reply_data to give, and what it was given
+struct test_reply
+{
+  const UINT8 *reply;
+  unsigned length;
+  unsigned calls;
+  unsigned received; // frames given to Receive_Data
+};
+
+static unsigned test_reply_data(
+  struct MSTP_Port *port,
+  const UINT8 **reply)
+{
+  struct test_reply *test = port->Reply_Context;
+
+  test->calls++;
+  *reply = test->reply;
+
+  return test->length;
+}
+
+static void test_reply_receive(struct MSTP_Port *port)
+{
+  struct test_reply *test = port->Reply_Context;
+
+  test->received++;
+
+  return;
+}
+
+// a request is answered at once by Reply_Data, or postponed when it
+// has no reply or is too late, and then the higher layers are given it
+void testReplyData(Test* pTest)
+{
+  static struct MSTP_Port port;
+  static struct test_reply test;
+  static UINT8 reply[INPUT_BUFFER_SIZE + 1];
+  UINT8 request[8] = {1, 4, 0, 5, 7, 12, 0x0C, 0};
+  UINT8 buffer[32];
+  unsigned length;
+
+  MSTP_Init(&port, 5);
+  Master_Node_FSM(&port);
+  memset(&test, 0, sizeof(test));
+  memset(reply, 0x55, sizeof(reply));
+  port.Reply_Data = test_reply_data;
+  port.Receive_Data = test_reply_receive;
+  port.Reply_Context = &test;
+  port.Send_Frame = Test_Send_Frame;
+  test.reply = reply;
+  test.length = 10;
+  length = MSTP_Create_Frame(buffer, sizeof(buffer),
+    FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY, 5, 9, request, sizeof(request));
+  (void)MSTP_Receive_Octets(&port, buffer, length);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_ANSWER_DATA_REQUEST);
+  ct_test(pTest, test.calls == 0);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_IDLE);
+  ct_test(pTest, test.calls == 1);
+  ct_test(pTest, test.received == 0);
+  ct_test(pTest, port.Stats.replies_sent == 1);
+  ct_test(pTest, port.Stats.replies_postponed_sent == 0);
+  ct_test(pTest, Test_Sent_Length == MSTP_HEADER_SIZE + 10 + 2);
+  ct_test(pTest, Test_Sent[2] == FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY);
+  ct_test(pTest, Test_Sent[3] == 9);
+  ct_test(pTest, Test_Sent[4] == 5);
+  ct_test(pTest, memcmp(&Test_Sent[MSTP_HEADER_SIZE], reply, 10) == 0);
+  // a reply too long for a frame that is not extended
+  test.length = sizeof(reply);
+  (void)MSTP_Receive_Octets(&port, buffer, length);
+  Master_Node_FSM(&port);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Stats.replies_sent == 2);
+  ct_test(pTest, Test_Sent[2] ==
+    FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY);
+  // no reply yet
+  test.length = 0;
+  (void)MSTP_Receive_Octets(&port, buffer, length);
+  Master_Node_FSM(&port);
+  Master_Node_FSM(&port);
+  ct_test(pTest, test.calls == 3);
+  ct_test(pTest, test.received == 1);
+  ct_test(pTest, port.Stats.replies_sent == 2);
+  ct_test(pTest, port.Stats.replies_postponed_sent == 1);
+  ct_test(pTest, Test_Sent_Length == MSTP_HEADER_SIZE);
+  ct_test(pTest, Test_Sent[2] == FRAME_TYPE_REPLY_POSTPONED);
+  // too late to ask
+  test.length = 10;
+  (void)MSTP_Receive_Octets(&port, buffer, length);
+  Master_Node_FSM(&port);
+  MSTP_Timer_Elapsed(&port, Treply_delay + 1);
+  Master_Node_FSM(&port);
+  ct_test(pTest, test.calls == 3);
+  ct_test(pTest, test.received == 2);
+  ct_test(pTest, port.Stats.replies_postponed_sent == 2);
+  // a Test_Request is still answered by the state machine
+  length = MSTP_Create_Frame(buffer, sizeof(buffer),
+    FRAME_TYPE_TEST_REQUEST, 5, 9, request, sizeof(request));
+  (void)MSTP_Receive_Octets(&port, buffer, length);
+  Master_Node_FSM(&port);
+  Master_Node_FSM(&port);
+  ct_test(pTest, test.calls == 3);
+  ct_test(pTest, Test_Sent[2] == FRAME_TYPE_TEST_RESPONSE);
+
+  return;
+}
+
+// the frames passed on by a bus monitor, back to back in octets
+struct test_monitor
+{
+  unsigned count;
+  unsigned length[16];
+  BOOLEAN valid[16];
+  unsigned used;
+  UINT8 octets[4 * MSTP_EXTENDED_FRAME_SIZE];
+};
+
+static void test_monitor_frame(
+  struct MSTP_Port *port,
+  const UINT8 *frame,
+  unsigned length,
+  BOOLEAN valid)
+{
+  struct test_monitor *monitor = port->Monitor_Context;
+
+  if ((monitor->count < 16) &&
+      ((monitor->used + length) <= sizeof(monitor->octets)))
+  {
+    monitor->length[monitor->count] = length;
+    monitor->valid[monitor->count] = valid;
+    monitor->count++;
+    memcpy(&monitor->octets[monitor->used], frame, length);
+    monitor->used += length;
+  }
+
+  return;
+}
+
+// a monitor passes on every frame as it was on the wire
+void testMonitor(Test* pTest)
+{
+  static struct MSTP_Port port;
+  static struct test_monitor monitor;
+  static UINT8 data[600];
+  static UINT8 buffer[4 * MSTP_EXTENDED_FRAME_SIZE];
+  unsigned offset[8];
+  unsigned length = 0;
+  unsigned count;
+  unsigned used;
+  unsigned i;
+
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (UINT8)(i * 7);
+  MSTP_Init(&port, 3);
+  port.Promiscuous = TRUE;
+  port.Monitor_Frame = test_monitor_frame;
+  port.Monitor_Context = &monitor;
+  offset[0] = length;
+  length += MSTP_Create_Frame(&buffer[length], sizeof(buffer) - length,
+    FRAME_TYPE_TOKEN, 9, 3, NULL, 0);
+  offset[1] = length;
+  length += MSTP_Create_Frame(&buffer[length], sizeof(buffer) - length,
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 8, 1, data, 50);
+  offset[2] = length;
+  length += MSTP_Create_Frame(&buffer[length], sizeof(buffer) - length,
+    FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY, 8, 1, data, 600);
+  // BadCRC on the header
+  offset[3] = length;
+  MSTP_Create_Header(&buffer[length], FRAME_TYPE_TOKEN, 4, 3, 0);
+  buffer[length + 7] ^= 0x10;
+  length += MSTP_HEADER_SIZE;
+  // FrameTooLong - the data that follows is not part of the frame
+  offset[4] = length;
+  MSTP_Create_Header(&buffer[length],
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 3, 1, INPUT_BUFFER_SIZE + 1);
+  length += MSTP_HEADER_SIZE;
+  memset(&buffer[length], 0, INPUT_BUFFER_SIZE + 3);
+  length += INPUT_BUFFER_SIZE + 3;
+  // BadCRC on the data
+  offset[5] = length;
+  length += MSTP_Create_Frame(&buffer[length], sizeof(buffer) - length,
+    FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY, 2, 1, data, 20);
+  buffer[length - 5] ^= 0x01;
+  // cut short by silence in the data
+  offset[6] = length;
+  count = MSTP_Create_Frame(&buffer[length], sizeof(buffer) - length,
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 8, 1, data, 100);
+  length += MSTP_HEADER_SIZE + 40;
+  // in small blocks, so that frames span the blocks
+  for (i = 0; i < length; i += used)
+  {
+    count = ((length - i) < 7) ? (length - i) : 7;
+    used = MSTP_Monitor_Octets(&port, &buffer[i], count);
+    ct_test(pTest, used == count);
+  }
+  ct_test(pTest, monitor.count == 6);
+  ct_test(pTest, MSTP_Timeout(&port) != MSTP_TIMEOUT_NONE);
+  MSTP_Timer_Elapsed(&port, MSTP_Timeout(&port));
+  ct_test(pTest, MSTP_Monitor_Octets(&port, buffer, 0) == 0);
+  ct_test(pTest, monitor.count == 7);
+  // the state machines of a monitor wait on nothing else
+  ct_test(pTest, MSTP_Timeout(&port) == MSTP_TIMEOUT_NONE);
+  // cut short in the header
+  (void)MSTP_Monitor_Octets(&port, buffer, 4);
+  MSTP_Timer_Elapsed(&port, MSTP_Timeout(&port));
+  (void)MSTP_Monitor_Octets(&port, buffer, 0);
+  ct_test(pTest, monitor.count == 8);
+  ct_test(pTest, monitor.length[7] == 4);
+  ct_test(pTest, !monitor.valid[7]);
+  // and never sent a thing
+  ct_test(pTest, port.Stats.octets_sent == 0);
+
+  ct_test(pTest, monitor.valid[0]);
+  ct_test(pTest, monitor.valid[1]);
+  ct_test(pTest, monitor.valid[2]);
+  ct_test(pTest, !monitor.valid[3]);
+  ct_test(pTest, !monitor.valid[4]);
+  ct_test(pTest, !monitor.valid[5]);
+  ct_test(pTest, !monitor.valid[6]);
+  ct_test(pTest, monitor.length[0] == (offset[1] - offset[0]));
+  ct_test(pTest, monitor.length[1] == (offset[2] - offset[1]));
+  // COBS-encoded, just as it was sent
+  ct_test(pTest, monitor.length[2] == (offset[3] - offset[2]));
+  ct_test(pTest, monitor.length[3] == MSTP_HEADER_SIZE);
+  ct_test(pTest, monitor.length[4] == MSTP_HEADER_SIZE);
+  ct_test(pTest, monitor.length[5] == (offset[6] - offset[5]));
+  ct_test(pTest, monitor.length[6] == (MSTP_HEADER_SIZE + 40));
+  used = 0;
+  for (i = 0; i < 7; i++)
+  {
+    ct_test(pTest, memcmp(&monitor.octets[used], &buffer[offset[i]],
+      monitor.length[i]) == 0);
+    used += monitor.length[i];
+  }
+  ct_test(pTest, memcmp(&monitor.octets[used], buffer, 4) == 0);
+
+  return;
+}
+
+#ifdef TEST_MSTP
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("mstp", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testReceiveOctets);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testReceiveTimeout);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testReceiveNoise);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testReceiveRing);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testReceiveRingThreads);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testTiming);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testTimeout);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testStats);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testUseToken);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testUnwantedFrame);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testExtendedFrames);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testSendExtended);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testReplyData);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testMonitor);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  return 0;
+}
+#endif /* TEST_MSTP */
+#endif /* TEST */
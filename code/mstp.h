@@ -0,0 +1,500 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef MSTP_H
+#define MSTP_H
+
+#include <stddef.h>
+#include "ringbuf.h"
+#include "mstpstat.h"
+#include "cobs.h"
+#include "preamble.h"
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef TRUE
+#define TRUE 1
+#endif
+typedef unsigned char BOOLEAN;
+typedef unsigned short UINT16;
+typedef unsigned char UINT8;
+
+// MS/TP Frame Type
+// Frame Types 8 through 31 and 34 through 127 are reserved by ASHRAE.
+#define FRAME_TYPE_TOKEN 0
+#define FRAME_TYPE_POLL_FOR_MASTER 1
+#define FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER 2
+#define FRAME_TYPE_TEST_REQUEST 3
+#define FRAME_TYPE_TEST_RESPONSE 4
+#define FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY 5
+#define FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY 6
+#define FRAME_TYPE_REPLY_POSTPONED 7
+// Frame Types 32 through 127 are COBS-encoded: the data is encoded and
+// followed by its encoded CRC-32K, and the Length field is two less
+// than the octets of both - see cobs.h.  A node that does not know the
+// type takes the last two octets as the data CRC, and drops the frame.
+#define FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY 32
+#define FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY 33
+#define FRAME_TYPE_COBS_MIN 32
+#define FRAME_TYPE_COBS_MAX 127
+#define MSTP_COBS_FRAME(frame_type) \
+  (((frame_type) >= FRAME_TYPE_COBS_MIN) && \
+   ((frame_type) <= FRAME_TYPE_COBS_MAX))
+// Frame Types 128 through 255: Proprietary Frames
+// These frames are available to vendors as proprietary (non-BACnet) frames. 
+// The first two octets of the Data field shall specify the unique vendor 
+// identification code, most significant octet first, for the type of 
+// vendor-proprietary frame to be conveyed. The length of the data portion 
+// of a Proprietary frame shall be in the range of 2 to 501 octets.
+#define FRAME_TYPE_PROPRIETARY_MIN 128
+#define FRAME_TYPE_PROPRIETARY_MAX 255
+
+// MS/TP Frame Format 
+// All frames are of the following format:
+// 
+// Preamble: two octet preamble: X`55', X`FF'
+// Frame Type: one octet
+// Destination Address: one octet address
+// Source Address: one octet address
+// Length: two octets, most significant octet first, of the Data field
+// Header CRC: one octet
+// Data: (present only if Length is non-zero)
+// Data CRC: (present only if Length is non-zero) two octets, 
+//           least significant octet first
+// (pad): (optional) at most one octet of padding: X'FF'
+
+#define MSTP_BROADCAST_ADDRESS 255
+
+// The most data in a frame that is not COBS-encoded.
+#define INPUT_BUFFER_SIZE (501)
+
+// The most data in a COBS-encoded frame: an NPDU with a 1476 octet
+// APDU, and the octets encoded from it and its CRC-32K.
+#define MSTP_EXTENDED_DATA_MAX (1497)
+#define MSTP_EXTENDED_ENCODED_MAX COBS_FRAME_ENCODED_SIZE(MSTP_EXTENDED_DATA_MAX)
+
+// the most data in a frame of a type
+#define MSTP_FRAME_DATA_MAX(frame_type) \
+  (MSTP_COBS_FRAME(frame_type) ? MSTP_EXTENDED_DATA_MAX : INPUT_BUFFER_SIZE)
+
+// the largest Length field of a frame of a type
+#define MSTP_LENGTH_MAX(frame_type) \
+  (MSTP_COBS_FRAME(frame_type) ? \
+   (MSTP_EXTENDED_ENCODED_MAX - 2) : INPUT_BUFFER_SIZE)
+
+// The preamble, the header and the header CRC.
+#define MSTP_HEADER_SIZE 8
+
+// The largest frame: the preamble, the header, its CRC,
+// the data and the data CRC.
+#define MAX_FRAME_SIZE (MSTP_HEADER_SIZE + INPUT_BUFFER_SIZE + 2)
+
+// The largest COBS-encoded frame.
+#define MSTP_EXTENDED_FRAME_SIZE \
+  (MSTP_HEADER_SIZE + MSTP_EXTENDED_ENCODED_MAX)
+
+// A frame is sent in up to three parts: the header, the data, and
+// the data CRC, so that the data is sent from where it is.
+#define MSTP_FRAME_PARTS 3
+struct MSTP_Frame_Part
+{
+  const UINT8 *buffer;
+  unsigned length;
+};
+
+// The times that the standard gives in bit times, at one baud rate.
+// Those that bound the time on the wire are in nanoseconds; a minimum
+// is rounded up, and a maximum down.  Tframe_abort is compared with
+// SilenceTimer, so it is in milliseconds, rounded up.
+struct MSTP_Timing
+{
+  unsigned baud; // bits per second
+  unsigned long Toctet; // a start bit, eight data bits and a stop bit
+  unsigned Tframe_abort; // 60 bit times
+  unsigned long Tframe_gap; // 20 bit times
+  unsigned long Tpostdrive; // 15 bit times
+  unsigned long Troff; // 30 bit times
+  unsigned long Tturnaround; // 40 bit times
+};
+
+// receive FSM states
+typedef enum
+{
+  MSTP_RECEIVE_STATE_IDLE,
+  MSTP_RECEIVE_STATE_PREAMBLE,
+  MSTP_RECEIVE_STATE_HEADER,
+  MSTP_RECEIVE_STATE_HEADER_CRC,
+  MSTP_RECEIVE_STATE_DATA,
+  MSTP_RECEIVE_STATE_DATA_CRC,
+} MSTP_RECEIVE_STATE;
+
+// master node FSM states
+typedef enum
+{
+  MSTP_MASTER_STATE_INITIALIZE,
+  MSTP_MASTER_STATE_IDLE,
+  MSTP_MASTER_STATE_USE_TOKEN,
+  MSTP_MASTER_STATE_WAIT_FOR_REPLY,
+  MSTP_MASTER_STATE_DONE_WITH_TOKEN,
+  MSTP_MASTER_STATE_PASS_TOKEN,
+  MSTP_MASTER_STATE_NO_TOKEN,
+  MSTP_MASTER_STATE_POLL_FOR_MASTER,
+  MSTP_MASTER_STATE_ANSWER_DATA_REQUEST,
+} MSTP_MASTER_STATE;
+
+// keeps each port on its own cache lines so that ports driven
+// from different threads do not share a line
+#define MSTP_CACHE_LINE 64
+#if defined(__GNUC__)
+#define MSTP_CACHE_ALIGN __attribute__((aligned(MSTP_CACHE_LINE)))
+#else
+#define MSTP_CACHE_ALIGN
+#endif
+
+struct MSTP_Queue; // see mstpq.h
+
+// All of the state for one MS/TP port (one EIA-485 trunk).
+// A process may drive as many ports as it likes by passing
+// a different port to the state machines.
+// The members used by the receive state machine for every octet
+// come first so that they share the first cache line.
+struct MSTP_Port
+{
+  // handoff from the UART to the Receive State Machine
+  volatile BOOLEAN ReceiveError; // TRUE when error detected during Rx octet
+  volatile BOOLEAN DataAvailable; // There is data in the buffer
+  volatile UINT8 DataRegister; // stores the latest data 
+
+  // state of the Receive State Machine
+  MSTP_RECEIVE_STATE Receive_State;
+
+  // Used to accumulate the CRC on the header of a frame.
+  UINT8 HeaderCRC;
+  // The header CRC octet as it was received, for a bus monitor.
+  UINT8 HeaderCRCActual;
+
+  // Used to store the frame type of a received frame.
+  UINT8 FrameType;
+
+  // Used to store the destination address of a received frame.
+  UINT8 DestinationAddress;
+
+  // Used to store the Source Address of a received frame.
+  UINT8 SourceAddress;
+
+  // Used to accumulate the CRC on the data field of a frame.
+  UINT16 DataCRC;
+
+  // Used to store the data length of a received frame.
+  unsigned DataLength;
+
+  // Used as an index by the Receive State Machine, up to a maximum value of 
+  // InputBufferSize.
+  unsigned Index;
+
+  // Used to count the number of received octets or errors. 
+  // This is used in the detection of link activity.
+  unsigned EventCount;
+
+  // A Boolean flag set to TRUE by the Receive State Machine if an error is 
+  // detected during the reception of a frame. Set to FALSE by the main 
+  // state machine.
+  BOOLEAN ReceivedInvalidFrame;
+
+  // A Boolean flag set to TRUE by the Receive State Machine if a valid frame 
+  // is received. Set to FALSE by the main state machine.
+  BOOLEAN ReceivedValidFrame;
+
+  // A timer with nominal 5 millisecond resolution used to measure and 
+  // generate silence on the medium between octets. It is incremented by a 
+  // timer process and is cleared by the Receive State Machine when activity 
+  // is detected and by the SendFrame procedure as each octet is transmitted. 
+  // Since the timer resolution is limited and the timer is not necessarily 
+  // synchronized to other machine events, a timer value of N will actually 
+  // denote intervals between N-1 and N
+  volatile unsigned SilenceTimer;
+
+  // the timing of the baud rate of the port, 9600 baud until
+  // MSTP_Timing_Set is called
+  const struct MSTP_Timing *Timing;
+
+  // finds the next preamble in a received block, the fastest engine
+  // of the CPU unless the owner picks one with Preamble_Engine
+  PREAMBLE_ENGINE Preamble_Find;
+
+  // A timer used to measure and generate Reply Postponed frames.  It is 
+  // incremented by a timer process and is cleared by the Master Node State 
+  // Machine when a Data Expecting Reply Answer activity is completed.
+  volatile unsigned ReplyPostponedTimer;
+
+  // Milliseconds since MSTP_Init, advanced with SilenceTimer, and the
+  // times of the last token received and the last request sent.  They
+  // time the token rotation and the replies in Stats.
+  unsigned long Milliseconds;
+  unsigned long TokenTime;
+  unsigned long RequestTime;
+
+  // state of the Master Node State Machine
+  MSTP_MASTER_STATE Master_State;
+
+  // The number of frames sent by this node during a single token hold. 
+  // When this counter reaches the value Nmax_info_frames, the node must 
+  // pass the token.
+  unsigned FrameCount;
+
+  // A counter of transmission retries used for Token and Poll For Master 
+  // transmission.
+  unsigned RetryCount;
+
+  // The number of tokens received by this node. When this counter reaches the 
+  // value Npoll, the node polls the address range between TS and NS for 
+  // additional master nodes. TokenCount is set to zero at the end of the 
+  // polling process.
+  unsigned TokenCount;
+
+  // "This Station," the MAC address of this node. TS is generally read from a 
+  // hardware DIP switch, or from nonvolatile memory. Valid values for TS are 
+  // 0 to 254. The value 255 is used to denote broadcast when used as a 
+  // destination address but is not allowed as a value for TS.
+  UINT8 This_Station;
+
+  // "Next Station," the MAC address of the node to which This Station passes 
+  // the token. If the Next_Station is unknown, Next_Station shall be equal to
+  // This_Station.
+  UINT8 Next_Station;
+
+  // "Poll Station," the MAC address of the node to which This Station last 
+  // sent a Poll For Master. This is used during token maintenance.
+  UINT8 Poll_Station;
+
+  // A Boolean flag set to TRUE by the master machine if this node is the 
+  // only known master node.
+  BOOLEAN SoleMaster;
+
+  // This parameter represents the value of the Max_Info_Frames property of 
+  // the node's Device object. The value of Max_Info_Frames specifies the 
+  // maximum number of information frames the node may send before it must 
+  // pass the token. Max_Info_Frames may have different values on different 
+  // nodes. This may be used to allocate more or less of the available link 
+  // bandwidth to particular nodes. If Max_Info_Frames is not writable in a 
+  // node, its value shall be 1.
+  unsigned Nmax_info_frames;
+
+  // This parameter represents the value of the Max_Master property of the 
+  // node's Device object. The value of Max_Master specifies the highest 
+  // allowable address for master nodes. The value of Max_Master shall be 
+  // less than or equal to 127. If Max_Master is not writable in a node, 
+  // its value shall be 127.
+  unsigned Nmax_master;
+
+  // The number of tokens received or used before a Poll For Master cycle
+  // is executed.  The standard value is 50.
+  unsigned Npoll;
+
+  // A Boolean flag set to TRUE to receive the frames sent to every
+  // destination, as a bus monitor or a capture replay does, instead of
+  // only the frames for This_Station and broadcast.
+  BOOLEAN Promiscuous;
+
+  // An array of octets, used to store octets as they are received. 
+  // InputBuffer is indexed from 0 to InputBufferSize-1. 
+  // The maximum size of a frame is 501 octets, or MSTP_EXTENDED_DATA_MAX
+  // for a COBS-encoded frame, which is received encoded with its
+  // CRC-32K and then decoded in place.
+  // It points at Input_Storage unless the owner has given the port a
+  // buffer of its own, of MSTP_EXTENDED_ENCODED_MAX octets, such as
+  // from Receive_Data.
+  UINT8 *InputBuffer;
+  UINT8 Input_Storage[MSTP_EXTENDED_ENCODED_MAX];
+
+  // Called by SendFrame to transmit the parts of a frame, such as by
+  // RS485_MSTP_Send_Frame or a simulated bus.  It waits for the
+  // turnaround after SilenceTimer, and returns once the frame is sent.
+  void (*Send_Frame)(
+    struct MSTP_Port *port,
+    const struct MSTP_Frame_Part *part,
+    unsigned count);
+
+  // The data frames awaiting transmission, sent in the USE_TOKEN state
+  // up to Nmax_info_frames at a time - see mstpq.h.
+  // When NULL, there is never a data frame to send.
+  struct MSTP_Queue *Queue;
+
+  // for the owner of the port
+  void *Context;
+
+  // When set, the port is a passive bus monitor that never transmits:
+  // MSTP_Monitor_Octets hands it every frame that is received, valid
+  // or not, with its octets from the preamble on as they were on the
+  // wire.  COBS-encoded frames are checked but left encoded.
+  void (*Monitor_Frame)(
+    struct MSTP_Port *port,
+    const UINT8 *frame,
+    unsigned length,
+    BOOLEAN valid);
+  // for the owner of the monitor
+  void *Monitor_Context;
+
+  // Called by Master_Node_FSM with each BACnet data frame that this
+  // station receives, whose DataLength octets are in InputBuffer.  It
+  // may keep InputBuffer, such as to forward the frame from where it
+  // was received, if it points InputBuffer at another buffer.
+  void (*Receive_Data)(struct MSTP_Port *port);
+  // for the owner of Receive_Data
+  void *Receive_Context;
+
+  // Called by Master_Node_FSM in the ANSWER_DATA_REQUEST state with a
+  // BACnet data frame that expects a reply, whose DataLength octets are
+  // in InputBuffer.  It must not block: it returns the length of the
+  // reply that it points *reply at, which is sent at once, or 0 if it
+  // has none yet.  Then Receive_Data is given the frame instead, and a
+  // Reply Postponed frame is sent.
+  unsigned (*Reply_Data)(
+    struct MSTP_Port *port,
+    const UINT8 **reply);
+  // for the owner of Reply_Data
+  void *Reply_Context;
+
+  // Written only by the thread that runs the state machines, and read
+  // by any thread with MSTP_Stats_Read.  On its own cache lines, so
+  // that a reader does not slow down the state machines.
+  struct MSTP_Stats Stats MSTP_CACHE_ALIGN;
+} MSTP_CACHE_ALIGN;
+typedef struct MSTP_Port MSTP_PORT;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// sets up a port with its station address and the default
+// Max_Info_Frames and Max_Master values
+void MSTP_Init(
+  struct MSTP_Port *port,
+  UINT8 this_station);
+
+// returns the timing of a baud rate that MS/TP supports,
+// or NULL if there is none
+const struct MSTP_Timing *MSTP_Timing_Find(unsigned baud);
+
+// sets the timing of a port for its baud rate.
+// returns FALSE, and leaves the timing as it was, for an unknown rate.
+BOOLEAN MSTP_Timing_Set(
+  struct MSTP_Port *port,
+  unsigned baud);
+
+// Millisecond Timer - called every millisecond for each port
+void MSTP_Millisecond_Timer(struct MSTP_Port *port);
+
+// advances the timers of a port by the milliseconds that have passed,
+// for a port that is woken at its deadlines instead of every millisecond
+void MSTP_Timer_Elapsed(
+  struct MSTP_Port *port,
+  unsigned milliseconds);
+
+// returns the milliseconds until SilenceTimer reaches the next timeout
+// that the state machines are waiting for, 0 if they should run now,
+// or MSTP_TIMEOUT_NONE if only an octet will move them.
+#define MSTP_TIMEOUT_NONE 0xFFFFFFFFU
+unsigned MSTP_Timeout(struct MSTP_Port *port);
+
+// called by timer, interrupt(?) or other thread
+// (a reader thread may instead fill a ring for MSTP_Receive_Ring)
+void Check_UART_Data(struct MSTP_Port *port);
+
+void Receive_Frame_FSM(struct MSTP_Port *port);
+
+// receives a block of octets that arrived back to back.
+// returns the number of octets used; returns early when a frame is
+// indicated so that Master_Node_FSM can handle it before the rest
+// of the block is received.
+unsigned MSTP_Receive_Octets(
+  struct MSTP_Port *port,
+  const UINT8 *buffer,
+  unsigned length);
+
+// receives a block of octets as a passive bus monitor, passing each
+// frame to Monitor_Frame in place of Master_Node_FSM.  Call it with
+// no octets when MSTP_Timeout expires so that a frame cut short by
+// silence is still passed on.  Returns the number of octets used,
+// which is all of them.
+unsigned MSTP_Monitor_Octets(
+  struct MSTP_Port *port,
+  const UINT8 *buffer,
+  unsigned length);
+
+// An entry in the ring from a UART reader thread or ISR: the octet
+// in the lower byte, or MSTP_RING_ERROR in place of an octet that was
+// received with an error.
+#define MSTP_RING_ERROR 0x0100
+
+// receives the octets and errors waiting in the ring, in blocks.
+// returns the number of entries used; returns early when a frame is
+// indicated, and leaves the rest in the ring until it is taken.
+unsigned MSTP_Receive_Ring(
+  struct MSTP_Port *port,
+  SPSC_RING *ring);
+
+// builds the preamble, header and header CRC in MSTP_HEADER_SIZE octets
+void MSTP_Create_Header(
+  UINT8 *header,
+  UINT8 frame_type,
+  UINT8 destination,
+  UINT8 source,
+  unsigned data_len);
+
+// builds the two data CRC octets that follow the data
+void MSTP_Create_Data_CRC(
+  UINT8 *crc,
+  const UINT8 *data,
+  unsigned data_len);
+
+// builds a complete frame and returns its length, or zero if
+// the frame does not fit in the buffer
+unsigned MSTP_Create_Frame(
+  UINT8 *buffer,
+  unsigned buffer_len,
+  UINT8 frame_type,
+  UINT8 destination,
+  UINT8 source,
+  const UINT8 *data,
+  unsigned data_len);
+
+void Master_Node_FSM(struct MSTP_Port *port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,694 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// MS/TP to BACnet/IP Forwarding
+//
+// The port receives each data frame into the InputBuffer that it is
+// given, which is the NPDU of a packet from the pool, just after the
+// room for its BVLC header.  Receive_Data writes the header in front
+// of the NPDU, adds the packet to the batch, and gives the port the
+// next packet from the pool to receive into.  A batch is handed to
+// the kernel with one sendmmsg(), and its packets go back to the pool,
+// so an NPDU is not copied between the UART and the socket.
+//
+// The NPDUs from BACnet/IP are received in batches too, with one
+// recvmmsg(), and copied into the port's queue, which is where
+// SendFrame sends them from.  The NPDUs are forwarded as they are;
+// this is the link between the networks, not the routing of the
+// network layer.
+
+// for sendmmsg and recvmmsg
+#define _GNU_SOURCE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+
+#include "mstp.h"
+#include "mstpq.h"
+#include "mstpbip.h" // check for valid prototypes
+
+// the NPCI control octet
+#define NPCI_DNET_PRESENT 0x20
+#define NPCI_EXPECTING_REPLY 0x04
+
+static struct MSTP_BIP_Packet *bip_get(struct MSTP_BIP *bip)
+{
+  struct MSTP_BIP_Packet *packet = bip->pool;
+
+  if (packet)
+    bip->pool = packet->next;
+
+  return packet;
+}
+
+static void bip_put(struct MSTP_BIP *bip, struct MSTP_BIP_Packet *packet)
+{
+  packet->next = bip->pool;
+  bip->pool = packet;
+
+  return;
+}
+
+// the packet that an InputBuffer from the pool is in
+static struct MSTP_BIP_Packet *bip_packet(UINT8 *npdu)
+{
+  return (struct MSTP_BIP_Packet *)
+    (npdu - BVLC_HEADER_SIZE - offsetof(struct MSTP_BIP_Packet, octets));
+}
+
+bool MSTP_BIP_Open(
+  struct MSTP_BIP *bip,
+  struct MSTP_Port *port,
+  struct MSTP_BIP_Packet *packets,
+  unsigned count,
+  const struct sockaddr_in *local,
+  const struct sockaddr_in *peer)
+{
+  unsigned i;
+
+  memset(bip, 0, sizeof(struct MSTP_BIP));
+  bip->fd = -1;
+  if (count < 2)
+    return false;
+  bip->fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (bip->fd < 0)
+    return false;
+  if ((bind(bip->fd, (const struct sockaddr *)local, sizeof(*local)) != 0) ||
+      (fcntl(bip->fd, F_SETFL, O_NONBLOCK) != 0))
+  {
+    close(bip->fd);
+    bip->fd = -1;
+    return false;
+  }
+  bip->peer = *peer;
+  bip->port = port;
+  bip->batch_size = MSTP_BIP_BATCH;
+  for (i = 0; i < count; i++)
+    bip_put(bip, &packets[i]);
+  port->InputBuffer = &bip_get(bip)->octets[BVLC_HEADER_SIZE];
+  port->Receive_Context = bip;
+  port->Receive_Data = MSTP_BIP_Receive_Data;
+
+  return true;
+}
+
+void MSTP_BIP_Receive_Data(struct MSTP_Port *port)
+{
+  struct MSTP_BIP *bip = port->Receive_Context;
+  struct MSTP_BIP_Packet *packet = bip_packet(port->InputBuffer);
+  struct MSTP_BIP_Packet *next = bip_get(bip);
+  unsigned length = BVLC_HEADER_SIZE + port->DataLength;
+
+  if ((next == NULL) && bip->count)
+  {
+    (void)MSTP_BIP_Flush(bip);
+    next = bip_get(bip);
+  }
+  // the port keeps its buffer, and the NPDU is lost
+  if (next == NULL)
+  {
+    bip->dropped++;
+    return;
+  }
+  packet->octets[0] = BVLC_TYPE_BACNET_IP;
+  packet->octets[1] = (port->DestinationAddress == MSTP_BROADCAST_ADDRESS) ?
+    BVLC_ORIGINAL_BROADCAST_NPDU : BVLC_ORIGINAL_UNICAST_NPDU;
+  packet->octets[2] = (UINT8)(length >> 8);
+  packet->octets[3] = (UINT8)(length & 0xFF);
+  packet->length = length;
+  bip->batch[bip->count++] = packet;
+  port->InputBuffer = &next->octets[BVLC_HEADER_SIZE];
+  if (bip->count >= bip->batch_size)
+    (void)MSTP_BIP_Flush(bip);
+
+  return;
+}
+
+unsigned MSTP_BIP_Flush(struct MSTP_BIP *bip)
+{
+  struct mmsghdr message[MSTP_BIP_BATCH];
+  struct iovec iov[MSTP_BIP_BATCH];
+  unsigned sent = 0; // return value
+  unsigned i;
+  int result;
+
+  if (bip->count == 0)
+    return 0;
+  memset(message, 0, sizeof(message[0]) * bip->count);
+  for (i = 0; i < bip->count; i++)
+  {
+    iov[i].iov_base = bip->batch[i]->octets;
+    iov[i].iov_len = bip->batch[i]->length;
+    message[i].msg_hdr.msg_name = &bip->peer;
+    message[i].msg_hdr.msg_namelen = sizeof(bip->peer);
+    message[i].msg_hdr.msg_iov = &iov[i];
+    message[i].msg_hdr.msg_iovlen = 1;
+  }
+  // the socket may take fewer than the whole batch
+  while (sent < bip->count)
+  {
+    result = sendmmsg(bip->fd, &message[sent], bip->count - sent, 0);
+    bip->sends++;
+    if (result > 0)
+      sent += (unsigned)result;
+    else if ((result < 0) && (errno == EINTR))
+      continue;
+    else
+      break;
+  }
+  bip->forwarded += sent;
+  bip->errors += bip->count - sent;
+  // the kernel has its own copy of each datagram
+  for (i = 0; i < bip->count; i++)
+    bip_put(bip, bip->batch[i]);
+  bip->count = 0;
+
+  return sent;
+}
+
+// takes the MS/TP destination and frame type of an NPDU from its NPCI
+static bool bip_frame(
+  const UINT8 *npdu,
+  unsigned length,
+  UINT8 *destination,
+  UINT8 *frame_type)
+{
+  BOOLEAN expecting_reply;
+
+  if (length < 2)
+    return false;
+  *destination = MSTP_BROADCAST_ADDRESS;
+  // DNET, DLEN and DADR of a station on this MS/TP network
+  if ((npdu[1] & NPCI_DNET_PRESENT) && (length >= 6) && (npdu[4] == 1))
+    *destination = npdu[5];
+  expecting_reply = (npdu[1] & NPCI_EXPECTING_REPLY) &&
+    (*destination != MSTP_BROADCAST_ADDRESS);
+  if (length > INPUT_BUFFER_SIZE)
+    *frame_type = expecting_reply ?
+      FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY :
+      FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY;
+  else
+    *frame_type = expecting_reply ?
+      FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY :
+      FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY;
+
+  return true;
+}
+
+// queues the NPDU of one datagram, or counts why it was not
+static void bip_queue(
+  struct MSTP_BIP *bip,
+  const UINT8 *octets,
+  unsigned length)
+{
+  unsigned header = BVLC_HEADER_SIZE;
+  UINT8 destination = 0;
+  UINT8 frame_type = 0;
+
+  if ((length < BVLC_HEADER_SIZE) ||
+      (octets[0] != BVLC_TYPE_BACNET_IP) ||
+      (((octets[2] * 256U) + octets[3]) != length))
+  {
+    bip->rejected++;
+    return;
+  }
+  if (octets[1] == BVLC_FORWARDED_NPDU)
+    header = BVLC_FORWARDED_SIZE;
+  else if ((octets[1] != BVLC_ORIGINAL_UNICAST_NPDU) &&
+      (octets[1] != BVLC_ORIGINAL_BROADCAST_NPDU))
+  {
+    bip->rejected++;
+    return;
+  }
+  if ((length <= header) ||
+      !bip_frame(&octets[header], length - header, &destination, &frame_type))
+    bip->rejected++;
+  else if (bip->port->Queue && MSTP_Queue_Put(bip->port->Queue, FALSE,
+      frame_type, destination, &octets[header], length - header))
+    bip->received++;
+  else
+    bip->dropped++;
+
+  return;
+}
+
+unsigned MSTP_BIP_Receive(struct MSTP_BIP *bip)
+{
+  struct mmsghdr message[MSTP_BIP_BATCH];
+  struct iovec iov[MSTP_BIP_BATCH];
+  struct MSTP_BIP_Packet *packet[MSTP_BIP_BATCH];
+  unsigned long received = bip->received;
+  unsigned count;
+  unsigned i;
+  int result;
+
+  do
+  {
+    for (count = 0; count < MSTP_BIP_BATCH; count++)
+    {
+      packet[count] = bip_get(bip);
+      if (packet[count] == NULL)
+        break;
+      memset(&message[count], 0, sizeof(message[count]));
+      iov[count].iov_base = packet[count]->octets;
+      iov[count].iov_len = sizeof(packet[count]->octets);
+      message[count].msg_hdr.msg_iov = &iov[count];
+      message[count].msg_hdr.msg_iovlen = 1;
+    }
+    result = -1;
+    if (count)
+      result = recvmmsg(bip->fd, message, count, MSG_DONTWAIT, NULL);
+    for (i = 0; (result > 0) && (i < (unsigned)result); i++)
+    {
+      if (message[i].msg_hdr.msg_flags & MSG_TRUNC)
+        bip->rejected++;
+      else
+        bip_queue(bip, packet[i]->octets, message[i].msg_len);
+    }
+    for (i = 0; i < count; i++)
+      bip_put(bip, packet[i]);
+  } while ((result > 0) && ((unsigned)result == count));
+
+  return (unsigned)(bip->received - received);
+}
+
+void MSTP_BIP_Close(struct MSTP_BIP *bip)
+{
+  if (bip->fd < 0)
+    return;
+  (void)MSTP_BIP_Flush(bip);
+  close(bip->fd);
+  bip->fd = -1;
+  bip->port->Receive_Data = NULL;
+  bip->port->Receive_Context = NULL;
+  bip->port->InputBuffer = bip->port->Input_Storage;
+
+  return;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <arpa/inet.h>
+
+#include "monotime.h"
+#include "ctest.h"
+
+// a UDP socket on the loopback address, and its address
+static int test_socket(struct sockaddr_in *address)
+{
+  socklen_t length = sizeof(*address);
+  int fd;
+
+  memset(address, 0, sizeof(*address));
+  address->sin_family = AF_INET;
+  address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  assert(fd >= 0);
+  assert(bind(fd, (struct sockaddr *)address, sizeof(*address)) == 0);
+  assert(getsockname(fd, (struct sockaddr *)address, &length) == 0);
+
+  return fd;
+}
+
+// receives the octets and runs the Master Node State Machine for each
+// frame, as rs485_mstp_run does
+static void test_receive(
+  struct MSTP_Port *port,
+  const UINT8 *buffer,
+  unsigned length)
+{
+  unsigned used;
+
+  do
+  {
+    used = MSTP_Receive_Octets(port, buffer, length);
+    buffer += used;
+    length -= used;
+    Master_Node_FSM(port);
+  } while (length || port->ReceivedValidFrame || port->ReceivedInvalidFrame);
+
+  return;
+}
+
+// an NPDU with no routing information, of length octets
+static void test_npdu(UINT8 *npdu, unsigned length, UINT8 seed)
+{
+  unsigned i;
+
+  npdu[0] = 1;
+  npdu[1] = 0;
+  for (i = 2; i < length; i++)
+    npdu[i] = (UINT8)(seed + (i * 7));
+
+  return;
+}
+
+void testBIPForward(Test* pTest)
+{
+  static const unsigned npdu_length[] = {20, 30, 1000, 5, 480, 501};
+  static struct MSTP_Port port;
+  static struct MSTP_BIP bip;
+  static struct MSTP_BIP_Packet packets[4];
+  static UINT8 npdu[1000];
+  static UINT8 frame[MSTP_EXTENDED_FRAME_SIZE];
+  static UINT8 datagram[BVLC_HEADER_SIZE + 1000];
+  struct sockaddr_in local, peer;
+  unsigned length;
+  unsigned i;
+  ssize_t received;
+  int fd;
+
+  fd = test_socket(&peer);
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  MSTP_Init(&port, 3);
+  Master_Node_FSM(&port);
+  ct_test(pTest, !MSTP_BIP_Open(&bip, &port, packets, 1, &local, &peer));
+  ct_test(pTest, MSTP_BIP_Open(&bip, &port, packets, 4, &local, &peer));
+  ct_test(pTest, port.InputBuffer != port.Input_Storage);
+  // more frames than packets, so the batch is sent to free them:
+  // the port has one, three wait, then the last three wait
+  for (i = 0; i < sizeof(npdu_length)/sizeof(npdu_length[0]); i++)
+  {
+    test_npdu(npdu, npdu_length[i], (UINT8)i);
+    length = MSTP_Create_Frame(frame, sizeof(frame),
+      (npdu_length[i] > INPUT_BUFFER_SIZE) ?
+        FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY :
+        FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY,
+      (i == 1) ? MSTP_BROADCAST_ADDRESS : 3, 9, npdu, npdu_length[i]);
+    test_receive(&port, frame, length);
+  }
+  // a frame for another station is not forwarded
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 4, 9, npdu, 10);
+  test_receive(&port, frame, length);
+  ct_test(pTest, MSTP_BIP_Flush(&bip) == 3);
+  ct_test(pTest, MSTP_BIP_Flush(&bip) == 0);
+  ct_test(pTest, bip.forwarded == 6);
+  ct_test(pTest, bip.dropped == 0);
+  ct_test(pTest, bip.errors == 0);
+  for (i = 0; i < sizeof(npdu_length)/sizeof(npdu_length[0]); i++)
+  {
+    received = recv(fd, datagram, sizeof(datagram), MSG_DONTWAIT);
+    ct_test(pTest, received == (ssize_t)(BVLC_HEADER_SIZE + npdu_length[i]));
+    ct_test(pTest, datagram[0] == BVLC_TYPE_BACNET_IP);
+    ct_test(pTest, datagram[1] == ((i == 1) ?
+      BVLC_ORIGINAL_BROADCAST_NPDU : BVLC_ORIGINAL_UNICAST_NPDU));
+    ct_test(pTest, ((datagram[2] * 256U) + datagram[3]) == received);
+    test_npdu(npdu, npdu_length[i], (UINT8)i);
+    ct_test(pTest, memcmp(&datagram[BVLC_HEADER_SIZE], npdu,
+      npdu_length[i]) == 0);
+  }
+  ct_test(pTest, recv(fd, datagram, sizeof(datagram), MSG_DONTWAIT) < 0);
+  MSTP_BIP_Close(&bip);
+  ct_test(pTest, port.InputBuffer == port.Input_Storage);
+  ct_test(pTest, port.Receive_Data == NULL);
+  close(fd);
+
+  return;
+}
+
+// sends one datagram of a BVLC header, extra octets and an NPDU
+static void test_send(
+  int fd,
+  const struct sockaddr_in *to,
+  UINT8 function,
+  unsigned extra,
+  const UINT8 *npdu,
+  unsigned npdu_length)
+{
+  UINT8 datagram[BVLC_FORWARDED_SIZE + 1000];
+  unsigned length = BVLC_HEADER_SIZE + extra + npdu_length;
+
+  memset(datagram, 0, sizeof(datagram));
+  datagram[0] = BVLC_TYPE_BACNET_IP;
+  datagram[1] = function;
+  datagram[2] = (UINT8)(length >> 8);
+  datagram[3] = (UINT8)(length & 0xFF);
+  memcpy(&datagram[BVLC_HEADER_SIZE + extra], npdu, npdu_length);
+  (void)sendto(fd, datagram, length, 0, (const struct sockaddr *)to,
+    sizeof(*to));
+
+  return;
+}
+
+void testBIPReceive(Test* pTest)
+{
+  static struct MSTP_Port port;
+  static struct MSTP_BIP bip;
+  static struct MSTP_BIP_Packet packets[8];
+  static struct MSTP_Queue queue;
+  static struct MSTP_Queue_Frame queued[MSTP_QUEUE_LANES * 4];
+  static UINT8 npdu[1000];
+  // a confirmed request for station 7 on network 5
+  static const UINT8 routed[] = {1, 0x24, 0, 5, 1, 7, 255, 0, 5, 1, 12};
+  const struct MSTP_Queue_Frame *frame;
+  struct sockaddr_in local, peer;
+  socklen_t size = sizeof(local);
+  unsigned found = 0;
+  int fd;
+
+  fd = test_socket(&peer);
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  MSTP_Init(&port, 3);
+  ct_test(pTest, MSTP_Queue_Init(&queue, queued, 4));
+  port.Queue = &queue;
+  ct_test(pTest, MSTP_BIP_Open(&bip, &port, packets, 8, &local, &peer));
+  ct_test(pTest, getsockname(bip.fd, (struct sockaddr *)&local, &size) == 0);
+  ct_test(pTest, MSTP_BIP_Receive(&bip) == 0);
+  test_send(fd, &local, BVLC_ORIGINAL_UNICAST_NPDU, 0, routed,
+    sizeof(routed));
+  test_npdu(npdu, 20, 1);
+  test_send(fd, &local, BVLC_ORIGINAL_BROADCAST_NPDU, 0, npdu, 20);
+  test_npdu(npdu, 1000, 2);
+  test_send(fd, &local, BVLC_FORWARDED_NPDU, 6, npdu, 1000);
+  // not NPDUs
+  test_send(fd, &local, 0x05, 0, npdu, 10);
+  test_send(fd, &local, BVLC_ORIGINAL_UNICAST_NPDU, 0, npdu, 0);
+  ct_test(pTest, MSTP_BIP_Receive(&bip) == 3);
+  ct_test(pTest, bip.received == 3);
+  ct_test(pTest, bip.rejected == 2);
+  ct_test(pTest, MSTP_Queue_Count(&queue) == 3);
+  while ((frame = MSTP_Queue_Front(&queue)) != NULL)
+  {
+    if (frame->destination == 7)
+    {
+      found++;
+      ct_test(pTest, frame->frame_type ==
+        FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY);
+      ct_test(pTest, frame->data_len == sizeof(routed));
+      ct_test(pTest, memcmp(frame->data, routed, sizeof(routed)) == 0);
+    }
+    else if (frame->data_len == 20)
+    {
+      found++;
+      ct_test(pTest, frame->destination == MSTP_BROADCAST_ADDRESS);
+      ct_test(pTest, frame->frame_type ==
+        FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY);
+    }
+    else if (frame->data_len == 1000)
+    {
+      found++;
+      ct_test(pTest, frame->frame_type ==
+        FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY);
+      ct_test(pTest, memcmp(frame->data, npdu, 1000) == 0);
+    }
+    MSTP_Queue_Pop(&queue);
+  }
+  ct_test(pTest, found == 3);
+  MSTP_BIP_Close(&bip);
+  close(fd);
+
+  return;
+}
+
+// when each frame of the benchmark stream was received, by its number
+static unsigned long long Benchmark_Received[256];
+
+static void benchmark_receive_data(struct MSTP_Port *port)
+{
+  Benchmark_Received[port->InputBuffer[2]] = OS_MonotonicNanosecs();
+  MSTP_BIP_Receive_Data(port);
+
+  return;
+}
+
+// forwards frames from a stream of back to back data frames, taken
+// in blocks as RS485_MSTP_Poll would read them, to a socket on the
+// loopback address, which is drained after each block.  The latency
+// is from the end of a frame until its datagram is read.
+static void benchmark_forward(
+  const UINT8 *stream,
+  unsigned length,
+  unsigned batch_size,
+  unsigned block)
+{
+  static struct MSTP_Port port;
+  static struct MSTP_BIP bip;
+  static struct MSTP_BIP_Packet packets[64];
+  static UINT8 datagram[MSTP_BIP_BATCH][BVLC_HEADER_SIZE + 512];
+  struct mmsghdr message[MSTP_BIP_BATCH];
+  struct iovec iov[MSTP_BIP_BATCH];
+  struct sockaddr_in local, peer;
+  unsigned long long start, now;
+  unsigned long long latency = 0;
+  unsigned long long latency_max = 0;
+  unsigned long frames = 0;
+  unsigned count;
+  unsigned i, j;
+  int result;
+  int fd;
+  double seconds;
+
+  fd = test_socket(&peer);
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  MSTP_Init(&port, 3);
+  Master_Node_FSM(&port);
+  if (!MSTP_BIP_Open(&bip, &port, packets, 64, &local, &peer))
+    return;
+  bip.batch_size = batch_size;
+  port.Receive_Data = benchmark_receive_data;
+  for (i = 0; i < MSTP_BIP_BATCH; i++)
+  {
+    iov[i].iov_base = datagram[i];
+    iov[i].iov_len = sizeof(datagram[i]);
+  }
+  start = OS_MonotonicNanosecs();
+  for (j = 0; j < 400; j++)
+  {
+    for (i = 0; i < length; i += count)
+    {
+      count = ((length - i) < block) ? (length - i) : block;
+      test_receive(&port, &stream[i], count);
+      (void)MSTP_BIP_Flush(&bip);
+      do
+      {
+        memset(message, 0, sizeof(message));
+        for (result = 0; result < MSTP_BIP_BATCH; result++)
+        {
+          message[result].msg_hdr.msg_iov = &iov[result];
+          message[result].msg_hdr.msg_iovlen = 1;
+        }
+        result = recvmmsg(fd, message, MSTP_BIP_BATCH, MSG_DONTWAIT, NULL);
+        now = OS_MonotonicNanosecs();
+        for (count = 0; (result > 0) && (count < (unsigned)result); count++)
+        {
+          now -= Benchmark_Received[datagram[count][BVLC_HEADER_SIZE + 2]];
+          latency += now;
+          if (now > latency_max)
+            latency_max = now;
+          now += Benchmark_Received[datagram[count][BVLC_HEADER_SIZE + 2]];
+          frames++;
+        }
+      } while (result == MSTP_BIP_BATCH);
+      count = ((length - i) < block) ? (length - i) : block;
+    }
+  }
+  seconds = (double)(OS_MonotonicNanosecs() - start) / 1.0e9;
+  printf("bip: batch %2u, %5u octet blocks: %lu of %lu frames, "
+    "%.0f frames/s, %.2f sends/frame, latency %.1f us mean %.1f us max\n",
+    batch_size, block, frames, bip.forwarded + bip.dropped + bip.errors,
+    frames / seconds, (double)bip.sends / (frames ? frames : 1),
+    (latency / 1000.0) / (frames ? frames : 1), latency_max / 1000.0);
+  MSTP_BIP_Close(&bip);
+  close(fd);
+
+  return;
+}
+
+// NPDUs of the sizes seen between a workstation and its controllers
+void benchmarkBIP(void)
+{
+  static UINT8 stream[256 * (MSTP_HEADER_SIZE + 200 + 2)];
+  UINT8 npdu[200];
+  unsigned length = 0;
+  unsigned i;
+
+  for (i = 0; i < 256; i++)
+  {
+    test_npdu(npdu, sizeof(npdu), (UINT8)i);
+    npdu[2] = (UINT8)i;
+    length += MSTP_Create_Frame(&stream[length], sizeof(stream) - length,
+      FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 3, 9, npdu,
+      20 + ((i * 37) % 180));
+  }
+  benchmark_forward(stream, length, 1, 512);
+  benchmark_forward(stream, length, MSTP_BIP_BATCH, 512);
+  benchmark_forward(stream, length, 1, 8192);
+  benchmark_forward(stream, length, MSTP_BIP_BATCH, 8192);
+
+  return;
+}
+
+#ifdef TEST_MSTPBIP
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("mstpbip", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testBIPForward);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testBIPReceive);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  benchmarkBIP();
+
+  return 0;
+}
+#endif /* TEST_MSTPBIP */
+#endif /* TEST */
@@ -0,0 +1,126 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef MSTPBIP_H
+#define MSTPBIP_H
+
+#include <stdbool.h>
+#include <netinet/in.h>
+#include "mstp.h"
+
+// Forwards the NPDUs of an MS/TP port to BACnet/IP, and back.
+// Data frames are received straight into packets from a pool, with
+// room in front of the NPDU for the BVLC header, and the packets are
+// handed to a UDP socket in batches, one sendmmsg() for each batch.
+// Every packet is in an array that the owner gives to MSTP_BIP_Open,
+// so nothing is allocated while the port runs.
+
+// BACnet Virtual Link Control
+#define BVLC_TYPE_BACNET_IP 0x81
+#define BVLC_FORWARDED_NPDU 0x04
+#define BVLC_ORIGINAL_UNICAST_NPDU 0x0A
+#define BVLC_ORIGINAL_BROADCAST_NPDU 0x0B
+#define BVLC_HEADER_SIZE 4
+// the B/IP address of the source that follows a Forwarded-NPDU header
+#define BVLC_FORWARDED_SIZE (BVLC_HEADER_SIZE + 6)
+
+// the most packets sent or received with one system call
+#define MSTP_BIP_BATCH 32
+
+struct MSTP_BIP_Packet
+{
+  struct MSTP_BIP_Packet *next; // in the pool
+  unsigned length; // octets in the packet from the BVLC header on
+  // the BVLC header, then the NPDU as the port received it
+  UINT8 octets[BVLC_HEADER_SIZE + MSTP_EXTENDED_ENCODED_MAX];
+};
+
+struct MSTP_BIP
+{
+  int fd; // the UDP socket, or -1
+  struct sockaddr_in peer; // where the NPDUs from MS/TP are sent
+  struct MSTP_Port *port;
+  struct MSTP_BIP_Packet *pool; // free packets
+  // packets waiting to be sent
+  struct MSTP_BIP_Packet *batch[MSTP_BIP_BATCH];
+  unsigned count;
+  unsigned batch_size; // sent once this many are waiting
+  // what has been forwarded
+  unsigned long forwarded; // NPDUs from MS/TP sent on BACnet/IP
+  unsigned long received; // NPDUs from BACnet/IP queued on MS/TP
+  unsigned long dropped; // NPDUs that found no packet or queue slot
+  unsigned long rejected; // datagrams that were not BVLC NPDUs
+  unsigned long sends; // calls to sendmmsg
+  unsigned long errors; // NPDUs that the socket would not take
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// binds a UDP socket to local, and has the port receive its data
+// frames into the count packets.  The NPDUs from BACnet/IP are put
+// in port->Queue, which may be NULL if there is no reverse path.
+// returns false if the socket cannot be set up or there are fewer
+// than two packets.
+bool MSTP_BIP_Open(
+  struct MSTP_BIP *bip,
+  struct MSTP_Port *port,
+  struct MSTP_BIP_Packet *packets,
+  unsigned count,
+  const struct sockaddr_in *local,
+  const struct sockaddr_in *peer);
+
+// the Receive_Data of the port: prefixes the frame with its BVLC
+// header where it was received, and adds it to the batch
+void MSTP_BIP_Receive_Data(struct MSTP_Port *port);
+
+// sends the packets waiting in the batch, such as once the ports have
+// been run for each wakeup, so that none waits long for the batch to
+// fill.  returns the number of NPDUs sent.
+unsigned MSTP_BIP_Flush(struct MSTP_BIP *bip);
+
+// queues the NPDUs waiting on the socket for the MS/TP port.
+// returns the number of NPDUs queued.
+unsigned MSTP_BIP_Receive(struct MSTP_BIP *bip);
+
+// sends the rest of the batch, closes the socket, and gives the port
+// its own InputBuffer back
+void MSTP_BIP_Close(struct MSTP_BIP *bip);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
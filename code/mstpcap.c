@@ -0,0 +1,407 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// Bus Monitor Capture
+//
+// Each frame that MSTP_Monitor_Octets passes on, valid or not, is
+// written as one record with the octets that were on the wire, as
+// the captures from a Wireshark MS/TP sniffer are.  The records are
+// gathered in large blocks which a thread writes to the file, so a
+// capture of a busy trunk costs a memcpy per frame and a write per
+// block.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "mstp.h"
+#include "pcap.h"
+#include "mstpcap.h" // check for valid prototypes
+
+#define NANOSECONDS_PER_SECOND 1000000000ULL
+
+static uint64_t capture_now(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+
+  return ((uint64_t)now.tv_sec * NANOSECONDS_PER_SECOND) +
+    (uint64_t)now.tv_nsec;
+}
+
+// Monitor_Frame of a capturing port
+static void capture_frame(
+  struct MSTP_Port *port,
+  const UINT8 *frame,
+  unsigned length,
+  BOOLEAN valid)
+{
+  struct MSTP_Capture *capture = port->Monitor_Context;
+  uint64_t timestamp = capture->timestamp;
+
+  if (timestamp == 0)
+    timestamp = capture_now();
+  if (valid)
+    capture->frames_valid++;
+  else
+    capture->frames_invalid++;
+  if (!Pcap_Writer_Write(&capture->writer, timestamp, frame, length))
+    capture->frames_lost++;
+  // so that little is lost if the process stops
+  else if ((timestamp - capture->flushed) >= NANOSECONDS_PER_SECOND)
+  {
+    (void)Pcap_Writer_Flush(&capture->writer);
+    capture->flushed = timestamp;
+  }
+
+  return;
+}
+
+bool MSTP_Capture_Open(
+  struct MSTP_Capture *capture,
+  struct MSTP_Port *port,
+  const char *filename)
+{
+  memset(capture, 0, sizeof(struct MSTP_Capture));
+  if (!Pcap_Writer_Open(&capture->writer, filename,
+      PCAP_LINKTYPE_BACNET_MS_TP, MSTP_EXTENDED_FRAME_SIZE))
+    return false;
+  capture->port = port;
+  capture->promiscuous = port->Promiscuous;
+  port->Promiscuous = TRUE;
+  port->Monitor_Context = capture;
+  port->Monitor_Frame = capture_frame;
+
+  return true;
+}
+
+bool MSTP_Capture_Flush(struct MSTP_Capture *capture)
+{
+  return Pcap_Writer_Flush(&capture->writer);
+}
+
+bool MSTP_Capture_Close(struct MSTP_Capture *capture)
+{
+  struct MSTP_Port *port = capture->port;
+
+  if (port)
+  {
+    port->Monitor_Frame = NULL;
+    port->Monitor_Context = NULL;
+    port->Promiscuous = capture->promiscuous;
+    capture->port = NULL;
+  }
+
+  return Pcap_Writer_Close(&capture->writer);
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "replay.h"
+#include "mstptest.h"
+#include "ctest.h"
+
+// where the Wireshark capture files live, relative to code/
+#ifndef REPLAY_CAPTURES_DIR
+#define REPLAY_CAPTURES_DIR "../captures"
+#endif
+
+// frames of each kind, back to back, the last with BadCRC on the data
+static const struct Test_Stream_Frame Test_Stream_Frames[] = {
+  {{0}, 0, FRAME_TYPE_TOKEN, 2, 1, 0, 0, 0},
+  {{0}, 0, FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY, 9, 2, 480, 0, 0},
+  {{0}, 0, FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY, 2, 9, 1000,
+    0, 0},
+  {{0}, 0, FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 5, 9, 30, 30, 0x40}
+};
+
+// the stream, and where each frame starts
+static unsigned test_stream(UINT8 *buffer, unsigned size, unsigned *offset)
+{
+  static UINT8 data[1000];
+  unsigned i;
+
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (UINT8)(i * 11);
+
+  return Test_Stream(buffer, size, Test_Stream_Frames,
+    sizeof(Test_Stream_Frames) / sizeof(Test_Stream_Frames[0]), data, offset);
+}
+
+void testCaptureFrames(Test* pTest)
+{
+  static UINT8 buffer[4096];
+  struct MSTP_Port port;
+  struct MSTP_Capture capture;
+  struct Pcap_File file;
+  struct Pcap_Record record;
+  char filename[] = "/tmp/mstpcapXXXXXX";
+  unsigned offset[5];
+  unsigned length;
+  unsigned i;
+  int fd;
+
+  fd = mkstemp(filename);
+  assert(fd >= 0);
+  close(fd);
+  length = test_stream(buffer, sizeof(buffer), offset);
+  MSTP_Init(&port, 1);
+  ct_test(pTest, MSTP_Capture_Open(&capture, &port, filename));
+  ct_test(pTest, port.Promiscuous);
+  capture.timestamp = 1234567890123456000ULL;
+  for (i = 0; i < 100; i++)
+  {
+    ct_test(pTest, MSTP_Monitor_Octets(&port, buffer, length) == length);
+    capture.timestamp += 1000;
+  }
+  ct_test(pTest, MSTP_Capture_Close(&capture));
+  ct_test(pTest, capture.frames_valid == 300);
+  ct_test(pTest, capture.frames_invalid == 100);
+  ct_test(pTest, capture.frames_lost == 0);
+  ct_test(pTest, !port.Promiscuous);
+  ct_test(pTest, port.Monitor_Frame == NULL);
+
+  ct_test(pTest, Pcap_Open(&file, filename));
+  ct_test(pTest, file.linktype == PCAP_LINKTYPE_BACNET_MS_TP);
+  for (i = 0; i < 400; i++)
+  {
+    ct_test(pTest, Pcap_Next(&file, &record));
+    ct_test(pTest, record.timestamp ==
+      (1234567890123456000ULL + ((i / 4) * 1000)));
+    ct_test(pTest, record.length ==
+      (offset[(i % 4) + 1] - offset[i % 4]));
+    ct_test(pTest, memcmp(record.data, &buffer[offset[i % 4]],
+      record.length) == 0);
+  }
+  ct_test(pTest, !Pcap_Next(&file, &record));
+  Pcap_Close(&file);
+
+  unlink(filename);
+  ct_test(pTest, !MSTP_Capture_Open(&capture, &port, "/nonexistent/x.cap"));
+  ct_test(pTest, port.Monitor_Frame == NULL);
+
+  return;
+}
+
+// captures the replay of a capture through a bus monitor, which
+// should see what the replay counts, and replays the new capture
+void testCaptureReplay(Test* pTest)
+{
+  const char *original = REPLAY_CAPTURES_DIR "/mstp_wtap.cap";
+  struct MSTP_Port port;
+  struct MSTP_Capture capture;
+  struct MSTP_Replay_Stats stats, captured;
+  struct Pcap_File file;
+  struct Pcap_Record record;
+  char filename[] = "/tmp/mstpcapXXXXXX";
+  uint64_t last = 0;
+  int fd;
+
+  MSTP_Init(&port, 0);
+  port.Promiscuous = TRUE;
+  memset(&stats, 0, sizeof(stats));
+  if (!MSTP_Replay_File(&port, original, &stats))
+    return;
+  fd = mkstemp(filename);
+  assert(fd >= 0);
+  close(fd);
+  MSTP_Init(&port, 0);
+  ct_test(pTest, MSTP_Capture_Open(&capture, &port, filename));
+  ct_test(pTest, Pcap_Open(&file, original));
+  // each record after the silence before it, as the replay does
+  port.SilenceTimer = 255;
+  while (Pcap_Next(&file, &record))
+  {
+    if (last && (record.timestamp >= last))
+      port.SilenceTimer = ((record.timestamp - last) / 1000000 > 255) ?
+        255 : (unsigned)((record.timestamp - last) / 1000000);
+    last = record.timestamp;
+    capture.timestamp = record.timestamp;
+    (void)MSTP_Monitor_Octets(&port, record.data, record.length);
+  }
+  Pcap_Close(&file);
+  ct_test(pTest, MSTP_Capture_Close(&capture));
+  ct_test(pTest, capture.frames_valid == stats.frames_valid);
+  ct_test(pTest, capture.frames_invalid == stats.frames_invalid);
+  ct_test(pTest, capture.writer.records ==
+    (stats.frames_valid + stats.frames_invalid));
+
+  MSTP_Init(&port, 0);
+  port.Promiscuous = TRUE;
+  memset(&captured, 0, sizeof(captured));
+  ct_test(pTest, MSTP_Replay_File(&port, filename, &captured));
+  ct_test(pTest, captured.frames_valid == stats.frames_valid);
+  ct_test(pTest, memcmp(captured.frame_type, stats.frame_type,
+    sizeof(stats.frame_type)) == 0);
+  unlink(filename);
+
+  return;
+}
+
+// writes each frame to the file as it arrives, as a simple sniffer
+// would, for comparison
+static void benchmark_write_frame(
+  struct MSTP_Port *port,
+  const UINT8 *frame,
+  unsigned length,
+  BOOLEAN valid)
+{
+  int fd = *(int *)port->Monitor_Context;
+  uint32_t header[4] = {0, 0, 0, 0};
+  struct timespec now;
+
+  (void)valid;
+  clock_gettime(CLOCK_REALTIME, &now);
+  header[0] = (uint32_t)now.tv_sec;
+  header[1] = (uint32_t)(now.tv_nsec / 1000);
+  header[2] = length;
+  header[3] = length;
+  if (write(fd, header, sizeof(header)) == (ssize_t)sizeof(header))
+    (void)(write(fd, frame, length) == (ssize_t)length);
+
+  return;
+}
+
+// the CPU time to capture an hour of a 115200 baud trunk that is
+// never idle, received in the blocks that RS485_MSTP_Poll reads
+void benchmarkCapture(void)
+{
+  const unsigned long long hour = (115200ULL / 10) * 3600;
+  static UINT8 buffer[64 * 1024];
+  UINT8 data[400];
+  struct MSTP_Port port;
+  struct MSTP_Capture capture;
+  char filename[] = "/tmp/mstpcapXXXXXX";
+  unsigned long long total;
+  unsigned long frames = 0;
+  unsigned length = 0;
+  unsigned count;
+  unsigned method;
+  unsigned i;
+  clock_t start;
+  double seconds;
+  int fd;
+
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (UINT8)(i * 3);
+  // a token, a request and its reply, over and over
+  while ((length + 3 * MAX_FRAME_SIZE) < sizeof(buffer))
+  {
+    length += MSTP_Create_Frame(&buffer[length], sizeof(buffer) - length,
+      FRAME_TYPE_TOKEN, 2, 1, NULL, 0);
+    length += MSTP_Create_Frame(&buffer[length], sizeof(buffer) - length,
+      FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY, 7, 2, data, 20);
+    length += MSTP_Create_Frame(&buffer[length], sizeof(buffer) - length,
+      FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 2, 7, data,
+      (unsigned)(frames++ % sizeof(data)));
+  }
+  fd = mkstemp(filename);
+  assert(fd >= 0);
+  close(fd);
+  for (method = 0; method < 2; method++)
+  {
+    MSTP_Init(&port, 1);
+    fd = -1;
+    if (method == 0)
+    {
+      fd = open(filename, O_WRONLY | O_TRUNC);
+      assert(fd >= 0);
+      port.Promiscuous = TRUE;
+      port.Monitor_Frame = benchmark_write_frame;
+      port.Monitor_Context = &fd;
+    }
+    else if (!MSTP_Capture_Open(&capture, &port, filename))
+      break;
+    start = clock();
+    for (total = 0; total < hour; total += length)
+    {
+      for (i = 0; i < length; i += count)
+      {
+        count = ((length - i) < 512) ? (length - i) : 512;
+        (void)MSTP_Monitor_Octets(&port, &buffer[i], count);
+      }
+    }
+    if (method == 0)
+      close(fd);
+    else
+      (void)MSTP_Capture_Close(&capture);
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("capture: %-12s %llu octets, %.3f s CPU per hour, %.4f%%",
+      (method == 0) ? "write each" : "two blocks", total, seconds,
+      (seconds * 100.0) / 3600.0);
+    if (method == 1)
+      printf(", %lu frames, %lu waits", capture.frames_valid,
+        capture.writer.waits);
+    printf("\n");
+  }
+  unlink(filename);
+
+  return;
+}
+
+#ifdef TEST_MSTPCAP
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("mstpcap", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testCaptureFrames);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testCaptureReplay);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  benchmarkCapture();
+
+  return 0;
+}
+#endif /* TEST_MSTPCAP */
+#endif /* TEST */
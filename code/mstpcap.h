@@ -0,0 +1,85 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef MSTPCAP_H
+#define MSTPCAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mstp.h"
+#include "pcap.h"
+
+// Captures the frames that a port sees as a bus monitor to a pcap
+// file, in the MS/TP link type that Wireshark reads.  The port never
+// transmits while it is capturing.
+
+struct MSTP_Capture
+{
+  struct Pcap_Writer writer;
+  struct MSTP_Port *port;
+  BOOLEAN promiscuous; // of the port before it was opened
+  // the time of the next frames in nanoseconds since 1970, such as
+  // from a replayed capture, or 0 to read the real time clock
+  uint64_t timestamp;
+  uint64_t flushed; // when the records were last handed to the writer
+  unsigned long frames_valid;
+  unsigned long frames_invalid;
+  unsigned long frames_lost; // not written since a write failed
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// makes the port a promiscuous bus monitor whose frames are written
+// to a new capture file.  returns false if it cannot be created.
+bool MSTP_Capture_Open(
+  struct MSTP_Capture *capture,
+  struct MSTP_Port *port,
+  const char *filename);
+
+// hands the frames captured so far to the writer.  They are also
+// handed over as the frames arrive, once a second.
+bool MSTP_Capture_Flush(struct MSTP_Capture *capture);
+
+// writes the rest of the frames, closes the file, and leaves the
+// port as it was before it was opened.  returns false if any write
+// failed.
+bool MSTP_Capture_Close(struct MSTP_Capture *capture);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,484 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// Outgoing frame queue of an MS/TP port
+//
+// Each lane is a single-producer single-consumer ring, synchronized
+// the same way as the SPSC ring in ringbuf.c.
+
+#include <stddef.h>
+#include <string.h>
+#include "mstp.h"
+#include "mstpq.h" // check for valid prototypes
+
+#if defined(__GNUC__)
+#define QUEUE_LOAD(index) __atomic_load_n(&(index), __ATOMIC_RELAXED)
+#define QUEUE_ACQUIRE(index) __atomic_load_n(&(index), __ATOMIC_ACQUIRE)
+#define QUEUE_RELEASE(index,value) \
+  __atomic_store_n(&(index), (value), __ATOMIC_RELEASE)
+#elif (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define QUEUE_LOAD(index) \
+  atomic_load_explicit((_Atomic unsigned *)&(index), memory_order_relaxed)
+#define QUEUE_ACQUIRE(index) \
+  atomic_load_explicit((_Atomic unsigned *)&(index), memory_order_acquire)
+#define QUEUE_RELEASE(index,value) \
+  atomic_store_explicit((_Atomic unsigned *)&(index), (value), \
+    memory_order_release)
+#else
+#error "the frame queue needs GNU __atomic builtins or C11 <stdatomic.h>"
+#endif
+
+// sets up a queue with size frames in each lane, from an array of
+// MSTP_QUEUE_LANES * size frames.  returns FALSE if size is not a
+// power of two.
+BOOLEAN MSTP_Queue_Init(
+  struct MSTP_Queue *queue,
+  struct MSTP_Queue_Frame *frames,
+  unsigned size)
+{
+  struct MSTP_Queue_Lane *lane;
+  unsigned i;
+
+  if (!queue || !frames || !size || (size & (size - 1)))
+    return FALSE;
+  for (i = 0; i < MSTP_QUEUE_LANES; i++)
+  {
+    lane = &queue->lane[i];
+    lane->frame = &frames[i * size];
+    lane->mask = size - 1;
+    lane->tail = 0;
+    lane->head = 0;
+  }
+  queue->turn = MSTP_QUEUE_EXPECTING_REPLY;
+  queue->front = MSTP_QUEUE_LANES;
+
+  return TRUE;
+}
+
+// the lane of a frame type that is not urgent
+unsigned MSTP_Queue_Lane(UINT8 frame_type)
+{
+  if ((frame_type == FRAME_TYPE_TEST_REQUEST) ||
+      (frame_type == FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY) ||
+      (frame_type == FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY))
+    return MSTP_QUEUE_EXPECTING_REPLY;
+
+  return MSTP_QUEUE_NOT_EXPECTING_REPLY;
+}
+
+// producer side: returns the free slot at the end of a lane, or NULL
+// if the lane is full
+struct MSTP_Queue_Frame *MSTP_Queue_Reserve(
+  struct MSTP_Queue *queue,
+  unsigned lane)
+{
+  struct MSTP_Queue_Lane *l;
+  unsigned tail;
+
+  if (lane >= MSTP_QUEUE_LANES)
+    return NULL;
+  l = &queue->lane[lane];
+  tail = QUEUE_LOAD(l->tail);
+  if ((tail - QUEUE_ACQUIRE(l->head)) > l->mask)
+    return NULL;
+
+  return &l->frame[tail & l->mask];
+}
+
+// producer side: queues the slot from MSTP_Queue_Reserve
+void MSTP_Queue_Commit(
+  struct MSTP_Queue *queue,
+  unsigned lane)
+{
+  struct MSTP_Queue_Lane *l;
+
+  if (lane >= MSTP_QUEUE_LANES)
+    return;
+  l = &queue->lane[lane];
+  QUEUE_RELEASE(l->tail, QUEUE_LOAD(l->tail) + 1);
+
+  return;
+}
+
+// producer side: copies a frame into its lane, or the priority lane
+BOOLEAN MSTP_Queue_Put(
+  struct MSTP_Queue *queue,
+  BOOLEAN priority,
+  UINT8 frame_type,
+  UINT8 destination,
+  const UINT8 *data,
+  unsigned data_len)
+{
+  struct MSTP_Queue_Frame *frame;
+  unsigned lane;
+
+  if (data_len > MSTP_FRAME_DATA_MAX(frame_type))
+    return FALSE;
+  // a COBS-encoded frame always has data
+  if (MSTP_COBS_FRAME(frame_type) && (data_len == 0))
+    return FALSE;
+  lane = priority ? MSTP_QUEUE_PRIORITY : MSTP_Queue_Lane(frame_type);
+  frame = MSTP_Queue_Reserve(queue, lane);
+  if (frame == NULL)
+    return FALSE;
+  frame->frame_type = frame_type;
+  frame->destination = destination;
+  frame->data_len = data_len;
+  frame->tag = 0;
+  if (data_len)
+    memcpy(frame->data, data, data_len);
+  MSTP_Queue_Commit(queue, lane);
+
+  return TRUE;
+}
+
+// frames waiting in all of the lanes
+unsigned MSTP_Queue_Count(struct MSTP_Queue *queue)
+{
+  struct MSTP_Queue_Lane *lane;
+  unsigned count = 0;
+  unsigned i;
+
+  for (i = 0; i < MSTP_QUEUE_LANES; i++)
+  {
+    lane = &queue->lane[i];
+    count += QUEUE_ACQUIRE(lane->tail) - QUEUE_LOAD(lane->head);
+  }
+
+  return count;
+}
+
+// consumer side: true if a lane has a frame waiting
+static BOOLEAN queue_waiting(struct MSTP_Queue_Lane *lane)
+{
+  return (QUEUE_ACQUIRE(lane->tail) != lane->head);
+}
+
+// consumer side: returns the frame to send next, or NULL if there is
+// none.  The lane is chosen once, so that a frame queued while the
+// front frame is being sent does not take its place before the pop.
+const struct MSTP_Queue_Frame *MSTP_Queue_Front(struct MSTP_Queue *queue)
+{
+  struct MSTP_Queue_Lane *lane;
+  unsigned other;
+
+  if (queue->front == MSTP_QUEUE_LANES)
+  {
+    other = (queue->turn == MSTP_QUEUE_EXPECTING_REPLY) ?
+      MSTP_QUEUE_NOT_EXPECTING_REPLY : MSTP_QUEUE_EXPECTING_REPLY;
+    if (queue_waiting(&queue->lane[MSTP_QUEUE_PRIORITY]))
+      queue->front = MSTP_QUEUE_PRIORITY;
+    else if (queue_waiting(&queue->lane[queue->turn]))
+      queue->front = queue->turn;
+    else if (queue_waiting(&queue->lane[other]))
+      queue->front = other;
+    else
+      return NULL;
+  }
+  lane = &queue->lane[queue->front];
+
+  return &lane->frame[lane->head & lane->mask];
+}
+
+// consumer side: frees the slot of the front frame.  After a frame
+// from one reply lane, the other reply lane goes next.
+void MSTP_Queue_Pop(struct MSTP_Queue *queue)
+{
+  struct MSTP_Queue_Lane *lane;
+
+  if (queue->front == MSTP_QUEUE_LANES)
+    return;
+  lane = &queue->lane[queue->front];
+  if (queue->front == MSTP_QUEUE_EXPECTING_REPLY)
+    queue->turn = MSTP_QUEUE_NOT_EXPECTING_REPLY;
+  else if (queue->front == MSTP_QUEUE_NOT_EXPECTING_REPLY)
+    queue->turn = MSTP_QUEUE_EXPECTING_REPLY;
+  queue->front = MSTP_QUEUE_LANES;
+  QUEUE_RELEASE(lane->head, lane->head + 1);
+
+  return;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ctest.h"
+
+#define TEST_QUEUE_SIZE 4
+
+// takes the front frame and checks where it came from
+static BOOLEAN test_pop(
+  struct MSTP_Queue *queue,
+  UINT8 frame_type,
+  UINT8 destination)
+{
+  const struct MSTP_Queue_Frame *frame = MSTP_Queue_Front(queue);
+  BOOLEAN status;
+
+  if (frame == NULL)
+    return FALSE;
+  status = (frame->frame_type == frame_type) &&
+    (frame->destination == destination);
+  MSTP_Queue_Pop(queue);
+
+  return status;
+}
+
+void testQueue(Test* pTest)
+{
+  static struct MSTP_Queue queue;
+  static struct MSTP_Queue_Frame frames[MSTP_QUEUE_LANES * TEST_QUEUE_SIZE];
+  const struct MSTP_Queue_Frame *frame;
+  UINT8 data[INPUT_BUFFER_SIZE + 1];
+  static UINT8 big[MSTP_EXTENDED_DATA_MAX + 1];
+  unsigned i;
+
+  ct_test(pTest, !MSTP_Queue_Init(&queue, frames, 0));
+  ct_test(pTest, !MSTP_Queue_Init(&queue, frames, 3));
+  ct_test(pTest, MSTP_Queue_Init(&queue, frames, TEST_QUEUE_SIZE));
+  ct_test(pTest, MSTP_Queue_Count(&queue) == 0);
+  ct_test(pTest, MSTP_Queue_Front(&queue) == NULL);
+  MSTP_Queue_Pop(&queue);
+  ct_test(pTest, MSTP_Queue_Count(&queue) == 0);
+
+  // the data is copied, and the lanes fill up separately
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (UINT8)i;
+  for (i = 0; i < sizeof(big); i++)
+    big[i] = (UINT8)(i * 7);
+  ct_test(pTest, !MSTP_Queue_Put(&queue, FALSE,
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 1, data, sizeof(data)));
+  for (i = 0; i < TEST_QUEUE_SIZE; i++)
+    ct_test(pTest, MSTP_Queue_Put(&queue, FALSE,
+      FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, (UINT8)i, data, i + 1));
+  ct_test(pTest, !MSTP_Queue_Put(&queue, FALSE,
+    FRAME_TYPE_TEST_RESPONSE, 9, NULL, 0));
+  ct_test(pTest, MSTP_Queue_Put(&queue, FALSE,
+    FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY, 10, NULL, 0));
+  ct_test(pTest, MSTP_Queue_Put(&queue, FALSE,
+    FRAME_TYPE_TEST_REQUEST, 11, NULL, 0));
+  ct_test(pTest, MSTP_Queue_Count(&queue) == TEST_QUEUE_SIZE + 2);
+  frame = MSTP_Queue_Front(&queue);
+  ct_test(pTest, frame != NULL);
+  ct_test(pTest, frame->destination == 10);
+  ct_test(pTest, frame->data_len == 0);
+  // the front frame stays put, even when an urgent frame is queued
+  ct_test(pTest, MSTP_Queue_Put(&queue, TRUE,
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 20, data, 2));
+  ct_test(pTest, MSTP_Queue_Front(&queue) == frame);
+  MSTP_Queue_Pop(&queue);
+  // the priority lane goes first, then the reply lanes take turns
+  ct_test(pTest, test_pop(&queue,
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 20));
+  frame = MSTP_Queue_Front(&queue);
+  ct_test(pTest, frame != NULL);
+  ct_test(pTest, frame->destination == 0);
+  ct_test(pTest, frame->data_len == 1);
+  ct_test(pTest, frame->data[0] == 0);
+  MSTP_Queue_Pop(&queue);
+  ct_test(pTest, test_pop(&queue, FRAME_TYPE_TEST_REQUEST, 11));
+  frame = MSTP_Queue_Front(&queue);
+  ct_test(pTest, frame != NULL);
+  ct_test(pTest, frame->destination == 1);
+  ct_test(pTest, frame->data_len == 2);
+  ct_test(pTest, memcmp(frame->data, data, 2) == 0);
+  MSTP_Queue_Pop(&queue);
+  ct_test(pTest, test_pop(&queue,
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 2));
+  ct_test(pTest, test_pop(&queue,
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 3));
+  ct_test(pTest, MSTP_Queue_Front(&queue) == NULL);
+  ct_test(pTest, MSTP_Queue_Count(&queue) == 0);
+
+  // a frame built in place
+  ct_test(pTest, MSTP_Queue_Reserve(&queue, MSTP_QUEUE_LANES) == NULL);
+  frame = MSTP_Queue_Reserve(&queue, MSTP_QUEUE_PRIORITY);
+  ct_test(pTest, frame != NULL);
+  ct_test(pTest, MSTP_Queue_Count(&queue) == 0);
+  ((struct MSTP_Queue_Frame *)frame)->frame_type = FRAME_TYPE_TEST_REQUEST;
+  ((struct MSTP_Queue_Frame *)frame)->destination = 30;
+  ((struct MSTP_Queue_Frame *)frame)->data_len = 0;
+  MSTP_Queue_Commit(&queue, MSTP_QUEUE_PRIORITY);
+  ct_test(pTest, MSTP_Queue_Count(&queue) == 1);
+  ct_test(pTest, MSTP_Queue_Front(&queue) == frame);
+  MSTP_Queue_Pop(&queue);
+  ct_test(pTest, MSTP_Queue_Count(&queue) == 0);
+
+  // a COBS-encoded frame carries a whole APDU, but never nothing
+  ct_test(pTest, MSTP_Queue_Put(&queue, FALSE,
+    FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY, 40, big,
+    MSTP_EXTENDED_DATA_MAX));
+  ct_test(pTest, !MSTP_Queue_Put(&queue, FALSE,
+    FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY, 41, big,
+    MSTP_EXTENDED_DATA_MAX + 1));
+  ct_test(pTest, !MSTP_Queue_Put(&queue, FALSE,
+    FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY, 41, NULL, 0));
+  ct_test(pTest, MSTP_Queue_Count(&queue) == 1);
+  ct_test(pTest, queue.lane[MSTP_QUEUE_EXPECTING_REPLY].tail !=
+    queue.lane[MSTP_QUEUE_EXPECTING_REPLY].head);
+  frame = MSTP_Queue_Front(&queue);
+  ct_test(pTest, frame != NULL);
+  ct_test(pTest, frame->data_len == MSTP_EXTENDED_DATA_MAX);
+  ct_test(pTest, memcmp(frame->data, big, MSTP_EXTENDED_DATA_MAX) == 0);
+  MSTP_Queue_Pop(&queue);
+
+  return;
+}
+
+// one thread queues frames in all of the lanes while another sends
+// them: each lane keeps its order and no frame is lost or torn
+#define TEST_QUEUE_FRAMES 1000000UL
+
+struct test_queue_threads
+{
+  struct MSTP_Queue queue;
+  struct MSTP_Queue_Frame frames[MSTP_QUEUE_LANES * TEST_QUEUE_SIZE];
+  unsigned long errors;
+};
+
+static void *test_queue_producer(void *arg)
+{
+  struct test_queue_threads *test = arg;
+  struct MSTP_Queue_Frame *frame;
+  unsigned long sequence[MSTP_QUEUE_LANES] = {0};
+  unsigned long n = 0;
+  unsigned lane;
+
+  while (n < TEST_QUEUE_FRAMES)
+  {
+    lane = (unsigned)((n * 7) / 5) % MSTP_QUEUE_LANES;
+    frame = MSTP_Queue_Reserve(&test->queue, lane);
+    if (frame == NULL)
+    {
+      sched_yield();
+      continue;
+    }
+    frame->tag = sequence[lane]++;
+    frame->data_len = (unsigned)(frame->tag % 8) + 1;
+    memset(frame->data, (int)(frame->tag & 0xFF), frame->data_len);
+    MSTP_Queue_Commit(&test->queue, lane);
+    n++;
+  }
+
+  return NULL;
+}
+
+static void *test_queue_consumer(void *arg)
+{
+  struct test_queue_threads *test = arg;
+  const struct MSTP_Queue_Frame *frame;
+  unsigned long sequence[MSTP_QUEUE_LANES] = {0};
+  unsigned long n = 0;
+  unsigned lane;
+  unsigned i;
+
+  while (n < TEST_QUEUE_FRAMES)
+  {
+    frame = MSTP_Queue_Front(&test->queue);
+    if (frame == NULL)
+    {
+      sched_yield();
+      continue;
+    }
+    lane = test->queue.front;
+    if ((frame->tag != sequence[lane]) ||
+        (frame->data_len != (unsigned)(frame->tag % 8) + 1))
+      test->errors++;
+    for (i = 0; i < frame->data_len; i++)
+    {
+      if (frame->data[i] != (UINT8)(frame->tag & 0xFF))
+        test->errors++;
+    }
+    sequence[lane]++;
+    MSTP_Queue_Pop(&test->queue);
+    n++;
+  }
+
+  return NULL;
+}
+
+void testQueueThreads(Test* pTest)
+{
+  struct test_queue_threads *test;
+  pthread_t producer, consumer;
+
+  // the aligned members need an aligned allocation
+  if (posix_memalign((void **)&test, MSTP_CACHE_LINE, sizeof(*test)))
+    return;
+  memset(test, 0, sizeof(*test));
+  ct_test(pTest, MSTP_Queue_Init(&test->queue, test->frames,
+    TEST_QUEUE_SIZE));
+  ct_test(pTest, pthread_create(&consumer, NULL, test_queue_consumer,
+    test) == 0);
+  ct_test(pTest, pthread_create(&producer, NULL, test_queue_producer,
+    test) == 0);
+  pthread_join(producer, NULL);
+  pthread_join(consumer, NULL);
+  ct_test(pTest, test->errors == 0);
+  ct_test(pTest, MSTP_Queue_Count(&test->queue) == 0);
+  free(test);
+
+  return;
+}
+
+#ifdef TEST_MSTPQ
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("mstpq", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testQueue);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testQueueThreads);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  return 0;
+}
+#endif /* TEST_MSTPQ */
+#endif /* TEST */
@@ -0,0 +1,135 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef MSTPQ_H
+#define MSTPQ_H
+
+#include "mstp.h"
+
+// Outgoing frame queue of one MS/TP port.
+// Frames wait here for the token, and are sent in the USE_TOKEN state,
+// up to Nmax_info_frames for each token.  There are three lanes: the
+// priority lane, which is always sent first, and a lane each for the
+// frames that expect a reply and those that do not, which take turns
+// so that a steady stream of one class cannot hold back the other.
+// Every frame is in an array that the owner gives to MSTP_Queue_Init,
+// so nothing is allocated while the port runs.
+//
+// Each lane is a lock-free ring for one producer, the thread that
+// queues the frames, and one consumer, the thread that runs the
+// state machines.  A frame stays in its slot until it has been sent,
+// so SendFrame uses the data in place.
+
+#define MSTP_QUEUE_PRIORITY 0 // frames of any type that go first
+#define MSTP_QUEUE_EXPECTING_REPLY 1 // frames that expect a reply
+#define MSTP_QUEUE_NOT_EXPECTING_REPLY 2 // all other frames
+#define MSTP_QUEUE_LANES 3
+
+struct MSTP_Queue_Frame
+{
+  UINT8 frame_type;
+  UINT8 destination;
+  unsigned data_len;
+  unsigned long long tag; // for the owner, such as when it was queued
+  UINT8 data[MSTP_EXTENDED_DATA_MAX]; // up to MSTP_FRAME_DATA_MAX
+};
+
+struct MSTP_Queue_Lane
+{
+  // read only after MSTP_Queue_Init
+  struct MSTP_Queue_Frame *frame MSTP_CACHE_ALIGN;
+  unsigned mask; // frames in the lane - 1
+  // written only by the producer
+  unsigned tail MSTP_CACHE_ALIGN; // next frame to queue
+  // written only by the consumer
+  unsigned head MSTP_CACHE_ALIGN; // next frame to send
+};
+
+struct MSTP_Queue
+{
+  struct MSTP_Queue_Lane lane[MSTP_QUEUE_LANES];
+  // written only by the consumer
+  unsigned turn; // the reply lane that goes next
+  unsigned front; // lane of the front frame, or MSTP_QUEUE_LANES
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// sets up a queue with size frames in each lane, from an array of
+// MSTP_QUEUE_LANES * size frames.  returns FALSE if size is not a
+// power of two.
+BOOLEAN MSTP_Queue_Init(
+  struct MSTP_Queue *queue,
+  struct MSTP_Queue_Frame *frames,
+  unsigned size);
+
+// the lane of a frame type that is not urgent
+unsigned MSTP_Queue_Lane(UINT8 frame_type);
+
+// producer side: returns the free slot at the end of a lane, to be
+// filled in place and queued with MSTP_Queue_Commit, or NULL if the
+// lane is full.
+struct MSTP_Queue_Frame *MSTP_Queue_Reserve(
+  struct MSTP_Queue *queue,
+  unsigned lane);
+void MSTP_Queue_Commit(
+  struct MSTP_Queue *queue,
+  unsigned lane);
+
+// producer side: copies a frame into its lane, or the priority lane.
+// returns FALSE if the lane is full or the data is too long.
+BOOLEAN MSTP_Queue_Put(
+  struct MSTP_Queue *queue,
+  BOOLEAN priority,
+  UINT8 frame_type,
+  UINT8 destination,
+  const UINT8 *data,
+  unsigned data_len);
+
+// frames waiting in all of the lanes
+unsigned MSTP_Queue_Count(struct MSTP_Queue *queue);
+
+// consumer side: returns the frame to send next, or NULL if there is
+// none.  It stays at the front, and its data stays valid, until
+// MSTP_Queue_Pop.
+const struct MSTP_Queue_Frame *MSTP_Queue_Front(struct MSTP_Queue *queue);
+void MSTP_Queue_Pop(struct MSTP_Queue *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
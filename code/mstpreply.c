@@ -0,0 +1,496 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// Reply cache for the Reply_Data of an MS/TP port
+//
+// The entries are a hash table with linear probing.  A request is
+// hashed with FNV-1a over its octets, skipping the invoke ID, which is
+// found from the NPDU control octet and the APDU type.  One entry is
+// always left free so that a search for a request that is not there
+// ends at a free entry.
+
+#include <stddef.h>
+#include <string.h>
+#include "bacenum.h"
+#include "mstp.h"
+#include "npdu.h"
+#include "mstpreply.h" // check for valid prototypes
+
+#define FNV_OFFSET_BASIS 2166136261UL
+#define FNV_PRIME 16777619UL
+
+// returns the offset of the invoke ID in an NPDU, or 0 if it has none
+static unsigned reply_invoke(const UINT8 *npdu, unsigned length)
+{
+  struct NPDU_Header header;
+  unsigned offset;
+  unsigned type;
+
+  if (!NPDU_Decode(npdu, length, &header) ||
+      (header.control & NPDU_NETWORK_LAYER_MESSAGE))
+    return 0;
+  type = npdu[header.offset] >> 4;
+  if (type == PDU_TYPE_CONFIRMED_SERVICE_REQUEST)
+    offset = header.offset + 2; // after the maximum segments and APDU size
+  else if ((type >= PDU_TYPE_SIMPLE_ACK) && (type <= PDU_TYPE_ABORT))
+    offset = header.offset + 1;
+  else
+    return 0;
+  if (offset >= length)
+    return 0;
+
+  return offset;
+}
+
+// FNV-1a of the octets of a request, less its invoke ID
+static unsigned long reply_hash(
+  const UINT8 *request,
+  unsigned length,
+  unsigned invoke)
+{
+  unsigned long hash = FNV_OFFSET_BASIS;
+  unsigned i;
+
+  for (i = 0; i < length; i++)
+  {
+    if ((i == invoke) && invoke)
+      continue;
+    hash = ((hash ^ request[i]) * FNV_PRIME) & 0xFFFFFFFFUL;
+  }
+
+  return hash;
+}
+
+// the octets of two requests are the same, other than their invoke IDs
+static BOOLEAN reply_same(
+  const struct MSTP_Reply_Entry *entry,
+  const UINT8 *request,
+  unsigned length,
+  unsigned invoke)
+{
+  if ((entry->request_length != length) || (entry->request_invoke != invoke))
+    return FALSE;
+  if (invoke == 0)
+    return (memcmp(entry->request, request, length) == 0);
+
+  return (memcmp(entry->request, request, invoke) == 0) &&
+    (memcmp(&entry->request[invoke + 1], &request[invoke + 1],
+      length - invoke - 1) == 0);
+}
+
+// returns the entry of a request, or the free entry where it would go
+static struct MSTP_Reply_Entry *reply_entry(
+  struct MSTP_Reply_Cache *cache,
+  const UINT8 *request,
+  unsigned length,
+  unsigned invoke,
+  unsigned long hash)
+{
+  struct MSTP_Reply_Entry *entry;
+  unsigned i = (unsigned)hash & cache->mask;
+
+  for (;;)
+  {
+    entry = &cache->entry[i];
+    if (entry->request == NULL)
+      break;
+    if ((entry->hash == hash) &&
+        reply_same(entry, request, length, invoke))
+      break;
+    i = (i + 1) & cache->mask;
+  }
+
+  return entry;
+}
+
+BOOLEAN MSTP_Reply_Cache_Init(
+  struct MSTP_Reply_Cache *cache,
+  struct MSTP_Reply_Entry *entries,
+  unsigned size)
+{
+  if (!cache || !entries || (size < 2) || (size & (size - 1)))
+    return FALSE;
+  memset(cache, 0, sizeof(struct MSTP_Reply_Cache));
+  memset(entries, 0, size * sizeof(struct MSTP_Reply_Entry));
+  cache->entry = entries;
+  cache->mask = size - 1;
+
+  return TRUE;
+}
+
+BOOLEAN MSTP_Reply_Cache_Add(
+  struct MSTP_Reply_Cache *cache,
+  const UINT8 *request,
+  unsigned request_length,
+  UINT8 *reply,
+  unsigned reply_length)
+{
+  struct MSTP_Reply_Entry *entry;
+  unsigned invoke;
+  unsigned long hash;
+
+  if (!request || !request_length || !reply || !reply_length ||
+      (reply_length > MSTP_EXTENDED_DATA_MAX))
+    return FALSE;
+  invoke = reply_invoke(request, request_length);
+  hash = reply_hash(request, request_length, invoke);
+  entry = reply_entry(cache, request, request_length, invoke, hash);
+  if (entry->request == NULL)
+  {
+    if (cache->count >= cache->mask)
+      return FALSE;
+    cache->count++;
+    entry->request = request;
+    entry->request_length = request_length;
+    entry->request_invoke = invoke;
+    entry->hash = hash;
+  }
+  entry->reply = reply;
+  entry->reply_length = reply_length;
+  // an invoke ID is only copied from a request that has one
+  entry->reply_invoke = invoke ? reply_invoke(reply, reply_length) : 0;
+  entry->hits = 0;
+
+  return TRUE;
+}
+
+unsigned MSTP_Reply_Cache_Find(
+  struct MSTP_Reply_Cache *cache,
+  const UINT8 *request,
+  unsigned request_length,
+  const UINT8 **reply)
+{
+  struct MSTP_Reply_Entry *entry;
+  unsigned invoke;
+
+  invoke = reply_invoke(request, request_length);
+  entry = reply_entry(cache, request, request_length, invoke,
+    reply_hash(request, request_length, invoke));
+  if (entry->request == NULL)
+  {
+    cache->misses++;
+    return 0;
+  }
+  if (entry->reply_invoke)
+    entry->reply[entry->reply_invoke] = request[invoke];
+  entry->hits++;
+  cache->hits++;
+  *reply = entry->reply;
+
+  return entry->reply_length;
+}
+
+unsigned MSTP_Reply_Cache_Reply_Data(
+  struct MSTP_Port *port,
+  const UINT8 **reply)
+{
+  return MSTP_Reply_Cache_Find(port->Reply_Context,
+    port->InputBuffer, port->DataLength, reply);
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+
+#include "monotime.h"
+#include "mstptest.h"
+#include "ctest.h"
+
+// a ReadProperty request for the Present_Value of an Analog Input
+static unsigned test_request(UINT8 *npdu, UINT8 invoke, unsigned instance)
+{
+  unsigned length = 0;
+
+  npdu[length++] = BACNET_PROTOCOL_VERSION;
+  npdu[length++] = 0x04; // expecting reply
+  npdu[length++] = 0x00; // Confirmed-Request, not segmented
+  npdu[length++] = 0x05; // up to 1476 octets accepted
+  npdu[length++] = invoke;
+  npdu[length++] = 12; // ReadProperty
+  npdu[length++] = 0x0C; // context tag 0, object identifier
+  npdu[length++] = 0x00;
+  npdu[length++] = (UINT8)(instance >> 16);
+  npdu[length++] = (UINT8)(instance >> 8);
+  npdu[length++] = (UINT8)instance;
+  npdu[length++] = 0x19; // context tag 1, property identifier
+  npdu[length++] = 85; // Present_Value
+
+  return length;
+}
+
+// the ReadProperty-ACK with a REAL of value for the request
+static unsigned test_reply(UINT8 *npdu, unsigned instance, UINT8 value)
+{
+  unsigned length = 0;
+
+  npdu[length++] = BACNET_PROTOCOL_VERSION;
+  npdu[length++] = 0x00;
+  npdu[length++] = 0x30; // Complex-ACK
+  npdu[length++] = 0; // invoke ID, from the request
+  npdu[length++] = 12; // ReadProperty
+  npdu[length++] = 0x0C;
+  npdu[length++] = 0x00;
+  npdu[length++] = (UINT8)(instance >> 16);
+  npdu[length++] = (UINT8)(instance >> 8);
+  npdu[length++] = (UINT8)instance;
+  npdu[length++] = 0x19;
+  npdu[length++] = 85;
+  npdu[length++] = 0x3E; // opening tag 3
+  npdu[length++] = 0x44; // REAL
+  npdu[length++] = 0x42;
+  npdu[length++] = value;
+  npdu[length++] = 0x00;
+  npdu[length++] = 0x00;
+  npdu[length++] = 0x3F; // closing tag 3
+
+  return length;
+}
+
+void testReplyCache(Test* pTest)
+{
+  static struct MSTP_Reply_Cache cache;
+  static struct MSTP_Reply_Entry entries[4];
+  static UINT8 request[4][32];
+  static UINT8 reply[4][32];
+  unsigned request_length[4];
+  unsigned reply_length[4];
+  UINT8 npdu[32];
+  UINT8 routed[] = {
+    BACNET_PROTOCOL_VERSION,
+    0x24, // a destination, expecting reply
+    0x00, 0x07, 1, 42, // DNET 7, DADR 42
+    255, // hop count
+    0x00, 0x05, 99, 12, 0x0C, 0x00, 0x00, 0x00, 0x01, 0x19, 85};
+  const UINT8 *found = NULL;
+  unsigned length;
+  unsigned i;
+
+  ct_test(pTest, !MSTP_Reply_Cache_Init(&cache, entries, 0));
+  ct_test(pTest, !MSTP_Reply_Cache_Init(&cache, entries, 3));
+  ct_test(pTest, MSTP_Reply_Cache_Init(&cache, entries, 4));
+  length = test_request(npdu, 1, 1);
+  ct_test(pTest, MSTP_Reply_Cache_Find(&cache, npdu, length, &found) == 0);
+  ct_test(pTest, cache.misses == 1);
+  for (i = 0; i < 4; i++)
+  {
+    request_length[i] = test_request(request[i], (UINT8)(10 + i), i);
+    reply_length[i] = test_reply(reply[i], i, (UINT8)i);
+  }
+  ct_test(pTest, !MSTP_Reply_Cache_Add(&cache, request[0],
+    request_length[0], reply[0], 0));
+  ct_test(pTest, !MSTP_Reply_Cache_Add(&cache, request[0],
+    request_length[0], reply[0], MSTP_EXTENDED_DATA_MAX + 1));
+  // one entry is always free
+  for (i = 0; i < 3; i++)
+    ct_test(pTest, MSTP_Reply_Cache_Add(&cache, request[i],
+      request_length[i], reply[i], reply_length[i]));
+  ct_test(pTest, !MSTP_Reply_Cache_Add(&cache, request[3],
+    request_length[3], reply[3], reply_length[3]));
+  ct_test(pTest, cache.count == 3);
+
+  // found with any invoke ID, which is copied into the reply
+  for (i = 0; i < 3; i++)
+  {
+    length = test_request(npdu, (UINT8)(200 + i), i);
+    ct_test(pTest, MSTP_Reply_Cache_Find(&cache, npdu, length, &found) ==
+      reply_length[i]);
+    ct_test(pTest, found == reply[i]);
+    ct_test(pTest, found[3] == 200 + i);
+    ct_test(pTest, found[15] == i);
+  }
+  ct_test(pTest, cache.hits == 3);
+  // but not if anything else differs
+  length = test_request(npdu, 1, 3);
+  ct_test(pTest, MSTP_Reply_Cache_Find(&cache, npdu, length, &found) == 0);
+  length = test_request(npdu, 1, 0);
+  npdu[length - 1] = 77;
+  ct_test(pTest, MSTP_Reply_Cache_Find(&cache, npdu, length, &found) == 0);
+  ct_test(pTest, MSTP_Reply_Cache_Find(&cache, npdu, length - 1, &found) == 0);
+  ct_test(pTest, cache.misses == 4);
+  // a request that is there again gets the new reply
+  length = test_request(npdu, 5, 1);
+  ct_test(pTest, MSTP_Reply_Cache_Add(&cache, npdu, length,
+    reply[3], reply_length[3]));
+  ct_test(pTest, cache.count == 3);
+  ct_test(pTest, MSTP_Reply_Cache_Find(&cache, request[1],
+    request_length[1], &found) == reply_length[3]);
+  ct_test(pTest, found == reply[3]);
+  ct_test(pTest, found[3] == 11);
+
+  // the invoke ID of a routed request is after the network header
+  ct_test(pTest, MSTP_Reply_Cache_Init(&cache, entries, 4));
+  ct_test(pTest, MSTP_Reply_Cache_Add(&cache, routed, sizeof(routed),
+    reply[0], reply_length[0]));
+  routed[9] = 100;
+  ct_test(pTest, MSTP_Reply_Cache_Find(&cache, routed, sizeof(routed),
+    &found) == reply_length[0]);
+  ct_test(pTest, found[3] == 100);
+  routed[5] = 43;
+  ct_test(pTest, MSTP_Reply_Cache_Find(&cache, routed, sizeof(routed),
+    &found) == 0);
+  // a network layer message is matched octet for octet
+  npdu[0] = BACNET_PROTOCOL_VERSION;
+  npdu[1] = NPDU_NETWORK_LAYER_MESSAGE;
+  npdu[2] = 0x00;
+  npdu[3] = 0x00;
+  ct_test(pTest, MSTP_Reply_Cache_Add(&cache, npdu, 4,
+    reply[1], reply_length[1]));
+  npdu[3] = 0x01;
+  ct_test(pTest, MSTP_Reply_Cache_Find(&cache, npdu, 4, &found) == 0);
+
+  return;
+}
+
+// a port answers a request from the cache at once, and postpones
+// one that is not in it
+void testReplyCachePort(Test* pTest)
+{
+  static struct MSTP_Port port;
+  static struct MSTP_Reply_Cache cache;
+  static struct MSTP_Reply_Entry entries[8];
+  static UINT8 request[32];
+  static UINT8 reply[32];
+  UINT8 npdu[32];
+  UINT8 frame[64];
+  unsigned length;
+  unsigned reply_length;
+
+  ct_test(pTest, MSTP_Reply_Cache_Init(&cache, entries, 8));
+  length = test_request(request, 0, 7);
+  reply_length = test_reply(reply, 7, 3);
+  ct_test(pTest, MSTP_Reply_Cache_Add(&cache, request, length,
+    reply, reply_length));
+  MSTP_Init(&port, 5);
+  Master_Node_FSM(&port);
+  port.Send_Frame = Test_Send_Frame;
+  port.Reply_Data = MSTP_Reply_Cache_Reply_Data;
+  port.Reply_Context = &cache;
+  length = test_request(npdu, 42, 7);
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY, 5, 9, npdu, length);
+  (void)MSTP_Receive_Octets(&port, frame, length);
+  Master_Node_FSM(&port);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Stats.replies_sent == 1);
+  ct_test(pTest, Test_Sent_Length == MSTP_HEADER_SIZE + reply_length + 2);
+  ct_test(pTest, Test_Sent[2] == FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY);
+  ct_test(pTest, Test_Sent[3] == 9);
+  ct_test(pTest, Test_Sent[MSTP_HEADER_SIZE + 3] == 42);
+  ct_test(pTest, memcmp(&Test_Sent[MSTP_HEADER_SIZE + 4], &reply[4],
+    reply_length - 4) == 0);
+  // another object is not cached
+  length = test_request(npdu, 43, 8);
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY, 5, 9, npdu, length);
+  (void)MSTP_Receive_Octets(&port, frame, length);
+  Master_Node_FSM(&port);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Stats.replies_sent == 1);
+  ct_test(pTest, port.Stats.replies_postponed_sent == 1);
+  ct_test(pTest, Test_Sent[2] == FRAME_TYPE_REPLY_POSTPONED);
+  ct_test(pTest, cache.hits == 1);
+  ct_test(pTest, cache.misses == 1);
+
+  return;
+}
+
+#ifdef TEST_MSTPREPLY
+// nanoseconds to find a reply among many cached ReadProperty requests,
+// next to the Treply_delay that it must be found within
+void benchmarkReplyCache(void)
+{
+  static struct MSTP_Reply_Cache cache;
+  static struct MSTP_Reply_Entry entries[1024];
+  static UINT8 request[512][16];
+  static UINT8 reply[512][32];
+  static UINT8 npdu[1024][16];
+  const UINT8 *found = NULL;
+  unsigned length[1024];
+  unsigned long sum = 0;
+  unsigned long rounds = 2000;
+  unsigned long i;
+  unsigned j;
+  double start, seconds;
+
+  (void)MSTP_Reply_Cache_Init(&cache, entries, 1024);
+  for (j = 0; j < 512; j++)
+  {
+    length[j] = test_request(request[j], 0, j);
+    (void)MSTP_Reply_Cache_Add(&cache, request[j], length[j],
+      reply[j], test_reply(reply[j], j, (UINT8)j));
+  }
+  // half of the requests are cached, with new invoke IDs
+  for (j = 0; j < 1024; j++)
+    length[j] = test_request(npdu[j], (UINT8)j, j);
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < rounds; i++)
+  {
+    for (j = 0; j < 1024; j++)
+      sum += MSTP_Reply_Cache_Find(&cache, npdu[j], length[j], &found);
+  }
+  seconds = OS_MonotonicSeconds() - start;
+  printf("reply cache: 512 of 1024 entries, %.0f ns a request, "
+    "%lu hits, %lu misses (%lu)\n",
+    (seconds * 1.0e9) / (double)(rounds * 1024), cache.hits, cache.misses,
+    sum);
+
+  return;
+}
+
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("mstpreply", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testReplyCache);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testReplyCachePort);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  benchmarkReplyCache();
+
+  return 0;
+}
+#endif /* TEST_MSTPREPLY */
+#endif /* TEST */
@@ -0,0 +1,111 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef MSTPREPLY_H
+#define MSTPREPLY_H
+
+#include "mstp.h"
+
+// A cache of precomputed replies for the Reply_Data of an MS/TP port,
+// so that a request is answered within Treply_delay instead of with a
+// Reply Postponed frame and a wait for the token.
+// A request is found by its octets, less the invoke ID of a confirmed
+// request, and the invoke ID of the request is written into the reply
+// before it is sent.  The entries are in an array that the owner gives
+// to MSTP_Reply_Cache_Init, and the requests and replies stay in the
+// owner's buffers, so nothing is allocated or copied while the port
+// runs.  The cache is filled before the port runs, and is then only
+// used by the thread that runs the state machines.
+
+struct MSTP_Reply_Entry
+{
+  const UINT8 *request; // NULL if the entry is free
+  unsigned request_length;
+  unsigned request_invoke; // offset of the invoke ID, or 0 if none
+  unsigned long hash; // of the request, less its invoke ID
+  UINT8 *reply; // the NPDU to send
+  unsigned reply_length;
+  unsigned reply_invoke; // offset of the invoke ID, or 0 if none
+  unsigned long hits;
+};
+
+struct MSTP_Reply_Cache
+{
+  struct MSTP_Reply_Entry *entry; // the owner's array
+  unsigned mask; // entries - 1
+  unsigned count; // entries in use
+  unsigned long hits; // requests answered
+  unsigned long misses; // requests that were not in the cache
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// sets up an empty cache of size entries.
+// returns FALSE if size is not a power of two.
+BOOLEAN MSTP_Reply_Cache_Init(
+  struct MSTP_Reply_Cache *cache,
+  struct MSTP_Reply_Entry *entries,
+  unsigned size);
+
+// adds the reply to a request, or replaces the reply of a request that
+// is already there.  Both stay where they are, and the reply is written
+// to with the invoke ID of each request.  returns FALSE if the cache is
+// full, or the reply is empty or too long for a frame.
+BOOLEAN MSTP_Reply_Cache_Add(
+  struct MSTP_Reply_Cache *cache,
+  const UINT8 *request,
+  unsigned request_length,
+  UINT8 *reply,
+  unsigned reply_length);
+
+// returns the length of the reply to a request, which *reply is
+// pointed at, or 0 if the request is not in the cache
+unsigned MSTP_Reply_Cache_Find(
+  struct MSTP_Reply_Cache *cache,
+  const UINT8 *request,
+  unsigned request_length,
+  const UINT8 **reply);
+
+// the Reply_Data of a port whose Reply_Context is an MSTP_Reply_Cache
+unsigned MSTP_Reply_Cache_Reply_Data(
+  struct MSTP_Port *port,
+  const UINT8 **reply);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,763 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// MS/TP Bus Simulator
+//
+// Each master node is an MSTP_Port that runs the real Receive and
+// Master Node State Machines.  The bus is a queue of frames that are
+// sent one octet at a time, at the octet time of the baud rate, to
+// every node but the sender.  A node that sends a frame waits for the
+// turnaround time after the end of the last frame on the bus.
+//
+// Time is kept in nanoseconds.  The simulation moves from one event
+// to the next: the end of an octet on the bus, or the millisecond
+// tick that runs the timers of every node.  There is nothing random,
+// so the same configuration always gives the same results.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mstp.h"
+#include "mstpq.h"
+#include "mstpsim.h" // check for valid prototypes
+
+#define NANOSECONDS_PER_MILLISECOND 1000000ULL
+
+// frames waiting for or using the bus
+#define SIM_BUS_FRAMES 8
+// data frames that can wait in each lane of a node's queue
+#define SIM_QUEUE_SIZE 64
+// state changes of the Master Node State Machine for each event
+#define SIM_FSM_STEPS 8
+
+struct sim;
+
+struct sim_node
+{
+  struct MSTP_Port port;
+  struct sim *sim;
+  unsigned index; // index of the node in the simulation
+  // data frames waiting for the token, tagged with the time they
+  // were queued
+  struct MSTP_Queue queue;
+  struct MSTP_Queue_Frame frames[MSTP_QUEUE_LANES * SIM_QUEUE_SIZE];
+  unsigned long queued; // data frames queued by this node
+  bool sending; // a frame from this node is on the bus
+  uint64_t token; // time this node last got the token, or zero
+  UINT8 data[INPUT_BUFFER_SIZE]; // the data of every data frame
+};
+
+struct sim_frame
+{
+  UINT8 buffer[MAX_FRAME_SIZE];
+  unsigned length;
+  unsigned sender; // index of the node that sends it
+  uint64_t start; // time the first octet begins
+};
+
+struct sim
+{
+  const struct MSTP_Sim_Config *config;
+  struct MSTP_Sim_Stats *stats;
+  uint64_t now; // simulated time in nanoseconds
+  uint64_t measure; // time the measurement starts
+  uint64_t octet_time; // nanoseconds for one octet
+  uint64_t turnaround; // nanoseconds of turnaround
+  // frames on the bus
+  struct sim_frame frame[SIM_BUS_FRAMES];
+  unsigned head;
+  unsigned count;
+  unsigned octet; // octet of the head frame that is being sent
+  uint64_t free; // time the bus is free after the last frame
+  // a Poll For Master is in progress
+  bool polling;
+  uint64_t poll_start;
+  struct sim_node node[MSTP_SIM_MASTERS_MAX];
+};
+
+// the measurement counts only what happens after the warm up
+static bool sim_measuring(const struct sim *sim)
+{
+  return (sim->now >= sim->measure);
+}
+
+// runs the Master Node State Machine until it stops changing state.
+// SendFrame does not return on a real node until the frame is sent,
+// so the machine waits while a frame from the node is on the bus.
+static void sim_master_fsm(struct sim_node *node)
+{
+  MSTP_MASTER_STATE state;
+  unsigned steps;
+
+  for (steps = 0; steps < SIM_FSM_STEPS; steps++)
+  {
+    if (node->sending)
+      break;
+    state = node->port.Master_State;
+    Master_Node_FSM(&node->port);
+    if (node->port.Master_State == state)
+      break;
+  }
+
+  return;
+}
+
+// counts the time a data frame waited in the queue
+static void sim_latency(
+  struct sim *sim,
+  const struct MSTP_Queue_Frame *queued)
+{
+  struct MSTP_Sim_Stats *stats = sim->stats;
+  uint64_t latency;
+
+  if (queued == NULL)
+    return;
+  latency = sim->now - queued->tag;
+  stats->latencies++;
+  stats->latency_sum += latency;
+  if (latency > stats->latency_max)
+    stats->latency_max = latency;
+
+  return;
+}
+
+// queues the next data frame of a node, to the next node.
+// every reply_every-th frame is a Test_Request that expects a reply.
+static void sim_queue(struct sim *sim, struct sim_node *node)
+{
+  const struct MSTP_Sim_Config *config = sim->config;
+  struct MSTP_Queue_Frame *frame;
+  UINT8 frame_type = FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY;
+  unsigned lane;
+
+  if (config->reply_every &&
+      (((node->queued + 1) % config->reply_every) == 0))
+    frame_type = FRAME_TYPE_TEST_REQUEST;
+  lane = MSTP_Queue_Lane(frame_type);
+  frame = MSTP_Queue_Reserve(&node->queue, lane);
+  if (frame == NULL)
+  {
+    if (sim_measuring(sim))
+      sim->stats->dropped++;
+    return;
+  }
+  frame->frame_type = frame_type;
+  frame->destination = (UINT8)((node->index + 1) % config->masters);
+  frame->data_len = config->data_len;
+  frame->tag = sim->now;
+  memcpy(frame->data, node->data, config->data_len);
+  MSTP_Queue_Commit(&node->queue, lane);
+  node->queued++;
+
+  return;
+}
+
+// the Send_Frame of every port - puts the frame on the bus
+static void sim_send_frame(
+  struct MSTP_Port *port,
+  const struct MSTP_Frame_Part *part,
+  unsigned count)
+{
+  struct sim_node *node = port->Context;
+  struct sim *sim = node->sim;
+  struct sim_frame *frame;
+  uint64_t start;
+  unsigned length = 0;
+  unsigned i;
+
+  // another node is still talking, and would garble the frame
+  if ((sim->free > sim->now) && sim_measuring(sim))
+    sim->stats->collisions++;
+  if (sim->count >= SIM_BUS_FRAMES)
+    return;
+  start = sim->now + sim->turnaround;
+  if (sim->free > start)
+    start = sim->free;
+  // the octets on the wire
+  frame = &sim->frame[(sim->head + sim->count) % SIM_BUS_FRAMES];
+  for (i = 0; i < count; i++)
+  {
+    memcpy(&frame->buffer[length], part[i].buffer, part[i].length);
+    length += part[i].length;
+  }
+  frame->length = length;
+  frame->sender = node->index;
+  frame->start = start;
+  sim->count++;
+  sim->free = start + (length * sim->octet_time);
+  node->sending = true;
+  // a data frame stays at the front of the queue while it is sent
+  if ((node->port.Master_State == MSTP_MASTER_STATE_USE_TOKEN) &&
+      sim_measuring(sim))
+    sim_latency(sim, MSTP_Queue_Front(&node->queue));
+
+  return;
+}
+
+// counts a frame as its first octet goes on the bus
+static void sim_frame_start(struct sim *sim, const struct sim_frame *frame)
+{
+  struct MSTP_Sim_Stats *stats = sim->stats;
+  struct sim_node *node;
+  UINT8 frame_type = frame->buffer[2];
+  UINT8 destination = frame->buffer[3];
+  uint64_t rotation;
+
+  if (!sim_measuring(sim))
+    return;
+  stats->busy += frame->length * sim->octet_time;
+  if (sim->polling)
+  {
+    stats->polling += frame->start - sim->poll_start;
+    sim->polling = false;
+  }
+  switch (frame_type)
+  {
+    case FRAME_TYPE_TOKEN:
+      stats->tokens++;
+      if (destination < sim->config->masters)
+      {
+        node = &sim->node[destination];
+        if (node->token)
+        {
+          rotation = frame->start - node->token;
+          stats->rotations++;
+          stats->rotation_sum += rotation;
+          if ((stats->rotation_min == 0) || (rotation < stats->rotation_min))
+            stats->rotation_min = rotation;
+          if (rotation > stats->rotation_max)
+            stats->rotation_max = rotation;
+        }
+        node->token = frame->start;
+      }
+      break;
+    case FRAME_TYPE_POLL_FOR_MASTER:
+    case FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER:
+      if (frame_type == FRAME_TYPE_POLL_FOR_MASTER)
+        stats->polls++;
+      else
+        stats->poll_replies++;
+      sim->polling = true;
+      sim->poll_start = frame->start;
+      break;
+    case FRAME_TYPE_TEST_RESPONSE:
+    case FRAME_TYPE_REPLY_POSTPONED:
+      stats->replies++;
+      break;
+    default:
+      stats->data_frames++;
+      break;
+  }
+
+  return;
+}
+
+// the next octet of the head frame reaches every node but the sender
+static void sim_octet(struct sim *sim)
+{
+  struct sim_frame *frame = &sim->frame[sim->head];
+  struct sim_node *node;
+  UINT8 octet;
+  unsigned i;
+  unsigned used;
+  unsigned calls;
+
+  if (sim->octet == 0)
+    sim_frame_start(sim, frame);
+  octet = frame->buffer[sim->octet];
+  for (i = 0; i < sim->config->masters; i++)
+  {
+    node = &sim->node[i];
+    if (i == frame->sender)
+    {
+      // As each octet is transmitted, set SilenceTimer to zero.
+      node->port.SilenceTimer = 0;
+      continue;
+    }
+    // a frame may be indicated before the octet is used
+    used = 0;
+    for (calls = 0; (used == 0) && (calls < 2); calls++)
+    {
+      used = MSTP_Receive_Octets(&node->port, &octet, 1);
+      if (node->port.ReceivedValidFrame || node->port.ReceivedInvalidFrame)
+        sim_master_fsm(node);
+    }
+  }
+  sim->octet++;
+  if (sim->octet >= frame->length)
+  {
+    sim->octet = 0;
+    sim->head = (sim->head + 1) % SIM_BUS_FRAMES;
+    sim->count--;
+    // SendFrame returns to the sender
+    node = &sim->node[frame->sender];
+    node->sending = false;
+    sim_master_fsm(node);
+  }
+
+  return;
+}
+
+// time that the octet being sent ends
+static uint64_t sim_octet_end(const struct sim *sim)
+{
+  const struct sim_frame *frame = &sim->frame[sim->head];
+
+  return frame->start + ((sim->octet + 1) * sim->octet_time);
+}
+
+// the millisecond tick of every node
+static void sim_tick(struct sim *sim, unsigned long milliseconds)
+{
+  const struct MSTP_Sim_Config *config = sim->config;
+  struct sim_node *node;
+  unsigned i;
+
+  for (i = 0; i < config->masters; i++)
+  {
+    node = &sim->node[i];
+    // data frames are queued at a steady rate, spread across the nodes
+    if (config->interval &&
+        ((milliseconds % config->interval) ==
+          ((i * config->interval) / config->masters)))
+      sim_queue(sim, node);
+    MSTP_Millisecond_Timer(&node->port);
+    sim_master_fsm(node);
+  }
+
+  return;
+}
+
+// fills in the standard parameters for a bus of masters at 38400 baud
+void MSTP_Sim_Default(struct MSTP_Sim_Config *config)
+{
+  memset(config, 0, sizeof(struct MSTP_Sim_Config));
+  config->masters = 32;
+  config->baud = 38400;
+  config->Npoll = 50;
+  config->Nmax_master = 127;
+  config->Nmax_info_frames = 1;
+  config->data_len = 50;
+  config->warmup = 5000;
+  config->duration = 60000;
+
+  return;
+}
+
+// runs a simulation.  returns false if the configuration is invalid
+// or the memory for the nodes is not available.
+bool MSTP_Sim_Run(
+  const struct MSTP_Sim_Config *config,
+  struct MSTP_Sim_Stats *stats)
+{
+  struct sim *sim = NULL;
+  struct sim_node *node;
+  const struct MSTP_Timing *timing;
+  uint64_t tick;
+  uint64_t end;
+  unsigned long milliseconds = 0;
+  unsigned i;
+
+  memset(stats, 0, sizeof(struct MSTP_Sim_Stats));
+  if ((config->masters == 0) || (config->masters > MSTP_SIM_MASTERS_MAX) ||
+      (config->masters > (config->Nmax_master + 1)) ||
+      (config->Nmax_master > 127) || (config->baud == 0) ||
+      (config->data_len == 0) || (config->data_len > INPUT_BUFFER_SIZE))
+    return false;
+  // the octet and turnaround times are those the ports use
+  timing = MSTP_Timing_Find(config->baud);
+  if (!timing)
+    return false;
+  // the ports are aligned to a cache line
+  if (posix_memalign((void **)&sim, MSTP_CACHE_LINE, sizeof(struct sim)))
+    return false;
+  memset(sim, 0, sizeof(struct sim));
+  sim->config = config;
+  sim->stats = stats;
+  sim->octet_time = timing->Toctet;
+  sim->turnaround = timing->Tturnaround;
+  sim->measure = config->warmup * NANOSECONDS_PER_MILLISECOND;
+  end = sim->measure + (config->duration * NANOSECONDS_PER_MILLISECOND);
+  for (i = 0; i < config->masters; i++)
+  {
+    node = &sim->node[i];
+    MSTP_Init(&node->port, (UINT8)i);
+    (void)MSTP_Timing_Set(&node->port, config->baud);
+    node->port.Npoll = config->Npoll;
+    node->port.Nmax_master = config->Nmax_master;
+    node->port.Nmax_info_frames = config->Nmax_info_frames;
+    node->port.Send_Frame = sim_send_frame;
+    (void)MSTP_Queue_Init(&node->queue, node->frames, SIM_QUEUE_SIZE);
+    node->port.Queue = &node->queue;
+    node->port.Context = node;
+    node->sim = sim;
+    node->index = i;
+    memset(node->data, (int)i, sizeof(node->data));
+    sim_master_fsm(node);
+  }
+  tick = NANOSECONDS_PER_MILLISECOND;
+  while (sim->now < end)
+  {
+    if (sim->count && (sim_octet_end(sim) <= tick))
+    {
+      sim->now = sim_octet_end(sim);
+      sim_octet(sim);
+    }
+    else
+    {
+      sim->now = tick;
+      tick += NANOSECONDS_PER_MILLISECOND;
+      sim_tick(sim, ++milliseconds);
+    }
+  }
+  stats->elapsed = end - sim->measure;
+  free(sim);
+
+  return true;
+}
+
+// prints the column headings for MSTP_Sim_Report
+void MSTP_Sim_Report_Header(FILE *stream)
+{
+  fprintf(stream,
+    "masters  baud Npoll Nmax_master Nmax_info | "
+    "rotation ms: mean   min    max | frames/token "
+    "polls/s poll%% busy%% | latency ms: mean    max\n");
+
+  return;
+}
+
+// prints one line with the configuration and its results
+void MSTP_Sim_Report(
+  FILE *stream,
+  const struct MSTP_Sim_Config *config,
+  const struct MSTP_Sim_Stats *stats)
+{
+  double elapsed = (double)stats->elapsed;
+  double rotations = stats->rotations ? (double)stats->rotations : 1.0;
+  double tokens = stats->tokens ? (double)stats->tokens : 1.0;
+  double latencies = stats->latencies ? (double)stats->latencies : 1.0;
+
+  if (elapsed <= 0.0)
+    elapsed = 1.0;
+  fprintf(stream,
+    "%7u %5u %5u %11u %9u | %18.2f %5.2f %6.2f | %12.2f "
+    "%7.2f %5.1f %5.1f | %16.2f %6.2f\n",
+    config->masters, config->baud, config->Npoll, config->Nmax_master,
+    config->Nmax_info_frames,
+    (stats->rotation_sum / rotations) / 1e6,
+    stats->rotation_min / 1e6,
+    stats->rotation_max / 1e6,
+    stats->data_frames / tokens,
+    stats->polls / (elapsed / 1e9),
+    (100.0 * stats->polling) / elapsed,
+    (100.0 * stats->busy) / elapsed,
+    (stats->latency_sum / latencies) / 1e6,
+    stats->latency_max / 1e6);
+
+  return;
+}
+
+#ifdef TEST
+#include <assert.h>
+
+#include "ctest.h"
+
+// a ring with no gaps in the station addresses never polls,
+// so the token goes around in exactly one token frame time
+// and one turnaround per node
+void testSimRing(Test* pTest)
+{
+  struct MSTP_Sim_Config config;
+  struct MSTP_Sim_Stats stats;
+  const struct MSTP_Timing *timing;
+  uint64_t hop;
+
+  MSTP_Sim_Default(&config);
+  config.masters = 4;
+  config.Nmax_master = 3;
+  config.duration = 10000;
+  ct_test(pTest, MSTP_Sim_Run(&config, &stats));
+  timing = MSTP_Timing_Find(config.baud);
+  hop = (8 * timing->Toctet) + timing->Tturnaround;
+  ct_test(pTest, stats.collisions == 0);
+  ct_test(pTest, stats.polls == 0);
+  ct_test(pTest, stats.data_frames == 0);
+  ct_test(pTest, stats.rotations > 1000);
+  ct_test(pTest, stats.rotation_min == (4 * hop));
+  ct_test(pTest, stats.rotation_max == (4 * hop));
+  ct_test(pTest, stats.tokens >= ((stats.elapsed / hop) - 1));
+  ct_test(pTest, stats.tokens <= ((stats.elapsed / hop) + 1));
+
+  // the last node polls the empty addresses
+  config.Nmax_master = 127;
+  ct_test(pTest, MSTP_Sim_Run(&config, &stats));
+  ct_test(pTest, stats.collisions == 0);
+  ct_test(pTest, stats.polls > 0);
+  ct_test(pTest, stats.poll_replies == 0);
+  ct_test(pTest, stats.rotation_min == (4 * hop));
+  ct_test(pTest, stats.rotation_max > (4 * hop));
+
+  return;
+}
+
+// the same configuration always gives the same results
+void testSimDeterministic(Test* pTest)
+{
+  struct MSTP_Sim_Config config;
+  struct MSTP_Sim_Stats stats[2];
+
+  MSTP_Sim_Default(&config);
+  config.masters = 16;
+  config.interval = 200;
+  config.reply_every = 3;
+  config.duration = 10000;
+  ct_test(pTest, MSTP_Sim_Run(&config, &stats[0]));
+  ct_test(pTest, MSTP_Sim_Run(&config, &stats[1]));
+  ct_test(pTest, memcmp(&stats[0], &stats[1], sizeof(stats[0])) == 0);
+  ct_test(pTest, stats[0].data_frames > 0);
+  ct_test(pTest, stats[0].replies > 0);
+
+  return;
+}
+
+// with every queue full, each token holder sends Nmax_info_frames
+void testSimInfoFrames(Test* pTest)
+{
+  struct MSTP_Sim_Config config;
+  struct MSTP_Sim_Stats stats;
+  unsigned nmax;
+
+  MSTP_Sim_Default(&config);
+  config.masters = 8;
+  config.Nmax_master = 7;
+  config.interval = 5;
+  config.duration = 10000;
+  for (nmax = 1; nmax <= 8; nmax *= 2)
+  {
+    config.Nmax_info_frames = nmax;
+    ct_test(pTest, MSTP_Sim_Run(&config, &stats));
+    ct_test(pTest, stats.collisions == 0);
+    ct_test(pTest, stats.dropped > 0);
+    ct_test(pTest, stats.data_frames >= ((stats.tokens - 1) * nmax));
+    ct_test(pTest, stats.data_frames <= ((stats.tokens + 1) * nmax));
+  }
+
+  return;
+}
+
+// every Test_Request is answered by a Test_Response
+void testSimReplies(Test* pTest)
+{
+  struct MSTP_Sim_Config config;
+  struct MSTP_Sim_Stats stats;
+
+  MSTP_Sim_Default(&config);
+  config.masters = 8;
+  config.interval = 1000;
+  config.reply_every = 1;
+  config.duration = 10000;
+  ct_test(pTest, MSTP_Sim_Run(&config, &stats));
+  ct_test(pTest, stats.collisions == 0);
+  ct_test(pTest, stats.dropped == 0);
+  ct_test(pTest, stats.data_frames > 0);
+  ct_test(pTest, stats.replies + 1 >= stats.data_frames);
+  ct_test(pTest, stats.replies <= stats.data_frames + 1);
+  ct_test(pTest, stats.latencies + 1 >= stats.data_frames);
+
+  // configurations that cannot run
+  config.masters = 0;
+  ct_test(pTest, !MSTP_Sim_Run(&config, &stats));
+  config.masters = MSTP_SIM_MASTERS_MAX + 1;
+  ct_test(pTest, !MSTP_Sim_Run(&config, &stats));
+  config.masters = 8;
+  config.Nmax_master = 6;
+  ct_test(pTest, !MSTP_Sim_Run(&config, &stats));
+  config.Nmax_master = 127;
+  config.data_len = INPUT_BUFFER_SIZE + 1;
+  ct_test(pTest, !MSTP_Sim_Run(&config, &stats));
+
+  return;
+}
+
+// runs one configuration and prints its line
+static void sim_study(struct MSTP_Sim_Config *config)
+{
+  struct MSTP_Sim_Stats stats;
+
+  if (MSTP_Sim_Run(config, &stats))
+    MSTP_Sim_Report(stdout, config, &stats);
+
+  return;
+}
+
+// how the token rotation and the poll overhead scale
+void studySim(void)
+{
+  static const unsigned masters[] = {2, 8, 32, 64, 127};
+  static const unsigned npoll[] = {10, 25, 50, 100, 200};
+  static const unsigned nmax_master[] = {31, 63, 127};
+  static const unsigned nmax_info_frames[] = {1, 2, 4, 8};
+  static const unsigned baud[] = {9600, 19200, 38400, 76800, 115200};
+  struct MSTP_Sim_Config config;
+  unsigned i;
+
+  printf("\nmasters, with no data frames\n");
+  MSTP_Sim_Report_Header(stdout);
+  for (i = 0; i < sizeof(masters)/sizeof(masters[0]); i++)
+  {
+    MSTP_Sim_Default(&config);
+    config.masters = masters[i];
+    sim_study(&config);
+  }
+  printf("\nNpoll, with 32 masters\n");
+  MSTP_Sim_Report_Header(stdout);
+  for (i = 0; i < sizeof(npoll)/sizeof(npoll[0]); i++)
+  {
+    MSTP_Sim_Default(&config);
+    config.Npoll = npoll[i];
+    sim_study(&config);
+  }
+  printf("\nNmax_master, with 32 masters\n");
+  MSTP_Sim_Report_Header(stdout);
+  for (i = 0; i < sizeof(nmax_master)/sizeof(nmax_master[0]); i++)
+  {
+    MSTP_Sim_Default(&config);
+    config.Nmax_master = nmax_master[i];
+    sim_study(&config);
+  }
+  printf("\nNmax_info_frames, with 32 masters each queuing "
+    "a frame every 700 ms, 1 in 4 a request\n");
+  MSTP_Sim_Report_Header(stdout);
+  for (i = 0; i < sizeof(nmax_info_frames)/sizeof(nmax_info_frames[0]); i++)
+  {
+    MSTP_Sim_Default(&config);
+    config.interval = 700;
+    config.reply_every = 4;
+    config.Nmax_info_frames = nmax_info_frames[i];
+    sim_study(&config);
+  }
+  printf("\nbaud, with 32 masters each queuing 1 frame/s\n");
+  MSTP_Sim_Report_Header(stdout);
+  for (i = 0; i < sizeof(baud)/sizeof(baud[0]); i++)
+  {
+    MSTP_Sim_Default(&config);
+    config.interval = 1000;
+    config.baud = baud[i];
+    sim_study(&config);
+  }
+
+  return;
+}
+
+// end to end throughput as Nmax_info_frames grows, with several
+// senders whose queues never run dry sharing one bus
+void benchmarkSimInfoFrames(void)
+{
+  static const unsigned masters[] = {2, 8, 32};
+  static const unsigned nmax_info_frames[] = {1, 2, 4, 8, 16, 32, 64};
+  struct MSTP_Sim_Config config;
+  struct MSTP_Sim_Stats stats;
+  double seconds;
+  unsigned i, j;
+
+  printf("\nthroughput, with every master queuing a frame every ms, "
+    "1 in 4 a request\n");
+  printf("masters Nmax_info | data frames/s data kB/s busy%% "
+    "| rotation ms latency ms\n");
+  for (i = 0; i < sizeof(masters)/sizeof(masters[0]); i++)
+  {
+    for (j = 0;
+         j < sizeof(nmax_info_frames)/sizeof(nmax_info_frames[0]); j++)
+    {
+      MSTP_Sim_Default(&config);
+      config.masters = masters[i];
+      config.Nmax_master = masters[i] - 1;
+      config.Nmax_info_frames = nmax_info_frames[j];
+      config.interval = 1;
+      config.reply_every = 4;
+      if (!MSTP_Sim_Run(&config, &stats))
+        continue;
+      seconds = stats.elapsed / 1e9;
+      printf("%7u %9u | %13.1f %9.2f %5.1f | %11.2f %10.1f\n",
+        config.masters, config.Nmax_info_frames,
+        stats.data_frames / seconds,
+        (stats.data_frames * (double)config.data_len) / seconds / 1e3,
+        (100.0 * stats.busy) / stats.elapsed,
+        stats.rotations ?
+          (stats.rotation_sum / (double)stats.rotations) / 1e6 : 0.0,
+        stats.latencies ?
+          (stats.latency_sum / (double)stats.latencies) / 1e6 : 0.0);
+    }
+  }
+
+  return;
+}
+
+#ifdef TEST_MSTPSIM
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("mstpsim", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testSimRing);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testSimDeterministic);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testSimInfoFrames);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testSimReplies);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  studySim();
+  benchmarkSimInfoFrames();
+
+  return 0;
+}
+#endif /* TEST_MSTPSIM */
+#endif /* TEST */
@@ -0,0 +1,116 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef MSTPSIM_H
+#define MSTPSIM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "mstp.h"
+
+// Simulates a number of MS/TP master nodes that share one EIA-485 bus.
+// Each node runs the real Receive and Master Node State Machines.
+// Time is simulated, so a run is exact and repeatable, and much
+// faster than the real bus.
+
+// the most master nodes on one bus
+#define MSTP_SIM_MASTERS_MAX 128
+
+struct MSTP_Sim_Config
+{
+  unsigned masters; // master nodes, at stations 0 to masters-1
+  unsigned baud; // bits per second on the bus
+  unsigned Npoll; // tokens between Poll For Master cycles
+  unsigned Nmax_master; // Max_Master of every node
+  unsigned Nmax_info_frames; // Max_Info_Frames of every node
+  unsigned data_len; // octets in each data frame
+  unsigned interval; // milliseconds between data frames queued at each
+                     // node, or zero for no data frames
+  unsigned reply_every; // every Nth data frame is a Test_Request that
+                        // expects a reply, or zero for none
+  unsigned warmup; // milliseconds before the measurement starts
+  unsigned duration; // milliseconds measured
+};
+
+struct MSTP_Sim_Stats
+{
+  unsigned long tokens; // Token frames
+  unsigned long polls; // Poll For Master frames
+  unsigned long poll_replies; // Reply To Poll For Master frames
+  unsigned long data_frames; // frames sent while holding the token
+  unsigned long replies; // frames sent in reply to a request
+  unsigned long collisions; // frames started while the bus was busy
+  unsigned long dropped; // data frames dropped as a queue was full
+  unsigned long rotations; // token rotation samples
+  uint64_t rotation_min; // nanoseconds between tokens to one node
+  uint64_t rotation_max;
+  uint64_t rotation_sum;
+  unsigned long latencies; // data frames sent
+  uint64_t latency_max; // nanoseconds from queued to sent
+  uint64_t latency_sum;
+  uint64_t busy; // nanoseconds that octets were on the bus
+  uint64_t polling; // nanoseconds from each Poll For Master to the
+                    // next frame that is not part of the poll
+  uint64_t elapsed; // nanoseconds measured
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// fills in the standard parameters for a bus of masters at 38400 baud
+void MSTP_Sim_Default(struct MSTP_Sim_Config *config);
+
+// runs a simulation.  returns false if the configuration is invalid,
+// such as a baud rate that MSTP_Timing_Find does not know, or the
+// memory for the nodes is not available.
+bool MSTP_Sim_Run(
+  const struct MSTP_Sim_Config *config,
+  struct MSTP_Sim_Stats *stats);
+
+// prints the column headings for MSTP_Sim_Report
+void MSTP_Sim_Report_Header(FILE *stream);
+
+// prints one line with the configuration and its results
+void MSTP_Sim_Report(
+  FILE *stream,
+  const struct MSTP_Sim_Config *config,
+  const struct MSTP_Sim_Stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,355 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// Counters and latency histograms of an MS/TP port
+//
+// The counters are written by the thread that runs the state machines
+// of the port, and read by anyone.  A writer that is the only writer
+// does not need an atomic read-modify-write: a relaxed load and store
+// of a whole word is enough for a reader never to see a torn value.
+// A copy is not one instant in time, but every counter in it is a
+// value that the counter really had.
+
+#include <stddef.h>
+#include "mstpstat.h" // check for valid prototypes
+
+// the bucket of a value
+unsigned MSTP_Histogram_Bucket(unsigned long value)
+{
+  unsigned shift = 0; // the power of two of the bucket width
+
+  if (value > MSTP_HISTOGRAM_MAX)
+    value = MSTP_HISTOGRAM_MAX;
+  if (value < (2 * MSTP_HISTOGRAM_SUB_BUCKETS))
+    return (unsigned)value;
+  while ((value >> shift) >= (2 * MSTP_HISTOGRAM_SUB_BUCKETS))
+    shift++;
+
+  return (2 * MSTP_HISTOGRAM_SUB_BUCKETS) +
+    ((shift - 1) * MSTP_HISTOGRAM_SUB_BUCKETS) +
+    (unsigned)((value >> shift) - MSTP_HISTOGRAM_SUB_BUCKETS);
+}
+
+// the largest value in a bucket
+unsigned long MSTP_Histogram_Bucket_Max(unsigned bucket)
+{
+  unsigned shift;
+  unsigned long mantissa;
+
+  if (bucket < (2 * MSTP_HISTOGRAM_SUB_BUCKETS))
+    return bucket;
+  bucket -= 2 * MSTP_HISTOGRAM_SUB_BUCKETS;
+  shift = (bucket / MSTP_HISTOGRAM_SUB_BUCKETS) + 1;
+  mantissa = (bucket % MSTP_HISTOGRAM_SUB_BUCKETS) + MSTP_HISTOGRAM_SUB_BUCKETS;
+
+  return ((mantissa + 1) << shift) - 1;
+}
+
+// adds a value - by the writing thread only
+void MSTP_Histogram_Record(
+  struct MSTP_Histogram *histogram,
+  unsigned long value)
+{
+  unsigned bucket;
+
+  if (value > MSTP_HISTOGRAM_MAX)
+    value = MSTP_HISTOGRAM_MAX;
+  bucket = MSTP_Histogram_Bucket(value);
+  MSTP_STAT_ADD(histogram->bucket[bucket], 1);
+  MSTP_STAT_ADD(histogram->sum, value);
+  if (value > histogram->max)
+    MSTP_STAT_SET(histogram->max, value);
+  // counted last, so a reader sees no more values than are in buckets
+  MSTP_STAT_ADD(histogram->count, 1);
+
+  return;
+}
+
+// returns the value that percent of the values are at or below,
+// to the resolution of the buckets
+unsigned long MSTP_Histogram_Percentile(
+  const struct MSTP_Histogram *histogram,
+  double percent)
+{
+  unsigned long count = 0; // values in the buckets so far
+  unsigned long target;
+  unsigned long value;
+  unsigned i;
+
+  if (histogram->count == 0)
+    return 0;
+  if (percent < 0.0)
+    percent = 0.0;
+  if (percent > 100.0)
+    percent = 100.0;
+  target = (unsigned long)((histogram->count * percent) / 100.0);
+  if (target == 0)
+    target = 1;
+  for (i = 0; i < MSTP_HISTOGRAM_BUCKETS; i++)
+  {
+    count += histogram->bucket[i];
+    if (count >= target)
+    {
+      value = MSTP_Histogram_Bucket_Max(i);
+      return (value < histogram->max) ? value : histogram->max;
+    }
+  }
+
+  return histogram->max;
+}
+
+// copies the counters, from any thread
+void MSTP_Stats_Read(
+  const struct MSTP_Stats *stats,
+  struct MSTP_Stats *copy)
+{
+  const unsigned long *from = (const unsigned long *)stats;
+  unsigned long *to = (unsigned long *)copy;
+  size_t i;
+
+  for (i = 0; i < (sizeof(struct MSTP_Stats) / sizeof(unsigned long)); i++)
+  {
+    to[i] = MSTP_STAT_LOAD(from[i]);
+  }
+
+  return;
+}
+
+static const char *stats_frame_name[MSTP_STATS_FRAME_TYPES] =
+{
+  "Token",
+  "Poll For Master",
+  "Reply To Poll For Master",
+  "Test_Request",
+  "Test_Response",
+  "BACnet Data Expecting Reply",
+  "BACnet Data Not Expecting Reply",
+  "Reply Postponed",
+  "other"
+};
+
+static void stats_histogram_report(
+  FILE *stream,
+  const char *name,
+  const struct MSTP_Histogram *histogram)
+{
+  fprintf(stream, "%s: %lu", name, histogram->count);
+  if (histogram->count)
+    fprintf(stream, ", mean %.1f ms, p50 %lu, p90 %lu, p99 %lu, max %lu ms",
+      (double)histogram->sum / histogram->count,
+      MSTP_Histogram_Percentile(histogram, 50.0),
+      MSTP_Histogram_Percentile(histogram, 90.0),
+      MSTP_Histogram_Percentile(histogram, 99.0),
+      histogram->max);
+  fprintf(stream, "\n");
+
+  return;
+}
+
+// prints the counters and the percentiles of the histograms
+void MSTP_Stats_Report(
+  FILE *stream,
+  const struct MSTP_Stats *stats)
+{
+  unsigned i;
+
+  fprintf(stream, "%-32s %10s %10s\n", "frames", "received", "sent");
+  for (i = 0; i < MSTP_STATS_FRAME_TYPES; i++)
+  {
+    if (stats->frames_received[i] || stats->frames_sent[i])
+      fprintf(stream, "%-32s %10lu %10lu\n", stats_frame_name[i],
+        stats->frames_received[i], stats->frames_sent[i]);
+  }
+  fprintf(stream, "octets: %lu received, %lu sent; "
+    "%lu frames for other stations\n",
+    stats->octets_received, stats->octets_sent, stats->frames_not_for_us);
+  fprintf(stream, "errors: %lu header CRC, %lu data CRC, %lu too long, "
+    "%lu Tframe_abort, %lu UART\n",
+    stats->header_crc_errors, stats->data_crc_errors,
+    stats->frames_too_long, stats->frame_aborts, stats->receive_errors);
+  fprintf(stream, "token: %lu received, %lu retries, %lu pass failures, "
+    "%lu lost\n",
+    stats->tokens_received, stats->token_retries,
+    stats->token_pass_failures, stats->lost_tokens);
+  fprintf(stream, "replies: %lu timeouts, %lu sent, %lu postponed sent, "
+    "%lu postponed received\n",
+    stats->reply_timeouts, stats->replies_sent, stats->replies_postponed_sent,
+    stats->replies_postponed_received);
+  stats_histogram_report(stream, "token rotation", &stats->token_rotation);
+  stats_histogram_report(stream, "reply latency", &stats->reply_latency);
+
+  return;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "ctest.h"
+
+void testHistogram(Test* pTest)
+{
+  static struct MSTP_Histogram histogram;
+  unsigned long value;
+  unsigned bucket;
+  unsigned last = 0;
+
+  // every value is in a bucket no wider than 1/16 of it, in order
+  for (value = 0; value <= MSTP_HISTOGRAM_MAX; value++)
+  {
+    bucket = MSTP_Histogram_Bucket(value);
+    ct_test(pTest, bucket < MSTP_HISTOGRAM_BUCKETS);
+    ct_test(pTest, (bucket == last) || (bucket == last + 1));
+    ct_test(pTest, value <= MSTP_Histogram_Bucket_Max(bucket));
+    if (bucket)
+    {
+      ct_test(pTest, value > MSTP_Histogram_Bucket_Max(bucket - 1));
+      ct_test(pTest, (MSTP_Histogram_Bucket_Max(bucket) -
+        MSTP_Histogram_Bucket_Max(bucket - 1)) <=
+        ((value / MSTP_HISTOGRAM_SUB_BUCKETS) + 1));
+    }
+    last = bucket;
+  }
+  ct_test(pTest, last == MSTP_HISTOGRAM_BUCKETS - 1);
+  ct_test(pTest, MSTP_Histogram_Bucket(1000000) == last);
+  ct_test(pTest, MSTP_Histogram_Bucket_Max(31) == 31);
+  ct_test(pTest, MSTP_Histogram_Bucket_Max(32) == 33);
+
+  memset(&histogram, 0, sizeof(histogram));
+  ct_test(pTest, MSTP_Histogram_Percentile(&histogram, 50.0) == 0);
+  for (value = 1; value <= 1000; value++)
+  {
+    MSTP_Histogram_Record(&histogram, value);
+  }
+  ct_test(pTest, histogram.count == 1000);
+  ct_test(pTest, histogram.sum == 500500);
+  ct_test(pTest, histogram.max == 1000);
+  value = MSTP_Histogram_Percentile(&histogram, 50.0);
+  ct_test(pTest, (value >= 500) && (value <= 500 + 500 / 16));
+  value = MSTP_Histogram_Percentile(&histogram, 99.0);
+  ct_test(pTest, (value >= 990) && (value <= 1000));
+  ct_test(pTest, MSTP_Histogram_Percentile(&histogram, 100.0) == 1000);
+  ct_test(pTest, MSTP_Histogram_Percentile(&histogram, 0.0) == 1);
+  // values beyond the timers are kept at the limit
+  MSTP_Histogram_Record(&histogram, 1000000);
+  ct_test(pTest, histogram.max == MSTP_HISTOGRAM_MAX);
+
+  return;
+}
+
+// a monitoring thread reads the counters while they are written
+#define STATS_TEST_COUNT 5000000
+struct stats_test
+{
+  struct MSTP_Stats stats;
+  volatile int done;
+  unsigned long reads;
+  unsigned long errors;
+};
+
+static void *stats_reader(void *arg)
+{
+  struct stats_test *test = arg;
+  struct MSTP_Stats copy;
+  unsigned long last = 0;
+
+  do
+  {
+    MSTP_Stats_Read(&test->stats, &copy);
+    // counters only go up, and the histogram counts last
+    if ((copy.octets_received < last) ||
+        (copy.token_rotation.count > copy.octets_received))
+      test->errors++;
+    last = copy.octets_received;
+    test->reads++;
+    sched_yield();
+  } while (!test->done);
+
+  return NULL;
+}
+
+void testStatsRead(Test* pTest)
+{
+  static struct stats_test test;
+  pthread_t thread;
+  unsigned long i;
+
+  memset(&test, 0, sizeof(test));
+  // the copy is made a word at a time
+  ct_test(pTest, (sizeof(struct MSTP_Stats) % sizeof(unsigned long)) == 0);
+  pthread_create(&thread, NULL, stats_reader, &test);
+  for (i = 0; i < STATS_TEST_COUNT; i++)
+  {
+    MSTP_STAT_ADD(test.stats.octets_received, 1);
+    if ((i % 64) == 0)
+      MSTP_Histogram_Record(&test.stats.token_rotation, i % 1000);
+  }
+  test.done = 1;
+  pthread_join(thread, NULL);
+  ct_test(pTest, test.errors == 0);
+  ct_test(pTest, test.reads > 0);
+  ct_test(pTest, test.stats.octets_received == STATS_TEST_COUNT);
+  ct_test(pTest, test.stats.token_rotation.count ==
+    (STATS_TEST_COUNT + 63) / 64);
+
+  return;
+}
+
+#ifdef TEST_MSTPSTAT
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("mstpstat", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testHistogram);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testStatsRead);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  return 0;
+}
+#endif /* TEST_MSTPSTAT */
+#endif /* TEST */
@@ -0,0 +1,140 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef MSTPSTAT_H
+#define MSTPSTAT_H
+
+#include <stdio.h>
+
+// Counters and latency histograms of one MS/TP port.
+// Only the thread that runs the state machines of a port writes its
+// counters, one aligned word at a time, so that a monitoring thread
+// can read them at any time, without a lock, with MSTP_Stats_Read.
+// Every member is an unsigned long so that they can be read as words.
+
+#if defined(__GNUC__)
+#define MSTP_STAT_ADD(counter,n) \
+  __atomic_store_n(&(counter), (counter) + (n), __ATOMIC_RELAXED)
+#define MSTP_STAT_SET(counter,value) \
+  __atomic_store_n(&(counter), (value), __ATOMIC_RELAXED)
+#define MSTP_STAT_LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+#else
+#define MSTP_STAT_ADD(counter,n) ((counter) += (n))
+#define MSTP_STAT_SET(counter,value) ((counter) = (value))
+#define MSTP_STAT_LOAD(counter) (*(volatile unsigned long *)&(counter))
+#endif
+
+// A histogram of milliseconds in the style of HdrHistogram: values
+// below 32 have a bucket each, and each power of two above that is
+// split into 16 buckets, so a bucket is never wider than 1/16 of its
+// values.  Values are limited to MSTP_HISTOGRAM_MAX, as the timers are.
+#define MSTP_HISTOGRAM_SUB_BUCKETS 16
+#define MSTP_HISTOGRAM_BUCKETS 208
+#define MSTP_HISTOGRAM_MAX 0xFFFF
+
+struct MSTP_Histogram
+{
+  unsigned long count; // values recorded
+  unsigned long sum; // of the values
+  unsigned long max; // largest value
+  unsigned long bucket[MSTP_HISTOGRAM_BUCKETS];
+};
+
+// frames of types 0 to 7 are counted by type, and all others together
+#define MSTP_STATS_FRAME_TYPES 9
+
+struct MSTP_Stats
+{
+  // valid frames for this station, or any station if Promiscuous
+  unsigned long frames_received[MSTP_STATS_FRAME_TYPES];
+  unsigned long frames_sent[MSTP_STATS_FRAME_TYPES];
+  unsigned long octets_received;
+  unsigned long octets_sent;
+  unsigned long frames_not_for_us; // valid headers for other stations
+  // invalid frames
+  unsigned long header_crc_errors;
+  unsigned long data_crc_errors;
+  unsigned long frames_too_long;
+  unsigned long frame_aborts; // no octet within Tframe_abort
+  unsigned long receive_errors; // ReceiveError from the UART
+  // token passing
+  unsigned long tokens_received;
+  unsigned long token_retries; // token passed again after Tusage_timeout
+  unsigned long token_pass_failures; // no successor after the retries
+  unsigned long lost_tokens; // no activity for Tno_token
+  // requests and replies
+  unsigned long reply_timeouts; // no reply within Treply_timeout
+  unsigned long replies_sent; // by Reply_Data within Treply_delay
+  unsigned long replies_postponed_sent;
+  unsigned long replies_postponed_received;
+  // milliseconds between receptions of the token
+  struct MSTP_Histogram token_rotation;
+  // milliseconds from sending a request to receiving its reply
+  struct MSTP_Histogram reply_latency;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// adds a value - by the writing thread only
+void MSTP_Histogram_Record(
+  struct MSTP_Histogram *histogram,
+  unsigned long value);
+
+// the bucket of a value, and the largest value in a bucket
+unsigned MSTP_Histogram_Bucket(unsigned long value);
+unsigned long MSTP_Histogram_Bucket_Max(unsigned bucket);
+
+// returns the value that percent of the values are at or below,
+// to the resolution of the buckets
+unsigned long MSTP_Histogram_Percentile(
+  const struct MSTP_Histogram *histogram,
+  double percent);
+
+// copies the counters, from any thread
+void MSTP_Stats_Read(
+  const struct MSTP_Stats *stats,
+  struct MSTP_Stats *copy);
+
+// prints the counters and the percentiles of the histograms
+void MSTP_Stats_Report(
+  FILE *stream,
+  const struct MSTP_Stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
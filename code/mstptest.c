@@ -0,0 +1,89 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#include <stddef.h>
+#include <string.h>
+#include "mstp.h"
+#include "mstptest.h" // check for valid prototypes
+
+UINT8 Test_Sent[MSTP_EXTENDED_FRAME_SIZE];
+unsigned Test_Sent_Length;
+
+unsigned Test_Stream(
+  UINT8 *buffer,
+  unsigned size,
+  const struct Test_Stream_Frame *frame,
+  unsigned count,
+  const UINT8 *data,
+  unsigned *offset)
+{
+  unsigned length = 0;
+  unsigned start;
+  unsigned i;
+
+  for (i = 0; i < count; i++)
+  {
+    memcpy(&buffer[length], frame[i].noise, frame[i].noise_length);
+    length += frame[i].noise_length;
+    start = length;
+    if (offset)
+      offset[i] = start;
+    length += MSTP_Create_Frame(&buffer[length], size - length,
+      frame[i].frame_type, frame[i].destination, frame[i].source,
+      frame[i].data_length ? data : NULL, frame[i].data_length);
+    buffer[start + frame[i].corrupt] ^= frame[i].mask;
+  }
+  if (offset)
+    offset[count] = length;
+
+  return length;
+}
+
+void Test_Send_Frame(
+  struct MSTP_Port *port,
+  const struct MSTP_Frame_Part *part,
+  unsigned count)
+{
+  unsigned i;
+
+  (void)port;
+  Test_Sent_Length = 0;
+  for (i = 0; i < count; i++)
+  {
+    memcpy(&Test_Sent[Test_Sent_Length], part[i].buffer, part[i].length);
+    Test_Sent_Length += part[i].length;
+  }
+
+  return;
+}
@@ -0,0 +1,84 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef MSTPTEST_H
+#define MSTPTEST_H
+
+// MS/TP helpers shared by the unit tests
+
+#include "mstp.h"
+
+// one frame of a test stream, and the noise before it
+struct Test_Stream_Frame
+{
+  UINT8 noise[4]; // octets sent before the frame
+  unsigned noise_length;
+  UINT8 frame_type;
+  UINT8 destination;
+  UINT8 source;
+  unsigned data_length; // octets from the start of the data
+  unsigned corrupt; // offset in the frame of an octet to damage
+  UINT8 mask; // the bits of that octet to flip, or 0 for none
+};
+
+// the octets of the last frame sent by Test_Send_Frame
+extern UINT8 Test_Sent[MSTP_EXTENDED_FRAME_SIZE];
+extern unsigned Test_Sent_Length;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// builds the frames back to back in buffer, each with its noise in
+// front of it.  if offset is not NULL it gets where each frame starts,
+// and offset[count] where the stream ends.  returns the length.
+unsigned Test_Stream(
+  UINT8 *buffer,
+  unsigned size,
+  const struct Test_Stream_Frame *frame,
+  unsigned count,
+  const UINT8 *data,
+  unsigned *offset);
+
+// a Send_Frame that gathers the parts of the frame into Test_Sent
+void Test_Send_Frame(
+  struct MSTP_Port *port,
+  const struct MSTP_Frame_Part *part,
+  unsigned count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1451 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// Capture Corpus Traffic Analysis
+//
+// Each record of a file is sorted by its link type.  MS/TP records
+// are received by a port in bus monitor mode, which passes on each
+// frame with its octets as they were on the wire, so that a frame
+// split over records, or several frames in one, are counted as the
+// frames that they are.  Ethernet, Linux cooked and ARCNET records
+// are taken apart down to BACnet/IP or the 802.2 LLC of BACnet.
+// Whatever the link, the NPDU is decoded the same way.
+//
+// The files are shared out to the workers through one index into the
+// list of files, sorted largest first.  A worker that is done takes
+// the next file, so the work balances itself without a queue for
+// each worker to steal from: there is nothing smaller than a file to
+// hand out, and each file is only taken once.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "bacenum.h"
+#include "cobs.h"
+#include "mstp.h"
+#include "npdu.h"
+#include "pcap.h"
+#include "mstptraf.h" // check for valid prototypes
+
+// link layer headers
+#define ETHERNET_HEADER_SIZE 14
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_VLAN 0x8100
+#define ETHERNET_LENGTH_MAX 1500 // larger is an Ethernet II type
+#define SLL_HEADER_SIZE 16
+#define IPV4_PROTOCOL_UDP 17
+#define UDP_HEADER_SIZE 8
+// the 802.2 LLC header of BACnet/Ethernet and BACnet/ARCNET
+#define LLC_BACNET_SAP 0x82
+#define LLC_UI 0x03
+#define LLC_HEADER_SIZE 3
+#define ARCNET_PROTOCOL_BACNET 0xCD
+
+// BACnet Virtual Link Control
+#define BVLC_TYPE_BACNET_IP 0x81
+#define BVLC_FORWARDED_NPDU 0x04
+#define BVLC_DISTRIBUTE_BROADCAST_TO_NETWORK 0x09
+#define BVLC_ORIGINAL_UNICAST_NPDU 0x0A
+#define BVLC_ORIGINAL_BROADCAST_NPDU 0x0B
+#define BVLC_HEADER_SIZE 4
+#define BVLC_FORWARDED_SIZE (BVLC_HEADER_SIZE + 6)
+
+// one file being analyzed
+struct traffic_file
+{
+  struct MSTP_Traffic *traffic;
+  uint64_t timestamp; // of the record being analyzed
+  uint64_t last[MSTP_TRAFFIC_LINKS]; // of the last frame on each link
+  bool seen[MSTP_TRAFFIC_LINKS];
+};
+
+static uint16_t traffic_get16(const uint8_t *octets)
+{
+  return (uint16_t)((octets[0] << 8) | octets[1]);
+}
+
+static uint32_t traffic_get32(const uint8_t *octets)
+{
+  return ((uint32_t)octets[0] << 24) | ((uint32_t)octets[1] << 16) |
+    ((uint32_t)octets[2] << 8) | (uint32_t)octets[3];
+}
+
+// a MAC address as a number
+static uint64_t traffic_mac(const uint8_t *octets)
+{
+  return ((uint64_t)traffic_get16(octets) << 32) | traffic_get32(&octets[2]);
+}
+
+static struct MSTP_Traffic_Flow *traffic_flow(
+  struct MSTP_Traffic *traffic,
+  unsigned link,
+  uint64_t source,
+  uint64_t destination)
+{
+  struct MSTP_Traffic_Flow *flow;
+  uint64_t hash;
+  unsigned i;
+
+  hash = (source * 0x9E3779B97F4A7C15ULL) ^
+    (destination * 0xC2B2AE3D27D4EB4FULL) ^ link;
+  i = (unsigned)(hash >> 40) & (MSTP_TRAFFIC_FLOWS - 1);
+  for (;;)
+  {
+    flow = &traffic->flow[i];
+    if (!flow->used)
+      break;
+    if ((flow->link == link) && (flow->source == source) &&
+        (flow->destination == destination))
+      return flow;
+    i = (i + 1) & (MSTP_TRAFFIC_FLOWS - 1);
+  }
+  // one flow is always left free, so that a search ends
+  if (traffic->flows >= (MSTP_TRAFFIC_FLOWS - 1))
+    return NULL;
+  traffic->flows++;
+  flow->used = true;
+  flow->link = link;
+  flow->source = source;
+  flow->destination = destination;
+
+  return flow;
+}
+
+// counts a frame on a link, in its flow, and the gap before it
+static void traffic_frame(
+  struct traffic_file *file,
+  unsigned link,
+  uint64_t source,
+  uint64_t destination,
+  unsigned long octets)
+{
+  struct MSTP_Traffic *traffic = file->traffic;
+  struct MSTP_Traffic_Flow *flow;
+  uint64_t gap = 0;
+
+  traffic->link[link].frames++;
+  traffic->link[link].octets += octets;
+  flow = traffic_flow(traffic, link, source, destination);
+  if (flow)
+  {
+    flow->frames++;
+    flow->octets += octets;
+  }
+  else
+    traffic->flows_lost++;
+  if (file->seen[link] && (file->timestamp >= file->last[link]))
+  {
+    gap = file->timestamp - file->last[link];
+    gap /= (link == MSTP_TRAFFIC_MSTP) ? 1000 : 1000000;
+    MSTP_Histogram_Record(&traffic->link[link].gap, (unsigned long)gap);
+  }
+  file->seen[link] = true;
+  file->last[link] = file->timestamp;
+
+  return;
+}
+
+// counts the network layer message or the APDU type and service
+static void traffic_npdu(
+  struct MSTP_Traffic *traffic,
+  const uint8_t *npdu,
+  unsigned length)
+{
+  struct NPDU_Header header;
+  const uint8_t *apdu;
+  unsigned remaining;
+  unsigned type;
+
+  traffic->npdus++;
+  if (!NPDU_Decode(npdu, length, &header))
+  {
+    traffic->npdus_invalid++;
+    return;
+  }
+  apdu = &npdu[header.offset];
+  remaining = length - header.offset;
+  if (header.control & NPDU_NETWORK_LAYER_MESSAGE)
+  {
+    traffic->network_message[apdu[0]]++;
+    return;
+  }
+  type = apdu[0] >> 4;
+  traffic->pdu_type[type]++;
+  // the service choice follows the invoke ID, and the sequence
+  // number and window size of a segment
+  if ((type == PDU_TYPE_CONFIRMED_SERVICE_REQUEST) && (remaining > 3))
+  {
+    if (!(apdu[0] & 0x08))
+      traffic->confirmed_service[apdu[3]]++;
+    else if (remaining > 5)
+      traffic->confirmed_service[apdu[5]]++;
+  }
+  else if ((type == PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST) && (remaining > 1))
+    traffic->unconfirmed_service[apdu[1]]++;
+
+  return;
+}
+
+// the Monitor_Frame of the port that receives the MS/TP records
+static void traffic_mstp_frame(
+  struct MSTP_Port *port,
+  const UINT8 *frame,
+  unsigned length,
+  BOOLEAN valid)
+{
+  struct traffic_file *file = port->Monitor_Context;
+  struct MSTP_Traffic *traffic = file->traffic;
+  UINT8 decoded[MSTP_EXTENDED_DATA_MAX];
+  unsigned data_len;
+
+  if (!valid)
+  {
+    traffic->frames_invalid++;
+    return;
+  }
+  traffic->frames_valid++;
+  traffic->frame_type[frame[2]]++;
+  traffic_frame(file, MSTP_TRAFFIC_MSTP, frame[4], frame[3], length);
+  if (length <= MSTP_HEADER_SIZE)
+    return;
+  switch (frame[2])
+  {
+    case FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY:
+    case FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY:
+      // less the data CRC
+      traffic_npdu(traffic, &frame[MSTP_HEADER_SIZE],
+        length - MSTP_HEADER_SIZE - 2);
+      break;
+    case FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY:
+    case FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY:
+      // a bus monitor leaves it encoded
+      data_len = (unsigned)COBS_Frame_Decode(decoded, sizeof(decoded),
+        &frame[MSTP_HEADER_SIZE], length - MSTP_HEADER_SIZE);
+      if (data_len)
+        traffic_npdu(traffic, decoded, data_len);
+      break;
+    default:
+      break;
+  }
+
+  return;
+}
+
+// a UDP datagram, counted if it is BACnet/IP
+static bool traffic_udp(
+  struct traffic_file *file,
+  const uint8_t *ip,
+  unsigned length,
+  unsigned long octets)
+{
+  struct MSTP_Traffic *traffic = file->traffic;
+  const uint8_t *udp;
+  const uint8_t *bvlc;
+  unsigned header;
+  unsigned remaining;
+  uint64_t source, destination;
+
+  if ((length < 20) || ((ip[0] >> 4) != 4))
+    return false;
+  header = (ip[0] & 0x0F) * 4;
+  // only the first fragment has the UDP header
+  if ((ip[9] != IPV4_PROTOCOL_UDP) || (traffic_get16(&ip[6]) & 0x1FFF) ||
+      (length < (header + UDP_HEADER_SIZE + BVLC_HEADER_SIZE)))
+    return false;
+  udp = &ip[header];
+  bvlc = &udp[UDP_HEADER_SIZE];
+  remaining = length - header - UDP_HEADER_SIZE;
+  if (bvlc[0] != BVLC_TYPE_BACNET_IP)
+    return false;
+  source = ((uint64_t)traffic_get32(&ip[12]) << 16) | traffic_get16(udp);
+  destination = ((uint64_t)traffic_get32(&ip[16]) << 16) |
+    traffic_get16(&udp[2]);
+  traffic->bvlc_function[bvlc[1]]++;
+  traffic_frame(file, MSTP_TRAFFIC_BIP, source, destination, octets);
+  switch (bvlc[1])
+  {
+    case BVLC_ORIGINAL_UNICAST_NPDU:
+    case BVLC_ORIGINAL_BROADCAST_NPDU:
+    case BVLC_DISTRIBUTE_BROADCAST_TO_NETWORK:
+      traffic_npdu(traffic, &bvlc[BVLC_HEADER_SIZE],
+        remaining - BVLC_HEADER_SIZE);
+      break;
+    case BVLC_FORWARDED_NPDU:
+      if (remaining > BVLC_FORWARDED_SIZE)
+        traffic_npdu(traffic, &bvlc[BVLC_FORWARDED_SIZE],
+          remaining - BVLC_FORWARDED_SIZE);
+      break;
+    default:
+      break;
+  }
+
+  return true;
+}
+
+// an 802.2 LLC frame, counted if it is BACnet
+static bool traffic_llc(
+  struct traffic_file *file,
+  unsigned link,
+  uint64_t source,
+  uint64_t destination,
+  const uint8_t *llc,
+  unsigned length,
+  unsigned long octets)
+{
+  if ((length <= LLC_HEADER_SIZE) || (llc[0] != LLC_BACNET_SAP) ||
+      (llc[1] != LLC_BACNET_SAP) || (llc[2] != LLC_UI))
+    return false;
+  traffic_frame(file, link, source, destination, octets);
+  traffic_npdu(file->traffic, &llc[LLC_HEADER_SIZE],
+    length - LLC_HEADER_SIZE);
+
+  return true;
+}
+
+static bool traffic_ethernet(
+  struct traffic_file *file,
+  const struct Pcap_Record *record)
+{
+  const uint8_t *data = record->data;
+  unsigned offset = 12;
+  uint16_t type;
+
+  if (record->length < ETHERNET_HEADER_SIZE)
+    return false;
+  type = traffic_get16(&data[offset]);
+  if ((type == ETHERTYPE_VLAN) && (record->length >= offset + 6))
+  {
+    offset += 4;
+    type = traffic_get16(&data[offset]);
+  }
+  offset += 2;
+  if (type == ETHERTYPE_IPV4)
+    return traffic_udp(file, &data[offset], record->length - offset,
+      record->original_length);
+  // 802.3, whose type is the length of the LLC frame
+  if (type <= ETHERNET_LENGTH_MAX)
+    return traffic_llc(file, MSTP_TRAFFIC_ETHERNET, traffic_mac(&data[6]),
+      traffic_mac(data), &data[offset], record->length - offset,
+      record->original_length);
+
+  return false;
+}
+
+// Linux cooked capture: only the source is known, so IPv4 it must be
+static bool traffic_sll(
+  struct traffic_file *file,
+  const struct Pcap_Record *record)
+{
+  if ((record->length < SLL_HEADER_SIZE) ||
+      (traffic_get16(&record->data[14]) != ETHERTYPE_IPV4))
+    return false;
+
+  return traffic_udp(file, &record->data[SLL_HEADER_SIZE],
+    record->length - SLL_HEADER_SIZE, record->original_length);
+}
+
+// ARCNET: the source and destination stations, then the protocol ID
+// either at once or after two octets of split flag and sequence
+static bool traffic_arcnet(
+  struct traffic_file *file,
+  const struct Pcap_Record *record)
+{
+  const uint8_t *data = record->data;
+  unsigned offset;
+
+  if (record->length < 6)
+    return false;
+  if (data[2] == ARCNET_PROTOCOL_BACNET)
+    offset = 3;
+  else if (data[4] == ARCNET_PROTOCOL_BACNET)
+    offset = 5;
+  else
+    return false;
+
+  return traffic_llc(file, MSTP_TRAFFIC_ARCNET, data[0], data[1],
+    &data[offset], record->length - offset, record->original_length);
+}
+
+bool MSTP_Traffic_File(
+  struct MSTP_Traffic *traffic,
+  const char *filename)
+{
+  struct Pcap_File capture;
+  struct Pcap_Record record;
+  struct traffic_file file;
+  struct MSTP_Port *port;
+  uint64_t last = 0;
+  uint64_t gap;
+  bool counted;
+
+  if (!Pcap_Open(&capture, filename))
+  {
+    traffic->unreadable++;
+    return false;
+  }
+  // aligned to a cache line
+  if (posix_memalign((void **)&port, MSTP_CACHE_LINE,
+      sizeof(struct MSTP_Port)))
+  {
+    Pcap_Close(&capture);
+    return false;
+  }
+  traffic->files++;
+  memset(&file, 0, sizeof(file));
+  file.traffic = traffic;
+  MSTP_Init(port, 0);
+  port->Promiscuous = TRUE;
+  port->Monitor_Frame = traffic_mstp_frame;
+  port->Monitor_Context = &file;
+  while (Pcap_Next(&capture, &record))
+  {
+    traffic->records++;
+    file.timestamp = record.timestamp;
+    switch (record.linktype)
+    {
+      case PCAP_LINKTYPE_BACNET_MS_TP:
+        // the gap before this record is silence, as on the wire
+        gap = 255;
+        if (last && (record.timestamp >= last))
+          gap = (record.timestamp - last) / 1000000;
+        last = record.timestamp;
+        port->SilenceTimer = (gap > 255) ? 255 : (unsigned)gap;
+        (void)MSTP_Monitor_Octets(port, record.data, record.length);
+        // a frame that ends the record is checked now
+        (void)MSTP_Monitor_Octets(port, record.data, 0);
+        counted = true;
+        break;
+      case PCAP_LINKTYPE_ETHERNET:
+        counted = traffic_ethernet(&file, &record);
+        break;
+      case PCAP_LINKTYPE_LINUX_SLL:
+        counted = traffic_sll(&file, &record);
+        break;
+      case PCAP_LINKTYPE_ARCNET:
+        counted = traffic_arcnet(&file, &record);
+        break;
+      default:
+        counted = false;
+        break;
+    }
+    if (!counted)
+      traffic->other++;
+  }
+  free(port);
+  Pcap_Close(&capture);
+
+  return true;
+}
+
+void MSTP_Traffic_Init(struct MSTP_Traffic *traffic)
+{
+  memset(traffic, 0, sizeof(struct MSTP_Traffic));
+
+  return;
+}
+
+static void traffic_add(
+  unsigned long *counts,
+  const unsigned long *from,
+  unsigned count)
+{
+  unsigned i;
+
+  for (i = 0; i < count; i++)
+    counts[i] += from[i];
+
+  return;
+}
+
+void MSTP_Traffic_Merge(
+  struct MSTP_Traffic *traffic,
+  const struct MSTP_Traffic *from)
+{
+  const struct MSTP_Traffic_Flow *source;
+  struct MSTP_Traffic_Flow *flow;
+  struct MSTP_Histogram *gap;
+  unsigned i;
+
+  traffic->files += from->files;
+  traffic->unreadable += from->unreadable;
+  traffic->records += from->records;
+  traffic->other += from->other;
+  for (i = 0; i < MSTP_TRAFFIC_LINKS; i++)
+  {
+    traffic->link[i].frames += from->link[i].frames;
+    traffic->link[i].octets += from->link[i].octets;
+    gap = &traffic->link[i].gap;
+    gap->count += from->link[i].gap.count;
+    gap->sum += from->link[i].gap.sum;
+    if (from->link[i].gap.max > gap->max)
+      gap->max = from->link[i].gap.max;
+    traffic_add(gap->bucket, from->link[i].gap.bucket,
+      MSTP_HISTOGRAM_BUCKETS);
+  }
+  traffic->frames_valid += from->frames_valid;
+  traffic->frames_invalid += from->frames_invalid;
+  traffic_add(traffic->frame_type, from->frame_type, 256);
+  traffic_add(traffic->bvlc_function, from->bvlc_function, 256);
+  traffic->npdus += from->npdus;
+  traffic->npdus_invalid += from->npdus_invalid;
+  traffic_add(traffic->network_message, from->network_message, 256);
+  traffic_add(traffic->pdu_type, from->pdu_type, 16);
+  traffic_add(traffic->confirmed_service, from->confirmed_service, 256);
+  traffic_add(traffic->unconfirmed_service, from->unconfirmed_service, 256);
+  traffic->flows_lost += from->flows_lost;
+  for (i = 0; i < MSTP_TRAFFIC_FLOWS; i++)
+  {
+    source = &from->flow[i];
+    if (!source->used)
+      continue;
+    flow = traffic_flow(traffic, source->link, source->source,
+      source->destination);
+    if (flow)
+    {
+      flow->frames += source->frames;
+      flow->octets += source->octets;
+    }
+    else
+      traffic->flows_lost += source->frames;
+  }
+
+  return;
+}
+
+bool MSTP_Traffic_Capture_Name(const char *filename)
+{
+  const char *dot = strrchr(filename, '.');
+
+  return dot && ((strcasecmp(dot, ".cap") == 0) ||
+    (strcasecmp(dot, ".pcap") == 0) || (strcasecmp(dot, ".pcapng") == 0));
+}
+
+// the files shared by the workers
+struct traffic_work
+{
+  const char *const *filenames;
+  unsigned *order; // largest first
+  unsigned count;
+  unsigned next; // the next file to be taken
+};
+
+struct traffic_worker
+{
+  pthread_t thread;
+  struct traffic_work *work;
+  struct MSTP_Traffic traffic;
+};
+
+static void *traffic_worker_thread(void *arg)
+{
+  struct traffic_worker *worker = arg;
+  struct traffic_work *work = worker->work;
+  unsigned i;
+
+  for (;;)
+  {
+    i = __atomic_fetch_add(&work->next, 1, __ATOMIC_RELAXED);
+    if (i >= work->count)
+      break;
+    (void)MSTP_Traffic_File(&worker->traffic,
+      work->filenames[work->order[i]]);
+  }
+
+  return NULL;
+}
+
+// the sizes of the files, for sorting them largest first
+static const off_t *Traffic_Sizes;
+
+static int traffic_larger(const void *a, const void *b)
+{
+  off_t size_a = Traffic_Sizes[*(const unsigned *)a];
+  off_t size_b = Traffic_Sizes[*(const unsigned *)b];
+
+  return (size_a < size_b) - (size_a > size_b);
+}
+
+bool MSTP_Traffic_Files(
+  struct MSTP_Traffic *traffic,
+  const char *const *filenames,
+  unsigned count,
+  unsigned workers)
+{
+  static pthread_mutex_t sort_lock = PTHREAD_MUTEX_INITIALIZER;
+  struct traffic_work work;
+  struct traffic_worker *worker;
+  off_t *sizes;
+  struct stat status;
+  unsigned started = 0;
+  unsigned i;
+
+  if (workers == 0)
+    workers = 1;
+  if (workers > count)
+    workers = count;
+  if (workers == 0)
+    return true;
+  worker = calloc(workers, sizeof(struct traffic_worker));
+  work.order = calloc(count, sizeof(unsigned));
+  sizes = calloc(count, sizeof(off_t));
+  if (!worker || !work.order || !sizes)
+  {
+    free(worker);
+    free(work.order);
+    free(sizes);
+    return false;
+  }
+  for (i = 0; i < count; i++)
+  {
+    work.order[i] = i;
+    sizes[i] = (stat(filenames[i], &status) == 0) ? status.st_size : 0;
+  }
+  // so that the largest file is not left until last
+  pthread_mutex_lock(&sort_lock);
+  Traffic_Sizes = sizes;
+  qsort(work.order, count, sizeof(unsigned), traffic_larger);
+  pthread_mutex_unlock(&sort_lock);
+  work.filenames = filenames;
+  work.count = count;
+  work.next = 0;
+  for (i = 0; i < workers; i++)
+  {
+    worker[i].work = &work;
+    if (pthread_create(&worker[i].thread, NULL, traffic_worker_thread,
+        &worker[i]) != 0)
+      break;
+    started++;
+  }
+  // a worker that did not start leaves its files to the others,
+  // or to this thread if none started
+  if (started == 0)
+    (void)traffic_worker_thread(&worker[0]);
+  for (i = 0; i < started; i++)
+    pthread_join(worker[i].thread, NULL);
+  for (i = 0; i < workers; i++)
+    MSTP_Traffic_Merge(traffic, &worker[i].traffic);
+  free(worker);
+  free(work.order);
+  free(sizes);
+
+  return true;
+}
+
+static const char *Traffic_Link_Name[MSTP_TRAFFIC_LINKS] =
+{
+  "MS/TP",
+  "BACnet/IP",
+  "Ethernet",
+  "ARCNET"
+};
+
+static const char *traffic_frame_name(unsigned frame_type)
+{
+  switch (frame_type)
+  {
+    case FRAME_TYPE_TOKEN:
+      return "Token";
+    case FRAME_TYPE_POLL_FOR_MASTER:
+      return "Poll For Master";
+    case FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER:
+      return "Reply To Poll For Master";
+    case FRAME_TYPE_TEST_REQUEST:
+      return "Test Request";
+    case FRAME_TYPE_TEST_RESPONSE:
+      return "Test Response";
+    case FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY:
+      return "BACnet Data Expecting Reply";
+    case FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY:
+      return "BACnet Data Not Expecting Reply";
+    case FRAME_TYPE_REPLY_POSTPONED:
+      return "Reply Postponed";
+    case FRAME_TYPE_BACNET_EXTENDED_DATA_EXPECTING_REPLY:
+      return "BACnet Extended Data Expecting Reply";
+    case FRAME_TYPE_BACNET_EXTENDED_DATA_NOT_EXPECTING_REPLY:
+      return "BACnet Extended Data Not Expecting Reply";
+    default:
+      break;
+  }
+  if (frame_type >= FRAME_TYPE_PROPRIETARY_MIN)
+    return "Proprietary";
+
+  return "Reserved";
+}
+
+static const char *traffic_bvlc_name(unsigned function)
+{
+  static const char *name[] =
+  {
+    "BVLC-Result",
+    "Write-Broadcast-Distribution-Table",
+    "Read-Broadcast-Distribution-Table",
+    "Read-Broadcast-Distribution-Table-Ack",
+    "Forwarded-NPDU",
+    "Register-Foreign-Device",
+    "Read-Foreign-Device-Table",
+    "Read-Foreign-Device-Table-Ack",
+    "Delete-Foreign-Device-Table-Entry",
+    "Distribute-Broadcast-To-Network",
+    "Original-Unicast-NPDU",
+    "Original-Broadcast-NPDU"
+  };
+
+  if (function < (sizeof(name) / sizeof(name[0])))
+    return name[function];
+
+  return "Unknown";
+}
+
+static const char *Traffic_PDU_Name[8] =
+{
+  "Confirmed-Request",
+  "Unconfirmed-Request",
+  "SimpleACK",
+  "ComplexACK",
+  "SegmentACK",
+  "Error",
+  "Reject",
+  "Abort"
+};
+
+static const char *traffic_confirmed_name(unsigned service)
+{
+  static const char *name[] =
+  {
+    "AcknowledgeAlarm",
+    "ConfirmedCOVNotification",
+    "ConfirmedEventNotification",
+    "GetAlarmSummary",
+    "GetEnrollmentSummary",
+    "SubscribeCOV",
+    "AtomicReadFile",
+    "AtomicWriteFile",
+    "AddListElement",
+    "RemoveListElement",
+    "CreateObject",
+    "DeleteObject",
+    "ReadProperty",
+    "ReadPropertyConditional",
+    "ReadPropertyMultiple",
+    "WriteProperty",
+    "WritePropertyMultiple",
+    "DeviceCommunicationControl",
+    "ConfirmedPrivateTransfer",
+    "ConfirmedTextMessage",
+    "ReinitializeDevice",
+    "VT-Open",
+    "VT-Close",
+    "VT-Data",
+    "Authenticate",
+    "RequestKey",
+    "ReadRange",
+    "LifeSafetyOperation",
+    "SubscribeCOVProperty",
+    "GetEventInformation"
+  };
+
+  if (service < (sizeof(name) / sizeof(name[0])))
+    return name[service];
+
+  return "Unknown";
+}
+
+static const char *traffic_unconfirmed_name(unsigned service)
+{
+  static const char *name[] =
+  {
+    "I-Am",
+    "I-Have",
+    "UnconfirmedCOVNotification",
+    "UnconfirmedEventNotification",
+    "UnconfirmedPrivateTransfer",
+    "UnconfirmedTextMessage",
+    "TimeSynchronization",
+    "Who-Has",
+    "Who-Is",
+    "UTCTimeSynchronization"
+  };
+
+  if (service < (sizeof(name) / sizeof(name[0])))
+    return name[service];
+
+  return "Unknown";
+}
+
+// prints an address of a link into text
+static void traffic_address(
+  char *text,
+  size_t size,
+  unsigned link,
+  uint64_t address)
+{
+  switch (link)
+  {
+    case MSTP_TRAFFIC_BIP:
+      snprintf(text, size, "%u.%u.%u.%u:%u",
+        (unsigned)(address >> 40) & 0xFF, (unsigned)(address >> 32) & 0xFF,
+        (unsigned)(address >> 24) & 0xFF, (unsigned)(address >> 16) & 0xFF,
+        (unsigned)address & 0xFFFF);
+      break;
+    case MSTP_TRAFFIC_ETHERNET:
+      snprintf(text, size, "%02x:%02x:%02x:%02x:%02x:%02x",
+        (unsigned)(address >> 40) & 0xFF, (unsigned)(address >> 32) & 0xFF,
+        (unsigned)(address >> 24) & 0xFF, (unsigned)(address >> 16) & 0xFF,
+        (unsigned)(address >> 8) & 0xFF, (unsigned)address & 0xFF);
+      break;
+    default:
+      snprintf(text, size, "%u", (unsigned)address);
+      break;
+  }
+
+  return;
+}
+
+static int traffic_more_frames(const void *a, const void *b)
+{
+  const struct MSTP_Traffic_Flow *flow_a = a;
+  const struct MSTP_Traffic_Flow *flow_b = b;
+
+  if (flow_a->frames != flow_b->frames)
+    return (flow_a->frames < flow_b->frames) ? 1 : -1;
+  if (flow_a->link != flow_b->link)
+    return (flow_a->link < flow_b->link) ? -1 : 1;
+  if (flow_a->source != flow_b->source)
+    return (flow_a->source < flow_b->source) ? -1 : 1;
+  if (flow_a->destination != flow_b->destination)
+    return (flow_a->destination < flow_b->destination) ? -1 : 1;
+
+  return 0;
+}
+
+static int traffic_same_source(const void *a, const void *b)
+{
+  const struct MSTP_Traffic_Flow *flow_a = a;
+  const struct MSTP_Traffic_Flow *flow_b = b;
+
+  if (flow_a->link != flow_b->link)
+    return (flow_a->link < flow_b->link) ? -1 : 1;
+  if (flow_a->source != flow_b->source)
+    return (flow_a->source < flow_b->source) ? -1 : 1;
+
+  return 0;
+}
+
+static void traffic_counts(
+  FILE *stream,
+  const char *title,
+  const unsigned long *counts,
+  unsigned count,
+  const char *(*name)(unsigned))
+{
+  unsigned i;
+
+  fprintf(stream, "%s:\n", title);
+  for (i = 0; i < count; i++)
+  {
+    if (counts[i])
+      fprintf(stream, "  %3u %-40s %10lu\n", i, name ? name(i) : "",
+        counts[i]);
+  }
+
+  return;
+}
+
+static const char *traffic_pdu_name(unsigned type)
+{
+  return (type < 8) ? Traffic_PDU_Name[type] : "Reserved";
+}
+
+void MSTP_Traffic_Report(
+  FILE *stream,
+  const struct MSTP_Traffic *traffic,
+  unsigned top)
+{
+  const struct MSTP_Histogram *gap;
+  struct MSTP_Traffic_Flow *flow;
+  unsigned flows = 0;
+  unsigned sources = 0;
+  char source[32], destination[32];
+  unsigned i;
+
+  fprintf(stream, "traffic: %lu files, %lu unreadable, %lu records, "
+    "%lu not BACnet\n",
+    traffic->files, traffic->unreadable, traffic->records, traffic->other);
+  fprintf(stream, "%-10s %10s %12s %10s %8s %8s %8s %8s\n", "link",
+    "frames", "octets", "gaps", "p50", "p90", "p99", "max");
+  for (i = 0; i < MSTP_TRAFFIC_LINKS; i++)
+  {
+    gap = &traffic->link[i].gap;
+    if (traffic->link[i].frames == 0)
+      continue;
+    fprintf(stream, "%-10s %10lu %12llu %10lu %8lu %8lu %8lu %8lu %s\n",
+      Traffic_Link_Name[i], traffic->link[i].frames,
+      traffic->link[i].octets, gap->count,
+      MSTP_Histogram_Percentile(gap, 50.0),
+      MSTP_Histogram_Percentile(gap, 90.0),
+      MSTP_Histogram_Percentile(gap, 99.0), gap->max,
+      (i == MSTP_TRAFFIC_MSTP) ? "us" : "ms");
+  }
+  fprintf(stream, "MS/TP frames: %lu valid, %lu invalid\n",
+    traffic->frames_valid, traffic->frames_invalid);
+  traffic_counts(stream, "MS/TP frame types", traffic->frame_type, 256,
+    traffic_frame_name);
+  traffic_counts(stream, "BVLC functions", traffic->bvlc_function, 256,
+    traffic_bvlc_name);
+  fprintf(stream, "NPDUs: %lu, %lu invalid\n",
+    traffic->npdus, traffic->npdus_invalid);
+  traffic_counts(stream, "network layer messages",
+    traffic->network_message, 256, NULL);
+  traffic_counts(stream, "APDU types", traffic->pdu_type, 16,
+    traffic_pdu_name);
+  traffic_counts(stream, "confirmed services", traffic->confirmed_service,
+    256, traffic_confirmed_name);
+  traffic_counts(stream, "unconfirmed services",
+    traffic->unconfirmed_service, 256, traffic_unconfirmed_name);
+
+  flow = malloc(MSTP_TRAFFIC_FLOWS * sizeof(struct MSTP_Traffic_Flow));
+  if (!flow)
+    return;
+  for (i = 0; i < MSTP_TRAFFIC_FLOWS; i++)
+  {
+    if (traffic->flow[i].used)
+      flow[flows++] = traffic->flow[i];
+  }
+  fprintf(stream, "flows: %u, %lu frames in flows that did not fit\n",
+    flows, traffic->flows_lost);
+  qsort(flow, flows, sizeof(struct MSTP_Traffic_Flow), traffic_more_frames);
+  fprintf(stream, "top flows by frames:\n");
+  for (i = 0; (i < flows) && (i < top); i++)
+  {
+    traffic_address(source, sizeof(source), flow[i].link, flow[i].source);
+    traffic_address(destination, sizeof(destination), flow[i].link,
+      flow[i].destination);
+    fprintf(stream, "  %-10s %21s -> %-21s %10lu %12llu\n",
+      Traffic_Link_Name[flow[i].link], source, destination,
+      flow[i].frames, flow[i].octets);
+  }
+  // the flows of each source added together, in place
+  qsort(flow, flows, sizeof(struct MSTP_Traffic_Flow), traffic_same_source);
+  for (i = 0; i < flows; i++)
+  {
+    if (sources && (traffic_same_source(&flow[sources - 1], &flow[i]) == 0))
+    {
+      flow[sources - 1].frames += flow[i].frames;
+      flow[sources - 1].octets += flow[i].octets;
+      flow[sources - 1].destination++; // destinations
+    }
+    else
+    {
+      flow[sources] = flow[i];
+      flow[sources].destination = 1;
+      sources++;
+    }
+  }
+  qsort(flow, sources, sizeof(struct MSTP_Traffic_Flow), traffic_more_frames);
+  fprintf(stream, "top sources by frames:\n");
+  for (i = 0; (i < sources) && (i < top); i++)
+  {
+    traffic_address(source, sizeof(source), flow[i].link, flow[i].source);
+    fprintf(stream, "  %-10s %21s %6llu destinations %10lu %12llu\n",
+      Traffic_Link_Name[flow[i].link], source,
+      (unsigned long long)flow[i].destination, flow[i].frames,
+      flow[i].octets);
+  }
+  free(flow);
+
+  return;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "monotime.h"
+#include "ctest.h"
+
+#ifndef MSTP_TRAFFIC_CAPTURES_DIR
+#define MSTP_TRAFFIC_CAPTURES_DIR "../captures"
+#endif
+
+// a Who-Is, and a ReadProperty request, as NPDUs
+static const uint8_t Test_Who_Is[] = {0x01, 0x20, 0xFF, 0xFF, 0x00, 0xFF,
+  0x10, 0x08};
+static const uint8_t Test_Read_Property[] = {0x01, 0x04, 0x00, 0x05, 0x01,
+  0x0C, 0x0C, 0x00, 0x00, 0x00, 0x01, 0x19, 0x55};
+static const uint8_t Test_I_Am[] = {0x01, 0x00, 0x10, 0x00, 0xC4, 0x02,
+  0x00, 0x00, 0x01, 0x22, 0x01, 0xE0, 0x91, 0x00, 0x21, 0x0F};
+
+static void test_mstp_capture(const char *filename)
+{
+  struct Pcap_Writer writer;
+  uint8_t frame[64];
+  uint64_t timestamp = 1000000000ULL;
+  unsigned length;
+  bool status;
+
+  status = Pcap_Writer_Open(&writer, filename, PCAP_LINKTYPE_BACNET_MS_TP,
+    65535);
+  assert(status);
+  length = MSTP_Create_Frame(frame, sizeof(frame), FRAME_TYPE_TOKEN, 16, 5,
+    NULL, 0);
+  (void)Pcap_Writer_Write(&writer, timestamp, frame, length);
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 255, 16,
+    (UINT8 *)Test_Who_Is, sizeof(Test_Who_Is));
+  (void)Pcap_Writer_Write(&writer, timestamp += 10000000, frame, length);
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY, 16, 5,
+    (UINT8 *)Test_Read_Property, sizeof(Test_Read_Property));
+  (void)Pcap_Writer_Write(&writer, timestamp += 10000000, frame, length);
+  // data CRC error
+  frame[length - 1] ^= 0x80;
+  (void)Pcap_Writer_Write(&writer, timestamp += 10000000, frame, length);
+  status = Pcap_Writer_Close(&writer);
+  assert(status);
+
+  return;
+}
+
+// an Ethernet frame from 00:00:00:00:00:0a to 00:00:00:00:00:14 of
+// type or length, followed by the payload
+static unsigned test_ethernet(
+  uint8_t *frame,
+  uint16_t type,
+  const uint8_t *payload,
+  unsigned length)
+{
+  memset(frame, 0, ETHERNET_HEADER_SIZE);
+  frame[5] = 20;
+  frame[11] = 10;
+  frame[12] = (uint8_t)(type >> 8);
+  frame[13] = (uint8_t)type;
+  memcpy(&frame[ETHERNET_HEADER_SIZE], payload, length);
+
+  return ETHERNET_HEADER_SIZE + length;
+}
+
+// a BVLC message in UDP from 192.168.1.10:47808 to host on port 47808
+static unsigned test_bvlc(
+  uint8_t *frame,
+  uint8_t host,
+  uint8_t function,
+  const uint8_t *npdu,
+  unsigned length)
+{
+  uint8_t ip[128];
+  unsigned total = 20 + UDP_HEADER_SIZE + BVLC_HEADER_SIZE + length;
+
+  memset(ip, 0, 20 + UDP_HEADER_SIZE);
+  ip[0] = 0x45;
+  ip[2] = (uint8_t)(total >> 8);
+  ip[3] = (uint8_t)total;
+  ip[8] = 64;
+  ip[9] = IPV4_PROTOCOL_UDP;
+  ip[12] = 192;
+  ip[13] = 168;
+  ip[14] = 1;
+  ip[15] = 10;
+  ip[16] = 192;
+  ip[17] = 168;
+  ip[18] = 1;
+  ip[19] = host;
+  ip[20] = 0xBA;
+  ip[21] = 0xC0;
+  ip[22] = 0xBA;
+  ip[23] = 0xC0;
+  ip[25] = (uint8_t)(total - 20);
+  ip[28] = BVLC_TYPE_BACNET_IP;
+  ip[29] = function;
+  ip[31] = (uint8_t)(total - 20 - UDP_HEADER_SIZE);
+  memcpy(&ip[32], npdu, length);
+
+  return test_ethernet(frame, ETHERTYPE_IPV4, ip, total);
+}
+
+static void test_ethernet_capture(const char *filename)
+{
+  struct Pcap_Writer writer;
+  uint8_t llc[64] = {LLC_BACNET_SAP, LLC_BACNET_SAP, LLC_UI};
+  uint8_t arp[28] = {0x00, 0x01, 0x08, 0x00, 6, 4, 0x00, 0x01};
+  uint8_t frame[128];
+  uint64_t timestamp = 1000000000ULL;
+  unsigned length;
+  bool status;
+
+  status = Pcap_Writer_Open(&writer, filename, PCAP_LINKTYPE_ETHERNET,
+    65535);
+  assert(status);
+  length = test_bvlc(frame, 255, BVLC_ORIGINAL_BROADCAST_NPDU,
+    Test_Who_Is, sizeof(Test_Who_Is));
+  (void)Pcap_Writer_Write(&writer, timestamp, frame, length);
+  length = test_bvlc(frame, 20, BVLC_ORIGINAL_UNICAST_NPDU,
+    Test_Read_Property, sizeof(Test_Read_Property));
+  (void)Pcap_Writer_Write(&writer, timestamp += 1000000000, frame, length);
+  memcpy(&llc[LLC_HEADER_SIZE], Test_I_Am, sizeof(Test_I_Am));
+  length = test_ethernet(frame, LLC_HEADER_SIZE + sizeof(Test_I_Am), llc,
+    LLC_HEADER_SIZE + sizeof(Test_I_Am));
+  (void)Pcap_Writer_Write(&writer, timestamp += 1000000000, frame, length);
+  length = test_ethernet(frame, 0x0806, arp, sizeof(arp));
+  (void)Pcap_Writer_Write(&writer, timestamp += 1000000000, frame, length);
+  status = Pcap_Writer_Close(&writer);
+  assert(status);
+
+  return;
+}
+
+static const struct MSTP_Traffic_Flow *test_find_flow(
+  const struct MSTP_Traffic *traffic,
+  unsigned link,
+  uint64_t source,
+  uint64_t destination)
+{
+  unsigned i;
+
+  for (i = 0; i < MSTP_TRAFFIC_FLOWS; i++)
+  {
+    if (traffic->flow[i].used && (traffic->flow[i].link == link) &&
+        (traffic->flow[i].source == source) &&
+        (traffic->flow[i].destination == destination))
+      return &traffic->flow[i];
+  }
+
+  return NULL;
+}
+
+// the counts of two analyses of the same files are the same
+static void test_same(
+  Test *pTest,
+  const struct MSTP_Traffic *a,
+  const struct MSTP_Traffic *b)
+{
+  const struct MSTP_Traffic_Flow *flow;
+  unsigned i;
+
+  ct_test(pTest, a->files == b->files);
+  ct_test(pTest, a->unreadable == b->unreadable);
+  ct_test(pTest, a->records == b->records);
+  ct_test(pTest, a->other == b->other);
+  ct_test(pTest, memcmp(a->link, b->link, sizeof(a->link)) == 0);
+  ct_test(pTest, a->frames_valid == b->frames_valid);
+  ct_test(pTest, a->frames_invalid == b->frames_invalid);
+  ct_test(pTest, memcmp(a->frame_type, b->frame_type,
+    sizeof(a->frame_type)) == 0);
+  ct_test(pTest, memcmp(a->bvlc_function, b->bvlc_function,
+    sizeof(a->bvlc_function)) == 0);
+  ct_test(pTest, a->npdus == b->npdus);
+  ct_test(pTest, a->npdus_invalid == b->npdus_invalid);
+  ct_test(pTest, memcmp(a->pdu_type, b->pdu_type,
+    sizeof(a->pdu_type)) == 0);
+  ct_test(pTest, memcmp(a->confirmed_service, b->confirmed_service,
+    sizeof(a->confirmed_service)) == 0);
+  ct_test(pTest, memcmp(a->unconfirmed_service, b->unconfirmed_service,
+    sizeof(a->unconfirmed_service)) == 0);
+  ct_test(pTest, a->flows == b->flows);
+  ct_test(pTest, a->flows_lost == b->flows_lost);
+  for (i = 0; i < MSTP_TRAFFIC_FLOWS; i++)
+  {
+    if (!a->flow[i].used)
+      continue;
+    flow = test_find_flow(b, a->flow[i].link, a->flow[i].source,
+      a->flow[i].destination);
+    ct_test(pTest, flow != NULL);
+    if (flow)
+    {
+      ct_test(pTest, flow->frames == a->flow[i].frames);
+      ct_test(pTest, flow->octets == a->flow[i].octets);
+    }
+  }
+
+  return;
+}
+
+void testTraffic(Test *pTest)
+{
+  static struct MSTP_Traffic traffic;
+  static struct MSTP_Traffic merged;
+  const struct MSTP_Traffic_Flow *flow;
+  const char *mstp = "/tmp/mstptraf-test-mstp.pcap";
+  const char *ethernet = "/tmp/mstptraf-test-ethernet.pcap";
+  const char *other = "/tmp/mstptraf-test.txt";
+  FILE *fp;
+
+  test_mstp_capture(mstp);
+  test_ethernet_capture(ethernet);
+  fp = fopen(other, "w");
+  assert(fp);
+  fprintf(fp, "not a capture\n");
+  fclose(fp);
+
+  MSTP_Traffic_Init(&traffic);
+  ct_test(pTest, MSTP_Traffic_File(&traffic, mstp));
+  ct_test(pTest, traffic.files == 1);
+  ct_test(pTest, traffic.records == 4);
+  ct_test(pTest, traffic.other == 0);
+  ct_test(pTest, traffic.frames_valid == 3);
+  ct_test(pTest, traffic.frames_invalid == 1);
+  ct_test(pTest, traffic.frame_type[FRAME_TYPE_TOKEN] == 1);
+  ct_test(pTest,
+    traffic.frame_type[FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY] == 1);
+  ct_test(pTest,
+    traffic.frame_type[FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY] == 1);
+  ct_test(pTest, traffic.link[MSTP_TRAFFIC_MSTP].frames == 3);
+  ct_test(pTest, traffic.link[MSTP_TRAFFIC_MSTP].octets ==
+    8 + (8 + sizeof(Test_Who_Is) + 2) + (8 + sizeof(Test_Read_Property) + 2));
+  // in microseconds
+  ct_test(pTest, traffic.link[MSTP_TRAFFIC_MSTP].gap.count == 2);
+  ct_test(pTest, traffic.link[MSTP_TRAFFIC_MSTP].gap.max == 10000);
+  ct_test(pTest, traffic.npdus == 2);
+  ct_test(pTest, traffic.npdus_invalid == 0);
+  ct_test(pTest, traffic.pdu_type[PDU_TYPE_CONFIRMED_SERVICE_REQUEST] == 1);
+  ct_test(pTest,
+    traffic.pdu_type[PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST] == 1);
+  ct_test(pTest,
+    traffic.confirmed_service[SERVICE_CONFIRMED_READ_PROPERTY] == 1);
+  ct_test(pTest, traffic.unconfirmed_service[SERVICE_UNCONFIRMED_WHO_IS] == 1);
+  ct_test(pTest, traffic.flows == 2);
+  flow = test_find_flow(&traffic, MSTP_TRAFFIC_MSTP, 5, 16);
+  ct_test(pTest, flow && (flow->frames == 2));
+  flow = test_find_flow(&traffic, MSTP_TRAFFIC_MSTP, 16, 255);
+  ct_test(pTest, flow && (flow->frames == 1));
+
+  MSTP_Traffic_Init(&traffic);
+  ct_test(pTest, MSTP_Traffic_File(&traffic, ethernet));
+  ct_test(pTest, traffic.records == 4);
+  ct_test(pTest, traffic.other == 1);
+  ct_test(pTest, traffic.frames_valid == 0);
+  ct_test(pTest, traffic.link[MSTP_TRAFFIC_BIP].frames == 2);
+  ct_test(pTest, traffic.link[MSTP_TRAFFIC_ETHERNET].frames == 1);
+  ct_test(pTest, traffic.bvlc_function[BVLC_ORIGINAL_UNICAST_NPDU] == 1);
+  ct_test(pTest, traffic.bvlc_function[BVLC_ORIGINAL_BROADCAST_NPDU] == 1);
+  // in milliseconds
+  ct_test(pTest, traffic.link[MSTP_TRAFFIC_BIP].gap.count == 1);
+  ct_test(pTest, traffic.link[MSTP_TRAFFIC_BIP].gap.max == 1000);
+  ct_test(pTest, traffic.link[MSTP_TRAFFIC_ETHERNET].gap.count == 0);
+  ct_test(pTest, traffic.npdus == 3);
+  ct_test(pTest, traffic.unconfirmed_service[SERVICE_UNCONFIRMED_I_AM] == 1);
+  ct_test(pTest, traffic.unconfirmed_service[SERVICE_UNCONFIRMED_WHO_IS] == 1);
+  ct_test(pTest,
+    traffic.confirmed_service[SERVICE_CONFIRMED_READ_PROPERTY] == 1);
+  flow = test_find_flow(&traffic, MSTP_TRAFFIC_BIP,
+    0xC0A8010ABAC0ULL, 0xC0A801FFBAC0ULL);
+  ct_test(pTest, flow && (flow->frames == 1));
+  flow = test_find_flow(&traffic, MSTP_TRAFFIC_ETHERNET, 10, 20);
+  ct_test(pTest, flow && (flow->frames == 1));
+
+  MSTP_Traffic_Init(&traffic);
+  ct_test(pTest, !MSTP_Traffic_File(&traffic, other));
+  ct_test(pTest, traffic.unreadable == 1);
+  ct_test(pTest, traffic.files == 0);
+
+  // one file after another, merged, and on many workers all count the
+  // same
+  {
+    const char *filenames[3];
+    static struct MSTP_Traffic parallel;
+
+    filenames[0] = other;
+    filenames[1] = mstp;
+    filenames[2] = ethernet;
+    MSTP_Traffic_Init(&traffic);
+    (void)MSTP_Traffic_File(&traffic, other);
+    (void)MSTP_Traffic_File(&traffic, mstp);
+    MSTP_Traffic_Init(&merged);
+    (void)MSTP_Traffic_File(&merged, ethernet);
+    MSTP_Traffic_Merge(&merged, &traffic);
+    ct_test(pTest, merged.files == 2);
+    ct_test(pTest, merged.unreadable == 1);
+    ct_test(pTest, merged.records == 8);
+    ct_test(pTest, merged.npdus == 5);
+    ct_test(pTest, merged.flows == 5);
+    ct_test(pTest, merged.pdu_type[PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST] == 3);
+    MSTP_Traffic_Init(&traffic);
+    ct_test(pTest, MSTP_Traffic_Files(&traffic, filenames, 3, 1));
+    test_same(pTest, &traffic, &merged);
+    MSTP_Traffic_Init(&parallel);
+    ct_test(pTest, MSTP_Traffic_Files(&parallel, filenames, 3, 3));
+    test_same(pTest, &parallel, &merged);
+    MSTP_Traffic_Init(&parallel);
+    ct_test(pTest, MSTP_Traffic_Files(&parallel, filenames, 0, 3));
+    ct_test(pTest, parallel.files == 0);
+  }
+  ct_test(pTest, MSTP_Traffic_Capture_Name("a.cap"));
+  ct_test(pTest, MSTP_Traffic_Capture_Name("dir/b.PCAP"));
+  ct_test(pTest, MSTP_Traffic_Capture_Name("c.pcapng"));
+  ct_test(pTest, !MSTP_Traffic_Capture_Name("d.pdf"));
+  ct_test(pTest, !MSTP_Traffic_Capture_Name("cap"));
+
+  (void)remove(mstp);
+  (void)remove(ethernet);
+  (void)remove(other);
+
+  return;
+}
+
+void testTrafficFlowsFull(Test *pTest)
+{
+  static struct MSTP_Traffic traffic;
+  static struct MSTP_Traffic other;
+  struct traffic_file file;
+  unsigned i;
+
+  MSTP_Traffic_Init(&traffic);
+  memset(&file, 0, sizeof(file));
+  file.traffic = &traffic;
+  for (i = 0; i < MSTP_TRAFFIC_FLOWS + 10; i++)
+    traffic_frame(&file, MSTP_TRAFFIC_BIP, i, 0, 100);
+  // one is left free, and the frames of the rest are still counted
+  ct_test(pTest, traffic.flows == MSTP_TRAFFIC_FLOWS - 1);
+  ct_test(pTest, traffic.flows_lost == 11);
+  ct_test(pTest, traffic.link[MSTP_TRAFFIC_BIP].frames ==
+    MSTP_TRAFFIC_FLOWS + 10);
+  ct_test(pTest, test_find_flow(&traffic, MSTP_TRAFFIC_BIP, 0, 0) != NULL);
+  MSTP_Traffic_Init(&other);
+  file.traffic = &other;
+  traffic_frame(&file, MSTP_TRAFFIC_BIP, 0, 0, 100);
+  traffic_frame(&file, MSTP_TRAFFIC_ARCNET, 1, 2, 100);
+  MSTP_Traffic_Merge(&traffic, &other);
+  ct_test(pTest, test_find_flow(&traffic, MSTP_TRAFFIC_BIP, 0, 0)->frames ==
+    2);
+  ct_test(pTest, traffic.flows_lost == 12);
+
+  return;
+}
+
+#ifdef TEST_MSTPTRAF
+// adds a file, or the captures in a directory, to the list
+static void traffic_add_path(
+  char ***filenames,
+  unsigned *count,
+  const char *path)
+{
+  char name[1024];
+  struct dirent *entry;
+  struct stat status;
+  DIR *dir;
+
+  if ((stat(path, &status) == 0) && S_ISDIR(status.st_mode))
+  {
+    dir = opendir(path);
+    while (dir && ((entry = readdir(dir)) != NULL))
+    {
+      if ((entry->d_name[0] == '.') ||
+          !MSTP_Traffic_Capture_Name(entry->d_name))
+        continue;
+      snprintf(name, sizeof(name), "%s/%s", path, entry->d_name);
+      traffic_add_path(filenames, count, name);
+    }
+    if (dir)
+      closedir(dir);
+    return;
+  }
+  *filenames = realloc(*filenames, (*count + 1) * sizeof(char *));
+  assert(*filenames);
+  (*filenames)[*count] = strdup(path);
+  (*count)++;
+
+  return;
+}
+
+// usage: mstptraf [-j workers] [capture or directory ...]
+int main(int argc, char *argv[])
+{
+  static struct MSTP_Traffic serial;
+  static struct MSTP_Traffic parallel;
+  char **filenames = NULL;
+  unsigned count = 0;
+  long workers = sysconf(_SC_NPROCESSORS_ONLN);
+  double start, serial_seconds, parallel_seconds;
+  Test *pTest;
+  bool rc;
+  int i;
+
+  pTest = ct_create("mstptraf", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testTraffic);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testTrafficFlowsFull);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  for (i = 1; i < argc; i++)
+  {
+    if ((strcmp(argv[i], "-j") == 0) && ((i + 1) < argc))
+      workers = atol(argv[++i]);
+    else
+      traffic_add_path(&filenames, &count, argv[i]);
+  }
+  if (count == 0)
+    traffic_add_path(&filenames, &count, MSTP_TRAFFIC_CAPTURES_DIR);
+  if (workers < 1)
+    workers = 1;
+
+  MSTP_Traffic_Init(&serial);
+  start = OS_MonotonicSeconds();
+  (void)MSTP_Traffic_Files(&serial, (const char *const *)filenames, count, 1);
+  serial_seconds = OS_MonotonicSeconds() - start;
+  MSTP_Traffic_Init(&parallel);
+  start = OS_MonotonicSeconds();
+  (void)MSTP_Traffic_Files(&parallel, (const char *const *)filenames, count,
+    (unsigned)workers);
+  parallel_seconds = OS_MonotonicSeconds() - start;
+  MSTP_Traffic_Report(stdout, &parallel, 10);
+  printf("%u files: %.3f s on 1 worker, %.3f s on %ld workers, "
+    "%.1f records/us, %s\n", count, serial_seconds, parallel_seconds,
+    workers, (double)parallel.records / (parallel_seconds * 1.0e6),
+    (parallel.records == serial.records) &&
+    (parallel.npdus == serial.npdus) && (parallel.flows == serial.flows) ?
+    "same counts" : "COUNTS DIFFER");
+  for (i = 0; i < (int)count; i++)
+    free(filenames[i]);
+  free(filenames);
+
+  return 0;
+}
+#endif /* TEST_MSTPTRAF */
+#endif /* TEST */
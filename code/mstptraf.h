@@ -0,0 +1,150 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef MSTPTRAF_H
+#define MSTPTRAF_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "mstp.h"
+
+// Traffic analysis of a corpus of capture files: who talks to whom,
+// how much, with which frames and services, and how far apart.
+// MS/TP frames are decoded by a port in bus monitor mode, and
+// BACnet/IP, BACnet/Ethernet and ARCNET packets by their headers, down
+// to the BVLC function, the NPDU and the APDU type and service.
+// Each file is analyzed by one worker into counts of its own, which
+// are added together once all of the files are done.
+
+// the data links that flows are counted on
+#define MSTP_TRAFFIC_MSTP 0
+#define MSTP_TRAFFIC_BIP 1 // BACnet/IP, addresses are IPv4 and UDP port
+#define MSTP_TRAFFIC_ETHERNET 2 // BACnet/Ethernet, 802.2 LLC
+#define MSTP_TRAFFIC_ARCNET 3
+#define MSTP_TRAFFIC_LINKS 4
+
+// flows in the table of each analysis, a power of two
+#define MSTP_TRAFFIC_FLOWS 4096
+
+// the frames and octets from one source to one destination
+struct MSTP_Traffic_Flow
+{
+  uint64_t source; // MS/TP or ARCNET station, MAC, or IPv4 and UDP port
+  uint64_t destination;
+  unsigned link; // MSTP_TRAFFIC_MSTP ... if used
+  bool used;
+  unsigned long frames;
+  unsigned long long octets;
+};
+
+struct MSTP_Traffic_Link
+{
+  unsigned long frames;
+  unsigned long long octets;
+  // the gap from one frame to the next in the same file, in
+  // microseconds on MS/TP, where the gaps of interest are a few bit
+  // times to a few milliseconds, and in milliseconds on the others
+  struct MSTP_Histogram gap;
+};
+
+struct MSTP_Traffic
+{
+  unsigned long files; // read
+  unsigned long unreadable; // files that are not captures
+  unsigned long records;
+  unsigned long other; // records that are not BACnet
+  struct MSTP_Traffic_Link link[MSTP_TRAFFIC_LINKS];
+  // MS/TP
+  unsigned long frames_valid;
+  unsigned long frames_invalid;
+  unsigned long frame_type[256]; // of the valid frames
+  // BACnet/IP
+  unsigned long bvlc_function[256];
+  // the NPDUs of every link
+  unsigned long npdus;
+  unsigned long npdus_invalid;
+  unsigned long network_message[256];
+  unsigned long pdu_type[16];
+  unsigned long confirmed_service[256];
+  unsigned long unconfirmed_service[256];
+  // the traffic matrix, a hash table of flows
+  struct MSTP_Traffic_Flow flow[MSTP_TRAFFIC_FLOWS];
+  unsigned flows;
+  unsigned long flows_lost; // frames of flows that did not fit
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// clears the counts
+void MSTP_Traffic_Init(struct MSTP_Traffic *traffic);
+
+// adds the frames of a capture file to the counts.
+// returns false if the file is not a capture.
+bool MSTP_Traffic_File(
+  struct MSTP_Traffic *traffic,
+  const char *filename);
+
+// adds the counts of one analysis to another
+void MSTP_Traffic_Merge(
+  struct MSTP_Traffic *traffic,
+  const struct MSTP_Traffic *from);
+
+// analyzes count files on up to workers threads, each of which takes
+// the largest file that is left when it is done with its last, and
+// adds them to traffic.  returns false if there is no memory for the
+// workers.
+bool MSTP_Traffic_Files(
+  struct MSTP_Traffic *traffic,
+  const char *const *filenames,
+  unsigned count,
+  unsigned workers);
+
+// true for a file name that ends in .cap, .pcap or .pcapng
+bool MSTP_Traffic_Capture_Name(const char *filename);
+
+// prints the totals, the mix of frames and services, the gaps, and
+// the top flows and sources by frames
+void MSTP_Traffic_Report(
+  FILE *stream,
+  const struct MSTP_Traffic *traffic,
+  unsigned top);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,162 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// BACnet NPDU header
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "npdu.h" // check for valid prototypes
+
+bool NPDU_Decode(
+  const uint8_t *npdu,
+  unsigned length,
+  struct NPDU_Header *header)
+{
+  unsigned offset = 2;
+
+  if ((length < 3) || (npdu[0] != BACNET_PROTOCOL_VERSION))
+    return false;
+  header->control = npdu[1];
+  header->dnet = 0;
+  header->dlen = 0;
+  header->dadr = NULL;
+  header->snet = 0;
+  header->slen = 0;
+  header->sadr = NULL;
+  header->hop_count = 0;
+  // DNET, DLEN and DADR
+  if (header->control & NPDU_DESTINATION_SPECIFIED)
+  {
+    if ((offset + 3) > length)
+      return false;
+    header->dnet = (uint16_t)((npdu[offset] << 8) | npdu[offset + 1]);
+    header->dlen = npdu[offset + 2];
+    header->dadr = &npdu[offset + 3];
+    offset += 3 + header->dlen;
+  }
+  // SNET, SLEN and SADR
+  if (header->control & NPDU_SOURCE_SPECIFIED)
+  {
+    if ((offset + 3) > length)
+      return false;
+    header->snet = (uint16_t)((npdu[offset] << 8) | npdu[offset + 1]);
+    header->slen = npdu[offset + 2];
+    header->sadr = &npdu[offset + 3];
+    offset += 3 + header->slen;
+  }
+  if (header->control & NPDU_DESTINATION_SPECIFIED)
+  {
+    if (offset >= length)
+      return false;
+    header->hop_count = npdu[offset++];
+  }
+  if (offset >= length)
+    return false;
+  header->offset = offset;
+
+  return true;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+
+#include "ctest.h"
+
+void testNPDU(Test* pTest)
+{
+  struct NPDU_Header header;
+  // a local Who-Is
+  const uint8_t local[] = {0x01, 0x00, 0x10, 0x08};
+  // routed from network 5, address 3, to network 7, address 42,
+  // expecting a reply
+  const uint8_t routed[] = {0x01, 0x2C, 0x00, 0x07, 1, 42,
+    0x00, 0x05, 1, 3, 255, 0x00, 0x05, 1, 12};
+  // a broadcast to network 9 of a network layer message
+  const uint8_t message[] = {0x01, 0xA0, 0x00, 0x09, 0, 254, 0x00};
+  unsigned length;
+
+  ct_test(pTest, NPDU_Decode(local, sizeof(local), &header));
+  ct_test(pTest, header.control == 0);
+  ct_test(pTest, header.dnet == 0);
+  ct_test(pTest, header.offset == 2);
+  ct_test(pTest, NPDU_Decode(routed, sizeof(routed), &header));
+  ct_test(pTest, header.control & NPDU_EXPECTING_REPLY);
+  ct_test(pTest, header.dnet == 7);
+  ct_test(pTest, header.dlen == 1);
+  ct_test(pTest, header.dadr[0] == 42);
+  ct_test(pTest, header.snet == 5);
+  ct_test(pTest, header.slen == 1);
+  ct_test(pTest, header.sadr[0] == 3);
+  ct_test(pTest, header.hop_count == 255);
+  ct_test(pTest, header.offset == 11);
+  ct_test(pTest, NPDU_Decode(message, sizeof(message), &header));
+  ct_test(pTest, header.control & NPDU_NETWORK_LAYER_MESSAGE);
+  ct_test(pTest, header.dnet == 9);
+  ct_test(pTest, header.dlen == 0);
+  ct_test(pTest, header.offset == 6);
+  // every truncation fails, as does another protocol version
+  for (length = 0; length < sizeof(routed) - 3; length++)
+    ct_test(pTest, !NPDU_Decode(routed, length, &header));
+  for (length = 0; length < sizeof(message) - 1; length++)
+    ct_test(pTest, !NPDU_Decode(message, length, &header));
+  ct_test(pTest, !NPDU_Decode(&local[1], sizeof(local) - 1, &header));
+
+  return;
+}
+
+#ifdef TEST_NPDU
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("npdu", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testNPDU);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  return 0;
+}
+#endif /* TEST_NPDU */
+#endif /* TEST */
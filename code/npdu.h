@@ -0,0 +1,83 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef NPDU_H
+#define NPDU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The network layer header of a BACnet NPDU, which comes before the
+// APDU or network layer message in every BACnet frame or packet.
+
+#define BACNET_PROTOCOL_VERSION 1
+
+// bits of the NPDU control octet
+#define NPDU_NETWORK_LAYER_MESSAGE 0x80
+#define NPDU_DESTINATION_SPECIFIED 0x20
+#define NPDU_SOURCE_SPECIFIED 0x08
+#define NPDU_EXPECTING_REPLY 0x04
+#define NPDU_PRIORITY_MASK 0x03
+
+struct NPDU_Header
+{
+  uint8_t control;
+  uint16_t dnet; // with NPDU_DESTINATION_SPECIFIED
+  uint8_t dlen; // 0 for a broadcast on DNET
+  const uint8_t *dadr;
+  uint16_t snet; // with NPDU_SOURCE_SPECIFIED
+  uint8_t slen;
+  const uint8_t *sadr;
+  uint8_t hop_count;
+  // the offset of the APDU, or of the message type of a network
+  // layer message
+  unsigned offset;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// decodes the header in place.  returns false if the NPDU is not
+// BACnet protocol version 1, or ends before the APDU or message type.
+bool NPDU_Decode(
+  const uint8_t *npdu,
+  unsigned length,
+  struct NPDU_Header *header);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
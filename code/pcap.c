@@ -0,0 +1,1349 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// Capture File Reader and Writer
+//
+// Reads the classic pcap and the pcapng capture file formats,
+// in either byte order, from a memory mapped file.  Records are
+// returned as pointers into the mapping.
+//
+// An index holds the decoded header of every record, so that record N
+// is read with one lookup.  Saved, it is a header that names the size
+// and modification time of the capture, followed by the entries in host
+// byte order; an index of another machine or an older capture is
+// rejected and built again.
+//
+// Writes classic pcap files in host byte order.  Records are copied
+// into the fill block, and when it is full the blocks change places
+// and a thread writes the full one with a single write().  The lock
+// is only taken when the blocks change places.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pcap.h" // check for valid prototypes
+
+// classic pcap magic numbers, as read in host byte order
+#define PCAP_MAGIC_MICROSECONDS 0xA1B2C3D4UL
+#define PCAP_MAGIC_NANOSECONDS 0xA1B23C4DUL
+#define PCAP_FILE_HEADER_SIZE 24
+#define PCAP_RECORD_HEADER_SIZE 16
+
+// pcapng block types
+#define PCAPNG_SECTION_HEADER 0x0A0D0D0AUL
+#define PCAPNG_INTERFACE_DESCRIPTION 0x00000001UL
+#define PCAPNG_PACKET 0x00000002UL
+#define PCAPNG_SIMPLE_PACKET 0x00000003UL
+#define PCAPNG_ENHANCED_PACKET 0x00000006UL
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4DUL
+#define PCAPNG_OPTION_END 0
+#define PCAPNG_OPTION_IF_TSRESOL 9
+
+#define NANOSECONDS_PER_SECOND 1000000000ULL
+
+static uint32_t swap32(uint32_t value)
+{
+  return ((value & 0x000000FFUL) << 24) | ((value & 0x0000FF00UL) << 8) |
+    ((value & 0x00FF0000UL) >> 8) | ((value & 0xFF000000UL) >> 24);
+}
+
+// reads a 32-bit value in the byte order of the file
+static uint32_t get32(const struct Pcap_File *file, const uint8_t *p)
+{
+  uint32_t value;
+
+  memcpy(&value, p, sizeof(value));
+
+  return file->swap ? swap32(value) : value;
+}
+
+// reads a 16-bit value in the byte order of the file
+static uint16_t get16(const struct Pcap_File *file, const uint8_t *p)
+{
+  uint16_t value;
+
+  memcpy(&value, p, sizeof(value));
+  if (file->swap)
+    value = (uint16_t)((value << 8) | (value >> 8));
+
+  return value;
+}
+
+// converts a pcapng timestamp to nanoseconds
+static uint64_t pcapng_nanoseconds(uint64_t units, uint64_t units_per_second)
+{
+  uint64_t seconds = units / units_per_second;
+  uint64_t fraction = units % units_per_second;
+
+  if (units_per_second <= NANOSECONDS_PER_SECOND)
+    fraction = (fraction * NANOSECONDS_PER_SECOND) / units_per_second;
+  else
+    fraction /= (units_per_second / NANOSECONDS_PER_SECOND);
+
+  return (seconds * NANOSECONDS_PER_SECOND) + fraction;
+}
+
+// reads the options of an interface description block
+static void pcapng_interface_options(
+  const struct Pcap_File *file,
+  struct Pcap_Interface *interface,
+  const uint8_t *option,
+  const uint8_t *end)
+{
+  uint16_t code;
+  uint16_t length;
+  unsigned resolution;
+
+  while ((option + 4) <= end)
+  {
+    code = get16(file, option);
+    length = get16(file, option + 2);
+    option += 4;
+    if ((code == PCAPNG_OPTION_END) || ((option + length) > end))
+      break;
+    if ((code == PCAPNG_OPTION_IF_TSRESOL) && (length >= 1))
+    {
+      resolution = option[0];
+      // a power of two, or a power of ten
+      if (resolution & 0x80)
+      {
+        resolution &= 0x7F;
+        if (resolution > 63)
+          resolution = 63;
+        interface->units_per_second = 1ULL << resolution;
+      }
+      else
+      {
+        if (resolution > 19)
+          resolution = 19;
+        interface->units_per_second = 1;
+        while (resolution--)
+          interface->units_per_second *= 10;
+      }
+    }
+    option += (length + 3) & ~3U;
+  }
+
+  return;
+}
+
+// reads a section header block, which sets the byte order
+static bool pcapng_section(struct Pcap_File *file, const uint8_t *block)
+{
+  uint32_t magic;
+
+  memcpy(&magic, block + 8, sizeof(magic));
+  if (magic == PCAPNG_BYTE_ORDER_MAGIC)
+    file->swap = false;
+  else if (swap32(magic) == PCAPNG_BYTE_ORDER_MAGIC)
+    file->swap = true;
+  else
+    return false;
+  // interfaces are numbered per section
+  file->interfaces = 0;
+
+  return true;
+}
+
+// reads pcapng blocks until a packet is found
+static bool pcapng_next(struct Pcap_File *file, struct Pcap_Record *record)
+{
+  const uint8_t *block;
+  uint32_t type;
+  uint32_t length;
+  uint32_t id;
+  uint64_t units;
+  struct Pcap_Interface *interface;
+
+  while ((file->offset + 12) <= file->size)
+  {
+    block = file->data + file->offset;
+    type = get32(file, block);
+    if (type == PCAPNG_SECTION_HEADER)
+    {
+      if ((file->offset + 28) > file->size)
+        return false;
+      if (!pcapng_section(file, block))
+        return false;
+    }
+    length = get32(file, block + 4);
+    if ((length < 12) || (length & 3) || (length > (file->size - file->offset)))
+      return false;
+    file->offset += length;
+    switch (type)
+    {
+      case PCAPNG_INTERFACE_DESCRIPTION:
+        if ((length >= 20) && (file->interfaces < PCAP_INTERFACES_MAX))
+        {
+          interface = &file->interface[file->interfaces++];
+          interface->linktype = get16(file, block + 8);
+          interface->snaplen = get32(file, block + 12);
+          interface->units_per_second = 1000000;
+          pcapng_interface_options(file, interface, block + 16,
+            block + length - 4);
+        }
+        break;
+      case PCAPNG_ENHANCED_PACKET:
+      case PCAPNG_PACKET:
+        if (length < 32)
+          return false;
+        if (type == PCAPNG_ENHANCED_PACKET)
+          id = get32(file, block + 8);
+        else
+          id = get16(file, block + 8);
+        if (id >= file->interfaces)
+          return false;
+        interface = &file->interface[id];
+        record->length = get32(file, block + 20);
+        record->original_length = get32(file, block + 24);
+        if (record->length > (length - 32))
+          return false;
+        record->data = block + 28;
+        record->linktype = interface->linktype;
+        units = ((uint64_t)get32(file, block + 12) << 32) |
+          get32(file, block + 16);
+        record->timestamp =
+          pcapng_nanoseconds(units, interface->units_per_second);
+        return true;
+      case PCAPNG_SIMPLE_PACKET:
+        if ((length < 16) || (file->interfaces == 0))
+          return false;
+        interface = &file->interface[0];
+        record->original_length = get32(file, block + 8);
+        record->length = record->original_length;
+        if (interface->snaplen && (record->length > interface->snaplen))
+          record->length = interface->snaplen;
+        if (record->length > (length - 16))
+          record->length = length - 16;
+        record->data = block + 12;
+        record->linktype = interface->linktype;
+        // simple packets carry no timestamp
+        record->timestamp = 0;
+        return true;
+      default:
+        // skip blocks that do not carry packets
+        break;
+    }
+  }
+
+  return false;
+}
+
+// reads the next classic pcap record
+static bool pcap_next(struct Pcap_File *file, struct Pcap_Record *record)
+{
+  const uint8_t *header;
+  uint32_t seconds;
+  uint32_t fraction;
+
+  if ((file->offset + PCAP_RECORD_HEADER_SIZE) > file->size)
+    return false;
+  header = file->data + file->offset;
+  seconds = get32(file, header);
+  fraction = get32(file, header + 4);
+  record->length = get32(file, header + 8);
+  record->original_length = get32(file, header + 12);
+  if (record->length >
+      (file->size - file->offset - PCAP_RECORD_HEADER_SIZE))
+    return false;
+  record->data = header + PCAP_RECORD_HEADER_SIZE;
+  record->linktype = file->linktype;
+  record->timestamp = (uint64_t)seconds * NANOSECONDS_PER_SECOND;
+  if (file->nanosecond)
+    record->timestamp += fraction;
+  else
+    record->timestamp += (uint64_t)fraction * 1000;
+  file->offset += PCAP_RECORD_HEADER_SIZE + record->length;
+
+  return true;
+}
+
+// reads the header of the file to find its format
+static bool pcap_header(struct Pcap_File *file)
+{
+  uint32_t magic;
+
+  if (file->size < PCAP_FILE_HEADER_SIZE)
+    return false;
+  memcpy(&magic, file->data, sizeof(magic));
+  file->swap = false;
+  file->nanosecond = false;
+  file->pcapng = false;
+  if ((magic == PCAP_MAGIC_MICROSECONDS) || (magic == PCAP_MAGIC_NANOSECONDS))
+    file->nanosecond = (magic == PCAP_MAGIC_NANOSECONDS);
+  else if ((swap32(magic) == PCAP_MAGIC_MICROSECONDS) ||
+           (swap32(magic) == PCAP_MAGIC_NANOSECONDS))
+  {
+    file->swap = true;
+    file->nanosecond = (swap32(magic) == PCAP_MAGIC_NANOSECONDS);
+  }
+  else if (magic == PCAPNG_SECTION_HEADER)
+  {
+    file->pcapng = true;
+    file->first = 0;
+    return pcapng_section(file, file->data);
+  }
+  else
+    return false;
+  file->linktype = get32(file, file->data + 20);
+  file->first = PCAP_FILE_HEADER_SIZE;
+
+  return true;
+}
+
+// maps the file and reads its header.
+// returns false if the file cannot be read or is not a capture.
+bool Pcap_Open(struct Pcap_File *file, const char *filename)
+{
+  struct stat status;
+  void *data;
+
+  memset(file, 0, sizeof(struct Pcap_File));
+  file->fd = open(filename, O_RDONLY);
+  if (file->fd < 0)
+    return false;
+  if ((fstat(file->fd, &status) == 0) && S_ISREG(status.st_mode) &&
+      (status.st_size >= PCAP_FILE_HEADER_SIZE))
+  {
+    data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE,
+      file->fd, 0);
+    if (data != MAP_FAILED)
+    {
+      (void)madvise(data, (size_t)status.st_size, MADV_SEQUENTIAL);
+      file->data = data;
+      file->size = (size_t)status.st_size;
+      if (pcap_header(file))
+      {
+        file->offset = file->first;
+        return true;
+      }
+    }
+  }
+  Pcap_Close(file);
+
+  return false;
+}
+
+// unmaps the file
+void Pcap_Close(struct Pcap_File *file)
+{
+  if (file->data)
+    (void)munmap((void *)file->data, file->size);
+  if (file->fd >= 0)
+    (void)close(file->fd);
+  file->data = NULL;
+  file->size = 0;
+  file->offset = 0;
+  file->fd = -1;
+
+  return;
+}
+
+// reads the next packet record.  returns false at the end of the file
+// or at a truncated or damaged record.
+bool Pcap_Next(struct Pcap_File *file, struct Pcap_Record *record)
+{
+  if (!file->data)
+    return false;
+  if (file->pcapng)
+    return pcapng_next(file, record);
+
+  return pcap_next(file, record);
+}
+
+// starts reading again from the first record
+void Pcap_Rewind(struct Pcap_File *file)
+{
+  file->offset = file->first;
+  if (file->pcapng && file->data)
+    (void)pcapng_section(file, file->data);
+
+  return;
+}
+
+// writes all of a block, through short writes and signals
+static bool pcap_write_all(int fd, const uint8_t *data, size_t length)
+{
+  ssize_t written;
+
+  while (length)
+  {
+    written = write(fd, data, length);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    length -= (size_t)written;
+  }
+
+  return true;
+}
+
+// writes each block that it is handed, until the writer is closed
+static void *pcap_writer_thread(void *arg)
+{
+  struct Pcap_Writer *writer = arg;
+  unsigned index;
+  bool ok;
+
+  pthread_mutex_lock(&writer->lock);
+  for (;;)
+  {
+    while (!writer->busy && !writer->done)
+      pthread_cond_wait(&writer->wake, &writer->lock);
+    if (!writer->busy)
+      break;
+    // the block that is not being filled
+    index = writer->fill ^ 1;
+    pthread_mutex_unlock(&writer->lock);
+    ok = pcap_write_all(writer->fd, writer->block[index],
+      writer->length[index]);
+    pthread_mutex_lock(&writer->lock);
+    writer->length[index] = 0;
+    if (!ok)
+      writer->error = true;
+    writer->busy = false;
+    pthread_cond_signal(&writer->idle);
+  }
+  pthread_mutex_unlock(&writer->lock);
+
+  return NULL;
+}
+
+// hands the fill block to the thread, once it has written the other
+static void pcap_writer_swap(struct Pcap_Writer *writer)
+{
+  pthread_mutex_lock(&writer->lock);
+  if (writer->busy)
+    writer->waits++;
+  while (writer->busy)
+    pthread_cond_wait(&writer->idle, &writer->lock);
+  writer->failed = writer->error;
+  writer->fill ^= 1;
+  writer->busy = true;
+  writer->blocks++;
+  pthread_cond_signal(&writer->wake);
+  pthread_mutex_unlock(&writer->lock);
+
+  return;
+}
+
+// values are written in host byte order, which the magic number shows
+static void put16(uint8_t *p, uint16_t value)
+{
+  memcpy(p, &value, sizeof(value));
+}
+
+static void put32(uint8_t *p, uint32_t value)
+{
+  memcpy(p, &value, sizeof(value));
+}
+
+// creates a classic pcap file with microsecond timestamps, and starts
+// the thread that writes it.  returns false if it cannot be created.
+bool Pcap_Writer_Open(
+  struct Pcap_Writer *writer,
+  const char *filename,
+  uint32_t linktype,
+  uint32_t snaplen)
+{
+  uint8_t *header;
+
+  memset(writer, 0, sizeof(struct Pcap_Writer));
+  // not open, so that a close after a failure does nothing
+  writer->fd = -1;
+  writer->snaplen = snaplen;
+  if ((snaplen == 0) ||
+      (snaplen > (PCAP_WRITER_BLOCK_SIZE - PCAP_RECORD_HEADER_SIZE)))
+    return false;
+  writer->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (writer->fd < 0)
+    return false;
+  writer->block[0] = malloc(PCAP_WRITER_BLOCK_SIZE);
+  writer->block[1] = malloc(PCAP_WRITER_BLOCK_SIZE);
+  if (writer->block[0] && writer->block[1])
+  {
+    header = writer->block[0];
+    put32(&header[0], PCAP_MAGIC_MICROSECONDS);
+    put16(&header[4], 2); // version 2.4
+    put16(&header[6], 4);
+    put32(&header[8], 0); // UTC
+    put32(&header[12], 0); // accuracy of the timestamps
+    put32(&header[16], snaplen);
+    put32(&header[20], linktype);
+    writer->length[0] = PCAP_FILE_HEADER_SIZE;
+    if ((pthread_mutex_init(&writer->lock, NULL) == 0) &&
+        (pthread_cond_init(&writer->wake, NULL) == 0) &&
+        (pthread_cond_init(&writer->idle, NULL) == 0) &&
+        (pthread_create(&writer->thread, NULL, pcap_writer_thread,
+          writer) == 0))
+      return true;
+  }
+  free(writer->block[0]);
+  free(writer->block[1]);
+  (void)close(writer->fd);
+  writer->fd = -1;
+
+  return false;
+}
+
+// appends a record with a timestamp in nanoseconds since 1970.
+// waits only if both blocks are full.  returns false once the write
+// of an earlier block has failed.
+bool Pcap_Writer_Write(
+  struct Pcap_Writer *writer,
+  uint64_t timestamp,
+  const uint8_t *data,
+  uint32_t length)
+{
+  uint32_t captured = length;
+  uint8_t *record;
+
+  if (captured > writer->snaplen)
+    captured = writer->snaplen;
+  if ((writer->length[writer->fill] + PCAP_RECORD_HEADER_SIZE + captured) >
+      PCAP_WRITER_BLOCK_SIZE)
+    pcap_writer_swap(writer);
+  record = writer->block[writer->fill] + writer->length[writer->fill];
+  put32(&record[0], (uint32_t)(timestamp / NANOSECONDS_PER_SECOND));
+  put32(&record[4],
+    (uint32_t)((timestamp % NANOSECONDS_PER_SECOND) / 1000));
+  put32(&record[8], captured);
+  put32(&record[12], length);
+  memcpy(&record[PCAP_RECORD_HEADER_SIZE], data, captured);
+  writer->length[writer->fill] += PCAP_RECORD_HEADER_SIZE + captured;
+  writer->records++;
+  writer->octets += captured;
+
+  return !writer->failed;
+}
+
+// hands the records appended so far to the thread
+bool Pcap_Writer_Flush(struct Pcap_Writer *writer)
+{
+  if (writer->length[writer->fill])
+    pcap_writer_swap(writer);
+
+  return !writer->failed;
+}
+
+// writes the rest of the records, stops the thread and closes the
+// file.  returns false if any write failed.
+bool Pcap_Writer_Close(struct Pcap_Writer *writer)
+{
+  bool ok;
+
+  if (writer->fd < 0)
+    return false;
+  (void)Pcap_Writer_Flush(writer);
+  pthread_mutex_lock(&writer->lock);
+  writer->done = true;
+  pthread_cond_signal(&writer->wake);
+  pthread_mutex_unlock(&writer->lock);
+  pthread_join(writer->thread, NULL);
+  pthread_cond_destroy(&writer->idle);
+  pthread_cond_destroy(&writer->wake);
+  pthread_mutex_destroy(&writer->lock);
+  ok = !writer->error;
+  if (close(writer->fd) != 0)
+    ok = false;
+  writer->fd = -1;
+  free(writer->block[0]);
+  free(writer->block[1]);
+  writer->block[0] = NULL;
+  writer->block[1] = NULL;
+
+  return ok;
+}
+
+// index files start with this header, in host byte order
+#define PCAP_INDEX_MAGIC 0x58444950UL // "PIDX"
+#define PCAP_INDEX_VERSION 1
+#define PCAP_INDEX_HEADER_SIZE 32
+#define PCAP_INDEX_POSITION_MASK 0x0000FFFFFFFFFFFFULL
+#define PCAP_INDEX_LINKTYPE_SHIFT 48
+
+struct pcap_index_header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t size; // of the capture file
+  uint64_t modified; // nanoseconds since 1970, of the capture file
+  uint64_t count;
+};
+
+// the size and modification time that an index was made for
+static bool pcap_index_stamp(
+  const struct Pcap_File *file,
+  struct pcap_index_header *header)
+{
+  struct stat status;
+
+  if ((file->fd < 0) || (fstat(file->fd, &status) != 0))
+    return false;
+  header->magic = PCAP_INDEX_MAGIC;
+  header->version = PCAP_INDEX_VERSION;
+  header->size = (uint64_t)status.st_size;
+  header->modified = (uint64_t)status.st_mtim.tv_sec * NANOSECONDS_PER_SECOND +
+    (uint64_t)status.st_mtim.tv_nsec;
+
+  return true;
+}
+
+// walks the records of the file into an index in memory, and
+// rewinds the file.  returns false if there is no memory.
+bool Pcap_Index_Build(struct Pcap_Index *index, struct Pcap_File *file)
+{
+  struct Pcap_Index_Entry *entry = NULL;
+  struct Pcap_Index_Entry *grown;
+  struct Pcap_Record record;
+  size_t allocated = 0;
+  size_t count = 0;
+
+  memset(index, 0, sizeof(struct Pcap_Index));
+  Pcap_Rewind(file);
+  while (Pcap_Next(file, &record))
+  {
+    if (count == allocated)
+    {
+      allocated = allocated ? (allocated * 2) : 1024;
+      grown = realloc(entry, allocated * sizeof(struct Pcap_Index_Entry));
+      if (!grown)
+      {
+        free(entry);
+        Pcap_Rewind(file);
+        return false;
+      }
+      entry = grown;
+    }
+    entry[count].position = (uint64_t)(record.data - file->data) |
+      ((uint64_t)(record.linktype & 0xFFFF) << PCAP_INDEX_LINKTYPE_SHIFT);
+    entry[count].timestamp = record.timestamp;
+    entry[count].length = record.length;
+    entry[count].original_length = record.original_length;
+    count++;
+  }
+  Pcap_Rewind(file);
+  index->entry = entry;
+  index->count = count;
+
+  return true;
+}
+
+// writes an index of the file.  returns false if it cannot be written.
+bool Pcap_Index_Save(
+  const struct Pcap_Index *index,
+  const struct Pcap_File *file,
+  const char *filename)
+{
+  struct pcap_index_header header;
+  bool status;
+  int fd;
+
+  memset(&header, 0, sizeof(header));
+  if (!pcap_index_stamp(file, &header))
+    return false;
+  header.count = index->count;
+  fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+  status = pcap_write_all(fd, (const uint8_t *)&header, sizeof(header)) &&
+    pcap_write_all(fd, (const uint8_t *)index->entry,
+      index->count * sizeof(struct Pcap_Index_Entry));
+  if (close(fd) != 0)
+    status = false;
+  // a part of an index is no index
+  if (!status)
+    (void)unlink(filename);
+
+  return status;
+}
+
+// maps an index that was saved for the file.  returns false if it
+// cannot be read, or the file has changed since it was saved.
+bool Pcap_Index_Load(
+  struct Pcap_Index *index,
+  const struct Pcap_File *file,
+  const char *filename)
+{
+  struct pcap_index_header expected;
+  struct pcap_index_header header;
+  struct stat status;
+  void *data;
+  int fd;
+
+  memset(index, 0, sizeof(struct Pcap_Index));
+  memset(&expected, 0, sizeof(expected));
+  if (!pcap_index_stamp(file, &expected))
+    return false;
+  fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return false;
+  if ((fstat(fd, &status) != 0) || !S_ISREG(status.st_mode) ||
+      (status.st_size < PCAP_INDEX_HEADER_SIZE))
+  {
+    (void)close(fd);
+    return false;
+  }
+  data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  (void)close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  memcpy(&header, data, sizeof(header));
+  if ((header.magic != expected.magic) ||
+      (header.version != expected.version) ||
+      (header.size != expected.size) ||
+      (header.modified != expected.modified) ||
+      (header.count != (((uint64_t)status.st_size - PCAP_INDEX_HEADER_SIZE) /
+        sizeof(struct Pcap_Index_Entry))) ||
+      ((((uint64_t)status.st_size - PCAP_INDEX_HEADER_SIZE) %
+        sizeof(struct Pcap_Index_Entry)) != 0))
+  {
+    (void)munmap(data, (size_t)status.st_size);
+    return false;
+  }
+  (void)madvise(data, (size_t)status.st_size, MADV_RANDOM);
+  index->map = data;
+  index->map_size = (size_t)status.st_size;
+  index->entry = (const struct Pcap_Index_Entry *)
+    ((const uint8_t *)data + PCAP_INDEX_HEADER_SIZE);
+  index->count = (size_t)header.count;
+
+  return true;
+}
+
+// loads the index of the file, or builds it and tries to save it.
+// returns false if it can be neither loaded nor built.
+bool Pcap_Index_Open(
+  struct Pcap_Index *index,
+  struct Pcap_File *file,
+  const char *filename)
+{
+  if (Pcap_Index_Load(index, file, filename))
+    return true;
+  if (!Pcap_Index_Build(index, file))
+    return false;
+  // an index that cannot be saved is built again next time
+  (void)Pcap_Index_Save(index, file, filename);
+
+  return true;
+}
+
+// reads record number n, counted from 0.  returns false past the end.
+bool Pcap_Index_Record(
+  const struct Pcap_Index *index,
+  const struct Pcap_File *file,
+  size_t n,
+  struct Pcap_Record *record)
+{
+  const struct Pcap_Index_Entry *entry;
+  uint64_t offset;
+
+  if ((n >= index->count) || !file->data)
+    return false;
+  entry = &index->entry[n];
+  offset = entry->position & PCAP_INDEX_POSITION_MASK;
+  // an index file is not trusted to point inside the capture
+  if ((offset > file->size) || (entry->length > (file->size - offset)))
+    return false;
+  record->data = file->data + offset;
+  record->length = entry->length;
+  record->original_length = entry->original_length;
+  record->linktype = (uint32_t)(entry->position >> PCAP_INDEX_LINKTYPE_SHIFT);
+  record->timestamp = entry->timestamp;
+
+  return true;
+}
+
+// frees or unmaps the index
+void Pcap_Index_Free(struct Pcap_Index *index)
+{
+  if (index->map)
+    (void)munmap(index->map, index->map_size);
+  else
+    free((void *)index->entry);
+  index->entry = NULL;
+  index->count = 0;
+  index->map = NULL;
+  index->map_size = 0;
+
+  return;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "monotime.h"
+#include "ctest.h"
+
+// where the Wireshark capture files live, relative to code/
+#ifndef PCAP_CAPTURES_DIR
+#define PCAP_CAPTURES_DIR "../captures"
+#endif
+
+static const uint8_t Test_Packet[2][9] = {
+  {0x55, 0xFF, 0x00, 0x10, 0x05, 0x00, 0x00, 0x73, 0xAA},
+  {0x55, 0xFF, 0x01, 0x05, 0x10, 0x00, 0x00, 0x42}
+};
+static const uint32_t Test_Length[2] = {9, 8};
+
+static void test_put32(FILE *fp, uint32_t value, bool swap)
+{
+  if (swap)
+    value = swap32(value);
+  (void)fwrite(&value, sizeof(value), 1, fp);
+
+  return;
+}
+
+static void test_put16(FILE *fp, uint16_t value, bool swap)
+{
+  if (swap)
+    value = (uint16_t)((value << 8) | (value >> 8));
+  (void)fwrite(&value, sizeof(value), 1, fp);
+
+  return;
+}
+
+// writes the test packets as a classic pcap file
+static void test_write_pcap(const char *filename, bool swap, bool nanosecond)
+{
+  FILE *fp;
+  unsigned i;
+
+  fp = fopen(filename, "wb");
+  assert(fp);
+  test_put32(fp, nanosecond ? PCAP_MAGIC_NANOSECONDS :
+    PCAP_MAGIC_MICROSECONDS, swap);
+  test_put16(fp, 2, swap);
+  test_put16(fp, 4, swap);
+  test_put32(fp, 0, swap);
+  test_put32(fp, 0, swap);
+  test_put32(fp, 65535, swap);
+  test_put32(fp, PCAP_LINKTYPE_BACNET_MS_TP, swap);
+  for (i = 0; i < 2; i++)
+  {
+    test_put32(fp, 1000 + i, swap);
+    test_put32(fp, 500, swap);
+    test_put32(fp, Test_Length[i], swap);
+    test_put32(fp, Test_Length[i], swap);
+    (void)fwrite(Test_Packet[i], 1, Test_Length[i], fp);
+  }
+  fclose(fp);
+
+  return;
+}
+
+// writes the test packets as a pcapng file, with an unknown block,
+// a second interface using 2^-10 second timestamps, and a simple packet
+static void test_write_pcapng(const char *filename, bool swap)
+{
+  FILE *fp;
+  unsigned i;
+  uint32_t pad;
+  uint32_t zero = 0;
+
+  fp = fopen(filename, "wb");
+  assert(fp);
+  // section header
+  test_put32(fp, PCAPNG_SECTION_HEADER, swap);
+  test_put32(fp, 28, swap);
+  test_put32(fp, PCAPNG_BYTE_ORDER_MAGIC, swap);
+  test_put16(fp, 1, swap);
+  test_put16(fp, 0, swap);
+  test_put32(fp, 0xFFFFFFFFUL, swap);
+  test_put32(fp, 0xFFFFFFFFUL, swap);
+  test_put32(fp, 28, swap);
+  // interface 0 with the default microsecond resolution
+  test_put32(fp, PCAPNG_INTERFACE_DESCRIPTION, swap);
+  test_put32(fp, 20, swap);
+  test_put16(fp, PCAP_LINKTYPE_BACNET_MS_TP, swap);
+  test_put16(fp, 0, swap);
+  test_put32(fp, 0, swap);
+  test_put32(fp, 20, swap);
+  // interface 1 with if_tsresol of 2^-10
+  test_put32(fp, PCAPNG_INTERFACE_DESCRIPTION, swap);
+  test_put32(fp, 32, swap);
+  test_put16(fp, PCAP_LINKTYPE_ETHERNET, swap);
+  test_put16(fp, 0, swap);
+  test_put32(fp, 0, swap);
+  test_put16(fp, PCAPNG_OPTION_IF_TSRESOL, swap);
+  test_put16(fp, 1, swap);
+  test_put32(fp, 0x8A, false);
+  test_put32(fp, 0, swap);
+  test_put32(fp, 32, swap);
+  // an unknown block is skipped
+  test_put32(fp, 0x0BAD, swap);
+  test_put32(fp, 16, swap);
+  test_put32(fp, 0, swap);
+  test_put32(fp, 16, swap);
+  // enhanced packets, one on each interface
+  for (i = 0; i < 2; i++)
+  {
+    pad = (4 - (Test_Length[i] & 3)) & 3;
+    test_put32(fp, PCAPNG_ENHANCED_PACKET, swap);
+    test_put32(fp, 32 + Test_Length[i] + pad, swap);
+    test_put32(fp, i, swap);
+    if (i == 0)
+    {
+      // 1000.5 seconds in microseconds
+      test_put32(fp, 0, swap);
+      test_put32(fp, 1000500000UL, swap);
+    }
+    else
+    {
+      // 1000.5 seconds in 1/1024 seconds
+      test_put32(fp, 0, swap);
+      test_put32(fp, 1024512UL, swap);
+    }
+    test_put32(fp, Test_Length[i], swap);
+    test_put32(fp, Test_Length[i], swap);
+    (void)fwrite(Test_Packet[i], 1, Test_Length[i], fp);
+    (void)fwrite(&zero, 1, pad, fp);
+    test_put32(fp, 32 + Test_Length[i] + pad, swap);
+  }
+  // simple packet on interface 0
+  test_put32(fp, PCAPNG_SIMPLE_PACKET, swap);
+  test_put32(fp, 16 + 8, swap);
+  test_put32(fp, Test_Length[1], swap);
+  (void)fwrite(Test_Packet[1], 1, Test_Length[1], fp);
+  test_put32(fp, 16 + 8, swap);
+  fclose(fp);
+
+  return;
+}
+
+void testPcapClassic(Test* pTest)
+{
+  struct Pcap_File file;
+  struct Pcap_Record record;
+  char filename[] = "/tmp/pcapXXXXXX";
+  unsigned variant;
+  unsigned pass;
+  unsigned i;
+  int fd;
+  bool swap;
+  bool nanosecond;
+
+  fd = mkstemp(filename);
+  assert(fd >= 0);
+  close(fd);
+  for (variant = 0; variant < 4; variant++)
+  {
+    swap = (variant & 1);
+    nanosecond = (variant & 2);
+    test_write_pcap(filename, swap, nanosecond);
+    ct_test(pTest, Pcap_Open(&file, filename));
+    ct_test(pTest, !file.pcapng);
+    ct_test(pTest, file.swap == swap);
+    ct_test(pTest, file.linktype == PCAP_LINKTYPE_BACNET_MS_TP);
+    for (pass = 0; pass < 2; pass++)
+    {
+      for (i = 0; i < 2; i++)
+      {
+        ct_test(pTest, Pcap_Next(&file, &record));
+        ct_test(pTest, record.length == Test_Length[i]);
+        ct_test(pTest, record.original_length == Test_Length[i]);
+        ct_test(pTest, record.linktype == PCAP_LINKTYPE_BACNET_MS_TP);
+        ct_test(pTest,
+          memcmp(record.data, Test_Packet[i], Test_Length[i]) == 0);
+        ct_test(pTest, record.timestamp ==
+          ((1000 + i) * NANOSECONDS_PER_SECOND +
+            (nanosecond ? 500 : 500000)));
+      }
+      ct_test(pTest, !Pcap_Next(&file, &record));
+      Pcap_Rewind(&file);
+    }
+    Pcap_Close(&file);
+  }
+  // a truncated record ends the file
+  truncate(filename, PCAP_FILE_HEADER_SIZE + PCAP_RECORD_HEADER_SIZE + 4);
+  ct_test(pTest, Pcap_Open(&file, filename));
+  ct_test(pTest, !Pcap_Next(&file, &record));
+  Pcap_Close(&file);
+  // too short to be a capture
+  truncate(filename, 4);
+  ct_test(pTest, !Pcap_Open(&file, filename));
+  ct_test(pTest, file.fd == -1);
+  unlink(filename);
+  ct_test(pTest, !Pcap_Open(&file, filename));
+  // a closed file reads nothing
+  ct_test(pTest, !Pcap_Next(&file, &record));
+
+  return;
+}
+
+void testPcapNextGeneration(Test* pTest)
+{
+  struct Pcap_File file;
+  struct Pcap_Record record;
+  char filename[] = "/tmp/pcapngXXXXXX";
+  unsigned variant;
+  unsigned pass;
+  int fd;
+  bool swap;
+
+  fd = mkstemp(filename);
+  assert(fd >= 0);
+  close(fd);
+  for (variant = 0; variant < 2; variant++)
+  {
+    swap = variant;
+    test_write_pcapng(filename, swap);
+    ct_test(pTest, Pcap_Open(&file, filename));
+    ct_test(pTest, file.pcapng);
+    ct_test(pTest, file.swap == swap);
+    for (pass = 0; pass < 2; pass++)
+    {
+      ct_test(pTest, Pcap_Next(&file, &record));
+      ct_test(pTest, file.interfaces == 2);
+      ct_test(pTest, record.length == Test_Length[0]);
+      ct_test(pTest, record.linktype == PCAP_LINKTYPE_BACNET_MS_TP);
+      ct_test(pTest, memcmp(record.data, Test_Packet[0], Test_Length[0]) == 0);
+      ct_test(pTest, record.timestamp == 1000500000000ULL);
+      ct_test(pTest, Pcap_Next(&file, &record));
+      ct_test(pTest, record.length == Test_Length[1]);
+      ct_test(pTest, record.linktype == PCAP_LINKTYPE_ETHERNET);
+      ct_test(pTest, memcmp(record.data, Test_Packet[1], Test_Length[1]) == 0);
+      ct_test(pTest, record.timestamp == 1000500000000ULL);
+      ct_test(pTest, Pcap_Next(&file, &record));
+      ct_test(pTest, record.length == Test_Length[1]);
+      ct_test(pTest, record.linktype == PCAP_LINKTYPE_BACNET_MS_TP);
+      ct_test(pTest, memcmp(record.data, Test_Packet[1], Test_Length[1]) == 0);
+      ct_test(pTest, !Pcap_Next(&file, &record));
+      Pcap_Rewind(&file);
+    }
+    Pcap_Close(&file);
+  }
+  unlink(filename);
+
+  return;
+}
+
+// every MS/TP record in a real capture starts with the preamble
+void testPcapCapture(Test* pTest)
+{
+  struct Pcap_File file;
+  struct Pcap_Record record;
+  unsigned records = 0;
+
+  if (!Pcap_Open(&file, PCAP_CAPTURES_DIR "/mstp_wtap.cap"))
+  {
+    printf("pcap: %s not found, skipped\n",
+      PCAP_CAPTURES_DIR "/mstp_wtap.cap");
+    return;
+  }
+  ct_test(pTest, file.linktype == PCAP_LINKTYPE_BACNET_MS_TP);
+  while (Pcap_Next(&file, &record))
+  {
+    records++;
+    ct_test(pTest, record.length >= 2);
+    ct_test(pTest, (record.data[0] == 0x55) && (record.data[1] == 0xFF));
+  }
+  ct_test(pTest, records > 0);
+  ct_test(pTest, file.offset == file.size);
+  Pcap_Close(&file);
+
+  return;
+}
+
+// records written across many blocks read back as they were written,
+// cut to the snaplen, with their timestamps to the microsecond
+#define TEST_WRITER_RECORDS 50000
+
+void testPcapWriter(Test* pTest)
+{
+  static struct Pcap_Writer writer;
+  struct Pcap_File file;
+  struct Pcap_Record record;
+  char filename[] = "/tmp/pcapXXXXXX";
+  uint8_t data[600];
+  uint64_t timestamp;
+  uint32_t length;
+  unsigned long i;
+  int fd;
+
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (uint8_t)(i * 3);
+  fd = mkstemp(filename);
+  assert(fd >= 0);
+  close(fd);
+  ct_test(pTest, !Pcap_Writer_Open(&writer, filename,
+    PCAP_LINKTYPE_BACNET_MS_TP, 0));
+  ct_test(pTest, writer.fd == -1);
+  ct_test(pTest, !Pcap_Writer_Close(&writer));
+  ct_test(pTest, Pcap_Writer_Open(&writer, filename,
+    PCAP_LINKTYPE_BACNET_MS_TP, 512));
+  for (i = 0; i < TEST_WRITER_RECORDS; i++)
+  {
+    timestamp = (1000000000ULL + i) * NANOSECONDS_PER_SECOND + (i * 1001);
+    length = 8 + (i % sizeof(data));
+    ct_test(pTest, Pcap_Writer_Write(&writer, timestamp, &data[i % 7],
+      length - (i % 7 ? 7 : 0)));
+    if ((i % 10000) == 0)
+      ct_test(pTest, Pcap_Writer_Flush(&writer));
+  }
+  ct_test(pTest, writer.records == TEST_WRITER_RECORDS);
+  ct_test(pTest, writer.blocks > 2);
+  ct_test(pTest, Pcap_Writer_Close(&writer));
+  ct_test(pTest, Pcap_Open(&file, filename));
+  ct_test(pTest, !file.pcapng);
+  ct_test(pTest, !file.swap);
+  ct_test(pTest, !file.nanosecond);
+  ct_test(pTest, file.linktype == PCAP_LINKTYPE_BACNET_MS_TP);
+  for (i = 0; i < TEST_WRITER_RECORDS; i++)
+  {
+    if (!Pcap_Next(&file, &record))
+      break;
+    length = 8 + (i % sizeof(data)) - (i % 7 ? 7 : 0);
+    ct_test(pTest, record.original_length == length);
+    if (length > 512)
+      length = 512;
+    ct_test(pTest, record.length == length);
+    ct_test(pTest, memcmp(record.data, &data[i % 7], length) == 0);
+    ct_test(pTest, record.timestamp ==
+      ((1000000000ULL + i) * NANOSECONDS_PER_SECOND +
+        ((i * 1001) / 1000) * 1000));
+  }
+  ct_test(pTest, i == TEST_WRITER_RECORDS);
+  ct_test(pTest, !Pcap_Next(&file, &record));
+  Pcap_Close(&file);
+  // a file that cannot be created
+  ct_test(pTest, !Pcap_Writer_Open(&writer, "/nonexistent/x.pcap",
+    PCAP_LINKTYPE_BACNET_MS_TP, 512));
+  ct_test(pTest, !Pcap_Writer_Close(&writer));
+  unlink(filename);
+
+  return;
+}
+
+// the records read through an index are those read one after another,
+// and a saved index is loaded only for the capture it was saved for
+void testPcapIndex(Test* pTest)
+{
+  struct Pcap_File file;
+  struct Pcap_Record record;
+  struct Pcap_Record indexed;
+  struct Pcap_Index index;
+  struct Pcap_Index loaded;
+  char filename[] = "/tmp/pcapXXXXXX";
+  char index_name[64];
+  unsigned variant;
+  size_t n;
+  int fd;
+
+  ct_test(pTest, sizeof(struct Pcap_Index_Entry) == 24);
+  fd = mkstemp(filename);
+  assert(fd >= 0);
+  close(fd);
+  snprintf(index_name, sizeof(index_name), "%s.idx", filename);
+  for (variant = 0; variant < 4; variant++)
+  {
+    if (variant < 2)
+      test_write_pcap(filename, variant, true);
+    else
+      test_write_pcapng(filename, variant & 1);
+    ct_test(pTest, Pcap_Open(&file, filename));
+    ct_test(pTest, Pcap_Index_Build(&index, &file));
+    ct_test(pTest, index.count == ((variant < 2) ? 2 : 3));
+    ct_test(pTest, Pcap_Index_Save(&index, &file, index_name));
+    ct_test(pTest, Pcap_Index_Load(&loaded, &file, index_name));
+    ct_test(pTest, loaded.map != NULL);
+    ct_test(pTest, loaded.count == index.count);
+    // in order, as Pcap_Next reads them
+    for (n = 0; Pcap_Next(&file, &record); n++)
+    {
+      ct_test(pTest, Pcap_Index_Record(&loaded, &file, n, &indexed));
+      ct_test(pTest, indexed.data == record.data);
+      ct_test(pTest, indexed.length == record.length);
+      ct_test(pTest, indexed.original_length == record.original_length);
+      ct_test(pTest, indexed.linktype == record.linktype);
+      ct_test(pTest, indexed.timestamp == record.timestamp);
+    }
+    ct_test(pTest, n == index.count);
+    ct_test(pTest, !Pcap_Index_Record(&loaded, &file, n, &indexed));
+    // out of order
+    ct_test(pTest, Pcap_Index_Record(&index, &file, 1, &indexed));
+    ct_test(pTest, memcmp(indexed.data, Test_Packet[1], Test_Length[1]) == 0);
+    ct_test(pTest, Pcap_Index_Record(&index, &file, 0, &indexed));
+    ct_test(pTest, memcmp(indexed.data, Test_Packet[0], Test_Length[0]) == 0);
+    Pcap_Index_Free(&loaded);
+    Pcap_Index_Free(&index);
+    ct_test(pTest, index.entry == NULL);
+    Pcap_Close(&file);
+  }
+  // the capture changed since the index was saved
+  test_write_pcap(filename, false, false);
+  truncate(filename, PCAP_FILE_HEADER_SIZE + PCAP_RECORD_HEADER_SIZE + 9);
+  ct_test(pTest, Pcap_Open(&file, filename));
+  ct_test(pTest, !Pcap_Index_Load(&loaded, &file, index_name));
+  ct_test(pTest, Pcap_Index_Open(&index, &file, index_name));
+  ct_test(pTest, index.map == NULL);
+  ct_test(pTest, index.count == 1);
+  Pcap_Index_Free(&index);
+  // saved by the first open, mapped by the next
+  ct_test(pTest, Pcap_Index_Open(&index, &file, index_name));
+  ct_test(pTest, index.map != NULL);
+  ct_test(pTest, index.count == 1);
+  Pcap_Index_Free(&index);
+  // a partial index
+  truncate(index_name, 32 + 20);
+  ct_test(pTest, !Pcap_Index_Load(&loaded, &file, index_name));
+  unlink(index_name);
+  ct_test(pTest, !Pcap_Index_Load(&loaded, &file, index_name));
+  Pcap_Close(&file);
+  unlink(filename);
+
+  return;
+}
+
+#ifdef TEST_PCAP
+// microseconds to open the largest capture, build, save and load its
+// index, and nanoseconds to read a random record through the index and
+// by walking from the start
+static void benchmarkPcapIndex(void)
+{
+  const char *filename = PCAP_CAPTURES_DIR "/plugfest-delta-2.cap";
+  const char *index_name = "/tmp/pcap-benchmark.idx";
+  struct Pcap_File file;
+  struct Pcap_Record record;
+  struct Pcap_Index index;
+  double start, opened, built, saved, loaded, indexed, walked;
+  unsigned long sum = 0;
+  unsigned long rounds = 1000000;
+  unsigned long walks = 100;
+  unsigned long i;
+  size_t n, j;
+
+  start = OS_MonotonicSeconds();
+  if (!Pcap_Open(&file, filename))
+  {
+    printf("pcap: %s not found, skipped\n", filename);
+    return;
+  }
+  opened = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  (void)Pcap_Index_Build(&index, &file);
+  built = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  (void)Pcap_Index_Save(&index, &file, index_name);
+  saved = OS_MonotonicSeconds() - start;
+  Pcap_Index_Free(&index);
+  start = OS_MonotonicSeconds();
+  (void)Pcap_Index_Load(&index, &file, index_name);
+  loaded = OS_MonotonicSeconds() - start;
+  if (index.count == 0)
+  {
+    Pcap_Close(&file);
+    return;
+  }
+  n = 12345;
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < rounds; i++)
+  {
+    n = (n * 1103515245 + 12345) & 0x7FFFFFFF;
+    if (Pcap_Index_Record(&index, &file, n % index.count, &record))
+      sum += record.data[0];
+  }
+  indexed = OS_MonotonicSeconds() - start;
+  start = OS_MonotonicSeconds();
+  for (i = 0; i < walks; i++)
+  {
+    n = (n * 1103515245 + 12345) & 0x7FFFFFFF;
+    Pcap_Rewind(&file);
+    for (j = 0; j <= (n % index.count); j++)
+      (void)Pcap_Next(&file, &record);
+    sum += record.data[0];
+  }
+  walked = OS_MonotonicSeconds() - start;
+  printf("pcap index: %lu records in %lu octets, open %.0f us, "
+    "build %.0f us, save %.0f us, load %.0f us\n",
+    (unsigned long)index.count, (unsigned long)file.size, opened * 1.0e6,
+    built * 1.0e6, saved * 1.0e6, loaded * 1.0e6);
+  printf("pcap index: random record %.1f ns indexed, %.0f ns walked (%lu)\n",
+    (indexed * 1.0e9) / (double)rounds, (walked * 1.0e9) / (double)walks,
+    sum);
+  Pcap_Index_Free(&index);
+  Pcap_Close(&file);
+  unlink(index_name);
+
+  return;
+}
+
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("pcap", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testPcapClassic);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testPcapNextGeneration);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testPcapCapture);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testPcapWriter);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testPcapIndex);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  benchmarkPcapIndex();
+
+  return 0;
+}
+#endif /* TEST_PCAP */
+#endif /* TEST */
@@ -0,0 +1,223 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef PCAP_H
+#define PCAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// Reader for Wireshark capture files in the classic pcap format
+// and in the pcapng format.  The file is memory mapped and the
+// records are walked in place, so no memory is allocated per record.
+//
+// Index of the records of a file, for reading packet N at once.
+// Each entry holds what Pcap_Next decodes, so that a record of a
+// pcapng file needs none of the blocks before it.  An index can be
+// saved next to the capture and memory mapped when it is opened again.
+//
+// Writer for classic pcap files, such as a capture of a live trunk.
+// Records are appended to one of two large blocks while a thread
+// writes the other, so the caller never waits on the disk.
+
+// link types used in the captures
+#define PCAP_LINKTYPE_ETHERNET 1
+#define PCAP_LINKTYPE_ARCNET 7
+#define PCAP_LINKTYPE_LINUX_SLL 113
+#define PCAP_LINKTYPE_BACNET_MS_TP 165
+
+// number of pcapng interfaces tracked in one section
+#define PCAP_INTERFACES_MAX 16
+
+// one pcapng interface description
+struct Pcap_Interface
+{
+  uint32_t linktype;
+  uint32_t snaplen;
+  uint64_t units_per_second; // timestamp resolution
+};
+
+struct Pcap_File
+{
+  const uint8_t *data; // the mapped file
+  size_t size; // octets in the file
+  size_t offset; // offset of the next record or block
+  size_t first; // offset of the first record or block
+  int fd; // file descriptor of the mapped file
+  bool pcapng; // true if the file is pcapng, false if classic pcap
+  bool swap; // true if the file byte order is not the host order
+  uint32_t linktype; // classic pcap link type
+  bool nanosecond; // classic pcap timestamps are in nanoseconds
+  unsigned interfaces; // pcapng interfaces in the current section
+  struct Pcap_Interface interface[PCAP_INTERFACES_MAX];
+};
+
+// one packet - data points into the mapped file
+struct Pcap_Record
+{
+  const uint8_t *data; // the captured octets
+  uint32_t length; // number of captured octets
+  uint32_t original_length; // length of the packet on the wire
+  uint32_t linktype; // link type of the packet
+  uint64_t timestamp; // nanoseconds since 1970
+};
+
+// one record of an index, which is 24 octets in an index file
+struct Pcap_Index_Entry
+{
+  uint64_t position; // offset of the data, and the link type above bit 48
+  uint64_t timestamp; // nanoseconds since 1970
+  uint32_t length;
+  uint32_t original_length;
+};
+
+struct Pcap_Index
+{
+  const struct Pcap_Index_Entry *entry;
+  size_t count; // records in the file
+  void *map; // the mapped index file, or NULL if built in memory
+  size_t map_size;
+};
+
+// octets in each of the two blocks of a writer
+#define PCAP_WRITER_BLOCK_SIZE (256 * 1024)
+
+struct Pcap_Writer
+{
+  int fd; // the file being written, or -1
+  uint32_t snaplen; // records are cut to this many octets
+  // written only by the caller
+  uint8_t *block[2];
+  size_t length[2]; // octets in each block
+  unsigned fill; // the block that records are appended to
+  bool failed; // error, as of the last time the blocks changed places
+  // shared with the thread, under lock
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake; // a block is ready, or the writer is closing
+  pthread_cond_t idle; // the thread has written its block
+  bool busy; // the other block is being written
+  bool done; // Pcap_Writer_Close was called
+  bool error; // a write failed
+  // what has been written
+  unsigned long long records;
+  unsigned long long octets; // in the records, without their headers
+  unsigned long blocks; // handed to the thread
+  unsigned long waits; // times the caller waited for the thread
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// maps the file and reads its header.
+// returns false if the file cannot be read or is not a capture.
+bool Pcap_Open(struct Pcap_File *file, const char *filename);
+
+// unmaps the file
+void Pcap_Close(struct Pcap_File *file);
+
+// reads the next packet record.  returns false at the end of the file
+// or at a truncated or damaged record.
+bool Pcap_Next(struct Pcap_File *file, struct Pcap_Record *record);
+
+// starts reading again from the first record
+void Pcap_Rewind(struct Pcap_File *file);
+
+// walks the records of the file into an index in memory, and
+// rewinds the file.  returns false if there is no memory.
+bool Pcap_Index_Build(struct Pcap_Index *index, struct Pcap_File *file);
+
+// writes an index of the file.  returns false if it cannot be written.
+bool Pcap_Index_Save(
+  const struct Pcap_Index *index,
+  const struct Pcap_File *file,
+  const char *filename);
+
+// maps an index that was saved for the file.  returns false if it
+// cannot be read, or the file has changed since it was saved.
+bool Pcap_Index_Load(
+  struct Pcap_Index *index,
+  const struct Pcap_File *file,
+  const char *filename);
+
+// loads the index of the file, or builds it and tries to save it.
+// returns false if it can be neither loaded nor built.
+bool Pcap_Index_Open(
+  struct Pcap_Index *index,
+  struct Pcap_File *file,
+  const char *filename);
+
+// reads record number n, counted from 0.  returns false past the end.
+bool Pcap_Index_Record(
+  const struct Pcap_Index *index,
+  const struct Pcap_File *file,
+  size_t n,
+  struct Pcap_Record *record);
+
+// frees or unmaps the index
+void Pcap_Index_Free(struct Pcap_Index *index);
+
+// creates a classic pcap file with microsecond timestamps, and starts
+// the thread that writes it.  returns false if it cannot be created.
+bool Pcap_Writer_Open(
+  struct Pcap_Writer *writer,
+  const char *filename,
+  uint32_t linktype,
+  uint32_t snaplen);
+
+// appends a record with a timestamp in nanoseconds since 1970.
+// waits only if both blocks are full.  returns false once the write
+// of an earlier block has failed.
+bool Pcap_Writer_Write(
+  struct Pcap_Writer *writer,
+  uint64_t timestamp,
+  const uint8_t *data,
+  uint32_t length);
+
+// hands the records appended so far to the thread, such as once a
+// second so that little is lost if the process stops
+bool Pcap_Writer_Flush(struct Pcap_Writer *writer);
+
+// writes the rest of the records, stops the thread and closes the
+// file.  returns false if any write failed.
+bool Pcap_Writer_Close(struct Pcap_Writer *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
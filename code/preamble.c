@@ -0,0 +1,582 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// MS/TP Preamble Scanner
+//
+// On a noisy trunk most of what is received between frames is not a
+// frame at all, and a receiver that looks at one octet at a time
+// spends its time there.  Each vector engine compares a block of
+// octets with 0x55 and the same block, one octet further on, with
+// 0xFF; the lowest bit set in the AND of the two masks is the pair.
+// Four blocks are ORed together so that a step with no pair costs one
+// test.  The last octet of the buffer has no successor, so the vector
+// loops stop one octet early and the short tail is done bytewise.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#if defined(__SSE2__)
+#define PREAMBLE_SSE2
+#endif
+// built for AVX2 on demand and used only if the CPU has it
+#define PREAMBLE_AVX2
+#endif
+#include "preamble.h" // check for valid prototypes
+
+#define PREAMBLE1 0x55
+#define PREAMBLE2 0xFF
+
+// the pair at or after offset, one octet at a time
+static size_t preamble_bytewise(
+  const uint8_t *buffer,
+  size_t length,
+  size_t offset)
+{
+  for (; (offset + 1) < length; offset++)
+  {
+    if ((buffer[offset] == PREAMBLE1) && (buffer[offset + 1] == PREAMBLE2))
+      return offset;
+  }
+
+  return length;
+}
+
+// the pair at or after offset, by memchr for each 0x55
+static size_t preamble_memchr(
+  const uint8_t *buffer,
+  size_t length,
+  size_t offset)
+{
+  const uint8_t *preamble;
+
+  while ((offset + 1) < length)
+  {
+    preamble = memchr(&buffer[offset], PREAMBLE1, length - offset - 1);
+    if (preamble == NULL)
+      break;
+    offset = (size_t)(preamble - buffer);
+    if (buffer[offset + 1] == PREAMBLE2)
+      return offset;
+    offset++;
+  }
+
+  return length;
+}
+
+#if defined(PREAMBLE_SSE2)
+// the pairs that start in the 16 octets at offset, from the octets
+// and their successors
+#define PREAMBLE_SSE2_PAIRS(buffer,offset) _mm_and_si128( \
+  _mm_cmpeq_epi8(_mm_loadu_si128( \
+    (const __m128i *)&(buffer)[(offset)]), preamble1), \
+  _mm_cmpeq_epi8(_mm_loadu_si128( \
+    (const __m128i *)&(buffer)[(offset) + 1]), preamble2))
+
+// the pair at or after offset, 64 octets at a time, and then 16
+static size_t preamble_sse2(
+  const uint8_t *buffer,
+  size_t length,
+  size_t offset)
+{
+  const __m128i preamble1 = _mm_set1_epi8((char)PREAMBLE1);
+  const __m128i preamble2 = _mm_set1_epi8((char)PREAMBLE2);
+  __m128i pairs[4];
+  unsigned mask;
+  unsigned i;
+
+  // the next frame is often close
+  if ((offset + 17) <= length)
+  {
+    mask = (unsigned)_mm_movemask_epi8(PREAMBLE_SSE2_PAIRS(buffer, offset));
+    if (mask)
+      return offset + (size_t)__builtin_ctz(mask);
+    offset += 16;
+  }
+  for (; (offset + 65) <= length; offset += 64)
+  {
+    for (i = 0; i < 4; i++)
+      pairs[i] = PREAMBLE_SSE2_PAIRS(buffer, offset + (16 * i));
+    mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(
+      _mm_or_si128(pairs[0], pairs[1]), _mm_or_si128(pairs[2], pairs[3])));
+    if (mask == 0)
+      continue;
+    for (i = 0; i < 4; i++)
+    {
+      mask = (unsigned)_mm_movemask_epi8(pairs[i]);
+      if (mask)
+        return offset + (16 * i) + (size_t)__builtin_ctz(mask);
+    }
+  }
+  for (; (offset + 17) <= length; offset += 16)
+  {
+    mask = (unsigned)_mm_movemask_epi8(PREAMBLE_SSE2_PAIRS(buffer, offset));
+    if (mask)
+      return offset + (size_t)__builtin_ctz(mask);
+  }
+
+  return preamble_bytewise(buffer, length, offset);
+}
+#endif
+
+#if defined(PREAMBLE_AVX2)
+// the pairs that start in the 32 octets at offset, from the octets
+// and their successors
+#define PREAMBLE_AVX2_PAIRS(buffer,offset) _mm256_and_si256( \
+  _mm256_cmpeq_epi8(_mm256_loadu_si256( \
+    (const __m256i *)&(buffer)[(offset)]), preamble1), \
+  _mm256_cmpeq_epi8(_mm256_loadu_si256( \
+    (const __m256i *)&(buffer)[(offset) + 1]), preamble2))
+
+// the pair at or after offset, 128 octets at a time, and then 32
+__attribute__((target("avx2")))
+static size_t preamble_avx2(
+  const uint8_t *buffer,
+  size_t length,
+  size_t offset)
+{
+  const __m256i preamble1 = _mm256_set1_epi8((char)PREAMBLE1);
+  const __m256i preamble2 = _mm256_set1_epi8((char)PREAMBLE2);
+  __m256i pairs[4];
+  __m256i any;
+  unsigned mask;
+  unsigned i;
+
+  // the next frame is often close
+  if ((offset + 33) <= length)
+  {
+    mask = (unsigned)_mm256_movemask_epi8(PREAMBLE_AVX2_PAIRS(buffer, offset));
+    if (mask)
+      return offset + (size_t)__builtin_ctz(mask);
+    offset += 32;
+  }
+  for (; (offset + 129) <= length; offset += 128)
+  {
+    for (i = 0; i < 4; i++)
+      pairs[i] = PREAMBLE_AVX2_PAIRS(buffer, offset + (32 * i));
+    any = _mm256_or_si256(_mm256_or_si256(pairs[0], pairs[1]),
+      _mm256_or_si256(pairs[2], pairs[3]));
+    if (_mm256_testz_si256(any, any))
+      continue;
+    for (i = 0; i < 4; i++)
+    {
+      mask = (unsigned)_mm256_movemask_epi8(pairs[i]);
+      if (mask)
+        return offset + (32 * i) + (size_t)__builtin_ctz(mask);
+    }
+  }
+  for (; (offset + 33) <= length; offset += 32)
+  {
+    mask = (unsigned)_mm256_movemask_epi8(PREAMBLE_AVX2_PAIRS(buffer, offset));
+    if (mask)
+      return offset + (size_t)__builtin_ctz(mask);
+  }
+
+  return preamble_bytewise(buffer, length, offset);
+}
+#endif
+
+// the pair in the block, one octet at a time
+size_t Preamble_Find_Bytewise(const uint8_t *buffer, size_t length)
+{
+  return preamble_bytewise(buffer, length, 0);
+}
+
+// the pair in the block, by memchr for each 0x55
+size_t Preamble_Find_Memchr(const uint8_t *buffer, size_t length)
+{
+  return preamble_memchr(buffer, length, 0);
+}
+
+// the pair in the block, 16 octets at a time
+size_t Preamble_Find_SSE2(const uint8_t *buffer, size_t length)
+{
+#if defined(PREAMBLE_SSE2)
+  return preamble_sse2(buffer, length, 0);
+#else
+  return preamble_memchr(buffer, length, 0);
+#endif
+}
+
+// the pair in the block, 32 octets at a time
+size_t Preamble_Find_AVX2(const uint8_t *buffer, size_t length)
+{
+#if defined(PREAMBLE_AVX2)
+  if (__builtin_cpu_supports("avx2"))
+    return preamble_avx2(buffer, length, 0);
+#endif
+
+  return Preamble_Find_SSE2(buffer, length);
+}
+
+// true if the build and the CPU have the engine
+bool Preamble_Method_Available(PREAMBLE_METHOD method)
+{
+  switch (method)
+  {
+    case PREAMBLE_METHOD_SSE2:
+#if defined(PREAMBLE_SSE2)
+      return true;
+#else
+      return false;
+#endif
+    case PREAMBLE_METHOD_AVX2:
+#if defined(PREAMBLE_AVX2)
+      return __builtin_cpu_supports("avx2") ? true : false;
+#else
+      return false;
+#endif
+    default:
+      break;
+  }
+
+  return true;
+}
+
+// returns the offset of the 0x55 of the first 0x55 0xFF pair in the
+// block, or length if there is none
+size_t Preamble_Find(const uint8_t *buffer, size_t length)
+{
+  return Preamble_Find_AVX2(buffer, length);
+}
+
+PREAMBLE_ENGINE Preamble_Engine(PREAMBLE_METHOD method)
+{
+  switch (method)
+  {
+    case PREAMBLE_METHOD_BYTEWISE:
+      return Preamble_Find_Bytewise;
+    case PREAMBLE_METHOD_MEMCHR:
+      return Preamble_Find_Memchr;
+    case PREAMBLE_METHOD_SSE2:
+      return Preamble_Find_SSE2;
+    case PREAMBLE_METHOD_AVX2:
+    case PREAMBLE_METHOD_AUTO:
+    default:
+      break;
+  }
+  if (Preamble_Method_Available(PREAMBLE_METHOD_AVX2))
+    return Preamble_Find_AVX2;
+
+  return Preamble_Find_SSE2;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ctest.h"
+#include "pcap.h"
+
+// where the Wireshark capture files live, relative to code/
+#ifndef PREAMBLE_CAPTURES_DIR
+#define PREAMBLE_CAPTURES_DIR "../captures"
+#endif
+
+// the engines, for the tests and the benchmark
+static const struct
+{
+  const char *name;
+  PREAMBLE_METHOD method;
+  PREAMBLE_ENGINE engine;
+} Preamble_Engines[] =
+{
+  {"bytewise", PREAMBLE_METHOD_BYTEWISE, Preamble_Find_Bytewise},
+  {"memchr", PREAMBLE_METHOD_MEMCHR, Preamble_Find_Memchr},
+  {"sse2", PREAMBLE_METHOD_SSE2, Preamble_Find_SSE2},
+  {"avx2", PREAMBLE_METHOD_AVX2, Preamble_Find_AVX2},
+  {"auto", PREAMBLE_METHOD_AUTO, Preamble_Find}
+};
+#define PREAMBLE_ENGINES (sizeof(Preamble_Engines)/sizeof(Preamble_Engines[0]))
+
+// the pairs that every engine must find, and the ones it must not
+void testPreamble(Test* pTest)
+{
+  uint8_t buffer[80];
+  PREAMBLE_ENGINE engine;
+  unsigned i;
+
+  for (i = 0; i < PREAMBLE_ENGINES; i++)
+  {
+    memset(buffer, 0, sizeof(buffer));
+    ct_test(pTest, Preamble_Engines[i].engine(buffer, 0) == 0);
+    ct_test(pTest, Preamble_Engines[i].engine(buffer, 1) == 1);
+    ct_test(pTest, Preamble_Engines[i].engine(buffer, sizeof(buffer)) ==
+      sizeof(buffer));
+    // a lone 0x55 at the end is not yet a pair
+    buffer[sizeof(buffer) - 1] = 0x55;
+    ct_test(pTest, Preamble_Engines[i].engine(buffer, sizeof(buffer)) ==
+      sizeof(buffer));
+    // the pair at the very end, across the last vector step
+    buffer[sizeof(buffer) - 2] = 0x55;
+    buffer[sizeof(buffer) - 1] = 0xFF;
+    ct_test(pTest, Preamble_Engines[i].engine(buffer, sizeof(buffer)) ==
+      sizeof(buffer) - 2);
+    // the 0xFF is only looked at after a 0x55
+    buffer[31] = 0x55;
+    buffer[32] = 0xFF;
+    buffer[15] = 0xFF;
+    buffer[16] = 0x55;
+    ct_test(pTest, Preamble_Engines[i].engine(buffer, sizeof(buffer)) == 31);
+    // a repeated 0x55 before the 0xFF
+    buffer[29] = 0x55;
+    buffer[30] = 0x55;
+    ct_test(pTest, Preamble_Engines[i].engine(buffer, sizeof(buffer)) == 31);
+    ct_test(pTest, Preamble_Engines[i].engine(&buffer[16], 16) == 16);
+    ct_test(pTest, Preamble_Engines[i].engine(&buffer[16], 17) == 15);
+  }
+  for (i = 0; i < PREAMBLE_ENGINES; i++)
+  {
+    engine = Preamble_Engine(Preamble_Engines[i].method);
+    ct_test(pTest, engine(buffer, sizeof(buffer)) == 31);
+  }
+  ct_test(pTest, Preamble_Find(buffer, sizeof(buffer)) == 31);
+  ct_test(pTest, Preamble_Method_Available(PREAMBLE_METHOD_BYTEWISE));
+  ct_test(pTest, Preamble_Method_Available(PREAMBLE_METHOD_MEMCHR));
+
+  return;
+}
+
+// every engine agrees with the bytewise one on random blocks, at
+// every length and alignment, with few and with many preamble octets
+void testPreambleRandom(Test* pTest)
+{
+  static uint8_t buffer[512 + 32];
+  size_t expected;
+  unsigned length;
+  unsigned offset;
+  unsigned density;
+  unsigned errors = 0;
+  unsigned i;
+
+  srand(1);
+  for (density = 2; density <= 64; density *= 2)
+  {
+    for (i = 0; i < sizeof(buffer); i++)
+    {
+      buffer[i] = (uint8_t)rand();
+      if ((rand() % density) == 0)
+        buffer[i] = (rand() & 1) ? 0x55 : 0xFF;
+    }
+    for (offset = 0; offset < 32; offset++)
+    {
+      for (length = 0; length <= 512; length++)
+      {
+        expected = Preamble_Find_Bytewise(&buffer[offset], length);
+        for (i = 1; i < PREAMBLE_ENGINES; i++)
+        {
+          if (Preamble_Engines[i].engine(&buffer[offset], length) !=
+              expected)
+            errors++;
+        }
+      }
+    }
+  }
+  ct_test(pTest, errors == 0);
+
+  return;
+}
+
+// The MS/TP records of a capture, one after another.  A capture from
+// a U+4 adapter wraps each frame in an Ethernet LLC/SNAP header with
+// the Cimetrics OUI and three octets of its own, and leaves out the
+// preamble, which is put back.  A record whose wrapper is damaged is
+// taken whole, as line noise.
+static size_t benchmark_capture(
+  const char *filename,
+  uint8_t *buffer,
+  size_t size)
+{
+  static const uint8_t snap[] =
+    {0xAA, 0xAA, 0x03, 0x00, 0x10, 0x90, 0x00, 0x01};
+  struct Pcap_File file;
+  struct Pcap_Record record;
+  const uint8_t *data;
+  size_t length = 0;
+  size_t count;
+  size_t skip = 14 + sizeof(snap) + 3;
+
+  if (!Pcap_Open(&file, filename))
+    return 0;
+  while (Pcap_Next(&file, &record))
+  {
+    data = record.data;
+    count = record.length;
+    if (record.linktype == PCAP_LINKTYPE_ETHERNET)
+    {
+      if ((count > skip) && (memcmp(&data[14], snap, sizeof(snap)) == 0) &&
+          ((length + 2) <= size))
+      {
+        buffer[length++] = 0x55;
+        buffer[length++] = 0xFF;
+        data += skip;
+        count -= skip;
+      }
+    }
+    else if (record.linktype != PCAP_LINKTYPE_BACNET_MS_TP)
+      continue;
+    if ((length + count) > size)
+      break;
+    memcpy(&buffer[length], data, count);
+    length += count;
+  }
+  Pcap_Close(&file);
+
+  return length;
+}
+
+// time one engine finding every pair in the stream.  the best of a
+// few runs is kept, since a shared machine is seldom quiet.
+#define BENCHMARK_RUNS 5
+
+static void benchmark_engine(
+  const char *name,
+  size_t (*engine)(const uint8_t *, size_t),
+  const uint8_t *buffer,
+  size_t length)
+{
+  unsigned long iterations = 40000000UL / (length + 1) + 1;
+  unsigned long pairs = 0;
+  unsigned long i;
+  unsigned run;
+  size_t offset;
+  clock_t start;
+  double seconds;
+  double best = 0.0;
+
+  for (run = 0; run < BENCHMARK_RUNS; run++)
+  {
+    pairs = 0;
+    start = clock();
+    for (i = 0; i < iterations; i++)
+    {
+      offset = 0;
+      for (;;)
+      {
+        offset += engine(&buffer[offset], length - offset);
+        if (offset >= length)
+          break;
+        pairs++;
+        offset += 2;
+      }
+    }
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if ((run == 0) || (seconds < best))
+      best = seconds;
+  }
+  if (best <= 0.0)
+    best = 1.0 / CLOCKS_PER_SEC;
+  printf("preamble: %-9s %8.1f MB/s %10lu pairs\n", name,
+    ((double)length * iterations) / (best * 1000000.0),
+    pairs / iterations);
+
+  return;
+}
+
+// finds every frame in the malformed captures, and in noise,
+// with each engine
+void benchmarkPreamble(void)
+{
+  static const char *captures[] =
+  {
+    PREAMBLE_CAPTURES_DIR "/MSTP_Malformed_Packets.pcap",
+    PREAMBLE_CAPTURES_DIR "/mstp_mix_basrt_V124_bad.cap"
+  };
+  static uint8_t buffer[1 << 20];
+  size_t length;
+  unsigned i, j;
+
+  // line noise with no frames in it at all
+  srand(1);
+  for (length = 0; length < 4096; length++)
+  {
+    buffer[length] = (uint8_t)rand();
+    if ((buffer[length] == 0xFF) && length && (buffer[length - 1] == 0x55))
+      buffer[length] = 0;
+  }
+  printf("preamble: random noise, %u octets\n", (unsigned)length);
+  for (j = 0; j < PREAMBLE_ENGINES; j++)
+  {
+    if (Preamble_Method_Available(Preamble_Engines[j].method))
+      benchmark_engine(Preamble_Engines[j].name,
+        Preamble_Engines[j].engine, buffer, length);
+  }
+  for (i = 0; i < sizeof(captures)/sizeof(captures[0]); i++)
+  {
+    length = benchmark_capture(captures[i], buffer, sizeof(buffer));
+    if (length == 0)
+      continue;
+    printf("preamble: %s, %u octets\n", captures[i], (unsigned)length);
+    for (j = 0; j < PREAMBLE_ENGINES; j++)
+    {
+      if (Preamble_Method_Available(Preamble_Engines[j].method))
+        benchmark_engine(Preamble_Engines[j].name,
+          Preamble_Engines[j].engine, buffer, length);
+    }
+  }
+
+  return;
+}
+
+#ifdef TEST_PREAMBLE
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("preamble", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testPreamble);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testPreambleRandom);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  benchmarkPreamble();
+
+  return 0;
+}
+#endif /* TEST_PREAMBLE */
+#endif /* TEST */
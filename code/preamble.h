@@ -0,0 +1,89 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef PREAMBLE_H
+#define PREAMBLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Finds the preamble of the next MS/TP frame, 0x55 followed by 0xFF,
+// in a block of received octets.  The receive state machine reaches
+// the HEADER state at the first such pair, so the octets before it can
+// be skipped in one step.  The vector engines compare 16 or 32 octets
+// and their successors at a time.
+
+// engine of a preamble search
+typedef enum
+{
+  PREAMBLE_METHOD_AUTO, // the fastest engine that the CPU has
+  PREAMBLE_METHOD_BYTEWISE, // one octet at a time
+  PREAMBLE_METHOD_MEMCHR, // memchr for 0x55, then check the next octet
+  PREAMBLE_METHOD_SSE2, // 16 octets per step
+  PREAMBLE_METHOD_AVX2 // 32 octets per step
+} PREAMBLE_METHOD;
+
+// a preamble search routine
+typedef size_t (*PREAMBLE_ENGINE)(const uint8_t *buffer, size_t length);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// returns the offset of the 0x55 of the first 0x55 0xFF pair in the
+// block, or length if there is none
+size_t Preamble_Find(const uint8_t *buffer, size_t length);
+
+// the individual engines - for testing and benchmarks.
+// an engine that the build or the CPU does not have uses the next
+// simpler one.
+size_t Preamble_Find_Bytewise(const uint8_t *buffer, size_t length);
+size_t Preamble_Find_Memchr(const uint8_t *buffer, size_t length);
+size_t Preamble_Find_SSE2(const uint8_t *buffer, size_t length);
+size_t Preamble_Find_AVX2(const uint8_t *buffer, size_t length);
+
+// true if the build and the CPU have the engine
+bool Preamble_Method_Available(PREAMBLE_METHOD method);
+
+// returns the routine of a method, to be looked up once by a caller
+// such as MSTP_Init.  PREAMBLE_METHOD_AUTO is resolved to the fastest
+// engine that the CPU has.
+PREAMBLE_ENGINE Preamble_Engine(PREAMBLE_METHOD method);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
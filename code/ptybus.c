@@ -0,0 +1,683 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// Pseudo Terminal Bus
+//
+// The thread of the bus waits in ppoll() for octets from any node, or
+// for the next millisecond of octets on the wire.  What a node sends
+// is on the wire from when the wire is next free, for ten bit times
+// an octet, and every other node gets the octets that have ended once
+// a millisecond, as if from the FIFO of a UART.  A node that sends
+// while the wire is taken collides with the node on the wire: what
+// is left of both is garbled.  One that starts within 40 bit times of the end of another
+// has not waited out its turnaround, and is counted.
+
+// for posix_openpt, ptsname_r and ppoll
+#define _GNU_SOURCE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "mstp.h"
+#include "monotime.h"
+#include "rs485.h"
+#include "ptybus.h" // check for valid prototypes
+
+// how long the bus sleeps with nothing on the wire, in nanoseconds,
+// so that it sees PTY_Bus_Stop
+#define PTY_BUS_IDLE_WAIT 10000000ULL
+// how often the octets that have ended are given to the nodes
+#define PTY_BUS_SLICE 1000000ULL
+
+// opens a pseudo terminal as the bus and the node each see it
+static bool pty_bus_pair(struct PTY_Bus *bus, unsigned i)
+{
+  struct termios tio;
+
+  bus->master[i] = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (bus->master[i] < 0)
+    return false;
+  if ((grantpt(bus->master[i]) != 0) || (unlockpt(bus->master[i]) != 0) ||
+      (ptsname_r(bus->master[i], bus->name[i], sizeof(bus->name[i])) != 0))
+    return false;
+  bus->slave[i] = open(bus->name[i], O_RDWR | O_NOCTTY);
+  if (bus->slave[i] < 0)
+    return false;
+  // nothing is echoed or changed, even before the node opens it
+  if (tcgetattr(bus->slave[i], &tio) == 0)
+  {
+    cfmakeraw(&tio);
+    (void)tcsetattr(bus->slave[i], TCSANOW, &tio);
+  }
+
+  return true;
+}
+
+bool PTY_Bus_Open(
+  struct PTY_Bus *bus,
+  unsigned count,
+  unsigned baud)
+{
+  const struct MSTP_Timing *timing = MSTP_Timing_Find(baud);
+  unsigned i;
+
+  memset(bus, 0, sizeof(struct PTY_Bus));
+  for (i = 0; i < PTY_BUS_PORTS_MAX; i++)
+  {
+    bus->master[i] = -1;
+    bus->slave[i] = -1;
+  }
+  if ((count < 2) || (count > PTY_BUS_PORTS_MAX) || !timing)
+    return false;
+  bus->count = count;
+  bus->baud = baud;
+  // the times the ports use at the same rate
+  bus->octet_time = timing->Toctet;
+  bus->turnaround = timing->Tturnaround;
+  for (i = 0; i < count; i++)
+  {
+    if (!pty_bus_pair(bus, i))
+    {
+      PTY_Bus_Close(bus);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// puts the octets that a node sent on the wire after what is there
+static void pty_bus_send(
+  struct PTY_Bus *bus,
+  struct PTY_Bus_Chunk *chunk,
+  uint64_t now)
+{
+  uint64_t start = now;
+  unsigned i, j;
+
+  if (now < bus->busy_until)
+  {
+    start = bus->busy_until;
+    // Collision - what is still on the wire is garbled, and so is
+    // what was sent over it
+    if (chunk->source != bus->talker)
+    {
+      bus->collisions++;
+      for (i = bus->head; i != bus->tail; i = (i + 1) % PTY_BUS_CHUNKS)
+      {
+        for (j = bus->chunk[i].sent; j < bus->chunk[i].length; j++)
+          bus->chunk[i].octets[j] ^= 0xA5;
+      }
+      for (j = 0; j < chunk->length; j++)
+        chunk->octets[j] ^= 0xA5;
+    }
+  }
+  else if ((chunk->source != bus->talker) && bus->octets &&
+      ((now - bus->busy_until) < bus->turnaround))
+    bus->turnarounds++;
+  chunk->start = start;
+  chunk->sent = 0;
+  chunk->release = start + (chunk->length * bus->octet_time);
+  bus->busy_until = chunk->release;
+  bus->talker = chunk->source;
+  bus->busy += chunk->length * bus->octet_time;
+  bus->octets += chunk->length;
+  bus->tail = (bus->tail + 1) % PTY_BUS_CHUNKS;
+
+  return;
+}
+
+// gives the octets on the wire that have ended to the other nodes
+static void pty_bus_release(struct PTY_Bus *bus, uint64_t now)
+{
+  struct PTY_Bus_Chunk *chunk;
+  unsigned ended;
+  unsigned count;
+  ssize_t written;
+  unsigned i;
+
+  while (bus->head != bus->tail)
+  {
+    chunk = &bus->chunk[bus->head];
+    if (now >= chunk->release)
+      ended = chunk->length;
+    else if (now > chunk->start)
+      ended = (unsigned)((now - chunk->start) / bus->octet_time);
+    else
+      ended = 0;
+    if (ended > chunk->sent)
+    {
+      count = ended - chunk->sent;
+      for (i = 0; i < bus->count; i++)
+      {
+        if (i == chunk->source)
+          continue;
+        written = write(bus->master[i], &chunk->octets[chunk->sent], count);
+        if (written < (ssize_t)count)
+          bus->overruns += count - ((written > 0) ? written : 0);
+      }
+      chunk->sent = ended;
+    }
+    if (chunk->sent < chunk->length)
+      break;
+    bus->head = (bus->head + 1) % PTY_BUS_CHUNKS;
+  }
+
+  return;
+}
+
+static void *pty_bus_thread(void *arg)
+{
+  struct PTY_Bus *bus = arg;
+  struct pollfd pfd[PTY_BUS_PORTS_MAX];
+  struct PTY_Bus_Chunk *chunk;
+  struct timespec wait;
+  uint64_t now;
+  uint64_t delay;
+  unsigned i;
+  ssize_t received;
+
+  for (i = 0; i < bus->count; i++)
+  {
+    pfd[i].fd = bus->master[i];
+    pfd[i].events = POLLIN;
+  }
+  while (!__atomic_load_n(&bus->stop, __ATOMIC_ACQUIRE))
+  {
+    now = OS_MonotonicNanosecs();
+    pty_bus_release(bus, now);
+    delay = PTY_BUS_IDLE_WAIT;
+    if (bus->head != bus->tail)
+    {
+      delay = PTY_BUS_SLICE;
+      if ((bus->chunk[bus->head].release - now) < delay)
+        delay = bus->chunk[bus->head].release - now;
+    }
+    wait.tv_sec = 0;
+    wait.tv_nsec = (long)delay;
+    if (ppoll(pfd, bus->count, &wait, NULL) <= 0)
+      continue;
+    now = OS_MonotonicNanosecs();
+    for (i = 0; i < bus->count; i++)
+    {
+      if (!(pfd[i].revents & POLLIN))
+        continue;
+      // the wire is full - leave it in the pseudo terminal for now
+      if (((bus->tail + 1) % PTY_BUS_CHUNKS) == bus->head)
+        break;
+      chunk = &bus->chunk[bus->tail];
+      received = read(bus->master[i], chunk->octets, sizeof(chunk->octets));
+      if (received > 0)
+      {
+        chunk->source = i;
+        chunk->length = (unsigned)received;
+        pty_bus_send(bus, chunk, now);
+      }
+    }
+  }
+
+  return NULL;
+}
+
+bool PTY_Bus_Start(struct PTY_Bus *bus)
+{
+  bus->stop = 0;
+
+  return pthread_create(&bus->thread, NULL, pty_bus_thread, bus) == 0;
+}
+
+void PTY_Bus_Stop(struct PTY_Bus *bus)
+{
+  __atomic_store_n(&bus->stop, 1, __ATOMIC_RELEASE);
+  pthread_join(bus->thread, NULL);
+
+  return;
+}
+
+void PTY_Bus_Close(struct PTY_Bus *bus)
+{
+  unsigned i;
+
+  for (i = 0; i < PTY_BUS_PORTS_MAX; i++)
+  {
+    if (bus->slave[i] >= 0)
+      (void)close(bus->slave[i]);
+    if (bus->master[i] >= 0)
+      (void)close(bus->master[i]);
+    bus->slave[i] = -1;
+    bus->master[i] = -1;
+  }
+
+  return;
+}
+
+void PTY_Bus_Send_Frame(
+  struct MSTP_Port *port,
+  const struct MSTP_Frame_Part *part,
+  unsigned count)
+{
+  struct RS485_Port *rs485 = port->Context;
+  unsigned long long octets = 0;
+  struct timespec delay;
+  uint64_t now;
+  unsigned i;
+
+  RS485_MSTP_Send_Frame(port, part, count);
+  for (i = 0; i < count; i++)
+    octets += part[i].length;
+  octets *= port->Timing->Toctet;
+  delay.tv_sec = (time_t)(octets / 1000000000ULL);
+  delay.tv_nsec = (long)(octets % 1000000000ULL);
+  while ((nanosleep(&delay, &delay) != 0) && (errno == EINTR))
+  {
+    // sleep for the rest
+  }
+  // as RS485_MSTP_Send_Frame does once the frame has drained
+  now = OS_MonotonicNanosecs();
+  MSTP_Timer_Elapsed(port, (unsigned)((now - rs485->clock) / 1000000ULL));
+  rs485->clock = now;
+
+  return;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+
+#include "mstpq.h"
+#include "mstpstat.h"
+#include "testio.h"
+#include "ctest.h"
+
+// octets go to every other node after their time on the wire,
+// and two nodes that send at once collide
+void testPtyBus(Test* pTest)
+{
+  static struct PTY_Bus bus;
+  struct RS485_Port node[3];
+  UINT8 frame[MAX_FRAME_SIZE];
+  UINT8 other[MAX_FRAME_SIZE];
+  UINT8 data[100];
+  UINT8 buffer[2 * MAX_FRAME_SIZE];
+  struct pollfd pfd;
+  uint64_t start;
+  unsigned length, length2;
+  unsigned i;
+
+  if (!PTY_Bus_Open(&bus, 3, 9600))
+  {
+    printf("ptybus: no pseudo terminals, skipped\n");
+    return;
+  }
+  for (i = 0; i < 3; i++)
+    ct_test(pTest, RS485_Open(&node[i], bus.name[i], 9600));
+  ct_test(pTest, PTY_Bus_Start(&bus));
+  length = MSTP_Create_Frame(frame, sizeof(frame), FRAME_TYPE_TOKEN,
+    1, 0, NULL, 0);
+  start = OS_MonotonicNanosecs();
+  ct_test(pTest, write(node[0].fd, frame, length) == (ssize_t)length);
+  ct_test(pTest, Test_Read(node[1].fd, buffer, length) == length);
+  // eight octets at 9600 baud
+  ct_test(pTest, (OS_MonotonicNanosecs() - start) >= (8 * bus.octet_time));
+  ct_test(pTest, memcmp(buffer, frame, length) == 0);
+  ct_test(pTest, Test_Read(node[2].fd, buffer, length) == length);
+  ct_test(pTest, memcmp(buffer, frame, length) == 0);
+  pfd.fd = node[0].fd;
+  pfd.events = POLLIN;
+  ct_test(pTest, poll(&pfd, 1, 50) == 0);
+
+  // the second frame starts while the first is on the wire
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (UINT8)i;
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 2, 0, data, sizeof(data));
+  length2 = MSTP_Create_Frame(other, sizeof(other),
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 2, 1, data, 10);
+  ct_test(pTest, write(node[0].fd, frame, length) == (ssize_t)length);
+  usleep(10000);
+  ct_test(pTest, write(node[1].fd, other, length2) == (ssize_t)length2);
+  ct_test(pTest, Test_Read(node[2].fd, buffer, length + length2) ==
+    (length + length2));
+  ct_test(pTest, memcmp(buffer, frame, length) != 0);
+  ct_test(pTest, memcmp(&buffer[length], other, length2) != 0);
+  PTY_Bus_Stop(&bus);
+  ct_test(pTest, bus.collisions == 1);
+  ct_test(pTest, bus.octets == (8 + length + length2));
+  ct_test(pTest, bus.overruns == 0);
+  for (i = 0; i < 3; i++)
+    RS485_Close(&node[i]);
+  PTY_Bus_Close(&bus);
+
+  return;
+}
+
+// one master node with its own thread, as if it were its own device
+struct test_node
+{
+  struct MSTP_Port port;
+  struct RS485_Port rs485;
+  struct MSTP_Queue queue;
+  struct MSTP_Queue_Frame queued[MSTP_QUEUE_LANES * 4];
+  UINT8 next; // where its data frames go
+  unsigned data_len; // octets in each, or zero for none
+  pthread_t thread;
+};
+
+static int Test_Stop;
+
+static void *test_node_thread(void *arg)
+{
+  struct test_node *node = arg;
+  struct MSTP_Port *ports[1];
+  UINT8 data[INPUT_BUFFER_SIZE];
+
+  memset(data, 0x3C, sizeof(data));
+  ports[0] = &node->port;
+  while (!__atomic_load_n(&Test_Stop, __ATOMIC_ACQUIRE))
+  {
+    // a data frame is always waiting for the token
+    while (node->data_len && (MSTP_Queue_Count(&node->queue) < 2) &&
+        MSTP_Queue_Put(&node->queue, FALSE,
+          FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, node->next, data,
+          node->data_len))
+    {
+      // queued
+    }
+    (void)RS485_MSTP_Poll(ports, 1, 10);
+  }
+
+  return NULL;
+}
+
+struct test_result
+{
+  double seconds;
+  unsigned long frames; // sent by all of the nodes
+  unsigned long data_frames;
+  unsigned long errors; // CRC errors received
+  unsigned long aborts; // frames received with a gap of Tframe_abort
+  struct MSTP_Histogram rotation; // of all of the nodes
+  double cpu_max; // seconds of the busiest node
+  double cpu_sum; // of all of the nodes
+  double cpu_bus; // of the thread of the bus
+  double busy; // fraction of the time that the wire was busy
+  unsigned long collisions;
+  unsigned long turnarounds;
+};
+
+static double test_thread_cpu(pthread_t thread)
+{
+  struct timespec now;
+  clockid_t clock;
+
+  if ((pthread_getcpuclockid(thread, &clock) != 0) ||
+      (clock_gettime(clock, &now) != 0))
+    return 0.0;
+
+  return (double)now.tv_sec + ((double)now.tv_nsec / 1000000000.0);
+}
+
+static void test_sleep(unsigned milliseconds)
+{
+  struct timespec delay;
+
+  delay.tv_sec = milliseconds / 1000;
+  delay.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+  while ((nanosleep(&delay, &delay) != 0) && (errno == EINTR))
+  {
+    // sleep for the rest
+  }
+
+  return;
+}
+
+// runs masters on a bus for warmup milliseconds so that the token is
+// passed, and measures them for duration milliseconds more
+static bool test_run(
+  unsigned masters,
+  unsigned baud,
+  unsigned data_len,
+  unsigned warmup,
+  unsigned duration,
+  struct test_result *result)
+{
+  static struct PTY_Bus bus;
+  static struct test_node node[PTY_BUS_PORTS_MAX];
+  static struct MSTP_Stats before[PTY_BUS_PORTS_MAX];
+  struct MSTP_Stats after;
+  double cpu[PTY_BUS_PORTS_MAX + 1];
+  uint64_t busy = 0;
+  uint64_t start = 0;
+  unsigned long collisions = 0, turnarounds = 0;
+  unsigned i, j;
+
+  memset(result, 0, sizeof(struct test_result));
+  if (!PTY_Bus_Open(&bus, masters, baud))
+    return false;
+  for (i = 0; i < masters; i++)
+  {
+    if (!RS485_Open(&node[i].rs485, bus.name[i], baud))
+      return false;
+    MSTP_Init(&node[i].port, (UINT8)i);
+    (void)MSTP_Timing_Set(&node[i].port, baud);
+    node[i].port.Nmax_master = (UINT8)(masters - 1);
+    node[i].port.Send_Frame = PTY_Bus_Send_Frame;
+    node[i].port.Context = &node[i].rs485;
+    (void)MSTP_Queue_Init(&node[i].queue, node[i].queued, 4);
+    node[i].port.Queue = &node[i].queue;
+    node[i].next = (UINT8)((i + 1) % masters);
+    node[i].data_len = data_len;
+  }
+  Test_Stop = 0;
+  (void)PTY_Bus_Start(&bus);
+  for (i = 0; i < masters; i++)
+    (void)pthread_create(&node[i].thread, NULL, test_node_thread, &node[i]);
+  test_sleep(warmup);
+  for (i = 0; i < masters; i++)
+  {
+    MSTP_Stats_Read(&node[i].port.Stats, &before[i]);
+    cpu[i] = test_thread_cpu(node[i].thread);
+  }
+  cpu[masters] = test_thread_cpu(bus.thread);
+  // the counts of the bus are only read once it stops, so the time
+  // on the wire is taken from the nodes' octets instead
+  start = OS_MonotonicNanosecs();
+  test_sleep(duration);
+  result->seconds = (double)(OS_MonotonicNanosecs() - start) / 1000000000.0;
+  for (i = 0; i < masters; i++)
+  {
+    MSTP_Stats_Read(&node[i].port.Stats, &after);
+    cpu[i] = test_thread_cpu(node[i].thread) - cpu[i];
+    result->cpu_sum += cpu[i];
+    if (cpu[i] > result->cpu_max)
+      result->cpu_max = cpu[i];
+    for (j = 0; j < MSTP_STATS_FRAME_TYPES; j++)
+      result->frames += after.frames_sent[j] - before[i].frames_sent[j];
+    result->data_frames +=
+      after.frames_sent[FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY] -
+      before[i].frames_sent[FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY];
+    result->errors += (after.header_crc_errors + after.data_crc_errors) -
+      (before[i].header_crc_errors + before[i].data_crc_errors);
+    result->aborts += after.frame_aborts - before[i].frame_aborts;
+    busy += (after.octets_sent - before[i].octets_sent) * bus.octet_time;
+    result->rotation.count +=
+      after.token_rotation.count - before[i].token_rotation.count;
+    result->rotation.sum +=
+      after.token_rotation.sum - before[i].token_rotation.sum;
+    if (after.token_rotation.max > result->rotation.max)
+      result->rotation.max = after.token_rotation.max;
+    for (j = 0; j < MSTP_HISTOGRAM_BUCKETS; j++)
+      result->rotation.bucket[j] += after.token_rotation.bucket[j] -
+        before[i].token_rotation.bucket[j];
+  }
+  result->cpu_bus = test_thread_cpu(bus.thread) - cpu[masters];
+  result->busy = ((double)busy / 1000000000.0) / result->seconds;
+  __atomic_store_n(&Test_Stop, 1, __ATOMIC_RELEASE);
+  for (i = 0; i < masters; i++)
+    pthread_join(node[i].thread, NULL);
+  PTY_Bus_Stop(&bus);
+  collisions = bus.collisions;
+  turnarounds = bus.turnarounds;
+  result->collisions = collisions;
+  result->turnarounds = turnarounds;
+  for (i = 0; i < masters; i++)
+    RS485_Close(&node[i].rs485);
+  PTY_Bus_Close(&bus);
+
+  return true;
+}
+
+// the token goes around three masters, and their data with it
+void testPtyBusMSTP(Test* pTest)
+{
+  struct test_result result;
+
+  if (!test_run(3, 115200, 50, 1500, 1000, &result))
+  {
+    printf("ptybus: no pseudo terminals, skipped\n");
+    return;
+  }
+  ct_test(pTest, result.rotation.count > 10);
+  ct_test(pTest, result.data_frames > 10);
+  // a thread of a busy machine may miss a deadline now and then
+  ct_test(pTest, (result.errors + result.aborts + result.collisions) <
+    (result.frames / 10));
+  ct_test(pTest, result.turnarounds == 0);
+
+  return;
+}
+
+static void benchmark_header(void)
+{
+  printf("ptybus: masters   baud data  frames/s  data/s busy%% "
+    "rotation ms mean/p99   CPU/port ms/s max  bus ms/s  "
+    "crc/abort/collision/turnaround\n");
+
+  return;
+}
+
+static void benchmark_run(
+  unsigned masters,
+  unsigned baud,
+  unsigned data_len,
+  unsigned seconds)
+{
+  struct test_result result;
+
+  if (!test_run(masters, baud, data_len, 1500, seconds * 1000, &result))
+  {
+    printf("ptybus: no pseudo terminals, skipped\n");
+    return;
+  }
+  printf("ptybus: %7u %6u %4u %9.0f %7.0f %5.1f %8.1f %8lu %10.2f %6.2f "
+    "%9.2f  %lu/%lu/%lu/%lu\n",
+    masters, baud, data_len, result.frames / result.seconds,
+    result.data_frames / result.seconds, result.busy * 100.0,
+    result.rotation.count ?
+      (double)result.rotation.sum / result.rotation.count : 0.0,
+    MSTP_Histogram_Percentile(&result.rotation, 99.0),
+    (result.cpu_sum * 1000.0) / (masters * result.seconds),
+    (result.cpu_max * 1000.0) / result.seconds,
+    (result.cpu_bus * 1000.0) / result.seconds,
+    result.errors, result.aborts, result.collisions, result.turnarounds);
+
+  return;
+}
+
+// masters passing the token and sending a data frame with each,
+// through pseudo terminals paced at the baud rate
+void benchmarkPtyBus(void)
+{
+  static const unsigned masters[] = {2, 4, 8};
+  static const unsigned bauds[] = {38400, 115200};
+  unsigned i, j;
+
+  benchmark_header();
+  for (j = 0; j < sizeof(bauds)/sizeof(bauds[0]); j++)
+  {
+    for (i = 0; i < sizeof(masters)/sizeof(masters[0]); i++)
+      benchmark_run(masters[i], bauds[j], 50, 2);
+  }
+
+  return;
+}
+
+#ifdef TEST_PTYBUS
+// runs the tests and the benchmark, or with arguments, one benchmark:
+// ptybus masters baud data_len seconds
+int main(int argc, char *argv[])
+{
+  Test *pTest;
+  bool rc;
+
+  if (argc > 1)
+  {
+    benchmark_header();
+    benchmark_run((unsigned)atoi(argv[1]),
+      (argc > 2) ? (unsigned)atoi(argv[2]) : 115200,
+      (argc > 3) ? (unsigned)atoi(argv[3]) : 50,
+      (argc > 4) ? (unsigned)atoi(argv[4]) : 2);
+    return 0;
+  }
+  pTest = ct_create("ptybus", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testPtyBus);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testPtyBusMSTP);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  benchmarkPtyBus();
+
+  return 0;
+}
+#endif /* TEST_PTYBUS */
+#endif /* TEST */
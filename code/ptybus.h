@@ -0,0 +1,125 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef PTYBUS_H
+#define PTYBUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "mstp.h"
+
+// An EIA-485 bus made of pseudo terminals, so that MS/TP nodes can be
+// run with RS485_Open and RS485_MSTP_Poll on a machine with no serial
+// ports.  Each node opens the slave side of its own pseudo terminal.
+// A thread reads what each node sends from the master side, holds it
+// for as long as it would take on the wire at the baud rate, and
+// writes it to every other node as its octets end, a millisecond's
+// worth at a time.  Octets that a node sends while
+// another is still sending collide, and are garbled for every node.
+
+// the most nodes on one bus
+#define PTY_BUS_PORTS_MAX 64
+// octets read from a node at once, and chunks on the wire at once
+#define PTY_BUS_CHUNK_SIZE 512
+#define PTY_BUS_CHUNKS 64
+
+// octets from one node, on the wire from start until release
+struct PTY_Bus_Chunk
+{
+  uint64_t start; // CLOCK_MONOTONIC nanoseconds when the first octet starts
+  uint64_t release; // when the last octet ends
+  unsigned source; // the node that sent them
+  unsigned length;
+  unsigned sent; // octets that the other nodes have been given
+  uint8_t octets[PTY_BUS_CHUNK_SIZE];
+};
+
+struct PTY_Bus
+{
+  unsigned count; // nodes
+  unsigned baud;
+  uint64_t octet_time; // nanoseconds for one octet, 10 bit times
+  uint64_t turnaround; // nanoseconds, 40 bit times
+  int master[PTY_BUS_PORTS_MAX]; // the side the bus reads and writes
+  int slave[PTY_BUS_PORTS_MAX]; // held open so that the masters never hang up
+  char name[PTY_BUS_PORTS_MAX][64]; // of the slave side, for RS485_Open
+  // written only by the thread of the bus
+  struct PTY_Bus_Chunk chunk[PTY_BUS_CHUNKS];
+  unsigned head; // next chunk to release
+  unsigned tail; // next free chunk
+  uint64_t busy_until; // when the wire is next idle
+  unsigned talker; // the node that sent last
+  pthread_t thread;
+  int stop;
+  // what has been on the bus, to be read once the bus has stopped
+  unsigned long long octets;
+  uint64_t busy; // nanoseconds that octets were on the wire
+  unsigned long collisions; // a node started while another was sending
+  unsigned long turnarounds; // a node started within 40 bit times
+  unsigned long overruns; // octets lost as a node did not read them
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// creates the pseudo terminals of a bus of count nodes.
+// returns false if they cannot be created, or MSTP_Timing_Find
+// does not know the baud rate.
+bool PTY_Bus_Open(
+  struct PTY_Bus *bus,
+  unsigned count,
+  unsigned baud);
+
+// starts and stops the thread that carries the octets between nodes
+bool PTY_Bus_Start(struct PTY_Bus *bus);
+void PTY_Bus_Stop(struct PTY_Bus *bus);
+
+void PTY_Bus_Close(struct PTY_Bus *bus);
+
+// the Send_Frame of an MSTP_Port whose Context is an RS485_Port on the
+// bus.  A pseudo terminal drains at once, so after sending the frame
+// it sleeps for as long as the frame takes on the wire, as tcdrain()
+// would on a UART.
+void PTY_Bus_Send_Frame(
+  struct MSTP_Port *port,
+  const struct MSTP_Frame_Part *part,
+  unsigned count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
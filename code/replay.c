@@ -0,0 +1,418 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// Capture Replay
+//
+// Feeds the MS/TP records of a Wireshark capture into the block
+// receive path, MSTP_Receive_Octets, one record at a time.  The gap
+// between the record timestamps is given to the port as silence so
+// that the frame abort timeout works as it did on the wire.
+// Each indicated frame is counted and its flag is cleared, as the
+// Master Node State Machine would do.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mstp.h"
+#include "monotime.h"
+#include "pcap.h"
+#include "replay.h" // check for valid prototypes
+
+// the silence timer saturates rather than wrapping on long gaps
+#define REPLAY_SILENCE_MAX 255
+
+// counts a frame that the receive path indicated.
+// state is the receive state before the call and used is the number of
+// octets consumed by it, which tell a timeout from a CRC error.
+static void replay_count(
+  struct MSTP_Port *port,
+  struct MSTP_Replay_Stats *stats,
+  MSTP_RECEIVE_STATE state,
+  unsigned used)
+{
+  if (port->ReceivedValidFrame)
+  {
+    stats->frames_valid++;
+    stats->frame_type[port->FrameType]++;
+  }
+  else
+  {
+    stats->frames_invalid++;
+    // Timeout - the silence ended the frame before any octet was used
+    if ((used == 0) &&
+        ((state == MSTP_RECEIVE_STATE_HEADER) ||
+         (state == MSTP_RECEIVE_STATE_DATA)))
+      stats->other_errors++;
+    else if (port->HeaderCRC != 0x55)
+      stats->header_crc_errors++;
+    // FrameTooLong
+    else if (port->DataLength > MSTP_LENGTH_MAX(port->FrameType))
+      stats->other_errors++;
+    else
+      stats->data_crc_errors++;
+  }
+  port->ReceivedValidFrame = FALSE;
+  port->ReceivedInvalidFrame = FALSE;
+
+  return;
+}
+
+// replays every MS/TP record of an open capture file,
+// adding to the counts in stats
+void MSTP_Replay(
+  struct MSTP_Port *port,
+  struct Pcap_File *file,
+  struct MSTP_Replay_Stats *stats)
+{
+  struct Pcap_Record record;
+  const UINT8 *data;
+  unsigned remaining;
+  unsigned used;
+  MSTP_RECEIVE_STATE state;
+  uint64_t last = 0; // timestamp of the previous record
+  uint64_t gap;
+  bool first = true;
+  double start;
+
+  start = OS_MonotonicSeconds();
+  while (Pcap_Next(file, &record))
+  {
+    if (record.linktype != PCAP_LINKTYPE_BACNET_MS_TP)
+    {
+      stats->skipped++;
+      continue;
+    }
+    stats->records++;
+    stats->octets += record.length;
+    // the silence before this record, in milliseconds
+    if (first || (record.timestamp < last))
+      gap = first ? REPLAY_SILENCE_MAX : 0;
+    else
+      gap = (record.timestamp - last) / 1000000;
+    port->SilenceTimer = (gap > REPLAY_SILENCE_MAX) ?
+      REPLAY_SILENCE_MAX : (unsigned)gap;
+    last = record.timestamp;
+    first = false;
+    data = record.data;
+    remaining = record.length;
+    // keep going after the last octet so that a frame which ends
+    // the record is validated
+    for (;;)
+    {
+      state = port->Receive_State;
+      used = MSTP_Receive_Octets(port, data, remaining);
+      data += used;
+      remaining -= used;
+      if (port->ReceivedValidFrame || port->ReceivedInvalidFrame)
+        replay_count(port, stats, state, used);
+      else if (remaining == 0)
+        break;
+    }
+  }
+  stats->seconds += OS_MonotonicSeconds() - start;
+
+  return;
+}
+
+// opens, replays and closes a capture file.
+// returns false if the file cannot be read.
+bool MSTP_Replay_File(
+  struct MSTP_Port *port,
+  const char *filename,
+  struct MSTP_Replay_Stats *stats)
+{
+  struct Pcap_File file;
+
+  if (!Pcap_Open(&file, filename))
+    return false;
+  MSTP_Replay(port, &file, stats);
+  Pcap_Close(&file);
+
+  return true;
+}
+
+static const char *replay_frame_name(unsigned frame_type)
+{
+  switch (frame_type)
+  {
+    case FRAME_TYPE_TOKEN:
+      return "Token";
+    case FRAME_TYPE_POLL_FOR_MASTER:
+      return "Poll For Master";
+    case FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER:
+      return "Reply To Poll For Master";
+    case FRAME_TYPE_TEST_REQUEST:
+      return "Test Request";
+    case FRAME_TYPE_TEST_RESPONSE:
+      return "Test Response";
+    case FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY:
+      return "BACnet Data Expecting Reply";
+    case FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY:
+      return "BACnet Data Not Expecting Reply";
+    case FRAME_TYPE_REPLY_POSTPONED:
+      return "Reply Postponed";
+    default:
+      break;
+  }
+  if (frame_type >= FRAME_TYPE_PROPRIETARY_MIN)
+    return "Proprietary";
+
+  return "Reserved";
+}
+
+// prints the counts and the frame rate
+void MSTP_Replay_Report(
+  FILE *stream,
+  const struct MSTP_Replay_Stats *stats)
+{
+  unsigned long frames = stats->frames_valid + stats->frames_invalid;
+  double seconds = stats->seconds;
+  unsigned i;
+
+  if (seconds <= 0.0)
+    seconds = 1.0e-9;
+  fprintf(stream, "records: %lu MS/TP, %lu other link types skipped\n",
+    stats->records, stats->skipped);
+  fprintf(stream, "frames: %lu valid, %lu invalid\n",
+    stats->frames_valid, stats->frames_invalid);
+  fprintf(stream, "errors: %lu header CRC, %lu data CRC, %lu other\n",
+    stats->header_crc_errors, stats->data_crc_errors, stats->other_errors);
+  for (i = 0; i < 256; i++)
+  {
+    if (stats->frame_type[i])
+      fprintf(stream, "  %3u %-32s %lu\n", i, replay_frame_name(i),
+        stats->frame_type[i]);
+  }
+  fprintf(stream, "time: %llu octets in %.6f s, %.0f frames/s, %.1f MB/s\n",
+    stats->octets, stats->seconds, frames / seconds,
+    stats->octets / (seconds * 1000000.0));
+
+  return;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "crc.h"
+#include "ctest.h"
+
+// where the Wireshark capture files live, relative to code/
+#ifndef REPLAY_CAPTURES_DIR
+#define REPLAY_CAPTURES_DIR "../captures"
+#endif
+
+// writes one record, timestamped in milliseconds
+static void test_record(
+  struct Pcap_Writer *writer,
+  unsigned milliseconds,
+  const UINT8 *data,
+  unsigned length)
+{
+  (void)Pcap_Writer_Write(writer, (uint64_t)milliseconds * 1000000ULL,
+    data, length);
+
+  return;
+}
+
+// writes a capture with a known mix of good and bad frames
+static void test_write_capture(const char *filename)
+{
+  static struct Pcap_Writer writer;
+  UINT8 frame[INPUT_BUFFER_SIZE + 8];
+  UINT8 data[10] = {1, 4, 0, 5, 1, 12, 12, 0, 0, 0};
+  unsigned length;
+  unsigned length2;
+  unsigned ms = 0;
+
+  assert(Pcap_Writer_Open(&writer, filename,
+    PCAP_LINKTYPE_BACNET_MS_TP, 65535));
+  // valid token for station 5
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_TOKEN, 5, 16, NULL, 0);
+  test_record(&writer, ms += 10, frame, length);
+  // valid data for station 32
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 32, 16, data, sizeof(data));
+  test_record(&writer, ms += 10, frame, length);
+  // header CRC error
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_TOKEN, 5, 16, NULL, 0);
+  frame[7] ^= 0x01;
+  test_record(&writer, ms += 10, frame, length);
+  // data CRC error for station 5
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY, 5, 16, data, sizeof(data));
+  frame[length - 1] ^= 0x80;
+  test_record(&writer, ms += 10, frame, length);
+  // data for station 32 that is cut short, then times out
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 32, 16, data, sizeof(data));
+  test_record(&writer, ms += 10, frame, 8 + 3);
+  ms += 100;
+  // a header for station 5 with a data length that is too long
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 5, 16, NULL, 0);
+  frame[5] = (INPUT_BUFFER_SIZE + 1) >> 8;
+  frame[6] = (INPUT_BUFFER_SIZE + 1) & 0xFF;
+  frame[7] = ~CRC_Header_Block(&frame[2], 5, 0xFF);
+  test_record(&writer, ms += 10, frame, length);
+  // poll for master and its reply in one record
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_POLL_FOR_MASTER, 7, 5, NULL, 0);
+  length2 = MSTP_Create_Frame(&frame[length], sizeof(frame) - length,
+    FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER, 5, 7, NULL, 0);
+  test_record(&writer, ms += 10, frame, length + length2);
+  assert(Pcap_Writer_Close(&writer));
+
+  return;
+}
+
+void testReplayCounts(Test* pTest)
+{
+  struct MSTP_Port port;
+  struct MSTP_Replay_Stats stats;
+  char filename[] = "/tmp/replayXXXXXX";
+  int fd;
+
+  fd = mkstemp(filename);
+  assert(fd >= 0);
+  close(fd);
+  test_write_capture(filename);
+
+  // a bus monitor sees every frame
+  MSTP_Init(&port, 5);
+  port.Promiscuous = TRUE;
+  memset(&stats, 0, sizeof(stats));
+  ct_test(pTest, MSTP_Replay_File(&port, filename, &stats));
+  ct_test(pTest, stats.records == 7);
+  ct_test(pTest, stats.skipped == 0);
+  ct_test(pTest, stats.frames_valid == 4);
+  ct_test(pTest, stats.frames_invalid == 4);
+  ct_test(pTest, stats.header_crc_errors == 1);
+  ct_test(pTest, stats.data_crc_errors == 1);
+  ct_test(pTest, stats.other_errors == 2);
+  ct_test(pTest, stats.frame_type[FRAME_TYPE_TOKEN] == 1);
+  ct_test(pTest, stats.frame_type[FRAME_TYPE_POLL_FOR_MASTER] == 1);
+  ct_test(pTest, stats.frame_type[FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER] == 1);
+  ct_test(pTest,
+    stats.frame_type[FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY] == 1);
+  ct_test(pTest, port.Receive_State == MSTP_RECEIVE_STATE_IDLE);
+  ct_test(pTest, !port.ReceivedValidFrame && !port.ReceivedInvalidFrame);
+
+  // station 5 only sees its own frames, but every header CRC error
+  MSTP_Init(&port, 5);
+  memset(&stats, 0, sizeof(stats));
+  ct_test(pTest, MSTP_Replay_File(&port, filename, &stats));
+  ct_test(pTest, stats.frames_valid == 2);
+  ct_test(pTest, stats.header_crc_errors == 1);
+  ct_test(pTest, stats.data_crc_errors == 1);
+  ct_test(pTest, stats.other_errors == 1);
+  ct_test(pTest, stats.frame_type[FRAME_TYPE_TOKEN] == 1);
+  ct_test(pTest, stats.frame_type[FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER] == 1);
+
+  unlink(filename);
+  ct_test(pTest, !MSTP_Replay_File(&port, filename, &stats));
+
+  return;
+}
+
+#ifdef TEST_REPLAY
+// replays the files given on the command line,
+// or every capture in the captures directory
+int main(int argc, char *argv[])
+{
+  Test *pTest;
+  bool rc;
+  struct MSTP_Port port;
+  struct MSTP_Replay_Stats stats;
+  DIR *dir;
+  struct dirent *entry;
+  char filename[1024];
+  unsigned files = 0;
+  int i;
+
+  pTest = ct_create("replay", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testReplayCounts);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  MSTP_Init(&port, 0);
+  port.Promiscuous = TRUE;
+  memset(&stats, 0, sizeof(stats));
+  if (argc > 1)
+  {
+    for (i = 1; i < argc; i++)
+    {
+      if (MSTP_Replay_File(&port, argv[i], &stats))
+        files++;
+      else
+        fprintf(stderr, "replay: unable to read %s\n", argv[i]);
+    }
+  }
+  else
+  {
+    dir = opendir(REPLAY_CAPTURES_DIR);
+    while (dir && ((entry = readdir(dir)) != NULL))
+    {
+      if (entry->d_name[0] == '.')
+        continue;
+      snprintf(filename, sizeof(filename), "%s/%s",
+        REPLAY_CAPTURES_DIR, entry->d_name);
+      if (MSTP_Replay_File(&port, filename, &stats))
+        files++;
+    }
+    if (dir)
+      closedir(dir);
+  }
+  printf("replay: %u capture files\n", files);
+  MSTP_Replay_Report(stdout, &stats);
+
+  return 0;
+}
+#endif /* TEST_REPLAY */
+#endif /* TEST */
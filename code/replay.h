@@ -0,0 +1,86 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+#include "mstp.h"
+#include "pcap.h"
+
+// Replays the MS/TP frames of a capture file through the receive
+// path of a port, as fast as it can, and counts what was received.
+
+struct MSTP_Replay_Stats
+{
+  unsigned long records; // MS/TP records replayed
+  unsigned long skipped; // records of other link types
+  unsigned long long octets; // octets received
+  unsigned long frames_valid;
+  unsigned long frames_invalid;
+  unsigned long header_crc_errors;
+  unsigned long data_crc_errors;
+  unsigned long other_errors; // timeouts and frames too long
+  unsigned long frame_type[256]; // valid frames of each type
+  double seconds; // time spent replaying
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// replays every MS/TP record of an open capture file,
+// adding to the counts in stats
+void MSTP_Replay(
+  struct MSTP_Port *port,
+  struct Pcap_File *file,
+  struct MSTP_Replay_Stats *stats);
+
+// opens, replays and closes a capture file.
+// returns false if the file cannot be read.
+bool MSTP_Replay_File(
+  struct MSTP_Port *port,
+  const char *filename,
+  struct MSTP_Replay_Stats *stats);
+
+// prints the counts and the frame rate
+void MSTP_Replay_Report(
+  FILE *stream,
+  const struct MSTP_Replay_Stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,853 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2004 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// Functional Description:  
+// Generic ring buffer implementation.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "ringbuf.h"
+
+/****************************************************************************
+* DESCRIPTION: Returns the empty/full status of the ring buffer
+* RETURN:      TRUE if the ring buffer is empty, FALSE if it is not.
+* ALGORITHM:   none
+* NOTES:       none
+*****************************************************************************/
+bool Ringbuf_Empty(RING_BUFFER const *b)
+{
+  return (b->count == 0);
+}
+
+/****************************************************************************
+* DESCRIPTION: Looks at the data from the head of the list without removing it
+* RETURN:      none
+* ALGORITHM:   none
+* NOTES:       none
+*****************************************************************************/
+char *Ringbuf_Get_Front(RING_BUFFER const *b)
+{
+  return (b->count ? &(b->data[b->head * b->element_size]) : NULL);
+}
+
+/****************************************************************************
+* DESCRIPTION: Gets the data from the front of the list, and removes it
+* RETURN:      none
+* ALGORITHM:   none
+* NOTES:       none
+*****************************************************************************/
+char *Ringbuf_Pop_Front(RING_BUFFER *b)
+{
+  char *data = NULL; // return value
+
+  if (b->count)
+  {
+    data = &(b->data[b->head * b->element_size]);
+    b->head++;
+    if (b->head >= b->element_count)
+      b->head = 0;
+    b->count--;
+  }
+
+  return data;
+}
+
+/****************************************************************************
+* DESCRIPTION: Adds an element of data to the ring buffer
+* RETURN:      TRUE on succesful add, FALSE if not added
+* ALGORITHM:   none
+* NOTES:       none
+*****************************************************************************/
+bool Ringbuf_Put(
+  RING_BUFFER *b, // ring buffer structure
+  char *data_element) // one element to add to the ring
+{
+  bool status = FALSE; // return value
+  unsigned offset = 0; // offset into array of data - head + count
+                       // can be more than 255
+  char *ring_data = NULL; // used to help point ring data
+  uint8_t i; // loop counter
+
+  if (b && data_element)
+  {
+    // limit the amount of data that we accept
+    if (b->count < b->element_count)
+    {
+      offset = b->head + b->count;
+      if (offset >= b->element_count)
+        offset -= b->element_count;
+      ring_data = b->data + offset * b->element_size;
+      for(i = 0; i < b->element_size; i++)
+      {
+        ring_data[i] = data_element[i];
+      }
+      b->count++;
+      status = TRUE;
+    }
+  }
+
+  return status;
+}
+
+/****************************************************************************
+* DESCRIPTION: Configures the ring buffer
+* RETURN:      none
+* ALGORITHM:   none
+* NOTES:       none
+*****************************************************************************/
+void Ringbuf_Init(
+  RING_BUFFER *b, // ring buffer structure
+  char *data, // data block or array of data
+  uint8_t element_size, // size of one element in the data block
+  uint8_t element_count) // number of elements in the data block
+{
+  b->head = 0;
+  b->count = 0;
+  b->data = data;
+  b->element_size = element_size;
+  b->element_count = element_count;
+
+  return;
+}
+
+// The producer owns tail and the consumer owns head.  An entry is
+// written before tail is released past it, and read before head is
+// released past it, so the acquire on the other side's index is all
+// the synchronization that is needed.
+#if defined(__GNUC__)
+#define RING_LOAD(index) __atomic_load_n(&(index), __ATOMIC_RELAXED)
+#define RING_ACQUIRE(index) __atomic_load_n(&(index), __ATOMIC_ACQUIRE)
+#define RING_RELEASE(index,value) \
+  __atomic_store_n(&(index), (value), __ATOMIC_RELEASE)
+#elif (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define RING_LOAD(index) \
+  atomic_load_explicit((_Atomic uint32_t *)&(index), memory_order_relaxed)
+#define RING_ACQUIRE(index) \
+  atomic_load_explicit((_Atomic uint32_t *)&(index), memory_order_acquire)
+#define RING_RELEASE(index,value) \
+  atomic_store_explicit((_Atomic uint32_t *)&(index), (value), \
+    memory_order_release)
+#else
+#error "the SPSC ring needs GNU __atomic builtins or C11 <stdatomic.h>"
+#endif
+
+/****************************************************************************
+* DESCRIPTION: Configures the single producer, single consumer ring
+* RETURN:      TRUE if configured, FALSE if size is not a power of two
+* ALGORITHM:   none
+* NOTES:       call before the producer and consumer are started
+*****************************************************************************/
+bool Ringbuf_SPSC_Init(
+  SPSC_RING *r, // ring structure
+  uint16_t *data, // array of entries
+  uint32_t size) // number of entries in the array
+{
+  if (!r || !data || !size || (size & (size - 1)))
+    return FALSE;
+  r->tail = 0;
+  r->head_cache = 0;
+  r->head = 0;
+  r->tail_cache = 0;
+  r->data = data;
+  r->mask = size - 1;
+
+  return TRUE;
+}
+
+/****************************************************************************
+* DESCRIPTION: Number of entries waiting in the ring
+* RETURN:      number of entries
+* ALGORITHM:   none
+* NOTES:       exact for the consumer, a snapshot for anyone else
+*****************************************************************************/
+unsigned Ringbuf_SPSC_Count(SPSC_RING *r)
+{
+  return RING_ACQUIRE(r->tail) - RING_LOAD(r->head);
+}
+
+/****************************************************************************
+* DESCRIPTION: Adds up to count entries to the ring
+* RETURN:      number of entries added
+* ALGORITHM:   the copy wraps around the end of the array at most once
+* NOTES:       producer only
+*****************************************************************************/
+unsigned Ringbuf_SPSC_Put_Block(
+  SPSC_RING *r,
+  const uint16_t *entries,
+  unsigned count)
+{
+  uint32_t tail = RING_LOAD(r->tail);
+  uint32_t space = r->mask + 1 - (tail - r->head_cache);
+  uint32_t offset = tail & r->mask;
+  uint32_t first = 0; // entries before the end of the array
+
+  if (space < count)
+  {
+    r->head_cache = RING_ACQUIRE(r->head);
+    space = r->mask + 1 - (tail - r->head_cache);
+    if (space < count)
+      count = space;
+  }
+  if (count)
+  {
+    first = r->mask + 1 - offset;
+    if (first > count)
+      first = count;
+    memcpy(&r->data[offset], entries, first * sizeof(uint16_t));
+    memcpy(r->data, &entries[first], (count - first) * sizeof(uint16_t));
+    RING_RELEASE(r->tail, tail + count);
+  }
+
+  return count;
+}
+
+/****************************************************************************
+* DESCRIPTION: Adds one entry to the ring
+* RETURN:      TRUE if added, FALSE if the ring is full
+* ALGORITHM:   none
+* NOTES:       producer only
+*****************************************************************************/
+bool Ringbuf_SPSC_Put(SPSC_RING *r, uint16_t entry)
+{
+  uint32_t tail = RING_LOAD(r->tail);
+
+  if ((tail - r->head_cache) > r->mask)
+  {
+    r->head_cache = RING_ACQUIRE(r->head);
+    if ((tail - r->head_cache) > r->mask)
+      return FALSE;
+  }
+  r->data[tail & r->mask] = entry;
+  RING_RELEASE(r->tail, tail + 1);
+
+  return TRUE;
+}
+
+/****************************************************************************
+* DESCRIPTION: Points to the entries that can be read without a copy
+* RETURN:      number of entries, up to the end of the array
+* ALGORITHM:   none
+* NOTES:       consumer only - follow with Ringbuf_SPSC_Consume
+*****************************************************************************/
+unsigned Ringbuf_SPSC_Peek(SPSC_RING *r, const uint16_t **entries)
+{
+  uint32_t head = RING_LOAD(r->head);
+  uint32_t offset = head & r->mask;
+  uint32_t count = r->tail_cache - head;
+  uint32_t room = r->mask + 1 - offset; // entries before the end
+
+  if (count < room)
+  {
+    r->tail_cache = RING_ACQUIRE(r->tail);
+    count = r->tail_cache - head;
+  }
+  if (count > room)
+    count = room;
+  *entries = &r->data[offset];
+
+  return count;
+}
+
+/****************************************************************************
+* DESCRIPTION: Releases entries that were read in place
+* RETURN:      none
+* ALGORITHM:   none
+* NOTES:       consumer only - count must not be more than was peeked
+*****************************************************************************/
+void Ringbuf_SPSC_Consume(SPSC_RING *r, unsigned count)
+{
+  if (count)
+    RING_RELEASE(r->head, RING_LOAD(r->head) + count);
+
+  return;
+}
+
+/****************************************************************************
+* DESCRIPTION: Gets up to count entries from the ring
+* RETURN:      number of entries
+* ALGORITHM:   two peeks to follow the ring around the end of the array
+* NOTES:       consumer only
+*****************************************************************************/
+unsigned Ringbuf_SPSC_Get_Block(
+  SPSC_RING *r,
+  uint16_t *entries,
+  unsigned count)
+{
+  const uint16_t *data = NULL;
+  unsigned total = 0; // return value
+  unsigned available = 0;
+
+  while (total < count)
+  {
+    available = Ringbuf_SPSC_Peek(r, &data);
+    if (!available)
+      break;
+    if (available > count - total)
+      available = count - total;
+    memcpy(&entries[total], data, available * sizeof(uint16_t));
+    Ringbuf_SPSC_Consume(r, available);
+    total += available;
+  }
+
+  return total;
+}
+
+/****************************************************************************
+* DESCRIPTION: Gets one entry from the ring
+* RETURN:      TRUE if an entry was removed, FALSE if the ring is empty
+* ALGORITHM:   none
+* NOTES:       consumer only
+*****************************************************************************/
+bool Ringbuf_SPSC_Get(SPSC_RING *r, uint16_t *entry)
+{
+  uint32_t head = RING_LOAD(r->head);
+
+  if (head == r->tail_cache)
+  {
+    r->tail_cache = RING_ACQUIRE(r->tail);
+    if (head == r->tail_cache)
+      return FALSE;
+  }
+  *entry = r->data[head & r->mask];
+  RING_RELEASE(r->head, head + 1);
+
+  return TRUE;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ctest.h"
+
+// test the FIFO
+#define RING_BUFFER_DATA_SIZE 8
+#define RING_BUFFER_SIZE 16
+void testRingBuf(Test* pTest)
+{
+  RING_BUFFER test_buffer;
+  char data_store[RING_BUFFER_DATA_SIZE * RING_BUFFER_SIZE];
+  char data[RING_BUFFER_DATA_SIZE];
+  char *test_data;
+  uint8_t index;
+  uint8_t data_index;
+  uint8_t count;
+  uint8_t dummy;
+  bool status;
+
+  Ringbuf_Init(&test_buffer,data_store,RING_BUFFER_DATA_SIZE,RING_BUFFER_SIZE);
+  ct_test(pTest,Ringbuf_Empty(&test_buffer));
+
+  for (data_index = 0; data_index < RING_BUFFER_DATA_SIZE; data_index++)
+  {
+    data[data_index] = data_index;
+  }
+  status = Ringbuf_Put(&test_buffer, data);
+  ct_test(pTest,status == TRUE);
+  ct_test(pTest,!Ringbuf_Empty(&test_buffer));
+
+  test_data = Ringbuf_Get_Front(&test_buffer);
+  for (data_index = 0; data_index < RING_BUFFER_DATA_SIZE; data_index++)
+  {
+    ct_test(pTest,test_data[data_index] == data[data_index]);
+  }
+  ct_test(pTest,!Ringbuf_Empty(&test_buffer));
+
+  test_data = Ringbuf_Pop_Front(&test_buffer);
+  for (data_index = 0; data_index < RING_BUFFER_DATA_SIZE; data_index++)
+  {
+    ct_test(pTest,test_data[data_index] == data[data_index]);
+  }
+  ct_test(pTest,Ringbuf_Empty(&test_buffer));
+
+  // fill to max
+  for (index = 0; index < RING_BUFFER_SIZE; index++)
+  {
+    for (data_index = 0; data_index < RING_BUFFER_DATA_SIZE; data_index++)
+    {
+      data[data_index] = index;
+    }
+    status = Ringbuf_Put(&test_buffer, data);
+    ct_test(pTest,status == TRUE);
+    ct_test(pTest,!Ringbuf_Empty(&test_buffer));
+  }
+  // verify actions on full buffer
+  for (index = 0; index < RING_BUFFER_SIZE; index++)
+  {
+    for (data_index = 0; data_index < RING_BUFFER_DATA_SIZE; data_index++)
+    {
+      data[data_index] = index;
+    }
+    status = Ringbuf_Put(&test_buffer, data);
+    ct_test(pTest,status == FALSE);
+    ct_test(pTest,!Ringbuf_Empty(&test_buffer));
+  }
+
+  // check buffer full
+  for (index = 0; index < RING_BUFFER_SIZE; index++)
+  {
+    test_data = Ringbuf_Get_Front(&test_buffer);
+    for (data_index = 0; data_index < RING_BUFFER_DATA_SIZE; data_index++)
+    {
+      ct_test(pTest,test_data[data_index] == index);
+    }
+
+    test_data = Ringbuf_Pop_Front(&test_buffer);
+    for (data_index = 0; data_index < RING_BUFFER_DATA_SIZE; data_index++)
+    {
+      ct_test(pTest,test_data[data_index] == index);
+    }
+  }
+  ct_test(pTest,Ringbuf_Empty(&test_buffer));
+
+  // test the ring around the buffer
+  for (index = 0; index < RING_BUFFER_SIZE; index++)
+  {
+    for (count = 1; count < 4; count++)
+    {
+      dummy = index * count;
+      for (data_index = 0; data_index < RING_BUFFER_DATA_SIZE; data_index++)
+      {
+        data[data_index] = dummy;
+      }
+      status = Ringbuf_Put(&test_buffer, data);
+      ct_test(pTest,status == TRUE);
+    }
+
+    for (count = 1; count < 4; count++)
+    {
+      dummy = index * count;
+      test_data = Ringbuf_Get_Front(&test_buffer);
+      for (data_index = 0; data_index < RING_BUFFER_DATA_SIZE; data_index++)
+      {
+        ct_test(pTest,test_data[data_index] == dummy);
+      }
+
+      test_data = Ringbuf_Pop_Front(&test_buffer);
+      for (data_index = 0; data_index < RING_BUFFER_DATA_SIZE; data_index++)
+      {
+        ct_test(pTest,test_data[data_index] == dummy);
+      }
+    }
+  }
+  ct_test(pTest,Ringbuf_Empty(&test_buffer));
+
+  // head + count is past 255 when there are more than 128 elements
+  {
+    char big_store[200];
+
+    Ringbuf_Init(&test_buffer,big_store,1,200);
+    for (index = 0; index < 150; index++)
+    {
+      data[0] = index;
+      (void)Ringbuf_Put(&test_buffer, data);
+      (void)Ringbuf_Pop_Front(&test_buffer);
+    }
+    for (index = 0; index < 200; index++)
+    {
+      data[0] = index;
+      status = Ringbuf_Put(&test_buffer, data);
+      ct_test(pTest,status == TRUE);
+    }
+    for (index = 0; index < 200; index++)
+    {
+      test_data = Ringbuf_Pop_Front(&test_buffer);
+      ct_test(pTest,test_data && (uint8_t)test_data[0] == index);
+    }
+  }
+
+  return;
+}
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "monotime.h"
+
+// the threads give up the CPU when the ring is full or empty, so
+// that the test also finishes on a single core
+
+void testRingSPSC(Test* pTest)
+{
+  SPSC_RING ring;
+  uint16_t data_store[16];
+  uint16_t entries[40];
+  const uint16_t *data;
+  uint16_t entry = 0;
+  unsigned count;
+  unsigned index;
+
+  ct_test(pTest,Ringbuf_SPSC_Init(&ring,data_store,12) == FALSE);
+  ct_test(pTest,Ringbuf_SPSC_Init(&ring,data_store,0) == FALSE);
+  ct_test(pTest,Ringbuf_SPSC_Init(&ring,data_store,16) == TRUE);
+  // the indices are on their own cache lines
+  ct_test(pTest,(offsetof(SPSC_RING, head) -
+    offsetof(SPSC_RING, tail)) >= RINGBUF_CACHE_LINE);
+  ct_test(pTest,(offsetof(SPSC_RING, data) -
+    offsetof(SPSC_RING, head)) >= RINGBUF_CACHE_LINE);
+  ct_test(pTest,Ringbuf_SPSC_Count(&ring) == 0);
+  ct_test(pTest,Ringbuf_SPSC_Get(&ring,&entry) == FALSE);
+  ct_test(pTest,Ringbuf_SPSC_Peek(&ring,&data) == 0);
+
+  // fill to max
+  for (index = 0; index < 16; index++)
+  {
+    ct_test(pTest,Ringbuf_SPSC_Put(&ring,0x100 + index) == TRUE);
+  }
+  ct_test(pTest,Ringbuf_SPSC_Put(&ring,0xFFFF) == FALSE);
+  ct_test(pTest,Ringbuf_SPSC_Count(&ring) == 16);
+  for (index = 0; index < 16; index++)
+  {
+    ct_test(pTest,Ringbuf_SPSC_Get(&ring,&entry) == TRUE);
+    ct_test(pTest,entry == 0x100 + index);
+  }
+  ct_test(pTest,Ringbuf_SPSC_Get(&ring,&entry) == FALSE);
+
+  // blocks that wrap around the end of the array
+  for (index = 0; index < 40; index++)
+  {
+    entries[index] = index;
+  }
+  ct_test(pTest,Ringbuf_SPSC_Put_Block(&ring,entries,5) == 5);
+  ct_test(pTest,Ringbuf_SPSC_Get_Block(&ring,entries + 20,3) == 3);
+  ct_test(pTest,entries[20] == 0 && entries[22] == 2);
+  // only the space that is left is used
+  ct_test(pTest,Ringbuf_SPSC_Put_Block(&ring,&entries[5],20) == 14);
+  ct_test(pTest,Ringbuf_SPSC_Put_Block(&ring,entries,1) == 0);
+  // in place reads stop at the end of the array
+  count = Ringbuf_SPSC_Peek(&ring,&data);
+  ct_test(pTest,count == 13);
+  ct_test(pTest,data[0] == 3);
+  Ringbuf_SPSC_Consume(&ring,4);
+  ct_test(pTest,Ringbuf_SPSC_Count(&ring) == 12);
+  count = Ringbuf_SPSC_Get_Block(&ring,&entries[20],20);
+  ct_test(pTest,count == 12);
+  for (index = 0; index < count; index++)
+  {
+    ct_test(pTest,entries[20 + index] == 7 + index);
+  }
+  ct_test(pTest,Ringbuf_SPSC_Count(&ring) == 0);
+
+  // the free running indices wrap around 32 bits
+  ring.tail = ring.head = ring.head_cache = ring.tail_cache = 0xFFFFFFFA;
+  for (index = 0; index < 12; index++)
+  {
+    ct_test(pTest,Ringbuf_SPSC_Put(&ring,index) == TRUE);
+  }
+  ct_test(pTest,Ringbuf_SPSC_Count(&ring) == 12);
+  for (index = 0; index < 12; index++)
+  {
+    ct_test(pTest,Ringbuf_SPSC_Get(&ring,&entry) == TRUE);
+    ct_test(pTest,entry == index);
+  }
+  ct_test(pTest,Ringbuf_SPSC_Get(&ring,&entry) == FALSE);
+
+  return;
+}
+
+// a reader thread and a state machine thread
+#define SPSC_STRESS_SIZE 256
+#define SPSC_STRESS_ENTRIES 20000000
+struct spsc_stress_t
+{
+  SPSC_RING ring;
+  unsigned entries; // number of entries to pass through the ring
+  unsigned batch; // largest block, or 0 for one entry at a time
+  unsigned errors; // entries out of sequence
+};
+
+static void *spsc_producer(void *arg)
+{
+  struct spsc_stress_t *stress = arg;
+  uint16_t block[SPSC_STRESS_SIZE];
+  unsigned sequence = 0;
+  unsigned count = 0;
+  unsigned index = 0;
+  unsigned i = 0;
+  uint32_t seed = 1;
+
+  while (sequence < stress->entries)
+  {
+    if (!stress->batch)
+    {
+      if (Ringbuf_SPSC_Put(&stress->ring,(uint16_t)sequence))
+        sequence++;
+      else
+        sched_yield();
+      continue;
+    }
+    // a burst of random length, as from a read() or a FIFO
+    seed = seed * 1103515245 + 12345;
+    count = 1 + ((seed >> 16) % stress->batch);
+    if (count > stress->entries - sequence)
+      count = stress->entries - sequence;
+    for (index = 0; index < count; index++)
+    {
+      block[index] = (uint16_t)(sequence + index);
+    }
+    index = 0;
+    while (index < count)
+    {
+      i = Ringbuf_SPSC_Put_Block(&stress->ring,&block[index],
+        count - index);
+      if (!i)
+        sched_yield();
+      index += i;
+    }
+    sequence += count;
+  }
+
+  return NULL;
+}
+
+static void *spsc_consumer(void *arg)
+{
+  struct spsc_stress_t *stress = arg;
+  uint16_t block[SPSC_STRESS_SIZE];
+  unsigned sequence = 0;
+  unsigned count = 0;
+  unsigned index = 0;
+  uint32_t seed = 7;
+
+  while (sequence < stress->entries)
+  {
+    if (!stress->batch)
+    {
+      if (Ringbuf_SPSC_Get(&stress->ring,&block[0]))
+      {
+        if (block[0] != (uint16_t)sequence)
+          stress->errors++;
+        sequence++;
+      }
+      else
+        sched_yield();
+      continue;
+    }
+    seed = seed * 1103515245 + 12345;
+    count = Ringbuf_SPSC_Get_Block(&stress->ring,block,
+      1 + ((seed >> 16) % stress->batch));
+    if (!count)
+      sched_yield();
+    for (index = 0; index < count; index++)
+    {
+      if (block[index] != (uint16_t)(sequence + index))
+        stress->errors++;
+    }
+    sequence += count;
+  }
+
+  return NULL;
+}
+
+static double spsc_run(struct spsc_stress_t *stress)
+{
+  uint16_t *data_store = calloc(SPSC_STRESS_SIZE, sizeof(uint16_t));
+  pthread_t producer, consumer;
+  double start;
+
+  (void)Ringbuf_SPSC_Init(&stress->ring,data_store,SPSC_STRESS_SIZE);
+  stress->errors = 0;
+  start = OS_MonotonicSeconds();
+  pthread_create(&consumer, NULL, spsc_consumer, stress);
+  pthread_create(&producer, NULL, spsc_producer, stress);
+  pthread_join(producer, NULL);
+  pthread_join(consumer, NULL);
+  free(data_store);
+
+  return OS_MonotonicSeconds() - start;
+}
+
+void testRingSPSCStress(Test* pTest)
+{
+  struct spsc_stress_t *stress = NULL;
+
+  // the aligned members need an aligned allocation
+  if (posix_memalign((void **)&stress, RINGBUF_CACHE_LINE, sizeof(*stress)))
+    return;
+  stress->entries = SPSC_STRESS_ENTRIES;
+  stress->batch = 0;
+  (void)spsc_run(stress);
+  ct_test(pTest,stress->errors == 0);
+  ct_test(pTest,Ringbuf_SPSC_Count(&stress->ring) == 0);
+  ct_test(pTest,stress->ring.tail == SPSC_STRESS_ENTRIES);
+  stress->batch = 64;
+  (void)spsc_run(stress);
+  ct_test(pTest,stress->errors == 0);
+  ct_test(pTest,Ringbuf_SPSC_Count(&stress->ring) == 0);
+  ct_test(pTest,stress->ring.tail == SPSC_STRESS_ENTRIES);
+  free(stress);
+
+  return;
+}
+
+// the old ring behind a mutex, for comparison
+struct locked_stress_t
+{
+  RING_BUFFER ring;
+  pthread_mutex_t mutex;
+  unsigned entries;
+  unsigned errors;
+};
+
+static void *locked_producer(void *arg)
+{
+  struct locked_stress_t *stress = arg;
+  unsigned sequence = 0;
+  uint16_t entry;
+  bool status;
+
+  while (sequence < stress->entries)
+  {
+    entry = (uint16_t)sequence;
+    pthread_mutex_lock(&stress->mutex);
+    status = Ringbuf_Put(&stress->ring,(char *)&entry);
+    pthread_mutex_unlock(&stress->mutex);
+    if (status)
+      sequence++;
+    else
+      sched_yield();
+  }
+
+  return NULL;
+}
+
+static void *locked_consumer(void *arg)
+{
+  struct locked_stress_t *stress = arg;
+  unsigned sequence = 0;
+  uint16_t entry = 0;
+  char *data;
+
+  while (sequence < stress->entries)
+  {
+    pthread_mutex_lock(&stress->mutex);
+    data = Ringbuf_Pop_Front(&stress->ring);
+    if (data)
+      memcpy(&entry,data,sizeof(entry));
+    pthread_mutex_unlock(&stress->mutex);
+    if (data)
+    {
+      if (entry != (uint16_t)sequence)
+        stress->errors++;
+      sequence++;
+    }
+    else
+      sched_yield();
+  }
+
+  return NULL;
+}
+
+void benchmarkRingBuf(void)
+{
+  struct spsc_stress_t *stress = NULL;
+  struct locked_stress_t locked;
+  char data_store[2 * 255];
+  pthread_t producer, consumer;
+  unsigned batch[] = {0, 8, 64, 256};
+  double start;
+  double seconds;
+  unsigned i;
+
+  printf("\nSPSC ring throughput, two threads, %u entries of %u\n",
+    SPSC_STRESS_ENTRIES, SPSC_STRESS_SIZE);
+  printf("%-24s %10s %12s\n", "mode", "seconds", "Mentries/s");
+  locked.entries = SPSC_STRESS_ENTRIES / 4;
+  locked.errors = 0;
+  Ringbuf_Init(&locked.ring,data_store,2,255);
+  pthread_mutex_init(&locked.mutex,NULL);
+  start = OS_MonotonicSeconds();
+  pthread_create(&consumer, NULL, locked_consumer, &locked);
+  pthread_create(&producer, NULL, locked_producer, &locked);
+  pthread_join(producer, NULL);
+  pthread_join(consumer, NULL);
+  seconds = OS_MonotonicSeconds() - start;
+  pthread_mutex_destroy(&locked.mutex);
+  printf("%-24s %10.3f %12.1f%s\n", "mutex RING_BUFFER", seconds,
+    locked.entries / seconds / 1e6, locked.errors ? " ERRORS" : "");
+  if (posix_memalign((void **)&stress, RINGBUF_CACHE_LINE, sizeof(*stress)))
+    return;
+  for (i = 0; i < sizeof(batch)/sizeof(batch[0]); i++)
+  {
+    char mode[32];
+
+    stress->entries = SPSC_STRESS_ENTRIES;
+    stress->batch = batch[i];
+    seconds = spsc_run(stress);
+    if (batch[i])
+      sprintf(mode, "SPSC blocks of 1..%u", batch[i]);
+    else
+      sprintf(mode, "SPSC one at a time");
+    printf("%-24s %10.3f %12.1f%s\n", mode, seconds,
+      stress->entries / seconds / 1e6, stress->errors ? " ERRORS" : "");
+  }
+  free(stress);
+
+  return;
+}
+
+#ifdef TEST_RINGBUF
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("ringbuf", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testRingBuf);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testRingSPSC);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testRingSPSCStress);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  benchmarkRingBuf();
+
+  return 0;
+}
+#endif
+#endif
+
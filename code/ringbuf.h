@@ -0,0 +1,117 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2004 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+#ifndef RINGBUF_H
+#define RINGBUF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct ring_buffer_t
+{
+  char *data; // block of memory or array of data
+  uint8_t element_size; // how many bytes for each chunk
+  uint8_t element_count; // number of chunks of data
+  uint8_t head; // first chunk of data
+  uint8_t count; // number of chunks in use
+};
+typedef struct ring_buffer_t RING_BUFFER;
+
+extern bool Ringbuf_Empty(RING_BUFFER const *b);
+extern char *Ringbuf_Get_Front(RING_BUFFER const *b);
+extern char *Ringbuf_Pop_Front(RING_BUFFER *b);
+extern bool Ringbuf_Put(
+  RING_BUFFER *b, // ring buffer structure
+  char *data_element); // one element to add to the ring
+extern void Ringbuf_Init(
+  RING_BUFFER *b, // ring buffer structure
+  char *data, // data block or array of data
+  uint8_t element_size, // size of one element in the data block
+  uint8_t element_count); // number of elements in the data block
+
+// Lock-free ring for exactly one producer and one consumer, such as
+// a UART reader thread or ISR and the MS/TP state machine thread.
+// Each entry is 16 bits, so that an octet can carry error flags in
+// the upper byte.  The size must be a power of two.  head and tail
+// run freely and are masked on use; each side keeps a copy of the
+// other side's index on its own cache line and only reloads it when
+// the ring looks full or empty.
+#define RINGBUF_CACHE_LINE 64
+#if defined(__GNUC__)
+#define RINGBUF_CACHE_ALIGN __attribute__((aligned(RINGBUF_CACHE_LINE)))
+#else
+#define RINGBUF_CACHE_ALIGN
+#endif
+
+struct spsc_ring_t
+{
+  // producer cache line
+  uint32_t tail RINGBUF_CACHE_ALIGN; // next entry to put
+  uint32_t head_cache; // producer's copy of head
+  // consumer cache line
+  uint32_t head RINGBUF_CACHE_ALIGN; // next entry to get
+  uint32_t tail_cache; // consumer's copy of tail
+  // read only after Ringbuf_SPSC_Init
+  uint16_t *data RINGBUF_CACHE_ALIGN; // array of entries
+  uint32_t mask; // number of entries - 1
+};
+typedef struct spsc_ring_t SPSC_RING;
+
+// returns FALSE if size is not a power of two
+extern bool Ringbuf_SPSC_Init(
+  SPSC_RING *r, // ring structure
+  uint16_t *data, // array of entries
+  uint32_t size); // number of entries in the array
+// consumer side; the count may already be larger when it returns
+extern unsigned Ringbuf_SPSC_Count(SPSC_RING *r);
+// producer side
+extern bool Ringbuf_SPSC_Put(SPSC_RING *r, uint16_t entry);
+extern unsigned Ringbuf_SPSC_Put_Block(
+  SPSC_RING *r,
+  const uint16_t *entries,
+  unsigned count);
+// consumer side
+extern bool Ringbuf_SPSC_Get(SPSC_RING *r, uint16_t *entry);
+extern unsigned Ringbuf_SPSC_Get_Block(
+  SPSC_RING *r,
+  uint16_t *entries,
+  unsigned count);
+// consumer side: points to the entries that can be read in place,
+// up to the end of the array, and returns how many there are.
+// Ringbuf_SPSC_Consume releases them back to the producer.
+extern unsigned Ringbuf_SPSC_Peek(SPSC_RING *r, const uint16_t **entries);
+extern void Ringbuf_SPSC_Consume(SPSC_RING *r, unsigned count);
+
+#endif
@@ -0,0 +1,957 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+// EIA-485 Transmitter
+//
+// Sends MS/TP frames on a POSIX serial port.  SendFrame builds the
+// header and the data CRC around the caller's data, and the parts are
+// written with one writev(), so there is one system call per frame
+// and the data is not copied on the way to the kernel.
+// The turnaround before a frame is slept, not spun, and the end of
+// the frame is found with tcdrain().  On Linux, the kernel is asked
+// to drive RTS for the transceiver when the UART supports it.
+//
+// RS485_MSTP_Poll drives the state machines of many ports from one
+// thread.  Instead of a tick every millisecond, each port has a
+// deadline on the monotonic clock, when its SilenceTimer reaches the
+// next timeout it waits for.  One poll() sleeps until the earliest
+// deadline or the next octet, so an idle bus costs no CPU.
+
+// for the pseudo terminals used by the tests
+#define _GNU_SOURCE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
+
+#include "mstp.h"
+#include "monotime.h"
+#include "rs485.h" // check for valid prototypes
+
+// the most parts written by one RS485_Send
+#define RS485_PARTS_MAX 8
+
+// The most state changes of Master_Node_FSM for one wakeup of a port;
+// a port with more to do is due again at once.
+#define RS485_FSM_STEPS 8
+
+// the termios speed for a baud rate, or B0 if there is none
+static speed_t rs485_speed(unsigned baud)
+{
+  switch (baud)
+  {
+    case 9600:
+      return B9600;
+    case 19200:
+      return B19200;
+    case 38400:
+      return B38400;
+#ifdef B57600
+    case 57600:
+      return B57600;
+#endif
+#ifdef B76800
+    case 76800:
+      return B76800;
+#endif
+#ifdef B115200
+    case 115200:
+      return B115200;
+#endif
+    default:
+      break;
+  }
+
+  return B0;
+}
+
+// opens a serial port as 8 data bits, no parity, one stop bit.
+// returns false if the device cannot be opened.
+bool RS485_Open(
+  struct RS485_Port *rs485,
+  const char *device,
+  unsigned baud)
+{
+  struct termios tio;
+  speed_t speed;
+#if defined(__linux__) && defined(TIOCSRS485)
+  struct serial_rs485 config;
+#endif
+
+  memset(rs485, 0, sizeof(struct RS485_Port));
+  rs485->fd = -1;
+  if (baud == 0)
+    return false;
+  rs485->fd = open(device, O_RDWR | O_NOCTTY);
+  if (rs485->fd < 0)
+    return false;
+  rs485->baud = baud;
+  rs485->clock = OS_MonotonicNanosecs();
+  // anything that is not a terminal, such as a pipe, is written as is
+  if (tcgetattr(rs485->fd, &tio) == 0)
+  {
+    rs485->tty = true;
+    cfmakeraw(&tio);
+    tio.c_cflag |= (CLOCAL | CREAD);
+    tio.c_cflag &= ~(CSTOPB | PARENB);
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    // a baud rate without a termios speed, such as 76800,
+    // is left as it was set by other means
+    speed = rs485_speed(baud);
+    if (speed != B0)
+    {
+      cfsetispeed(&tio, speed);
+      cfsetospeed(&tio, speed);
+    }
+    (void)tcsetattr(rs485->fd, TCSANOW, &tio);
+#if defined(__linux__) && defined(TIOCSRS485)
+    // let the UART enable the driver while it sends, if it can
+    memset(&config, 0, sizeof(config));
+    config.flags = SER_RS485_ENABLED | SER_RS485_RTS_ON_SEND;
+    (void)ioctl(rs485->fd, TIOCSRS485, &config);
+#endif
+  }
+
+  return true;
+}
+
+void RS485_Close(struct RS485_Port *rs485)
+{
+  if (rs485->fd >= 0)
+    (void)close(rs485->fd);
+  rs485->fd = -1;
+
+  return;
+}
+
+// writes the parts of a frame in order, without copying them.
+// returns false if they could not all be written.
+bool RS485_Send(
+  struct RS485_Port *rs485,
+  const struct MSTP_Frame_Part *part,
+  unsigned count)
+{
+  struct iovec iov[RS485_PARTS_MAX];
+  struct iovec *next = iov; // the first part not completely written
+  struct pollfd pfd;
+  unsigned long long total = 0;
+  ssize_t written;
+  size_t skip;
+  unsigned i;
+
+  if ((rs485->fd < 0) || (count > RS485_PARTS_MAX))
+  {
+    rs485->errors++;
+    return false;
+  }
+  for (i = 0; i < count; i++)
+  {
+    iov[i].iov_base = (void *)part[i].buffer;
+    iov[i].iov_len = part[i].length;
+    total += part[i].length;
+  }
+  while (count)
+  {
+    written = writev(rs485->fd, next, (int)count);
+    rs485->writes++;
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+      {
+        // the output queue is full - wait for room
+        pfd.fd = rs485->fd;
+        pfd.events = POLLOUT;
+        (void)poll(&pfd, 1, -1);
+        continue;
+      }
+      rs485->errors++;
+      return false;
+    }
+    // a short write continues from the middle of a part
+    skip = (size_t)written;
+    while (count && (skip >= next->iov_len))
+    {
+      skip -= next->iov_len;
+      next++;
+      count--;
+    }
+    if (count)
+    {
+      next->iov_base = (char *)next->iov_base + skip;
+      next->iov_len -= skip;
+    }
+  }
+  rs485->frames++;
+  rs485->octets += total;
+
+  return true;
+}
+
+// the Send_Frame of an MSTP_Port whose Context is an RS485_Port.
+// sleeps out the turnaround, sends the frame and waits for it to drain.
+void RS485_MSTP_Send_Frame(
+  struct MSTP_Port *port,
+  const struct MSTP_Frame_Part *part,
+  unsigned count)
+{
+  struct RS485_Port *rs485 = port->Context;
+  unsigned long long silence; // nanoseconds since the last octet
+  unsigned long long now;
+  struct timespec delay;
+
+  // in order to avoid line contention.  SilenceTimer has whole
+  // milliseconds up to the clock, so the part of a millisecond since
+  // is added rather than waiting out all of the turnaround again.
+  now = OS_MonotonicNanosecs();
+  silence = (port->SilenceTimer * 1000000ULL) + (now - rs485->clock);
+  if (silence < port->Timing->Tturnaround)
+  {
+    delay.tv_sec = 0;
+    delay.tv_nsec = (long)(port->Timing->Tturnaround - silence);
+    while ((nanosleep(&delay, &delay) != 0) && (errno == EINTR))
+    {
+      // sleep for the rest
+    }
+  }
+  (void)RS485_Send(rs485, part, count);
+  // Wait until the final stop bit of the most significant CRC octet
+  // has been transmitted.
+  if (rs485->tty)
+    (void)tcdrain(rs485->fd);
+  // the time spent sending still counts for the timers that run
+  // across it, then SendFrame clears SilenceTimer as the frame ends
+  now = OS_MonotonicNanosecs();
+  MSTP_Timer_Elapsed(port, (unsigned)((now - rs485->clock) / 1000000ULL));
+  rs485->clock = now;
+
+  return;
+}
+
+// receives a block of octets, and runs the Master Node State Machine
+// for each frame, and through the states that do not wait.
+static void rs485_mstp_run(
+  struct MSTP_Port *port,
+  const UINT8 *buffer,
+  unsigned length)
+{
+  MSTP_MASTER_STATE state;
+  unsigned used;
+  unsigned steps;
+
+  // a bus monitor only receives
+  if (port->Monitor_Frame)
+  {
+    (void)MSTP_Monitor_Octets(port, buffer, length);
+    return;
+  }
+  do
+  {
+    used = MSTP_Receive_Octets(port, buffer, length);
+    buffer += used;
+    length -= used;
+    for (steps = 0; steps < RS485_FSM_STEPS; steps++)
+    {
+      state = port->Master_State;
+      Master_Node_FSM(port);
+      if (port->Master_State == state)
+        break;
+    }
+  } while (length);
+
+  return;
+}
+
+// runs the state machines of MSTP_Ports whose Context is an RS485_Port.
+// sleeps until an octet arrives on any of them or the earliest of their
+// deadlines, but not longer than timeout milliseconds (-1 for no limit).
+// returns the number of ports that were run, or -1 on an error.
+int RS485_MSTP_Poll(
+  struct MSTP_Port **ports,
+  unsigned count,
+  int timeout)
+{
+  struct pollfd pfd[RS485_POLL_PORTS_MAX];
+  UINT8 buffer[512];
+  struct RS485_Port *rs485;
+  struct timespec wait;
+  unsigned long long now;
+  unsigned long long deadline = ~0ULL; // the earliest deadline
+  unsigned long long due;
+  unsigned elapsed;
+  unsigned milliseconds;
+  unsigned i;
+  ssize_t received;
+  int ready = 0; // return value
+
+  if (count > RS485_POLL_PORTS_MAX)
+    return -1;
+  now = OS_MonotonicNanosecs();
+  if (timeout >= 0)
+    deadline = now + ((unsigned long long)timeout * 1000000ULL);
+  for (i = 0; i < count; i++)
+  {
+    rs485 = ports[i]->Context;
+    pfd[i].fd = rs485->fd;
+    pfd[i].events = POLLIN;
+    pfd[i].revents = 0;
+    milliseconds = MSTP_Timeout(ports[i]);
+    if (milliseconds != MSTP_TIMEOUT_NONE)
+    {
+      due = rs485->clock + ((unsigned long long)milliseconds * 1000000ULL);
+      if (due < deadline)
+        deadline = due;
+    }
+  }
+  if (deadline <= now)
+  {
+    wait.tv_sec = 0;
+    wait.tv_nsec = 0;
+  }
+  else if (deadline != ~0ULL)
+  {
+    wait.tv_sec = (time_t)((deadline - now) / 1000000000ULL);
+    wait.tv_nsec = (long)((deadline - now) % 1000000000ULL);
+  }
+  if (ppoll(pfd, count, (deadline == ~0ULL) ? NULL : &wait, NULL) < 0)
+  {
+    if (errno != EINTR)
+      return -1;
+  }
+  now = OS_MonotonicNanosecs();
+  for (i = 0; i < count; i++)
+  {
+    rs485 = ports[i]->Context;
+    // whole milliseconds; the rest is carried to the next wakeup
+    elapsed = (unsigned)((now - rs485->clock) / 1000000ULL);
+    if (elapsed)
+    {
+      MSTP_Timer_Elapsed(ports[i], elapsed);
+      rs485->clock += (unsigned long long)elapsed * 1000000ULL;
+    }
+    received = 0;
+    if (pfd[i].revents & (POLLIN | POLLERR | POLLHUP))
+    {
+      received = read(rs485->fd, buffer, sizeof(buffer));
+      if (received > 0)
+      {
+        rs485->received += (unsigned long long)received;
+        // SilenceTimer starts again from the last octet
+        rs485->clock = now;
+      }
+      // a hang up, or an error from the device, closes the port, or
+      // ppoll would return at once for it on every call from now on
+      else if ((received == 0) || ((errno != EINTR) && (errno != EAGAIN)))
+      {
+        rs485->errors++;
+        RS485_Close(rs485);
+      }
+    }
+    if ((received > 0) || (MSTP_Timeout(ports[i]) == 0))
+    {
+      rs485_mstp_run(ports[i], buffer, (received > 0) ? received : 0);
+      rs485->wakeups++;
+      ready++;
+    }
+  }
+
+  return ready;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "testio.h"
+#include "ctest.h"
+
+// opens a pseudo terminal.  returns the master side, which reads what
+// is written to the slave side, and the name of the slave side.
+static int test_pty(char *name, size_t size)
+{
+  int fd;
+
+  fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0)
+    return -1;
+  if ((grantpt(fd) != 0) || (unlockpt(fd) != 0) ||
+      (ptsname_r(fd, name, size) != 0))
+  {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+void testRS485Send(Test* pTest)
+{
+  struct RS485_Port rs485;
+  struct MSTP_Frame_Part part[RS485_PARTS_MAX + 1];
+  UINT8 header[MSTP_HEADER_SIZE];
+  UINT8 crc[2];
+  UINT8 data[INPUT_BUFFER_SIZE];
+  UINT8 expected[MAX_FRAME_SIZE];
+  UINT8 received[MAX_FRAME_SIZE];
+  char name[64];
+  unsigned length;
+  unsigned i;
+  int fd;
+
+  fd = test_pty(name, sizeof(name));
+  if (fd < 0)
+  {
+    printf("rs485: no pseudo terminals, skipped\n");
+    return;
+  }
+  ct_test(pTest, RS485_Open(&rs485, name, 38400));
+  ct_test(pTest, rs485.tty);
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (UINT8)(i * 7);
+  MSTP_Create_Header(header, FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY,
+    16, 5, sizeof(data));
+  MSTP_Create_Data_CRC(crc, data, sizeof(data));
+  length = MSTP_Create_Frame(expected, sizeof(expected),
+    FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 16, 5, data, sizeof(data));
+  ct_test(pTest, length == MAX_FRAME_SIZE);
+  // the parts, with an empty part in the middle
+  part[0].buffer = header;
+  part[0].length = sizeof(header);
+  part[1].buffer = data;
+  part[1].length = 0;
+  part[2].buffer = data;
+  part[2].length = sizeof(data);
+  part[3].buffer = crc;
+  part[3].length = sizeof(crc);
+  ct_test(pTest, RS485_Send(&rs485, part, 4));
+  ct_test(pTest, Test_Read(fd, received, length) == length);
+  ct_test(pTest, memcmp(received, expected, length) == 0);
+  ct_test(pTest, rs485.frames == 1);
+  ct_test(pTest, rs485.octets == length);
+  ct_test(pTest, rs485.errors == 0);
+  // too many parts
+  for (i = 0; i <= RS485_PARTS_MAX; i++)
+    part[i] = part[0];
+  ct_test(pTest, !RS485_Send(&rs485, part, RS485_PARTS_MAX + 1));
+  ct_test(pTest, rs485.errors == 1);
+  RS485_Close(&rs485);
+  ct_test(pTest, !RS485_Send(&rs485, part, 1));
+  close(fd);
+  ct_test(pTest, !RS485_Open(&rs485, "/nonexistent/tty", 38400));
+  ct_test(pTest, !RS485_Open(&rs485, name, 0));
+
+  return;
+}
+
+// the Master Node State Machine answers through the serial port
+void testRS485MSTP(Test* pTest)
+{
+  struct RS485_Port rs485;
+  struct MSTP_Port port;
+  UINT8 data[20];
+  UINT8 frame[MAX_FRAME_SIZE];
+  UINT8 expected[MAX_FRAME_SIZE];
+  UINT8 received[MAX_FRAME_SIZE];
+  char name[64];
+  unsigned length;
+  unsigned i;
+  int fd;
+
+  fd = test_pty(name, sizeof(name));
+  if (fd < 0)
+    return;
+  ct_test(pTest, RS485_Open(&rs485, name, 38400));
+  MSTP_Init(&port, 5);
+  (void)MSTP_Timing_Set(&port, 38400);
+  port.Send_Frame = RS485_MSTP_Send_Frame;
+  port.Context = &rs485;
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_IDLE);
+  // ReceivedPFM
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_POLL_FOR_MASTER, 5, 16, NULL, 0);
+  ct_test(pTest, MSTP_Receive_Octets(&port, frame, length) == length);
+  ct_test(pTest, port.ReceivedValidFrame);
+  Master_Node_FSM(&port);
+  length = MSTP_Create_Frame(expected, sizeof(expected),
+    FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER, 16, 5, NULL, 0);
+  ct_test(pTest, Test_Read(fd, received, length) == length);
+  ct_test(pTest, memcmp(received, expected, length) == 0);
+  ct_test(pTest, port.SilenceTimer == 0);
+  // a Test_Request is answered with its data
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (UINT8)i;
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_TEST_REQUEST, 5, 16, data, sizeof(data));
+  ct_test(pTest, MSTP_Receive_Octets(&port, frame, length) == length);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_ANSWER_DATA_REQUEST);
+  Master_Node_FSM(&port);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_IDLE);
+  length = MSTP_Create_Frame(expected, sizeof(expected),
+    FRAME_TYPE_TEST_RESPONSE, 16, 5, data, sizeof(data));
+  ct_test(pTest, Test_Read(fd, received, length) == length);
+  ct_test(pTest, memcmp(received, expected, length) == 0);
+  ct_test(pTest, rs485.frames == 2);
+  ct_test(pTest, rs485.writes == 2);
+  RS485_Close(&rs485);
+  close(fd);
+
+  return;
+}
+
+// a port that hears nothing polls for a successor in its slot after
+// the loss of the token, and sleeps in between
+void testRS485Poll(Test* pTest)
+{
+  struct RS485_Port rs485;
+  struct MSTP_Port port;
+  struct MSTP_Port *ports[1];
+  UINT8 frame[MAX_FRAME_SIZE];
+  UINT8 expected[MAX_FRAME_SIZE];
+  UINT8 received[MAX_FRAME_SIZE];
+  char name[64];
+  unsigned long long start;
+  unsigned long long elapsed;
+  unsigned length;
+  unsigned i;
+  int fd;
+
+  fd = test_pty(name, sizeof(name));
+  if (fd < 0)
+    return;
+  ct_test(pTest, RS485_Open(&rs485, name, 38400));
+  MSTP_Init(&port, 5);
+  (void)MSTP_Timing_Set(&port, 38400);
+  port.Nmax_master = 7;
+  port.Send_Frame = RS485_MSTP_Send_Frame;
+  port.Context = &rs485;
+  ports[0] = &port;
+  start = OS_MonotonicNanosecs();
+  for (i = 0; (i < 20) && (rs485.frames == 0); i++)
+  {
+    ct_test(pTest, RS485_MSTP_Poll(ports, 1, 1000) >= 0);
+  }
+  elapsed = (OS_MonotonicNanosecs() - start) / 1000000ULL;
+  // Tno_token plus a Tslot for each station address below ours
+  ct_test(pTest, elapsed >= 550);
+  ct_test(pTest, elapsed < 750);
+  // once to initialize, once at Tno_token and once in our slot
+  ct_test(pTest, rs485.wakeups <= 4);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_POLL_FOR_MASTER);
+  length = MSTP_Create_Frame(expected, sizeof(expected),
+    FRAME_TYPE_POLL_FOR_MASTER, 6, 5, NULL, 0);
+  ct_test(pTest, Test_Read(fd, received, length) == length);
+  ct_test(pTest, memcmp(received, expected, length) == 0);
+  // a node answers, and is passed the token
+  length = MSTP_Create_Frame(frame, sizeof(frame),
+    FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER, 5, 6, NULL, 0);
+  ct_test(pTest, write(fd, frame, length) == (ssize_t)length);
+  start = OS_MonotonicNanosecs();
+  for (i = 0; (i < 20) && (rs485.frames == 1); i++)
+  {
+    ct_test(pTest, RS485_MSTP_Poll(ports, 1, 1000) >= 0);
+  }
+  elapsed = (OS_MonotonicNanosecs() - start) / 1000000ULL;
+  ct_test(pTest, elapsed < 20);
+  ct_test(pTest, rs485.received == length);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_PASS_TOKEN);
+  ct_test(pTest, port.Next_Station == 6);
+  length = MSTP_Create_Frame(expected, sizeof(expected),
+    FRAME_TYPE_TOKEN, 6, 5, NULL, 0);
+  ct_test(pTest, Test_Read(fd, received, length) == length);
+  ct_test(pTest, memcmp(received, expected, length) == 0);
+  // the token is not used, so it is passed again after Tusage_timeout
+  start = OS_MonotonicNanosecs();
+  for (i = 0; (i < 20) && (rs485.frames == 2); i++)
+  {
+    ct_test(pTest, RS485_MSTP_Poll(ports, 1, 1000) >= 0);
+  }
+  elapsed = (OS_MonotonicNanosecs() - start) / 1000000ULL;
+  ct_test(pTest, elapsed >= 20);
+  ct_test(pTest, elapsed < 100);
+  ct_test(pTest, port.RetryCount == 1);
+  ct_test(pTest, Test_Read(fd, received, length) == length);
+  ct_test(pTest, memcmp(received, expected, length) == 0);
+  // the timeout limits the wait
+  port.Master_State = MSTP_MASTER_STATE_NO_TOKEN;
+  port.SilenceTimer = 0xFFFF;
+  ct_test(pTest, MSTP_Timeout(&port) == MSTP_TIMEOUT_NONE);
+  start = OS_MonotonicNanosecs();
+  ct_test(pTest, RS485_MSTP_Poll(ports, 1, 30) == 0);
+  elapsed = (OS_MonotonicNanosecs() - start) / 1000000ULL;
+  ct_test(pTest, (elapsed >= 29) && (elapsed < 100));
+  ct_test(pTest, rs485.errors == 0);
+  RS485_Close(&rs485);
+  close(fd);
+
+  return;
+}
+
+// frames to this station that it does not implement are dropped at
+// once, so the poll sleeps instead of running the state machines
+// again and again until the token is lost
+void testRS485PollUnwanted(Test* pTest)
+{
+  struct RS485_Port rs485;
+  struct MSTP_Port port;
+  struct MSTP_Port *ports[1];
+  UINT8 frame[2 * MAX_FRAME_SIZE];
+  UINT8 data[8] = {0};
+  char name[64];
+  unsigned long long start;
+  unsigned length;
+  int fd;
+
+  fd = test_pty(name, sizeof(name));
+  if (fd < 0)
+    return;
+  ct_test(pTest, RS485_Open(&rs485, name, 38400));
+  MSTP_Init(&port, 5);
+  (void)MSTP_Timing_Set(&port, 38400);
+  port.Send_Frame = RS485_MSTP_Send_Frame;
+  port.Context = &rs485;
+  ports[0] = &port;
+  ct_test(pTest, RS485_MSTP_Poll(ports, 1, 0) == 1);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_IDLE);
+  length = MSTP_Create_Frame(frame, sizeof(frame), 34, 5, 6,
+    data, sizeof(data));
+  length += MSTP_Create_Frame(&frame[length], sizeof(frame) - length, 8,
+    5, 6, data, sizeof(data));
+  ct_test(pTest, write(fd, frame, length) == (ssize_t)length);
+  rs485.wakeups = 0;
+  start = OS_MonotonicNanosecs();
+  while ((OS_MonotonicNanosecs() - start) < 200000000ULL)
+  {
+    ct_test(pTest, RS485_MSTP_Poll(ports, 1, 50) >= 0);
+  }
+  ct_test(pTest, rs485.received == length);
+  ct_test(pTest, port.Master_State == MSTP_MASTER_STATE_IDLE);
+  ct_test(pTest, port.ReceivedValidFrame == FALSE);
+  // once or twice as the octets arrive
+  ct_test(pTest, rs485.wakeups <= 4);
+  ct_test(pTest, rs485.frames == 0);
+  RS485_Close(&rs485);
+  close(fd);
+
+  return;
+}
+
+// a port whose device hangs up is closed once, and the poll goes
+// back to sleeping until the deadlines instead of returning at once
+void testRS485PollHangup(Test* pTest)
+{
+  struct RS485_Port rs485;
+  struct MSTP_Port port;
+  struct MSTP_Port *ports[1];
+  char name[64];
+  unsigned long long start;
+  unsigned long long elapsed;
+  unsigned i;
+  int fd;
+
+  fd = test_pty(name, sizeof(name));
+  if (fd < 0)
+    return;
+  ct_test(pTest, RS485_Open(&rs485, name, 38400));
+  MSTP_Init(&port, 5);
+  (void)MSTP_Timing_Set(&port, 38400);
+  port.Send_Frame = RS485_MSTP_Send_Frame;
+  port.Context = &rs485;
+  ports[0] = &port;
+  ct_test(pTest, RS485_MSTP_Poll(ports, 1, 0) == 1);
+  close(fd);
+  start = OS_MonotonicNanosecs();
+  for (i = 0; i < 4; i++)
+  {
+    ct_test(pTest, RS485_MSTP_Poll(ports, 1, 30) >= 0);
+  }
+  elapsed = (OS_MonotonicNanosecs() - start) / 1000000ULL;
+  ct_test(pTest, rs485.fd == -1);
+  ct_test(pTest, rs485.errors == 1);
+  // the first call returns for the hang up, and the rest sleep
+  ct_test(pTest, elapsed >= 3 * 29);
+  RS485_Close(&rs485);
+
+  return;
+}
+
+// sends frames one way for a quarter of a second
+static void benchmark_send(
+  struct RS485_Port *rs485,
+  const char *name,
+  unsigned method,
+  const UINT8 *data,
+  unsigned data_len)
+{
+  struct MSTP_Frame_Part part[MSTP_FRAME_PARTS];
+  UINT8 header[MSTP_HEADER_SIZE];
+  UINT8 crc[2];
+  UINT8 buffer[MAX_FRAME_SIZE];
+  unsigned long frames = 0;
+  unsigned length = 0;
+  unsigned count;
+  unsigned i;
+  double start;
+  double seconds;
+
+  start = OS_MonotonicSeconds();
+  do
+  {
+    for (count = 0; count < 64; count++)
+    {
+      switch (method)
+      {
+        case 0:
+          // one write per octet, as SendFrame described it
+          length = MSTP_Create_Frame(buffer, sizeof(buffer),
+            FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 16, 5,
+            data, data_len);
+          for (i = 0; i < length; i++)
+            (void)!write(rs485->fd, &buffer[i], 1);
+          break;
+        case 1:
+          // copy the data into a frame and write it
+          length = MSTP_Create_Frame(buffer, sizeof(buffer),
+            FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 16, 5,
+            data, data_len);
+          (void)!write(rs485->fd, buffer, length);
+          break;
+        default:
+          // build the header and CRC around the data and gather them
+          MSTP_Create_Header(header,
+            FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, 16, 5, data_len);
+          part[0].buffer = header;
+          part[0].length = sizeof(header);
+          length = sizeof(header);
+          if (data_len)
+          {
+            MSTP_Create_Data_CRC(crc, data, data_len);
+            part[1].buffer = data;
+            part[1].length = data_len;
+            part[2].buffer = crc;
+            part[2].length = sizeof(crc);
+            length += data_len + sizeof(crc);
+          }
+          (void)RS485_Send(rs485, part, data_len ? 3 : 1);
+          break;
+      }
+    }
+    frames += count;
+    seconds = OS_MonotonicSeconds() - start;
+  } while (seconds < 0.25);
+  printf("rs485: %-7s %4u octets %9.0f frames/s %8.1f MB/s %7.2f us/frame\n",
+    name, length, frames / seconds,
+    ((double)frames * length) / (seconds * 1000000.0),
+    (seconds * 1000000.0) / frames);
+
+  return;
+}
+
+// the cost of sending a frame, without the wire:
+// frames are written to /dev/null
+void benchmarkRS485(void)
+{
+  static const unsigned lengths[] = {0, 50, 200, INPUT_BUFFER_SIZE};
+  struct RS485_Port rs485;
+  UINT8 data[INPUT_BUFFER_SIZE];
+  unsigned i;
+
+  if (!RS485_Open(&rs485, "/dev/null", 38400))
+    return;
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (UINT8)rand();
+  for (i = 0; i < sizeof(lengths)/sizeof(lengths[0]); i++)
+  {
+    benchmark_send(&rs485, "octet", 0, data, lengths[i]);
+    benchmark_send(&rs485, "copy", 1, data, lengths[i]);
+    benchmark_send(&rs485, "writev", 2, data, lengths[i]);
+  }
+  RS485_Close(&rs485);
+
+  return;
+}
+
+static double benchmark_cpu_seconds(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+
+  return (double)now.tv_sec + ((double)now.tv_nsec / 1000000000.0);
+}
+
+// ports on a bus where another master holds the token, which they hear
+// every 250 ms, for two seconds.  They are driven either by a tick of
+// MSTP_Millisecond_Timer every millisecond, or by RS485_MSTP_Poll.
+static void benchmark_poll(unsigned count, bool tick)
+{
+  static struct RS485_Port rs485[64];
+  static struct MSTP_Port port[64];
+  struct MSTP_Port *ports[64];
+  struct pollfd pfd[64];
+  int bus[64];
+  UINT8 token[MSTP_HEADER_SIZE];
+  UINT8 buffer[512];
+  char name[64];
+  struct timespec next;
+  unsigned long wakeups = 0;
+  double start, cpu, now;
+  double next_token;
+  ssize_t received;
+  unsigned i;
+
+  if (count > 64)
+    count = 64;
+  for (i = 0; i < count; i++)
+  {
+    bus[i] = test_pty(name, sizeof(name));
+    if ((bus[i] < 0) || !RS485_Open(&rs485[i], name, 38400))
+    {
+      printf("rs485: no pseudo terminals, skipped\n");
+      return;
+    }
+    MSTP_Init(&port[i], (UINT8)i);
+    (void)MSTP_Timing_Set(&port[i], 38400);
+    port[i].Send_Frame = RS485_MSTP_Send_Frame;
+    port[i].Context = &rs485[i];
+    ports[i] = &port[i];
+    pfd[i].fd = rs485[i].fd;
+    pfd[i].events = POLLIN;
+  }
+  (void)MSTP_Create_Frame(token, sizeof(token), FRAME_TYPE_TOKEN,
+    100, 101, NULL, 0);
+  start = OS_MonotonicSeconds();
+  cpu = benchmark_cpu_seconds();
+  next_token = start;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  while ((now = OS_MonotonicSeconds()) < (start + 2.0))
+  {
+    if (now >= next_token)
+    {
+      for (i = 0; i < count; i++)
+        (void)!write(bus[i], token, sizeof(token));
+      next_token += 0.25;
+    }
+    if (tick)
+    {
+      next.tv_nsec += 1000000;
+      if (next.tv_nsec >= 1000000000)
+      {
+        next.tv_nsec -= 1000000000;
+        next.tv_sec++;
+      }
+      (void)clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+      (void)poll(pfd, count, 0);
+      for (i = 0; i < count; i++)
+      {
+        MSTP_Millisecond_Timer(&port[i]);
+        received = 0;
+        if (pfd[i].revents & POLLIN)
+          received = read(rs485[i].fd, buffer, sizeof(buffer));
+        rs485_mstp_run(&port[i], buffer, (received > 0) ? received : 0);
+        wakeups++;
+      }
+    }
+    else
+      (void)RS485_MSTP_Poll(ports, count,
+        (int)((next_token - now) * 1000.0) + 1);
+  }
+  cpu = benchmark_cpu_seconds() - cpu;
+  for (i = 0; i < count; i++)
+  {
+    wakeups += rs485[i].wakeups;
+    if (port[i].Master_State != MSTP_MASTER_STATE_IDLE)
+      printf("rs485: port %u lost the token\n", i);
+    RS485_Close(&rs485[i]);
+    close(bus[i]);
+  }
+  printf("rs485: %2u ports %-9s %8.1f ms CPU in 2 s %8lu wakeups\n",
+    count, tick ? "1 ms tick" : "deadline", cpu * 1000.0, wakeups);
+
+  return;
+}
+
+#ifdef TEST_RS485
+int main(void)
+{
+  Test *pTest;
+  bool rc;
+
+  pTest = ct_create("rs485", NULL);
+
+  /* individual tests */
+  rc = ct_addTestFunction(pTest, testRS485Send);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testRS485MSTP);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testRS485Poll);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testRS485PollUnwanted);
+  assert(rc);
+  rc = ct_addTestFunction(pTest, testRS485PollHangup);
+  assert(rc);
+
+  ct_setStream(pTest, stdout);
+  ct_run(pTest);
+  (void)ct_report(pTest);
+
+  ct_destroy(pTest);
+
+  benchmarkRS485();
+  benchmark_poll(1, true);
+  benchmark_poll(1, false);
+  benchmark_poll(32, true);
+  benchmark_poll(32, false);
+
+  return 0;
+}
+#endif /* TEST_RS485 */
+#endif /* TEST */
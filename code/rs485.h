@@ -0,0 +1,110 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef RS485_H
+#define RS485_H
+
+#include <stdbool.h>
+#include "mstp.h"
+
+// EIA-485 transmitter on a POSIX serial port.
+// Frames are written with one writev() of their parts, so the data
+// of a frame goes from the caller's buffer to the kernel uncopied.
+
+struct RS485_Port
+{
+  int fd; // the open serial port, or -1
+  unsigned baud; // bits per second
+  bool tty; // the device is a terminal, so it can be drained
+  // what has been sent
+  unsigned long frames;
+  unsigned long long octets;
+  unsigned long writes; // calls to writev
+  unsigned long errors;
+  // what has been received
+  unsigned long long received; // octets
+  unsigned long wakeups; // times the state machines were run
+  // CLOCK_MONOTONIC nanoseconds up to which the MS/TP timers of the
+  // port have been advanced by RS485_MSTP_Poll
+  unsigned long long clock;
+};
+
+// the most ports that one RS485_MSTP_Poll can wait on
+#define RS485_POLL_PORTS_MAX 256
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// opens a serial port as 8 data bits, no parity, one stop bit.
+// returns false if the device cannot be opened.
+// The caller must set the MSTP_Port that uses it to the same rate
+// with MSTP_Timing_Set(port, baud), whose Tturnaround is waited out
+// before each frame.
+bool RS485_Open(
+  struct RS485_Port *rs485,
+  const char *device,
+  unsigned baud);
+
+void RS485_Close(struct RS485_Port *rs485);
+
+// writes the parts of a frame in order, without copying them.
+// returns false if they could not all be written.
+bool RS485_Send(
+  struct RS485_Port *rs485,
+  const struct MSTP_Frame_Part *part,
+  unsigned count);
+
+// the Send_Frame of an MSTP_Port whose Context is an RS485_Port.
+// sleeps out the turnaround, sends the frame and waits for it to drain.
+void RS485_MSTP_Send_Frame(
+  struct MSTP_Port *port,
+  const struct MSTP_Frame_Part *part,
+  unsigned count);
+
+// runs the state machines of MSTP_Ports whose Context is an RS485_Port.
+// sleeps until an octet arrives on any of them or the earliest of their
+// deadlines, but not longer than timeout milliseconds (-1 for no limit).
+// a port whose device hangs up or fails is closed, and its fd is -1.
+// returns the number of ports that were run, or -1 on an error.
+int RS485_MSTP_Poll(
+  struct MSTP_Port **ports,
+  unsigned count,
+  int timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
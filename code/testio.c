@@ -0,0 +1,56 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#include <poll.h>
+#include <unistd.h>
+#include "testio.h" // check for valid prototypes
+
+unsigned Test_Read(int fd, uint8_t *buffer, unsigned length)
+{
+  struct pollfd pfd;
+  unsigned index = 0;
+  ssize_t count;
+
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  while ((index < length) && (poll(&pfd, 1, 1000) > 0))
+  {
+    count = read(fd, &buffer[index], length - index);
+    if (count <= 0)
+      break;
+    index += (unsigned)count;
+  }
+
+  return index;
+}